@@ -23,12 +23,47 @@
 /* Page heap flags */
 #define DPH_FLAG_DLL_NOTIFY 0x40
 
+/* Loader workers used during process initialization */
+#define LDRP_DEFAULT_MAP_WORKERS 4
+
 typedef struct _LDRP_TLS_DATA
 {
     LIST_ENTRY TlsLinks;
     IMAGE_TLS_DIRECTORY TlsDirectory;
 } LDRP_TLS_DATA, *PLDRP_TLS_DATA;
 
+typedef struct _LDRP_MAPPED_DLL
+{
+    UNICODE_STRING FullDllName;
+    UNICODE_STRING BaseDllName;
+    HANDLE SectionHandle;
+    PVOID ViewBase;
+    SIZE_T ViewSize;
+    NTSTATUS Status;
+    BOOLEAN KnownDll;
+    BOOLEAN Relocated;
+} LDRP_MAPPED_DLL, *PLDRP_MAPPED_DLL;
+
+typedef struct _LDRP_SNAP_STATS
+{
+    ULONG Snaps;
+    ULONG ByOrdinal;
+    ULONG ByHint;
+    ULONG ByIndex;
+    ULONG BySearch;
+    ULONG Indexes;
+    LONGLONG SnapTicks;
+} LDRP_SNAP_STATS, *PLDRP_SNAP_STATS;
+
+typedef struct _LDRP_MAP_STATS
+{
+    ULONG Workers;
+    ULONG Mapped;
+    ULONG Taken;
+    ULONG Discarded;
+    ULONG Waits;
+} LDRP_MAP_STATS, *PLDRP_MAP_STATS;
+
 typedef
 NTSTATUS
 (NTAPI* PLDR_APP_COMPAT_DLL_REDIRECTION_CALLBACK_FUNCTION)(
@@ -45,6 +80,7 @@ extern BOOLEAN LdrpInLdrInit;
 extern PVOID LdrpHeap;
 extern LIST_ENTRY LdrpHashTable[LDR_HASH_TABLE_ENTRIES];
 extern BOOLEAN ShowSnaps;
+extern LDRP_SNAP_STATS LdrpSnapStats;
 extern UNICODE_STRING LdrpDefaultPath;
 extern HANDLE LdrpKnownDllObjectDirectory;
 extern ULONG LdrpNumberOfProcessors;
@@ -96,6 +132,16 @@ NTSTATUS NTAPI
 LdrpWalkImportDescriptor(IN LPWSTR DllPath OPTIONAL,
                          IN PLDR_DATA_TABLE_ENTRY LdrEntry);
 
+USHORT NTAPI
+LdrpNameToOrdinalIndexed(IN LPSTR ImportName,
+                         IN PVOID ExportBase,
+                         IN PIMAGE_EXPORT_DIRECTORY ExportDirectory,
+                         IN PULONG NameTable,
+                         IN PUSHORT OrdinalTable);
+
+VOID NTAPI
+LdrpDropExportIndex(IN PVOID ExportBase);
+
 
 /* ldrutils.c */
 NTSTATUS NTAPI
@@ -173,6 +219,31 @@ LdrpLoadShimEngine(IN PWSTR ImageName,
 VOID NTAPI
 LdrpUnloadShimEngine(VOID);
 
+BOOLEAN NTAPI
+LdrpResolveDllName(PWSTR DllPath,
+                   PWSTR DllName,
+                   PUNICODE_STRING FullDllName,
+                   PUNICODE_STRING BaseDllName);
+
+/* ldrmap.c */
+VOID NTAPI
+LdrpStartMapWorkers(IN ULONG WorkerCount);
+
+VOID NTAPI
+LdrpStopMapWorkers(OUT PLDRP_MAP_STATS Stats OPTIONAL);
+
+BOOLEAN NTAPI
+LdrpIsMapWorkerThread(VOID);
+
+VOID NTAPI
+LdrpQueueMapImports(IN PWSTR SearchPath OPTIONAL,
+                    IN PVOID ImageBase);
+
+BOOLEAN NTAPI
+LdrpTakeMappedDll(IN PWSTR SearchPath OPTIONAL,
+                  IN PWSTR DllName,
+                  OUT PLDRP_MAPPED_DLL MappedDll);
+
 /* verifier.c */
 
 NTSTATUS NTAPI
@@ -1538,6 +1538,9 @@ LdrUnloadDll(IN PVOID BaseAddress)
             DPRINT1(".NET Images are not supported yet\n");
         }
 
+        /* Forget its export index, another image may get this address */
+        LdrpDropExportIndex(CurrentEntry->DllBase);
+
         /* Check if we should unmap*/
         if (!(CurrentEntry->Flags & LDR_COR_OWNS_UNMAP))
         {
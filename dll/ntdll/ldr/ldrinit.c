@@ -959,6 +959,15 @@ LdrShutdownProcess(VOID)
     if (ShowSnaps)
     {
         DPRINT1("\n");
+        DPRINT1("LDR: %wZ snapped %lu imports: %lu by ordinal, %lu by hint, "
+                "%lu through %lu export indexes, %lu by binary search\n",
+                &LdrpImageEntry->BaseDllName,
+                LdrpSnapStats.Snaps,
+                LdrpSnapStats.ByOrdinal,
+                LdrpSnapStats.ByHint,
+                LdrpSnapStats.ByIndex,
+                LdrpSnapStats.Indexes,
+                LdrpSnapStats.BySearch);
     }
 
     /* Set the shutdown variables */
@@ -1747,6 +1756,67 @@ LdrpInitializeDotLocalSupport(PRTL_USER_PROCESS_PARAMETERS ProcessParameters)
     }
 }
 
+static
+ULONG
+LdrpTicksToMicroseconds(IN LONGLONG Ticks,
+                        IN PLARGE_INTEGER Frequency)
+{
+    if (!Frequency->QuadPart) return 0;
+    return (ULONG)((Ticks * 1000000) / Frequency->QuadPart);
+}
+
+static
+VOID
+LdrpTraceProcessStartup(IN PLARGE_INTEGER StartTime,
+                        IN PLARGE_INTEGER ImportTime,
+                        IN PLARGE_INTEGER SnapTime,
+                        IN PLDRP_MAP_STATS MapStats)
+{
+    PPEB Peb = NtCurrentPeb();
+    PLIST_ENTRY ListHead, NextEntry;
+    LARGE_INTEGER InitTime, Frequency;
+    ULONG ModuleCount = 0;
+
+    NtQueryPerformanceCounter(&InitTime, &Frequency);
+
+    /* Count what got loaded */
+    ListHead = &Peb->Ldr->InLoadOrderModuleList;
+    for (NextEntry = ListHead->Flink; NextEntry != ListHead; NextEntry = NextEntry->Flink)
+    {
+        ModuleCount++;
+    }
+
+    /* One record per process, visible by default when snaps are shown */
+    DbgPrintEx(DPFLTR_LDR_ID,
+               ShowSnaps ? DPFLTR_ERROR_LEVEL : DPFLTR_INFO_LEVEL,
+               "LDR: Startup of %wZ: %lu modules; setup %lu us, imports %lu us, "
+               "init routines %lu us; %lu workers mapped %lu DLLs (%lu used, "
+               "%lu dropped, %lu waits)\n",
+               &LdrpImageEntry->BaseDllName,
+               ModuleCount,
+               LdrpTicksToMicroseconds(ImportTime->QuadPart - StartTime->QuadPart, &Frequency),
+               LdrpTicksToMicroseconds(SnapTime->QuadPart - ImportTime->QuadPart, &Frequency),
+               LdrpTicksToMicroseconds(InitTime.QuadPart - SnapTime->QuadPart, &Frequency),
+               MapStats->Workers,
+               MapStats->Mapped,
+               MapStats->Taken,
+               MapStats->Discarded,
+               MapStats->Waits);
+
+    /* And how the imports got resolved */
+    DbgPrintEx(DPFLTR_LDR_ID,
+               ShowSnaps ? DPFLTR_ERROR_LEVEL : DPFLTR_INFO_LEVEL,
+               "LDR: Startup of %wZ: %lu imports snapped in %lu us; %lu by ordinal, "
+               "%lu by hint, %lu through %lu export indexes, %lu by binary search\n",
+               &LdrpImageEntry->BaseDllName,
+               LdrpSnapStats.Snaps,
+               LdrpTicksToMicroseconds(LdrpSnapStats.SnapTicks, &Frequency),
+               LdrpSnapStats.ByOrdinal,
+               LdrpSnapStats.ByHint,
+               LdrpSnapStats.ByIndex,
+               LdrpSnapStats.Indexes,
+               LdrpSnapStats.BySearch);
+}
 
 NTSTATUS
 NTAPI
@@ -1788,6 +1858,12 @@ LdrpInitializeProcess(IN PCONTEXT Context,
     PWCHAR Current;
     ULONG ExecuteOptions = 0;
     PVOID ViewBase;
+    ULONG LoaderThreads;
+    LDRP_MAP_STATS MapStats;
+    LARGE_INTEGER StartTime, ImportTime, SnapTime;
+
+    /* Remember when we started, for the startup trace */
+    NtQueryPerformanceCounter(&StartTime, NULL);
 
     /* Set a NULL SEH Filter */
     RtlSetUnhandledExceptionFilter(NULL);
@@ -2022,6 +2098,10 @@ LdrpInitializeProcess(IN PCONTEXT Context,
         return STATUS_NO_MEMORY;
     }
 
+    /* Loader workers share the process heap with us, so it must be serialized */
+    LoaderThreads = (HeapFlags & HEAP_NO_SERIALIZE) ?
+                    0 : min(LdrpNumberOfProcessors, LDRP_DEFAULT_MAP_WORKERS);
+
     /* Allocate an Activation Context Stack */
     Status = RtlAllocateActivationContextStack(&Teb->ActivationContextStackPointer);
     if (!NT_SUCCESS(Status)) return Status;
@@ -2056,6 +2136,17 @@ LdrpInitializeProcess(IN PCONTEXT Context,
                 RtlpPageHeapEnabled = FALSE;
             }
         }
+
+        /* Check if the number of loader workers is overridden, 0 disables them */
+        if (LoaderThreads)
+        {
+            LdrQueryImageFileKeyOption(OptionsKey,
+                                       L"MaxLoaderThreads",
+                                       REG_DWORD,
+                                       &LoaderThreads,
+                                       sizeof(ULONG),
+                                       NULL);
+        }
     }
 
     /* Build the NTDLL Path */
@@ -2348,8 +2439,12 @@ LdrpInitializeProcess(IN PCONTEXT Context,
         Kernel32BaseQueryModuleData = FunctionAddress;
     }
 
-    /* Walk the IAT and load all the DLLs */
+    /* Walk the IAT and load all the DLLs, with the loader workers mapping ahead */
+    NtQueryPerformanceCounter(&ImportTime, NULL);
+    LdrpStartMapWorkers(LoaderThreads);
     ImportStatus = LdrpWalkImportDescriptor(LdrpDefaultPath.Buffer, LdrpImageEntry);
+    LdrpStopMapWorkers(&MapStats);
+    NtQueryPerformanceCounter(&SnapTime, NULL);
 
     /* Check if relocation is needed */
     if (Peb->ImageBaseAddress != (PVOID)NtHeader->OptionalHeader.ImageBase)
@@ -2505,6 +2600,9 @@ LdrpInitializeProcess(IN PCONTEXT Context,
         return Status;
     }
 
+    /* Trace how long each phase of the startup took */
+    LdrpTraceProcessStartup(&StartTime, &ImportTime, &SnapTime, &MapStats);
+
     /* Notify Shim Engine */
     if (g_ShimsEnabled)
     {
@@ -2588,6 +2686,9 @@ LdrpInit(PCONTEXT Context,
         Teb->DeallocationStack = MemoryBasicInfo.AllocationBase;
     }
 
+    /* Loader workers run while the process is initializing and never need thread init */
+    if (LdrpIsMapWorkerThread()) return;
+
     /* Now check if the process is already being initialized */
     while (_InterlockedCompareExchange(&LdrpProcessInitialized,
                                       1,
@@ -0,0 +1,748 @@
+/*
+ * PROJECT:     ReactOS NT User Mode Library
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Parallel mapping of static imports during process initialization
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+/*
+ * While the main thread walks the import graph of the executable, a small
+ * pool of loader workers opens, maps and (where no policy decision is
+ * involved) relocates the DLLs it is going to need next. The workers read
+ * the import directory of every view they map and queue its dependencies
+ * in turn, so the graph is discovered ahead of the depth-first walk.
+ *
+ * The workers never touch the loader lists. LdrpMapDll picks up finished
+ * views through LdrpTakeMappedDll, so data table entries, snapping and the
+ * initialization order are produced by the main thread exactly as before.
+ * Anything a worker cannot handle is simply left to LdrpMapDll, which then
+ * takes the regular path and reports errors the usual way.
+ */
+
+/* INCLUDES *****************************************************************/
+
+#include <ntdll.h>
+
+#define NDEBUG
+#include <debug.h>
+
+/* GLOBALS *******************************************************************/
+
+#define LDRP_MAP_HASH_BUCKETS   64
+#define LDRP_MAX_MAP_WORKERS    16
+
+typedef enum _LDRP_MAP_STATE
+{
+    LdrpMapQueued,
+    LdrpMapMapping,
+    LdrpMapMapped,
+    LdrpMapFailed,
+    LdrpMapTaken
+} LDRP_MAP_STATE;
+
+typedef struct _LDRP_MAP_WORK
+{
+    struct _LDRP_MAP_WORK *HashNext;
+    LIST_ENTRY QueueLinks;
+    PWSTR SearchPath;
+    UNICODE_STRING DllName;
+    LDRP_MAP_STATE State;
+    LDRP_MAPPED_DLL Result;
+} LDRP_MAP_WORK, *PLDRP_MAP_WORK;
+
+BOOLEAN LdrpMapInitialized;
+BOOLEAN LdrpMapActive;
+BOOLEAN LdrpMapShutdown;
+RTL_CRITICAL_SECTION LdrpMapLock;
+PLDRP_MAP_WORK LdrpMapHash[LDRP_MAP_HASH_BUCKETS];
+LIST_ENTRY LdrpMapQueue;
+HANDLE LdrpMapSemaphore;
+HANDLE LdrpMapDoneEvent;
+ULONG LdrpMapWorkerCount;
+HANDLE LdrpMapThreads[LDRP_MAX_MAP_WORKERS];
+HANDLE LdrpMapThreadIds[LDRP_MAX_MAP_WORKERS];
+LDRP_MAP_STATS LdrpMapStats;
+
+/* FUNCTIONS *****************************************************************/
+
+static
+ULONG
+LdrpHashMapName(IN PUNICODE_STRING DllName)
+{
+    ULONG Hash = 0;
+
+    RtlHashUnicodeString(DllName, TRUE, HASH_STRING_ALGORITHM_X65599, &Hash);
+    return Hash & (LDRP_MAP_HASH_BUCKETS - 1);
+}
+
+static
+PLDRP_MAP_WORK
+LdrpFindMapWork(IN PWSTR SearchPath,
+                IN PUNICODE_STRING DllName)
+{
+    PLDRP_MAP_WORK Work;
+
+    /* Entries without a search path stand for modules that are loaded */
+    for (Work = LdrpMapHash[LdrpHashMapName(DllName)]; Work; Work = Work->HashNext)
+    {
+        if ((!Work->SearchPath || Work->SearchPath == SearchPath) &&
+            RtlEqualUnicodeString(&Work->DllName, DllName, TRUE))
+        {
+            return Work;
+        }
+    }
+
+    return NULL;
+}
+
+static
+PLDRP_MAP_WORK
+LdrpInsertMapWork(IN PWSTR SearchPath OPTIONAL,
+                  IN PUNICODE_STRING DllName,
+                  IN LDRP_MAP_STATE State)
+{
+    PLDRP_MAP_WORK Work;
+    ULONG Bucket;
+
+    /* The name is kept right behind the work item */
+    Work = RtlAllocateHeap(LdrpHeap,
+                           HEAP_ZERO_MEMORY,
+                           sizeof(*Work) + DllName->Length + sizeof(UNICODE_NULL));
+    if (!Work) return NULL;
+
+    Work->SearchPath = SearchPath;
+    Work->DllName.Buffer = (PWSTR)(Work + 1);
+    Work->DllName.MaximumLength = DllName->Length + sizeof(UNICODE_NULL);
+    RtlCopyUnicodeString(&Work->DllName, DllName);
+    Work->State = State;
+
+    Bucket = LdrpHashMapName(DllName);
+    Work->HashNext = LdrpMapHash[Bucket];
+    LdrpMapHash[Bucket] = Work;
+
+    /* Hand it to a worker if it still has to be mapped */
+    if (State == LdrpMapQueued)
+    {
+        InsertTailList(&LdrpMapQueue, &Work->QueueLinks);
+        NtReleaseSemaphore(LdrpMapSemaphore, 1, NULL);
+    }
+
+    return Work;
+}
+
+static
+VOID
+LdrpReleaseMappedDll(IN PLDRP_MAPPED_DLL MappedDll)
+{
+    if (MappedDll->ViewBase) NtUnmapViewOfSection(NtCurrentProcess(), MappedDll->ViewBase);
+    if (MappedDll->SectionHandle) NtClose(MappedDll->SectionHandle);
+    LdrpFreeUnicodeString(&MappedDll->FullDllName);
+    LdrpFreeUnicodeString(&MappedDll->BaseDllName);
+    RtlZeroMemory(MappedDll, sizeof(*MappedDll));
+}
+
+static
+VOID
+LdrpQueueMapName(IN PWSTR SearchPath,
+                 IN LPSTR ImportName)
+{
+    ANSI_STRING AnsiString;
+    UNICODE_STRING DllName;
+    WCHAR NameBuffer[MAX_PATH];
+    BOOLEAN GotExtension = FALSE;
+    USHORT i;
+
+    /* Convert the import name the same way LdrpLoadImportModule does */
+    RtlInitAnsiString(&AnsiString, ImportName);
+    RtlInitEmptyUnicodeString(&DllName, NameBuffer, sizeof(NameBuffer));
+    if (!NT_SUCCESS(RtlAnsiStringToUnicodeString(&DllName, &AnsiString, FALSE))) return;
+
+    for (i = 0; i < DllName.Length / sizeof(WCHAR); i++)
+    {
+        /* Names with a path are left to the main thread */
+        if (DllName.Buffer[i] == L'\\' || DllName.Buffer[i] == L'/') return;
+        if (DllName.Buffer[i] == L'.') GotExtension = TRUE;
+    }
+
+    /* Add the default extension if there is none */
+    if (!GotExtension)
+    {
+        if (DllName.Length + LdrApiDefaultExtension.Length >= sizeof(NameBuffer)) return;
+        RtlAppendUnicodeStringToString(&DllName, &LdrApiDefaultExtension);
+    }
+
+    /* Queue it unless somebody already has it */
+    RtlEnterCriticalSection(&LdrpMapLock);
+    if (!LdrpMapShutdown && !LdrpFindMapWork(SearchPath, &DllName))
+    {
+        LdrpInsertMapWork(SearchPath, &DllName, LdrpMapQueued);
+    }
+    RtlLeaveCriticalSection(&LdrpMapLock);
+}
+
+VOID
+NTAPI
+LdrpQueueMapImports(IN PWSTR SearchPath OPTIONAL,
+                    IN PVOID ImageBase)
+{
+    PIMAGE_IMPORT_DESCRIPTOR ImportEntry;
+    ULONG ImportSize;
+
+    /* Nothing to do outside of process initialization */
+    if (!LdrpMapActive) return;
+    if (!SearchPath) SearchPath = LdrpDefaultPath.Buffer;
+
+    /* Get the import directory */
+    ImportEntry = RtlImageDirectoryEntryToData(ImageBase,
+                                               TRUE,
+                                               IMAGE_DIRECTORY_ENTRY_IMPORT,
+                                               &ImportSize);
+    if (!ImportEntry) return;
+
+    _SEH2_TRY
+    {
+        /* Queue every DLL it refers to */
+        while ((ImportEntry->Name) && (ImportEntry->FirstThunk))
+        {
+            LdrpQueueMapName(SearchPath,
+                             (LPSTR)((ULONG_PTR)ImageBase + ImportEntry->Name));
+            ImportEntry++;
+        }
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        /* A broken import table is reported by the main thread */
+        DPRINT1("LDR: Malformed import table in image at %p\n", ImageBase);
+    }
+    _SEH2_END;
+}
+
+static
+NTSTATUS
+LdrpOpenKnownDllSection(IN PLDRP_MAP_WORK Work)
+{
+    PLDRP_MAPPED_DLL Result = &Work->Result;
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    PWCHAR p;
+    NTSTATUS Status;
+
+    /* Try to open the section in the Known DLLs directory */
+    InitializeObjectAttributes(&ObjectAttributes,
+                               &Work->DllName,
+                               OBJ_CASE_INSENSITIVE,
+                               LdrpKnownDllObjectDirectory,
+                               NULL);
+    Status = NtOpenSection(&Result->SectionHandle,
+                           SECTION_MAP_READ | SECTION_MAP_EXECUTE | SECTION_MAP_WRITE,
+                           &ObjectAttributes);
+    if (!NT_SUCCESS(Status))
+    {
+        Result->SectionHandle = NULL;
+        return Status;
+    }
+
+    /* Build the same names LdrpCheckForKnownDll would */
+    Result->BaseDllName.Length = Work->DllName.Length;
+    Result->BaseDllName.MaximumLength = Work->DllName.Length + sizeof(UNICODE_NULL);
+    Result->BaseDllName.Buffer = RtlAllocateHeap(LdrpHeap,
+                                                 0,
+                                                 Result->BaseDllName.MaximumLength);
+    Result->FullDllName.Length = LdrpKnownDllPath.Length + sizeof(WCHAR) + Work->DllName.Length;
+    Result->FullDllName.MaximumLength = Result->FullDllName.Length + sizeof(UNICODE_NULL);
+    Result->FullDllName.Buffer = RtlAllocateHeap(LdrpHeap,
+                                                 0,
+                                                 Result->FullDllName.MaximumLength);
+    if (!Result->BaseDllName.Buffer || !Result->FullDllName.Buffer)
+    {
+        LdrpReleaseMappedDll(Result);
+        return STATUS_NO_MEMORY;
+    }
+
+    RtlCopyMemory(Result->BaseDllName.Buffer,
+                  Work->DllName.Buffer,
+                  Result->BaseDllName.MaximumLength);
+
+    p = Result->FullDllName.Buffer;
+    RtlCopyMemory(p, LdrpKnownDllPath.Buffer, LdrpKnownDllPath.Length);
+    p += LdrpKnownDllPath.Length / sizeof(WCHAR);
+    *p++ = L'\\';
+    RtlCopyMemory(p, Work->DllName.Buffer, Work->DllName.MaximumLength);
+
+    Result->KnownDll = TRUE;
+    return STATUS_SUCCESS;
+}
+
+static
+NTSTATUS
+LdrpCreateMapSection(IN PLDRP_MAP_WORK Work)
+{
+    PLDRP_MAPPED_DLL Result = &Work->Result;
+    UNICODE_STRING NtPathDllName;
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    IO_STATUS_BLOCK IoStatusBlock;
+    HANDLE FileHandle;
+    NTSTATUS Status;
+
+    /* Find the file */
+    if (!LdrpResolveDllName(Work->SearchPath,
+                            Work->DllName.Buffer,
+                            &Result->FullDllName,
+                            &Result->BaseDllName))
+    {
+        return STATUS_DLL_NOT_FOUND;
+    }
+
+    /* Convert to NT Name */
+    if (!RtlDosPathNameToNtPathName_U(Result->FullDllName.Buffer,
+                                      &NtPathDllName,
+                                      NULL,
+                                      NULL))
+    {
+        return STATUS_OBJECT_PATH_SYNTAX_BAD;
+    }
+
+    /* Open it. Unlike LdrpCreateDllSection, don't retry for execute-only access */
+    InitializeObjectAttributes(&ObjectAttributes,
+                               &NtPathDllName,
+                               OBJ_CASE_INSENSITIVE,
+                               NULL,
+                               NULL);
+    Status = NtOpenFile(&FileHandle,
+                        SYNCHRONIZE | FILE_EXECUTE | FILE_READ_DATA,
+                        &ObjectAttributes,
+                        &IoStatusBlock,
+                        FILE_SHARE_READ | FILE_SHARE_DELETE,
+                        FILE_NON_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT);
+    RtlFreeHeap(RtlGetProcessHeap(), 0, NtPathDllName.Buffer);
+    if (!NT_SUCCESS(Status)) return Status;
+
+    /* Create the image section */
+    Status = NtCreateSection(&Result->SectionHandle,
+                             SECTION_MAP_READ | SECTION_MAP_EXECUTE |
+                             SECTION_MAP_WRITE | SECTION_QUERY,
+                             NULL,
+                             NULL,
+                             PAGE_EXECUTE,
+                             SEC_IMAGE,
+                             FileHandle);
+    if (!NT_SUCCESS(Status)) Result->SectionHandle = NULL;
+
+    NtClose(FileHandle);
+    return Status;
+}
+
+static
+NTSTATUS
+LdrpRelocateMappedDll(IN PLDRP_MAPPED_DLL MappedDll)
+{
+    PIMAGE_NT_HEADERS NtHeaders;
+    UNICODE_STRING IllegalDll;
+    PVOID RelocData;
+    ULONG RelocDataSize = 0;
+    NTSTATUS Status;
+
+    /* Leave everything that needs a policy decision to LdrpMapDll */
+    NtHeaders = RtlImageNtHeader(MappedDll->ViewBase);
+    if (!(NtHeaders->FileHeader.Characteristics & IMAGE_FILE_DLL) ||
+        (NtHeaders->FileHeader.Characteristics & IMAGE_FILE_RELOCS_STRIPPED))
+    {
+        return STATUS_SUCCESS;
+    }
+
+    RelocData = RtlImageDirectoryEntryToData(MappedDll->ViewBase,
+                                             TRUE,
+                                             IMAGE_DIRECTORY_ENTRY_BASERELOC,
+                                             &RelocDataSize);
+    if (!RelocData && !RelocDataSize) return STATUS_SUCCESS;
+
+    RtlInitUnicodeString(&IllegalDll, L"user32.dll");
+    if (RtlEqualUnicodeString(&MappedDll->BaseDllName, &IllegalDll, TRUE)) return STATUS_SUCCESS;
+    RtlInitUnicodeString(&IllegalDll, L"kernel32.dll");
+    if (RtlEqualUnicodeString(&MappedDll->BaseDllName, &IllegalDll, TRUE)) return STATUS_SUCCESS;
+
+    /* Apply the fixups */
+    Status = LdrpSetProtection(MappedDll->ViewBase, FALSE);
+    if (NT_SUCCESS(Status))
+    {
+        Status = LdrRelocateImageWithBias(MappedDll->ViewBase, 0LL, NULL, STATUS_SUCCESS,
+            STATUS_CONFLICTING_ADDRESSES, STATUS_INVALID_IMAGE_FORMAT);
+
+        if (NT_SUCCESS(Status)) Status = LdrpSetProtection(MappedDll->ViewBase, TRUE);
+    }
+
+    MappedDll->Relocated = NT_SUCCESS(Status);
+    return Status;
+}
+
+static
+NTSTATUS
+LdrpMapWorkItem(IN PLDRP_MAP_WORK Work)
+{
+    PLDRP_MAPPED_DLL Result = &Work->Result;
+    PTEB Teb = NtCurrentTeb();
+    PVOID ArbitraryUserPointer;
+    NTSTATUS Status;
+
+    /* Check the Known DLLs first, like LdrpMapDll */
+    if (LdrpKnownDllObjectDirectory)
+    {
+        Status = LdrpOpenKnownDllSection(Work);
+        if (!NT_SUCCESS(Status) && (Status != STATUS_OBJECT_NAME_NOT_FOUND)) goto Failure;
+    }
+
+    /* Otherwise go look for the file */
+    if (!Result->SectionHandle)
+    {
+        Status = LdrpCreateMapSection(Work);
+        if (!NT_SUCCESS(Status)) goto Failure;
+    }
+
+    /* Stuff the image name in the TIB, for the debugger */
+    ArbitraryUserPointer = Teb->NtTib.ArbitraryUserPointer;
+    Teb->NtTib.ArbitraryUserPointer = Result->FullDllName.Buffer;
+
+    /* Map the DLL */
+    Status = NtMapViewOfSection(Result->SectionHandle,
+                                NtCurrentProcess(),
+                                &Result->ViewBase,
+                                0,
+                                0,
+                                NULL,
+                                &Result->ViewSize,
+                                ViewShare,
+                                0,
+                                PAGE_READWRITE);
+
+    /* Restore */
+    Teb->NtTib.ArbitraryUserPointer = ArbitraryUserPointer;
+
+    if (!NT_SUCCESS(Status))
+    {
+        Result->ViewBase = NULL;
+        goto Failure;
+    }
+    Result->Status = Status;
+
+    if (!RtlImageNtHeader(Result->ViewBase))
+    {
+        Status = STATUS_INVALID_IMAGE_FORMAT;
+        goto Failure;
+    }
+
+    /* Relocate it while we're at it */
+    if (Result->Status == STATUS_IMAGE_NOT_AT_BASE)
+    {
+        Status = LdrpRelocateMappedDll(Result);
+        if (!NT_SUCCESS(Status)) goto Failure;
+    }
+
+    return STATUS_SUCCESS;
+
+Failure:
+    /* LdrpMapDll will retry and report the error */
+    LdrpReleaseMappedDll(Result);
+    return Status;
+}
+
+static
+ULONG
+NTAPI
+LdrpMapWorkerRoutine(IN PVOID Parameter)
+{
+    PLIST_ENTRY Entry;
+    PLDRP_MAP_WORK Work;
+    NTSTATUS Status;
+
+    for (;;)
+    {
+        /* Wait for something to map */
+        NtWaitForSingleObject(LdrpMapSemaphore, FALSE, NULL);
+
+        RtlEnterCriticalSection(&LdrpMapLock);
+        if (LdrpMapShutdown)
+        {
+            RtlLeaveCriticalSection(&LdrpMapLock);
+            break;
+        }
+
+        /* The main thread may have taken the item itself */
+        if (IsListEmpty(&LdrpMapQueue))
+        {
+            RtlLeaveCriticalSection(&LdrpMapLock);
+            continue;
+        }
+
+        Entry = RemoveHeadList(&LdrpMapQueue);
+        Work = CONTAINING_RECORD(Entry, LDRP_MAP_WORK, QueueLinks);
+        Work->State = LdrpMapMapping;
+        RtlLeaveCriticalSection(&LdrpMapLock);
+
+        /* Map it and queue its own imports before handing it over */
+        Status = LdrpMapWorkItem(Work);
+        if (NT_SUCCESS(Status)) LdrpQueueMapImports(Work->SearchPath, Work->Result.ViewBase);
+
+        RtlEnterCriticalSection(&LdrpMapLock);
+        if (NT_SUCCESS(Status))
+        {
+            Work->State = LdrpMapMapped;
+            LdrpMapStats.Mapped++;
+        }
+        else
+        {
+            Work->State = LdrpMapFailed;
+        }
+        RtlLeaveCriticalSection(&LdrpMapLock);
+
+        /* Wake up the main thread in case it waits for this one */
+        NtSetEvent(LdrpMapDoneEvent, NULL);
+    }
+
+    /* Loader workers never ran LdrpInitializeThread, so just go away */
+    NtCurrentTeb()->FreeStackOnTermination = TRUE;
+    NtTerminateThread(NtCurrentThread(), STATUS_SUCCESS);
+    return STATUS_SUCCESS;
+}
+
+BOOLEAN
+NTAPI
+LdrpIsMapWorkerThread(VOID)
+{
+    HANDLE ThreadId = NtCurrentTeb()->ClientId.UniqueThread;
+    ULONG i;
+
+    for (i = 0; i < LDRP_MAX_MAP_WORKERS; i++)
+    {
+        if (LdrpMapThreadIds[i] == ThreadId) return TRUE;
+    }
+
+    return FALSE;
+}
+
+BOOLEAN
+NTAPI
+LdrpTakeMappedDll(IN PWSTR SearchPath OPTIONAL,
+                  IN PWSTR DllName,
+                  OUT PLDRP_MAPPED_DLL MappedDll)
+{
+    UNICODE_STRING DllNameString;
+    PLDRP_MAP_WORK Work;
+    BOOLEAN Taken = FALSE;
+
+    if (!LdrpMapActive) return FALSE;
+    if (!SearchPath) SearchPath = LdrpDefaultPath.Buffer;
+    RtlInitUnicodeString(&DllNameString, DllName);
+
+    RtlEnterCriticalSection(&LdrpMapLock);
+    for (;;)
+    {
+        Work = LdrpFindMapWork(SearchPath, &DllNameString);
+        if (!Work)
+        {
+            /* Not discovered yet, make sure no worker maps it after us */
+            LdrpInsertMapWork(SearchPath, &DllNameString, LdrpMapTaken);
+            break;
+        }
+
+        if (Work->State == LdrpMapQueued)
+        {
+            /* No worker got to it yet, it's cheaper to do it inline */
+            RemoveEntryList(&Work->QueueLinks);
+            Work->State = LdrpMapTaken;
+            break;
+        }
+
+        if (Work->State != LdrpMapMapping) break;
+
+        /* A worker is mapping it right now, wait for it */
+        LdrpMapStats.Waits++;
+        RtlLeaveCriticalSection(&LdrpMapLock);
+        NtWaitForSingleObject(LdrpMapDoneEvent, FALSE, NULL);
+        RtlEnterCriticalSection(&LdrpMapLock);
+    }
+
+    if (Work && Work->State == LdrpMapMapped)
+    {
+        /* Transfer the view, section and names to the caller */
+        *MappedDll = Work->Result;
+        RtlZeroMemory(&Work->Result, sizeof(Work->Result));
+        LdrpMapStats.Taken++;
+        Taken = TRUE;
+    }
+
+    if (Work) Work->State = LdrpMapTaken;
+    RtlLeaveCriticalSection(&LdrpMapLock);
+
+    if (Taken && ShowSnaps)
+    {
+        DPRINT1("LDR: Loading (STATIC) %wZ, mapped by a loader worker\n",
+                &MappedDll->FullDllName);
+    }
+
+    return Taken;
+}
+
+VOID
+NTAPI
+LdrpStartMapWorkers(IN ULONG WorkerCount)
+{
+    PPEB Peb = NtCurrentPeb();
+    PLIST_ENTRY ListHead, NextEntry;
+    PLDR_DATA_TABLE_ENTRY LdrEntry;
+    CLIENT_ID ClientId;
+    NTSTATUS Status;
+    ULONG i;
+
+    if (!WorkerCount) return;
+    WorkerCount = min(WorkerCount, LDRP_MAX_MAP_WORKERS);
+
+    /* Set up the queue */
+    Status = RtlInitializeCriticalSection(&LdrpMapLock);
+    if (!NT_SUCCESS(Status)) return;
+    LdrpMapInitialized = TRUE;
+    InitializeListHead(&LdrpMapQueue);
+    RtlZeroMemory(LdrpMapHash, sizeof(LdrpMapHash));
+    RtlZeroMemory(&LdrpMapStats, sizeof(LdrpMapStats));
+    LdrpMapShutdown = FALSE;
+
+    Status = NtCreateSemaphore(&LdrpMapSemaphore,
+                               SEMAPHORE_ALL_ACCESS,
+                               NULL,
+                               0,
+                               MAXLONG);
+    if (!NT_SUCCESS(Status)) goto Cleanup;
+
+    Status = NtCreateEvent(&LdrpMapDoneEvent,
+                           EVENT_ALL_ACCESS,
+                           NULL,
+                           SynchronizationEvent,
+                           FALSE);
+    if (!NT_SUCCESS(Status)) goto Cleanup;
+
+    /* Nothing that is loaded already needs to be mapped */
+    ListHead = &Peb->Ldr->InLoadOrderModuleList;
+    for (NextEntry = ListHead->Flink; NextEntry != ListHead; NextEntry = NextEntry->Flink)
+    {
+        LdrEntry = CONTAINING_RECORD(NextEntry, LDR_DATA_TABLE_ENTRY, InLoadOrderLinks);
+        LdrpInsertMapWork(NULL, &LdrEntry->BaseDllName, LdrpMapTaken);
+    }
+
+    /*
+     * Create the workers suspended, so LdrpInit knows their IDs before they
+     * run and lets them through while the process is still initializing.
+     */
+    for (i = 0; i < WorkerCount; i++)
+    {
+        Status = RtlCreateUserThread(NtCurrentProcess(),
+                                     NULL,
+                                     TRUE,
+                                     0,
+                                     0,
+                                     0,
+                                     LdrpMapWorkerRoutine,
+                                     NULL,
+                                     &LdrpMapThreads[i],
+                                     &ClientId);
+        if (!NT_SUCCESS(Status)) break;
+
+        LdrpMapThreadIds[i] = ClientId.UniqueThread;
+    }
+
+    LdrpMapWorkerCount = i;
+    if (!LdrpMapWorkerCount) goto Cleanup;
+    LdrpMapStats.Workers = LdrpMapWorkerCount;
+
+    /* Let them go */
+    LdrpMapActive = TRUE;
+    for (i = 0; i < LdrpMapWorkerCount; i++) NtResumeThread(LdrpMapThreads[i], NULL);
+
+    if (ShowSnaps)
+    {
+        DPRINT1("LDR: Started %lu loader workers\n", LdrpMapWorkerCount);
+    }
+    return;
+
+Cleanup:
+    DPRINT1("LDR: Failed to start loader workers, Status=0x%08lx\n", Status);
+    LdrpStopMapWorkers(NULL);
+}
+
+VOID
+NTAPI
+LdrpStopMapWorkers(OUT PLDRP_MAP_STATS Stats OPTIONAL)
+{
+    PLDRP_MAP_WORK Work, NextWork;
+    ULONG i;
+
+    if (!LdrpMapInitialized)
+    {
+        /* The workers were never started */
+        if (Stats) RtlZeroMemory(Stats, sizeof(*Stats));
+        return;
+    }
+
+    if (LdrpMapWorkerCount)
+    {
+        /* Tell the workers to quit and wait for them */
+        RtlEnterCriticalSection(&LdrpMapLock);
+        LdrpMapShutdown = TRUE;
+        RtlLeaveCriticalSection(&LdrpMapLock);
+
+        NtReleaseSemaphore(LdrpMapSemaphore, LdrpMapWorkerCount, NULL);
+        NtWaitForMultipleObjects(LdrpMapWorkerCount,
+                                 LdrpMapThreads,
+                                 WaitAll,
+                                 FALSE,
+                                 NULL);
+
+        for (i = 0; i < LdrpMapWorkerCount; i++) NtClose(LdrpMapThreads[i]);
+    }
+
+    /* Thread IDs get reused, forget them */
+    LdrpMapActive = FALSE;
+    LdrpMapWorkerCount = 0;
+    RtlZeroMemory(LdrpMapThreads, sizeof(LdrpMapThreads));
+    RtlZeroMemory(LdrpMapThreadIds, sizeof(LdrpMapThreadIds));
+
+    /* Drop whatever was mapped but never asked for */
+    for (i = 0; i < LDRP_MAP_HASH_BUCKETS; i++)
+    {
+        for (Work = LdrpMapHash[i]; Work; Work = NextWork)
+        {
+            NextWork = Work->HashNext;
+
+            if (Work->State == LdrpMapMapped)
+            {
+                if (ShowSnaps)
+                {
+                    DPRINT1("LDR: Dropping unused mapping of %wZ\n", &Work->DllName);
+                }
+
+                LdrpReleaseMappedDll(&Work->Result);
+                LdrpMapStats.Discarded++;
+            }
+
+            RtlFreeHeap(LdrpHeap, 0, Work);
+        }
+
+        LdrpMapHash[i] = NULL;
+    }
+
+    if (LdrpMapSemaphore)
+    {
+        NtClose(LdrpMapSemaphore);
+        LdrpMapSemaphore = NULL;
+    }
+
+    if (LdrpMapDoneEvent)
+    {
+        NtClose(LdrpMapDoneEvent);
+        LdrpMapDoneEvent = NULL;
+    }
+
+    RtlDeleteCriticalSection(&LdrpMapLock);
+    LdrpMapInitialized = FALSE;
+
+    if (Stats) *Stats = LdrpMapStats;
+}
+
+/* EOF */
@@ -17,6 +17,35 @@
 
 PLDR_MANIFEST_PROBER_ROUTINE LdrpManifestProberRoutine;
 ULONG LdrpNormalSnap;
+LDRP_SNAP_STATS LdrpSnapStats;
+
+/*
+ * Per-process hash index over the export name table of a module. A module
+ * only gets one after a few imports by name missed their hint, which is
+ * where the binary search in LdrpNameToOrdinal would otherwise run.
+ * All users run under the loader lock (or before other threads exist).
+ */
+#define LDRP_EXPORT_INDEX_BUCKETS   32
+#define LDRP_EXPORT_INDEX_THRESHOLD 16
+#define LDRP_EXPORT_INDEX_MAX_NAMES 0x10000
+#define LDRP_EXPORT_INDEX_BUCKET(Base) \
+    (((ULONG_PTR)(Base) >> 16) & (LDRP_EXPORT_INDEX_BUCKETS - 1))
+
+typedef struct _LDRP_EXPORT_INDEX
+{
+    struct _LDRP_EXPORT_INDEX *Next;
+    PVOID ExportBase;
+    PIMAGE_EXPORT_DIRECTORY ExportDirectory;
+    ULONG TimeDateStamp;
+    ULONG NumberOfNames;
+    ULONG Misses;
+    ULONG Mask;
+    PULONG Slots;
+} LDRP_EXPORT_INDEX, *PLDRP_EXPORT_INDEX;
+
+PLDRP_EXPORT_INDEX LdrpExportIndexTable[LDRP_EXPORT_INDEX_BUCKETS];
+PLDRP_EXPORT_INDEX LdrpLastExportIndex;
+ULONG LdrpSnapDepth;
 
 /* FUNCTIONS *****************************************************************/
 
@@ -37,6 +66,7 @@ LdrpSnapIAT(IN PLDR_DATA_TABLE_ENTRY ExportLdrEntry,
     LPSTR ImportName;
     ULONG ForwarderChain, i, Rva, OldProtect, IatSize, ExportSize;
     SIZE_T ImportSize;
+    LARGE_INTEGER SnapStart, SnapEnd;
     DPRINT("LdrpSnapIAT(%wZ %wZ %p %u)\n", &ExportLdrEntry->BaseDllName, &ImportLdrEntry->BaseDllName, IatEntry, EntriesValid);
 
     /* Get export directory */
@@ -131,6 +161,9 @@ LdrpSnapIAT(IN PLDR_DATA_TABLE_ENTRY ExportLdrEntry,
         return Status;
     }
 
+    /* Account the time spent snapping, forwarders may load and snap other DLLs */
+    if (!LdrpSnapDepth++) NtQueryPerformanceCounter(&SnapStart, NULL);
+
     /* Check if the Thunks are already valid */
     if (EntriesValid)
     {
@@ -240,6 +273,12 @@ LdrpSnapIAT(IN PLDR_DATA_TABLE_ENTRY ExportLdrEntry,
         }
     }
 
+    if (!--LdrpSnapDepth)
+    {
+        NtQueryPerformanceCounter(&SnapEnd, NULL);
+        LdrpSnapStats.SnapTicks += SnapEnd.QuadPart - SnapStart.QuadPart;
+    }
+
     /* Protect the IAT again */
     NtProtectVirtualMemory(NtCurrentProcess(),
                            &Iat,
@@ -665,6 +704,161 @@ LdrpNameToOrdinal(IN LPSTR ImportName,
     return OrdinalTable[Next];
 }
 
+static
+ULONG
+LdrpHashExportName(IN LPSTR Name)
+{
+    ULONG Hash = 2166136261U;
+
+    /* FNV-1a, export names are case sensitive */
+    while (*Name) Hash = (Hash ^ (UCHAR)*Name++) * 16777619U;
+    return Hash;
+}
+
+static
+PLDRP_EXPORT_INDEX
+LdrpGetExportIndex(IN PVOID ExportBase,
+                   IN PIMAGE_EXPORT_DIRECTORY ExportDirectory)
+{
+    PLDRP_EXPORT_INDEX Index = LdrpLastExportIndex;
+    ULONG Bucket;
+
+    /* Snaps come in runs against the same module, check the last one first */
+    if (!Index || Index->ExportBase != ExportBase)
+    {
+        Bucket = LDRP_EXPORT_INDEX_BUCKET(ExportBase);
+        for (Index = LdrpExportIndexTable[Bucket]; Index; Index = Index->Next)
+        {
+            if (Index->ExportBase == ExportBase) break;
+        }
+
+        if (!Index)
+        {
+            /* First miss in this module, start tracking it */
+            Index = RtlAllocateHeap(LdrpHeap, HEAP_ZERO_MEMORY, sizeof(*Index));
+            if (!Index) return NULL;
+
+            Index->ExportBase = ExportBase;
+            Index->Next = LdrpExportIndexTable[Bucket];
+            LdrpExportIndexTable[Bucket] = Index;
+        }
+    }
+
+    /* Make sure this isn't left over from an image that was at this address before */
+    if ((Index->ExportDirectory != ExportDirectory) ||
+        (Index->TimeDateStamp != ExportDirectory->TimeDateStamp) ||
+        (Index->NumberOfNames != ExportDirectory->NumberOfNames))
+    {
+        if (Index->Slots) RtlFreeHeap(LdrpHeap, 0, Index->Slots);
+        Index->Slots = NULL;
+        Index->Mask = 0;
+        Index->Misses = 0;
+        Index->ExportDirectory = ExportDirectory;
+        Index->TimeDateStamp = ExportDirectory->TimeDateStamp;
+        Index->NumberOfNames = ExportDirectory->NumberOfNames;
+    }
+
+    LdrpLastExportIndex = Index;
+    return Index;
+}
+
+static
+VOID
+LdrpBuildExportIndex(IN PLDRP_EXPORT_INDEX Index,
+                     IN PULONG NameTable)
+{
+    ULONG Size = 16, i, Slot;
+    PULONG Slots;
+
+    /* Keep the table at most half full */
+    if (Index->NumberOfNames > LDRP_EXPORT_INDEX_MAX_NAMES) return;
+    while (Size < Index->NumberOfNames * 2) Size <<= 1;
+
+    Slots = RtlAllocateHeap(LdrpHeap, HEAP_ZERO_MEMORY, Size * sizeof(ULONG));
+    if (!Slots) return;
+
+    /* Slots hold the name table index plus one, zero is empty */
+    for (i = 0; i < Index->NumberOfNames; i++)
+    {
+        Slot = LdrpHashExportName((LPSTR)((ULONG_PTR)Index->ExportBase + NameTable[i])) & (Size - 1);
+        while (Slots[Slot]) Slot = (Slot + 1) & (Size - 1);
+        Slots[Slot] = i + 1;
+    }
+
+    Index->Mask = Size - 1;
+    Index->Slots = Slots;
+    LdrpSnapStats.Indexes++;
+}
+
+USHORT
+NTAPI
+LdrpNameToOrdinalIndexed(IN LPSTR ImportName,
+                         IN PVOID ExportBase,
+                         IN PIMAGE_EXPORT_DIRECTORY ExportDirectory,
+                         IN PULONG NameTable,
+                         IN PUSHORT OrdinalTable)
+{
+    PLDRP_EXPORT_INDEX Index;
+    ULONG Slot, Entry;
+
+    /* Build the index once the module has missed often enough */
+    Index = LdrpGetExportIndex(ExportBase, ExportDirectory);
+    if (Index && !Index->Slots && (++Index->Misses >= LDRP_EXPORT_INDEX_THRESHOLD))
+    {
+        LdrpBuildExportIndex(Index, NameTable);
+    }
+
+    if (!Index || !Index->Slots)
+    {
+        /* Not worth it yet, do the binary search */
+        LdrpSnapStats.BySearch++;
+        return LdrpNameToOrdinal(ImportName,
+                                 ExportDirectory->NumberOfNames,
+                                 ExportBase,
+                                 NameTable,
+                                 OrdinalTable);
+    }
+
+    /* Probe the index */
+    LdrpSnapStats.ByIndex++;
+    Slot = LdrpHashExportName(ImportName) & Index->Mask;
+    while ((Entry = Index->Slots[Slot]))
+    {
+        if (!strcmp(ImportName, (LPSTR)((ULONG_PTR)ExportBase + NameTable[Entry - 1])))
+        {
+            return OrdinalTable[Entry - 1];
+        }
+
+        Slot = (Slot + 1) & Index->Mask;
+    }
+
+    /* Every name is in the index, so it isn't exported */
+    return -1;
+}
+
+VOID
+NTAPI
+LdrpDropExportIndex(IN PVOID ExportBase)
+{
+    PLDRP_EXPORT_INDEX *Link, Index;
+
+    /* Called when a module is unmapped */
+    Link = &LdrpExportIndexTable[LDRP_EXPORT_INDEX_BUCKET(ExportBase)];
+    while ((Index = *Link))
+    {
+        if (Index->ExportBase == ExportBase)
+        {
+            *Link = Index->Next;
+            if (LdrpLastExportIndex == Index) LdrpLastExportIndex = NULL;
+            if (Index->Slots) RtlFreeHeap(LdrpHeap, 0, Index->Slots);
+            RtlFreeHeap(LdrpHeap, 0, Index);
+            return;
+        }
+
+        Link = &Index->Next;
+    }
+}
+
 NTSTATUS
 NTAPI
 LdrpWalkImportDescriptor(IN LPWSTR DllPath OPTIONAL,
@@ -747,6 +941,9 @@ LdrpWalkImportDescriptor(IN LPWSTR DllPath OPTIONAL,
                                                IMAGE_DIRECTORY_ENTRY_IMPORT,
                                                &IatSize);
 
+    /* Let the loader workers start mapping what we are about to load */
+    if (ImportEntry) LdrpQueueMapImports(DllPath, LdrEntry->DllBase);
+
     /* Check if we got at least one */
     if ((BoundEntry) || (ImportEntry))
     {
@@ -977,10 +1174,13 @@ LdrpSnapThunk(IN PVOID ExportBase,
     PVOID ForwarderHandle;
     ULONG ForwardOrdinal;
 
+    LdrpSnapStats.Snaps++;
+
     /* Check if the snap is by ordinal */
     if ((IsOrdinal = IMAGE_SNAP_BY_ORDINAL(OriginalThunk->u1.Ordinal)))
     {
         /* Get the ordinal number, and its normalized version */
+        LdrpSnapStats.ByOrdinal++;
         OriginalOrdinal = IMAGE_ORDINAL(OriginalThunk->u1.Ordinal);
         Ordinal = (USHORT)(OriginalOrdinal - ExportDirectory->Base);
     }
@@ -1008,16 +1208,17 @@ LdrpSnapThunk(IN PVOID ExportBase,
              (!strcmp(ImportName, ((LPSTR)((ULONG_PTR)ExportBase + NameTable[Hint])))))
         {
             /* We got a match, get the Ordinal from the hint */
+            LdrpSnapStats.ByHint++;
             Ordinal = OrdinalTable[Hint];
         }
         else
         {
             /* Well bummer, hint didn't work, do it the long way */
-            Ordinal = LdrpNameToOrdinal(ImportName,
-                                        ExportDirectory->NumberOfNames,
-                                        ExportBase,
-                                        NameTable,
-                                        OrdinalTable);
+            Ordinal = LdrpNameToOrdinalIndexed(ImportName,
+                                               ExportBase,
+                                               ExportDirectory,
+                                               NameTable,
+                                               OrdinalTable);
         }
     }
 
@@ -1051,6 +1051,8 @@ LdrpMapDll(IN PWSTR SearchPath OPTIONAL,
     UNICODE_STRING IllegalDll;
     PVOID RelocData;
     ULONG RelocDataSize = 0;
+    LDRP_MAPPED_DLL MappedDll;
+    BOOLEAN Relocated = FALSE;
 
     // FIXME: AppCompat stuff is missing
 
@@ -1061,6 +1063,21 @@ LdrpMapDll(IN PWSTR SearchPath OPTIONAL,
                 SearchPath ? SearchPath : L"");
     }
 
+    /* Check if a loader worker has mapped this DLL already */
+    if (!Redirect && !DllCharacteristics &&
+        LdrpTakeMappedDll(SearchPath, DllName, &MappedDll))
+    {
+        FullDllName = MappedDll.FullDllName;
+        BaseDllName = MappedDll.BaseDllName;
+        SectionHandle = MappedDll.SectionHandle;
+        ViewBase = MappedDll.ViewBase;
+        ViewSize = MappedDll.ViewSize;
+        KnownDll = MappedDll.KnownDll;
+        Relocated = MappedDll.Relocated;
+        Status = MappedDll.Status;
+        goto Mapped;
+    }
+
     /* Check if we have a known dll directory */
     if (LdrpKnownDllObjectDirectory && Redirect == FALSE)
     {
@@ -1210,6 +1227,7 @@ SkipCheck:
         return Status;
     }
 
+Mapped:
     /* Get the NT Header */
     if (!(NtHeaders = RtlImageNtHeader(ViewBase)))
     {
@@ -1435,6 +1453,13 @@ SkipCheck:
                 goto FailRelocate;
             }
 
+            /* The loader worker that mapped it has applied the fixups already */
+            if (Relocated)
+            {
+                Status = STATUS_SUCCESS;
+                goto FailRelocate;
+            }
+
             /* Change the protection to prepare for relocation */
             Status = LdrpSetProtection(ViewBase, FALSE);
 
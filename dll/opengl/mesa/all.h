@@ -122,6 +122,7 @@
 #include "texobj.h"
 #include "texstate.h"
 #include "texture.h"
+#include "tiler.h"
 #include "triangle.h"
 #include "types.h"
 #include "varray.h"
@@ -71,6 +71,10 @@
 #include "types.h"
 #endif
 
+#ifdef USE_SSE2
+#include <emmintrin.h>
+#endif
+
 
 
 void gl_BlendFunc( GLcontext* ctx, GLenum sfactor, GLenum dfactor )
@@ -117,6 +121,107 @@ void gl_BlendFunc( GLcontext* ctx, GLenum sfactor, GLenum dfactor )
 
 
 
+#ifdef USE_SSE2
+/*
+ * The two most common blend modes for 8-bit color channels, eight pixels
+ * at a time and with the same results as do_blend().
+ * Returns how many pixels were done, the caller finishes the rest.
+ */
+
+/* dst = mask ? val : dst, for 8 bytes */
+#define SSE2_STORE8( DST, VAL, OFF )					\
+   _mm_storel_epi64( (__m128i *) (DST),					\
+                     _mm_or_si128( _mm_and_si128( OFF,			\
+                          _mm_loadl_epi64( (const __m128i *) (DST) ) ),	\
+                        _mm_andnot_si128( OFF, VAL ) ) )
+
+static GLuint sse2_blend_transparency( GLfloat ascale, GLuint n,
+                                       const GLubyte mask[],
+                                       GLubyte red[], GLubyte green[],
+                                       GLubyte blue[], GLubyte alpha[],
+                                       const GLubyte rdest[],
+                                       const GLubyte gdest[],
+                                       const GLubyte bdest[],
+                                       const GLubyte adest[] )
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i v256 = _mm_set1_epi16( 256 );
+   const __m128 scale = _mm_set1_ps( ascale );
+   GLuint i;
+
+   for (i=0; i+8<=n; i+=8) {
+      __m128i off, a, t, s, c, d;
+
+      /* all ones where mask[i] is 0 */
+      off = _mm_cmpeq_epi8( _mm_loadl_epi64( (const __m128i *) (mask+i) ),
+                            zero );
+
+      /* t = (GLint) (alpha[i] * ascale), s = 256 - t */
+      a = _mm_unpacklo_epi8( _mm_loadl_epi64( (const __m128i *) (alpha+i) ),
+                             zero );
+      t = _mm_packs_epi32(
+             _mm_cvttps_epi32( _mm_mul_ps( _mm_cvtepi32_ps(
+                _mm_unpacklo_epi16( a, zero ) ), scale ) ),
+             _mm_cvttps_epi32( _mm_mul_ps( _mm_cvtepi32_ps(
+                _mm_unpackhi_epi16( a, zero ) ), scale ) ) );
+      s = _mm_sub_epi16( v256, t );
+
+#define BLEND8( SRC, SRCW, DEST )					\
+      c = _mm_add_epi16( _mm_mullo_epi16( SRCW, t ),			\
+             _mm_mullo_epi16( _mm_unpacklo_epi8(				\
+                _mm_loadl_epi64( (const __m128i *) (DEST+i) ), zero ), s ) ); \
+      c = _mm_srli_epi16( c, 8 );					\
+      SSE2_STORE8( SRC+i, _mm_packus_epi16( c, c ), off );
+
+      d = _mm_unpacklo_epi8( _mm_loadl_epi64( (const __m128i *) (red+i) ),
+                             zero );
+      BLEND8( red, d, rdest )
+      d = _mm_unpacklo_epi8( _mm_loadl_epi64( (const __m128i *) (green+i) ),
+                             zero );
+      BLEND8( green, d, gdest )
+      d = _mm_unpacklo_epi8( _mm_loadl_epi64( (const __m128i *) (blue+i) ),
+                             zero );
+      BLEND8( blue, d, bdest )
+      BLEND8( alpha, a, adest )
+#undef BLEND8
+   }
+   return i;
+}
+
+static GLuint sse2_blend_add( GLuint n, const GLubyte mask[],
+                              GLubyte red[], GLubyte green[],
+                              GLubyte blue[], GLubyte alpha[],
+                              const GLubyte rdest[], const GLubyte gdest[],
+                              const GLubyte bdest[], const GLubyte adest[] )
+{
+   const __m128i zero = _mm_setzero_si128();
+   GLuint i;
+
+   for (i=0; i+8<=n; i+=8) {
+      __m128i off, c;
+
+      off = _mm_cmpeq_epi8( _mm_loadl_epi64( (const __m128i *) (mask+i) ),
+                            zero );
+
+#define ADD8( SRC, DEST )						\
+      c = _mm_adds_epu8( _mm_loadl_epi64( (const __m128i *) (SRC+i) ),	\
+                         _mm_loadl_epi64( (const __m128i *) (DEST+i) ) ); \
+      SSE2_STORE8( SRC+i, c, off );
+
+      ADD8( red, rdest )
+      ADD8( green, gdest )
+      ADD8( blue, bdest )
+      ADD8( alpha, adest )
+#undef ADD8
+   }
+   return i;
+}
+
+#undef SSE2_STORE8
+#endif
+
+
+
 /*
  * Do the real work of gl_blend_span() and gl_blend_pixels().
  * Input:  n - number of pixels
@@ -140,7 +245,14 @@ static void do_blend( GLcontext* ctx, GLuint n, const GLubyte mask[],
       GLint gmax = (GLint) ctx->Visual->GreenScale;
       GLint bmax = (GLint) ctx->Visual->BlueScale;
       GLint amax = (GLint) ctx->Visual->AlphaScale;
-      for (i=0;i<n;i++) {
+      i = 0;
+#ifdef USE_SSE2
+      if (ctx->Visual->EightBitColor) {
+         i = sse2_blend_transparency( ascale, n, mask, red, green, blue, alpha,
+                                      rdest, gdest, bdest, adest );
+      }
+#endif
+      for (;i<n;i++) {
 	 if (mask[i]) {
 	    GLint r, g, b, a;
             GLint t = (GLint) ( alpha[i] * ascale );  /* t in [0,256] */
@@ -168,7 +280,14 @@ static void do_blend( GLcontext* ctx, GLuint n, const GLubyte mask[],
 	 GLint gmax = (GLint) ctx->Visual->GreenScale;
 	 GLint bmax = (GLint) ctx->Visual->BlueScale;
 	 GLint amax = (GLint) ctx->Visual->AlphaScale;
-	 for (i=0; i < n; i++) {
+	 i = 0;
+#ifdef USE_SSE2
+	 if (ctx->Visual->EightBitColor) {
+	    i = sse2_blend_add( n, mask, red, green, blue, alpha,
+	                        rdest, gdest, bdest, adest );
+	 }
+#endif
+	 for (; i < n; i++) {
 	    if (mask[i]) {
 	       red[i]	= MIN2(rmax, red[i]   + rdest[i]);
 	       green[i] = MIN2(gmax, green[i] + gdest[i]);
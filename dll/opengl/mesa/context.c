@@ -252,6 +252,7 @@
 #include "pointers.h"
 #include "quads.h"
 #include "stencil.h"
+#include "tiler.h"
 #include "triangle.h"
 #include "teximage.h"
 #include "texobj.h"
@@ -1193,6 +1194,7 @@ void gl_destroy_context( GLcontext *ctx )
       }
 #endif
 
+      gl_tiler_destroy( ctx );
       free( ctx->PB );
       free( ctx->VB );
 
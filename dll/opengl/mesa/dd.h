@@ -483,6 +483,19 @@ struct dd_function_table {
     * Return GL_FALSE if failure, let core Mesa render the vertex buffer.
     */
 
+   GLuint (*RasterThreads)( GLcontext *ctx );
+   void (*RasterRun)( GLcontext *ctx, void (*func)( void *data, GLuint i ),
+                      void *data, GLuint count );
+   /*
+    * These two functions, if not NULL, let core Mesa rasterize triangles
+    * on several threads (see tiler.c).  RasterThreads returns how many
+    * threads may write to the current color buffer at once, each one
+    * only touching its own rows, or 1 if that isn't possible.  RasterRun
+    * calls func(data, i) for every 0 <= i < count, one call per thread,
+    * and returns once all of them have returned.  Mesa doesn't call
+    * Color(), Index() or the WriteMono*Span() functions from those threads.
+    */
+
    /***
     *** Texture mapping functions:
     ***/
@@ -76,6 +76,10 @@
 #include "types.h"
 #endif
 
+#ifdef USE_SSE2
+#include <emmintrin.h>
+#endif
+
 
 
 /**********************************************************************/
@@ -413,6 +417,55 @@ GLuint gl_depth_test_span_generic( GLcontext* ctx,
 
 
 
+#ifdef USE_SSE2
+/*
+ * Depth test four fragments at a time, the same way the loops below do.
+ * Returns how many fragments were done, the caller finishes the rest.
+ */
+static GLuint sse2_depth_test_span( GLuint n, const GLdepth z[],
+                                    GLdepth zptr[], GLubyte mask[],
+                                    GLboolean greater, GLuint *passed )
+{
+   static const GLubyte bitcount[16] = {
+      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+   };
+   const __m128i zero = _mm_setzero_si128();
+   GLuint i, m;
+
+   for (i=0; i+4<=n; i+=4) {
+      __m128i off, zsrc, zdst, pass;
+
+      MEMCPY( &m, mask+i, 4 );
+      if (m==0) {
+         continue;
+      }
+      /* all ones where mask[i] is 0 */
+      off = _mm_unpacklo_epi8( _mm_cvtsi32_si128( (int) m ), zero );
+      off = _mm_cmpeq_epi32( _mm_unpacklo_epi16( off, zero ), zero );
+
+      zsrc = _mm_loadu_si128( (const __m128i *) (z+i) );
+      zdst = _mm_loadu_si128( (const __m128i *) (zptr+i) );
+      if (greater)
+         pass = _mm_cmpgt_epi32( zsrc, zdst );
+      else
+         pass = _mm_cmplt_epi32( zsrc, zdst );
+      pass = _mm_andnot_si128( off, pass );
+
+      zdst = _mm_or_si128( _mm_and_si128( pass, zsrc ),
+                           _mm_andnot_si128( pass, zdst ) );
+      _mm_storeu_si128( (__m128i *) (zptr+i), zdst );
+      *passed += bitcount[_mm_movemask_ps( _mm_castsi128_ps( pass ) )];
+
+      /* clear the mask of the fragments which failed */
+      pass = _mm_packs_epi32( pass, pass );
+      m &= (GLuint) _mm_cvtsi128_si32( _mm_packs_epi16( pass, pass ) );
+      MEMCPY( mask+i, &m, 4 );
+   }
+   return i;
+}
+#endif
+
+
 /*
  * glDepthFunc(GL_LESS) and glDepthMask(GL_TRUE).
  */
@@ -421,10 +474,13 @@ GLuint gl_depth_test_span_less( GLcontext* ctx,
                                 GLubyte mask[] )
 {
    GLdepth *zptr = Z_ADDRESS( ctx, x, y );
-   GLuint i;
+   GLuint i = 0;
    GLuint passed = 0;
 
-   for (i=0; i<n; i++) {
+#ifdef USE_SSE2
+   i = sse2_depth_test_span( n, z, zptr, mask, GL_FALSE, &passed );
+#endif
+   for (; i<n; i++) {
       if (mask[i]) {
          if (z[i] < zptr[i]) {
             /* pass */
@@ -450,10 +506,13 @@ GLuint gl_depth_test_span_greater( GLcontext* ctx,
                                    GLubyte mask[] )
 {
    GLdepth *zptr = Z_ADDRESS( ctx, x, y );
-   GLuint i;
+   GLuint i = 0;
    GLuint passed = 0;
 
-   for (i=0; i<n; i++) {
+#ifdef USE_SSE2
+   i = sse2_depth_test_span( n, z, zptr, mask, GL_TRUE, &passed );
+#endif
+   for (; i<n; i++) {
       if (mask[i]) {
          if (z[i] > zptr[i]) {
             /* pass */
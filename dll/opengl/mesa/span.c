@@ -308,7 +308,8 @@ void gl_write_monoindex_span( GLcontext *ctx,
    }
 
     if ((ctx->Fog.Enabled && (ctx->Hint.Fog==GL_NICEST || primitive==GL_BITMAP))
-            || ctx->Color.SWLogicOpEnabled || ctx->Color.SWmasking)
+            || ctx->Color.SWLogicOpEnabled || ctx->Color.SWmasking
+            || !ctx->Driver.WriteMonoindexSpan)
     {
         GLuint ispan[MAX_WIDTH];
         /* index may change, replicate single index into an array */
@@ -600,7 +601,7 @@ void gl_write_monocolor_span( GLcontext *ctx,
    }
 
    if (ctx->Color.BlendEnabled || ctx->Color.SWLogicOpEnabled
-       || ctx->Color.SWmasking) {
+       || ctx->Color.SWmasking || !ctx->Driver.WriteMonocolorSpan) {
       /* assign same color to each pixel */
       for (i=0;i<n;i++) {
 	 if (mask[i]) {
@@ -63,6 +63,10 @@
 #include "types.h"
 #endif
 
+#ifdef USE_SSE2
+#include <emmintrin.h>
+#endif
+
 
 /*
  * Return the address of a stencil buffer value given the window coords:
@@ -327,6 +331,69 @@ static void apply_stencil_op_to_span( GLcontext *ctx,
 
 
 
+#ifdef USE_SSE2
+/*
+ * The comparison functions of gl_stencil_span(), sixteen pixels at a
+ * time.  Returns how many pixels were done, the caller does the rest.
+ */
+static GLuint sse2_stencil_test_span( const GLcontext *ctx, GLuint n,
+                                      const GLstencil stencil[],
+                                      GLubyte mask[], GLubyte fail[] )
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i ones = _mm_cmpeq_epi8( zero, zero );
+   const __m128i one = _mm_set1_epi8( 1 );
+   const __m128i vmask = _mm_set1_epi8( (char) ctx->Stencil.ValueMask );
+   const __m128i r = _mm_set1_epi8( (char) (ctx->Stencil.Ref
+                                            & ctx->Stencil.ValueMask) );
+   GLenum func = ctx->Stencil.Function;
+   GLuint i;
+
+   if (func==GL_NEVER || func==GL_ALWAYS) {
+      return 0;
+   }
+
+   for (i=0; i+16<=n; i+=16) {
+      __m128i m, s, rmin, pass, f;
+
+      m = _mm_loadu_si128( (const __m128i *) (mask+i) );
+      s = _mm_and_si128( _mm_loadu_si128( (const __m128i *) (stencil+i) ),
+                         vmask );
+      rmin = _mm_min_epu8( r, s );
+      switch (func) {
+         case GL_LESS:
+            pass = _mm_andnot_si128( _mm_cmpeq_epi8( r, s ),
+                                     _mm_cmpeq_epi8( rmin, r ) );
+            break;
+         case GL_LEQUAL:
+            pass = _mm_cmpeq_epi8( rmin, r );
+            break;
+         case GL_GREATER:
+            pass = _mm_xor_si128( _mm_cmpeq_epi8( rmin, r ), ones );
+            break;
+         case GL_GEQUAL:
+            pass = _mm_cmpeq_epi8( rmin, s );
+            break;
+         case GL_EQUAL:
+            pass = _mm_cmpeq_epi8( r, s );
+            break;
+         default: /* GL_NOTEQUAL */
+            pass = _mm_xor_si128( _mm_cmpeq_epi8( r, s ), ones );
+            break;
+      }
+
+      /* fail where the mask is set and the test didn't pass */
+      f = _mm_andnot_si128( _mm_or_si128( pass, _mm_cmpeq_epi8( m, zero ) ),
+                            ones );
+      _mm_storeu_si128( (__m128i *) (fail+i), _mm_and_si128( f, one ) );
+      _mm_storeu_si128( (__m128i *) (mask+i), _mm_andnot_si128( f, m ) );
+   }
+   return i;
+}
+#endif
+
+
+
 /*
  * Apply stencil test to a span of pixels before depth buffering.
  * Input:  n - number of pixels in the span
@@ -347,6 +414,11 @@ GLint gl_stencil_span( GLcontext *ctx,
 
    stencil = STENCIL_ADDRESS( x, y );
 
+   i = 0;
+#ifdef USE_SSE2
+   i = sse2_stencil_test_span( ctx, n, stencil, mask, fail );
+#endif
+
    /*
     * Perform stencil test.  The results of this operation are stored
     * in the fail[] array:
@@ -372,7 +444,7 @@ GLint gl_stencil_span( GLcontext *ctx,
 	 break;
       case GL_LESS:
 	 r = ctx->Stencil.Ref & ctx->Stencil.ValueMask;
-	 for (i=0;i<n;i++) {
+	 for (;i<n;i++) {
 	    if (mask[i]) {
 	       s = stencil[i] & ctx->Stencil.ValueMask;
 	       if (r < s) {
@@ -391,7 +463,7 @@ GLint gl_stencil_span( GLcontext *ctx,
 	 break;
       case GL_LEQUAL:
 	 r = ctx->Stencil.Ref & ctx->Stencil.ValueMask;
-	 for (i=0;i<n;i++) {
+	 for (;i<n;i++) {
 	    if (mask[i]) {
 	       s = stencil[i] & ctx->Stencil.ValueMask;
 	       if (r <= s) {
@@ -410,7 +482,7 @@ GLint gl_stencil_span( GLcontext *ctx,
 	 break;
       case GL_GREATER:
 	 r = ctx->Stencil.Ref & ctx->Stencil.ValueMask;
-	 for (i=0;i<n;i++) {
+	 for (;i<n;i++) {
 	    if (mask[i]) {
 	       s = stencil[i] & ctx->Stencil.ValueMask;
 	       if (r > s) {
@@ -429,7 +501,7 @@ GLint gl_stencil_span( GLcontext *ctx,
 	 break;
       case GL_GEQUAL:
 	 r = ctx->Stencil.Ref & ctx->Stencil.ValueMask;
-	 for (i=0;i<n;i++) {
+	 for (;i<n;i++) {
 	    if (mask[i]) {
 	       s = stencil[i] & ctx->Stencil.ValueMask;
 	       if (r >= s) {
@@ -448,7 +520,7 @@ GLint gl_stencil_span( GLcontext *ctx,
 	 break;
       case GL_EQUAL:
 	 r = ctx->Stencil.Ref & ctx->Stencil.ValueMask;
-	 for (i=0;i<n;i++) {
+	 for (;i<n;i++) {
 	    if (mask[i]) {
 	       s = stencil[i] & ctx->Stencil.ValueMask;
 	       if (r == s) {
@@ -467,7 +539,7 @@ GLint gl_stencil_span( GLcontext *ctx,
 	 break;
       case GL_NOTEQUAL:
 	 r = ctx->Stencil.Ref & ctx->Stencil.ValueMask;
-	 for (i=0;i<n;i++) {
+	 for (;i<n;i++) {
 	    if (mask[i]) {
 	       s = stencil[i] & ctx->Stencil.ValueMask;
 	       if (r != s) {
@@ -149,6 +149,10 @@
 #include "types.h"
 #endif
 
+#ifdef USE_SSE2
+#include <emmintrin.h>
+#endif
+
 
 
 /*
@@ -1159,14 +1163,178 @@ static void sample_nearest_2d( const struct gl_texture_object *tObj, GLuint n,
 
 
 
+#ifdef USE_SSE2
+/*
+ * Broadcast each of the four 16-bit weights in the low half of W over
+ * the four channels of its texel: LO gets texels 0 and 1, HI 2 and 3.
+ */
+#define SSE2_SPLAT_WEIGHTS( W, LO, HI )				\
+   W = _mm_unpacklo_epi16( W, W );					\
+   LO = _mm_unpacklo_epi32( W, W );					\
+   HI = _mm_unpackhi_epi32( W, W );
+
+/*
+ * GL_LINEAR sampling of four texels at a time for RGB and RGBA images
+ * which repeat and have no border, with the same results as
+ * sample_2d_linear().  Returns how many were done.
+ */
+static GLuint sse2_sample_linear_2d( const struct gl_texture_object *tObj,
+                                     GLuint n,
+                                     const GLfloat s[], const GLfloat t[],
+                                     GLubyte red[], GLubyte green[],
+                                     GLubyte blue[], GLubyte alpha[] )
+{
+   const struct gl_texture_image *img = tObj->Image[0];
+   const __m128 half = _mm_set1_ps( 0.5F );
+   const __m128 one = _mm_set1_ps( 1.0F );
+   const __m128 limit = _mm_set1_ps( 8388608.0F );	/* 2^23 */
+   const __m128 absmask = _mm_castsi128_ps( _mm_set1_epi32( 0x7fffffff ) );
+   const __m128i zero = _mm_setzero_si128();
+   const __m128 width = _mm_set1_ps( (GLfloat) img->Width2 );
+   const __m128 height = _mm_set1_ps( (GLfloat) img->Height2 );
+   const __m128i colMask = _mm_set1_epi32( img->Width2 - 1 );
+   const __m128i rowMask = _mm_set1_epi32( img->Height2 - 1 );
+   const GLint rgba = (img->Format==GL_RGBA);
+   GLuint k;
+
+   for (k=0; k+4<=n; k+=4) {
+      __m128 u, v, fu, fv, a, b;
+      __m128i iu, iv, i0, i1, j0, j1, w, lo, hi, sumlo, sumhi;
+      GLint I0[4], I1[4], J0[4], J1[4];
+      GLuint T[4][4];
+      GLubyte out[16];
+      GLuint p, q;
+
+      u = _mm_sub_ps( _mm_mul_ps( _mm_loadu_ps( s+k ), width ), half );
+      v = _mm_sub_ps( _mm_mul_ps( _mm_loadu_ps( t+k ), height ), half );
+      if (_mm_movemask_ps( _mm_or_ps(
+             _mm_cmpnlt_ps( _mm_and_ps( u, absmask ), limit ),
+             _mm_cmpnlt_ps( _mm_and_ps( v, absmask ), limit ) ) )) {
+         /* too big for the float floor() below */
+         break;
+      }
+
+      /* floor(u), floor(v) */
+      iu = _mm_cvttps_epi32( u );
+      fu = _mm_cvtepi32_ps( iu );
+      iu = _mm_add_epi32( iu, _mm_castps_si128( _mm_cmpgt_ps( fu, u ) ) );
+      fu = _mm_cvtepi32_ps( iu );
+      iv = _mm_cvttps_epi32( v );
+      fv = _mm_cvtepi32_ps( iv );
+      iv = _mm_add_epi32( iv, _mm_castps_si128( _mm_cmpgt_ps( fv, v ) ) );
+      fv = _mm_cvtepi32_ps( iv );
+
+      i0 = _mm_and_si128( iu, colMask );
+      i1 = _mm_and_si128( _mm_add_epi32( iu, _mm_set1_epi32( 1 ) ), colMask );
+      j0 = _mm_and_si128( iv, rowMask );
+      j1 = _mm_and_si128( _mm_add_epi32( iv, _mm_set1_epi32( 1 ) ), rowMask );
+      _mm_storeu_si128( (__m128i *) I0, i0 );
+      _mm_storeu_si128( (__m128i *) I1, i1 );
+      _mm_storeu_si128( (__m128i *) J0, j0 );
+      _mm_storeu_si128( (__m128i *) J1, j1 );
+
+      /* fetch the 2x2 texels around each sample as 32-bit RGBA */
+      for (p=0;p<4;p++) {
+         GLint pos[4];
+         pos[0] = (J0[p] << img->WidthLog2) | I0[p];
+         pos[1] = (J0[p] << img->WidthLog2) | I1[p];
+         pos[2] = (J1[p] << img->WidthLog2) | I0[p];
+         pos[3] = (J1[p] << img->WidthLog2) | I1[p];
+         for (q=0;q<4;q++) {
+            if (rgba) {
+               MEMCPY( &T[q][p], img->Data + (pos[q] << 2), 4 );
+            }
+            else {
+               const GLubyte *texel = img->Data + pos[q] * 3;
+               GLubyte c[4];
+               c[0] = texel[0];
+               c[1] = texel[1];
+               c[2] = texel[2];
+               c[3] = 0;
+               MEMCPY( &T[q][p], c, 4 );
+            }
+         }
+      }
+
+      /* the weights, computed exactly like sample_2d_linear() does */
+      a = _mm_sub_ps( u, fu );
+      b = _mm_sub_ps( v, fv );
+      sumlo = sumhi = zero;
+#define ACCUMULATE( Q, WEIGHT )						\
+      w = _mm_cvttps_epi32( _mm_mul_ps( WEIGHT, _mm_set1_ps( 256.0F ) ) ); \
+      w = _mm_packs_epi32( w, w );					\
+      SSE2_SPLAT_WEIGHTS( w, lo, hi )					\
+      {									\
+         __m128i tex = _mm_loadu_si128( (const __m128i *) T[Q] );	\
+         sumlo = _mm_add_epi16( sumlo, _mm_mullo_epi16( lo,		\
+                    _mm_unpacklo_epi8( tex, zero ) ) );			\
+         sumhi = _mm_add_epi16( sumhi, _mm_mullo_epi16( hi,		\
+                    _mm_unpackhi_epi8( tex, zero ) ) );			\
+      }
+      ACCUMULATE( 0, _mm_mul_ps( _mm_sub_ps( one, a ), _mm_sub_ps( one, b ) ) )
+      ACCUMULATE( 1, _mm_mul_ps( a, _mm_sub_ps( one, b ) ) )
+      ACCUMULATE( 2, _mm_mul_ps( _mm_sub_ps( one, a ), b ) )
+      ACCUMULATE( 3, _mm_mul_ps( a, b ) )
+#undef ACCUMULATE
+
+      _mm_storeu_si128( (__m128i *) out,
+                        _mm_packus_epi16( _mm_srli_epi16( sumlo, 8 ),
+                                          _mm_srli_epi16( sumhi, 8 ) ) );
+      for (p=0;p<4;p++) {
+         red[k+p]   = out[p*4+0];
+         green[k+p] = out[p*4+1];
+         blue[k+p]  = out[p*4+2];
+         if (rgba) {
+            alpha[k+p] = out[p*4+3];
+         }
+      }
+   }
+   return k;
+}
+
+#undef SSE2_SPLAT_WEIGHTS
+
+
+/*
+ * The texel offsets (j << WidthLog2) | i of four GL_NEAREST samples
+ * of a repeating image without border, computed as opt_sample_rgb_2d()
+ * and opt_sample_rgba_2d() do.
+ */
+static void sse2_nearest_pos( const struct gl_texture_image *img,
+                              const GLfloat s[], const GLfloat t[],
+                              GLint pos[4] )
+{
+   __m128i i, j;
+
+   i = _mm_cvttps_epi32( _mm_mul_ps( _mm_loadu_ps( s ),
+                                     _mm_set1_ps( (GLfloat) img->Width ) ) );
+   j = _mm_cvttps_epi32( _mm_mul_ps( _mm_loadu_ps( t ),
+                                     _mm_set1_ps( (GLfloat) img->Height ) ) );
+   i = _mm_and_si128( i, _mm_set1_epi32( img->Width - 1 ) );
+   j = _mm_and_si128( j, _mm_set1_epi32( img->Height - 1 ) );
+   j = _mm_sll_epi32( j, _mm_cvtsi32_si128( img->WidthLog2 ) );
+   _mm_storeu_si128( (__m128i *) pos, _mm_or_si128( i, j ) );
+}
+#endif
+
+
+
 static void sample_linear_2d( const struct gl_texture_object *tObj, GLuint n,
                               const GLfloat s[], const GLfloat t[],
                               const GLfloat u[], const GLfloat lambda[],
                               GLubyte red[], GLubyte green[], GLubyte blue[],
                               GLubyte alpha[] )
 {
-   GLuint i;
-   for (i=0;i<n;i++) {
+   GLuint i = 0;
+#ifdef USE_SSE2
+   if (tObj->WrapS==GL_REPEAT && tObj->WrapT==GL_REPEAT
+       && tObj->Image[0]->Border==0
+       && (tObj->Image[0]->Format==GL_RGB
+           || tObj->Image[0]->Format==GL_RGBA)) {
+      i = sse2_sample_linear_2d( tObj, n, s, t, red, green, blue, alpha );
+   }
+#endif
+   for (;i<n;i++) {
       sample_2d_linear( tObj, tObj->Image[0], s[i], t[i],
                         &red[i], &green[i], &blue[i], &alpha[i]);
    }
@@ -1260,7 +1428,21 @@ static void opt_sample_rgb_2d( const struct gl_texture_object *tObj,
    ASSERT(img->Border==0);
    ASSERT(img->Format==GL_RGB);
 
-   for (k=0;k<n;k++) {
+   k = 0;
+#ifdef USE_SSE2
+   for (; k+4<=n; k+=4) {
+      GLint pos[4];
+      GLuint m;
+      sse2_nearest_pos( img, s+k, t+k, pos );
+      for (m=0;m<4;m++) {
+         GLubyte *texel = img->Data + pos[m] + pos[m] + pos[m];
+         red[k+m]   = texel[0];
+         green[k+m] = texel[1];
+         blue[k+m]  = texel[2];
+      }
+   }
+#endif
+   for (;k<n;k++) {
       GLint i = (GLint) (s[k] * width) & colMask;
       GLint j = (GLint) (t[k] * height) & rowMask;
       GLint pos = (j << shift) | i;
@@ -1295,7 +1477,22 @@ static void opt_sample_rgba_2d( const struct gl_texture_object *tObj,
    ASSERT(img->Border==0);
    ASSERT(img->Format==GL_RGBA);
 
-   for (k=0;k<n;k++) {
+   k = 0;
+#ifdef USE_SSE2
+   for (; k+4<=n; k+=4) {
+      GLint pos[4];
+      GLuint m;
+      sse2_nearest_pos( img, s+k, t+k, pos );
+      for (m=0;m<4;m++) {
+         GLubyte *texel = img->Data + (pos[m] << 2);
+         red[k+m]   = texel[0];
+         green[k+m] = texel[1];
+         blue[k+m]  = texel[2];
+         alpha[k+m] = texel[3];
+      }
+   }
+#endif
+   for (;k<n;k++) {
       GLint i = (GLint) (s[k] * width) & colMask;
       GLint j = (GLint) (t[k] * height) & rowMask;
       GLint pos = (j << shift) | i;
@@ -0,0 +1,323 @@
+/* $Id$ */
+
+/*
+ * Mesa 3-D graphics library
+ * Version:  2.6
+ * Copyright (C) 1995-1997  Brian Paul
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+
+/*
+ * Multi-threaded triangle rasterization.
+ *
+ * When the device driver provides the RasterThreads() and RasterRun()
+ * functions, the triangle function chosen by gl_set_triangle_function()
+ * is replaced by one which only records the triangle: its vertices are
+ * copied into vertex buffers owned by the tiler.  At glEnd() time (or
+ * when the tiler is full) the recorded triangles are drawn by the
+ * driver's threads.  Each thread draws every triangle, in order, but
+ * only writes the rows in its own set of bands (see TILE_OWNS_ROW), so
+ * no two threads ever touch the same pixel and the result is identical
+ * to drawing the triangles one after the other.
+ *
+ * Small batches aren't worth waking the threads up for and are drawn
+ * on the calling thread instead.
+ */
+
+
+#ifdef PC_HEADER
+#include "all.h"
+#else
+#include <stdlib.h>
+#include <string.h>
+#include "macros.h"
+#include "tiler.h"
+#include "types.h"
+#include "vb.h"
+#endif
+
+
+#define MAX_TILE_THREADS  16
+
+/* Each recorded triangle takes 4 vertex slots: v0, v1, v2 and pv */
+#define TRIS_PER_BLOCK    (VB_SIZE / 4)
+#define TILER_BLOCKS      8
+#define MAX_TRIS          (TILER_BLOCKS * TRIS_PER_BLOCK)
+
+/* Batches covering fewer pixels than this are drawn serially */
+#define SERIAL_AREA       (64 * 1024)
+
+
+struct tiler_triangle {
+   struct vertex_buffer *VB;
+   GLuint First;		/* v0 of the triangle in VB */
+   GLint Ymin, Ymax;		/* Rows the triangle may touch */
+   GLfloat Zoffset;		/* ctx->PolygonZoffset when recorded */
+};
+
+
+struct gl_tiler {
+   triangle_func Triangle;	/* The rasterizer being deferred */
+   GLuint Threads;
+   GLuint Count;		/* Number of recorded triangles */
+   GLfloat Area;		/* Sum of their bounding box areas */
+   GLcontext *Ctx;		/* Context being flushed */
+   struct vertex_buffer *Block[TILER_BLOCKS];
+   GLcontext *Worker[MAX_TILE_THREADS];
+   struct tiler_triangle Tri[MAX_TRIS];
+};
+
+
+
+/*
+ * Draw the triangles recorded so far on the calling thread.
+ */
+static void draw_serial( GLcontext *ctx, struct gl_tiler *t )
+{
+   struct vertex_buffer *VB = ctx->VB;
+   GLfloat zoffset = ctx->PolygonZoffset;
+   GLuint i;
+
+   for (i=0;i<t->Count;i++) {
+      const struct tiler_triangle *tri = &t->Tri[i];
+      GLuint f = tri->First;
+      ctx->VB = tri->VB;
+      ctx->PolygonZoffset = tri->Zoffset;
+      (*t->Triangle)( ctx, f, f+1, f+2, f+3 );
+   }
+
+   ctx->VB = VB;
+   ctx->PolygonZoffset = zoffset;
+}
+
+
+
+static void record_triangle( GLcontext *ctx,
+                             GLuint v0, GLuint v1, GLuint v2, GLuint pv )
+{
+   struct gl_tiler *t = ctx->Tiler;
+   struct vertex_buffer *VB = ctx->VB;
+   struct vertex_buffer *dst;
+   struct tiler_triangle *tri;
+   GLuint v[4], i, first;
+   GLfloat xmin, xmax, ymin, ymax;
+
+   if (t->Count==MAX_TRIS) {
+      gl_tiler_flush( ctx );
+   }
+
+   dst = t->Block[t->Count / TRIS_PER_BLOCK];
+   if (!dst) {
+      dst = (struct vertex_buffer *) malloc( sizeof(struct vertex_buffer) );
+      if (!dst) {
+         /* out of memory, keep the order and draw it right away */
+         gl_tiler_flush( ctx );
+         (*t->Triangle)( ctx, v0, v1, v2, pv );
+         return;
+      }
+      dst->Color = dst->Fcolor;
+      dst->Index = dst->Findex;
+      dst->MonoColor = GL_FALSE;
+      t->Block[t->Count / TRIS_PER_BLOCK] = dst;
+   }
+
+   v[0] = v0;  v[1] = v1;  v[2] = v2;  v[3] = pv;
+   first = (t->Count % TRIS_PER_BLOCK) * 4;
+   for (i=0;i<4;i++) {
+      GLuint s = v[i], d = first + i;
+      COPY_3V( dst->Win[d], VB->Win[s] );
+      COPY_4V( dst->Clip[d], VB->Clip[s] );
+      COPY_4V( dst->TexCoord[d], VB->TexCoord[s] );
+      COPY_4UBV( dst->Fcolor[d], VB->Color[s] );
+      dst->Findex[d] = VB->Index[s];
+   }
+
+   xmin = MIN2( VB->Win[v0][0], MIN2( VB->Win[v1][0], VB->Win[v2][0] ) );
+   xmax = MAX2( VB->Win[v0][0], MAX2( VB->Win[v1][0], VB->Win[v2][0] ) );
+   ymin = MIN2( VB->Win[v0][1], MIN2( VB->Win[v1][1], VB->Win[v2][1] ) );
+   ymax = MAX2( VB->Win[v0][1], MAX2( VB->Win[v1][1], VB->Win[v2][1] ) );
+
+   tri = &t->Tri[t->Count++];
+   tri->VB = dst;
+   tri->First = first;
+   tri->Ymin = (GLint) ymin - 1;
+   tri->Ymax = (GLint) ymax + 1;
+   tri->Zoffset = ctx->PolygonZoffset;
+   t->Area += (xmax - xmin + 1.0F) * (ymax - ymin + 1.0F);
+}
+
+
+
+/*
+ * Does the triangle cross any of the bands the context draws?
+ */
+static GLboolean overlaps_bands( const GLcontext *ctx,
+                                 const struct tiler_triangle *tri )
+{
+   GLint band, last;
+
+   if (tri->Ymin < 0) {
+      return GL_TRUE;
+   }
+   band = tri->Ymin >> TILE_SHIFT;
+   last = tri->Ymax >> TILE_SHIFT;
+   if ((GLuint) (last - band) + 1 >= ctx->TileCount) {
+      return GL_TRUE;
+   }
+   for (;band<=last;band++) {
+      if ((GLuint) band % ctx->TileCount == ctx->TileIndex) {
+         return GL_TRUE;
+      }
+   }
+   return GL_FALSE;
+}
+
+
+
+/* The threads must not change the driver's current color or index */
+static void null_color( GLcontext *ctx,
+                        GLubyte red, GLubyte green, GLubyte blue,
+                        GLubyte alpha )
+{
+}
+
+static void null_index( GLcontext *ctx, GLuint index )
+{
+}
+
+
+
+/*
+ * Called by the driver's RasterRun() on each of its threads.
+ */
+static void draw_bands( void *data, GLuint index )
+{
+   struct gl_tiler *t = (struct gl_tiler *) data;
+   GLcontext *ctx = t->Worker[index];
+   GLuint i;
+
+   MEMCPY( ctx, t->Ctx, sizeof(GLcontext) );
+   ctx->TileIndex = index;
+   ctx->TileCount = t->Threads;
+
+   /* Flat shaded spans then go through WriteColorSpan/WriteIndexSpan */
+   ctx->Driver.Color = null_color;
+   ctx->Driver.Index = null_index;
+   ctx->Driver.WriteMonocolorSpan = NULL;
+   ctx->Driver.WriteMonoindexSpan = NULL;
+
+   for (i=0;i<t->Count;i++) {
+      const struct tiler_triangle *tri = &t->Tri[i];
+      GLuint f = tri->First;
+      if (overlaps_bands( ctx, tri )) {
+         ctx->VB = tri->VB;
+         ctx->PolygonZoffset = tri->Zoffset;
+         (*t->Triangle)( ctx, f, f+1, f+2, f+3 );
+      }
+   }
+}
+
+
+
+/*
+ * Called by gl_set_triangle_function() once it has picked one of the
+ * core rasterizers.  Defers the triangles if the driver and the
+ * current state allow it.
+ */
+void gl_tiler_bind( GLcontext *ctx )
+{
+   GLuint threads;
+
+   if (!ctx->Driver.RasterThreads || !ctx->Driver.RasterRun
+       || ctx->Driver.RenderVB
+       || ctx->Polygon.Unfilled
+       || (ctx->RasterMask & FRONT_AND_BACK_BIT)) {
+      return;
+   }
+
+   threads = (*ctx->Driver.RasterThreads)( ctx );
+   if (threads < 2) {
+      return;
+   }
+
+   if (!ctx->Tiler) {
+      ctx->Tiler = (struct gl_tiler *) calloc( 1, sizeof(struct gl_tiler) );
+      if (!ctx->Tiler) {
+         return;
+      }
+   }
+
+   ctx->Tiler->Threads = MIN2( threads, MAX_TILE_THREADS );
+   ctx->Tiler->Triangle = ctx->Driver.TriangleFunc;
+   ctx->Driver.TriangleFunc = record_triangle;
+}
+
+
+
+/*
+ * Draw all recorded triangles.  Called by gl_render_vb() at glEnd().
+ */
+void gl_tiler_flush( GLcontext *ctx )
+{
+   struct gl_tiler *t = ctx->Tiler;
+   GLuint i = 0;
+
+   if (!t || t->Count==0) {
+      return;
+   }
+
+   if (t->Area >= SERIAL_AREA) {
+      for (i=0;i<t->Threads;i++) {
+         if (!t->Worker[i]) {
+            t->Worker[i] = (GLcontext *) malloc( sizeof(GLcontext) );
+            if (!t->Worker[i]) {
+               break;
+            }
+         }
+      }
+   }
+
+   if (t->Area < SERIAL_AREA || i < t->Threads) {
+      draw_serial( ctx, t );
+   }
+   else {
+      t->Ctx = ctx;
+      (*ctx->Driver.RasterRun)( ctx, draw_bands, t, t->Threads );
+   }
+
+   t->Count = 0;
+   t->Area = 0.0F;
+}
+
+
+
+void gl_tiler_destroy( GLcontext *ctx )
+{
+   struct gl_tiler *t = ctx->Tiler;
+   GLuint i;
+
+   if (t) {
+      for (i=0;i<TILER_BLOCKS;i++) {
+         free( t->Block[i] );
+      }
+      for (i=0;i<MAX_TILE_THREADS;i++) {
+         free( t->Worker[i] );
+      }
+      free( t );
+      ctx->Tiler = NULL;
+   }
+}
@@ -0,0 +1,50 @@
+/* $Id$ */
+
+/*
+ * Mesa 3-D graphics library
+ * Version:  2.6
+ * Copyright (C) 1995-1997  Brian Paul
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+
+#ifndef TILER_H
+#define TILER_H
+
+
+#include "types.h"
+
+
+/* Rows are dealt out to the rasterizer threads in bands of this many */
+#define TILE_SHIFT 4
+
+
+/*
+ * Does the given context draw row Y?  Used by tritemp.h.
+ */
+#define TILE_OWNS_ROW( CTX, Y )						\
+   ((CTX)->TileCount <= 1 ||						\
+    (((GLuint) (Y) >> TILE_SHIFT) % (CTX)->TileCount) == (CTX)->TileIndex)
+
+
+extern void gl_tiler_bind( GLcontext *ctx );
+
+extern void gl_tiler_flush( GLcontext *ctx );
+
+extern void gl_tiler_destroy( GLcontext *ctx );
+
+
+#endif
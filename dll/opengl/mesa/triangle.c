@@ -133,6 +133,7 @@
 #include "macros.h"
 #include "span.h"
 #include "texstate.h"
+#include "tiler.h"
 #include "triangle.h"
 #include "types.h"
 #include "vb.h"
@@ -716,6 +717,7 @@ void gl_set_triangle_function( GLcontext *ctx )
       }
       if (ctx->Driver.TriangleFunc) {
          /* Device driver will draw triangles. */
+         return;
       }
       else if (ctx->Texture.Enabled
                && ctx->Texture.Current
@@ -781,6 +783,8 @@ void gl_set_triangle_function( GLcontext *ctx )
                ctx->Driver.TriangleFunc = flat_ci_triangle;
 	 }
       }
+      /* maybe spread the triangles over several threads */
+      gl_tiler_bind( ctx );
    }
    else if (ctx->RenderMode==GL_FEEDBACK) {
       ctx->Driver.TriangleFunc = feedback_triangle;
@@ -770,7 +770,10 @@
                if (ffi<0) ffi = 0;
 #endif
 
-               INNER_LOOP( left, right, iy );
+               /* with several rasterizer threads, only draw our rows */
+               if (TILE_OWNS_ROW( ctx, iy )) {
+                  INNER_LOOP( left, right, iy );
+               }
 
                /*
                 * Advance to the next scan line.  Compute the
@@ -1382,6 +1382,11 @@ struct gl_context {
         /* The pixel buffer being used by this context */
         struct pixel_buffer* PB;
 
+        /* Multi-threaded triangle rasterization, see tiler.c */
+        struct gl_tiler* Tiler;
+        GLuint TileIndex;	/* Row band set this context draws to */
+        GLuint TileCount;	/* Number of band sets, 0 or 1 = all rows */
+
 #ifdef PROFILE
         /* Performance measurements */
         GLuint BeginEndCount;	/* number of glBegin/glEnd pairs */
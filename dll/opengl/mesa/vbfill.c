@@ -111,6 +111,7 @@
 #include "matrix.h"
 #include "mmath.h"
 #include "pb.h"
+#include "tiler.h"
 #include "types.h"
 #include "vb.h"
 #include "vbfill.h"
@@ -1435,6 +1436,8 @@ void gl_End( GLcontext *ctx )
    if (VB->Count > VB->Start) {
       gl_transform_vb_part1( ctx, GL_TRUE );
    }
+   /* the VB may have been rendered before glEnd, with allDone false */
+   gl_tiler_flush( ctx );
    if (PB->count>0) {
       gl_flush_pb(ctx);
    }
@@ -111,6 +111,7 @@
 #include "macros.h"
 #include "matrix.h"
 #include "pb.h"
+#include "tiler.h"
 #include "types.h"
 #include "vb.h"
 #include "vbrender.h"
@@ -1137,6 +1138,11 @@ void gl_render_vb( GLcontext *ctx, GLboolean allDone )
          gl_problem( ctx, "invalid mode in gl_render_vb" );
    }
 
+   if (allDone) {
+      /* draw any triangles the tiler has been holding back */
+      gl_tiler_flush( ctx );
+   }
+
    gl_reset_vb( ctx, allDone );
 }
 
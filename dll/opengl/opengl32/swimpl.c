@@ -16,6 +16,9 @@ WINE_DEFAULT_DEBUG_CHANNEL(opengl32);
 #define WIDTH_BYTES_ALIGN32(cx, bpp) ((((cx) * (bpp) + 31) & ~31) >> 3)
 #define WIDTH_BYTES_ALIGN16(cx, bpp) ((((cx) * (bpp) + 15) & ~15) >> 3)
 
+/* Most threads a context rasterizes with, the calling one included */
+#define SW_MAX_RASTER_THREADS 8
+
 /* Flags for our pixel formats */
 #define SB_FLAGS            (PFD_DRAW_TO_BITMAP | PFD_SUPPORT_GDI | PFD_SUPPORT_OPENGL | PFD_GENERIC_FORMAT)
 #define SB_FLAGS_WINDOW     (PFD_DRAW_TO_BITMAP | PFD_SUPPORT_GDI | PFD_DRAW_TO_WINDOW | PFD_SUPPORT_OPENGL | PFD_GENERIC_FORMAT)
@@ -268,6 +271,23 @@ struct sw_context
         } u32;
     };
     GLenum Mode;
+
+    /* Rasterizer threads, see sw_raster_run */
+    struct sw_raster_worker
+    {
+        struct sw_context* sw_ctx;
+        GLuint Index;
+        HANDLE Thread;
+        HANDLE Start;
+        HMODULE Module;
+    } Workers[SW_MAX_RASTER_THREADS - 1];
+    UINT WorkerCount;
+    UINT RasterThreads;
+    HANDLE RasterDone;
+    LONG RasterPending;
+    BOOL RasterExit;
+    void (*RasterFunc)(void* data, GLuint i);
+    void* RasterData;
 };
 
 /* WGL <-> mesa glue */
@@ -419,10 +439,92 @@ BOOL sw_SetPixelFormat(HDC hdc, struct wgl_dc_data* dc_data, INT format)
     return TRUE;
 }
 
+/* Rasterizer threads.
+ * Mesa hands us the triangles of a glBegin/glEnd pair and the number of
+ * threads to draw them with, each thread drawing its own rows. Workers
+ * hold a reference on our module so that it can't go away under them. */
+static DWORD WINAPI sw_raster_thread(LPVOID param)
+{
+    struct sw_raster_worker* worker = param;
+    struct sw_context* sw_ctx = worker->sw_ctx;
+
+    for (;;)
+    {
+        WaitForSingleObject(worker->Start, INFINITE);
+        if (sw_ctx->RasterExit)
+            break;
+
+        sw_ctx->RasterFunc(sw_ctx->RasterData, worker->Index);
+
+        if (InterlockedDecrement(&sw_ctx->RasterPending) == 0)
+            SetEvent(sw_ctx->RasterDone);
+    }
+
+    FreeLibraryAndExitThread(worker->Module, 0);
+}
+
+static BOOL sw_start_raster_threads(struct sw_context* sw_ctx, UINT count)
+{
+    if (!sw_ctx->RasterDone)
+    {
+        sw_ctx->RasterDone = CreateEventW(NULL, FALSE, FALSE, NULL);
+        if (!sw_ctx->RasterDone)
+            return FALSE;
+    }
+
+    while (sw_ctx->WorkerCount < count)
+    {
+        struct sw_raster_worker* worker = &sw_ctx->Workers[sw_ctx->WorkerCount];
+
+        worker->sw_ctx = sw_ctx;
+        worker->Index = sw_ctx->WorkerCount + 1;
+        worker->Start = CreateEventW(NULL, FALSE, FALSE, NULL);
+        if (!worker->Start)
+            return FALSE;
+        if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS,
+                                (LPCWSTR)sw_raster_thread, &worker->Module))
+        {
+            CloseHandle(worker->Start);
+            return FALSE;
+        }
+        worker->Thread = CreateThread(NULL, 0, sw_raster_thread, worker, 0, NULL);
+        if (!worker->Thread)
+        {
+            FreeLibrary(worker->Module);
+            CloseHandle(worker->Start);
+            return FALSE;
+        }
+        sw_ctx->WorkerCount++;
+    }
+
+    return TRUE;
+}
+
+static void sw_stop_raster_threads(struct sw_context* sw_ctx)
+{
+    UINT i;
+
+    sw_ctx->RasterExit = TRUE;
+    for (i = 0; i < sw_ctx->WorkerCount; i++)
+        SetEvent(sw_ctx->Workers[i].Start);
+
+    for (i = 0; i < sw_ctx->WorkerCount; i++)
+    {
+        WaitForSingleObject(sw_ctx->Workers[i].Thread, INFINITE);
+        CloseHandle(sw_ctx->Workers[i].Thread);
+        CloseHandle(sw_ctx->Workers[i].Start);
+    }
+    sw_ctx->WorkerCount = 0;
+
+    if (sw_ctx->RasterDone)
+        CloseHandle(sw_ctx->RasterDone);
+}
+
 DHGLRC sw_CreateContext(struct wgl_dc_data* dc_data)
 {
     struct sw_context* sw_ctx;
     struct sw_framebuffer* fb = dc_data->sw_data;
+    SYSTEM_INFO SystemInfo;
 
     sw_ctx = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*sw_ctx));
     if(!sw_ctx)
@@ -442,6 +544,10 @@ DHGLRC sw_CreateContext(struct wgl_dc_data* dc_data)
     /* Choose relevant default */
     sw_ctx->Mode = fb->gl_visual->DBflag ? GL_BACK : GL_FRONT;
 
+    /* Rasterize on as many threads as there are CPUs */
+    GetSystemInfo(&SystemInfo);
+    sw_ctx->RasterThreads = min(SystemInfo.dwNumberOfProcessors, SW_MAX_RASTER_THREADS);
+
     return (DHGLRC)sw_ctx;
 }
 
@@ -454,6 +560,7 @@ BOOL sw_DeleteContext(DHGLRC dhglrc)
     
     /* Destroy everything */
     gl_destroy_context(sw_ctx->gl_ctx);
+    sw_stop_raster_threads(sw_ctx);
 
     HeapFree(GetProcessHeap(), 0, sw_ctx);
     
@@ -1305,6 +1412,43 @@ READ_COLOR_PIXELS(24, ULONG, 3)
 READ_COLOR_PIXELS(32, ULONG, 4)
 #undef READ_COLOR_PIXELS
 
+/* Only the back buffer is plain memory that several threads can draw to.
+ * 24bpp pixels are written 4 bytes at a time and may touch the next row. */
+static GLuint sw_raster_threads(GLcontext* ctx)
+{
+    struct sw_context* sw_ctx = ctx->DriverCtx;
+    struct sw_framebuffer* fb = sw_ctx->fb;
+
+    if ((sw_ctx->Mode != GL_BACK) || !fb->BackBuffer || (fb->pixel_format->cColorBits == 24))
+        return 1;
+
+    return sw_ctx->RasterThreads;
+}
+
+static void sw_raster_run(GLcontext* ctx, void (*func)(void* data, GLuint i), void* data, GLuint count)
+{
+    struct sw_context* sw_ctx = ctx->DriverCtx;
+    GLuint i;
+
+    if ((count > SW_MAX_RASTER_THREADS) || !sw_start_raster_threads(sw_ctx, count - 1))
+    {
+        /* Do it all ourselves then */
+        for (i = 0; i < count; i++)
+            func(data, i);
+        return;
+    }
+
+    sw_ctx->RasterFunc = func;
+    sw_ctx->RasterData = data;
+    sw_ctx->RasterPending = count - 1;
+    for (i = 0; i < count - 1; i++)
+        SetEvent(sw_ctx->Workers[i].Start);
+
+    func(data, 0);
+
+    WaitForSingleObject(sw_ctx->RasterDone, INFINITE);
+}
+
 static void setup_DD_pointers( GLcontext* ctx )
 {
     struct sw_context* sw_ctx = ctx->DriverCtx;
@@ -1356,6 +1500,10 @@ HANDLE_BPP(32);
     ctx->Driver.SetBuffer = set_buffer;
     ctx->Driver.GetBufferSize = buffer_size;
 
+    /* Triangles may be drawn on several threads */
+    ctx->Driver.RasterThreads = sw_raster_threads;
+    ctx->Driver.RasterRun = sw_raster_run;
+
     /* Pixel/span writing functions: */
     ctx->Driver.WriteIndexSpan       = write_index_span;
     ctx->Driver.WriteIndexPixels     = write_index_pixels;
@@ -394,6 +394,53 @@ static GpStatus alpha_blend_bmp_pixels(GpGraphics *graphics, INT dst_x, INT dst_
 {
     GpBitmap *dst_bitmap = (GpBitmap*)graphics->image;
     INT x, y;
+    span_format format = SPAN_FORMAT_ARGB;
+    BOOL rows = TRUE;
+
+    switch (dst_bitmap->format)
+    {
+    case PixelFormat32bppRGB:
+        format = SPAN_FORMAT_RGB;
+        break;
+    case PixelFormat32bppARGB:
+        format = SPAN_FORMAT_ARGB;
+        break;
+    case PixelFormat32bppPARGB:
+        format = SPAN_FORMAT_PARGB;
+        break;
+    default:
+        rows = FALSE;
+        break;
+    }
+
+    if (rows)
+    {
+        /* Whole rows at a time, clipped the way GdipBitmapSetPixel would */
+        if (dst_x < 0)
+        {
+            src += -dst_x * 4;
+            src_width += dst_x;
+            dst_x = 0;
+        }
+        if (dst_y < 0)
+        {
+            src += -dst_y * src_stride;
+            src_height += dst_y;
+            dst_y = 0;
+        }
+        if (src_width > dst_bitmap->width - dst_x)
+            src_width = dst_bitmap->width - dst_x;
+        if (src_height > dst_bitmap->height - dst_y)
+            src_height = dst_bitmap->height - dst_y;
+        if (src_width <= 0 || src_height <= 0)
+            return Ok;
+
+        for (y=0; y<src_height; y++)
+            span_blend_row(dst_bitmap->bits + dst_bitmap->stride * (y+dst_y) + dst_x * 4, format,
+                (const ARGB*)(src + src_stride * y), src_width, (fmt & PixelFormatPAlpha) != 0);
+
+        return Ok;
+    }
 
     for (y=0; y<src_height; y++)
     {
@@ -557,38 +604,8 @@ static GpStatus alpha_blend_pixels(GpGraphics *graphics, INT dst_x, INT dst_y,
     return alpha_blend_pixels_hrgn(graphics, dst_x, dst_y, src, src_width, src_height, src_stride, NULL, fmt);
 }
 
-/* NOTE: start and end pixels must be in pre-multiplied ARGB format */
-static inline ARGB blend_colors_premult(ARGB start, ARGB end, REAL position)
-{
-    UINT pos = position * 255.0f + 0.5f;
-    return
-        (((((start >> 24)       ) << 8) + (((end >> 24)       ) - ((start >> 24)       )) * pos) >> 8) << 24 |
-        (((((start >> 16) & 0xff) << 8) + (((end >> 16) & 0xff) - ((start >> 16) & 0xff)) * pos) >> 8) << 16 |
-        (((((start >>  8) & 0xff) << 8) + (((end >>  8) & 0xff) - ((start >>  8) & 0xff)) * pos) >> 8) <<  8 |
-        (((((start      ) & 0xff) << 8) + (((end      ) & 0xff) - ((start      ) & 0xff)) * pos) >> 8);
-}
-
-static ARGB blend_colors(ARGB start, ARGB end, REAL position)
-{
-    INT start_a, end_a, final_a;
-    INT pos;
-
-    pos = (INT)(position * 255.0f + 0.5f);
-
-    start_a = ((start >> 24) & 0xff) * (pos ^ 0xff);
-    end_a = ((end >> 24) & 0xff) * pos;
-
-    final_a = start_a + end_a;
-
-    if (final_a < 0xff) return 0;
-
-    return (final_a / 0xff) << 24 |
-        ((((start >> 16) & 0xff) * start_a + (((end >> 16) & 0xff) * end_a)) / final_a) << 16 |
-        ((((start >> 8) & 0xff) * start_a + (((end >> 8) & 0xff) * end_a)) / final_a) << 8 |
-        (((start & 0xff) * start_a + ((end & 0xff) * end_a)) / final_a);
-}
-
-static ARGB blend_line_gradient(GpLineGradient* brush, REAL position)
+/* Position between the start and the end color before preset colors */
+static REAL line_gradient_blendfac(GpLineGradient* brush, REAL position)
 {
     REAL blendfac;
 
@@ -628,6 +645,13 @@ static ARGB blend_line_gradient(GpLineGradient* brush, REAL position)
                     right_blendfac * (position - left_blendpos)) / range;
     }
 
+    return blendfac;
+}
+
+static ARGB blend_line_gradient(GpLineGradient* brush, REAL position)
+{
+    REAL blendfac = line_gradient_blendfac(brush, position);
+
     if (brush->pblendcount == 0)
         return blend_colors(brush->startcolor, brush->endcolor, blendfac);
     else
@@ -875,10 +899,17 @@ static void get_bitmap_sample_size(InterpolationMode interpolation, WrapMode wra
 
     switch (interpolation)
     {
-    case InterpolationModeHighQualityBilinear:
     case InterpolationModeHighQualityBicubic:
-    /* FIXME: Include a greater range for the prefilter? */
     case InterpolationModeBicubic:
+        /* The cubic reaches one pixel further to the left and top and two
+         * to the right and bottom */
+        left = (INT)(floorf(srcx)) - 1;
+        top = (INT)(floorf(srcy)) - 1;
+        right = (INT)(ceilf(srcx+srcwidth)) + 2;
+        bottom = (INT)(ceilf(srcy+srcheight)) + 2;
+        break;
+    case InterpolationModeHighQualityBilinear:
+    /* FIXME: Include a greater range for the prefilter? */
     case InterpolationModeBilinear:
         left = (INT)(floorf(srcx));
         top = (INT)(floorf(srcy));
@@ -933,63 +964,26 @@ static void get_bitmap_sample_size(InterpolationMode interpolation, WrapMode wra
     rect->Height = bottom - top + 1;
 }
 
-static ARGB sample_bitmap_pixel(GDIPCONST GpRect *src_rect, LPBYTE bits, UINT width,
-    UINT height, INT x, INT y, GDIPCONST GpImageAttributes *attributes)
-{
-    if (attributes->wrap == WrapModeClamp)
-    {
-        if (x < 0 || y < 0 || x >= width || y >= height)
-            return attributes->outside_color;
-    }
-    else
-    {
-        /* Tiling. Make sure co-ordinates are positive as it simplifies the math. */
-        if (x < 0)
-            x = width*2 + x % (width * 2);
-        if (y < 0)
-            y = height*2 + y % (height * 2);
-
-        if (attributes->wrap & WrapModeTileFlipX)
-        {
-            if ((x / width) % 2 == 0)
-                x = x % width;
-            else
-                x = width - 1 - x % width;
-        }
-        else
-            x = x % width;
-
-        if (attributes->wrap & WrapModeTileFlipY)
-        {
-            if ((y / height) % 2 == 0)
-                y = y % height;
-            else
-                y = height - 1 - y % height;
-        }
-        else
-            y = y % height;
-    }
-
-    if (x < src_rect->X || y < src_rect->Y || x >= src_rect->X + src_rect->Width || y >= src_rect->Y + src_rect->Height)
-    {
-        ERR("out of range pixel requested\n");
-        return 0xffcd0084;
-    }
-
-    return ((DWORD*)(bits))[(x - src_rect->X) + (y - src_rect->Y) * src_rect->Width];
-}
-
-static inline int positive_ceilf(float f)
-{
-    return f - (int)f > 0.0f ? f + 1.0f : f;
-}
-
-static ARGB resample_bitmap_pixel(GDIPCONST GpRect *src_rect, LPBYTE bits, UINT width,
-    UINT height, GpPointF *point, GDIPCONST GpImageAttributes *attributes,
-    InterpolationMode interpolation, PixelOffsetMode offset_mode)
+static void init_span_source(span_source *source, GDIPCONST GpRect *src_rect, LPBYTE bits,
+    UINT width, UINT height, GDIPCONST GpImageAttributes *attributes,
+    InterpolationMode interpolation, PixelOffsetMode offset_mode, BOOL premult)
 {
     static int fixme;
 
+    source->bits = (const ARGB*)bits;
+    source->x = src_rect->X;
+    source->y = src_rect->Y;
+    source->width = src_rect->Width;
+    source->height = src_rect->Height;
+    source->bitmap_width = width;
+    source->bitmap_height = height;
+    source->clamp = attributes->wrap == WrapModeClamp;
+    source->flip_x = (attributes->wrap & WrapModeTileFlipX) != 0;
+    source->flip_y = (attributes->wrap & WrapModeTileFlipY) != 0;
+    source->outside_color = attributes->outside_color;
+    source->premult = premult;
+    source->bounded = FALSE;
+
     switch (interpolation)
     {
     default:
@@ -997,128 +991,30 @@ static ARGB resample_bitmap_pixel(GDIPCONST GpRect *src_rect, LPBYTE bits, UINT
             FIXME("Unimplemented interpolation %i\n", interpolation);
         /* fall-through */
     case InterpolationModeBilinear:
-    {
-        REAL leftxf, topyf;
-        INT leftx, rightx, topy, bottomy;
-        ARGB topleft, topright, bottomleft, bottomright;
-        ARGB top, bottom;
-        float x_offset;
-
-        leftx = (INT)point->X;
-        leftxf = (REAL)leftx;
-        rightx = positive_ceilf(point->X);
-        topy = (INT)point->Y;
-        topyf = (REAL)topy;
-        bottomy = positive_ceilf(point->Y);
-
-        if (leftx == rightx && topy == bottomy)
-            return sample_bitmap_pixel(src_rect, bits, width, height,
-                leftx, topy, attributes);
-
-        topleft = sample_bitmap_pixel(src_rect, bits, width, height,
-            leftx, topy, attributes);
-        topright = sample_bitmap_pixel(src_rect, bits, width, height,
-            rightx, topy, attributes);
-        bottomleft = sample_bitmap_pixel(src_rect, bits, width, height,
-            leftx, bottomy, attributes);
-        bottomright = sample_bitmap_pixel(src_rect, bits, width, height,
-            rightx, bottomy, attributes);
-
-        x_offset = point->X - leftxf;
-        top = blend_colors(topleft, topright, x_offset);
-        bottom = blend_colors(bottomleft, bottomright, x_offset);
-
-        return blend_colors(top, bottom, point->Y - topyf);
-    }
+    case InterpolationModeHighQualityBilinear:
+        source->filter = SPAN_FILTER_BILINEAR;
+        break;
+    case InterpolationModeBicubic:
+    case InterpolationModeHighQualityBicubic:
+        source->filter = SPAN_FILTER_BICUBIC;
+        break;
     case InterpolationModeNearestNeighbor:
-    {
-        FLOAT pixel_offset;
-        switch (offset_mode)
-        {
-        default:
-        case PixelOffsetModeNone:
-        case PixelOffsetModeHighSpeed:
-            pixel_offset = 0.5;
-            break;
-
-        case PixelOffsetModeHalf:
-        case PixelOffsetModeHighQuality:
-            pixel_offset = 0.0;
-            break;
-        }
-        return sample_bitmap_pixel(src_rect, bits, width, height,
-            floorf(point->X + pixel_offset), floorf(point->Y + pixel_offset), attributes);
-    }
-
+        source->filter = SPAN_FILTER_NEAREST;
+        break;
     }
-}
 
-static ARGB resample_bitmap_pixel_premult(GDIPCONST GpRect *src_rect, LPBYTE bits, UINT width,
-    UINT height, GpPointF *point, GDIPCONST GpImageAttributes *attributes,
-    InterpolationMode interpolation, PixelOffsetMode offset_mode)
-{
-    static int fixme;
-
-    switch (interpolation)
+    switch (offset_mode)
     {
     default:
-        if (!fixme++)
-            FIXME("Unimplemented interpolation %i\n", interpolation);
-        /* fall-through */
-    case InterpolationModeBilinear:
-    {
-        REAL leftxf, topyf;
-        INT leftx, rightx, topy, bottomy;
-        ARGB topleft, topright, bottomleft, bottomright;
-        ARGB top, bottom;
-        float x_offset;
-
-        leftx = (INT)point->X;
-        leftxf = (REAL)leftx;
-        rightx = positive_ceilf(point->X);
-        topy = (INT)point->Y;
-        topyf = (REAL)topy;
-        bottomy = positive_ceilf(point->Y);
-
-        if (leftx == rightx && topy == bottomy)
-            return sample_bitmap_pixel(src_rect, bits, width, height,
-                leftx, topy, attributes);
-
-        topleft = sample_bitmap_pixel(src_rect, bits, width, height,
-            leftx, topy, attributes);
-        topright = sample_bitmap_pixel(src_rect, bits, width, height,
-            rightx, topy, attributes);
-        bottomleft = sample_bitmap_pixel(src_rect, bits, width, height,
-            leftx, bottomy, attributes);
-        bottomright = sample_bitmap_pixel(src_rect, bits, width, height,
-            rightx, bottomy, attributes);
-
-        x_offset = point->X - leftxf;
-        top = blend_colors_premult(topleft, topright, x_offset);
-        bottom = blend_colors_premult(bottomleft, bottomright, x_offset);
-
-        return blend_colors_premult(top, bottom, point->Y - topyf);
-    }
-    case InterpolationModeNearestNeighbor:
-    {
-        FLOAT pixel_offset;
-        switch (offset_mode)
-        {
-        default:
-        case PixelOffsetModeNone:
-        case PixelOffsetModeHighSpeed:
-            pixel_offset = 0.5;
-            break;
-
-        case PixelOffsetModeHalf:
-        case PixelOffsetModeHighQuality:
-            pixel_offset = 0.0;
-            break;
-        }
-        return sample_bitmap_pixel(src_rect, bits, width, height,
-            floorf(point->X + pixel_offset), point->Y + pixel_offset, attributes);
-    }
+    case PixelOffsetModeNone:
+    case PixelOffsetModeHighSpeed:
+        source->pixel_offset = 0.5;
+        break;
 
+    case PixelOffsetModeHalf:
+    case PixelOffsetModeHighQuality:
+        source->pixel_offset = 0.0;
+        break;
     }
 }
 
@@ -1243,36 +1139,25 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
     {
     case BrushTypeSolidColor:
     {
-        int x, y;
+        int y;
         GpSolidFill *fill = (GpSolidFill*)brush;
-        for (x=0; x<fill_area->Width; x++)
-            for (y=0; y<fill_area->Height; y++)
-                argb_pixels[x + y*cdwStride] = fill->color;
+        for (y=0; y<fill_area->Height; y++)
+            span_fill_solid(argb_pixels + y*cdwStride, fill_area->Width, fill->color);
         return Ok;
     }
     case BrushTypeHatchFill:
     {
-        int x, y;
+        int y;
         GpHatch *fill = (GpHatch*)brush;
         const char *hatch_data;
 
         if (get_hatch_data(fill->hatchstyle, &hatch_data) != Ok)
             return NotImplemented;
 
-        for (x=0; x<fill_area->Width; x++)
-            for (y=0; y<fill_area->Height; y++)
-            {
-                int hx, hy;
-
-                /* FIXME: Account for the rendering origin */
-                hx = (x + fill_area->X) % 8;
-                hy = (y + fill_area->Y) % 8;
-
-                if ((hatch_data[7-hy] & (0x80 >> hx)) != 0)
-                    argb_pixels[x + y*cdwStride] = fill->forecol;
-                else
-                    argb_pixels[x + y*cdwStride] = fill->backcol;
-            }
+        /* FIXME: Account for the rendering origin */
+        for (y=0; y<fill_area->Height; y++)
+            span_fill_hatch(argb_pixels + y*cdwStride, fill_area->Width,
+                fill_area->X, fill_area->Y + y, hatch_data, fill->forecol, fill->backcol);
 
         return Ok;
     }
@@ -1309,14 +1194,35 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
         {
             REAL x_delta = draw_points[1].X - draw_points[0].X;
             REAL y_delta = draw_points[2].X - draw_points[0].X;
+            ARGB colors[256];
+
+            /* Without preset colors every pixel is one of 256 blends of the
+             * start and end color. */
+            if (fill->pblendcount == 0)
+            {
+                for (x=0; x<256; x++)
+                    colors[x] = blend_colors_pos(fill->startcolor, fill->endcolor, x);
+            }
 
             for (y=0; y<fill_area->Height; y++)
             {
+                DWORD *row = argb_pixels + y*cdwStride;
+
                 for (x=0; x<fill_area->Width; x++)
                 {
                     REAL pos = draw_points[0].X + x * x_delta + y * y_delta;
 
-                    argb_pixels[x + y*cdwStride] = blend_line_gradient(fill, pos);
+                    if (fill->pblendcount == 0)
+                    {
+                        INT index = (INT)(line_gradient_blendfac(fill, pos) * 255.0f + 0.5f);
+
+                        if (index >= 0 && index <= 255)
+                            row[x] = colors[index];
+                        else
+                            row[x] = blend_colors_pos(fill->startcolor, fill->endcolor, index);
+                    }
+                    else
+                        row[x] = blend_line_gradient(fill, pos);
                 }
             }
         }
@@ -1328,7 +1234,7 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
         GpTexture *fill = (GpTexture*)brush;
         GpPointF draw_points[3];
         GpStatus stat;
-        int x, y;
+        int y;
         GpBitmap *bitmap;
         int src_stride;
         GpRect src_area;
@@ -1407,21 +1313,16 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
             REAL x_dy = draw_points[1].Y - draw_points[0].Y;
             REAL y_dx = draw_points[2].X - draw_points[0].X;
             REAL y_dy = draw_points[2].Y - draw_points[0].Y;
+            span_source source;
+
+            init_span_source(&source, &src_area, fill->bitmap_bits, bitmap->width,
+                bitmap->height, fill->imageattributes, graphics->interpolation,
+                graphics->pixeloffset, FALSE);
 
             for (y=0; y<fill_area->Height; y++)
-            {
-                for (x=0; x<fill_area->Width; x++)
-                {
-                    GpPointF point;
-                    point.X = draw_points[0].X + x * x_dx + y * y_dx;
-                    point.Y = draw_points[0].Y + y * x_dy + y * y_dy;
-
-                    argb_pixels[x + y*cdwStride] = resample_bitmap_pixel(
-                        &src_area, fill->bitmap_bits, bitmap->width, bitmap->height,
-                        &point, fill->imageattributes, graphics->interpolation,
-                        graphics->pixeloffset);
-                }
-            }
+                span_resample(&source, argb_pixels + y*cdwStride, fill_area->Width,
+                    draw_points[0].X + y * y_dx, draw_points[0].Y + y * y_dy,
+                    0.0f, 0.0f, x_dx, x_dy);
         }
 
         return stat;
@@ -3264,7 +3165,8 @@ GpStatus WINGDIPAPI GdipDrawImagePointsRect(GpGraphics *graphics, GpImage *image
 
             if (do_resampling)
             {
-                REAL delta_xx, delta_xy, delta_yx, delta_yy;
+                REAL delta_yx, delta_yy;
+                span_source source;
 
                 /* Transform the bits as needed to the destination. */
                 dst_data = dst_dyn_data = heap_alloc_zero(sizeof(ARGB) * (dst_area.right - dst_area.left) * (dst_area.bottom - dst_area.top));
@@ -3283,41 +3185,28 @@ GpStatus WINGDIPAPI GdipDrawImagePointsRect(GpGraphics *graphics, GpImage *image
                 y_dx = dst_to_src_points[2].X - dst_to_src_points[0].X;
                 y_dy = dst_to_src_points[2].Y - dst_to_src_points[0].Y;
 
-                delta_yy = dst_area.top * y_dy;
+                init_span_source(&source, &src_area, src_data, bitmap->width, bitmap->height,
+                    imageAttributes, interpolation, offset_mode,
+                    lockeddata.PixelFormat == PixelFormat32bppPARGB);
+
+                /* Only points inside the source rectangle are drawn */
+                source.bounded = TRUE;
+                source.min_x = srcx;
+                source.min_y = srcy;
+                source.max_x = srcx + srcwidth;
+                source.max_y = srcy + srcheight;
+
                 delta_yx = dst_area.top * y_dx;
+                delta_yy = dst_area.top * y_dy;
 
                 for (y=dst_area.top; y<dst_area.bottom; y++)
                 {
-                    delta_xx = dst_area.left * x_dx;
-                    delta_xy = dst_area.left * x_dy;
-
-                    for (x=dst_area.left; x<dst_area.right; x++)
-                    {
-                        GpPointF src_pointf;
-                        ARGB *dst_color;
-
-                        src_pointf.X = dst_to_src_points[0].X + delta_xx + delta_yx;
-                        src_pointf.Y = dst_to_src_points[0].Y + delta_xy + delta_yy;
-
-                        dst_color = (ARGB*)(dst_data + dst_stride * (y - dst_area.top) + sizeof(ARGB) * (x - dst_area.left));
-
-                        if (src_pointf.X >= srcx && src_pointf.X < srcx + srcwidth && src_pointf.Y >= srcy && src_pointf.Y < srcy+srcheight)
-                        {
-                            if (lockeddata.PixelFormat != PixelFormat32bppPARGB)
-                                *dst_color = resample_bitmap_pixel(&src_area, src_data, bitmap->width, bitmap->height, &src_pointf,
-                                                                   imageAttributes, interpolation, offset_mode);
-                            else
-                                *dst_color = resample_bitmap_pixel_premult(&src_area, src_data, bitmap->width, bitmap->height, &src_pointf,
-                                                                           imageAttributes, interpolation, offset_mode);
-                        }
-                        else
-                            *dst_color = 0;
+                    span_resample(&source, (ARGB*)(dst_data + dst_stride * (y - dst_area.top)),
+                        dst_area.right - dst_area.left,
+                        dst_to_src_points[0].X + delta_yx, dst_to_src_points[0].Y + delta_yy,
+                        dst_area.left * x_dx, dst_area.left * x_dy, x_dx, x_dy);
 
-                        delta_xx += x_dx;
-                        delta_yx += y_dx;
-                    }
-
-                    delta_xy += x_dy;
+                    delta_yx += y_dx;
                     delta_yy += y_dy;
                 }
             }
@@ -4366,6 +4255,127 @@ end:
     return retval;
 }
 
+static BOOL is_antialiased(GpGraphics *graphics)
+{
+    return graphics->smoothing == SmoothingModeAntiAlias ||
+           graphics->smoothing == SmoothingModeHighQuality ||
+           graphics->smoothing > SmoothingModeAntiAlias;
+}
+
+/* Fills the path through the scanline rasterizer: the brush is rendered for
+ * the bounding box of the path, the coverage of each pixel goes into its
+ * alpha, and the result is blended like any other software drawing. */
+static GpStatus SOFTWARE_GdipFillPathAntiAlias(GpGraphics *graphics, GpBrush *brush, GpPath *path)
+{
+    GpStatus stat;
+    GpPath *flat_path;
+    GpMatrix world_to_device;
+    GpRectF graphics_bounds;
+    GpRect area;
+    REAL min_x, min_y, max_x, max_y;
+    INT *ends = NULL, figures = 0, i, y;
+    DWORD *pixel_data = NULL;
+    BYTE *mask = NULL;
+
+    stat = gdi_transform_acquire(graphics);
+    if (stat != Ok)
+        return stat;
+
+    stat = get_graphics_device_bounds(graphics, &graphics_bounds);
+
+    if (stat == Ok)
+        stat = GdipClonePath(path, &flat_path);
+
+    if (stat != Ok)
+    {
+        gdi_transform_release(graphics);
+        return stat;
+    }
+
+    stat = get_graphics_transform(graphics, WineCoordinateSpaceGdiDevice,
+        CoordinateSpaceWorld, &world_to_device);
+
+    /* Unless pixels are offset by half, their centers are on whole
+     * coordinates, while the rasterizer has them in between. */
+    if (stat == Ok && graphics->pixeloffset != PixelOffsetModeHalf &&
+        graphics->pixeloffset != PixelOffsetModeHighQuality)
+        stat = GdipTranslateMatrix(&world_to_device, 0.5, 0.5, MatrixOrderAppend);
+
+    if (stat == Ok)
+        stat = GdipFlattenPath(flat_path, &world_to_device, 0.25);
+
+    if (stat == Ok && flat_path->pathdata.Count)
+    {
+        ends = heap_alloc_zero(sizeof(*ends) * flat_path->pathdata.Count);
+        if (!ends)
+            stat = OutOfMemory;
+    }
+
+    if (stat == Ok && flat_path->pathdata.Count)
+    {
+        const GpPointF *points = flat_path->pathdata.Points;
+
+        min_x = max_x = points[0].X;
+        min_y = max_y = points[0].Y;
+
+        for (i=0; i<flat_path->pathdata.Count; i++)
+        {
+            if (i && (flat_path->pathdata.Types[i] & PathPointTypePathTypeMask) == PathPointTypeStart)
+                ends[figures++] = i;
+
+            if (points[i].X < min_x) min_x = points[i].X;
+            if (points[i].X > max_x) max_x = points[i].X;
+            if (points[i].Y < min_y) min_y = points[i].Y;
+            if (points[i].Y > max_y) max_y = points[i].Y;
+        }
+        ends[figures++] = flat_path->pathdata.Count;
+
+        if (min_x < graphics_bounds.X) min_x = graphics_bounds.X;
+        if (min_y < graphics_bounds.Y) min_y = graphics_bounds.Y;
+        if (max_x > graphics_bounds.X + graphics_bounds.Width) max_x = graphics_bounds.X + graphics_bounds.Width;
+        if (max_y > graphics_bounds.Y + graphics_bounds.Height) max_y = graphics_bounds.Y + graphics_bounds.Height;
+
+        area.X = floorf(min_x);
+        area.Y = floorf(min_y);
+        area.Width = (max_x > min_x) ? (INT)ceilf(max_x) - area.X : 0;
+        area.Height = (max_y > min_y) ? (INT)ceilf(max_y) - area.Y : 0;
+
+        if (area.Width > 0 && area.Height > 0)
+        {
+            pixel_data = heap_alloc_zero(sizeof(*pixel_data) * area.Width * area.Height);
+            mask = heap_alloc_zero(area.Width * area.Height);
+            if (!pixel_data || !mask)
+                stat = OutOfMemory;
+
+            if (stat == Ok && !raster_fill_mask(points, ends, figures,
+                    flat_path->fill == FillModeWinding, TRUE, mask,
+                    area.X, area.Y, area.Width, area.Height, area.Width))
+                stat = OutOfMemory;
+
+            if (stat == Ok)
+                stat = brush_fill_pixels(graphics, brush, pixel_data, &area, area.Width);
+
+            if (stat == Ok)
+            {
+                for (y=0; y<area.Height; y++)
+                    span_apply_coverage(pixel_data + y * area.Width, mask + y * area.Width, area.Width);
+
+                stat = alpha_blend_pixels(graphics, area.X, area.Y, (BYTE*)pixel_data,
+                    area.Width, area.Height, area.Width * 4, PixelFormat32bppARGB);
+            }
+        }
+    }
+
+    heap_free(pixel_data);
+    heap_free(mask);
+    heap_free(ends);
+    GdipDeletePath(flat_path);
+
+    gdi_transform_release(graphics);
+
+    return stat;
+}
+
 static GpStatus SOFTWARE_GdipFillPath(GpGraphics *graphics, GpBrush *brush, GpPath *path)
 {
     GpStatus stat;
@@ -4374,6 +4384,9 @@ static GpStatus SOFTWARE_GdipFillPath(GpGraphics *graphics, GpBrush *brush, GpPa
     if (!brush_can_fill_pixels(brush))
         return NotImplemented;
 
+    if (is_antialiased(graphics))
+        return SOFTWARE_GdipFillPathAntiAlias(graphics, brush, path);
+
     /* FIXME: This could probably be done more efficiently without regions. */
 
     stat = GdipCreateRegionPath(path, &rgn);
@@ -4406,7 +4419,7 @@ GpStatus WINGDIPAPI GdipFillPath(GpGraphics *graphics, GpBrush *brush, GpPath *p
     if (graphics->image && graphics->image->type == ImageTypeMetafile)
         return METAFILE_FillPath((GpMetafile*)graphics->image, brush, path);
 
-    if (!graphics->image && !graphics->alpha_hdc)
+    if (!graphics->image && !graphics->alpha_hdc && !is_antialiased(graphics))
         stat = GDI32_GdipFillPath(graphics, brush, path);
 
     if (stat == NotImplemented)
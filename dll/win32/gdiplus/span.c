@@ -0,0 +1,740 @@
+/*
+ * PROJECT:     ReactOS GDI+
+ * LICENSE:     LGPL-2.1+ (https://spdx.org/licenses/LGPL-2.1+)
+ * PURPOSE:     Scanline rasterizer and span functions of the software renderer
+ *
+ * The software renderer used to go through a region and GDI for the shape of
+ * a fill and through GdipBitmapGetPixel and GdipBitmapSetPixel for every
+ * pixel it blended. The functions here work on whole rows instead. Blending
+ * and resampling give the same pixels as the per-pixel code did; the SSE2
+ * loops are for amd64, the C loops finish the row and are all x86 gets.
+ */
+
+#ifdef GDIPLUS_HOST
+#include <typedefs.h>
+#include <math.h>
+#include <stdlib.h>
+#define heap_alloc(size)    malloc(size)
+#define heap_free(mem)      free(mem)
+#else
+#include <stdarg.h>
+#include <math.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "wingdi.h"
+
+#include "objbase.h"
+#include "wine/heap.h"
+
+#include "gdiplus.h"
+#endif
+
+#include <string.h>
+
+#include "span.h"
+
+#if defined(_M_AMD64) || defined(__x86_64__)
+#define SPAN_SSE2
+#include <emmintrin.h>
+#endif
+
+/* RASTERIZER *****************************************************************/
+
+/* Sample lines per pixel when antialiasing; each adds 256 / RASTER_SAMPLES
+ * to a pixel it covers completely */
+#define RASTER_SAMPLES      4
+
+typedef struct raster_edge
+{
+    double x, dxdy;     /* x at sample line first, change per sample line */
+    INT first, last;    /* the edge crosses sample lines first to last - 1 */
+    INT dir;            /* 1 when going down, -1 when going up */
+    INT next;           /* next edge starting at the same sample line */
+} raster_edge;
+
+typedef struct raster_crossing
+{
+    double x;
+    INT edge;
+} raster_crossing;
+
+static void raster_add_edge(raster_edge *edges, INT *count, INT *heads,
+    const GpPointF *p0, const GpPointF *p1, INT left, INT top, INT samples, INT lines)
+{
+    raster_edge *edge = &edges[*count];
+    double x0, y0, x1, y1, temp;
+    INT dir = 1;
+
+    /* Sample line s is at y = top + (s + 0.5) / samples */
+    x0 = p0->X - left;
+    y0 = (p0->Y - top) * samples - 0.5;
+    x1 = p1->X - left;
+    y1 = (p1->Y - top) * samples - 0.5;
+
+    /* Horizontal edges and NaNs don't cross anything */
+    if (!(y0 < y1) && !(y1 < y0))
+        return;
+
+    if (y0 > y1)
+    {
+        temp = x0; x0 = x1; x1 = temp;
+        temp = y0; y0 = y1; y1 = temp;
+        dir = -1;
+    }
+
+    if (y1 <= 0.0 || y0 >= lines)
+        return;
+
+    edge->first = y0 <= 0.0 ? 0 : (INT)ceil(y0);
+    edge->last = y1 >= lines ? lines : (INT)ceil(y1);
+    if (edge->first >= edge->last)
+        return;
+
+    edge->dxdy = (x1 - x0) / (y1 - y0);
+    edge->x = x0 + (edge->first - y0) * edge->dxdy;
+    edge->dir = dir;
+    edge->next = heads[edge->first];
+    heads[edge->first] = *count;
+    (*count)++;
+}
+
+/* cover holds pairs of the coverage added to a pixel and the change of the
+ * coverage carried over from the left, for width + 1 pixels */
+static void raster_add_span(INT *cover, INT width, double xl, double xr,
+    INT *row_min, INT *row_max)
+{
+    const INT weight = 256 / RASTER_SAMPLES;
+    INT fl, fr, l, r;
+
+    if (xl < 0.0) xl = 0.0;
+    if (xr > width) xr = width;
+    if (!(xl < xr))
+        return;
+
+    fl = (INT)(xl * 256.0 + 0.5);
+    fr = (INT)(xr * 256.0 + 0.5);
+    if (fl >= fr)
+        return;
+
+    l = fl >> 8;
+    r = fr >> 8;
+
+    if (l == r)
+        cover[l * 2] += ((fr - fl) * weight) >> 8;
+    else
+    {
+        cover[l * 2] += ((256 - (fl & 0xff)) * weight) >> 8;
+        cover[(l + 1) * 2 + 1] += weight;
+        cover[r * 2 + 1] -= weight;
+        cover[r * 2] += ((fr & 0xff) * weight) >> 8;
+    }
+
+    if (l < *row_min) *row_min = l;
+    if (r > *row_max) *row_max = r;
+}
+
+static void raster_resolve_row(INT *cover, INT width, BYTE *row, INT row_min, INT row_max)
+{
+    INT x, run = 0, value;
+
+    for (x = row_min; x <= row_max; x++)
+    {
+        run += cover[x * 2 + 1];
+        value = run + cover[x * 2];
+        if (x < width)
+            row[x] = value > 255 ? 255 : value;
+        cover[x * 2] = cover[x * 2 + 1] = 0;
+    }
+}
+
+static void raster_fill_span(BYTE *row, INT width, double xl, double xr)
+{
+    INT l, r;
+
+    /* Pixels whose centers are in [xl, xr) */
+    xl -= 0.5;
+    xr -= 0.5;
+    l = xl <= 0.0 ? 0 : xl >= width ? width : (INT)ceil(xl);
+    r = xr <= 0.0 ? 0 : xr >= width ? width : (INT)ceil(xr);
+
+    if (l < r)
+        memset(row + l, 0xff, r - l);
+}
+
+BOOL raster_fill_mask(const GpPointF *points, const INT *ends, INT figures,
+    BOOL winding, BOOL antialias, BYTE *mask, INT left, INT top,
+    INT width, INT height, INT stride)
+{
+    INT samples = antialias ? RASTER_SAMPLES : 1;
+    INT lines = height * samples;
+    raster_edge *edges;
+    raster_crossing *crossings;
+    INT *heads, *cover = NULL;
+    INT edge_count = 0, active_count = 0, total, start, f, i, j, y, k;
+
+    if (figures <= 0 || width <= 0 || height <= 0)
+        return TRUE;
+
+    total = ends[figures - 1];
+
+    edges = heap_alloc(total * sizeof(*edges));
+    crossings = heap_alloc(total * sizeof(*crossings));
+    heads = heap_alloc(lines * sizeof(*heads));
+    if (antialias)
+        cover = heap_alloc((width + 1) * 2 * sizeof(*cover));
+
+    if (!edges || !crossings || !heads || (antialias && !cover))
+    {
+        heap_free(edges);
+        heap_free(crossings);
+        heap_free(heads);
+        heap_free(cover);
+        return FALSE;
+    }
+
+    for (i = 0; i < lines; i++)
+        heads[i] = -1;
+    if (cover)
+        memset(cover, 0, (width + 1) * 2 * sizeof(*cover));
+
+    for (f = 0, start = 0; f < figures; start = ends[f], f++)
+        for (i = start; i < ends[f]; i++)
+            raster_add_edge(edges, &edge_count, heads, &points[i],
+                &points[i + 1 < ends[f] ? i + 1 : start], left, top, samples, lines);
+
+    for (y = 0; y < height; y++)
+    {
+        BYTE *row = mask + y * stride;
+        INT row_min = width, row_max = -1;
+
+        for (k = 0; k < samples; k++)
+        {
+            INT s = y * samples + k, n, wind;
+            double span_x = 0.0;
+
+            if (!active_count && heads[s] == -1)
+                continue;
+
+            /* The active edges are still in the order of the last line, so
+             * sorting them again is mostly a matter of checking it. */
+            n = 0;
+            for (i = 0; i < active_count; i++)
+            {
+                raster_edge *edge = &edges[crossings[i].edge];
+
+                if (edge->last > s)
+                {
+                    crossings[n].x = edge->x + (s - edge->first) * edge->dxdy;
+                    crossings[n].edge = crossings[i].edge;
+                    n++;
+                }
+            }
+            for (i = heads[s]; i != -1; i = edges[i].next)
+            {
+                crossings[n].x = edges[i].x;
+                crossings[n].edge = i;
+                n++;
+            }
+            active_count = n;
+
+            for (i = 1; i < active_count; i++)
+            {
+                raster_crossing crossing = crossings[i];
+
+                for (j = i; j > 0 && crossings[j - 1].x > crossing.x; j--)
+                    crossings[j] = crossings[j - 1];
+                crossings[j] = crossing;
+            }
+
+            wind = 0;
+            for (i = 0; i < active_count; i++)
+            {
+                BOOL was_inside = winding ? wind != 0 : (wind & 1);
+                BOOL inside;
+
+                wind += winding ? edges[crossings[i].edge].dir : 1;
+                inside = winding ? wind != 0 : (wind & 1);
+
+                if (!was_inside && inside)
+                    span_x = crossings[i].x;
+                else if (was_inside && !inside)
+                {
+                    if (antialias)
+                        raster_add_span(cover, width, span_x, crossings[i].x, &row_min, &row_max);
+                    else
+                        raster_fill_span(row, width, span_x, crossings[i].x);
+                }
+            }
+        }
+
+        if (row_min <= row_max)
+            raster_resolve_row(cover, width, row, row_min, row_max);
+    }
+
+    heap_free(edges);
+    heap_free(crossings);
+    heap_free(heads);
+    heap_free(cover);
+    return TRUE;
+}
+
+/* SPAN SHADERS ***************************************************************/
+
+void span_fill_solid(ARGB *dst, UINT count, ARGB color)
+{
+    UINT i = 0;
+
+#ifdef SPAN_SSE2
+    const __m128i c = _mm_set1_epi32(color);
+
+    for (; i + 8 <= count; i += 8)
+    {
+        _mm_storeu_si128((__m128i *)(dst + i), c);
+        _mm_storeu_si128((__m128i *)(dst + i + 4), c);
+    }
+#endif
+
+    for (; i < count; i++)
+        dst[i] = color;
+}
+
+void span_fill_hatch(ARGB *dst, UINT count, INT x, INT y,
+    const char *hatch_data, ARGB fore, ARGB back)
+{
+    char bits = hatch_data[7 - (y & 7)];
+    ARGB pattern[8];
+    UINT i = 0;
+
+    /* pattern[i] is the color of dst[i], dst[i + 8], ... */
+    for (i = 0; i < 8; i++)
+        pattern[i] = (bits & (0x80 >> ((x + i) & 7))) ? fore : back;
+
+    i = 0;
+
+#ifdef SPAN_SSE2
+    {
+        const __m128i lo = _mm_loadu_si128((const __m128i *)pattern);
+        const __m128i hi = _mm_loadu_si128((const __m128i *)(pattern + 4));
+
+        for (; i + 8 <= count; i += 8)
+        {
+            _mm_storeu_si128((__m128i *)(dst + i), lo);
+            _mm_storeu_si128((__m128i *)(dst + i + 4), hi);
+        }
+    }
+#endif
+
+    for (; i < count; i++)
+        dst[i] = pattern[i & 7];
+}
+
+static inline BYTE mul_div255(UINT a, UINT b)
+{
+    UINT t = a * b + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+void span_apply_coverage(ARGB *pixels, const BYTE *coverage, UINT count)
+{
+    UINT i = 0;
+
+#ifdef SPAN_SSE2
+    const __m128i zero = _mm_setzero_si128(), rgb = _mm_set1_epi32(0x00ffffff);
+    const __m128i round = _mm_set1_epi32(128);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i p = _mm_loadu_si128((const __m128i *)(pixels + i));
+        __m128i c, t;
+        UINT cov;
+
+        memcpy(&cov, coverage + i, sizeof(cov));
+        if (cov == 0xffffffff)
+            continue;
+
+        c = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(cov), zero), zero);
+
+        /* Both factors are 8 bit, so the products fit 16 bit lanes */
+        t = _mm_add_epi32(_mm_mullo_epi16(_mm_srli_epi32(p, 24), c), round);
+        t = _mm_srli_epi32(_mm_add_epi32(t, _mm_srli_epi32(t, 8)), 8);
+
+        p = _mm_or_si128(_mm_and_si128(p, rgb), _mm_slli_epi32(t, 24));
+        _mm_storeu_si128((__m128i *)(pixels + i), p);
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        if (coverage[i] != 255)
+            pixels[i] = (pixels[i] & 0x00ffffff) |
+                ((ARGB)mul_div255(pixels[i] >> 24, coverage[i]) << 24);
+    }
+}
+
+/* BLENDING *******************************************************************/
+
+/* What GdipBitmapGetPixel returns for a pixel */
+static inline ARGB read_pixel(const BYTE *dst, span_format format)
+{
+    DWORD pixel = *(const DWORD *)dst;
+    BYTE a, r, g, b;
+
+    switch (format)
+    {
+    case SPAN_FORMAT_RGB:
+        return 0xff000000 | pixel;
+    case SPAN_FORMAT_ARGB:
+        return pixel;
+    default:
+        a = pixel >> 24;
+        if (a == 0)
+            return 0;
+        r = ((pixel >> 16) & 0xff) * 255 / a;
+        g = ((pixel >> 8) & 0xff) * 255 / a;
+        b = (pixel & 0xff) * 255 / a;
+        return (a << 24) | (r << 16) | (g << 8) | b;
+    }
+}
+
+/* What GdipBitmapSetPixel stores for a color */
+static inline void write_pixel(BYTE *dst, span_format format, ARGB color)
+{
+    BYTE a, r, g, b;
+
+    switch (format)
+    {
+    case SPAN_FORMAT_RGB:
+        *(DWORD *)dst = color & 0x00ffffff;
+        break;
+    case SPAN_FORMAT_ARGB:
+        *(DWORD *)dst = color;
+        break;
+    default:
+        a = color >> 24;
+        r = ((color >> 16) & 0xff) * a / 255;
+        g = ((color >> 8) & 0xff) * a / 255;
+        b = (color & 0xff) * a / 255;
+        *(DWORD *)dst = (a << 24) | (r << 16) | (g << 8) | b;
+        break;
+    }
+}
+
+static inline void blend_pixel(BYTE *dst, span_format format, ARGB src, BOOL src_premult)
+{
+    if (!(src & 0xff000000))
+        return;
+
+    if (src_premult)
+        write_pixel(dst, format, color_over_fgpremult(read_pixel(dst, format), src));
+    else
+        write_pixel(dst, format, color_over(read_pixel(dst, format), src));
+}
+
+void span_blend_row(BYTE *dst, span_format format, const ARGB *src,
+    UINT count, BOOL src_premult)
+{
+    UINT i = 0;
+
+#ifdef SPAN_SSE2
+    /* Both kinds of over give the source for opaque pixels, and those get
+     * written back unchanged except for losing their alpha in RGB rows. */
+    const __m128i alpha = _mm_set1_epi32(0xff000000), zero = _mm_setzero_si128();
+    const __m128i keep = _mm_set1_epi32(format == SPAN_FORMAT_RGB ? 0x00ffffff : 0xffffffff);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i a = _mm_and_si128(s, alpha);
+        UINT k;
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, alpha)) == 0xffff)
+            _mm_storeu_si128((__m128i *)(dst + i * 4), _mm_and_si128(s, keep));
+        else if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, zero)) != 0xffff)
+        {
+            for (k = i; k < i + 4; k++)
+                blend_pixel(dst + k * 4, format, src[k], src_premult);
+        }
+    }
+#endif
+
+    for (; i < count; i++)
+        blend_pixel(dst + i * 4, format, src[i], src_premult);
+}
+
+/* RESAMPLING *****************************************************************/
+
+static inline INT wrap_coordinate(INT v, INT size, BOOL flip)
+{
+    if (flip)
+    {
+        v %= size * 2;
+        if (v < 0)
+            v += size * 2;
+        if (v >= size)
+            v = size * 2 - 1 - v;
+    }
+    else
+    {
+        v %= size;
+        if (v < 0)
+            v += size;
+    }
+
+    return v;
+}
+
+static inline ARGB sample_pixel(const span_source *src, INT x, INT y)
+{
+    if (src->clamp)
+    {
+        if (x < 0 || y < 0 || x >= src->bitmap_width || y >= src->bitmap_height)
+            return src->outside_color;
+    }
+    else
+    {
+        x = wrap_coordinate(x, src->bitmap_width, src->flip_x);
+        y = wrap_coordinate(y, src->bitmap_height, src->flip_y);
+    }
+
+    /* The caller didn't read enough of the bitmap, make it show */
+    if (x < src->x || y < src->y || x >= src->x + src->width || y >= src->y + src->height)
+        return 0xffcd0084;
+
+    return src->bits[(x - src->x) + (y - src->y) * src->width];
+}
+
+static inline int positive_ceilf(float f)
+{
+    return f - (int)f > 0.0f ? f + 1.0f : f;
+}
+
+#ifdef SPAN_SSE2
+/* blend_colors_premult across and then down, for pos up to 255 */
+static inline ARGB bilinear_premult_sse2(ARGB tl, ARGB tr, ARGB bl, ARGB br, UINT px, UINT py)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i top = _mm_unpacklo_epi8(_mm_set_epi32(0, 0, tr, tl), zero);
+    __m128i bottom = _mm_unpacklo_epi8(_mm_set_epi32(0, 0, br, bl), zero);
+    __m128i wx = _mm_set_epi16(px, px, px, px, 256 - px, 256 - px, 256 - px, 256 - px);
+    __m128i wy = _mm_set_epi16(py, py, py, py, 256 - py, 256 - py, 256 - py, 256 - py);
+    __m128i v;
+
+    /* start * (256 - pos) + end * pos is at most 255 * 256 */
+    top = _mm_mullo_epi16(top, wx);
+    bottom = _mm_mullo_epi16(bottom, wx);
+    top = _mm_srli_epi16(_mm_add_epi16(top, _mm_srli_si128(top, 8)), 8);
+    bottom = _mm_srli_epi16(_mm_add_epi16(bottom, _mm_srli_si128(bottom, 8)), 8);
+
+    v = _mm_mullo_epi16(_mm_unpacklo_epi64(top, bottom), wy);
+    v = _mm_srli_epi16(_mm_add_epi16(v, _mm_srli_si128(v, 8)), 8);
+
+    return _mm_cvtsi128_si32(_mm_packus_epi16(v, zero));
+}
+#endif
+
+static ARGB resample_bilinear(const span_source *src, REAL x, REAL y)
+{
+    REAL leftxf, topyf, x_offset, y_offset;
+    INT leftx, rightx, topy, bottomy;
+    ARGB topleft, topright, bottomleft, bottomright;
+    ARGB top, bottom;
+
+    leftx = (INT)x;
+    leftxf = (REAL)leftx;
+    rightx = positive_ceilf(x);
+    topy = (INT)y;
+    topyf = (REAL)topy;
+    bottomy = positive_ceilf(y);
+
+    x_offset = x - leftxf;
+    y_offset = y - topyf;
+
+    if (x >= 0.0f && y >= 0.0f &&
+        leftx >= src->x && rightx < src->x + src->width &&
+        topy >= src->y && bottomy < src->y + src->height)
+    {
+        const ARGB *row = src->bits + (leftx - src->x) + (topy - src->y) * src->width;
+
+        topleft = row[0];
+        if (leftx == rightx && topy == bottomy)
+            return topleft;
+
+        topright = row[rightx - leftx];
+        bottomleft = row[(bottomy - topy) * src->width];
+        bottomright = row[(bottomy - topy) * src->width + rightx - leftx];
+
+#ifdef SPAN_SSE2
+        if (src->premult)
+        {
+            UINT px = x_offset * 255.0f + 0.5f;
+            UINT py = y_offset * 255.0f + 0.5f;
+
+            return bilinear_premult_sse2(topleft, topright, bottomleft, bottomright, px, py);
+        }
+#endif
+    }
+    else
+    {
+        if (leftx == rightx && topy == bottomy)
+            return sample_pixel(src, leftx, topy);
+
+        topleft = sample_pixel(src, leftx, topy);
+        topright = sample_pixel(src, rightx, topy);
+        bottomleft = sample_pixel(src, leftx, bottomy);
+        bottomright = sample_pixel(src, rightx, bottomy);
+    }
+
+    if (src->premult)
+    {
+        top = blend_colors_premult(topleft, topright, x_offset);
+        bottom = blend_colors_premult(bottomleft, bottomright, x_offset);
+        return blend_colors_premult(top, bottom, y_offset);
+    }
+
+    top = blend_colors(topleft, topright, x_offset);
+    bottom = blend_colors(bottomleft, bottomright, x_offset);
+    return blend_colors(top, bottom, y_offset);
+}
+
+static void cubic_weights(REAL t, REAL *w)
+{
+    REAL t2 = t * t, t3 = t2 * t;
+
+    /* Catmull-Rom, the cubic with a = -0.5 */
+    w[0] = -0.5f * t3 + t2 - 0.5f * t;
+    w[1] = 1.5f * t3 - 2.5f * t2 + 1.0f;
+    w[2] = -1.5f * t3 + 2.0f * t2 + 0.5f * t;
+    w[3] = 0.5f * t3 - 0.5f * t2;
+}
+
+static ARGB resample_bicubic(const span_source *src, REAL x, REAL y)
+{
+    REAL wx[4], wy[4], sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    INT left, top, i, j, k, c[4];
+    BOOL inside;
+
+    left = (INT)floorf(x);
+    top = (INT)floorf(y);
+    cubic_weights(x - left, wx);
+    cubic_weights(y - top, wy);
+
+    inside = left - 1 >= src->x && left + 2 < src->x + src->width &&
+             top - 1 >= src->y && top + 2 < src->y + src->height;
+
+    /* Filter premultiplied colors so transparent pixels don't bleed */
+    for (j = 0; j < 4; j++)
+    {
+        REAL row[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+        for (i = 0; i < 4; i++)
+        {
+            ARGB pixel;
+            REAL alpha, factor;
+
+            if (inside)
+                pixel = src->bits[(left - 1 + i - src->x) + (top - 1 + j - src->y) * src->width];
+            else
+                pixel = sample_pixel(src, left - 1 + i, top - 1 + j);
+
+            alpha = (REAL)(pixel >> 24);
+            factor = src->premult ? 1.0f : alpha * (1.0f / 255.0f);
+
+            row[0] += wx[i] * ((REAL)(pixel & 0xff) * factor);
+            row[1] += wx[i] * ((REAL)((pixel >> 8) & 0xff) * factor);
+            row[2] += wx[i] * ((REAL)((pixel >> 16) & 0xff) * factor);
+            row[3] += wx[i] * alpha;
+        }
+
+        for (k = 0; k < 4; k++)
+            sum[k] += wy[j] * row[k];
+    }
+
+    if (sum[3] < 0.0f) sum[3] = 0.0f;
+    if (sum[3] > 255.0f) sum[3] = 255.0f;
+    for (k = 0; k < 4; k++)
+    {
+        if (sum[k] < 0.0f) sum[k] = 0.0f;
+        if (sum[k] > sum[3]) sum[k] = sum[3];
+        c[k] = (INT)(sum[k] + 0.5f);
+    }
+
+    if (!src->premult)
+    {
+        if (!c[3])
+            return 0;
+        for (k = 0; k < 3; k++)
+            c[k] = c[k] * 255 / c[3];
+    }
+
+    return (c[3] << 24) | (c[2] << 16) | (c[1] << 8) | c[0];
+}
+
+static inline BOOL point_outside(const span_source *src, REAL x, REAL y)
+{
+    return src->bounded &&
+        !(x >= src->min_x && x < src->max_x && y >= src->min_y && y < src->max_y);
+}
+
+static void resample_nearest(const span_source *src, ARGB *dst, UINT count,
+    REAL x, REAL y, REAL offset_x, REAL offset_y, REAL dx, REAL dy)
+{
+    /* Loaded once, the stores to dst could alias them otherwise */
+    const ARGB *bits = src->bits;
+    const INT left = src->x, top = src->y;
+    const UINT width = src->width, height = src->height;
+    const REAL pixel_offset = src->pixel_offset;
+    UINT i;
+
+    for (i = 0; i < count; i++, offset_x += dx, offset_y += dy)
+    {
+        REAL px = x + offset_x, py = y + offset_y;
+        INT ix, iy;
+
+        if (point_outside(src, px, py))
+        {
+            dst[i] = 0;
+            continue;
+        }
+
+        ix = (INT)floorf(px + pixel_offset) - left;
+        iy = (INT)floorf(py + pixel_offset) - top;
+
+        /* The read area lies inside the bitmap, so no clamping or tiling */
+        if ((UINT)ix < width && (UINT)iy < height)
+            dst[i] = bits[ix + iy * width];
+        else
+            dst[i] = sample_pixel(src, ix + left, iy + top);
+    }
+}
+
+void span_resample(const span_source *src, ARGB *dst, UINT count,
+    REAL x, REAL y, REAL offset_x, REAL offset_y, REAL dx, REAL dy)
+{
+    UINT i;
+
+    switch (src->filter)
+    {
+    case SPAN_FILTER_NEAREST:
+        resample_nearest(src, dst, count, x, y, offset_x, offset_y, dx, dy);
+        break;
+
+    case SPAN_FILTER_BILINEAR:
+        for (i = 0; i < count; i++, offset_x += dx, offset_y += dy)
+        {
+            REAL px = x + offset_x, py = y + offset_y;
+
+            dst[i] = point_outside(src, px, py) ? 0 : resample_bilinear(src, px, py);
+        }
+        break;
+
+    case SPAN_FILTER_BICUBIC:
+        for (i = 0; i < count; i++, offset_x += dx, offset_y += dy)
+        {
+            REAL px = x + offset_x, py = y + offset_y;
+
+            dst[i] = point_outside(src, px, py) ? 0 : resample_bicubic(src, px, py);
+        }
+        break;
+    }
+}
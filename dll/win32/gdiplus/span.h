@@ -0,0 +1,175 @@
+/*
+ * PROJECT:     ReactOS GDI+
+ * LICENSE:     LGPL-2.1+ (https://spdx.org/licenses/LGPL-2.1+)
+ * PURPOSE:     Scanline rasterizer and span functions of the software renderer
+ */
+
+#ifndef GDIPLUS_SPAN_H
+#define GDIPLUS_SPAN_H
+
+#ifdef GDIPLUS_HOST
+typedef float REAL;
+typedef DWORD ARGB;
+
+typedef struct
+{
+    REAL X;
+    REAL Y;
+} GpPointF;
+#endif
+
+/* Color blending *************************************************************/
+
+static inline ARGB color_over(ARGB bg, ARGB fg)
+{
+    BYTE b, g, r, a;
+    BYTE bg_alpha, fg_alpha;
+
+    fg_alpha = (fg>>24)&0xff;
+
+    if (fg_alpha == 0xff) return fg;
+
+    if (fg_alpha == 0) return bg;
+
+    bg_alpha = (((bg>>24)&0xff) * (0xff-fg_alpha)) / 0xff;
+
+    if (bg_alpha == 0) return fg;
+
+    a = bg_alpha + fg_alpha;
+    b = ((bg&0xff)*bg_alpha + (fg&0xff)*fg_alpha)/a;
+    g = (((bg>>8)&0xff)*bg_alpha + ((fg>>8)&0xff)*fg_alpha)/a;
+    r = (((bg>>16)&0xff)*bg_alpha + ((fg>>16)&0xff)*fg_alpha)/a;
+
+    return (a<<24)|(r<<16)|(g<<8)|b;
+}
+
+/* fg is premultiplied, bg and return value are not */
+static inline ARGB color_over_fgpremult(ARGB bg, ARGB fg)
+{
+    BYTE b, g, r, a;
+    BYTE bg_alpha, fg_alpha;
+
+    fg_alpha = (fg>>24)&0xff;
+
+    if (fg_alpha == 0) return bg;
+
+    bg_alpha = (((bg>>24)&0xff) * (0xff-fg_alpha)) / 0xff;
+
+    a = bg_alpha + fg_alpha;
+    b = ((bg&0xff)*bg_alpha + (fg&0xff)*0xff)/a;
+    g = (((bg>>8)&0xff)*bg_alpha + ((fg>>8)&0xff)*0xff)/a;
+    r = (((bg>>16)&0xff)*bg_alpha + ((fg>>16)&0xff)*0xff)/a;
+
+    return (a<<24)|(r<<16)|(g<<8)|b;
+}
+
+/* NOTE: start and end pixels must be in pre-multiplied ARGB format */
+static inline ARGB blend_colors_premult(ARGB start, ARGB end, REAL position)
+{
+    UINT pos = position * 255.0f + 0.5f;
+    return
+        (((((start >> 24)       ) << 8) + (((end >> 24)       ) - ((start >> 24)       )) * pos) >> 8) << 24 |
+        (((((start >> 16) & 0xff) << 8) + (((end >> 16) & 0xff) - ((start >> 16) & 0xff)) * pos) >> 8) << 16 |
+        (((((start >>  8) & 0xff) << 8) + (((end >>  8) & 0xff) - ((start >>  8) & 0xff)) * pos) >> 8) <<  8 |
+        (((((start      ) & 0xff) << 8) + (((end      ) & 0xff) - ((start      ) & 0xff)) * pos) >> 8);
+}
+
+/* pos goes from 0 (start) to 255 (end) */
+static inline ARGB blend_colors_pos(ARGB start, ARGB end, INT pos)
+{
+    INT start_a, end_a, final_a;
+
+    start_a = ((start >> 24) & 0xff) * (pos ^ 0xff);
+    end_a = ((end >> 24) & 0xff) * pos;
+
+    final_a = start_a + end_a;
+
+    if (final_a < 0xff) return 0;
+
+    return (final_a / 0xff) << 24 |
+        ((((start >> 16) & 0xff) * start_a + (((end >> 16) & 0xff) * end_a)) / final_a) << 16 |
+        ((((start >> 8) & 0xff) * start_a + (((end >> 8) & 0xff) * end_a)) / final_a) << 8 |
+        (((start & 0xff) * start_a + ((end & 0xff) * end_a)) / final_a);
+}
+
+static inline ARGB blend_colors(ARGB start, ARGB end, REAL position)
+{
+    return blend_colors_pos(start, end, (INT)(position * 255.0f + 0.5f));
+}
+
+/* Rasterizer *****************************************************************/
+
+/* Renders polygons into a coverage mask of width x height bytes whose top left
+ * pixel is at (left, top). Figure i ends before point ends[i] and is closed
+ * implicitly. Pixel (x, y) covers the square from (x, y) to (x + 1, y + 1).
+ * Without antialiasing a pixel is 255 when its center is inside and 0 when it
+ * isn't, with it the coverage is exact horizontally and sampled at 4 lines
+ * per pixel vertically. The mask has to be zeroed by the caller. Returns FALSE
+ * when out of memory. */
+BOOL raster_fill_mask(const GpPointF *points, const INT *ends, INT figures,
+    BOOL winding, BOOL antialias, BYTE *mask, INT left, INT top,
+    INT width, INT height, INT stride);
+
+/* Span shaders ***************************************************************/
+
+void span_fill_solid(ARGB *dst, UINT count, ARGB color);
+
+/* hatch_data is the 8x8 pattern of the hatch style, x and y are the device
+ * position of dst[0] */
+void span_fill_hatch(ARGB *dst, UINT count, INT x, INT y,
+    const char *hatch_data, ARGB fore, ARGB back);
+
+/* Scales the alpha of straight ARGB pixels by coverage / 255, rounded */
+void span_apply_coverage(ARGB *pixels, const BYTE *coverage, UINT count);
+
+/* Blending into bitmaps ******************************************************/
+
+typedef enum span_format
+{
+    SPAN_FORMAT_RGB,
+    SPAN_FORMAT_ARGB,
+    SPAN_FORMAT_PARGB
+} span_format;
+
+/* Blends count pixels of src over a 32bpp row with the same result as
+ * reading every pixel with GdipBitmapGetPixel, combining it with
+ * color_over (color_over_fgpremult when src_premult is set) and writing it
+ * back with GdipBitmapSetPixel. Transparent source pixels are skipped. */
+void span_blend_row(BYTE *dst, span_format format, const ARGB *src,
+    UINT count, BOOL src_premult);
+
+/* Resampling *****************************************************************/
+
+typedef enum span_filter
+{
+    SPAN_FILTER_NEAREST,
+    SPAN_FILTER_BILINEAR,
+    SPAN_FILTER_BICUBIC
+} span_filter;
+
+/* 32bpp pixels of the rectangle (x, y, width, height) of a bitmap of
+ * bitmap_width x bitmap_height, width pixels apart. Samples outside the
+ * bitmap are outside_color when clamp is set and tile, flipped or not,
+ * otherwise. When bounded is set, sample points outside of (min_x, min_y) -
+ * (max_x, max_y) give 0. */
+typedef struct span_source
+{
+    const ARGB *bits;
+    INT x, y, width, height;
+    INT bitmap_width, bitmap_height;
+    BOOL clamp, flip_x, flip_y;
+    ARGB outside_color;
+    BOOL premult;
+    span_filter filter;
+    REAL pixel_offset;
+    BOOL bounded;
+    REAL min_x, min_y, max_x, max_y;
+} span_source;
+
+/* Samples count points into dst, point i being
+ * (x + offset_x + i * dx, y + offset_y + i * dy) with the offsets added up
+ * one step at a time. Results are premultiplied if the source is. */
+void span_resample(const span_source *src, ARGB *dst, UINT count,
+    REAL x, REAL y, REAL offset_x, REAL offset_y, REAL dx, REAL dy);
+
+#endif /* GDIPLUS_SPAN_H */
@@ -224,6 +224,16 @@ static unsigned push_instr(compiler_ctx_t *ctx, jsop_t op)
     }
 
     ctx->code->instrs[ctx->code_off].op = op;
+    switch(op) {
+    case OP_ident:
+    case OP_identid:
+    case OP_member:
+    case OP_member_ref:
+        ctx->code->instrs[ctx->code_off].cache = ctx->code->cache_cnt++;
+        break;
+    default:
+        ctx->code->instrs[ctx->code_off].cache = 0;
+    }
     return ctx->code_off++;
 }
 
@@ -485,22 +495,12 @@ static HRESULT compile_memberid_expression(compiler_ctx_t *ctx, expression_t *ex
     }
     case EXPR_MEMBER: {
         member_expression_t *member_expr = (member_expression_t*)expr;
-        jsstr_t *jsstr;
 
         hres = compile_expression(ctx, member_expr->expression, TRUE);
         if(FAILED(hres))
             return hres;
 
-        /* FIXME: Potential optimization */
-        jsstr = compiler_alloc_string(ctx, member_expr->identifier);
-        if(!jsstr)
-            return E_OUTOFMEMORY;
-
-        hres = push_instr_str(ctx, OP_str, jsstr);
-        if(FAILED(hres))
-            return hres;
-
-        hres = push_instr_uint(ctx, OP_memberid, flags);
+        hres = push_instr_bstr_uint(ctx, OP_member_ref, member_expr->identifier, flags);
         break;
     }
     DEFAULT_UNREACHABLE;
@@ -2239,6 +2239,11 @@ void release_bytecode(bytecode_t *code)
     heap_pool_free(&code->heap);
     heap_free(code->bstr_pool);
     heap_free(code->str_pool);
+    if(code->caches) {
+        for(i=0; i < code->cache_cnt; i++)
+            prop_cache_release(code->caches+i);
+        heap_free(code->caches);
+    }
     heap_free(code->instrs);
     heap_free(code);
 }
@@ -2492,6 +2497,11 @@ HRESULT compile_script(script_ctx_t *ctx, const WCHAR *code, const WCHAR *args,
     hres = compile_function(&compiler, compiler.parser->source, NULL, from_eval, &compiler.code->global_code);
     heap_pool_free(&compiler.heap);
     parser_release(compiler.parser);
+    if(SUCCEEDED(hres) && compiler.code->cache_cnt) {
+        compiler.code->caches = heap_alloc_zero(compiler.code->cache_cnt * sizeof(*compiler.code->caches));
+        if(!compiler.code->caches)
+            hres = E_OUTOFMEMORY;
+    }
     if(FAILED(hres)) {
         release_bytecode(compiler.code);
         return hres;
@@ -130,6 +130,109 @@ static inline unsigned get_props_idx(jsdisp_t *This, unsigned hash)
     return (hash*GOLDEN_RATIO) & (This->buf_size-1);
 }
 
+/*
+ * A shape stands for the list of property names an object got, in order.
+ * Properties are never removed from the table (deleting only changes their
+ * type), so two objects with the same shape have every name at the same
+ * DISPID. Shapes form a tree: each name added to an object moves it to a
+ * child of its current shape. Parents don't hold references to children,
+ * a child unlinks itself when it's freed.
+ */
+#define SHAPE_MAX_DEPTH    64
+#define SHAPE_MAX_CHILDREN 64
+
+struct _shape_t {
+    LONG ref;
+    unsigned depth;
+    unsigned hash;
+    WCHAR *name;
+    shape_t *parent;
+    shape_t *children;
+    shape_t *next_sibling;
+    unsigned child_cnt;
+};
+
+static inline shape_t *shape_addref(shape_t *shape)
+{
+    shape->ref++;
+    return shape;
+}
+
+void shape_release(shape_t *shape)
+{
+    shape_t *parent, **iter;
+
+    while(shape && !--shape->ref) {
+        parent = shape->parent;
+        if(parent) {
+            for(iter = &parent->children; *iter != shape; iter = &(*iter)->next_sibling);
+            *iter = shape->next_sibling;
+            parent->child_cnt--;
+        }
+
+        heap_free(shape->name);
+        heap_free(shape);
+        shape = parent;
+    }
+}
+
+/* Root shape has only the value property at DISPID 0 */
+static shape_t *get_root_shape(script_ctx_t *ctx)
+{
+    if(!ctx->root_shape) {
+        ctx->root_shape = heap_alloc_zero(sizeof(shape_t));
+        if(!ctx->root_shape)
+            return NULL;
+
+        ctx->root_shape->ref = 1;
+        ctx->root_shape->depth = 1;
+    }
+
+    return shape_addref(ctx->root_shape);
+}
+
+/* Returns NULL for objects that grew too large to be worth tracking */
+static shape_t *shape_add_prop(shape_t *shape, const WCHAR *name, unsigned hash)
+{
+    shape_t *child, **iter;
+
+    if(shape->depth >= SHAPE_MAX_DEPTH)
+        return NULL;
+
+    for(iter = &shape->children; (child = *iter); iter = &child->next_sibling) {
+        if(child->hash == hash && !wcscmp(child->name, name)) {
+            *iter = child->next_sibling;
+            child->next_sibling = shape->children;
+            shape->children = child;
+            return shape_addref(child);
+        }
+    }
+
+    if(shape->child_cnt >= SHAPE_MAX_CHILDREN)
+        return NULL;
+
+    child = heap_alloc(sizeof(*child));
+    if(!child)
+        return NULL;
+
+    child->name = heap_strdupW(name);
+    if(!child->name) {
+        heap_free(child);
+        return NULL;
+    }
+
+    child->ref = 1;
+    child->depth = shape->depth+1;
+    child->hash = hash;
+    child->parent = shape_addref(shape);
+    child->children = NULL;
+    child->next_sibling = shape->children;
+    child->child_cnt = 0;
+    shape->children = child;
+    shape->child_cnt++;
+    return child;
+}
+
 static inline HRESULT resize_props(jsdisp_t *This)
 {
     dispex_prop_t *props;
@@ -179,6 +282,12 @@ static inline dispex_prop_t* alloc_prop(jsdisp_t *This, const WCHAR *name, prop_
     bucket = get_props_idx(This, prop->hash);
     prop->bucket_next = This->props[bucket].bucket_head;
     This->props[bucket].bucket_head = This->prop_cnt++;
+
+    if(This->shape) {
+        shape_t *shape = shape_add_prop(This->shape, name, prop->hash);
+        shape_release(This->shape);
+        This->shape = shape;
+    }
     return prop;
 }
 
@@ -940,6 +1049,8 @@ HRESULT init_dispex(jsdisp_t *dispex, script_ctx_t *ctx, const builtin_info_t *b
         dispex->props[0].type = PROP_DELETED;
     }
 
+    dispex->shape = get_root_shape(ctx);
+
     script_addref(ctx);
     dispex->ctx = ctx;
 
@@ -996,6 +1107,7 @@ void jsdisp_free(jsdisp_t *obj)
         heap_free(prop->name);
     }
     heap_free(obj->props);
+    shape_release(obj->shape);
     script_release(obj->ctx);
     if(obj->prototype)
         jsdisp_release(obj->prototype);
@@ -1086,6 +1198,59 @@ HRESULT jsdisp_get_id(jsdisp_t *jsdisp, const WCHAR *name, DWORD flags, DISPID *
     return DISP_E_UNKNOWNNAME;
 }
 
+/*
+ * Same as jsdisp_get_id, but first tries the DISPIDs the cache found for other
+ * objects of the same shape. A hit needs the property to still exist, deleted
+ * properties take the slow path which may bring them back from the prototype.
+ */
+HRESULT jsdisp_get_id_cached(jsdisp_t *jsdisp, const WCHAR *name, DWORD flags, prop_cache_t *cache, DISPID *id)
+{
+    unsigned i;
+    HRESULT hres;
+
+    if(!cache)
+        return jsdisp_get_id(jsdisp, name, flags, id);
+
+    if(jsdisp->shape) {
+        for(i = 0; i < PROP_CACHE_SIZE; i++) {
+            if(cache->entries[i].shape != jsdisp->shape)
+                continue;
+
+            if(jsdisp->props[cache->entries[i].id].type == PROP_DELETED)
+                break;
+
+            *id = cache->entries[i].id;
+            return S_OK;
+        }
+    }
+
+    hres = jsdisp_get_id(jsdisp, name, flags, id);
+    if(FAILED(hres) || !jsdisp->shape)
+        return hres;
+
+    /* The lookup may have added properties, so use the shape we have now. */
+    for(i = 0; i < PROP_CACHE_SIZE; i++) {
+        if(cache->entries[i].shape == jsdisp->shape)
+            break;
+    }
+    if(i == PROP_CACHE_SIZE) {
+        i = cache->next;
+        cache->next = (i+1) % PROP_CACHE_SIZE;
+        shape_release(cache->entries[i].shape);
+        cache->entries[i].shape = shape_addref(jsdisp->shape);
+    }
+    cache->entries[i].id = *id;
+    return hres;
+}
+
+void prop_cache_release(prop_cache_t *cache)
+{
+    unsigned i;
+
+    for(i = 0; i < PROP_CACHE_SIZE; i++)
+        shape_release(cache->entries[i].shape);
+}
+
 HRESULT jsdisp_call_value(jsdisp_t *jsfunc, IDispatch *jsthis, WORD flags, unsigned argc, jsval_t *argv, jsval_t *r)
 {
     HRESULT hres;
@@ -632,7 +632,7 @@ local_ref_t *lookup_local(const function_code_t *function, const WCHAR *identifi
 }
 
 /* ECMA-262 3rd Edition    10.1.4 */
-static HRESULT identifier_eval(script_ctx_t *ctx, BSTR identifier, exprval_t *ret)
+static HRESULT identifier_eval(script_ctx_t *ctx, BSTR identifier, prop_cache_t *cache, exprval_t *ret)
 {
     scope_chain_t *scope;
     named_item_t *item;
@@ -662,7 +662,7 @@ static HRESULT identifier_eval(script_ctx_t *ctx, BSTR identifier, exprval_t *re
                 }
             }
             if(scope->jsobj)
-                hres = jsdisp_get_id(scope->jsobj, identifier, fdexNameImplicit, &id);
+                hres = jsdisp_get_id_cached(scope->jsobj, identifier, fdexNameImplicit, cache, &id);
             else
                 hres = disp_get_id(ctx, scope->obj, identifier, identifier, fdexNameImplicit, &id);
             if(SUCCEEDED(hres)) {
@@ -672,7 +672,7 @@ static HRESULT identifier_eval(script_ctx_t *ctx, BSTR identifier, exprval_t *re
         }
     }
 
-    hres = jsdisp_get_id(ctx->global, identifier, 0, &id);
+    hres = jsdisp_get_id_cached(ctx->global, identifier, 0, cache, &id);
     if(SUCCEEDED(hres)) {
         exprval_set_disp_ref(ret, to_disp(ctx->global), id);
         return S_OK;
@@ -745,6 +745,12 @@ static inline double get_op_double(script_ctx_t *ctx)
     return frame->bytecode->instrs[frame->ip].u.dbl;
 }
 
+static inline prop_cache_t *get_op_cache(script_ctx_t *ctx)
+{
+    call_frame_t *frame = ctx->call_ctx;
+    return frame->bytecode->caches + frame->bytecode->instrs[frame->ip].cache;
+}
+
 static inline void jmp_next(script_ctx_t *ctx)
 {
     ctx->call_ctx->ip++;
@@ -1063,6 +1069,18 @@ static HRESULT interp_array(script_ctx_t *ctx)
     return stack_push(ctx, v);
 }
 
+/* Looks up a name used by the current instruction, using its inline cache for our own objects. */
+static HRESULT member_get_id(script_ctx_t *ctx, IDispatch *disp, BSTR name, DWORD flags, DISPID *id)
+{
+    jsdisp_t *jsdisp;
+
+    jsdisp = to_jsdisp(disp);
+    if(jsdisp)
+        return jsdisp_get_id_cached(jsdisp, name, flags, get_op_cache(ctx), id);
+
+    return disp_get_id(ctx, disp, name, name, flags, id);
+}
+
 /* ECMA-262 3rd Edition    11.2.1 */
 static HRESULT interp_member(script_ctx_t *ctx)
 {
@@ -1078,7 +1096,7 @@ static HRESULT interp_member(script_ctx_t *ctx)
     if(FAILED(hres))
         return hres;
 
-    hres = disp_get_id(ctx, obj, arg, arg, 0, &id);
+    hres = member_get_id(ctx, obj, arg, 0, &id);
     if(SUCCEEDED(hres)) {
         hres = disp_propget(ctx, obj, id, &v);
     }else if(hres == DISP_E_UNKNOWNNAME) {
@@ -1140,6 +1158,44 @@ static HRESULT interp_memberid(script_ctx_t *ctx)
     return stack_push_exprval(ctx, &ref);
 }
 
+/* ECMA-262 3rd Edition    11.2.1 */
+static HRESULT interp_member_ref(script_ctx_t *ctx)
+{
+    const BSTR arg = get_op_bstr(ctx, 0);
+    const unsigned flags = get_op_uint(ctx, 1);
+    IDispatch *obj;
+    exprval_t ref;
+    jsval_t objv;
+    DISPID id;
+    HRESULT hres;
+
+    TRACE("%s %x\n", debugstr_w(arg), flags);
+
+    objv = stack_pop(ctx);
+    hres = to_object(ctx, objv, &obj);
+    jsval_release(objv);
+    if(FAILED(hres))
+        return hres;
+
+    hres = member_get_id(ctx, obj, arg, flags, &id);
+    if(SUCCEEDED(hres)) {
+        ref.type = EXPRVAL_IDREF;
+        ref.u.idref.disp = obj;
+        ref.u.idref.id = id;
+    }else {
+        IDispatch_Release(obj);
+        if(hres == DISP_E_UNKNOWNNAME && !(flags & fdexNameEnsure)) {
+            exprval_set_exception(&ref, JS_E_INVALID_PROPERTY);
+            hres = S_OK;
+        }else {
+            ERR("failed %08x\n", hres);
+            return hres;
+        }
+    }
+
+    return stack_push_exprval(ctx, &ref);
+}
+
 /* ECMA-262 3rd Edition    11.2.1 */
 static HRESULT interp_refval(script_ctx_t *ctx)
 {
@@ -1229,19 +1285,19 @@ static HRESULT interp_this(script_ctx_t *ctx)
     return stack_push(ctx, jsval_disp(frame->this_obj));
 }
 
-static HRESULT interp_identifier_ref(script_ctx_t *ctx, BSTR identifier, unsigned flags)
+static HRESULT interp_identifier_ref(script_ctx_t *ctx, BSTR identifier, unsigned flags, prop_cache_t *cache)
 {
     exprval_t exprval;
     HRESULT hres;
 
-    hres = identifier_eval(ctx, identifier, &exprval);
+    hres = identifier_eval(ctx, identifier, cache, &exprval);
     if(FAILED(hres))
         return hres;
 
     if(exprval.type == EXPRVAL_INVALID && (flags & fdexNameEnsure)) {
         DISPID id;
 
-        hres = jsdisp_get_id(ctx->global, identifier, fdexNameEnsure, &id);
+        hres = jsdisp_get_id_cached(ctx->global, identifier, fdexNameEnsure, cache, &id);
         if(FAILED(hres))
             return hres;
 
@@ -1257,13 +1313,13 @@ static HRESULT interp_identifier_ref(script_ctx_t *ctx, BSTR identifier, unsigne
     return stack_push_exprval(ctx, &exprval);
 }
 
-static HRESULT identifier_value(script_ctx_t *ctx, BSTR identifier)
+static HRESULT identifier_value(script_ctx_t *ctx, BSTR identifier, prop_cache_t *cache)
 {
     exprval_t exprval;
     jsval_t v;
     HRESULT hres;
 
-    hres = identifier_eval(ctx, identifier, &exprval);
+    hres = identifier_eval(ctx, identifier, cache, &exprval);
     if(FAILED(hres))
         return hres;
 
@@ -1287,7 +1343,7 @@ static HRESULT interp_local_ref(script_ctx_t *ctx)
     TRACE("%d\n", arg);
 
     if(!frame->base_scope || !frame->base_scope->frame)
-        return interp_identifier_ref(ctx, local_name(frame, arg), flags);
+        return interp_identifier_ref(ctx, local_name(frame, arg), flags, NULL);
 
     ref.type = EXPRVAL_STACK_REF;
     ref.u.off = local_off(frame, arg);
@@ -1304,7 +1360,7 @@ static HRESULT interp_local(script_ctx_t *ctx)
     TRACE("%d: %s\n", arg, debugstr_w(local_name(frame, arg)));
 
     if(!frame->base_scope || !frame->base_scope->frame)
-        return identifier_value(ctx, local_name(frame, arg));
+        return identifier_value(ctx, local_name(frame, arg), NULL);
 
     hres = jsval_copy(ctx->stack[local_off(frame, arg)], &copy);
     if(FAILED(hres))
@@ -1320,7 +1376,7 @@ static HRESULT interp_ident(script_ctx_t *ctx)
 
     TRACE("%s\n", debugstr_w(arg));
 
-    return identifier_value(ctx, arg);
+    return identifier_value(ctx, arg, get_op_cache(ctx));
 }
 
 /* ECMA-262 3rd Edition    10.1.4 */
@@ -1331,7 +1387,7 @@ static HRESULT interp_identid(script_ctx_t *ctx)
 
     TRACE("%s %x\n", debugstr_w(arg), flags);
 
-    return interp_identifier_ref(ctx, arg, flags);
+    return interp_identifier_ref(ctx, arg, flags, get_op_cache(ctx));
 }
 
 /* ECMA-262 3rd Edition    7.8.1 */
@@ -1887,7 +1943,7 @@ static HRESULT interp_delete_ident(script_ctx_t *ctx)
 
     TRACE("%s\n", debugstr_w(arg));
 
-    hres = identifier_eval(ctx, arg, &exprval);
+    hres = identifier_eval(ctx, arg, NULL, &exprval);
     if(FAILED(hres))
         return hres;
 
@@ -1998,7 +2054,7 @@ static HRESULT interp_typeofident(script_ctx_t *ctx)
 
     TRACE("%s\n", debugstr_w(arg));
 
-    hres = identifier_eval(ctx, arg, &exprval);
+    hres = identifier_eval(ctx, arg, NULL, &exprval);
     if(FAILED(hres))
         return hres;
 
@@ -2850,7 +2906,7 @@ static HRESULT bind_event_target(script_ctx_t *ctx, function_code_t *func, jsdis
     jsval_t v;
     HRESULT hres;
 
-    hres = identifier_eval(ctx, func->event_target, &exprval);
+    hres = identifier_eval(ctx, func->event_target, NULL, &exprval);
     if(FAILED(hres))
         return hres;
 
@@ -59,6 +59,7 @@
     X(lteq,       1, 0,0)                  \
     X(member,     1, ARG_BSTR,   0)        \
     X(memberid,   1, ARG_UINT,   0)        \
+    X(member_ref, 1, ARG_BSTR,   ARG_UINT) \
     X(minus,      1, 0,0)                  \
     X(mod,        1, 0,0)                  \
     X(mul,        1, 0,0)                  \
@@ -125,6 +126,7 @@ typedef enum {
 
 typedef struct {
     jsop_t op;
+    unsigned cache; /* index in bytecode_t caches for name lookups */
     union {
         instr_arg_t arg[2];
         double dbl;
@@ -187,6 +189,9 @@ typedef struct _bytecode_t {
     unsigned str_pool_size;
     unsigned str_cnt;
 
+    prop_cache_t *caches;
+    unsigned cache_cnt;
+
     struct _bytecode_t *next;
 } bytecode_t;
 
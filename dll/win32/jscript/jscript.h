@@ -55,6 +55,7 @@ typedef struct _jsval_t jsval_t;
 typedef struct _jsstr_t jsstr_t;
 typedef struct _script_ctx_t script_ctx_t;
 typedef struct _dispex_prop_t dispex_prop_t;
+typedef struct _shape_t shape_t;
 typedef struct _property_desc_t property_desc_t;
 
 typedef struct {
@@ -240,6 +241,10 @@ struct jsdisp_t {
     jsdisp_t *prototype;
 
     const builtin_info_t *builtin_info;
+
+    /* Objects that got the same property names in the same order share a shape,
+     * see dispex.c. NULL once the object has too many properties to track. */
+    shape_t *shape;
 };
 
 static inline IDispatch *to_disp(jsdisp_t *jsdisp)
@@ -296,6 +301,25 @@ HRESULT jsdisp_propput_idx(jsdisp_t*,DWORD,jsval_t) DECLSPEC_HIDDEN;
 HRESULT jsdisp_propget_name(jsdisp_t*,LPCWSTR,jsval_t*) DECLSPEC_HIDDEN;
 HRESULT jsdisp_get_idx(jsdisp_t*,DWORD,jsval_t*) DECLSPEC_HIDDEN;
 HRESULT jsdisp_get_id(jsdisp_t*,const WCHAR*,DWORD,DISPID*) DECLSPEC_HIDDEN;
+
+/*
+ * Inline cache of a name lookup at one place in the bytecode. A DISPID found in
+ * an object with a given shape is the DISPID of that name in every object with
+ * the same shape, so one entry serves all of them.
+ */
+#define PROP_CACHE_SIZE 4
+
+typedef struct {
+    struct {
+        shape_t *shape;
+        DISPID id;
+    } entries[PROP_CACHE_SIZE];
+    unsigned next;
+} prop_cache_t;
+
+HRESULT jsdisp_get_id_cached(jsdisp_t*,const WCHAR*,DWORD,prop_cache_t*,DISPID*) DECLSPEC_HIDDEN;
+void prop_cache_release(prop_cache_t*) DECLSPEC_HIDDEN;
+void shape_release(shape_t*) DECLSPEC_HIDDEN;
 HRESULT disp_delete(IDispatch*,DISPID,BOOL*) DECLSPEC_HIDDEN;
 HRESULT disp_delete_name(script_ctx_t*,IDispatch*,jsstr_t*,BOOL*) DECLSPEC_HIDDEN;
 HRESULT jsdisp_delete_idx(jsdisp_t*,DWORD) DECLSPEC_HIDDEN;
@@ -439,6 +463,7 @@ struct _script_ctx_t {
     DWORD last_match_length;
 
     jsdisp_t *global;
+    shape_t *root_shape;
     jsdisp_t *function_constr;
     jsdisp_t *array_constr;
     jsdisp_t *bool_constr;
@@ -29,6 +29,7 @@
 #include "objbase.h"
 
 #include "wincodecs_private.h"
+#include "pixconv.h"
 
 #include "wine/heap.h"
 #include "wine/debug.h"
@@ -138,9 +139,60 @@ static inline FormatConverter *impl_from_IWICFormatConverter(IWICFormatConverter
     return CONTAINING_RECORD(iface, FormatConverter, IWICFormatConverter_iface);
 }
 
-static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRect *prc,
-    UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
+/* Work done on each 32bppBGRA row while it is still in the cache, so the
+ * other 32bpp formats don't take a second pass over the whole image */
+#define ROW_OPAQUE          0x1     /* alpha is 255 */
+#define ROW_UNPREMULTIPLY   0x2
+#define ROW_PREMULTIPLY     0x4
+#define ROW_SWAP_RB         0x8     /* make it RGBA */
+
+static void finish_row(BYTE *row, UINT width, DWORD flags)
 {
+    if (flags & ROW_OPAQUE) pixconv_set_alpha(row, width);
+    if (flags & ROW_UNPREMULTIPLY) pixconv_unpremultiply(row, width);
+    if (flags & ROW_PREMULTIPLY) pixconv_premultiply(row, width);
+    if (flags & ROW_SWAP_RB) pixconv_swap_rb(row, width);
+}
+
+/* The source is 32bpp already, its rows only need finishing */
+static HRESULT copypixels_in_place(struct FormatConverter *This, const WICRect *prc,
+    UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, DWORD flags)
+{
+    HRESULT hr;
+    INT y;
+
+    if (!prc) return S_OK;
+
+    hr = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
+    if (FAILED(hr) || !flags) return hr;
+
+    for (y=0; y<prc->Height; y++)
+        finish_row(pbBuffer+cbStride*y, prc->Width, flags);
+
+    return S_OK;
+}
+
+static HRESULT copypixels_to_32bppBGRA_flags(struct FormatConverter *This, const WICRect *prc,
+    UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format, DWORD flags)
+{
+    switch (source_format)
+    {
+    case format_8bppGray:
+    case format_16bppGray:
+    case format_16bppBGR555:
+    case format_16bppBGR565:
+    case format_24bppBGR:
+    case format_24bppRGB:
+    case format_32bppBGR:
+    case format_48bppRGB:
+    case format_32bppCMYK:
+        /* opaque, premultiplying wouldn't change anything */
+        flags &= ~ROW_PREMULTIPLY;
+        break;
+    default:
+        break;
+    }
+
     switch (source_format)
     {
     case format_1bppIndexed:
@@ -173,6 +225,9 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
             IWICPalette_Release(palette);
             if (FAILED(res)) return res;
 
+            /* the pixels are palette entries, so finish those instead */
+            finish_row((BYTE *)colors, ARRAY_SIZE(colors), flags);
+
             srcstride = (prc->Width+7)/8;
             srcdatasize = srcstride * prc->Height;
 
@@ -240,6 +295,9 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
             IWICPalette_Release(palette);
             if (FAILED(res)) return res;
 
+            /* the pixels are palette entries, so finish those instead */
+            finish_row((BYTE *)colors, ARRAY_SIZE(colors), flags);
+
             srcstride = (prc->Width+3)/4;
             srcdatasize = srcstride * prc->Height;
 
@@ -303,6 +361,9 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
             IWICPalette_Release(palette);
             if (FAILED(res)) return res;
 
+            /* the pixels are palette entries, so finish those instead */
+            finish_row((BYTE *)colors, ARRAY_SIZE(colors), flags);
+
             srcstride = (prc->Width+1)/2;
             srcdatasize = srcstride * prc->Height;
 
@@ -338,13 +399,11 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const BYTE *srcbyte;
             BYTE *dstrow;
-            DWORD *dstpixel;
 
             srcstride = prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -358,14 +417,9 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
             {
                 srcrow = srcdata;
                 dstrow = pbBuffer;
+                /* swapping or premultiplying doesn't change gray */
                 for (y=0; y<prc->Height; y++) {
-                    srcbyte = srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++)
-                    {
-                        *dstpixel++ = 0xff000000|(*srcbyte<<16)|(*srcbyte<<8)|*srcbyte;
-                        srcbyte++;
-                    }
+                    pixconv_gray8_to_32(srcrow, dstrow, prc->Width);
                     srcrow += srcstride;
                     dstrow += cbStride;
                 }
@@ -380,13 +434,11 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const BYTE *srcbyte;
             BYTE *dstrow;
-            DWORD *dstpixel;
             WICColor colors[256];
             IWICPalette *palette;
             UINT actualcolors;
@@ -399,9 +451,11 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                 res = IWICPalette_GetColors(palette, 256, colors, &actualcolors);
 
             IWICPalette_Release(palette);
-
             if (FAILED(res)) return res;
 
+            /* the pixels are palette entries, so finish those instead */
+            finish_row((BYTE *)colors, ARRAY_SIZE(colors), flags);
+
             srcstride = prc->Width;
             srcdatasize = srcstride * prc->Height;
 
@@ -415,10 +469,7 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                 srcrow = srcdata;
                 dstrow = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcbyte = srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++)
-                        *dstpixel++ = colors[*srcbyte++];
+                    pixconv_indexed8_to_32(srcrow, dstrow, prc->Width, colors);
                     srcrow += srcstride;
                     dstrow += cbStride;
                 }
@@ -453,6 +504,7 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
             {
                 srcrow = srcdata;
                 dstrow = pbBuffer;
+                /* swapping or premultiplying doesn't change gray */
                 for (y=0; y<prc->Height; y++) {
                     srcbyte = srcrow;
                     dstpixel=(DWORD*)dstrow;
@@ -476,13 +528,11 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const WORD *srcpixel;
             BYTE *dstrow;
-            DWORD *dstpixel;
 
             srcstride = 2 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -497,19 +547,8 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                 srcrow = srcdata;
                 dstrow = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcpixel=(const WORD*)srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        WORD srcval;
-                        srcval=*srcpixel++;
-                        *dstpixel++=0xff000000 | /* constant 255 alpha */
-                                    ((srcval << 9) & 0xf80000) | /* r */
-                                    ((srcval << 4) & 0x070000) | /* r - 3 bits */
-                                    ((srcval << 6) & 0x00f800) | /* g */
-                                    ((srcval << 1) & 0x000700) | /* g - 3 bits */
-                                    ((srcval << 3) & 0x0000f8) | /* b */
-                                    ((srcval >> 2) & 0x000007);  /* b - 3 bits */
-                    }
+                    pixconv_555_to_32(srcrow, dstrow, prc->Width, FALSE);
+                    finish_row(dstrow, prc->Width, flags);
                     srcrow += srcstride;
                     dstrow += cbStride;
                 }
@@ -524,13 +563,11 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const WORD *srcpixel;
             BYTE *dstrow;
-            DWORD *dstpixel;
 
             srcstride = 2 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -545,19 +582,8 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                 srcrow = srcdata;
                 dstrow = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcpixel=(const WORD*)srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        WORD srcval;
-                        srcval=*srcpixel++;
-                        *dstpixel++=0xff000000 | /* constant 255 alpha */
-                                    ((srcval << 8) & 0xf80000) | /* r */
-                                    ((srcval << 3) & 0x070000) | /* r - 3 bits */
-                                    ((srcval << 5) & 0x00fc00) | /* g */
-                                    ((srcval >> 1) & 0x000300) | /* g - 2 bits */
-                                    ((srcval << 3) & 0x0000f8) | /* b */
-                                    ((srcval >> 2) & 0x000007);  /* b - 3 bits */
-                    }
+                    pixconv_565_to_32(srcrow, dstrow, prc->Width);
+                    finish_row(dstrow, prc->Width, flags);
                     srcrow += srcstride;
                     dstrow += cbStride;
                 }
@@ -572,13 +598,11 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const WORD *srcpixel;
             BYTE *dstrow;
-            DWORD *dstpixel;
 
             srcstride = 2 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -593,19 +617,8 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                 srcrow = srcdata;
                 dstrow = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcpixel=(const WORD*)srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        WORD srcval;
-                        srcval=*srcpixel++;
-                        *dstpixel++=((srcval & 0x8000) ? 0xff000000 : 0) | /* alpha */
-                                    ((srcval << 9) & 0xf80000) | /* r */
-                                    ((srcval << 4) & 0x070000) | /* r - 3 bits */
-                                    ((srcval << 6) & 0x00f800) | /* g */
-                                    ((srcval << 1) & 0x000700) | /* g - 3 bits */
-                                    ((srcval << 3) & 0x0000f8) | /* b */
-                                    ((srcval >> 2) & 0x000007);  /* b - 3 bits */
-                    }
+                    pixconv_555_to_32(srcrow, dstrow, prc->Width, TRUE);
+                    finish_row(dstrow, prc->Width, flags);
                     srcrow += srcstride;
                     dstrow += cbStride;
                 }
@@ -620,13 +633,11 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const BYTE *srcpixel;
             BYTE *dstrow;
-            BYTE *dstpixel;
 
             srcstride = 3 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -641,14 +652,7 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                 srcrow = srcdata;
                 dstrow = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        *dstpixel++=*srcpixel++; /* blue */
-                        *dstpixel++=*srcpixel++; /* green */
-                        *dstpixel++=*srcpixel++; /* red */
-                        *dstpixel++=255; /* alpha */
-                    }
+                    pixconv_24_to_32(srcrow, dstrow, prc->Width, (flags & ROW_SWAP_RB) != 0);
                     srcrow += srcstride;
                     dstrow += cbStride;
                 }
@@ -663,14 +667,11 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const BYTE *srcpixel;
             BYTE *dstrow;
-            BYTE *dstpixel;
-            BYTE tmppixel[3];
 
             srcstride = 3 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -685,18 +686,7 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                 srcrow = srcdata;
                 dstrow = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        tmppixel[0]=*srcpixel++; /* red */
-                        tmppixel[1]=*srcpixel++; /* green */
-                        tmppixel[2]=*srcpixel++; /* blue */
-
-                        *dstpixel++=tmppixel[2]; /* blue */
-                        *dstpixel++=tmppixel[1]; /* green */
-                        *dstpixel++=tmppixel[0]; /* red */
-                        *dstpixel++=255; /* alpha */
-                    }
+                    pixconv_24_to_32(srcrow, dstrow, prc->Width, !(flags & ROW_SWAP_RB));
                     srcrow += srcstride;
                     dstrow += cbStride;
                 }
@@ -708,46 +698,11 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         }
         return S_OK;
     case format_32bppBGR:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
-            if (FAILED(res)) return res;
-
-            /* set all alpha values to 255 */
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                    pbBuffer[cbStride*y+4*x+3] = 0xff;
-        }
-        return S_OK;
+        return copypixels_in_place(This, prc, cbStride, cbBufferSize, pbBuffer, flags | ROW_OPAQUE);
     case format_32bppBGRA:
-        if (prc)
-            return IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
-        return S_OK;
+        return copypixels_in_place(This, prc, cbStride, cbBufferSize, pbBuffer, flags);
     case format_32bppPBGRA:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
-            if (FAILED(res)) return res;
-
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 0 && alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * 255 / alpha;
-                    }
-                }
-        }
-        return S_OK;
+        return copypixels_in_place(This, prc, cbStride, cbBufferSize, pbBuffer, flags | ROW_UNPREMULTIPLY);
     case format_48bppRGB:
         if (prc)
         {
@@ -782,6 +737,7 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                         srcpixel++; blue = *srcpixel++;
                         *dstpixel++=0xff000000|red<<16|green<<8|blue;
                     }
+                    finish_row(dstrow, prc->Width, flags);
                     srcrow += srcstride;
                     dstrow += cbStride;
                 }
@@ -827,6 +783,7 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                         srcpixel++; alpha = *srcpixel++;
                         *dstpixel++=alpha<<24|red<<16|green<<8|blue;
                     }
+                    finish_row(dstrow, prc->Width, flags);
                     srcrow += srcstride;
                     dstrow += cbStride;
                 }
@@ -847,6 +804,7 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
             if (FAILED(res)) return res;
 
             for (y=0; y<prc->Height; y++)
+            {
                 for (x=0; x<prc->Width; x++)
                 {
                     BYTE *pixel = pbBuffer+cbStride*y+4*x;
@@ -856,6 +814,8 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                     pixel[2] = (255-c)*(255-k)/255; /* red */
                     pixel[3] = 255; /* alpha */
                 }
+                finish_row(pbBuffer+cbStride*y, prc->Width, flags);
+            }
         }
         return S_OK;
     default:
@@ -863,63 +823,39 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
     }
 }
 
-static HRESULT copypixels_to_32bppRGBA(struct FormatConverter *This, const WICRect *prc,
+static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRect *prc,
     UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
 {
-    HRESULT hr;
+    return copypixels_to_32bppBGRA_flags(This, prc, cbStride, cbBufferSize, pbBuffer, source_format, 0);
+}
 
+static HRESULT copypixels_to_32bppRGBA_flags(struct FormatConverter *This, const WICRect *prc,
+    UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format, DWORD flags)
+{
     switch (source_format)
     {
     case format_32bppRGB:
-        if (prc)
-        {
-            INT x, y;
-
-            hr = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
-            if (FAILED(hr)) return hr;
-
-            /* set all alpha values to 255 */
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                    pbBuffer[cbStride*y+4*x+3] = 0xff;
-        }
-        return S_OK;
+        return copypixels_in_place(This, prc, cbStride, cbBufferSize, pbBuffer,
+                                   (flags & ~ROW_PREMULTIPLY) | ROW_OPAQUE);
 
     case format_32bppRGBA:
-        if (prc)
-            return IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
-        return S_OK;
+        return copypixels_in_place(This, prc, cbStride, cbBufferSize, pbBuffer, flags);
 
     case format_32bppPRGBA:
-        if (prc)
-        {
-            INT x, y;
-
-            hr = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
-            if (FAILED(hr)) return hr;
-
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 0 && alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * 255 / alpha;
-                    }
-                }
-        }
-        return S_OK;
+        return copypixels_in_place(This, prc, cbStride, cbBufferSize, pbBuffer, flags | ROW_UNPREMULTIPLY);
 
     default:
-        hr = copypixels_to_32bppBGRA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
-        if (SUCCEEDED(hr) && prc)
-              reverse_bgr8(4, pbBuffer, prc->Width, prc->Height, cbStride);
-        return hr;
+        return copypixels_to_32bppBGRA_flags(This, prc, cbStride, cbBufferSize, pbBuffer,
+                                             source_format, flags | ROW_SWAP_RB);
     }
 }
 
+static HRESULT copypixels_to_32bppRGBA(struct FormatConverter *This, const WICRect *prc,
+    UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
+{
+    return copypixels_to_32bppRGBA_flags(This, prc, cbStride, cbBufferSize, pbBuffer, source_format, 0);
+}
+
 static HRESULT copypixels_to_32bppBGR(struct FormatConverter *This, const WICRect *prc,
     UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
 {
@@ -955,8 +891,6 @@ static HRESULT copypixels_to_32bppRGB(struct FormatConverter *This, const WICRec
 static HRESULT copypixels_to_32bppPBGRA(struct FormatConverter *This, const WICRect *prc,
     UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
 {
-    HRESULT hr;
-
     switch (source_format)
     {
     case format_32bppPBGRA:
@@ -964,32 +898,14 @@ static HRESULT copypixels_to_32bppPBGRA(struct FormatConverter *This, const WICR
             return IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
         return S_OK;
     default:
-        hr = copypixels_to_32bppBGRA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
-        if (SUCCEEDED(hr) && prc)
-        {
-            INT x, y;
-
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * alpha / 255;
-                    }
-                }
-        }
-        return hr;
+        return copypixels_to_32bppBGRA_flags(This, prc, cbStride, cbBufferSize, pbBuffer,
+                                             source_format, ROW_PREMULTIPLY);
     }
 }
 
 static HRESULT copypixels_to_32bppPRGBA(struct FormatConverter *This, const WICRect *prc,
     UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
 {
-    HRESULT hr;
-
     switch (source_format)
     {
     case format_32bppPRGBA:
@@ -997,24 +913,8 @@ static HRESULT copypixels_to_32bppPRGBA(struct FormatConverter *This, const WICR
             return IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
         return S_OK;
     default:
-        hr = copypixels_to_32bppRGBA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
-        if (SUCCEEDED(hr) && prc)
-        {
-            INT x, y;
-
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * alpha / 255;
-                    }
-                }
-        }
-        return hr;
+        return copypixels_to_32bppRGBA_flags(This, prc, cbStride, cbBufferSize, pbBuffer,
+                                             source_format, ROW_PREMULTIPLY);
     }
 }
 
@@ -1041,13 +941,11 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const BYTE *srcpixel;
             BYTE *dstrow;
-            BYTE *dstpixel;
 
             srcstride = 4 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -1062,14 +960,7 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
                 srcrow = srcdata;
                 dstrow = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        *dstpixel++=*srcpixel++; /* blue */
-                        *dstpixel++=*srcpixel++; /* green */
-                        *dstpixel++=*srcpixel++; /* red */
-                        srcpixel++; /* alpha */
-                    }
+                    pixconv_32_to_24(srcrow, dstrow, prc->Width, FALSE);
                     srcrow += srcstride;
                     dstrow += cbStride;
                 }
@@ -1194,14 +1085,11 @@ static HRESULT copypixels_to_24bppRGB(struct FormatConverter *This, const WICRec
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const BYTE *srcpixel;
             BYTE *dstrow;
-            BYTE *dstpixel;
-            BYTE tmppixel[3];
 
             srcstride = 4 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -1216,18 +1104,7 @@ static HRESULT copypixels_to_24bppRGB(struct FormatConverter *This, const WICRec
                 srcrow = srcdata;
                 dstrow = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        tmppixel[0]=*srcpixel++; /* blue */
-                        tmppixel[1]=*srcpixel++; /* green */
-                        tmppixel[2]=*srcpixel++; /* red */
-                        srcpixel++; /* alpha */
-
-                        *dstpixel++=tmppixel[2]; /* red */
-                        *dstpixel++=tmppixel[1]; /* green */
-                        *dstpixel++=tmppixel[0]; /* blue */
-                    }
+                    pixconv_32_to_24(srcrow, dstrow, prc->Width, TRUE);
                     srcrow += srcstride;
                     dstrow += cbStride;
                 }
@@ -1287,12 +1164,51 @@ static HRESULT copypixels_to_32bppGrayFloat(struct FormatConverter *This, const
     return hr;
 }
 
+/* Reads the source as 24bppBGR for the conversions that only look at blue,
+ * green and red. 32bpp BGR sources are read as they are, saving a pass. */
+static HRESULT copypixels_bgr(struct FormatConverter *This, const WICRect *prc,
+    enum pixelformat source_format, BYTE **srcdata, UINT *srcbpp, UINT *srcstride)
+{
+    HRESULT hr;
+    UINT srcdatasize;
+
+    switch (source_format)
+    {
+    case format_32bppBGR:
+    case format_32bppBGRA:
+    case format_32bppPBGRA:
+        *srcbpp = 4;
+        break;
+    default:
+        *srcbpp = 3;
+        break;
+    }
+
+    *srcstride = *srcbpp * prc->Width;
+    srcdatasize = *srcstride * prc->Height;
+
+    *srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
+    if (!*srcdata) return E_OUTOFMEMORY;
+
+    if (*srcbpp == 4)
+        hr = IWICBitmapSource_CopyPixels(This->source, prc, *srcstride, srcdatasize, *srcdata);
+    else
+        hr = copypixels_to_24bppBGR(This, prc, *srcstride, srcdatasize, *srcdata, source_format);
+
+    if (FAILED(hr))
+    {
+        HeapFree(GetProcessHeap(), 0, *srcdata);
+        *srcdata = NULL;
+    }
+    return hr;
+}
+
 static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRect *prc,
     UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
 {
     HRESULT hr;
     BYTE *srcdata;
-    UINT srcstride, srcdatasize;
+    UINT srcstride, srcdatasize, srcbpp;
 
     if (source_format == format_8bppGray)
     {
@@ -1342,13 +1258,7 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
     if (!prc)
         return copypixels_to_24bppBGR(This, NULL, cbStride, cbBufferSize, pbBuffer, source_format);
 
-    srcstride = 3 * prc->Width;
-    srcdatasize = srcstride * prc->Height;
-
-    srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-    if (!srcdata) return E_OUTOFMEMORY;
-
-    hr = copypixels_to_24bppBGR(This, prc, srcstride, srcdatasize, srcdata, source_format);
+    hr = copypixels_bgr(This, prc, source_format, &srcdata, &srcbpp, &srcstride);
     if (SUCCEEDED(hr))
     {
         INT x, y;
@@ -1364,14 +1274,15 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
 
                 gray = to_sRGB_component(gray) * 255.0f;
                 dst[x] = (BYTE)floorf(gray + 0.51f);
-                bgr += 3;
+                bgr += srcbpp;
             }
             src += srcstride;
             dst += cbStride;
         }
+
+        HeapFree(GetProcessHeap(), 0, srcdata);
     }
 
-    HeapFree(GetProcessHeap(), 0, srcdata);
     return hr;
 }
 
@@ -1414,7 +1325,7 @@ static HRESULT copypixels_to_8bppIndexed(struct FormatConverter *This, const WIC
     HRESULT hr;
     BYTE *srcdata;
     WICColor colors[256];
-    UINT srcstride, srcdatasize, count;
+    UINT srcstride, srcbpp, count;
 
     if (source_format == format_8bppIndexed)
     {
@@ -1432,13 +1343,7 @@ static HRESULT copypixels_to_8bppIndexed(struct FormatConverter *This, const WIC
     hr = IWICPalette_GetColors(This->palette, 256, colors, &count);
     if (hr != S_OK) return hr;
 
-    srcstride = 3 * prc->Width;
-    srcdatasize = srcstride * prc->Height;
-
-    srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-    if (!srcdata) return E_OUTOFMEMORY;
-
-    hr = copypixels_to_24bppBGR(This, prc, srcstride, srcdatasize, srcdata, source_format);
+    hr = copypixels_bgr(This, prc, source_format, &srcdata, &srcbpp, &srcstride);
     if (SUCCEEDED(hr))
     {
         INT x, y;
@@ -1451,14 +1356,15 @@ static HRESULT copypixels_to_8bppIndexed(struct FormatConverter *This, const WIC
             for (x = 0; x < prc->Width; x++)
             {
                 dst[x] = rgb_to_palette_index(bgr, colors, count);
-                bgr += 3;
+                bgr += srcbpp;
             }
             src += srcstride;
             dst += cbStride;
         }
+
+        HeapFree(GetProcessHeap(), 0, srcdata);
     }
 
-    HeapFree(GetProcessHeap(), 0, srcdata);
     return hr;
 }
 
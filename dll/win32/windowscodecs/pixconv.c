@@ -0,0 +1,398 @@
+/*
+ * PROJECT:     ReactOS Windows Imaging Component
+ * LICENSE:     LGPL-2.1+ (https://spdx.org/licenses/LGPL-2.1+)
+ * PURPOSE:     Row conversion kernels for the format converter
+ *
+ * Each kernel converts one row and does exactly what the converter's old
+ * per-pixel loop did, including the way unpremultiplying wraps around when
+ * a color is larger than its alpha. The SSE2 loops are for amd64, the C
+ * loops finish the row and are all x86 gets.
+ */
+
+#ifdef WINCODECS_HOST
+#include <typedefs.h>
+#else
+#include "config.h"
+
+#include <stdarg.h>
+
+#include "windef.h"
+#endif
+
+#include <string.h>
+
+#include "pixconv.h"
+
+#if defined(_M_AMD64) || defined(__x86_64__)
+#define PIXCONV_SSE2
+#include <emmintrin.h>
+#endif
+
+static inline UINT load32(const BYTE *p)
+{
+    UINT v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void store32(BYTE *p, UINT v)
+{
+    memcpy(p, &v, sizeof(v));
+}
+
+static inline UINT swap_rb(UINT v)
+{
+    return (v & 0xff00ff00) | ((v << 16) & 0xff0000) | ((v >> 16) & 0xff);
+}
+
+/* 24 <-> 32 BPP ***************************************************************/
+
+#ifdef PIXCONV_SSE2
+static inline __m128i swap_rb_sse2(__m128i v)
+{
+    const __m128i ga = _mm_set1_epi32(0xff00ff00), low = _mm_set1_epi32(0xff);
+    __m128i rb = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(v, 16), low),
+                              _mm_slli_epi32(_mm_and_si128(v, low), 16));
+
+    return _mm_or_si128(_mm_and_si128(v, ga), rb);
+}
+#endif
+
+void pixconv_24_to_32(const BYTE *src, BYTE *dst, UINT width, BOOL swap)
+{
+    UINT x = 0;
+
+    if (!width) return;
+
+#ifdef PIXCONV_SSE2
+    {
+        const __m128i alpha = _mm_set1_epi32(0xff000000);
+
+        /* SSE2 has no byte shuffle, so each pixel is moved to the bottom of
+         * the register and the four are put together from there. The 16 byte
+         * load reads 4 bytes past the 4 pixels. */
+        for (; x + 6 <= width; x += 4)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)(src + x * 3));
+            __m128i p01 = _mm_unpacklo_epi32(v, _mm_srli_si128(v, 3));
+            __m128i p23 = _mm_unpacklo_epi32(_mm_srli_si128(v, 6), _mm_srli_si128(v, 9));
+
+            v = _mm_or_si128(_mm_unpacklo_epi64(p01, p23), alpha);
+            _mm_storeu_si128((__m128i *)(dst + x * 4), swap ? swap_rb_sse2(v) : v);
+        }
+    }
+#endif
+
+    /* the 32 bit load takes one byte of the next pixel, so not for the last */
+    for (; x + 1 < width; x++)
+    {
+        UINT v = load32(src + x * 3) | 0xff000000;
+        store32(dst + x * 4, swap ? swap_rb(v) : v);
+    }
+
+    dst[x * 4] = src[x * 3 + (swap ? 2 : 0)];
+    dst[x * 4 + 1] = src[x * 3 + 1];
+    dst[x * 4 + 2] = src[x * 3 + (swap ? 0 : 2)];
+    dst[x * 4 + 3] = 0xff;
+}
+
+void pixconv_32_to_24(const BYTE *src, BYTE *dst, UINT width, BOOL swap)
+{
+    UINT x = 0;
+
+#ifdef PIXCONV_SSE2
+    {
+        const __m128i color = _mm_set1_epi32(0xffffff);
+        const __m128i low = _mm_set_epi32(0, 0xffffff, 0, 0xffffff);
+        const __m128i high = _mm_set_epi32(0xffff, 0xff000000, 0xffff, 0xff000000);
+        const __m128i first = _mm_set_epi32(0, 0, -1, -1);
+
+        /* pairs of pixels closed up in each half, then the halves */
+        for (; x + 4 <= width; x += 4)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)(src + x * 4));
+
+            if (swap) v = swap_rb_sse2(v);
+            v = _mm_and_si128(v, color);
+            v = _mm_or_si128(_mm_and_si128(v, low), _mm_and_si128(_mm_srli_epi64(v, 8), high));
+            v = _mm_or_si128(_mm_and_si128(v, first), _mm_srli_si128(_mm_andnot_si128(first, v), 2));
+            _mm_storel_epi64((__m128i *)(dst + x * 3), v);
+            store32(dst + x * 3 + 8, (UINT)_mm_cvtsi128_si32(_mm_srli_si128(v, 8)));
+        }
+    }
+#endif
+
+    /* four pixels make three 32 bit stores */
+    for (; x + 4 <= width; x += 4)
+    {
+        UINT p0 = load32(src + x * 4), p1 = load32(src + x * 4 + 4);
+        UINT p2 = load32(src + x * 4 + 8), p3 = load32(src + x * 4 + 12);
+
+        if (swap)
+        {
+            p0 = swap_rb(p0);
+            p1 = swap_rb(p1);
+            p2 = swap_rb(p2);
+            p3 = swap_rb(p3);
+        }
+        store32(dst + x * 3, (p0 & 0xffffff) | (p1 << 24));
+        store32(dst + x * 3 + 4, ((p1 >> 8) & 0xffff) | (p2 << 16));
+        store32(dst + x * 3 + 8, ((p2 >> 16) & 0xff) | (p3 << 8));
+    }
+
+    for (; x < width; x++)
+    {
+        dst[x * 3] = src[x * 4 + (swap ? 2 : 0)];
+        dst[x * 3 + 1] = src[x * 4 + 1];
+        dst[x * 3 + 2] = src[x * 4 + (swap ? 0 : 2)];
+    }
+}
+
+/* GRAY AND INDEXED ***********************************************************/
+
+void pixconv_gray8_to_32(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x = 0;
+
+#ifdef PIXCONV_SSE2
+    const __m128i alpha = _mm_set1_epi8((char)0xff);
+
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i g = _mm_loadu_si128((const __m128i *)(src + x));
+        __m128i gg = _mm_unpacklo_epi8(g, g), ga = _mm_unpacklo_epi8(g, alpha);
+
+        _mm_storeu_si128((__m128i *)(dst + x * 4), _mm_unpacklo_epi16(gg, ga));
+        _mm_storeu_si128((__m128i *)(dst + x * 4 + 16), _mm_unpackhi_epi16(gg, ga));
+        gg = _mm_unpackhi_epi8(g, g);
+        ga = _mm_unpackhi_epi8(g, alpha);
+        _mm_storeu_si128((__m128i *)(dst + x * 4 + 32), _mm_unpacklo_epi16(gg, ga));
+        _mm_storeu_si128((__m128i *)(dst + x * 4 + 48), _mm_unpackhi_epi16(gg, ga));
+    }
+#endif
+
+    for (; x < width; x++)
+        store32(dst + x * 4, 0xff000000 | (src[x] << 16) | (src[x] << 8) | src[x]);
+}
+
+void pixconv_indexed8_to_32(const BYTE *src, BYTE *dst, UINT width, const UINT *colors)
+{
+    UINT x;
+
+    for (x = 0; x + 4 <= width; x += 4)
+    {
+        store32(dst + x * 4, colors[src[x]]);
+        store32(dst + x * 4 + 4, colors[src[x + 1]]);
+        store32(dst + x * 4 + 8, colors[src[x + 2]]);
+        store32(dst + x * 4 + 12, colors[src[x + 3]]);
+    }
+
+    for (; x < width; x++)
+        store32(dst + x * 4, colors[src[x]]);
+}
+
+/* 16 BPP *********************************************************************/
+
+#ifdef PIXCONV_SSE2
+/* Eight pixels from their 8 bit channels in 16 bit lanes */
+static inline void store_bgra_sse2(BYTE *dst, __m128i b, __m128i g, __m128i r, __m128i a)
+{
+    __m128i bg = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+    __m128i ra = _mm_or_si128(r, _mm_slli_epi16(a, 8));
+
+    _mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi16(bg, ra));
+    _mm_storeu_si128((__m128i *)(dst + 16), _mm_unpackhi_epi16(bg, ra));
+}
+
+/* x << 3 | x >> 2 for 5 bit values */
+static inline __m128i expand5_sse2(__m128i x)
+{
+    return _mm_or_si128(_mm_slli_epi16(x, 3), _mm_srli_epi16(x, 2));
+}
+#endif
+
+void pixconv_555_to_32(const BYTE *src, BYTE *dst, UINT width, BOOL alpha_bit)
+{
+    UINT x = 0;
+
+#ifdef PIXCONV_SSE2
+    const __m128i mask5 = _mm_set1_epi16(0x1f);
+    const __m128i opaque = _mm_set1_epi16(0xff);
+
+    for (; x + 8 <= width; x += 8)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + x * 2));
+        __m128i b = expand5_sse2(_mm_and_si128(v, mask5));
+        __m128i g = expand5_sse2(_mm_and_si128(_mm_srli_epi16(v, 5), mask5));
+        __m128i r = expand5_sse2(_mm_and_si128(_mm_srli_epi16(v, 10), mask5));
+        __m128i a = alpha_bit ? _mm_srli_epi16(_mm_srai_epi16(v, 15), 8) : opaque;
+
+        store_bgra_sse2(dst + x * 4, b, g, r, a);
+    }
+#endif
+
+    for (; x < width; x++)
+    {
+        WORD v = src[x * 2] | (src[x * 2 + 1] << 8);
+        DWORD alpha = (!alpha_bit || (v & 0x8000)) ? 0xff000000 : 0;
+
+        store32(dst + x * 4, alpha |
+                ((v << 9) & 0xf80000) | ((v << 4) & 0x070000) |
+                ((v << 6) & 0x00f800) | ((v << 1) & 0x000700) |
+                ((v << 3) & 0x0000f8) | ((v >> 2) & 0x000007));
+    }
+}
+
+void pixconv_565_to_32(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x = 0;
+
+#ifdef PIXCONV_SSE2
+    const __m128i mask5 = _mm_set1_epi16(0x1f);
+    const __m128i mask6 = _mm_set1_epi16(0x3f);
+    const __m128i opaque = _mm_set1_epi16(0xff);
+
+    for (; x + 8 <= width; x += 8)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + x * 2));
+        __m128i b = expand5_sse2(_mm_and_si128(v, mask5));
+        __m128i g = _mm_and_si128(_mm_srli_epi16(v, 5), mask6);
+        __m128i r = expand5_sse2(_mm_srli_epi16(v, 11));
+
+        g = _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4));
+        store_bgra_sse2(dst + x * 4, b, g, r, opaque);
+    }
+#endif
+
+    for (; x < width; x++)
+    {
+        WORD v = src[x * 2] | (src[x * 2 + 1] << 8);
+
+        store32(dst + x * 4, 0xff000000 |
+                ((v << 8) & 0xf80000) | ((v << 3) & 0x070000) |
+                ((v << 5) & 0x00fc00) | ((v >> 1) & 0x000300) |
+                ((v << 3) & 0x0000f8) | ((v >> 2) & 0x000007));
+    }
+}
+
+/* IN PLACE *******************************************************************/
+
+void pixconv_set_alpha(BYTE *row, UINT width)
+{
+    UINT x = 0;
+
+#ifdef PIXCONV_SSE2
+    const __m128i alpha = _mm_set1_epi32(0xff000000);
+
+    for (; x + 4 <= width; x += 4)
+    {
+        __m128i *p = (__m128i *)(row + x * 4);
+        _mm_storeu_si128(p, _mm_or_si128(_mm_loadu_si128(p), alpha));
+    }
+#endif
+
+    for (; x < width; x++)
+        row[x * 4 + 3] = 0xff;
+}
+
+void pixconv_swap_rb(BYTE *row, UINT width)
+{
+    UINT x = 0;
+
+#ifdef PIXCONV_SSE2
+    for (; x + 4 <= width; x += 4)
+    {
+        __m128i *p = (__m128i *)(row + x * 4);
+        _mm_storeu_si128(p, swap_rb_sse2(_mm_loadu_si128(p)));
+    }
+#endif
+
+    for (; x < width; x++)
+        store32(row + x * 4, swap_rb(load32(row + x * 4)));
+}
+
+void pixconv_premultiply(BYTE *row, UINT width)
+{
+    UINT x = 0;
+
+#ifdef PIXCONV_SSE2
+    const __m128i zero = _mm_setzero_si128(), one = _mm_set1_epi16(1);
+    const __m128i alpha_lane = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+    const __m128i alpha_255 = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+
+    for (; x + 2 <= width; x += 2)
+    {
+        __m128i v = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(row + x * 4)), zero);
+        __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xff), 0xff);
+
+        /* alpha itself is multiplied by 255, which leaves it as it is */
+        a = _mm_or_si128(_mm_andnot_si128(alpha_lane, a), alpha_255);
+        v = _mm_add_epi16(_mm_mullo_epi16(v, a), one);
+
+        /* c * a / 255 rounded down, exact for c * a <= 255 * 255 */
+        v = _mm_srli_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)), 8);
+        _mm_storel_epi64((__m128i *)(row + x * 4), _mm_packus_epi16(v, v));
+    }
+#endif
+
+    for (; x < width; x++)
+    {
+        BYTE alpha = row[x * 4 + 3];
+
+        if (alpha != 255)
+        {
+            row[x * 4] = row[x * 4] * alpha / 255;
+            row[x * 4 + 1] = row[x * 4 + 1] * alpha / 255;
+            row[x * 4 + 2] = row[x * 4 + 2] * alpha / 255;
+        }
+    }
+}
+
+void pixconv_unpremultiply(BYTE *row, UINT width)
+{
+    UINT x = 0;
+
+#ifdef PIXCONV_SSE2
+    const __m128i zero = _mm_setzero_si128(), low = _mm_set1_epi32(0xff);
+    const __m128i alpha_lane = _mm_set_epi32(-1, 0, 0, 0);
+    const __m128 scale = _mm_set1_ps(255.0f);
+
+    /* One pixel per vector. Both operands are exact in single precision and
+     * below 2^24, so the rounded quotient truncates to the integer one. */
+    for (; x + 4 <= width; x += 4)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(row + x * 4));
+        __m128i wide[2], out[4];
+        UINT i;
+
+        wide[0] = _mm_unpacklo_epi8(v, zero);
+        wide[1] = _mm_unpackhi_epi8(v, zero);
+        for (i = 0; i < 4; i++)
+        {
+            __m128i c = (i & 1) ? _mm_unpackhi_epi16(wide[i / 2], zero) : _mm_unpacklo_epi16(wide[i / 2], zero);
+            __m128i a = _mm_shuffle_epi32(c, 0xff);
+            __m128 q = _mm_div_ps(_mm_mul_ps(_mm_cvtepi32_ps(c), scale), _mm_cvtepi32_ps(a));
+            __m128i keep = _mm_or_si128(_mm_cmpeq_epi32(a, zero), alpha_lane);
+
+            /* the old loop stored into a BYTE, keep only the low 8 bits */
+            __m128i color = _mm_and_si128(_mm_cvttps_epi32(q), low);
+            out[i] = _mm_or_si128(_mm_and_si128(keep, c), _mm_andnot_si128(keep, color));
+        }
+
+        v = _mm_packus_epi16(_mm_packs_epi32(out[0], out[1]), _mm_packs_epi32(out[2], out[3]));
+        _mm_storeu_si128((__m128i *)(row + x * 4), v);
+    }
+#endif
+
+    for (; x < width; x++)
+    {
+        BYTE alpha = row[x * 4 + 3];
+
+        if (alpha != 0 && alpha != 255)
+        {
+            row[x * 4] = row[x * 4] * 255 / alpha;
+            row[x * 4 + 1] = row[x * 4 + 1] * 255 / alpha;
+            row[x * 4 + 2] = row[x * 4 + 2] * 255 / alpha;
+        }
+    }
+}
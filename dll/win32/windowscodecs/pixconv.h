@@ -0,0 +1,31 @@
+/*
+ * PROJECT:     ReactOS Windows Imaging Component
+ * LICENSE:     LGPL-2.1+ (https://spdx.org/licenses/LGPL-2.1+)
+ * PURPOSE:     Row conversion kernels for the format converter
+ */
+
+#ifndef WINCODECS_PIXCONV_H
+#define WINCODECS_PIXCONV_H
+
+/* 32 bpp rows are B, G, R, A in memory unless swap is set, then R, G, B, A.
+ * All of these give the same bytes as the per-pixel loops they replace. */
+
+/* 24 bpp to 32 bpp with 255 alpha, and back dropping alpha */
+void pixconv_24_to_32(const BYTE *src, BYTE *dst, UINT width, BOOL swap);
+void pixconv_32_to_24(const BYTE *src, BYTE *dst, UINT width, BOOL swap);
+
+/* 8 bpp gray and 8 bpp indexed to 32 bpp */
+void pixconv_gray8_to_32(const BYTE *src, BYTE *dst, UINT width);
+void pixconv_indexed8_to_32(const BYTE *src, BYTE *dst, UINT width, const UINT *colors);
+
+/* 16 bpp 555 and 565 to 32 bpp, alpha_bit reads the top bit of 5551 */
+void pixconv_555_to_32(const BYTE *src, BYTE *dst, UINT width, BOOL alpha_bit);
+void pixconv_565_to_32(const BYTE *src, BYTE *dst, UINT width);
+
+/* In place on 32 bpp rows */
+void pixconv_set_alpha(BYTE *row, UINT width);
+void pixconv_swap_rb(BYTE *row, UINT width);
+void pixconv_premultiply(BYTE *row, UINT width);
+void pixconv_unpremultiply(BYTE *row, UINT width);
+
+#endif /* WINCODECS_PIXCONV_H */
@@ -0,0 +1,327 @@
+/*
+ * PROJECT:     ReactOS Windows Imaging Component
+ * LICENSE:     LGPL-2.1+ (https://spdx.org/licenses/LGPL-2.1+)
+ * PURPOSE:     Separable resampling filters for the bitmap scaler
+ *
+ * Every byte of a pixel is filtered as its own channel. The vertical pass
+ * turns a group of source rows into one row of 16 bit values with 6 bits of
+ * fraction, the horizontal pass turns that row into destination pixels.
+ * Both passes are integer only, so the SSE2 loops give the same results as
+ * the C ones. x86 can't count on SSE2 and stays on the C loops.
+ */
+
+#ifdef WINCODECS_HOST
+#include <typedefs.h>
+#else
+#include "config.h"
+
+#include <stdarg.h>
+
+#include "windef.h"
+#endif
+
+#include <math.h>
+
+#include "resample.h"
+
+#if defined(_M_AMD64) || defined(__x86_64__)
+#define RESAMPLE_SSE2
+#include <emmintrin.h>
+#endif
+
+#define ONE             (1 << RESAMPLE_WEIGHT_BITS)
+#define ROW_SHIFT       (RESAMPLE_WEIGHT_BITS - 6)
+#define PIXEL_SHIFT     (RESAMPLE_WEIGHT_BITS + 6)
+
+/* Keys cubic convolution with a = -0.5 */
+static double cubic(double x)
+{
+    x = fabs(x);
+    if (x < 1.0)
+        return (1.5 * x - 2.5) * x * x + 1.0;
+    if (x < 2.0)
+        return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+    return 0.0;
+}
+
+static double center(UINT src, UINT dst, UINT d)
+{
+    return (d + 0.5) * src / dst - 0.5;
+}
+
+/* Source pixels used by destination pixel d, before clamping to the image */
+static void filter_range(resample_kind kind, UINT src, UINT dst, UINT d, INT *first, INT *last)
+{
+    switch (kind)
+    {
+    case RESAMPLE_LINEAR:
+        *first = (INT)floor(center(src, dst, d));
+        *last = *first + 1;
+        break;
+    case RESAMPLE_CUBIC:
+        *first = (INT)floor(center(src, dst, d)) - 1;
+        *last = *first + 3;
+        break;
+    case RESAMPLE_FANT:
+        /* the pixels covered by [d, d + 1) scaled to the source */
+        *first = (INT)((ULONGLONG)d * src / dst);
+        *last = (INT)(((ULONGLONG)(d + 1) * src + dst - 1) / dst) - 1;
+        break;
+    }
+}
+
+static INT clamp_index(INT i, UINT src)
+{
+    if (i < 0) return 0;
+    if (i >= (INT)src) return src - 1;
+    return i;
+}
+
+UINT resample_filter_taps(resample_kind kind, UINT src, UINT dst)
+{
+    UINT d, taps = 1;
+    INT first, last;
+
+    for (d = 0; d < dst; d++)
+    {
+        filter_range(kind, src, dst, d, &first, &last);
+        first = clamp_index(first, src);
+        last = clamp_index(last, src);
+        if ((UINT)(last - first + 1) > taps)
+            taps = last - first + 1;
+    }
+
+    return taps;
+}
+
+/* The arrays of filter must hold dst starts and dst * taps weights */
+void resample_filter_init(resample_filter *filter, resample_kind kind, UINT src, UINT dst)
+{
+    UINT d, k;
+    INT first, last, i;
+
+    for (d = 0; d < dst; d++)
+    {
+        SHORT *weights = filter->weights + d * filter->taps;
+        INT start, total = 0;
+        UINT largest = 0;
+
+        filter_range(kind, src, dst, d, &first, &last);
+        start = clamp_index(first, src);
+        if (start + filter->taps > src)
+            start = src - filter->taps;
+        filter->start[d] = start;
+
+        for (k = 0; k < filter->taps; k++)
+            weights[k] = 0;
+
+        if (kind == RESAMPLE_FANT)
+        {
+            /* Box filter: each pixel counts for its overlap with [x0, x1).
+             * Rounding the running sum keeps the total exact. */
+            double x0 = (double)d * src / dst, x1 = (double)(d + 1) * src / dst;
+            double scale = ONE / (x1 - x0);
+
+            for (i = first; i <= last; i++)
+            {
+                double a = (i > x0 ? i : x0) - x0, b = (i + 1 < x1 ? i + 1 : x1) - x0;
+                weights[clamp_index(i, src) - start] +=
+                    (SHORT)(floor(b * scale + 0.5) - floor(a * scale + 0.5));
+            }
+            continue;
+        }
+
+        /* Linear and cubic: the kernel around the center, pixels outside
+         * the image are replaced by the edge. */
+        for (i = first; i <= last; i++)
+        {
+            double x = i - center(src, dst, d);
+            double w = (kind == RESAMPLE_CUBIC) ? cubic(x) : 1.0 - fabs(x);
+
+            weights[clamp_index(i, src) - start] += (SHORT)floor(w * ONE + 0.5);
+        }
+        for (k = 0; k < filter->taps; k++)
+        {
+            total += weights[k];
+            if (weights[k] > weights[largest])
+                largest = k;
+        }
+        weights[largest] += ONE - total;
+    }
+}
+
+/* VERTICAL PASS **************************************************************/
+
+#ifdef RESAMPLE_SSE2
+/* Two weights for _mm_madd_epi16, as one 32 bit lane */
+static __m128i weight_pair(SHORT low, SHORT high)
+{
+    return _mm_set1_epi32((INT)(((UINT)(USHORT)high << 16) | (USHORT)low));
+}
+
+static UINT vertical_sse2(const SHORT *weights, UINT taps, BYTE * const *rows,
+    UINT offset, UINT bytes, SHORT *out)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(1 << (ROW_SHIFT - 1));
+    UINT i, k;
+
+    for (i = 0; i + 8 <= bytes; i += 8)
+    {
+        __m128i lo = round, hi = round;
+
+        /* rows k and k + 1 interleaved, so madd does both taps at once */
+        for (k = 0; k < taps; k += 2)
+        {
+            __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(rows[k] + offset + i)), zero);
+            __m128i b = zero, w;
+
+            if (k + 1 < taps)
+            {
+                b = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(rows[k + 1] + offset + i)), zero);
+                w = weight_pair(weights[k], weights[k + 1]);
+            }
+            else
+                w = weight_pair(weights[k], 0);
+
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+        }
+
+        lo = _mm_srai_epi32(lo, ROW_SHIFT);
+        hi = _mm_srai_epi32(hi, ROW_SHIFT);
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(lo, hi));
+    }
+
+    return i;
+}
+#endif
+
+void resample_vertical(const resample_filter *filter, UINT dst_y,
+    BYTE * const *rows, UINT offset, UINT bytes, SHORT *out)
+{
+    const SHORT *weights = filter->weights + dst_y * filter->taps;
+    UINT i = 0, k;
+
+#ifdef RESAMPLE_SSE2
+    i = vertical_sse2(weights, filter->taps, rows, offset, bytes, out);
+#endif
+
+    for (; i < bytes; i++)
+    {
+        INT sum = 1 << (ROW_SHIFT - 1);
+
+        for (k = 0; k < filter->taps; k++)
+            sum += weights[k] * rows[k][offset + i];
+        out[i] = (SHORT)(sum >> ROW_SHIFT);
+    }
+}
+
+/* HORIZONTAL PASS ************************************************************/
+
+#ifdef RESAMPLE_SSE2
+static void horizontal4_sse2(const resample_filter *filter, UINT dst_x, UINT count,
+    const SHORT *row, UINT row_x, BYTE *out)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(1 << (PIXEL_SHIFT - 1));
+    UINT i, k, taps = filter->taps;
+
+    for (i = 0; i < count; i++)
+    {
+        const SHORT *weights = filter->weights + (dst_x + i) * taps;
+        const SHORT *src = row + (filter->start[dst_x + i] - row_x) * 4;
+        __m128i sum = round, v;
+
+        /* two neighbouring pixels, channel by channel */
+        for (k = 0; k + 1 < taps; k += 2)
+        {
+            v = _mm_loadu_si128((const __m128i *)(src + k * 4));
+            v = _mm_unpacklo_epi16(v, _mm_srli_si128(v, 8));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(v, weight_pair(weights[k], weights[k + 1])));
+        }
+        if (k < taps)
+        {
+            v = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)(src + k * 4)), zero);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(v, weight_pair(weights[k], 0)));
+        }
+
+        sum = _mm_srai_epi32(sum, PIXEL_SHIFT);
+        sum = _mm_packs_epi32(sum, sum);
+        sum = _mm_packus_epi16(sum, sum);
+        *(UINT *)(out + i * 4) = (UINT)_mm_cvtsi128_si32(sum);
+    }
+}
+
+/* Same with 3 channels, the fourth lane of each load is the next pixel and
+ * gets thrown away. This reads up to 2 values past the last pixel. */
+static void horizontal3_sse2(const resample_filter *filter, UINT dst_x, UINT count,
+    const SHORT *row, UINT row_x, BYTE *out)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(1 << (PIXEL_SHIFT - 1));
+    UINT i, k, taps = filter->taps, pixel;
+
+    for (i = 0; i < count; i++)
+    {
+        const SHORT *weights = filter->weights + (dst_x + i) * taps;
+        const SHORT *src = row + (filter->start[dst_x + i] - row_x) * 3;
+        __m128i sum = round, v;
+
+        for (k = 0; k + 1 < taps; k += 2)
+        {
+            v = _mm_loadu_si128((const __m128i *)(src + k * 3));
+            v = _mm_unpacklo_epi16(v, _mm_srli_si128(v, 6));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(v, weight_pair(weights[k], weights[k + 1])));
+        }
+        if (k < taps)
+        {
+            v = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)(src + k * 3)), zero);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(v, weight_pair(weights[k], 0)));
+        }
+
+        sum = _mm_srai_epi32(sum, PIXEL_SHIFT);
+        sum = _mm_packs_epi32(sum, sum);
+        sum = _mm_packus_epi16(sum, sum);
+        pixel = (UINT)_mm_cvtsi128_si32(sum);
+        out[i * 3] = (BYTE)pixel;
+        out[i * 3 + 1] = (BYTE)(pixel >> 8);
+        out[i * 3 + 2] = (BYTE)(pixel >> 16);
+    }
+}
+#endif
+
+void resample_horizontal(const resample_filter *filter, UINT dst_x, UINT count,
+    UINT channels, const SHORT *row, UINT row_x, BYTE *out)
+{
+    UINT i, c, k;
+
+#ifdef RESAMPLE_SSE2
+    if (channels == 4)
+    {
+        horizontal4_sse2(filter, dst_x, count, row, row_x, out);
+        return;
+    }
+    if (channels == 3)
+    {
+        horizontal3_sse2(filter, dst_x, count, row, row_x, out);
+        return;
+    }
+#endif
+
+    for (i = 0; i < count; i++)
+    {
+        const SHORT *weights = filter->weights + (dst_x + i) * filter->taps;
+        const SHORT *src = row + (filter->start[dst_x + i] - row_x) * channels;
+
+        for (c = 0; c < channels; c++)
+        {
+            INT sum = 1 << (PIXEL_SHIFT - 1);
+
+            for (k = 0; k < filter->taps; k++)
+                sum += weights[k] * src[k * channels + c];
+            sum >>= PIXEL_SHIFT;
+            out[i * channels + c] = sum < 0 ? 0 : (sum > 255 ? 255 : sum);
+        }
+    }
+}
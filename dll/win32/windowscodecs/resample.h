@@ -0,0 +1,43 @@
+/*
+ * PROJECT:     ReactOS Windows Imaging Component
+ * LICENSE:     LGPL-2.1+ (https://spdx.org/licenses/LGPL-2.1+)
+ * PURPOSE:     Separable resampling filters for the bitmap scaler
+ */
+
+#ifndef WINCODECS_RESAMPLE_H
+#define WINCODECS_RESAMPLE_H
+
+/* The weights of a destination pixel add up to 1 << RESAMPLE_WEIGHT_BITS */
+#define RESAMPLE_WEIGHT_BITS    14
+
+typedef enum resample_kind
+{
+    RESAMPLE_LINEAR,
+    RESAMPLE_CUBIC,
+    RESAMPLE_FANT
+} resample_kind;
+
+/* One dimension of the filter: destination pixel d is made of source pixels
+ * start[d] to start[d] + taps - 1, weighted by weights[d * taps + k]. */
+typedef struct resample_filter
+{
+    UINT taps;
+    UINT *start;
+    SHORT *weights;
+} resample_filter;
+
+UINT resample_filter_taps(resample_kind kind, UINT src, UINT dst);
+void resample_filter_init(resample_filter *filter, resample_kind kind, UINT src, UINT dst);
+
+/* rows[k] is source row filter->start[dst_y] + k, out gets bytes values */
+void resample_vertical(const resample_filter *filter, UINT dst_y,
+    BYTE * const *rows, UINT offset, UINT bytes, SHORT *out);
+
+/* row holds the output of resample_vertical, starting at source pixel row_x,
+ * followed by RESAMPLE_ROW_PADDING more values that are read but not used */
+#define RESAMPLE_ROW_PADDING    8
+
+void resample_horizontal(const resample_filter *filter, UINT dst_x, UINT count,
+    UINT channels, const SHORT *row, UINT row_x, BYTE *out);
+
+#endif /* WINCODECS_RESAMPLE_H */
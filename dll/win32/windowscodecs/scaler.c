@@ -28,11 +28,16 @@
 #include "objbase.h"
 
 #include "wincodecs_private.h"
+#include "resample.h"
 
 #include "wine/debug.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(wincodecs);
 
+/* Source rows fetched at once by CopyPixels, unless a single destination
+ * row needs more */
+#define SCALER_BAND_SIZE 0x400000
+
 typedef struct BitmapScaler {
     IWICBitmapScaler IWICBitmapScaler_iface;
     LONG ref;
@@ -44,6 +49,12 @@ typedef struct BitmapScaler {
     UINT bpp;
     void (*fn_get_required_source_rect)(struct BitmapScaler*,UINT,UINT,WICRect*);
     void (*fn_copy_scanline)(struct BitmapScaler*,UINT,UINT,UINT,BYTE**,UINT,UINT,BYTE*);
+    resample_filter filter_x, filter_y; /* linear, cubic and fant */
+    SHORT *filter_row;
+    BYTE *band_bits; /* source rows kept from the last CopyPixels call */
+    BYTE **band_rows;
+    UINT band_size, band_rows_size;
+    WICRect band_rect;
     CRITICAL_SECTION lock; /* must be held when initialized */
 } BitmapScaler;
 
@@ -108,6 +119,13 @@ static ULONG WINAPI BitmapScaler_Release(IWICBitmapScaler *iface)
         This->lock.DebugInfo->Spare[0] = 0;
         DeleteCriticalSection(&This->lock);
         if (This->source) IWICBitmapSource_Release(This->source);
+        HeapFree(GetProcessHeap(), 0, This->filter_x.start);
+        HeapFree(GetProcessHeap(), 0, This->filter_x.weights);
+        HeapFree(GetProcessHeap(), 0, This->filter_y.start);
+        HeapFree(GetProcessHeap(), 0, This->filter_y.weights);
+        HeapFree(GetProcessHeap(), 0, This->filter_row);
+        HeapFree(GetProcessHeap(), 0, This->band_bits);
+        HeapFree(GetProcessHeap(), 0, This->band_rows);
         HeapFree(GetProcessHeap(), 0, This);
     }
 
@@ -205,6 +223,137 @@ static void NearestNeighbor_CopyScanline(BitmapScaler *This,
     }
 }
 
+static void Filter_GetRequiredSourceRect(BitmapScaler *This,
+    UINT x, UINT y, WICRect *src_rect)
+{
+    src_rect->X = This->filter_x.start[x];
+    src_rect->Y = This->filter_y.start[y];
+    src_rect->Width = This->filter_x.taps;
+    src_rect->Height = This->filter_y.taps;
+}
+
+static void Filter_CopyScanline(BitmapScaler *This,
+    UINT dst_x, UINT dst_y, UINT dst_width,
+    BYTE **src_data, UINT src_data_x, UINT src_data_y, BYTE *pbBuffer)
+{
+    UINT bytesperpixel = This->bpp/8;
+    UINT first = This->filter_x.start[dst_x];
+    UINT last = This->filter_x.start[dst_x + dst_width - 1] + This->filter_x.taps;
+
+    /* columns first..last of the source rows, then along the row */
+    resample_vertical(&This->filter_y, dst_y, src_data + This->filter_y.start[dst_y] - src_data_y,
+        (first - src_data_x) * bytesperpixel, (last - first) * bytesperpixel, This->filter_row);
+    resample_horizontal(&This->filter_x, dst_x, dst_width, bytesperpixel,
+        This->filter_row, first, pbBuffer);
+}
+
+static HRESULT init_filter(resample_filter *filter, resample_kind kind, UINT src, UINT dst)
+{
+    HeapFree(GetProcessHeap(), 0, filter->start);
+    HeapFree(GetProcessHeap(), 0, filter->weights);
+
+    filter->taps = resample_filter_taps(kind, src, dst);
+    filter->start = HeapAlloc(GetProcessHeap(), 0, sizeof(UINT) * dst);
+    filter->weights = HeapAlloc(GetProcessHeap(), 0, sizeof(SHORT) * dst * filter->taps);
+    if (!filter->start || !filter->weights)
+        return E_OUTOFMEMORY;
+
+    resample_filter_init(filter, kind, src, dst);
+    return S_OK;
+}
+
+/* Formats where each byte is a channel of its own, the filters work on
+ * those directly */
+static BOOL is_byte_channel_format(const WICPixelFormatGUID *format)
+{
+    static const WICPixelFormatGUID * const formats[] = {
+        &GUID_WICPixelFormat8bppGray,
+        &GUID_WICPixelFormat24bppBGR,
+        &GUID_WICPixelFormat24bppRGB,
+        &GUID_WICPixelFormat32bppBGR,
+        &GUID_WICPixelFormat32bppBGRA,
+        &GUID_WICPixelFormat32bppPBGRA,
+        &GUID_WICPixelFormat32bppRGB,
+        &GUID_WICPixelFormat32bppRGBA,
+        &GUID_WICPixelFormat32bppPRGBA
+    };
+    UINT i;
+
+    for (i = 0; i < ARRAY_SIZE(formats); i++)
+        if (IsEqualGUID(format, formats[i])) return TRUE;
+
+    return FALSE;
+}
+
+/* Makes src_rows point to the source rows top to top+height-1, columns
+ * x to x+width-1. Rows left from the previous band are reused, so callers
+ * going through the image one band or scanline at a time read each source
+ * row only once. */
+static HRESULT load_band(BitmapScaler *This, INT x, INT width, INT top, INT height)
+{
+    UINT stride = (width * This->bpp + 7)/8;
+    INT keep = 0, y;
+    HRESULT hr = S_OK;
+
+    if (This->band_rect.Height && This->band_rect.X == x && This->band_rect.Width == width &&
+        top >= This->band_rect.Y && top < This->band_rect.Y + This->band_rect.Height)
+    {
+        keep = min(This->band_rect.Y + This->band_rect.Height - top, height);
+        memmove(This->band_bits, This->band_bits + (top - This->band_rect.Y) * stride, keep * stride);
+    }
+    This->band_rect.Height = 0;
+
+    if (stride * height > This->band_size)
+    {
+        BYTE *bits = This->band_bits ?
+            HeapReAlloc(GetProcessHeap(), 0, This->band_bits, stride * height) :
+            HeapAlloc(GetProcessHeap(), 0, stride * height);
+        if (!bits) return E_OUTOFMEMORY;
+        This->band_bits = bits;
+        This->band_size = stride * height;
+    }
+
+    if ((UINT)height > This->band_rows_size)
+    {
+        HeapFree(GetProcessHeap(), 0, This->band_rows);
+        This->band_rows = HeapAlloc(GetProcessHeap(), 0, sizeof(BYTE*) * height);
+        This->band_rows_size = This->band_rows ? height : 0;
+        if (!This->band_rows) return E_OUTOFMEMORY;
+    }
+
+    if (keep < height)
+    {
+        WICRect rc;
+
+        rc.X = x;
+        rc.Y = top + keep;
+        rc.Width = width;
+        rc.Height = height - keep;
+        hr = IWICBitmapSource_CopyPixels(This->source, &rc, stride,
+            stride * rc.Height, This->band_bits + keep * stride);
+        if (FAILED(hr)) return hr;
+    }
+
+    for (y=0; y<height; y++)
+        This->band_rows[y] = This->band_bits + y * stride;
+
+    This->band_rect.X = x;
+    This->band_rect.Y = top;
+    This->band_rect.Width = width;
+    This->band_rect.Height = height;
+    return hr;
+}
+
+static void free_band(BitmapScaler *This)
+{
+    HeapFree(GetProcessHeap(), 0, This->band_bits);
+    HeapFree(GetProcessHeap(), 0, This->band_rows);
+    This->band_bits = NULL;
+    This->band_rows = NULL;
+    This->band_size = This->band_rows_size = 0;
+    This->band_rect.Height = 0;
+}
+
 static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
     const WICRect *prc, UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer)
 {
@@ -212,12 +361,9 @@ static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
     HRESULT hr;
     WICRect dest_rect;
     WICRect src_rect_ul, src_rect_br, src_rect;
-    BYTE **src_rows;
-    BYTE *src_bits;
     ULONG bytesperrow;
     ULONG src_bytesperrow;
-    ULONG buffer_size;
-    UINT y;
+    INT y, i, rows;
 
     TRACE("(%p,%s,%u,%u,%p)\n", iface, debug_wic_rect(prc), cbStride, cbBufferSize, pbBuffer);
 
@@ -259,54 +405,54 @@ static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
         goto end;
     }
 
+    if (!dest_rect.Width || !dest_rect.Height)
+    {
+        hr = S_OK;
+        goto end;
+    }
+
     /* MSDN recommends calling CopyPixels once for each scanline from top to
-     * bottom, and claims codecs optimize for this. Ideally, when called in this
-     * way, we should avoid requesting a scanline from the source more than
-     * once, by saving the data that will be useful for the next scanline after
-     * the call returns. The GetRequiredSourceRect/CopyScanline functions are
-     * designed to make it possible to do this in a generic way, but for now we
-     * just grab all the data we need in each call. */
+     * bottom, and claims codecs optimize for this. The source rows are
+     * fetched in bands of at most SCALER_BAND_SIZE bytes, and the rows a
+     * band shares with the next one (or with the next call) are kept, so
+     * each source row is normally requested only once. */
 
     This->fn_get_required_source_rect(This, dest_rect.X, dest_rect.Y, &src_rect_ul);
     This->fn_get_required_source_rect(This, dest_rect.X+dest_rect.Width-1,
         dest_rect.Y+dest_rect.Height-1, &src_rect_br);
 
     src_rect.X = src_rect_ul.X;
-    src_rect.Y = src_rect_ul.Y;
     src_rect.Width = src_rect_br.Width + src_rect_br.X - src_rect_ul.X;
-    src_rect.Height = src_rect_br.Height + src_rect_br.Y - src_rect_ul.Y;
 
     src_bytesperrow = (src_rect.Width * This->bpp + 7)/8;
-    buffer_size = src_bytesperrow * src_rect.Height;
 
-    src_rows = HeapAlloc(GetProcessHeap(), 0, sizeof(BYTE*) * src_rect.Height);
-    src_bits = HeapAlloc(GetProcessHeap(), 0, buffer_size);
-
-    if (!src_rows || !src_bits)
+    hr = S_OK;
+    for (y=0; y < dest_rect.Height && SUCCEEDED(hr); y += rows)
     {
-        HeapFree(GetProcessHeap(), 0, src_rows);
-        HeapFree(GetProcessHeap(), 0, src_bits);
-        hr = E_OUTOFMEMORY;
-        goto end;
-    }
+        This->fn_get_required_source_rect(This, dest_rect.X, dest_rect.Y+y, &src_rect_ul);
+        src_rect.Y = src_rect_ul.Y;
+        src_rect.Height = src_rect_ul.Height;
 
-    for (y=0; y<src_rect.Height; y++)
-        src_rows[y] = src_bits + y * src_bytesperrow;
+        for (rows=1; y+rows < dest_rect.Height; rows++)
+        {
+            This->fn_get_required_source_rect(This, dest_rect.X, dest_rect.Y+y+rows, &src_rect_br);
+            if ((src_rect_br.Y + src_rect_br.Height - src_rect.Y) * src_bytesperrow > SCALER_BAND_SIZE)
+                break;
+            src_rect.Height = src_rect_br.Y + src_rect_br.Height - src_rect.Y;
+        }
 
-    hr = IWICBitmapSource_CopyPixels(This->source, &src_rect, src_bytesperrow,
-        buffer_size, src_bits);
+        hr = load_band(This, src_rect.X, src_rect.Width, src_rect.Y, src_rect.Height);
 
-    if (SUCCEEDED(hr))
-    {
-        for (y=0; y < dest_rect.Height; y++)
+        for (i=0; i < rows && SUCCEEDED(hr); i++)
         {
-            This->fn_copy_scanline(This, dest_rect.X, dest_rect.Y+y, dest_rect.Width,
-                src_rows, src_rect.X, src_rect.Y, pbBuffer + cbStride * y);
+            This->fn_copy_scanline(This, dest_rect.X, dest_rect.Y+y+i, dest_rect.Width,
+                This->band_rows, src_rect.X, src_rect.Y, pbBuffer + cbStride * (y+i));
         }
     }
 
-    HeapFree(GetProcessHeap(), 0, src_rows);
-    HeapFree(GetProcessHeap(), 0, src_bits);
+    /* done with the image, or something went wrong */
+    if (FAILED(hr) || dest_rect.Y + dest_rect.Height == This->height)
+        free_band(This);
 
 end:
     LeaveCriticalSection(&This->lock);
@@ -353,6 +499,46 @@ static HRESULT WINAPI BitmapScaler_Initialize(IWICBitmapScaler *iface,
     {
         switch (mode)
         {
+        case WICBitmapInterpolationModeLinear:
+        case WICBitmapInterpolationModeCubic:
+        case WICBitmapInterpolationModeFant:
+        {
+            resample_kind kind = mode == WICBitmapInterpolationModeLinear ? RESAMPLE_LINEAR :
+                mode == WICBitmapInterpolationModeCubic ? RESAMPLE_CUBIC : RESAMPLE_FANT;
+
+            if (is_byte_channel_format(&src_pixelformat))
+            {
+                IWICBitmapSource_AddRef(pISource);
+                This->source = pISource;
+            }
+            else
+            {
+                hr = WICConvertBitmapSource(&GUID_WICPixelFormat32bppBGRA,
+                    pISource, &This->source);
+                This->bpp = 32;
+            }
+
+            if (SUCCEEDED(hr))
+                hr = init_filter(&This->filter_x, kind, This->src_width, This->width);
+            if (SUCCEEDED(hr))
+                hr = init_filter(&This->filter_y, kind, This->src_height, This->height);
+            if (SUCCEEDED(hr))
+            {
+                HeapFree(GetProcessHeap(), 0, This->filter_row);
+                This->filter_row = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY,
+                    sizeof(SHORT) * (This->src_width * This->bpp/8 + RESAMPLE_ROW_PADDING));
+                if (!This->filter_row) hr = E_OUTOFMEMORY;
+            }
+            if (FAILED(hr) && This->source)
+            {
+                IWICBitmapSource_Release(This->source);
+                This->source = NULL;
+            }
+
+            This->fn_get_required_source_rect = Filter_GetRequiredSourceRect;
+            This->fn_copy_scanline = Filter_CopyScanline;
+            break;
+        }
         default:
             FIXME("unsupported mode %i\n", mode);
             /* fall-through */
@@ -529,6 +715,13 @@ HRESULT BitmapScaler_Create(IWICBitmapScaler **scaler)
     This->src_height = 0;
     This->mode = 0;
     This->bpp = 0;
+    memset(&This->filter_x, 0, sizeof(This->filter_x));
+    memset(&This->filter_y, 0, sizeof(This->filter_y));
+    This->filter_row = NULL;
+    This->band_bits = NULL;
+    This->band_rows = NULL;
+    This->band_size = This->band_rows_size = 0;
+    memset(&This->band_rect, 0, sizeof(This->band_rect));
     InitializeCriticalSection(&This->lock);
     This->lock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": BitmapScaler.lock");
 
@@ -22,13 +22,11 @@
 #include "btrfs_drv.h"
 #include "xxhash.h"
 #include "crc32c.h"
-#ifndef __REACTOS__
-#ifndef _MSC_VER
+#if !defined(_MSC_VER) && !defined(__REACTOS__)
 #include <cpuid.h>
 #else
 #include <intrin.h>
 #endif
-#endif // __REACTOS__
 #include <ntddscsi.h>
 #include "btrfs.h"
 #include <ata.h>
@@ -67,9 +65,7 @@ DEFINE_GUID(BtrfsBusInterface, 0x4d414874, 0x6865, 0x6761, 0x6d, 0x65, 0x83, 0x6
 
 PDRIVER_OBJECT drvobj;
 PDEVICE_OBJECT master_devobj, busobj;
-#ifndef __REACTOS__
 bool have_sse2 = false;
-#endif
 uint64_t num_reads = 0;
 LIST_ENTRY uid_map_list, gid_map_list;
 LIST_ENTRY VcbList;
@@ -5874,19 +5870,33 @@ static void init_serial(bool first_time) {
 }
 #endif
 
-#if !defined(__REACTOS__) && (defined(_X86_) || defined(_AMD64_))
+#if defined(_X86_) || defined(_AMD64_)
 static void check_cpu() {
     unsigned int cpuInfo[4];
-    bool have_sse42;
+    bool have_sse42, have_sse41, have_sha;
 
-#ifndef _MSC_VER
+#if !defined(_MSC_VER) && !defined(__REACTOS__)
     __get_cpuid(1, &cpuInfo[0], &cpuInfo[1], &cpuInfo[2], &cpuInfo[3]);
     have_sse42 = cpuInfo[2] & bit_SSE4_2;
+    have_sse41 = cpuInfo[2] & bit_SSE4_1;
     have_sse2 = cpuInfo[3] & bit_SSE2;
+
+    if (__get_cpuid_count(7, 0, &cpuInfo[0], &cpuInfo[1], &cpuInfo[2], &cpuInfo[3]))
+        have_sha = cpuInfo[1] & bit_SHA;
+    else
+        have_sha = false;
 #else
-    __cpuid(cpuInfo, 1);
+    __cpuid((int*)cpuInfo, 1);
     have_sse42 = cpuInfo[2] & (1 << 20);
+    have_sse41 = cpuInfo[2] & (1 << 19);
     have_sse2 = cpuInfo[3] & (1 << 26);
+
+    __cpuid((int*)cpuInfo, 0);
+    if (cpuInfo[0] >= 7) {
+        __cpuidex((int*)cpuInfo, 7, 0);
+        have_sha = cpuInfo[1] & (1 << 29);
+    } else
+        have_sha = false;
 #endif
 
     if (have_sse42) {
@@ -5899,6 +5909,18 @@ static void check_cpu() {
         TRACE("SSE2 is supported\n");
     else
         TRACE("SSE2 is not supported\n");
+
+#ifdef _AMD64_
+    // x86 would need KeSaveFloatingPointState around every block
+    if (have_sha && have_sse41) {
+        TRACE("SHA extensions are supported\n");
+        sha256_use_shani = true;
+    } else
+        TRACE("SHA extensions not supported\n");
+#else
+    UNUSED(have_sha);
+    UNUSED(have_sse41);
+#endif
 }
 #endif
 
@@ -6196,7 +6218,7 @@ NTSTATUS __stdcall DriverEntry(_In_ PDRIVER_OBJECT DriverObject, _In_ PUNICODE_S
 
     TRACE("DriverEntry\n");
 
-#if !defined(__REACTOS__) && (defined(_X86_) || defined(_AMD64_))
+#if defined(_X86_) || defined(_AMD64_)
     check_cpu();
 #endif
 
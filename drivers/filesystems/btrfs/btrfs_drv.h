@@ -316,6 +316,7 @@ typedef struct _fcb {
     struct _file_ref* fileref;
     bool inode_item_changed;
     enum prop_compression_type prop_compression;
+    uint8_t prop_compression_level;
     LIST_ENTRY xattrs;
     bool marked_as_orphan;
     bool case_sensitive;
@@ -650,7 +651,7 @@ typedef struct {
     LIST_ENTRY list_entry;
     void* in;
     void* out;
-    unsigned int inlen, outlen, off, space_left;
+    unsigned int inlen, outlen, off, space_left, level;
     LONG left, not_started;
     KEVENT event;
     enum calc_thread_type type;
@@ -1245,6 +1246,9 @@ void init_fast_io_dispatch(FAST_IO_DISPATCH** fiod);
 
 // in sha256.c
 void calc_sha256(uint8_t* hash, const void* input, size_t len);
+#ifdef _AMD64_
+extern int sha256_use_shani;
+#endif
 #define SHA256_HASH_SIZE 32
 
 // in blake2b-ref.c
@@ -1554,6 +1558,8 @@ NTSTATUS write_compressed(fcb* fcb, uint64_t start_data, uint64_t end_data, void
 NTSTATUS zlib_compress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, unsigned int level, unsigned int* space_left);
 NTSTATUS lzo_compress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, unsigned int* space_left);
 NTSTATUS zstd_compress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, uint32_t level, unsigned int* space_left);
+void parse_compression_prop(const char* value, uint16_t len, enum prop_compression_type* type, uint8_t* level);
+uint16_t format_compression_prop(enum prop_compression_type type, uint8_t level, char* buf);
 
 // in galois.c
 void galois_double(uint8_t* data, uint32_t len);
@@ -1576,7 +1582,7 @@ void __stdcall calc_thread(void* context);
 void do_calc_job(device_extension* Vcb, uint8_t* data, uint32_t sectors, void* csum);
 NTSTATUS add_calc_job_decomp(device_extension* Vcb, uint8_t compression, void* in, unsigned int inlen,
                              void* out, unsigned int outlen, unsigned int off, calc_job** pcj);
-NTSTATUS add_calc_job_comp(device_extension* Vcb, uint8_t compression, void* in, unsigned int inlen,
+NTSTATUS add_calc_job_comp(device_extension* Vcb, uint8_t compression, unsigned int level, void* in, unsigned int inlen,
                            void* out, unsigned int outlen, calc_job** pcj);
 void calc_thread_main(device_extension* Vcb, calc_job* cj);
 
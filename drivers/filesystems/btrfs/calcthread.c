@@ -19,6 +19,37 @@
 #include "xxhash.h"
 #include "crc32c.h"
 
+// maximum number of sectors a thread takes from a checksum job at once
+#define CALC_BATCH_SECTORS 32
+
+static void calc_csums(device_extension* Vcb, enum calc_thread_type type, uint8_t* src, uint8_t* dest, unsigned int sectors) {
+    for (unsigned int i = 0; i < sectors; i++) {
+        switch (type) {
+            case calc_thread_crc32c:
+                *(uint32_t*)dest = ~calc_crc32c(0xffffffff, src, Vcb->superblock.sector_size);
+            break;
+
+            case calc_thread_xxhash:
+                *(uint64_t*)dest = XXH64(src, Vcb->superblock.sector_size, 0);
+            break;
+
+            case calc_thread_sha256:
+                calc_sha256(dest, src, Vcb->superblock.sector_size);
+            break;
+
+            case calc_thread_blake2:
+                blake2b(dest, BLAKE2_HASH_SIZE, src, Vcb->superblock.sector_size);
+            break;
+
+            default:
+                break;
+        }
+
+        src += Vcb->superblock.sector_size;
+        dest += Vcb->csum_size;
+    }
+}
+
 void calc_thread_main(device_extension* Vcb, calc_job* cj) {
     while (true) {
         KIRQL irql;
@@ -26,6 +57,7 @@ void calc_thread_main(device_extension* Vcb, calc_job* cj) {
         uint8_t* src;
         void* dest;
         bool last_one = false;
+        LONG count = 1;
 
         KeAcquireSpinLock(&Vcb->calcthreads.spinlock, &irql);
 
@@ -53,15 +85,24 @@ void calc_thread_main(device_extension* Vcb, calc_job* cj) {
             case calc_thread_xxhash:
             case calc_thread_sha256:
             case calc_thread_blake2:
-                cj2->in = (uint8_t*)cj2->in + Vcb->superblock.sector_size;
-                cj2->out = (uint8_t*)cj2->out + Vcb->csum_size;
+                // take a share of the remaining sectors, so that the spinlock
+                // isn't acquired for every sector but all threads still get work
+                count = cj2->not_started / (LONG)(Vcb->calcthreads.num_threads + 1);
+
+                if (count < 1)
+                    count = 1;
+                else if (count > CALC_BATCH_SECTORS)
+                    count = CALC_BATCH_SECTORS;
+
+                cj2->in = (uint8_t*)cj2->in + (count * Vcb->superblock.sector_size);
+                cj2->out = (uint8_t*)cj2->out + (count * Vcb->csum_size);
             break;
 
             default:
                 break;
         }
 
-        cj2->not_started--;
+        cj2->not_started -= count;
 
         if (cj2->not_started == 0) {
             RemoveEntryList(&cj2->list_entry);
@@ -72,19 +113,10 @@ void calc_thread_main(device_extension* Vcb, calc_job* cj) {
 
         switch (cj2->type) {
             case calc_thread_crc32c:
-                *(uint32_t*)dest = ~calc_crc32c(0xffffffff, src, Vcb->superblock.sector_size);
-            break;
-
             case calc_thread_xxhash:
-                *(uint64_t*)dest = XXH64(src, Vcb->superblock.sector_size, 0);
-            break;
-
             case calc_thread_sha256:
-                calc_sha256(dest, src, Vcb->superblock.sector_size);
-            break;
-
             case calc_thread_blake2:
-                blake2b(dest, BLAKE2_HASH_SIZE, src, Vcb->superblock.sector_size);
+                calc_csums(Vcb, cj2->type, src, dest, count);
             break;
 
             case calc_thread_decomp_zlib:
@@ -109,7 +141,7 @@ void calc_thread_main(device_extension* Vcb, calc_job* cj) {
             break;
 
             case calc_thread_comp_zlib:
-                cj2->Status = zlib_compress(src, cj2->inlen, dest, cj2->outlen, Vcb->options.zlib_level, &cj2->space_left);
+                cj2->Status = zlib_compress(src, cj2->inlen, dest, cj2->outlen, cj2->level, &cj2->space_left);
 
                 if (!NT_SUCCESS(cj2->Status))
                     ERR("zlib_compress returned %08lx\n", cj2->Status);
@@ -123,14 +155,14 @@ void calc_thread_main(device_extension* Vcb, calc_job* cj) {
             break;
 
             case calc_thread_comp_zstd:
-                cj2->Status = zstd_compress(src, cj2->inlen, dest, cj2->outlen, Vcb->options.zstd_level, &cj2->space_left);
+                cj2->Status = zstd_compress(src, cj2->inlen, dest, cj2->outlen, cj2->level, &cj2->space_left);
 
                 if (!NT_SUCCESS(cj2->Status))
                     ERR("zstd_compress returned %08lx\n", cj2->Status);
             break;
         }
 
-        if (InterlockedDecrement(&cj2->left) == 0)
+        if (InterlockedExchangeAdd(&cj2->left, -count) == count)
             KeSetEvent(&cj2->event, 0, false);
 
         if (last_one)
@@ -234,7 +266,7 @@ NTSTATUS add_calc_job_decomp(device_extension* Vcb, uint8_t compression, void* i
     return STATUS_SUCCESS;
 }
 
-NTSTATUS add_calc_job_comp(device_extension* Vcb, uint8_t compression, void* in, unsigned int inlen,
+NTSTATUS add_calc_job_comp(device_extension* Vcb, uint8_t compression, unsigned int level, void* in, unsigned int inlen,
                            void* out, unsigned int outlen, calc_job** pcj) {
     calc_job* cj;
     KIRQL irql;
@@ -249,6 +281,7 @@ NTSTATUS add_calc_job_comp(device_extension* Vcb, uint8_t compression, void* in,
     cj->inlen = inlen;
     cj->out = out;
     cj->outlen = outlen;
+    cj->level = level;
     cj->left = cj->not_started = 1;
     cj->Status = STATUS_SUCCESS;
 
@@ -26,7 +26,11 @@
 // Modern versions of lzo are licensed under the GPL, but the very oldest
 // versions are under the LGPL and hence okay to use here.
 
+#ifndef BTRFS_HOST
 #include "btrfs_drv.h"
+#else
+#include "btrfs_host.h" // sdk/tools/btrfsbench
+#endif
 
 #define Z_SOLO
 #define ZLIB_INTERNAL
@@ -866,6 +870,9 @@ NTSTATUS zstd_compress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t
     return STATUS_SUCCESS;
 }
 
+#ifndef BTRFS_HOST
+// write_compressed and the property helpers need the whole driver
+
 typedef struct {
     uint8_t buf[COMPRESSED_EXTENT_SIZE];
     uint8_t compression_type;
@@ -874,6 +881,91 @@ typedef struct {
     calc_job* cj;
 } comp_part;
 
+void parse_compression_prop(const char* value, uint16_t len, enum prop_compression_type* type, uint8_t* level) {
+    static const char lzo[] = "lzo";
+    static const char zlib[] = "zlib";
+    static const char zstd[] = "zstd";
+    uint16_t namelen;
+    unsigned int lvl = 0;
+
+    *level = 0;
+
+    if (len >= sizeof(zstd) - 1 && RtlCompareMemory(value, zstd, sizeof(zstd) - 1) == sizeof(zstd) - 1) {
+        *type = PropCompression_ZSTD;
+        namelen = sizeof(zstd) - 1;
+    } else if (len >= sizeof(zlib) - 1 && RtlCompareMemory(value, zlib, sizeof(zlib) - 1) == sizeof(zlib) - 1) {
+        *type = PropCompression_Zlib;
+        namelen = sizeof(zlib) - 1;
+    } else if (len >= sizeof(lzo) - 1 && RtlCompareMemory(value, lzo, sizeof(lzo) - 1) == sizeof(lzo) - 1) {
+        *type = PropCompression_LZO;
+        namelen = sizeof(lzo) - 1;
+    } else {
+        *type = PropCompression_None;
+        return;
+    }
+
+    if (len == namelen)
+        return;
+
+    // "zlib:N" or "zstd:N", as accepted by btrfs-progs
+
+    if (value[namelen] != ':' || len == namelen + 1 || len > namelen + 3 || *type == PropCompression_LZO) {
+        *type = PropCompression_None;
+        return;
+    }
+
+    for (uint16_t i = namelen + 1; i < len; i++) {
+        if (value[i] < '0' || value[i] > '9') {
+            *type = PropCompression_None;
+            return;
+        }
+
+        lvl = (lvl * 10) + value[i] - '0';
+    }
+
+    if (*type == PropCompression_Zlib && lvl > 9)
+        lvl = 9;
+    else if (*type == PropCompression_ZSTD && lvl > (unsigned int)ZSTD_maxCLevel())
+        lvl = ZSTD_maxCLevel();
+
+    *level = (uint8_t)lvl;
+}
+
+// buf must hold at least 8 characters
+uint16_t format_compression_prop(enum prop_compression_type type, uint8_t level, char* buf) {
+    uint16_t len;
+
+    switch (type) {
+        case PropCompression_Zlib:
+            RtlCopyMemory(buf, "zlib", 4);
+            len = 4;
+        break;
+
+        case PropCompression_LZO:
+            RtlCopyMemory(buf, "lzo", 3);
+            return 3;
+
+        case PropCompression_ZSTD:
+            RtlCopyMemory(buf, "zstd", 4);
+            len = 4;
+        break;
+
+        default:
+            return 0;
+    }
+
+    if (level != 0) {
+        buf[len++] = ':';
+
+        if (level >= 10)
+            buf[len++] = '0' + (level / 10);
+
+        buf[len++] = '0' + (level % 10);
+    }
+
+    return len;
+}
+
 NTSTATUS write_compressed(fcb* fcb, uint64_t start_data, uint64_t end_data, void* data, PIRP Irp, LIST_ENTRY* rollback) {
     NTSTATUS Status;
     uint64_t i;
@@ -886,6 +978,7 @@ NTSTATUS write_compressed(fcb* fcb, uint64_t start_data, uint64_t end_data, void
     LIST_ENTRY* le;
     uint64_t address, extaddr;
     void* csum = NULL;
+    unsigned int level = 0;
 #ifdef __REACTOS__
     int32_t i2;
     uint32_t i3, j;
@@ -906,6 +999,12 @@ NTSTATUS write_compressed(fcb* fcb, uint64_t start_data, uint64_t end_data, void
             type = BTRFS_COMPRESSION_ZLIB;
     }
 
+    // a level stored in the file's compression property overrides the volume default
+    if (type == BTRFS_COMPRESSION_ZLIB)
+        level = fcb->prop_compression == PropCompression_Zlib && fcb->prop_compression_level != 0 ? fcb->prop_compression_level : fcb->Vcb->options.zlib_level;
+    else if (type == BTRFS_COMPRESSION_ZSTD)
+        level = fcb->prop_compression == PropCompression_ZSTD && fcb->prop_compression_level != 0 ? fcb->prop_compression_level : fcb->Vcb->options.zstd_level;
+
     Status = excise_extents(fcb->Vcb, fcb, start_data, end_data, Irp, rollback);
     if (!NT_SUCCESS(Status)) {
         ERR("excise_extents returned %08lx\n", Status);
@@ -924,7 +1023,7 @@ NTSTATUS write_compressed(fcb* fcb, uint64_t start_data, uint64_t end_data, void
         else
             parts[i].inlen = COMPRESSED_EXTENT_SIZE;
 
-        Status = add_calc_job_comp(fcb->Vcb, type, (uint8_t*)data + (i * COMPRESSED_EXTENT_SIZE), parts[i].inlen,
+        Status = add_calc_job_comp(fcb->Vcb, type, level, (uint8_t*)data + (i * COMPRESSED_EXTENT_SIZE), parts[i].inlen,
                                    parts[i].buf, parts[i].inlen, &parts[i].cj);
         if (!NT_SUCCESS(Status)) {
             ERR("add_calc_job_comp returned %08lx\n", Status);
@@ -956,7 +1055,7 @@ NTSTATUS write_compressed(fcb* fcb, uint64_t start_data, uint64_t end_data, void
     }
 #else
     for (i2 = num_parts - 1; i2 >= 0; i2--) {
-        calc_thread_main(fcb->Vcb, parts[i].cj);
+        calc_thread_main(fcb->Vcb, parts[i2].cj);
 
         KeWaitForSingleObject(&parts[i2].cj->event, Executive, KernelMode, false, NULL);
 
@@ -1258,3 +1357,5 @@ NTSTATUS write_compressed(fcb* fcb, uint64_t start_data, uint64_t end_data, void
 
     return STATUS_SUCCESS;
 }
+
+#endif // BTRFS_HOST
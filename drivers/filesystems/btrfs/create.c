@@ -1061,20 +1061,8 @@ NTSTATUS open_fcb(_Requires_lock_held_(_Curr_->tree_lock) _Requires_exclusive_lo
                             sd_set = true;
                     }
                 } else if (tp.item->key.offset == EA_PROP_COMPRESSION_HASH && di->n == sizeof(EA_PROP_COMPRESSION) - 1 && RtlCompareMemory(EA_PROP_COMPRESSION, di->name, di->n) == di->n) {
-                    if (di->m > 0) {
-                        static const char lzo[] = "lzo";
-                        static const char zlib[] = "zlib";
-                        static const char zstd[] = "zstd";
-
-                        if (di->m == sizeof(lzo) - 1 && RtlCompareMemory(&di->name[di->n], lzo, di->m) == di->m)
-                            fcb->prop_compression = PropCompression_LZO;
-                        else if (di->m == sizeof(zlib) - 1 && RtlCompareMemory(&di->name[di->n], zlib, di->m) == di->m)
-                            fcb->prop_compression = PropCompression_Zlib;
-                        else if (di->m == sizeof(zstd) - 1 && RtlCompareMemory(&di->name[di->n], zstd, di->m) == di->m)
-                            fcb->prop_compression = PropCompression_ZSTD;
-                        else
-                            fcb->prop_compression = PropCompression_None;
-                    }
+                    if (di->m > 0)
+                        parse_compression_prop(&di->name[di->n], di->m, &fcb->prop_compression, &fcb->prop_compression_level);
                 } else if (tp.item->key.offset == EA_CASE_SENSITIVE_HASH && di->n == sizeof(EA_CASE_SENSITIVE) - 1 && RtlCompareMemory(EA_CASE_SENSITIVE, di->name, di->n) == di->n) {
                     if (di->m > 0) {
                         fcb->case_sensitive = di->m == 1 && di->name[di->n] == '1';
@@ -2313,6 +2301,7 @@ static NTSTATUS file_create2(_In_ PIRP Irp, _Requires_exclusive_lock_held_(_Curr
     }
 
     fcb->prop_compression = parfileref->fcb->prop_compression;
+    fcb->prop_compression_level = parfileref->fcb->prop_compression_level;
     fcb->prop_compression_changed = fcb->prop_compression != PropCompression_None;
 
     fcb->inode_item_changed = true;
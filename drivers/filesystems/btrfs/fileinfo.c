@@ -657,6 +657,7 @@ static NTSTATUS duplicate_fcb(fcb* oldfcb, fcb** pfcb) {
     }
 
     fcb->prop_compression = oldfcb->prop_compression;
+    fcb->prop_compression_level = oldfcb->prop_compression_level;
 
     le = oldfcb->xattrs.Flink;
     while (le != &oldfcb->xattrs) {
@@ -853,6 +854,7 @@ static NTSTATUS create_directory_fcb(device_extension* Vcb, root* r, fcb* parfcb
         fcb->inode_item.flags |= BTRFS_INODE_COMPRESS;
 
     fcb->prop_compression = parfcb->prop_compression;
+    fcb->prop_compression_level = parfcb->prop_compression_level;
     fcb->prop_compression_changed = fcb->prop_compression != PropCompression_None;
 
     fcb->hash_ptrs = ExAllocatePoolWithTag(PagedPool, sizeof(LIST_ENTRY*) * 256, ALLOC_TAG);
@@ -1576,6 +1578,7 @@ static NTSTATUS rename_stream_to_file(device_extension* Vcb, file_ref* fileref,
 
     fileref->fcb->inode_item_changed = true;
     fileref->fcb->prop_compression = ofr->fcb->prop_compression;
+    fileref->fcb->prop_compression_level = ofr->fcb->prop_compression_level;
 
     while (!IsListEmpty(&ofr->fcb->xattrs)) {
         InsertTailList(&fileref->fcb->xattrs, RemoveHeadList(&ofr->fcb->xattrs));
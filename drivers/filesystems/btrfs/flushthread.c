@@ -5275,29 +5275,12 @@ NTSTATUS flush_fcb(fcb* fcb, bool cache, LIST_ENTRY* batchlist, PIRP Irp) {
                 ERR("delete_xattr returned %08lx\n", Status);
                 goto end;
             }
-        } else if (fcb->prop_compression == PropCompression_Zlib) {
-            static const char zlib[] = "zlib";
-
-            Status = set_xattr(fcb->Vcb, batchlist, fcb->subvol, fcb->inode, EA_PROP_COMPRESSION, sizeof(EA_PROP_COMPRESSION) - 1,
-                               EA_PROP_COMPRESSION_HASH, (uint8_t*)zlib, sizeof(zlib) - 1);
-            if (!NT_SUCCESS(Status)) {
-                ERR("set_xattr returned %08lx\n", Status);
-                goto end;
-            }
-        } else if (fcb->prop_compression == PropCompression_LZO) {
-            static const char lzo[] = "lzo";
-
-            Status = set_xattr(fcb->Vcb, batchlist, fcb->subvol, fcb->inode, EA_PROP_COMPRESSION, sizeof(EA_PROP_COMPRESSION) - 1,
-                               EA_PROP_COMPRESSION_HASH, (uint8_t*)lzo, sizeof(lzo) - 1);
-            if (!NT_SUCCESS(Status)) {
-                ERR("set_xattr returned %08lx\n", Status);
-                goto end;
-            }
-        } else if (fcb->prop_compression == PropCompression_ZSTD) {
-            static const char zstd[] = "zstd";
+        } else {
+            char val[8];
+            uint16_t vallen = format_compression_prop(fcb->prop_compression, fcb->prop_compression_level, val);
 
             Status = set_xattr(fcb->Vcb, batchlist, fcb->subvol, fcb->inode, EA_PROP_COMPRESSION, sizeof(EA_PROP_COMPRESSION) - 1,
-                               EA_PROP_COMPRESSION_HASH, (uint8_t*)zstd, sizeof(zstd) - 1);
+                               EA_PROP_COMPRESSION_HASH, (uint8_t*)val, vallen);
             if (!NT_SUCCESS(Status)) {
                 ERR("set_xattr returned %08lx\n", Status);
                 goto end;
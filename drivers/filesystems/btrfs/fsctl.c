@@ -1021,6 +1021,7 @@ static NTSTATUS create_subvol(device_extension* Vcb, PFILE_OBJECT FileObject, vo
         rootfcb->inode_item.flags |= BTRFS_INODE_COMPRESS;
 
     rootfcb->prop_compression = fileref->fcb->prop_compression;
+    rootfcb->prop_compression_level = fileref->fcb->prop_compression_level;
     rootfcb->prop_compression_changed = rootfcb->prop_compression != PropCompression_None;
 
     r->lastinode = rootfcb->inode;
@@ -1419,6 +1420,7 @@ static NTSTATUS set_inode_info(PFILE_OBJECT FileObject, void* data, ULONG length
             break;
         }
 
+        fcb->prop_compression_level = 0;
         fcb->prop_compression_changed = true;
     }
 
@@ -3876,6 +3878,7 @@ static NTSTATUS mknod(device_extension* Vcb, PFILE_OBJECT FileObject, void* data
         fcb->inode_item.flags |= BTRFS_INODE_COMPRESS;
 
     fcb->prop_compression = parfcb->prop_compression;
+    fcb->prop_compression_level = parfcb->prop_compression_level;
     fcb->prop_compression_changed = fcb->prop_compression != PropCompression_None;
 
     fcb->inode_item_changed = true;
@@ -4393,18 +4396,7 @@ static NTSTATUS fsctl_set_xattr(device_extension* Vcb, PFILE_OBJECT FileObject,
         Status = STATUS_SUCCESS;
         goto end;
     } else if (bsxa->namelen == sizeof(EA_PROP_COMPRESSION) - 1 && RtlCompareMemory(bsxa->data, EA_PROP_COMPRESSION, sizeof(EA_PROP_COMPRESSION) - 1) == sizeof(EA_PROP_COMPRESSION) - 1) {
-        static const char lzo[] = "lzo";
-        static const char zlib[] = "zlib";
-        static const char zstd[] = "zstd";
-
-        if (bsxa->valuelen == sizeof(zstd) - 1 && RtlCompareMemory(bsxa->data + bsxa->namelen, zstd, bsxa->valuelen) == bsxa->valuelen)
-            fcb->prop_compression = PropCompression_ZSTD;
-        else if (bsxa->valuelen == sizeof(lzo) - 1 && RtlCompareMemory(bsxa->data + bsxa->namelen, lzo, bsxa->valuelen) == bsxa->valuelen)
-            fcb->prop_compression = PropCompression_LZO;
-        else if (bsxa->valuelen == sizeof(zlib) - 1 && RtlCompareMemory(bsxa->data + bsxa->namelen, zlib, bsxa->valuelen) == bsxa->valuelen)
-            fcb->prop_compression = PropCompression_Zlib;
-        else
-            fcb->prop_compression = PropCompression_None;
+        parse_compression_prop(bsxa->data + bsxa->namelen, bsxa->valuelen, &fcb->prop_compression, &fcb->prop_compression_level);
 
         if (fcb->prop_compression != PropCompression_None) {
             fcb->inode_item.flags |= BTRFS_INODE_COMPRESS;
@@ -1,9 +1,16 @@
 #include <stdint.h>
 #include <string.h>
 
-// Public domain code from https://github.com/amosnier/sha-2
+#if !defined(__REACTOS__) && defined(_AMD64_)
+#include <immintrin.h>
+#endif
+
+#if defined(__REACTOS__) && defined(_AMD64_)
+/* in sha256-amd64.S */
+void __stdcall sha256_block_shani(uint32_t h[8], const uint8_t chunk[64], const uint32_t k[64]);
+#endif
 
-// FIXME - x86 SHA extensions
+// Public domain code from https://github.com/amosnier/sha-2
 
 #define CHUNK_SIZE 64
 #define TOTAL_LEN_LEN 8
@@ -115,6 +122,134 @@ static int calc_chunk(uint8_t chunk[CHUNK_SIZE], struct buffer_state * state)
 	return 1;
 }
 
+/*
+ * Limitations:
+ * - Since input is a pointer in RAM, the data to hash should be in RAM, which could be a problem
+ *   for large data sizes.
+ * - SHA algorithms theoretically operate on bit strings. However, this implementation has no support
+ *   for bit string lengths that are not multiples of eight, and it really operates on arrays of bytes.
+ *   In particular, the len parameter is a number of bytes.
+ */
+static void sha256_block_sw(uint32_t h[8], const uint8_t chunk[CHUNK_SIZE])
+{
+	uint32_t ah[8];
+	unsigned i, j;
+
+	const uint8_t *p = chunk;
+
+	/* Initialize working variables to current hash value: */
+	for (i = 0; i < 8; i++)
+		ah[i] = h[i];
+
+	/* Compression function main loop: */
+	for (i = 0; i < 4; i++) {
+		/*
+		 * The w-array is really w[64], but since we only need
+		 * 16 of them at a time, we save stack by calculating
+		 * 16 at a time.
+		 *
+		 * This optimization was not there initially and the
+		 * rest of the comments about w[64] are kept in their
+		 * initial state.
+		 */
+
+		/*
+		 * create a 64-entry message schedule array w[0..63] of 32-bit words
+		 * (The initial values in w[0..63] don't matter, so many implementations zero them here)
+		 * copy chunk into first 16 words w[0..15] of the message schedule array
+		 */
+		uint32_t w[16];
+
+		for (j = 0; j < 16; j++) {
+			if (i == 0) {
+				w[j] = (uint32_t) p[0] << 24 | (uint32_t) p[1] << 16 |
+					(uint32_t) p[2] << 8 | (uint32_t) p[3];
+				p += 4;
+			} else {
+				/* Extend the first 16 words into the remaining 48 words w[16..63] of the message schedule array: */
+				const uint32_t s0 = right_rot(w[(j + 1) & 0xf], 7) ^ right_rot(w[(j + 1) & 0xf], 18) ^ (w[(j + 1) & 0xf] >> 3);
+				const uint32_t s1 = right_rot(w[(j + 14) & 0xf], 17) ^ right_rot(w[(j + 14) & 0xf], 19) ^ (w[(j + 14) & 0xf] >> 10);
+				w[j] = w[j] + s0 + w[(j + 9) & 0xf] + s1;
+			}
+			{
+				const uint32_t s1 = right_rot(ah[4], 6) ^ right_rot(ah[4], 11) ^ right_rot(ah[4], 25);
+				const uint32_t ch = (ah[4] & ah[5]) ^ (~ah[4] & ah[6]);
+				const uint32_t temp1 = ah[7] + s1 + ch + k[i << 4 | j] + w[j];
+				const uint32_t s0 = right_rot(ah[0], 2) ^ right_rot(ah[0], 13) ^ right_rot(ah[0], 22);
+				const uint32_t maj = (ah[0] & ah[1]) ^ (ah[0] & ah[2]) ^ (ah[1] & ah[2]);
+				const uint32_t temp2 = s0 + maj;
+
+				ah[7] = ah[6];
+				ah[6] = ah[5];
+				ah[5] = ah[4];
+				ah[4] = ah[3] + temp1;
+				ah[3] = ah[2];
+				ah[2] = ah[1];
+				ah[1] = ah[0];
+				ah[0] = temp1 + temp2;
+			}
+		}
+	}
+
+	/* Add the compressed chunk to the current hash value: */
+	for (i = 0; i < 8; i++)
+		h[i] += ah[i];
+}
+
+#ifdef _AMD64_
+/* Set by check_cpu when the CPU has the SHA extensions and SSE4.1 */
+int sha256_use_shani = 0;
+#endif
+
+#if !defined(__REACTOS__) && defined(_AMD64_)
+
+#ifndef _MSC_VER
+__attribute__((target("sha,sse4.1")))
+#endif
+static void sha256_block_shani(uint32_t h[8], const uint8_t chunk[CHUNK_SIZE])
+{
+	const __m128i bswap_mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	__m128i state0, state1, abef_save, cdgh_save, tmp, msg, w[4];
+	unsigned i;
+
+	/* The SHA instructions want the state as ABEF / CDGH */
+	tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&h[0]), 0xb1);	/* CDAB */
+	state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&h[4]), 0x1b);	/* EFGH */
+	state0 = _mm_alignr_epi8(tmp, state1, 8);					/* ABEF */
+	state1 = _mm_blend_epi16(state1, tmp, 0xf0);				/* CDGH */
+
+	abef_save = state0;
+	cdgh_save = state1;
+
+	/* Four rounds per iteration, w[] holds the last 16 message words */
+	for (i = 0; i < 16; i++) {
+		if (i < 4)
+			w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(chunk + (i * 16))), bswap_mask);
+		else {
+			tmp = _mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]);
+			tmp = _mm_add_epi32(tmp, _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4));
+			w[i & 3] = _mm_sha256msg2_epu32(tmp, w[(i + 3) & 3]);
+		}
+
+		msg = _mm_add_epi32(w[i & 3], _mm_loadu_si128((const __m128i*)&k[i * 4]));
+		state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+		msg = _mm_shuffle_epi32(msg, 0x0e);
+		state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+	}
+
+	state0 = _mm_add_epi32(state0, abef_save);
+	state1 = _mm_add_epi32(state1, cdgh_save);
+
+	tmp = _mm_shuffle_epi32(state0, 0x1b);		/* FEBA */
+	state1 = _mm_shuffle_epi32(state1, 0xb1);	/* DCHG */
+	state0 = _mm_blend_epi16(tmp, state1, 0xf0);	/* DCBA */
+	state1 = _mm_alignr_epi8(state1, tmp, 8);	/* HGFE */
+
+	_mm_storeu_si128((__m128i*)&h[0], state0);
+	_mm_storeu_si128((__m128i*)&h[4], state1);
+}
+#endif
+
 /*
  * Limitations:
  * - Since input is a pointer in RAM, the data to hash should be in RAM, which could be a problem
@@ -149,67 +284,18 @@ void calc_sha256(uint8_t* hash, const void* input, size_t len)
 	init_buf_state(&state, input, len);
 
 	while (calc_chunk(chunk, &state)) {
-		uint32_t ah[8];
-
-		const uint8_t *p = chunk;
-
-		/* Initialize working variables to current hash value: */
-		for (i = 0; i < 8; i++)
-			ah[i] = h[i];
-
-		/* Compression function main loop: */
-		for (i = 0; i < 4; i++) {
-			/*
-			 * The w-array is really w[64], but since we only need
-			 * 16 of them at a time, we save stack by calculating
-			 * 16 at a time.
-			 *
-			 * This optimization was not there initially and the
-			 * rest of the comments about w[64] are kept in their
-			 * initial state.
-			 */
-
-			/*
-			 * create a 64-entry message schedule array w[0..63] of 32-bit words
-			 * (The initial values in w[0..63] don't matter, so many implementations zero them here)
-			 * copy chunk into first 16 words w[0..15] of the message schedule array
-			 */
-			uint32_t w[16];
-
-			for (j = 0; j < 16; j++) {
-				if (i == 0) {
-					w[j] = (uint32_t) p[0] << 24 | (uint32_t) p[1] << 16 |
-						(uint32_t) p[2] << 8 | (uint32_t) p[3];
-					p += 4;
-				} else {
-					/* Extend the first 16 words into the remaining 48 words w[16..63] of the message schedule array: */
-					const uint32_t s0 = right_rot(w[(j + 1) & 0xf], 7) ^ right_rot(w[(j + 1) & 0xf], 18) ^ (w[(j + 1) & 0xf] >> 3);
-					const uint32_t s1 = right_rot(w[(j + 14) & 0xf], 17) ^ right_rot(w[(j + 14) & 0xf], 19) ^ (w[(j + 14) & 0xf] >> 10);
-					w[j] = w[j] + s0 + w[(j + 9) & 0xf] + s1;
-				}
-				{
-					const uint32_t s1 = right_rot(ah[4], 6) ^ right_rot(ah[4], 11) ^ right_rot(ah[4], 25);
-					const uint32_t ch = (ah[4] & ah[5]) ^ (~ah[4] & ah[6]);
-					const uint32_t temp1 = ah[7] + s1 + ch + k[i << 4 | j] + w[j];
-					const uint32_t s0 = right_rot(ah[0], 2) ^ right_rot(ah[0], 13) ^ right_rot(ah[0], 22);
-					const uint32_t maj = (ah[0] & ah[1]) ^ (ah[0] & ah[2]) ^ (ah[1] & ah[2]);
-					const uint32_t temp2 = s0 + maj;
-
-					ah[7] = ah[6];
-					ah[6] = ah[5];
-					ah[5] = ah[4];
-					ah[4] = ah[3] + temp1;
-					ah[3] = ah[2];
-					ah[2] = ah[1];
-					ah[1] = ah[0];
-					ah[0] = temp1 + temp2;
-				}
-			}
+#ifdef _AMD64_
+		if (sha256_use_shani) {
+#ifdef __REACTOS__
+			sha256_block_shani(h, chunk, k);
+#else
+			sha256_block_shani(h, chunk);
+#endif
+			continue;
 		}
+#endif
 
-		/* Add the compressed chunk to the current hash value: */
-		for (i = 0; i < 8; i++)
-			h[i] += ah[i];
+		sha256_block_sw(h, chunk);
 	}
 
 	/* Produce the final hash value (big-endian): */
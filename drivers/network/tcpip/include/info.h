@@ -143,6 +143,9 @@ TDI_STATUS InfoTdiQueryGetArptableMIB(TDIEntityID ID,
 				      PNDIS_BUFFER Buffer,
 				      PUINT BufferSize);
 
+TDI_STATUS InfoTdiQueryGetNeighborCacheStats(PNDIS_BUFFER Buffer,
+					     PUINT BufferSize);
+
 TDI_STATUS SetAddressFileInfo(TDIObjectID *ID,
                               PADDRESS_FILE AddrFile,
                               PVOID Buffer,
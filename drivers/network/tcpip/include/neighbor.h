@@ -7,7 +7,14 @@
 
 #pragma once
 
-#define NB_HASHMASK 0xF /* Hash mask for neighbor cache */
+#define NB_INITIAL_BUCKETS 16   /* Initial size of the neighbor hash table */
+#define NB_MAX_BUCKETS     4096 /* The hash table is never grown beyond this */
+#define NB_MAX_LOAD        2    /* Average chain length that triggers a resize */
+#define NB_GROWTH_SHIFT    2    /* The table grows by a factor of 4 */
+
+#define NB_WHEEL_SIZE      256  /* Number of slots in the aging timer wheel (power of 2) */
+#define NB_WHEEL_IDLE      ((ULONG)-1) /* NCE is not on the timer wheel */
+#define NB_GRACE_TICKS     2    /* Ticks an unlinked NCE or table stays allocated */
 
 typedef VOID (*PNEIGHBOR_PACKET_COMPLETE)
     ( PVOID Context, PNDIS_PACKET Packet, NDIS_STATUS Status );
@@ -19,24 +26,47 @@ typedef struct _NEIGHBOR_PACKET {
     PVOID Context;
 } NEIGHBOR_PACKET, *PNEIGHBOR_PACKET;
 
+typedef struct NEIGHBOR_CACHE_BUCKET {
+    struct NEIGHBOR_CACHE_ENTRY * volatile Cache; /* Pointer to cache */
+    KSPIN_LOCK Lock;                    /* Protects writers of the chain */
+} NEIGHBOR_CACHE_BUCKET, *PNEIGHBOR_CACHE_BUCKET;
+
+/* Readers walk the chains without any lock. Writers hold the bucket lock
+ * and publish fully initialized entries only. Unlinked entries and tables
+ * replaced by a resize are freed NB_GRACE_TICKS neighbor ticks later */
 typedef struct NEIGHBOR_CACHE_TABLE {
-    struct NEIGHBOR_CACHE_ENTRY *Cache; /* Pointer to cache */
-    KSPIN_LOCK Lock;                    /* Protecting lock */
+    LIST_ENTRY RetireLink;              /* Entry on retired table list */
+    ULONG RetireTick;                   /* Tick at which it was retired */
+    ULONG Mask;                         /* Number of buckets - 1 */
+    PNEIGHBOR_CACHE_BUCKET Buckets;     /* Bucket array */
 } NEIGHBOR_CACHE_TABLE, *PNEIGHBOR_CACHE_TABLE;
 
 /* Information about a neighbor */
 typedef struct NEIGHBOR_CACHE_ENTRY {
-    struct NEIGHBOR_CACHE_ENTRY *Next;  /* Pointer to next entry */
+    struct NEIGHBOR_CACHE_ENTRY * volatile Next; /* Pointer to next entry */
     UCHAR State;                        /* State of NCE */
-    UINT EventTimer;                    /* Ticks since last event */
-    UINT EventCount;                    /* Number of events */
+    BOOLEAN Unlinked;                   /* NCE was removed from the cache */
+    UINT EventTimer;                    /* Lifetime in ticks, 0 for none */
+    volatile ULONG LastEventTick;       /* Tick of last event */
+    ULONG WheelSlot;                    /* Timer wheel slot or NB_WHEEL_IDLE */
+    LIST_ENTRY WheelLink;               /* Timer wheel or retired list entry */
     PIP_INTERFACE Interface;            /* Pointer to interface */
     UINT LinkAddressLength;             /* Length of link address */
     PVOID LinkAddress;                  /* Pointer to link address */
     IP_ADDRESS Address;                 /* IP address of neighbor */
+    KSPIN_LOCK PacketLock;              /* Protects the packet queue */
     LIST_ENTRY PacketQueue;             /* Packet queue */
 } NEIGHBOR_CACHE_ENTRY, *PNEIGHBOR_CACHE_ENTRY;
 
+typedef struct NEIGHBOR_CACHE_STATISTICS {
+    ULONG Lookups;                      /* Calls to NBLocateNeighbor */
+    ULONG Misses;                       /* Lookups that found nothing */
+    ULONG Evictions;                    /* NCEs aged out by NBTimeout */
+    ULONG Resizes;                      /* Hash table resizes */
+    ULONG Entries;                      /* NCEs currently in the cache */
+    ULONG Buckets;                      /* Current hash table size */
+} NEIGHBOR_CACHE_STATISTICS, *PNEIGHBOR_CACHE_STATISTICS;
+
 /* NCE states */
 #define NUD_INCOMPLETE 0x01
 #define NUD_PERMANENT  0x02
@@ -54,7 +84,7 @@ typedef struct NEIGHBOR_CACHE_ENTRY {
 /* Number of seconds before retransmission */
 #define ARP_TIMEOUT_RETRANSMISSION 3
 
-extern NEIGHBOR_CACHE_TABLE NeighborCache[NB_HASHMASK + 1];
+extern PNEIGHBOR_CACHE_TABLE volatile NeighborCache;
 
 
 VOID NBTimeout(
@@ -109,4 +139,7 @@ VOID NBResetNeighborTimeout(
 
 VOID NBDestroyNeighborsForInterface(PIP_INTERFACE Interface);
 
+VOID NBQueryStatistics(
+    PNEIGHBOR_CACHE_STATISTICS Statistics);
+
 /* EOF */
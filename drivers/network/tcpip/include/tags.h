@@ -23,6 +23,7 @@
 #define OSKITTCP_CONTEXT_TAG 'TKSO'
 #define NEIGHBOR_PACKET_TAG 'kPbN'
 #define NCE_TAG ' ECN'
+#define NCE_TABLE_TAG 'TECN'
 #define PORT_SET_TAG 'teSP'
 #define PACKET_BUFFER_TAG 'fuBP'
 #define FRAGMENT_DATA_TAG 'taDF'
@@ -130,6 +130,15 @@ TDI_STATUS InfoTdiQueryGetArptableMIB(TDIEntityID ID,
     return Status;
 }
 
+TDI_STATUS InfoTdiQueryGetNeighborCacheStats(PNDIS_BUFFER Buffer,
+					     PUINT BufferSize) {
+    NEIGHBOR_CACHE_STATISTICS Statistics;
+
+    NBQueryStatistics( &Statistics );
+
+    return InfoCopyOut( (PCHAR)&Statistics, sizeof(Statistics), Buffer, BufferSize );
+}
+
 TDI_STATUS InfoTdiSetArptableMIB(PIP_INTERFACE IF, PVOID Buffer, UINT BufferSize)
 {
     PIPARP_ENTRY ArpEntry = Buffer;
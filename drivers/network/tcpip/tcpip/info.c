@@ -362,6 +362,16 @@ TDI_STATUS InfoTdiQueryInformationEx(
                  else
                      return TDI_INVALID_PARAMETER;
 
+              case IP_NEIGHBOR_CACHE_STATS_ID:
+                 if (ID->toi_type != INFO_TYPE_PROVIDER)
+                     return TDI_INVALID_PARAMETER;
+
+                 /* The neighbor cache is shared by all interfaces */
+                 if (ID->toi_entity.tei_entity == AT_ENTITY)
+                     return InfoTdiQueryGetNeighborCacheStats(Buffer, BufferSize);
+                 else
+                     return TDI_INVALID_PARAMETER;
+
 #if 0
               case IP_INTFC_INFO_ID:
                  if (ID->toi_type != INFO_TYPE_PROVIDER)
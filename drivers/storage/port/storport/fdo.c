@@ -24,8 +24,8 @@ PortFdoInterruptRoutine(
 {
     PFDO_DEVICE_EXTENSION DeviceExtension;
 
-    DPRINT1("PortFdoInterruptRoutine(%p %p)\n",
-            Interrupt, ServiceContext);
+    DPRINT("PortFdoInterruptRoutine(%p %p)\n",
+           Interrupt, ServiceContext);
 
     DeviceExtension = (PFDO_DEVICE_EXTENSION)ServiceContext;
 
@@ -99,6 +99,65 @@ PortFdoConnectInterrupt(
 }
 
 
+static
+VOID
+PortFdoGetDmaAdapter(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension)
+{
+    PPORT_CONFIGURATION_INFORMATION PortConfig = &DeviceExtension->Miniport.PortConfig;
+    DEVICE_DESCRIPTION DeviceDescription;
+
+    if (DeviceExtension->DmaAdapter != NULL)
+        return;
+
+    /* A transfer that spans more pages than the HAL can list would never start */
+    if (PortConfig->MaximumTransferLength > (PORT_MAXIMUM_SG_ELEMENTS - 1) * PAGE_SIZE)
+        PortConfig->MaximumTransferLength = (PORT_MAXIMUM_SG_ELEMENTS - 1) * PAGE_SIZE;
+    if (PortConfig->NumberOfPhysicalBreaks == 0 ||
+        PortConfig->NumberOfPhysicalBreaks > PORT_MAXIMUM_SG_ELEMENTS - 1)
+        PortConfig->NumberOfPhysicalBreaks = PORT_MAXIMUM_SG_ELEMENTS - 1;
+
+    /* Describe the DMA capabilities the miniport reported in FindAdapter */
+    RtlZeroMemory(&DeviceDescription, sizeof(DeviceDescription));
+    DeviceDescription.Version = DEVICE_DESCRIPTION_VERSION;
+    DeviceDescription.Master = PortConfig->Master;
+    DeviceDescription.ScatterGather = PortConfig->ScatterGather;
+    DeviceDescription.DemandMode = PortConfig->DemandMode;
+    DeviceDescription.Dma32BitAddresses = PortConfig->Dma32BitAddresses;
+    DeviceDescription.Dma64BitAddresses = (PortConfig->Dma64BitAddresses != 0);
+    DeviceDescription.BusNumber = PortConfig->SystemIoBusNumber;
+    DeviceDescription.DmaChannel = PortConfig->DmaChannel;
+    DeviceDescription.InterfaceType = PortConfig->AdapterInterfaceType;
+    DeviceDescription.DmaWidth = PortConfig->DmaWidth;
+    DeviceDescription.DmaSpeed = PortConfig->DmaSpeed;
+    DeviceDescription.MaximumLength = PortConfig->MaximumTransferLength;
+    DeviceDescription.DmaPort = PortConfig->DmaPort;
+
+    DeviceExtension->DmaAdapter = IoGetDmaAdapter(DeviceExtension->PhysicalDevice,
+                                                  &DeviceDescription,
+                                                  &DeviceExtension->MapRegisterCount);
+    if (DeviceExtension->DmaAdapter == NULL)
+    {
+        /* Requests are still sent, the miniport just gets no scatter/gather lists */
+        DPRINT1("IoGetDmaAdapter() failed\n");
+    }
+
+    DPRINT1("Map registers: %lu\n", DeviceExtension->MapRegisterCount);
+
+    /* What the class drivers size their transfers by */
+    DeviceExtension->PortCapabilities.Length = sizeof(IO_SCSI_CAPABILITIES);
+    DeviceExtension->PortCapabilities.MaximumTransferLength = PortConfig->MaximumTransferLength;
+    DeviceExtension->PortCapabilities.MaximumPhysicalPages = PortConfig->NumberOfPhysicalBreaks + 1;
+    if (DeviceExtension->MapRegisterCount != 0 &&
+        DeviceExtension->MapRegisterCount < DeviceExtension->PortCapabilities.MaximumPhysicalPages)
+        DeviceExtension->PortCapabilities.MaximumPhysicalPages = DeviceExtension->MapRegisterCount;
+    DeviceExtension->PortCapabilities.AlignmentMask = PortConfig->AlignmentMask;
+    DeviceExtension->PortCapabilities.TaggedQueuing = PortConfig->TaggedQueuing;
+    DeviceExtension->PortCapabilities.AdapterScansDown = PortConfig->AdapterScansDown;
+    DeviceExtension->PortCapabilities.AdapterUsesPio = PortConfig->MapBuffers;
+}
+
+
 static
 NTSTATUS
 PortFdoStartMiniport(
@@ -139,6 +198,23 @@ PortFdoStartMiniport(
         return Status;
     }
 
+    /* Get the adapter that builds the scatter/gather lists of the requests */
+    PortFdoGetDmaAdapter(DeviceExtension);
+
+    /* Every request carries an SRB extension of the size the miniport asked for */
+    if (DeviceExtension->Miniport.PortConfig.SrbExtensionSize != 0 &&
+        !DeviceExtension->SrbExtensionLookasideInitialized)
+    {
+        ExInitializeNPagedLookasideList(&DeviceExtension->SrbExtensionLookaside,
+                                        NULL,
+                                        NULL,
+                                        0,
+                                        DeviceExtension->Miniport.PortConfig.SrbExtensionSize,
+                                        TAG_SRB_EXTENSION,
+                                        0);
+        DeviceExtension->SrbExtensionLookasideInitialized = TRUE;
+    }
+
     /* Connect the configured interrupt */
     Status = PortFdoConnectInterrupt(DeviceExtension);
     if (!NT_SUCCESS(Status))
@@ -251,7 +327,6 @@ PortSendInquiry(
     IO_STATUS_BLOCK IoStatusBlock;
     PIO_STACK_LOCATION IrpStack;
     KEVENT Event;
-//    KIRQL Irql;
     PIRP Irp;
     NTSTATUS Status;
     PSENSE_DATA SenseBuffer;
@@ -259,8 +334,6 @@ PortSendInquiry(
     ULONG RetryCount = 0;
     SCSI_REQUEST_BLOCK Srb;
     PCDB Cdb;
-//    PSCSI_PORT_LUN_EXTENSION LunExtension;
-//    PFDO_DEVICE_EXTENSION DeviceExtension;
 
     DPRINT("PortSendInquiry(%p)\n", PdoExtension);
 
@@ -368,25 +441,10 @@ PortSendInquiry(
             /* Something weird happened, deal with it (unfreeze the queue) */
             KeepTrying = FALSE;
 
-            DPRINT("SpiSendInquiry(): the queue is frozen at TargetId %d\n", Srb.TargetId);
+            DPRINT("PortSendInquiry(): the queue is frozen at TargetId %d\n", Srb.TargetId);
 
-//            LunExtension = SpiGetLunExtension(DeviceExtension,
-//                                              LunInfo->PathId,
-//                                              LunInfo->TargetId,
-//                                              LunInfo->Lun);
-
-            /* Clear frozen flag */
-//            LunExtension->Flags &= ~LUNEX_FROZEN_QUEUE;
-
-            /* Acquire the spinlock */
-//            KeAcquireSpinLock(&DeviceExtension->SpinLock, &Irql);
-
-            /* Process the request */
-//            SpiGetNextRequestFromLun(DeviceObject->DeviceExtension, LunExtension);
-
-            /* SpiGetNextRequestFromLun() releases the spinlock,
-                so we just lower irql back to what it was before */
-//            KeLowerIrql(Irql);
+            /* Clear the frozen flag and process the next request */
+            PortReleaseQueue(PdoExtension);
         }
 
         /* Check if data overrun happened */
@@ -555,6 +613,230 @@ PortFdoFilterRequirements(
 }
 
 
+static
+NTSTATUS
+PortStatusSrbToNt(
+    _In_ UCHAR SrbStatus)
+{
+    switch (SRB_STATUS(SrbStatus))
+    {
+        case SRB_STATUS_SUCCESS:
+            return STATUS_SUCCESS;
+
+        case SRB_STATUS_TIMEOUT:
+        case SRB_STATUS_COMMAND_TIMEOUT:
+            return STATUS_IO_TIMEOUT;
+
+        case SRB_STATUS_BAD_SRB_BLOCK_LENGTH:
+        case SRB_STATUS_BAD_FUNCTION:
+            return STATUS_INVALID_DEVICE_REQUEST;
+
+        case SRB_STATUS_NO_DEVICE:
+        case SRB_STATUS_INVALID_LUN:
+        case SRB_STATUS_INVALID_TARGET_ID:
+        case SRB_STATUS_NO_HBA:
+            return STATUS_DEVICE_DOES_NOT_EXIST;
+
+        case SRB_STATUS_DATA_OVERRUN:
+            return STATUS_BUFFER_OVERFLOW;
+
+        case SRB_STATUS_SELECTION_TIMEOUT:
+            return STATUS_DEVICE_NOT_CONNECTED;
+
+        default:
+            return STATUS_IO_DEVICE_ERROR;
+    }
+}
+
+
+VOID
+PortQueueCompletedRequest(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension,
+    _In_ PSCSI_REQUEST_BLOCK Srb)
+{
+    PSCSI_REQUEST_BLOCK ListHead;
+
+    /* Miniports complete requests from their interrupt routine, their DPCs
+       and HwStartIo, so the list has to do without a spin lock */
+    do
+    {
+        ListHead = DeviceExtension->CompletedSrbList;
+        Srb->NextSrb = ListHead;
+    }
+    while (InterlockedCompareExchangePointer((PVOID volatile *)&DeviceExtension->CompletedSrbList,
+                                             Srb,
+                                             ListHead) != ListHead);
+
+    /* Completions arriving before the DPC runs are handled in the same batch */
+    KeInsertQueueDpc(&DeviceExtension->CompletionDpc, NULL, NULL);
+}
+
+
+VOID
+NTAPI
+PortFdoCompletionDpc(
+    _In_ PKDPC Dpc,
+    _In_opt_ PVOID DeferredContext,
+    _In_opt_ PVOID SystemArgument1,
+    _In_opt_ PVOID SystemArgument2)
+{
+    PFDO_DEVICE_EXTENSION DeviceExtension = (PFDO_DEVICE_EXTENSION)DeferredContext;
+    PPDO_DEVICE_EXTENSION PdoExtension, RestartList = NULL;
+    PSCSI_REQUEST_BLOCK Srb, NextSrb, CompletedList = NULL;
+    PPORT_REQUEST_CONTEXT Context;
+    ULONGLONG CurrentTime;
+    ULONG BatchSize = 0;
+    PIRP Irp;
+
+    UNREFERENCED_PARAMETER(Dpc);
+    UNREFERENCED_PARAMETER(SystemArgument1);
+    UNREFERENCED_PARAMETER(SystemArgument2);
+
+    /* Take all completed requests, the list is newest first */
+    Srb = InterlockedExchangePointer((PVOID volatile *)&DeviceExtension->CompletedSrbList, NULL);
+    while (Srb != NULL)
+    {
+        NextSrb = Srb->NextSrb;
+        Srb->NextSrb = CompletedList;
+        CompletedList = Srb;
+        Srb = NextSrb;
+    }
+
+    if (CompletedList == NULL)
+        return;
+
+    CurrentTime = KeQueryInterruptTime();
+
+    /* Account for the whole batch under a single acquisition of the lock */
+    KeAcquireSpinLockAtDpcLevel(&DeviceExtension->StartIoLock);
+
+    for (Srb = CompletedList; Srb != NULL; Srb = Srb->NextSrb)
+    {
+        Irp = (PIRP)Srb->OriginalRequest;
+        Context = PortGetRequestContext(Irp);
+        PdoExtension = (PPDO_DEVICE_EXTENSION)IoGetCurrentIrpStackLocation(Irp)->DeviceObject->DeviceExtension;
+
+        /* Requests completed by HwBuildIo never took a slot */
+        if (Context->Flags & PORT_REQUEST_STARTED)
+        {
+            ASSERT(PdoExtension->OutstandingCount != 0);
+            PdoExtension->OutstandingCount--;
+
+            PdoExtension->ActiveSrbs[Srb->QueueTag] = NULL;
+            if (Context->Flags & PORT_REQUEST_TAGGED)
+                RtlClearBits(&PdoExtension->QueueTagBitmap, Srb->QueueTag, 1);
+            else
+                PdoExtension->Flags &= ~LUNEX_UNTAGGED_ACTIVE;
+        }
+
+        if (Srb->SrbFlags & SRB_FLAGS_DATA_IN)
+            PdoExtension->Statistics.ReadRequests++;
+        else if (Srb->SrbFlags & SRB_FLAGS_DATA_OUT)
+            PdoExtension->Statistics.WriteRequests++;
+        PdoExtension->Statistics.TotalLatency += CurrentTime - Context->StartTime;
+
+        if (SRB_STATUS(Srb->SrbStatus) == SRB_STATUS_SUCCESS)
+        {
+            if (Srb->SrbFlags & SRB_FLAGS_DATA_IN)
+                PdoExtension->Statistics.BytesRead += Srb->DataTransferLength;
+            else if (Srb->SrbFlags & SRB_FLAGS_DATA_OUT)
+                PdoExtension->Statistics.BytesWritten += Srb->DataTransferLength;
+        }
+        else
+        {
+            PdoExtension->Statistics.FailedRequests++;
+
+            /* Freeze the queue until the class driver releases it */
+            if (!(Srb->SrbFlags & SRB_FLAGS_NO_QUEUE_FREEZE))
+            {
+                PdoExtension->Flags |= LUNEX_FROZEN_QUEUE;
+                Srb->SrbStatus |= SRB_STATUS_QUEUE_FROZEN;
+            }
+        }
+
+        /* Remember each logical unit once, its queue is refilled below */
+        if (!(PdoExtension->Flags & LUNEX_NEEDS_RESTART))
+        {
+            PdoExtension->Flags |= LUNEX_NEEDS_RESTART;
+            PdoExtension->NextRestart = RestartList;
+            RestartList = PdoExtension;
+        }
+
+        BatchSize++;
+    }
+
+    DeviceExtension->CompletionBatches++;
+    if (BatchSize > DeviceExtension->MaximumCompletionBatch)
+        DeviceExtension->MaximumCompletionBatch = BatchSize;
+
+    KeReleaseSpinLockFromDpcLevel(&DeviceExtension->StartIoLock);
+
+    /* Refill the device queues before completing, so the device stays busy */
+    while (RestartList != NULL)
+    {
+        PdoExtension = RestartList;
+        RestartList = PdoExtension->NextRestart;
+
+        KeAcquireSpinLockAtDpcLevel(&DeviceExtension->StartIoLock);
+        PdoExtension->Flags &= ~LUNEX_NEEDS_RESTART;
+        KeReleaseSpinLockFromDpcLevel(&DeviceExtension->StartIoLock);
+
+        PortStartNextRequests(PdoExtension);
+    }
+
+    /* Complete the IRPs, the SRBs may be freed by the completion routines */
+    for (Srb = CompletedList; Srb != NULL; Srb = NextSrb)
+    {
+        NextSrb = Srb->NextSrb;
+        Srb->NextSrb = NULL;
+        Irp = (PIRP)Srb->OriginalRequest;
+
+        if (Srb->SrbExtension != NULL)
+        {
+            ExFreeToNPagedLookasideList(&DeviceExtension->SrbExtensionLookaside,
+                                        Srb->SrbExtension);
+            Srb->SrbExtension = NULL;
+        }
+
+        PortPutScatterGatherList(DeviceExtension, Irp);
+
+        Irp->IoStatus.Status = PortStatusSrbToNt(Srb->SrbStatus);
+        if (SRB_STATUS(Srb->SrbStatus) == SRB_STATUS_SUCCESS ||
+            SRB_STATUS(Srb->SrbStatus) == SRB_STATUS_DATA_OVERRUN)
+            Irp->IoStatus.Information = Srb->DataTransferLength;
+        else
+            Irp->IoStatus.Information = 0;
+
+        IoCompleteRequest(Irp, IO_DISK_INCREMENT);
+    }
+}
+
+
+VOID
+PortPutScatterGatherList(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension,
+    _In_ PIRP Irp)
+{
+    PPORT_REQUEST_CONTEXT Context = PortGetRequestContext(Irp);
+    PSCSI_REQUEST_BLOCK Srb;
+    KIRQL OldIrql;
+
+    if (Context->ScatterGatherList == NULL)
+        return;
+
+    Srb = IoGetCurrentIrpStackLocation(Irp)->Parameters.Scsi.Srb;
+
+    /* Flushes the adapter buffers and releases the map registers */
+    KeRaiseIrql(DISPATCH_LEVEL, &OldIrql);
+    DeviceExtension->DmaAdapter->DmaOperations->PutScatterGatherList(DeviceExtension->DmaAdapter,
+                                                                     Context->ScatterGatherList,
+                                                                     (Srb->SrbFlags & SRB_FLAGS_DATA_OUT) != 0);
+    KeLowerIrql(OldIrql);
+
+    Context->ScatterGatherList = NULL;
+}
+
+
 NTSTATUS
 NTAPI
 PortFdoScsi(
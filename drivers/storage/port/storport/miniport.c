@@ -353,28 +353,84 @@ MiniportHwInterrupt(
 {
     BOOLEAN Result;
 
-    DPRINT1("MiniportHwInterrupt(%p)\n",
-            Miniport);
+    DPRINT("MiniportHwInterrupt(%p)\n",
+           Miniport);
 
     Result = Miniport->InitData->HwInterrupt(&Miniport->MiniportExtension->HwDeviceExtension);
-    DPRINT1("HwInterrupt() returned %u\n", Result);
+    DPRINT("HwInterrupt() returned %u\n", Result);
 
     return Result;
 }
 
 
+BOOLEAN
+MiniportBuildIo(
+    _In_ PMINIPORT Miniport,
+    _In_ PSCSI_REQUEST_BLOCK Srb)
+{
+    BOOLEAN Result;
+
+    DPRINT("MiniportBuildIo(%p %p)\n",
+           Miniport, Srb);
+
+    /* HwBuildIo is optional */
+    if (Miniport->InitData->HwBuildIo == NULL)
+        return TRUE;
+
+    Result = Miniport->InitData->HwBuildIo(&Miniport->MiniportExtension->HwDeviceExtension, Srb);
+    DPRINT("HwBuildIo() returned %u\n", Result);
+
+    return Result;
+}
+
+
+typedef struct _MINIPORT_STARTIO_CONTEXT
+{
+    PMINIPORT Miniport;
+    PSCSI_REQUEST_BLOCK Srb;
+} MINIPORT_STARTIO_CONTEXT, *PMINIPORT_STARTIO_CONTEXT;
+
+static
+BOOLEAN
+NTAPI
+MiniportSynchronizedStartIo(
+    _In_ PVOID SynchronizeContext)
+{
+    PMINIPORT_STARTIO_CONTEXT Context = (PMINIPORT_STARTIO_CONTEXT)SynchronizeContext;
+
+    return Context->Miniport->InitData->HwStartIo(&Context->Miniport->MiniportExtension->HwDeviceExtension,
+                                                  Context->Srb);
+}
+
+
 BOOLEAN
 MiniportStartIo(
     _In_ PMINIPORT Miniport,
     _In_ PSCSI_REQUEST_BLOCK Srb)
 {
+    MINIPORT_STARTIO_CONTEXT Context;
+    PKINTERRUPT Interrupt;
     BOOLEAN Result;
 
-    DPRINT1("MiniportHwStartIo(%p %p)\n",
-            Miniport, Srb);
+    DPRINT("MiniportHwStartIo(%p %p)\n",
+           Miniport, Srb);
 
-    Result = Miniport->InitData->HwStartIo(&Miniport->MiniportExtension->HwDeviceExtension, Srb);
-    DPRINT1("HwStartIo() returned %u\n", Result);
+    /* Half duplex miniports expect HwStartIo to be synchronized with HwInterrupt */
+    Interrupt = Miniport->DeviceExtension->Interrupt;
+    if (Interrupt != NULL &&
+        Miniport->PortConfig.SynchronizationModel == StorSynchronizeHalfDuplex)
+    {
+        Context.Miniport = Miniport;
+        Context.Srb = Srb;
+        Result = KeSynchronizeExecution(Interrupt,
+                                        MiniportSynchronizedStartIo,
+                                        &Context);
+    }
+    else
+    {
+        Result = Miniport->InitData->HwStartIo(&Miniport->MiniportExtension->HwDeviceExtension, Srb);
+    }
+    DPRINT("HwStartIo() returned %u\n", Result);
 
     return Result;
 }
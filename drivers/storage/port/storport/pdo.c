@@ -58,6 +58,42 @@ PortCreatePdo(
     DeviceExtension->FdoExtension = FdoDeviceExtension;
     DeviceExtension->PnpState = dsStopped;
 
+    DeviceExtension->Bus = Bus;
+    DeviceExtension->Target = Target;
+    DeviceExtension->Lun = Lun;
+
+    /* Allocate the logical unit extension of the miniport */
+    if (FdoDeviceExtension->Miniport.PortConfig.SpecificLuExtensionSize != 0)
+    {
+        DeviceExtension->LuExtension = ExAllocatePoolWithTag(NonPagedPool,
+                                                             FdoDeviceExtension->Miniport.PortConfig.SpecificLuExtensionSize,
+                                                             TAG_LUN_EXTENSION);
+        if (DeviceExtension->LuExtension == NULL)
+        {
+            IoDeleteDevice(Pdo);
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        RtlZeroMemory(DeviceExtension->LuExtension,
+                      FdoDeviceExtension->Miniport.PortConfig.SpecificLuExtensionSize);
+    }
+
+    /* Initialize the request queue */
+    InitializeListHead(&DeviceExtension->RequestQueueHead);
+    if (FdoDeviceExtension->Miniport.PortConfig.MultipleRequestPerLu)
+        DeviceExtension->QueueDepth = PORT_DEFAULT_QUEUE_DEPTH;
+    else
+        DeviceExtension->QueueDepth = 1;
+
+    /* Tag 0 and SP_UNTAGGED are never handed out */
+    RtlInitializeBitMap(&DeviceExtension->QueueTagBitmap,
+                        DeviceExtension->QueueTagBuffer,
+                        PORT_QUEUE_TAG_COUNT);
+    RtlClearAllBits(&DeviceExtension->QueueTagBitmap);
+    RtlSetBits(&DeviceExtension->QueueTagBitmap, 0, 1);
+    RtlSetBits(&DeviceExtension->QueueTagBitmap, SP_UNTAGGED, 1);
+    DeviceExtension->NextQueueTag = 1;
+
     /* Add the PDO to the PDO list*/
     KeAcquireInStackQueuedSpinLock(&FdoDeviceExtension->PdoListLock,
                                    &LockHandle);
@@ -66,14 +102,6 @@ PortCreatePdo(
     FdoDeviceExtension->PdoCount++;
     KeReleaseInStackQueuedSpinLock(&LockHandle);
 
-    DeviceExtension->Bus = Bus;
-    DeviceExtension->Target = Target;
-    DeviceExtension->Lun = Lun;
-
-
-    // FIXME: More initialization
-
-
     /* The device has been initialized */
     Pdo->Flags &= ~DO_DEVICE_INITIALIZING;
 
@@ -98,14 +126,25 @@ PortDeletePdo(
     PdoExtension->FdoExtension->PdoCount--;
     KeReleaseInStackQueuedSpinLock(&LockHandle);
 
+    ASSERT(PdoExtension->OutstandingCount == 0);
+    ASSERT(IsListEmpty(&PdoExtension->RequestQueueHead));
+
+    DPRINT("Reads %I64u (%I64u bytes)  Writes %I64u (%I64u bytes)  Failed %I64u\n",
+           PdoExtension->Statistics.ReadRequests, PdoExtension->Statistics.BytesRead,
+           PdoExtension->Statistics.WriteRequests, PdoExtension->Statistics.BytesWritten,
+           PdoExtension->Statistics.FailedRequests);
+
     if (PdoExtension->InquiryBuffer)
     {
         ExFreePoolWithTag(PdoExtension->InquiryBuffer, TAG_INQUIRY_DATA);
         PdoExtension->InquiryBuffer = NULL;
     }
 
-
-    // FIXME: More uninitialization
+    if (PdoExtension->LuExtension)
+    {
+        ExFreePoolWithTag(PdoExtension->LuExtension, TAG_LUN_EXTENSION);
+        PdoExtension->LuExtension = NULL;
+    }
 
 
     /* Delete the PDO */
@@ -115,18 +154,550 @@ PortDeletePdo(
 }
 
 
+PPDO_DEVICE_EXTENSION
+PortGetPdoExtension(
+    _In_ PFDO_DEVICE_EXTENSION FdoExtension,
+    _In_ ULONG Bus,
+    _In_ ULONG Target,
+    _In_ ULONG Lun)
+{
+    PPDO_DEVICE_EXTENSION PdoExtension, Result = NULL;
+    KLOCK_QUEUE_HANDLE LockHandle;
+    PLIST_ENTRY ListEntry;
+    BOOLEAN Locked;
+
+    /* Miniports may ask from their interrupt routine. PDOs are only
+       deleted at passive level, so the list is walked unlocked there. */
+    Locked = (KeGetCurrentIrql() <= DISPATCH_LEVEL);
+    if (Locked)
+        KeAcquireInStackQueuedSpinLock(&FdoExtension->PdoListLock, &LockHandle);
+
+    ListEntry = FdoExtension->PdoListHead.Flink;
+    while (ListEntry != &FdoExtension->PdoListHead)
+    {
+        PdoExtension = CONTAINING_RECORD(ListEntry,
+                                         PDO_DEVICE_EXTENSION,
+                                         PdoListEntry);
+        if (PdoExtension->Bus == Bus &&
+            PdoExtension->Target == Target &&
+            PdoExtension->Lun == Lun)
+        {
+            Result = PdoExtension;
+            break;
+        }
+
+        ListEntry = ListEntry->Flink;
+    }
+
+    if (Locked)
+        KeReleaseInStackQueuedSpinLock(&LockHandle);
+
+    return Result;
+}
+
+
+VOID
+PortStartNextRequests(
+    _In_ PPDO_DEVICE_EXTENSION PdoExtension)
+{
+    PFDO_DEVICE_EXTENSION FdoExtension = PdoExtension->FdoExtension;
+    PPORT_REQUEST_CONTEXT Context;
+    PSCSI_REQUEST_BLOCK Srb;
+    KIRQL OldIrql;
+    ULONG QueueTag;
+    PIRP Irp;
+
+    KeAcquireSpinLock(&FdoExtension->StartIoLock, &OldIrql);
+
+    while (!IsListEmpty(&PdoExtension->RequestQueueHead))
+    {
+        Irp = CONTAINING_RECORD(PdoExtension->RequestQueueHead.Flink,
+                                IRP,
+                                Tail.Overlay.ListEntry);
+        Srb = IoGetCurrentIrpStackLocation(Irp)->Parameters.Scsi.Srb;
+        Context = PortGetRequestContext(Irp);
+
+        /* A frozen queue only lets through requests that bypass it */
+        if ((PdoExtension->Flags & LUNEX_FROZEN_QUEUE) &&
+            !(Srb->SrbFlags & SRB_FLAGS_BYPASS_FROZEN_QUEUE))
+            break;
+
+        /* Keep within the queue depth, an untagged request runs alone */
+        if (PdoExtension->OutstandingCount >= PdoExtension->QueueDepth ||
+            (PdoExtension->Flags & LUNEX_UNTAGGED_ACTIVE))
+            break;
+
+        if (PdoExtension->QueueDepth > 1)
+        {
+            /* Hand out tags round robin, so the miniport can index its command slots with them */
+            QueueTag = RtlFindClearBitsAndSet(&PdoExtension->QueueTagBitmap,
+                                              1,
+                                              PdoExtension->NextQueueTag);
+            if (QueueTag == MAXULONG)
+                break;
+
+            PdoExtension->NextQueueTag = QueueTag + 1;
+            Srb->QueueTag = (UCHAR)QueueTag;
+            Context->Flags |= PORT_REQUEST_TAGGED;
+        }
+        else
+        {
+            if (PdoExtension->OutstandingCount != 0)
+                break;
+
+            Srb->QueueTag = SP_UNTAGGED;
+            PdoExtension->Flags |= LUNEX_UNTAGGED_ACTIVE;
+        }
+
+        RemoveHeadList(&PdoExtension->RequestQueueHead);
+        PdoExtension->QueuedCount--;
+
+        if (PdoExtension->OutstandingCount != 0)
+            PdoExtension->Statistics.OverlappedRequests++;
+        PdoExtension->OutstandingCount++;
+        if (PdoExtension->OutstandingCount > PdoExtension->Statistics.MaximumOutstanding)
+            PdoExtension->Statistics.MaximumOutstanding = PdoExtension->OutstandingCount;
+
+        Context->Flags |= PORT_REQUEST_STARTED;
+        PdoExtension->ActiveSrbs[Srb->QueueTag] = Srb;
+
+        /* The miniport may complete the request right away, completions are picked up by the DPC */
+        MiniportStartIo(&FdoExtension->Miniport, Srb);
+    }
+
+    KeReleaseSpinLock(&FdoExtension->StartIoLock, OldIrql);
+}
+
+
+VOID
+PortReleaseQueue(
+    _In_ PPDO_DEVICE_EXTENSION PdoExtension)
+{
+    KIRQL OldIrql;
+
+    DPRINT("PortReleaseQueue(%p)\n", PdoExtension);
+
+    KeAcquireSpinLock(&PdoExtension->FdoExtension->StartIoLock, &OldIrql);
+    PdoExtension->Flags &= ~LUNEX_FROZEN_QUEUE;
+    KeReleaseSpinLock(&PdoExtension->FdoExtension->StartIoLock, OldIrql);
+
+    PortStartNextRequests(PdoExtension);
+}
+
+
+static
+VOID
+PortFlushQueue(
+    _In_ PPDO_DEVICE_EXTENSION PdoExtension)
+{
+    PFDO_DEVICE_EXTENSION FdoExtension = PdoExtension->FdoExtension;
+    LIST_ENTRY FlushedListHead;
+    PSCSI_REQUEST_BLOCK Srb;
+    PLIST_ENTRY ListEntry;
+    KIRQL OldIrql;
+    PIRP Irp;
+
+    DPRINT("PortFlushQueue(%p)\n", PdoExtension);
+
+    InitializeListHead(&FlushedListHead);
+
+    /* Take all waiting requests off the queue and unfreeze it */
+    KeAcquireSpinLock(&FdoExtension->StartIoLock, &OldIrql);
+    while (!IsListEmpty(&PdoExtension->RequestQueueHead))
+    {
+        ListEntry = RemoveHeadList(&PdoExtension->RequestQueueHead);
+        InsertTailList(&FlushedListHead, ListEntry);
+    }
+    PdoExtension->QueuedCount = 0;
+    PdoExtension->Flags &= ~LUNEX_FROZEN_QUEUE;
+    KeReleaseSpinLock(&FdoExtension->StartIoLock, OldIrql);
+
+    /* Complete them, they never reached the miniport */
+    while (!IsListEmpty(&FlushedListHead))
+    {
+        ListEntry = RemoveHeadList(&FlushedListHead);
+        Irp = CONTAINING_RECORD(ListEntry, IRP, Tail.Overlay.ListEntry);
+        Srb = IoGetCurrentIrpStackLocation(Irp)->Parameters.Scsi.Srb;
+
+        if (Srb->SrbExtension != NULL)
+        {
+            ExFreeToNPagedLookasideList(&FdoExtension->SrbExtensionLookaside,
+                                        Srb->SrbExtension);
+            Srb->SrbExtension = NULL;
+        }
+
+        PortPutScatterGatherList(FdoExtension, Irp);
+
+        Srb->SrbStatus = SRB_STATUS_REQUEST_FLUSHED;
+        Irp->IoStatus.Status = STATUS_UNSUCCESSFUL;
+        Irp->IoStatus.Information = 0;
+        IoCompleteRequest(Irp, IO_NO_INCREMENT);
+    }
+}
+
+
+static
+VOID
+PortBuildRequest(
+    _In_ PPDO_DEVICE_EXTENSION PdoExtension,
+    _In_ PIRP Irp,
+    _In_ PSCSI_REQUEST_BLOCK Srb)
+{
+    PFDO_DEVICE_EXTENSION FdoExtension = PdoExtension->FdoExtension;
+
+    /* Let the miniport prepare the request outside of the StartIo lock */
+    if (MiniportBuildIo(&FdoExtension->Miniport, Srb))
+    {
+        KeAcquireSpinLockAtDpcLevel(&FdoExtension->StartIoLock);
+
+        if (Srb->SrbFlags & SRB_FLAGS_BYPASS_FROZEN_QUEUE)
+            InsertHeadList(&PdoExtension->RequestQueueHead, &Irp->Tail.Overlay.ListEntry);
+        else
+            InsertTailList(&PdoExtension->RequestQueueHead, &Irp->Tail.Overlay.ListEntry);
+
+        PdoExtension->QueuedCount++;
+        if (PdoExtension->QueuedCount > PdoExtension->Statistics.MaximumQueued)
+            PdoExtension->Statistics.MaximumQueued = PdoExtension->QueuedCount;
+
+        KeReleaseSpinLockFromDpcLevel(&FdoExtension->StartIoLock);
+
+        PortStartNextRequests(PdoExtension);
+    }
+}
+
+
+static
+VOID
+NTAPI
+PortScatterGatherListReady(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ PIRP Irp,
+    _In_ PSCATTER_GATHER_LIST ScatterGatherList,
+    _In_ PVOID Context)
+{
+    PIRP RequestIrp = (PIRP)Context;
+    PIO_STACK_LOCATION Stack;
+
+    UNREFERENCED_PARAMETER(DeviceObject);
+    UNREFERENCED_PARAMETER(Irp);
+
+    /* Called at DISPATCH_LEVEL once the map registers are allocated */
+    PortGetRequestContext(RequestIrp)->ScatterGatherList = ScatterGatherList;
+
+    Stack = IoGetCurrentIrpStackLocation(RequestIrp);
+    PortBuildRequest((PPDO_DEVICE_EXTENSION)Stack->DeviceObject->DeviceExtension,
+                     RequestIrp,
+                     Stack->Parameters.Scsi.Srb);
+}
+
+
+static
+NTSTATUS
+PortQueueRequest(
+    _In_ PPDO_DEVICE_EXTENSION PdoExtension,
+    _In_ PIRP Irp,
+    _In_ PSCSI_REQUEST_BLOCK Srb)
+{
+    PFDO_DEVICE_EXTENSION FdoExtension = PdoExtension->FdoExtension;
+    PDMA_ADAPTER DmaAdapter = FdoExtension->DmaAdapter;
+    PPORT_REQUEST_CONTEXT Context;
+    NTSTATUS Status;
+    KIRQL OldIrql;
+
+    DPRINT("PortQueueRequest(%p %p %p)\n", PdoExtension, Irp, Srb);
+
+    Srb->OriginalRequest = Irp;
+    Srb->SrbStatus = SRB_STATUS_PENDING;
+    Srb->SrbExtension = NULL;
+
+    if (FdoExtension->SrbExtensionLookasideInitialized)
+    {
+        Srb->SrbExtension = ExAllocateFromNPagedLookasideList(&FdoExtension->SrbExtensionLookaside);
+        if (Srb->SrbExtension == NULL)
+            return STATUS_INSUFFICIENT_RESOURCES;
+
+        RtlZeroMemory(Srb->SrbExtension,
+                      FdoExtension->Miniport.PortConfig.SrbExtensionSize);
+    }
+
+    Context = PortGetRequestContext(Irp);
+    Context->StartTime = KeQueryInterruptTime();
+    Context->Flags = 0;
+    Context->ScatterGatherList = NULL;
+
+    /* The HAL drops transfers it can't describe, reject them here instead */
+    if (DmaAdapter != NULL &&
+        Srb->DataTransferLength != 0 &&
+        ADDRESS_AND_SIZE_TO_SPAN_PAGES(Srb->DataBuffer, Srb->DataTransferLength) > PORT_MAXIMUM_SG_ELEMENTS)
+    {
+        DPRINT1("Transfer of %lu bytes at %p needs too many map registers\n",
+                Srb->DataTransferLength, Srb->DataBuffer);
+
+        if (Srb->SrbExtension != NULL)
+        {
+            ExFreeToNPagedLookasideList(&FdoExtension->SrbExtensionLookaside,
+                                        Srb->SrbExtension);
+            Srb->SrbExtension = NULL;
+        }
+
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    IoMarkIrpPending(Irp);
+
+    KeRaiseIrql(DISPATCH_LEVEL, &OldIrql);
+
+    if (DmaAdapter != NULL &&
+        Irp->MdlAddress != NULL &&
+        Srb->DataTransferLength != 0 &&
+        (Srb->SrbFlags & (SRB_FLAGS_DATA_IN | SRB_FLAGS_DATA_OUT)))
+    {
+        /* HwBuildIo reads the list, so the request is built once it exists */
+        Status = DmaAdapter->DmaOperations->GetScatterGatherList(DmaAdapter,
+                                                                 FdoExtension->Device,
+                                                                 Irp->MdlAddress,
+                                                                 Srb->DataBuffer,
+                                                                 Srb->DataTransferLength,
+                                                                 PortScatterGatherListReady,
+                                                                 Irp,
+                                                                 (Srb->SrbFlags & SRB_FLAGS_DATA_OUT) != 0);
+        if (!NT_SUCCESS(Status))
+        {
+            DPRINT1("GetScatterGatherList() failed (Status 0x%08lx)\n", Status);
+
+            if (Srb->SrbExtension != NULL)
+            {
+                ExFreeToNPagedLookasideList(&FdoExtension->SrbExtensionLookaside,
+                                            Srb->SrbExtension);
+                Srb->SrbExtension = NULL;
+            }
+
+            /* The IRP is already marked pending */
+            Srb->SrbStatus = SRB_STATUS_ERROR;
+            Irp->IoStatus.Status = Status;
+            Irp->IoStatus.Information = 0;
+            IoCompleteRequest(Irp, IO_NO_INCREMENT);
+        }
+    }
+    else
+    {
+        PortBuildRequest(PdoExtension, Irp, Srb);
+    }
+
+    KeLowerIrql(OldIrql);
+
+    return STATUS_PENDING;
+}
+
+
+static
+NTSTATUS
+PortPdoQueryProperty(
+    _In_ PPDO_DEVICE_EXTENSION PdoExtension,
+    _In_ PIRP Irp,
+    _Out_ PULONG_PTR Information)
+{
+    PIO_SCSI_CAPABILITIES PortCapabilities = &PdoExtension->FdoExtension->PortCapabilities;
+    PIO_STACK_LOCATION Stack = IoGetCurrentIrpStackLocation(Irp);
+    PSTORAGE_PROPERTY_QUERY Query = Irp->AssociatedIrp.SystemBuffer;
+    STORAGE_ADAPTER_DESCRIPTOR Descriptor;
+    ULONG Length;
+
+    if (Stack->Parameters.DeviceIoControl.InputBufferLength < FIELD_OFFSET(STORAGE_PROPERTY_QUERY, AdditionalParameters))
+        return STATUS_INVALID_PARAMETER;
+
+    /* Only the adapter limits are known here */
+    if (Query->PropertyId != StorageAdapterProperty)
+        return STATUS_NOT_SUPPORTED;
+
+    if (Query->QueryType == PropertyExistsQuery)
+        return STATUS_SUCCESS;
+
+    if (Query->QueryType != PropertyStandardQuery)
+        return STATUS_INVALID_PARAMETER;
+
+    RtlZeroMemory(&Descriptor, sizeof(Descriptor));
+    Descriptor.Version = sizeof(STORAGE_ADAPTER_DESCRIPTOR);
+    Descriptor.Size = sizeof(STORAGE_ADAPTER_DESCRIPTOR);
+    Descriptor.MaximumTransferLength = PortCapabilities->MaximumTransferLength;
+    Descriptor.MaximumPhysicalPages = PortCapabilities->MaximumPhysicalPages;
+    Descriptor.AlignmentMask = PortCapabilities->AlignmentMask;
+    Descriptor.AdapterUsesPio = PortCapabilities->AdapterUsesPio;
+    Descriptor.AdapterScansDown = PortCapabilities->AdapterScansDown;
+    Descriptor.CommandQueueing = PortCapabilities->TaggedQueuing;
+    Descriptor.AcceleratedTransfer = TRUE;
+    Descriptor.BusType = BusTypeUnknown;
+
+    /* A short buffer gets the header, so the caller learns the size */
+    Length = min(Stack->Parameters.DeviceIoControl.OutputBufferLength, sizeof(Descriptor));
+    if (Length < sizeof(STORAGE_DESCRIPTOR_HEADER))
+        return STATUS_BUFFER_TOO_SMALL;
+
+    RtlCopyMemory(Irp->AssociatedIrp.SystemBuffer, &Descriptor, Length);
+    *Information = Length;
+    return STATUS_SUCCESS;
+}
+
+
+NTSTATUS
+NTAPI
+PortPdoDeviceControl(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ PIRP Irp)
+{
+    PPDO_DEVICE_EXTENSION DeviceExtension;
+    PFDO_DEVICE_EXTENSION FdoExtension;
+    PIO_STACK_LOCATION Stack;
+    ULONG_PTR Information = 0;
+    NTSTATUS Status;
+    KIRQL OldIrql;
+
+    DPRINT("PortPdoDeviceControl(%p %p)\n", DeviceObject, Irp);
+
+    DeviceExtension = (PPDO_DEVICE_EXTENSION)DeviceObject->DeviceExtension;
+    ASSERT(DeviceExtension);
+    ASSERT(DeviceExtension->ExtensionType == PdoExtension);
+    FdoExtension = DeviceExtension->FdoExtension;
+
+    Stack = IoGetCurrentIrpStackLocation(Irp);
+
+    switch (Stack->Parameters.DeviceIoControl.IoControlCode)
+    {
+        case IOCTL_STORPORT_QUERY_LUN_STATISTICS:
+            DPRINT("IOCTL_STORPORT_QUERY_LUN_STATISTICS\n");
+            if (Stack->Parameters.DeviceIoControl.OutputBufferLength < sizeof(PORT_LUN_STATISTICS))
+            {
+                Status = STATUS_BUFFER_TOO_SMALL;
+                break;
+            }
+
+            /* Take a consistent snapshot, the completion DPC updates them under the same lock */
+            KeAcquireSpinLock(&FdoExtension->StartIoLock, &OldIrql);
+            RtlCopyMemory(Irp->AssociatedIrp.SystemBuffer,
+                          &DeviceExtension->Statistics,
+                          sizeof(PORT_LUN_STATISTICS));
+            KeReleaseSpinLock(&FdoExtension->StartIoLock, OldIrql);
+
+            Information = sizeof(PORT_LUN_STATISTICS);
+            Status = STATUS_SUCCESS;
+            break;
+
+        case IOCTL_SCSI_GET_CAPABILITIES:
+            DPRINT("IOCTL_SCSI_GET_CAPABILITIES\n");
+            if (Stack->Parameters.DeviceIoControl.OutputBufferLength == sizeof(PVOID))
+            {
+                *((PVOID *)Irp->AssociatedIrp.SystemBuffer) = &FdoExtension->PortCapabilities;
+                Information = sizeof(PVOID);
+                Status = STATUS_SUCCESS;
+                break;
+            }
+
+            if (Stack->Parameters.DeviceIoControl.OutputBufferLength < sizeof(IO_SCSI_CAPABILITIES))
+            {
+                Status = STATUS_BUFFER_TOO_SMALL;
+                break;
+            }
+
+            RtlCopyMemory(Irp->AssociatedIrp.SystemBuffer,
+                          &FdoExtension->PortCapabilities,
+                          sizeof(IO_SCSI_CAPABILITIES));
+            Information = sizeof(IO_SCSI_CAPABILITIES);
+            Status = STATUS_SUCCESS;
+            break;
+
+        case IOCTL_STORAGE_QUERY_PROPERTY:
+            DPRINT("IOCTL_STORAGE_QUERY_PROPERTY\n");
+            Status = PortPdoQueryProperty(DeviceExtension, Irp, &Information);
+            break;
+
+        default:
+            /* Not handled yet, complete it like the FDO does */
+            DPRINT1("Unhandled IOCTL 0x%08lx\n",
+                    Stack->Parameters.DeviceIoControl.IoControlCode);
+            Status = STATUS_SUCCESS;
+            break;
+    }
+
+    Irp->IoStatus.Information = Information;
+    Irp->IoStatus.Status = Status;
+    IoCompleteRequest(Irp, IO_NO_INCREMENT);
+    return Status;
+}
+
+
 NTSTATUS
 NTAPI
 PortPdoScsi(
     _In_ PDEVICE_OBJECT DeviceObject,
     _In_ PIRP Irp)
 {
-    DPRINT1("PortPdoScsi(%p %p)\n", DeviceObject, Irp);
+    PPDO_DEVICE_EXTENSION DeviceExtension;
+    PIO_STACK_LOCATION Stack;
+    PSCSI_REQUEST_BLOCK Srb;
+    NTSTATUS Status;
+
+    DPRINT("PortPdoScsi(%p %p)\n", DeviceObject, Irp);
+
+    DeviceExtension = (PPDO_DEVICE_EXTENSION)DeviceObject->DeviceExtension;
+    ASSERT(DeviceExtension);
+    ASSERT(DeviceExtension->ExtensionType == PdoExtension);
+
+    Stack = IoGetCurrentIrpStackLocation(Irp);
+    Srb = Stack->Parameters.Scsi.Srb;
+    if (Srb == NULL)
+    {
+        DPRINT1("PortPdoScsi() called with Srb = NULL!\n");
+        Status = STATUS_UNSUCCESSFUL;
+        Irp->IoStatus.Information = 0;
+        Irp->IoStatus.Status = Status;
+        IoCompleteRequest(Irp, IO_NO_INCREMENT);
+        return Status;
+    }
+
+    switch (Srb->Function)
+    {
+        case SRB_FUNCTION_CLAIM_DEVICE:
+        case SRB_FUNCTION_ATTACH_DEVICE:
+            DPRINT("SRB_FUNCTION_CLAIM_DEVICE or ATTACH\n");
+            Srb->DataBuffer = DeviceObject;
+            Srb->SrbStatus = SRB_STATUS_SUCCESS;
+            Status = STATUS_SUCCESS;
+            break;
+
+        case SRB_FUNCTION_RELEASE_DEVICE:
+            DPRINT("SRB_FUNCTION_RELEASE_DEVICE\n");
+            Srb->SrbStatus = SRB_STATUS_SUCCESS;
+            Status = STATUS_SUCCESS;
+            break;
+
+        case SRB_FUNCTION_RELEASE_QUEUE:
+            DPRINT("SRB_FUNCTION_RELEASE_QUEUE\n");
+            PortReleaseQueue(DeviceExtension);
+            Srb->SrbStatus = SRB_STATUS_SUCCESS;
+            Status = STATUS_SUCCESS;
+            break;
+
+        case SRB_FUNCTION_FLUSH_QUEUE:
+            DPRINT("SRB_FUNCTION_FLUSH_QUEUE\n");
+            PortFlushQueue(DeviceExtension);
+            Srb->SrbStatus = SRB_STATUS_SUCCESS;
+            Status = STATUS_SUCCESS;
+            break;
+
+        default:
+            /* Everything else goes to the miniport */
+            Status = PortQueueRequest(DeviceExtension, Irp, Srb);
+            if (Status == STATUS_PENDING)
+                return Status;
+
+            Srb->SrbStatus = SRB_STATUS_ERROR;
+            break;
+    }
 
     Irp->IoStatus.Information = 0;
-    Irp->IoStatus.Status = STATUS_SUCCESS;
+    Irp->IoStatus.Status = Status;
     IoCompleteRequest(Irp, IO_NO_INCREMENT);
-    return STATUS_SUCCESS;
+    return Status;
 }
 
 
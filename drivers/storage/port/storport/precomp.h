@@ -22,6 +22,8 @@
 #include <mountdev.h>
 #include <wdmguid.h>
 
+#include <drivers/storport/ntddstorport.h>
+
 /* Memory Tags */
 #define TAG_GLOBAL_DATA     'DGtS'
 #define TAG_INIT_DATA       'DItS'
@@ -31,6 +33,31 @@
 #define TAG_ADDRESS_MAPPING 'MAtS'
 #define TAG_INQUIRY_DATA    'QItS'
 #define TAG_SENSE_DATA      'NStS'
+#define TAG_LUN_EXTENSION   'ELtS'
+#define TAG_SRB_EXTENSION   'EStS'
+
+#ifndef SP_UNTAGGED
+#define SP_UNTAGGED ((UCHAR)~0)
+#endif
+
+/* Requests a logical unit may have in flight until the miniport sets its own depth */
+#define PORT_DEFAULT_QUEUE_DEPTH    20
+
+/* Queue tags run from 1 to 254, 0 and SP_UNTAGGED are never handed out */
+#define PORT_MAXIMUM_QUEUE_DEPTH    254
+#define PORT_QUEUE_TAG_COUNT        256
+
+/* Elements the HAL puts into one scatter/gather list (MAX_SG_ELEMENTS) */
+#define PORT_MAXIMUM_SG_ELEMENTS    16
+
+/* Logical unit flags */
+#define LUNEX_FROZEN_QUEUE          0x0001
+#define LUNEX_UNTAGGED_ACTIVE       0x0002
+#define LUNEX_NEEDS_RESTART         0x0004
+
+/* Request flags */
+#define PORT_REQUEST_STARTED        0x0001
+#define PORT_REQUEST_TAGGED         0x0002
 
 typedef enum
 {
@@ -81,6 +108,19 @@ typedef struct _MINIPORT
     PMINIPORT_DEVICE_EXTENSION MiniportExtension;
 } MINIPORT, *PMINIPORT;
 
+/* Port context of a request, kept in the IRP while the port owns it */
+typedef struct _PORT_REQUEST_CONTEXT
+{
+    ULONGLONG StartTime;
+    ULONG Flags;
+    PSCATTER_GATHER_LIST ScatterGatherList;
+} PORT_REQUEST_CONTEXT, *PPORT_REQUEST_CONTEXT;
+
+C_ASSERT(sizeof(PORT_REQUEST_CONTEXT) <= RTL_FIELD_SIZE(IRP, Tail.Overlay.DriverContext));
+
+#define PortGetRequestContext(Irp) \
+    ((PPORT_REQUEST_CONTEXT)(Irp)->Tail.Overlay.DriverContext)
+
 typedef struct _UNIT_DATA
 {
     LIST_ENTRY ListEntry;
@@ -111,10 +151,25 @@ typedef struct _FDO_DEVICE_EXTENSION
     PHW_PASSIVE_INITIALIZE_ROUTINE HwPassiveInitRoutine;
     PKINTERRUPT Interrupt;
     ULONG InterruptIrql;
+    PDMA_ADAPTER DmaAdapter;
+    ULONG MapRegisterCount;
+    IO_SCSI_CAPABILITIES PortCapabilities;
 
     KSPIN_LOCK PdoListLock;
     LIST_ENTRY PdoListHead;
     ULONG PdoCount;
+
+    /* Guards the logical unit queues and serializes HwStartIo */
+    KSPIN_LOCK StartIoLock;
+
+    /* Requests completed by the miniport, linked through NextSrb */
+    PSCSI_REQUEST_BLOCK volatile CompletedSrbList;
+    KDPC CompletionDpc;
+    ULONG CompletionBatches;
+    ULONG MaximumCompletionBatch;
+
+    NPAGED_LOOKASIDE_LIST SrbExtensionLookaside;
+    BOOLEAN SrbExtensionLookasideInitialized;
 } FDO_DEVICE_EXTENSION, *PFDO_DEVICE_EXTENSION;
 
 
@@ -131,8 +186,24 @@ typedef struct _PDO_DEVICE_EXTENSION
     ULONG Target;
     ULONG Lun;
     PINQUIRYDATA InquiryBuffer;
+    PVOID LuExtension;
+
+    /* Request queue, guarded by the StartIo lock of the FDO */
+    LIST_ENTRY RequestQueueHead;
+    ULONG QueuedCount;
+    ULONG OutstandingCount;
+    ULONG QueueDepth;
+    ULONG Flags;
+    struct _PDO_DEVICE_EXTENSION *NextRestart;
 
+    RTL_BITMAP QueueTagBitmap;
+    ULONG QueueTagBuffer[PORT_QUEUE_TAG_COUNT / 32];
+    ULONG NextQueueTag;
 
+    /* Started requests by queue tag, the untagged one at SP_UNTAGGED */
+    PSCSI_REQUEST_BLOCK ActiveSrbs[PORT_QUEUE_TAG_COUNT];
+
+    PORT_LUN_STATISTICS Statistics;
 } PDO_DEVICE_EXTENSION, *PPDO_DEVICE_EXTENSION;
 
 
@@ -150,6 +221,24 @@ PortFdoPnp(
     _In_ PDEVICE_OBJECT DeviceObject,
     _In_ PIRP Irp);
 
+VOID
+NTAPI
+PortFdoCompletionDpc(
+    _In_ PKDPC Dpc,
+    _In_opt_ PVOID DeferredContext,
+    _In_opt_ PVOID SystemArgument1,
+    _In_opt_ PVOID SystemArgument2);
+
+VOID
+PortQueueCompletedRequest(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension,
+    _In_ PSCSI_REQUEST_BLOCK Srb);
+
+VOID
+PortPutScatterGatherList(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension,
+    _In_ PIRP Irp);
+
 
 /* miniport.c */
 
@@ -171,6 +260,11 @@ BOOLEAN
 MiniportHwInterrupt(
     _In_ PMINIPORT Miniport);
 
+BOOLEAN
+MiniportBuildIo(
+    _In_ PMINIPORT Miniport,
+    _In_ PSCSI_REQUEST_BLOCK Srb);
+
 BOOLEAN
 MiniportStartIo(
     _In_ PMINIPORT Miniport,
@@ -248,12 +342,33 @@ NTSTATUS
 PortDeletePdo(
     _In_ PPDO_DEVICE_EXTENSION PdoExtension);
 
+PPDO_DEVICE_EXTENSION
+PortGetPdoExtension(
+    _In_ PFDO_DEVICE_EXTENSION FdoExtension,
+    _In_ ULONG Bus,
+    _In_ ULONG Target,
+    _In_ ULONG Lun);
+
+VOID
+PortStartNextRequests(
+    _In_ PPDO_DEVICE_EXTENSION PdoExtension);
+
+VOID
+PortReleaseQueue(
+    _In_ PPDO_DEVICE_EXTENSION PdoExtension);
+
 NTSTATUS
 NTAPI
 PortPdoScsi(
     _In_ PDEVICE_OBJECT DeviceObject,
     _In_ PIRP Irp);
 
+NTSTATUS
+NTAPI
+PortPdoDeviceControl(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ PIRP Irp);
+
 NTSTATUS
 NTAPI
 PortPdoPnp(
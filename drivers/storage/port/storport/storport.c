@@ -108,23 +108,31 @@ PortAcquireSpinLock(
     PVOID LockContext,
     PSTOR_LOCK_HANDLE LockHandle)
 {
-    DPRINT1("PortAcquireSpinLock(%p %lu %p %p)\n",
-            DeviceExtension, SpinLock, LockContext, LockHandle);
+    PKSPIN_LOCK Lock;
+
+    DPRINT("PortAcquireSpinLock(%p %lu %p %p)\n",
+           DeviceExtension, SpinLock, LockContext, LockHandle);
 
     LockHandle->Lock = SpinLock;
 
     switch (SpinLock)
     {
         case DpcLock: /* 1, */
-            DPRINT1("DpcLock\n");
+            DPRINT("DpcLock\n");
+            Lock = (PKSPIN_LOCK)&((PSTOR_DPC)LockContext)->Lock;
+            LockHandle->Context.LockQueue.Lock = Lock;
+            KeAcquireSpinLock(Lock, &LockHandle->Context.OldIrql);
             break;
 
         case StartIoLock: /* 2 */
-            DPRINT1("StartIoLock\n");
+            DPRINT("StartIoLock\n");
+            Lock = &DeviceExtension->StartIoLock;
+            LockHandle->Context.LockQueue.Lock = Lock;
+            KeAcquireSpinLock(Lock, &LockHandle->Context.OldIrql);
             break;
 
         case InterruptLock: /* 3 */
-            DPRINT1("InterruptLock\n");
+            DPRINT("InterruptLock\n");
             if (DeviceExtension->Interrupt == NULL)
                 LockHandle->Context.OldIrql = 0;
             else
@@ -140,21 +148,20 @@ PortReleaseSpinLock(
     PFDO_DEVICE_EXTENSION DeviceExtension,
     PSTOR_LOCK_HANDLE LockHandle)
 {
-    DPRINT1("PortReleaseSpinLock(%p %p)\n",
-            DeviceExtension, LockHandle);
+    DPRINT("PortReleaseSpinLock(%p %p)\n",
+           DeviceExtension, LockHandle);
 
     switch (LockHandle->Lock)
     {
         case DpcLock: /* 1, */
-            DPRINT1("DpcLock\n");
-            break;
-
         case StartIoLock: /* 2 */
-            DPRINT1("StartIoLock\n");
+            DPRINT("DpcLock or StartIoLock\n");
+            KeReleaseSpinLock((PKSPIN_LOCK)LockHandle->Context.LockQueue.Lock,
+                              LockHandle->Context.OldIrql);
             break;
 
         case InterruptLock: /* 3 */
-            DPRINT1("InterruptLock\n");
+            DPRINT("InterruptLock\n");
             if (DeviceExtension->Interrupt != NULL)
                 KeReleaseInterruptSpinLock(DeviceExtension->Interrupt,
                                            LockHandle->Context.OldIrql);
@@ -226,6 +233,11 @@ PortAddDevice(
     KeInitializeSpinLock(&DeviceExtension->PdoListLock);
     InitializeListHead(&DeviceExtension->PdoListHead);
 
+    KeInitializeSpinLock(&DeviceExtension->StartIoLock);
+    KeInitializeDpc(&DeviceExtension->CompletionDpc,
+                    PortFdoCompletionDpc,
+                    DeviceExtension);
+
     /* Attach the FDO to the device stack */
     Status = IoAttachDeviceToDeviceStackSafe(Fdo,
                                              PhysicalDeviceObject,
@@ -327,9 +339,16 @@ PortDispatchDeviceControl(
     IN PDEVICE_OBJECT DeviceObject,
     IN PIRP Irp)
 {
+    PFDO_DEVICE_EXTENSION DeviceExtension;
+
     DPRINT1("PortDispatchDeviceControl(%p %p)\n",
             DeviceObject, Irp);
 
+    DeviceExtension = (PFDO_DEVICE_EXTENSION)DeviceObject->DeviceExtension;
+    if (DeviceExtension->ExtensionType == PdoExtension)
+        return PortPdoDeviceControl(DeviceObject,
+                                    Irp);
+
     Irp->IoStatus.Status = STATUS_SUCCESS;
     Irp->IoStatus.Information = 0;
 
@@ -348,11 +367,11 @@ PortDispatchScsi(
 {
     PFDO_DEVICE_EXTENSION DeviceExtension;
 
-    DPRINT1("PortDispatchScsi(%p %p)\n",
-            DeviceObject, Irp);
+    DPRINT("PortDispatchScsi(%p %p)\n",
+           DeviceObject, Irp);
 
     DeviceExtension = (PFDO_DEVICE_EXTENSION)DeviceObject->DeviceExtension;
-    DPRINT1("ExtensionType: %u\n", DeviceExtension->ExtensionType);
+    DPRINT("ExtensionType: %u\n", DeviceExtension->ExtensionType);
 
     switch (DeviceExtension->ExtensionType)
     {
@@ -765,7 +784,7 @@ StorPortGetDeviceBase(
 
 
 /*
- * @unimplemented
+ * @implemented
  */
 STORPORT_API
 PVOID
@@ -776,9 +795,25 @@ StorPortGetLogicalUnit(
     _In_ UCHAR TargetId,
     _In_ UCHAR Lun)
 {
-    DPRINT1("StorPortGetLogicalUnit()\n");
-    UNIMPLEMENTED;
-    return NULL;
+    PMINIPORT_DEVICE_EXTENSION MiniportExtension;
+    PPDO_DEVICE_EXTENSION PdoExtension;
+
+    DPRINT("StorPortGetLogicalUnit(%p %u %u %u)\n",
+           HwDeviceExtension, PathId, TargetId, Lun);
+
+    /* Get the miniport extension */
+    MiniportExtension = CONTAINING_RECORD(HwDeviceExtension,
+                                          MINIPORT_DEVICE_EXTENSION,
+                                          HwDeviceExtension);
+
+    PdoExtension = PortGetPdoExtension(MiniportExtension->Miniport->DeviceExtension,
+                                       PathId,
+                                       TargetId,
+                                       Lun);
+    if (PdoExtension == NULL)
+        return NULL;
+
+    return PdoExtension->LuExtension;
 }
 
 
@@ -799,15 +834,15 @@ StorPortGetPhysicalAddress(
     STOR_PHYSICAL_ADDRESS PhysicalAddress;
     ULONG_PTR Offset;
 
-    DPRINT1("StorPortGetPhysicalAddress(%p %p %p %p)\n",
-            HwDeviceExtension, Srb, VirtualAddress, Length);
+    DPRINT("StorPortGetPhysicalAddress(%p %p %p %p)\n",
+           HwDeviceExtension, Srb, VirtualAddress, Length);
 
     /* Get the miniport extension */
     MiniportExtension = CONTAINING_RECORD(HwDeviceExtension,
                                           MINIPORT_DEVICE_EXTENSION,
                                           HwDeviceExtension);
-    DPRINT1("HwDeviceExtension %p  MiniportExtension %p\n",
-            HwDeviceExtension, MiniportExtension);
+    DPRINT("HwDeviceExtension %p  MiniportExtension %p\n",
+           HwDeviceExtension, MiniportExtension);
 
     DeviceExtension = MiniportExtension->Miniport->DeviceExtension;
 
@@ -837,8 +872,12 @@ StorPortGetPhysicalAddress(
 }
 
 
+/* The HAL list is handed out as is */
+C_ASSERT(FIELD_OFFSET(STOR_SCATTER_GATHER_LIST, List) == FIELD_OFFSET(SCATTER_GATHER_LIST, Elements));
+C_ASSERT(sizeof(STOR_SCATTER_GATHER_ELEMENT) == sizeof(SCATTER_GATHER_ELEMENT));
+
 /*
- * @unimplemented
+ * @implemented
  */
 STORPORT_API
 PSTOR_SCATTER_GATHER_LIST
@@ -847,9 +886,14 @@ StorPortGetScatterGatherList(
     _In_ PVOID DeviceExtension,
     _In_ PSCSI_REQUEST_BLOCK Srb)
 {
-    DPRINT1("StorPortGetScatterGatherList()\n");
-    UNIMPLEMENTED;
-    return NULL;
+    DPRINT("StorPortGetScatterGatherList(%p %p)\n",
+           DeviceExtension, Srb);
+
+    if (Srb == NULL || Srb->OriginalRequest == NULL)
+        return NULL;
+
+    /* Built before HwBuildIo, NULL for requests without data or DMA adapter */
+    return (PSTOR_SCATTER_GATHER_LIST)PortGetRequestContext((PIRP)Srb->OriginalRequest)->ScatterGatherList;
 }
 
 
@@ -866,8 +910,29 @@ StorPortGetSrb(
     _In_ UCHAR Lun,
     _In_ LONG QueueTag)
 {
-    DPRINT("StorPortGetSrb()\n");
-    return NULL;
+    PMINIPORT_DEVICE_EXTENSION MiniportExtension;
+    PPDO_DEVICE_EXTENSION PdoExtension;
+
+    DPRINT("StorPortGetSrb(%p %u %u %u %ld)\n",
+           DeviceExtension, PathId, TargetId, Lun, QueueTag);
+
+    if (QueueTag < 0 || QueueTag >= PORT_QUEUE_TAG_COUNT)
+        return NULL;
+
+    /* Get the miniport extension */
+    MiniportExtension = CONTAINING_RECORD(DeviceExtension,
+                                          MINIPORT_DEVICE_EXTENSION,
+                                          HwDeviceExtension);
+
+    PdoExtension = PortGetPdoExtension(MiniportExtension->Miniport->DeviceExtension,
+                                       PathId,
+                                       TargetId,
+                                       Lun);
+    if (PdoExtension == NULL)
+        return NULL;
+
+    /* SP_UNTAGGED finds the untagged request */
+    return PdoExtension->ActiveSrbs[QueueTag];
 }
 
 
@@ -1102,6 +1167,8 @@ StorPortNotification(
     PBOOLEAN Result;
     PSTOR_DPC Dpc;
     PHW_DPC_ROUTINE HwDpcRoutine;
+    PVOID SystemArgument1, SystemArgument2;
+    PLONG Queued;
     va_list ap;
 
     STOR_SPINLOCK SpinLock;
@@ -1109,8 +1176,8 @@ StorPortNotification(
     PSTOR_LOCK_HANDLE LockHandle;
     PSCSI_REQUEST_BLOCK Srb;
 
-    DPRINT1("StorPortNotification(%x %p)\n",
-            NotificationType, HwDeviceExtension);
+    DPRINT("StorPortNotification(%x %p)\n",
+           NotificationType, HwDeviceExtension);
 
     /* Get the miniport extension */
     if (HwDeviceExtension != NULL)
@@ -1118,8 +1185,8 @@ StorPortNotification(
         MiniportExtension = CONTAINING_RECORD(HwDeviceExtension,
                                               MINIPORT_DEVICE_EXTENSION,
                                               HwDeviceExtension);
-        DPRINT1("HwDeviceExtension %p  MiniportExtension %p\n",
-                HwDeviceExtension, MiniportExtension);
+        DPRINT("HwDeviceExtension %p  MiniportExtension %p\n",
+               HwDeviceExtension, MiniportExtension);
 
         DeviceExtension = MiniportExtension->Miniport->DeviceExtension;
     }
@@ -1129,13 +1196,14 @@ StorPortNotification(
     switch (NotificationType)
     {
         case RequestComplete:
-            DPRINT1("RequestComplete\n");
+            DPRINT("RequestComplete\n");
             Srb = (PSCSI_REQUEST_BLOCK)va_arg(ap, PSCSI_REQUEST_BLOCK);
-            DPRINT1("Srb %p\n", Srb);
-            if (Srb->OriginalRequest != NULL)
+            DPRINT("Srb %p\n", Srb);
+            if ((DeviceExtension != NULL) &&
+                (Srb->OriginalRequest != NULL))
             {
-                DPRINT1("Need to complete the IRP!\n");
-
+                /* The IRP is completed by the completion DPC */
+                PortQueueCompletedRequest(DeviceExtension, Srb);
             }
             break;
 
@@ -1169,20 +1237,35 @@ StorPortNotification(
             HwDpcRoutine = (PHW_DPC_ROUTINE)va_arg(ap, PHW_DPC_ROUTINE);
             DPRINT1("HwDpcRoutine %p\n", HwDpcRoutine);
 
+            /* The DPC routine gets the miniport extension as its context */
             KeInitializeDpc((PRKDPC)&Dpc->Dpc,
                             (PKDEFERRED_ROUTINE)HwDpcRoutine,
-                            (PVOID)DeviceExtension);
-            KeInitializeSpinLock(&Dpc->Lock);
+                            HwDeviceExtension);
+            KeInitializeSpinLock((PKSPIN_LOCK)&Dpc->Lock);
+            break;
+
+        case IssueDpc:
+            DPRINT("IssueDpc\n");
+            Dpc = (PSTOR_DPC)va_arg(ap, PSTOR_DPC);
+            SystemArgument1 = (PVOID)va_arg(ap, PVOID);
+            SystemArgument2 = (PVOID)va_arg(ap, PVOID);
+            Queued = (PLONG)va_arg(ap, PLONG);
+            DPRINT("Dpc %p  SystemArgument1 %p  SystemArgument2 %p\n",
+                   Dpc, SystemArgument1, SystemArgument2);
+
+            *Queued = KeInsertQueueDpc((PRKDPC)&Dpc->Dpc,
+                                       SystemArgument1,
+                                       SystemArgument2);
             break;
 
         case AcquireSpinLock:
-            DPRINT1("AcquireSpinLock\n");
+            DPRINT("AcquireSpinLock\n");
             SpinLock = (STOR_SPINLOCK)va_arg(ap, STOR_SPINLOCK);
-            DPRINT1("SpinLock %lu\n", SpinLock);
+            DPRINT("SpinLock %lu\n", SpinLock);
             LockContext = (PVOID)va_arg(ap, PVOID);
-            DPRINT1("LockContext %p\n", LockContext);
+            DPRINT("LockContext %p\n", LockContext);
             LockHandle = (PSTOR_LOCK_HANDLE)va_arg(ap, PSTOR_LOCK_HANDLE);
-            DPRINT1("LockHandle %p\n", LockHandle);
+            DPRINT("LockHandle %p\n", LockHandle);
             PortAcquireSpinLock(DeviceExtension,
                                 SpinLock,
                                 LockContext,
@@ -1190,9 +1273,9 @@ StorPortNotification(
             break;
 
         case ReleaseSpinLock:
-            DPRINT1("ReleaseSpinLock\n");
+            DPRINT("ReleaseSpinLock\n");
             LockHandle = (PSTOR_LOCK_HANDLE)va_arg(ap, PSTOR_LOCK_HANDLE);
-            DPRINT1("LockHandle %p\n", LockHandle);
+            DPRINT("LockHandle %p\n", LockHandle);
             PortReleaseSpinLock(DeviceExtension,
                                 LockHandle);
             break;
@@ -1390,7 +1473,7 @@ StorPortSetBusDataByOffset(
 
 
 /*
- * @unimplemented
+ * @implemented
  */
 STORPORT_API
 BOOLEAN
@@ -1402,9 +1485,34 @@ StorPortSetDeviceQueueDepth(
     _In_ UCHAR Lun,
     _In_ ULONG Depth)
 {
-    DPRINT1("StorPortSetDeviceQueueDepth()\n");
-    UNIMPLEMENTED;
-    return FALSE;
+    PMINIPORT_DEVICE_EXTENSION MiniportExtension;
+    PPDO_DEVICE_EXTENSION PdoExtension;
+
+    DPRINT("StorPortSetDeviceQueueDepth(%p %u %u %u %lu)\n",
+           HwDeviceExtension, PathId, TargetId, Lun, Depth);
+
+    if (Depth == 0 || Depth > PORT_MAXIMUM_QUEUE_DEPTH)
+        return FALSE;
+
+    /* Get the miniport extension */
+    MiniportExtension = CONTAINING_RECORD(HwDeviceExtension,
+                                          MINIPORT_DEVICE_EXTENSION,
+                                          HwDeviceExtension);
+
+    PdoExtension = PortGetPdoExtension(MiniportExtension->Miniport->DeviceExtension,
+                                       PathId,
+                                       TargetId,
+                                       Lun);
+    if (PdoExtension == NULL)
+        return FALSE;
+
+    /* Miniports may call this while the StartIo lock is held, so the new
+       depth is picked up by the next dispatch or completion of the unit */
+    if (!MiniportExtension->Miniport->PortConfig.MultipleRequestPerLu)
+        Depth = 1;
+    InterlockedExchange((PLONG)&PdoExtension->QueueDepth, (LONG)Depth);
+
+    return TRUE;
 }
 
 
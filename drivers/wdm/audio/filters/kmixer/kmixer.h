@@ -4,6 +4,10 @@
 #include <portcls.h>
 #include <float_cast.h>
 
+#include "mix.h"
+
+#define TAG_KMIXER 'XIMK'
+
 typedef struct
 {
     KSDEVICE_HEADER KsDeviceHeader;
@@ -18,6 +22,17 @@ typedef struct
 
 }SUM_NODE_CONTEXT, *PSUM_NODE_CONTEXT;
 
+typedef struct
+{
+    KSDATAFORMAT_WAVEFORMATEX Formats[2];   /* Input and output format */
+    FAST_MUTEX Lock;                        /* Serializes format changes and packets */
+    MIX_RESAMPLER Resampler;                /* Kept across packets while the rates differ */
+    PFLOAT Accumulator;                     /* MIX_MIN_FRAMES samples, allocated with the pin */
+    PUCHAR Buffers[2];                      /* Channel and rate/width conversion results */
+    ULONG BufferSize;                       /* Size of each of the Buffers */
+
+}PIN_CONTEXT, *PPIN_CONTEXT;
+
 
 NTSTATUS
 NTAPI
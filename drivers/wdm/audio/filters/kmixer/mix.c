@@ -0,0 +1,472 @@
+/*
+ * PROJECT:     ReactOS Kernel Streaming Mixer
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     PCM conversion, mixing and resampling
+ *
+ * Samples of every width are handled as left justified 32 bit integers,
+ * scaled by 2^-31 to float. For 16 and 32 bit PCM this is bit for bit what
+ * libsamplerate's src_*_to_*_array helpers do. amd64 converts with SSE2,
+ * x86 would need KeSaveFloatingPointState to cover the XMM registers and
+ * stays on the C loops.
+ */
+
+#ifdef KMIXER_HOST
+#include <typedefs.h>
+#include <math.h>
+#include <string.h>
+#include "mix.h"
+#define MixAllocate(Size)   malloc(Size)
+#define MixFree(Block)      free(Block)
+#define min(a, b)           (((a) < (b)) ? (a) : (b))
+#define max(a, b)           (((a) > (b)) ? (a) : (b))
+#else
+#include "kmixer.h"
+#define MixAllocate(Size)   ExAllocatePoolWithTag(NonPagedPool, (Size), TAG_KMIXER)
+#define MixFree(Block)      ExFreePoolWithTag((Block), TAG_KMIXER)
+#endif
+
+#if defined(_M_AMD64) || defined(__x86_64__)
+#define MIX_SSE2
+#include <emmintrin.h>
+#endif
+
+#define MIX_TO_FLOAT    (1.0f / 2147483648.0f)
+#define MIX_TO_INT      2147483648.0f
+
+/* PCM TO FLOAT **************************************************************/
+
+#ifdef MIX_SSE2
+static __inline __m128
+MixLoad4(const FLOAT *Out, __m128 Value, __m128 Scale, BOOLEAN Add)
+{
+    Value = _mm_mul_ps(Value, Scale);
+    return Add ? _mm_add_ps(_mm_loadu_ps(Out), Value) : Value;
+}
+
+static ULONG
+MixLoadSse2(FLOAT *Out, const UCHAR *In, ULONG Bits, ULONG Samples, FLOAT Gain, BOOLEAN Add)
+{
+    const __m128 Scale = _mm_set1_ps(Gain * MIX_TO_FLOAT);
+    const __m128i Zero = _mm_setzero_si128();
+    ULONG Index = 0;
+
+    switch (Bits)
+    {
+        case 8:
+        {
+            const __m128i Bias = _mm_set1_epi8((char)0x80);
+
+            for (; Index + 16 <= Samples; Index += 16)
+            {
+                __m128i Bytes = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(In + Index)), Bias);
+                __m128i Lo = _mm_unpacklo_epi8(Zero, Bytes);
+                __m128i Hi = _mm_unpackhi_epi8(Zero, Bytes);
+
+                _mm_storeu_ps(Out + Index, MixLoad4(Out + Index, _mm_cvtepi32_ps(_mm_unpacklo_epi16(Zero, Lo)), Scale, Add));
+                _mm_storeu_ps(Out + Index + 4, MixLoad4(Out + Index + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(Zero, Lo)), Scale, Add));
+                _mm_storeu_ps(Out + Index + 8, MixLoad4(Out + Index + 8, _mm_cvtepi32_ps(_mm_unpacklo_epi16(Zero, Hi)), Scale, Add));
+                _mm_storeu_ps(Out + Index + 12, MixLoad4(Out + Index + 12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(Zero, Hi)), Scale, Add));
+            }
+            break;
+        }
+        case 16:
+        {
+            for (; Index + 8 <= Samples; Index += 8)
+            {
+                __m128i Words = _mm_loadu_si128((const __m128i *)(In + Index * 2));
+
+                _mm_storeu_ps(Out + Index, MixLoad4(Out + Index, _mm_cvtepi32_ps(_mm_unpacklo_epi16(Zero, Words)), Scale, Add));
+                _mm_storeu_ps(Out + Index + 4, MixLoad4(Out + Index + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(Zero, Words)), Scale, Add));
+            }
+            break;
+        }
+        case 24:
+        {
+            /* No byte shuffle in SSE2, the samples are assembled in C */
+            for (; Index + 4 <= Samples; Index += 4)
+            {
+                const UCHAR *p = In + Index * 3;
+                __m128i Words = _mm_set_epi32((int)(((ULONG)p[11] << 24) | (p[10] << 16) | (p[9] << 8)),
+                                              (int)(((ULONG)p[8] << 24) | (p[7] << 16) | (p[6] << 8)),
+                                              (int)(((ULONG)p[5] << 24) | (p[4] << 16) | (p[3] << 8)),
+                                              (int)(((ULONG)p[2] << 24) | (p[1] << 16) | (p[0] << 8)));
+
+                _mm_storeu_ps(Out + Index, MixLoad4(Out + Index, _mm_cvtepi32_ps(Words), Scale, Add));
+            }
+            break;
+        }
+        case 32:
+        {
+            for (; Index + 4 <= Samples; Index += 4)
+            {
+                __m128i Words = _mm_loadu_si128((const __m128i *)(In + Index * 4));
+
+                _mm_storeu_ps(Out + Index, MixLoad4(Out + Index, _mm_cvtepi32_ps(Words), Scale, Add));
+            }
+            break;
+        }
+    }
+
+    return Index;
+}
+#endif
+
+static VOID
+MixLoad(FLOAT *Out, const UCHAR *In, ULONG Bits, ULONG Samples, FLOAT Gain, BOOLEAN Add)
+{
+    const FLOAT Scale = Gain * MIX_TO_FLOAT;
+    ULONG Index = 0;
+    LONG Sample;
+
+#ifdef MIX_SSE2
+    Index = MixLoadSse2(Out, In, Bits, Samples, Gain, Add);
+#endif
+
+#define MIX_LOAD_LOOP(Expression) \
+    for (; Index < Samples; Index++) \
+    { \
+        Sample = (Expression); \
+        Out[Index] = Add ? Out[Index] + (FLOAT)Sample * Scale : (FLOAT)Sample * Scale; \
+    }
+
+    switch (Bits)
+    {
+        case 8:
+            MIX_LOAD_LOOP((LONG)((ULONG)(In[Index] ^ 0x80) << 24));
+            break;
+        case 16:
+            MIX_LOAD_LOOP((LONG)((ULONG)((const USHORT *)In)[Index] << 16));
+            break;
+        case 24:
+            MIX_LOAD_LOOP((LONG)(((ULONG)In[Index * 3] << 8) |
+                                 ((ULONG)In[Index * 3 + 1] << 16) |
+                                 ((ULONG)In[Index * 3 + 2] << 24)));
+            break;
+        case 32:
+            MIX_LOAD_LOOP(((const LONG *)In)[Index]);
+            break;
+    }
+
+#undef MIX_LOAD_LOOP
+}
+
+VOID
+MixPcmToFloat(
+    const VOID *In,
+    ULONG BitsPerSample,
+    FLOAT *Out,
+    ULONG Samples)
+{
+    MixLoad(Out, In, BitsPerSample, Samples, 1.0f, FALSE);
+}
+
+/* FLOAT TO PCM **************************************************************/
+
+#ifdef MIX_SSE2
+/* Values of 1.0 and up convert to 0x80000000, flipping every bit where
+ * they were clipped turns that into 0x7FFFFFFF. */
+static __inline __m128i
+MixQuantize4(const FLOAT *In)
+{
+    const __m128 Scale = _mm_set1_ps(MIX_TO_INT);
+    __m128 Value = _mm_mul_ps(_mm_loadu_ps(In), Scale);
+
+    return _mm_xor_si128(_mm_cvtps_epi32(Value), _mm_castps_si128(_mm_cmpge_ps(Value, Scale)));
+}
+
+static ULONG
+MixStoreSse2(UCHAR *Out, const FLOAT *In, ULONG Bits, ULONG Samples)
+{
+    ULONG Index = 0;
+
+    switch (Bits)
+    {
+        case 8:
+        {
+            const __m128i Bias = _mm_set1_epi8((char)0x80);
+
+            for (; Index + 16 <= Samples; Index += 16)
+            {
+                __m128i Lo = _mm_packs_epi32(_mm_srai_epi32(MixQuantize4(In + Index), 24),
+                                             _mm_srai_epi32(MixQuantize4(In + Index + 4), 24));
+                __m128i Hi = _mm_packs_epi32(_mm_srai_epi32(MixQuantize4(In + Index + 8), 24),
+                                             _mm_srai_epi32(MixQuantize4(In + Index + 12), 24));
+
+                _mm_storeu_si128((__m128i *)(Out + Index), _mm_xor_si128(_mm_packs_epi16(Lo, Hi), Bias));
+            }
+            break;
+        }
+        case 16:
+        {
+            for (; Index + 8 <= Samples; Index += 8)
+            {
+                __m128i Words = _mm_packs_epi32(_mm_srai_epi32(MixQuantize4(In + Index), 16),
+                                                _mm_srai_epi32(MixQuantize4(In + Index + 4), 16));
+
+                _mm_storeu_si128((__m128i *)(Out + Index * 2), Words);
+            }
+            break;
+        }
+        case 24:
+        {
+            for (; Index + 4 <= Samples; Index += 4)
+            {
+                LONG Words[4];
+                UCHAR *p = Out + Index * 3;
+                ULONG Sub;
+
+                _mm_storeu_si128((__m128i *)Words, MixQuantize4(In + Index));
+                for (Sub = 0; Sub < 4; Sub++, p += 3)
+                {
+                    p[0] = (UCHAR)(Words[Sub] >> 8);
+                    p[1] = (UCHAR)(Words[Sub] >> 16);
+                    p[2] = (UCHAR)(Words[Sub] >> 24);
+                }
+            }
+            break;
+        }
+        case 32:
+        {
+            for (; Index + 4 <= Samples; Index += 4)
+                _mm_storeu_si128((__m128i *)(Out + Index * 4), MixQuantize4(In + Index));
+            break;
+        }
+    }
+
+    return Index;
+}
+#endif
+
+static __inline LONG
+MixQuantize(FLOAT Value)
+{
+    Value *= MIX_TO_INT;
+    if (Value >= MIX_TO_INT)
+        return 0x7FFFFFFF;
+    if (Value <= -MIX_TO_INT)
+        return (LONG)0x80000000;
+    return (LONG)lrintf(Value);
+}
+
+VOID
+MixFloatToPcm(
+    const FLOAT *In,
+    ULONG BitsPerSample,
+    VOID *Out,
+    ULONG Samples)
+{
+    UCHAR *Bytes = Out;
+    ULONG Index = 0;
+    LONG Sample;
+
+#ifdef MIX_SSE2
+    Index = MixStoreSse2(Bytes, In, BitsPerSample, Samples);
+#endif
+
+    switch (BitsPerSample)
+    {
+        case 8:
+            for (; Index < Samples; Index++)
+                Bytes[Index] = (UCHAR)((MixQuantize(In[Index]) >> 24) ^ 0x80);
+            break;
+        case 16:
+            for (; Index < Samples; Index++)
+                ((SHORT *)Out)[Index] = (SHORT)(MixQuantize(In[Index]) >> 16);
+            break;
+        case 24:
+            for (; Index < Samples; Index++)
+            {
+                Sample = MixQuantize(In[Index]);
+                Bytes[Index * 3] = (UCHAR)(Sample >> 8);
+                Bytes[Index * 3 + 1] = (UCHAR)(Sample >> 16);
+                Bytes[Index * 3 + 2] = (UCHAR)(Sample >> 24);
+            }
+            break;
+        case 32:
+            for (; Index < Samples; Index++)
+                ((LONG *)Out)[Index] = MixQuantize(In[Index]);
+            break;
+    }
+}
+
+/* MIXING ********************************************************************/
+
+VOID
+MixStreams(
+    const MIX_STREAM *Streams,
+    ULONG StreamCount,
+    ULONG Samples,
+    FLOAT *Accumulator,
+    ULONG AccumulatorSamples,
+    ULONG BitsPerSample,
+    VOID *Out)
+{
+    ULONG Offset, Count, Stream;
+
+    /* Streams are summed a block at a time, so the accumulator stays in
+     * the cache and the output may overlap a narrower input */
+    for (Offset = 0; Offset < Samples; Offset += Count)
+    {
+        Count = min(Samples - Offset, AccumulatorSamples);
+
+        if (StreamCount == 0)
+            memset(Accumulator, 0, Count * sizeof(FLOAT));
+
+        for (Stream = 0; Stream < StreamCount; Stream++)
+        {
+            ULONG Bits = Streams[Stream].BitsPerSample;
+
+            MixLoad(Accumulator,
+                    (const UCHAR *)Streams[Stream].Data + Offset * (Bits / 8),
+                    Bits,
+                    Count,
+                    Streams[Stream].Gain,
+                    Stream != 0);
+        }
+
+        MixFloatToPcm(Accumulator, BitsPerSample, (UCHAR *)Out + Offset * (BitsPerSample / 8), Count);
+    }
+}
+
+/* RESAMPLING ****************************************************************/
+
+/* The resampler keeps libsamplerate's filter history and the input it did
+ * not consume yet from one packet to the next, so packet boundaries are
+ * inaudible. Its buffers are sized once, packets of any length are
+ * converted in blocks of Capacity frames. */
+
+BOOLEAN
+MixResamplerInit(
+    PMIX_RESAMPLER Resampler,
+    ULONG Channels,
+    ULONG InRate,
+    ULONG OutRate,
+    ULONG Frames)
+{
+    int Error;
+
+    memset(Resampler, 0, sizeof(*Resampler));
+
+    if (!Channels || !InRate || !OutRate)
+        return FALSE;
+
+    Resampler->Channels = Channels;
+    Resampler->InRate = InRate;
+    Resampler->OutRate = OutRate;
+    Resampler->Capacity = max(Frames, MIX_MIN_FRAMES);
+    /* One block of input plus the filter delay always fits */
+    Resampler->OutCapacity = (ULONG)(((ULONGLONG)Resampler->Capacity * 2 * OutRate + InRate - 1) / InRate) + 16;
+
+    Resampler->In = MixAllocate((SIZE_T)Resampler->Capacity * Channels * sizeof(FLOAT));
+    Resampler->Out = MixAllocate((SIZE_T)Resampler->OutCapacity * Channels * sizeof(FLOAT));
+    Resampler->State = src_new(SRC_SINC_FASTEST, Channels, &Error);
+    if (!Resampler->In || !Resampler->Out || !Resampler->State)
+    {
+        MixResamplerFree(Resampler);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+VOID
+MixResamplerReset(
+    PMIX_RESAMPLER Resampler)
+{
+    if (Resampler->State)
+        src_reset(Resampler->State);
+    Resampler->Carried = 0;
+    Resampler->InTotal = 0;
+    Resampler->OutTotal = 0;
+}
+
+VOID
+MixResamplerFree(
+    PMIX_RESAMPLER Resampler)
+{
+    if (Resampler->State)
+        src_delete(Resampler->State);
+    if (Resampler->In)
+        MixFree(Resampler->In);
+    if (Resampler->Out)
+        MixFree(Resampler->Out);
+    memset(Resampler, 0, sizeof(*Resampler));
+}
+
+/* libsamplerate never gets ahead of the input it was given, so the output
+ * so far is bounded by the input so far times the ratio. */
+ULONG
+MixResamplerMaxOutput(
+    PMIX_RESAMPLER Resampler,
+    ULONG Frames)
+{
+    ULONGLONG Total;
+
+    Total = ((Resampler->InTotal + Resampler->Carried + Frames) * Resampler->OutRate +
+             Resampler->InRate - 1) / Resampler->InRate;
+
+    return (ULONG)(Total - Resampler->OutTotal) + 8;
+}
+
+int
+MixResamplerProcess(
+    PMIX_RESAMPLER Resampler,
+    const VOID *In,
+    ULONG InBitsPerSample,
+    ULONG Frames,
+    VOID *Out,
+    ULONG OutBitsPerSample,
+    ULONG OutFrames,
+    ULONG *Generated)
+{
+    const ULONG Channels = Resampler->Channels;
+    const UCHAR *Source = In;
+    UCHAR *Target = Out;
+    ULONG Take;
+    SRC_DATA Data;
+    int Error;
+
+    *Generated = 0;
+
+    Data.src_ratio = (double)Resampler->OutRate / (double)Resampler->InRate;
+    Data.end_of_input = 0;
+
+    for (;;)
+    {
+        /* Append the next block behind what the last call left over */
+        Take = min(Frames, Resampler->Capacity - Resampler->Carried);
+        MixLoad(Resampler->In + Resampler->Carried * Channels, Source, InBitsPerSample, Take * Channels, 1.0f, FALSE);
+        Source += Take * Channels * (InBitsPerSample / 8);
+        Frames -= Take;
+
+        Data.data_in = Resampler->In;
+        Data.input_frames = Resampler->Carried + Take;
+        Data.data_out = Resampler->Out;
+        Data.output_frames = min(Resampler->OutCapacity, OutFrames - *Generated);
+
+        Error = src_process(Resampler->State, &Data);
+        if (Error)
+            return Error;
+
+        MixFloatToPcm(Resampler->Out, OutBitsPerSample, Target, Data.output_frames_gen * Channels);
+        Target += Data.output_frames_gen * Channels * (OutBitsPerSample / 8);
+        *Generated += Data.output_frames_gen;
+
+        Resampler->Carried = Data.input_frames - Data.input_frames_used;
+        memmove(Resampler->In,
+                Resampler->In + Data.input_frames_used * Channels,
+                Resampler->Carried * Channels * sizeof(FLOAT));
+        Resampler->InTotal += Data.input_frames_used;
+        Resampler->OutTotal += Data.output_frames_gen;
+
+        /* Stop when the input is in and libsamplerate is done with it, or
+         * when it can't make progress into the output it was given */
+        if (Data.input_frames_used == 0 && Data.output_frames_gen == 0)
+            break;
+        if (Frames == 0 && (Resampler->Carried == 0 || *Generated == OutFrames))
+            break;
+    }
+
+    /* Input that didn't fit the output is dropped */
+    return 0;
+}
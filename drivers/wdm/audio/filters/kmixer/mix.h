@@ -0,0 +1,96 @@
+/*
+ * PROJECT:     ReactOS Kernel Streaming Mixer
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     PCM conversion, mixing and resampling
+ *
+ * Nothing in here allocates after setup or depends on the kernel, so the
+ * same code is benchmarked on the host (sdk/tools/kmixbench).
+ */
+
+#ifndef _KMIXER_MIX_H_
+#define _KMIXER_MIX_H_
+
+#include <samplerate.h>
+
+/* Smallest block of frames the resampler converts at a time */
+#define MIX_MIN_FRAMES      4096
+
+typedef struct _MIX_STREAM
+{
+    const VOID *Data;
+    ULONG BitsPerSample;        /* 8 (unsigned), 16, 24 (packed) or 32 */
+    FLOAT Gain;
+} MIX_STREAM, *PMIX_STREAM;
+
+typedef struct _MIX_RESAMPLER
+{
+    SRC_STATE *State;
+    FLOAT *In;                  /* Input frames, starting with the carried ones */
+    FLOAT *Out;                 /* Output of one src_process call */
+    ULONG Channels;
+    ULONG InRate;
+    ULONG OutRate;
+    ULONG Capacity;             /* Frames In holds */
+    ULONG OutCapacity;          /* Frames Out holds */
+    ULONG Carried;              /* Frames src_process left over from the last call */
+    ULONGLONG InTotal;          /* Frames consumed since the last reset */
+    ULONGLONG OutTotal;         /* Frames produced since the last reset */
+} MIX_RESAMPLER, *PMIX_RESAMPLER;
+
+VOID
+MixPcmToFloat(
+    const VOID *In,
+    ULONG BitsPerSample,
+    FLOAT *Out,
+    ULONG Samples);
+
+VOID
+MixFloatToPcm(
+    const FLOAT *In,
+    ULONG BitsPerSample,
+    VOID *Out,
+    ULONG Samples);
+
+VOID
+MixStreams(
+    const MIX_STREAM *Streams,
+    ULONG StreamCount,
+    ULONG Samples,
+    FLOAT *Accumulator,
+    ULONG AccumulatorSamples,
+    ULONG BitsPerSample,
+    VOID *Out);
+
+BOOLEAN
+MixResamplerInit(
+    PMIX_RESAMPLER Resampler,
+    ULONG Channels,
+    ULONG InRate,
+    ULONG OutRate,
+    ULONG Frames);
+
+VOID
+MixResamplerReset(
+    PMIX_RESAMPLER Resampler);
+
+VOID
+MixResamplerFree(
+    PMIX_RESAMPLER Resampler);
+
+ULONG
+MixResamplerMaxOutput(
+    PMIX_RESAMPLER Resampler,
+    ULONG Frames);
+
+int
+MixResamplerProcess(
+    PMIX_RESAMPLER Resampler,
+    const VOID *In,
+    ULONG InBitsPerSample,
+    ULONG Frames,
+    VOID *Out,
+    ULONG OutBitsPerSample,
+    ULONG OutFrames,
+    ULONG *Generated);
+
+#endif /* _KMIXER_MIX_H_ */
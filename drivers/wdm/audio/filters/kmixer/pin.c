@@ -8,146 +8,185 @@
 
 #include "kmixer.h"
 
-#include <samplerate.h>
 
 #define NDEBUG
 #include <debug.h>
 
 const GUID KSPROPSETID_Connection              = {0x1D58C920L, 0xAC9B, 0x11CF, {0xA5, 0xD6, 0x28, 0xDB, 0x04, 0xC1, 0x00, 0x00}};
 
+static
 NTSTATUS
-PerformSampleRateConversion(
-    PUCHAR Buffer,
-    ULONG BufferLength,
-    ULONG OldRate,
-    ULONG NewRate,
-    ULONG BytesPerSample,
-    ULONG NumChannels,
-    PVOID * Result,
-    PULONG ResultLength)
+UpdateResampler(
+    IN PPIN_CONTEXT Context)
 {
+    PWAVEFORMATEX InputFormat = &Context->Formats[0].WaveFormatEx;
+    PWAVEFORMATEX OutputFormat = &Context->Formats[1].WaveFormatEx;
+    PMIX_RESAMPLER Resampler = &Context->Resampler;
     KFLOATING_SAVE FloatSave;
     NTSTATUS Status;
-    ULONG Index;
-    SRC_STATE * State;
-    SRC_DATA Data;
-    PUCHAR ResultOut;
-    int error;
-    PFLOAT FloatIn, FloatOut;
-    ULONG NumSamples;
-    ULONG NewSamples;
+    BOOLEAN Success;
 
-    DPRINT("PerformSampleRateConversion OldRate %u NewRate %u BytesPerSample %u NumChannels %u Irql %u\n", OldRate, NewRate, BytesPerSample, NumChannels, KeGetCurrentIrql());
+    if (Resampler->State &&
+        Resampler->InRate == InputFormat->nSamplesPerSec &&
+        Resampler->OutRate == OutputFormat->nSamplesPerSec &&
+        Resampler->Channels == OutputFormat->nChannels)
+    {
+        /* still matches the formats */
+        return STATUS_SUCCESS;
+    }
 
-    ASSERT(BytesPerSample == 1 || BytesPerSample == 2 || BytesPerSample == 4);
+    MixResamplerFree(Resampler);
 
-    /* first acquire float save context */
-    Status = KeSaveFloatingPointState(&FloatSave);
+    if (!InputFormat->nSamplesPerSec || !OutputFormat->nSamplesPerSec || !OutputFormat->nChannels ||
+        InputFormat->nSamplesPerSec == OutputFormat->nSamplesPerSec)
+    {
+        /* nothing to convert (yet) */
+        return STATUS_SUCCESS;
+    }
 
+    Status = KeSaveFloatingPointState(&FloatSave);
     if (!NT_SUCCESS(Status))
     {
         DPRINT1("KeSaveFloatingPointState failed with %x\n", Status);
         return Status;
     }
 
-    NumSamples = BufferLength / (BytesPerSample * NumChannels);
+    /* buffers hold 100 ms, longer packets are converted in blocks */
+    Success = MixResamplerInit(Resampler,
+                               OutputFormat->nChannels,
+                               InputFormat->nSamplesPerSec,
+                               OutputFormat->nSamplesPerSec,
+                               InputFormat->nSamplesPerSec / 10);
 
-    FloatIn = ExAllocatePool(NonPagedPool, NumSamples * NumChannels * sizeof(FLOAT));
-    if (!FloatIn)
+    KeRestoreFloatingPointState(&FloatSave);
+
+    if (!Success)
     {
-        KeRestoreFloatingPointState(&FloatSave);
+        DPRINT1("MixResamplerInit failed\n");
         return STATUS_INSUFFICIENT_RESOURCES;
     }
 
-    NewSamples = ((((ULONG64)NumSamples * NewRate) + (OldRate / 2)) / OldRate) + 2;
+    return STATUS_SUCCESS;
+}
+
+static
+ULONG
+GetConversionBufferSize(
+    IN PPIN_CONTEXT Context,
+    IN ULONG Frames)
+{
+    PWAVEFORMATEX InputFormat = &Context->Formats[0].WaveFormatEx;
+    PWAVEFORMATEX OutputFormat = &Context->Formats[1].WaveFormatEx;
+    ULONG ChannelSize, OutputSize, OutputFrames = Frames;
 
-    FloatOut = ExAllocatePool(NonPagedPool, NewSamples * NumChannels * sizeof(FLOAT));
-    if (!FloatOut)
-    {
-        ExFreePool(FloatIn);
-        KeRestoreFloatingPointState(&FloatSave);
-        return STATUS_INSUFFICIENT_RESOURCES;
-    }
+    /* channels are converted at the input width, the rest ends at the output width */
+    ChannelSize = Frames * OutputFormat->nChannels * (InputFormat->wBitsPerSample / 8);
 
-    ResultOut = ExAllocatePool(NonPagedPool, NewSamples * NumChannels * BytesPerSample);
-    if (!ResultOut)
+    if (Context->Resampler.State)
+        OutputFrames = MixResamplerMaxOutput(&Context->Resampler, Frames);
+
+    OutputSize = OutputFrames * OutputFormat->nChannels * (OutputFormat->wBitsPerSample / 8);
+
+    return max(ChannelSize, OutputSize);
+}
+
+static
+NTSTATUS
+ReserveConversionBuffers(
+    IN PPIN_CONTEXT Context,
+    IN ULONG Size)
+{
+    PUCHAR Buffers[2];
+
+    if (Size <= Context->BufferSize)
+        return STATUS_SUCCESS;
+
+    /* only a packet longer than any before it gets here */
+    Buffers[0] = ExAllocatePoolWithTag(NonPagedPool, Size, TAG_KMIXER);
+    Buffers[1] = ExAllocatePoolWithTag(NonPagedPool, Size, TAG_KMIXER);
+    if (!Buffers[0] || !Buffers[1])
     {
-        ExFreePool(FloatIn);
-        ExFreePool(FloatOut);
-        KeRestoreFloatingPointState(&FloatSave);
+        if (Buffers[0])
+            ExFreePoolWithTag(Buffers[0], TAG_KMIXER);
+        if (Buffers[1])
+            ExFreePoolWithTag(Buffers[1], TAG_KMIXER);
         return STATUS_INSUFFICIENT_RESOURCES;
     }
 
-    State = src_new(SRC_SINC_FASTEST, NumChannels, &error);
-    if (!State)
+    if (Context->Buffers[0])
     {
-        DPRINT1("src_new failed with %x\n", error);
-        KeRestoreFloatingPointState(&FloatSave);
-        ExFreePool(FloatIn);
-        ExFreePool(FloatOut);
-        ExFreePool(ResultOut);
-        return STATUS_UNSUCCESSFUL;
+        ExFreePoolWithTag(Context->Buffers[0], TAG_KMIXER);
+        ExFreePoolWithTag(Context->Buffers[1], TAG_KMIXER);
     }
 
-    /* fixme use asm */
-    if (BytesPerSample == 1)
-    {
-        for(Index = 0; Index < NumSamples * NumChannels; Index++)
-            FloatIn[Index] = (float)(Buffer[Index] / (1.0 * 0x80));
-    }
-    else if (BytesPerSample == 2)
-    {
-        src_short_to_float_array((short*)Buffer, FloatIn, NumSamples * NumChannels);
-    }
-    else if (BytesPerSample == 4)
+    Context->Buffers[0] = Buffers[0];
+    Context->Buffers[1] = Buffers[1];
+    Context->BufferSize = Size;
+    return STATUS_SUCCESS;
+}
+
+static
+VOID
+FreeConversionBuffers(
+    IN PPIN_CONTEXT Context)
+{
+    if (Context->Buffers[0])
     {
-        src_int_to_float_array((int*)Buffer, FloatIn, NumSamples * NumChannels);
+        ExFreePoolWithTag(Context->Buffers[0], TAG_KMIXER);
+        ExFreePoolWithTag(Context->Buffers[1], TAG_KMIXER);
+        Context->Buffers[0] = Context->Buffers[1] = NULL;
     }
+    Context->BufferSize = 0;
+}
+
+NTSTATUS
+PerformSampleRateConversion(
+    PPIN_CONTEXT Context,
+    PUCHAR Buffer,
+    ULONG BufferLength,
+    ULONG OldWidth,
+    ULONG NewWidth,
+    PUCHAR BufferOut,
+    ULONG BufferOutSize,
+    PULONG ResultLength)
+{
+    PMIX_RESAMPLER Resampler = &Context->Resampler;
+    KFLOATING_SAVE FloatSave;
+    NTSTATUS Status;
+    ULONG NumSamples;
+    ULONG NewSamples;
+    ULONG Generated;
+    int error;
 
-    Data.data_in = FloatIn;
-    Data.data_out = FloatOut;
-    Data.input_frames = NumSamples;
-    Data.output_frames = NewSamples;
-    Data.src_ratio = (double)NewRate / (double)OldRate;
+    DPRINT("PerformSampleRateConversion OldRate %u NewRate %u OldWidth %u NewWidth %u NumChannels %u Irql %u\n",
+           Resampler->InRate, Resampler->OutRate, OldWidth, NewWidth, Resampler->Channels, KeGetCurrentIrql());
 
-    error = src_process(State, &Data);
-    if (error)
+    ASSERT(Resampler->State);
+
+    NumSamples = BufferLength / ((OldWidth / 8) * Resampler->Channels);
+    NewSamples = MixResamplerMaxOutput(Resampler, NumSamples);
+    ASSERT(NewSamples * Resampler->Channels * (NewWidth / 8) <= BufferOutSize);
+
+    /* first acquire float save context */
+    Status = KeSaveFloatingPointState(&FloatSave);
+    if (!NT_SUCCESS(Status))
     {
-        DPRINT1("src_process failed with %x\n", error);
-        KeRestoreFloatingPointState(&FloatSave);
-        ExFreePool(FloatIn);
-        ExFreePool(FloatOut);
-        ExFreePool(ResultOut);
-        return STATUS_UNSUCCESSFUL;
+        DPRINT1("KeSaveFloatingPointState failed with %x\n", Status);
+        return Status;
     }
 
-    if (BytesPerSample == 1)
-    {
-        /* FIXME perform over/under clipping */
+    error = MixResamplerProcess(Resampler, Buffer, OldWidth, NumSamples, BufferOut, NewWidth, NewSamples, &Generated);
 
-        for(Index = 0; Index < Data.output_frames_gen * NumChannels; Index++)
-            ResultOut[Index] = (lrintf(FloatOut[Index]) >> 24);
-    }
-    else if (BytesPerSample == 2)
-    {
-        PUSHORT Res = (PUSHORT)ResultOut;
+    KeRestoreFloatingPointState(&FloatSave);
 
-        src_float_to_short_array(FloatOut, (short*)Res, Data.output_frames_gen * NumChannels);
-    }
-    else if (BytesPerSample == 4)
+    if (error)
     {
-        PULONG Res = (PULONG)ResultOut;
-
-        src_float_to_int_array(FloatOut, (int*)Res, Data.output_frames_gen * NumChannels);
+        DPRINT1("src_process failed with %x\n", error);
+        MixResamplerReset(Resampler);
+        return STATUS_UNSUCCESSFUL;
     }
 
-
-    *Result = ResultOut;
-    *ResultLength = Data.output_frames_gen * BytesPerSample * NumChannels;
-    ExFreePool(FloatIn);
-    ExFreePool(FloatOut);
-    src_delete(State);
-    KeRestoreFloatingPointState(&FloatSave);
+    *ResultLength = Generated * Resampler->Channels * (NewWidth / 8);
     return STATUS_SUCCESS;
 }
 
@@ -158,262 +197,89 @@ PerformChannelConversion(
     ULONG OldChannels,
     ULONG NewChannels,
     ULONG BitsPerSample,
-    PVOID * Result,
+    PUCHAR BufferOut,
+    ULONG BufferOutSize,
     PULONG ResultLength)
 {
     ULONG Samples;
-    ULONG NewIndex, OldIndex;
+    ULONG Width = BitsPerSample / 8;
+    ULONG NewIndex, OldIndex, SubIndex;
 
-    Samples = BufferLength / (BitsPerSample / 8) / OldChannels;
+    Samples = BufferLength / Width / OldChannels;
+    ASSERT(Samples * NewChannels * Width <= BufferOutSize);
 
-    if (NewChannels > OldChannels)
+    for(NewIndex = 0, OldIndex = 0; OldIndex < Samples * OldChannels * Width; NewIndex += NewChannels * Width, OldIndex += OldChannels * Width)
     {
-        if (BitsPerSample == 8)
-        {
-            PUCHAR BufferOut = ExAllocatePool(NonPagedPool, Samples * NewChannels);
-            if (!BufferOut)
-                return STATUS_INSUFFICIENT_RESOURCES;
-
-            for(NewIndex = 0, OldIndex = 0; OldIndex < Samples * OldChannels; NewIndex += NewChannels, OldIndex += OldChannels)
-            {
-                ULONG SubIndex = 0;
-
-                RtlMoveMemory(&BufferOut[NewIndex], &Buffer[OldIndex], OldChannels * sizeof(UCHAR));
-
-                do
-                {
-                    /* 2 channel stretched to 4 looks like LRLR */
-                     BufferOut[NewIndex+OldChannels + SubIndex] = Buffer[OldIndex + (SubIndex % OldChannels)];
-                }while(SubIndex++ < NewChannels - OldChannels);
-            }
-            *Result = BufferOut;
-            *ResultLength = Samples * NewChannels;
-        }
-        else if (BitsPerSample == 16)
-        {
-            PUSHORT BufferOut = ExAllocatePool(NonPagedPool, Samples * NewChannels);
-            if (!BufferOut)
-                return STATUS_INSUFFICIENT_RESOURCES;
-
-            for(NewIndex = 0, OldIndex = 0; OldIndex < Samples * OldChannels; NewIndex += NewChannels, OldIndex += OldChannels)
-            {
-                ULONG SubIndex = 0;
-
-                RtlMoveMemory(&BufferOut[NewIndex], &Buffer[OldIndex], OldChannels * sizeof(USHORT));
-
-                do
-                {
-                     BufferOut[NewIndex+OldChannels + SubIndex] = Buffer[OldIndex + (SubIndex % OldChannels)];
-                }while(SubIndex++ < NewChannels - OldChannels);
-            }
-            *Result = BufferOut;
-            *ResultLength = Samples * NewChannels;
-        }
-        else if (BitsPerSample == 24)
-        {
-            PUCHAR BufferOut = ExAllocatePool(NonPagedPool, Samples * NewChannels);
-            if (!BufferOut)
-                return STATUS_INSUFFICIENT_RESOURCES;
-
-            for(NewIndex = 0, OldIndex = 0; OldIndex < Samples * OldChannels; NewIndex += NewChannels, OldIndex += OldChannels)
-            {
-                ULONG SubIndex = 0;
-
-                RtlMoveMemory(&BufferOut[NewIndex], &Buffer[OldIndex], OldChannels * 3);
-
-                do
-                {
-                     RtlMoveMemory(&BufferOut[(NewIndex+OldChannels + SubIndex) * 3], &Buffer[(OldIndex + (SubIndex % OldChannels)) * 3], 3);
-                }while(SubIndex++ < NewChannels - OldChannels);
-            }
-            *Result = BufferOut;
-            *ResultLength = Samples * NewChannels;
-        }
-        else if (BitsPerSample == 32)
+        if (NewChannels > OldChannels)
         {
-            PULONG BufferOut = ExAllocatePool(NonPagedPool, Samples * NewChannels);
-            if (!BufferOut)
-                return STATUS_INSUFFICIENT_RESOURCES;
+            RtlMoveMemory(&BufferOut[NewIndex], &Buffer[OldIndex], OldChannels * Width);
 
-            for(NewIndex = 0, OldIndex = 0; OldIndex < Samples * OldChannels; NewIndex += NewChannels, OldIndex += OldChannels)
+            for (SubIndex = 0; SubIndex < NewChannels - OldChannels; SubIndex++)
             {
-                ULONG SubIndex = 0;
-
-                RtlMoveMemory(&BufferOut[NewIndex], &Buffer[OldIndex], OldChannels * sizeof(ULONG));
-
-                do
-                {
-                     BufferOut[NewIndex+OldChannels + SubIndex] = Buffer[OldIndex + (SubIndex % OldChannels)];
-                }while(SubIndex++ < NewChannels - OldChannels);
+                /* 2 channel stretched to 4 looks like LRLR */
+                RtlMoveMemory(&BufferOut[NewIndex + (OldChannels + SubIndex) * Width],
+                              &Buffer[OldIndex + (SubIndex % OldChannels) * Width],
+                              Width);
             }
-            *Result = BufferOut;
-            *ResultLength = Samples * NewChannels;
         }
-
-    }
-    else
-    {
-        PUSHORT BufferOut = ExAllocatePool(NonPagedPool, Samples * NewChannels);
-        if (!BufferOut)
-            return STATUS_INSUFFICIENT_RESOURCES;
-
-        for(NewIndex = 0, OldIndex = 0; OldIndex < Samples * OldChannels; NewIndex += NewChannels, OldIndex += OldChannels)
+        else
         {
             /* TODO
              * mix stream instead of just dumping part of it ;)
              */
-            RtlMoveMemory(&BufferOut[NewIndex], &Buffer[OldIndex], NewChannels * (BitsPerSample/8));
+            RtlMoveMemory(&BufferOut[NewIndex], &Buffer[OldIndex], NewChannels * Width);
         }
-
-        *Result = BufferOut;
-        *ResultLength = Samples * NewChannels;
     }
+
+    *ResultLength = Samples * NewChannels * Width;
     return STATUS_SUCCESS;
 }
 
 
 NTSTATUS
 PerformQualityConversion(
+    PPIN_CONTEXT Context,
     PUCHAR Buffer,
     ULONG BufferLength,
     ULONG OldWidth,
     ULONG NewWidth,
-    PVOID * Result,
+    PUCHAR BufferOut,
+    ULONG BufferOutSize,
     PULONG ResultLength)
 {
+    KFLOATING_SAVE FloatSave;
+    MIX_STREAM Stream;
+    NTSTATUS Status;
     ULONG Samples;
-    ULONG Index;
 
     ASSERT(OldWidth != NewWidth);
 
+    if ((OldWidth != 8 && OldWidth != 16 && OldWidth != 24 && OldWidth != 32) ||
+        (NewWidth != 8 && NewWidth != 16 && NewWidth != 24 && NewWidth != 32))
+    {
+        DPRINT1("Not implemented conversion OldWidth %u NewWidth %u\n", OldWidth, NewWidth);
+        return STATUS_NOT_IMPLEMENTED;
+    }
+
     Samples = BufferLength / (OldWidth / 8);
     //DPRINT("Samples %u BufferLength %u\n", Samples, BufferLength);
+    ASSERT(Samples * (NewWidth / 8) <= BufferOutSize);
 
-    if (OldWidth == 8 && NewWidth == 16)
-    {
-         USHORT Sample;
-         PUSHORT BufferOut = ExAllocatePool(NonPagedPool, Samples * sizeof(USHORT));
-         if (!BufferOut)
-             return STATUS_INSUFFICIENT_RESOURCES;
-
-          for(Index = 0; Index < Samples; Index++)
-          {
-              Sample = Buffer[Index];
-              Sample *= 2;
-#ifdef _X86_
-              Sample = _byteswap_ushort(Sample);
-#endif
-              BufferOut[Index] = Sample;
-          }
-          *Result = BufferOut;
-          *ResultLength = Samples * sizeof(USHORT);
-    }
-    else if (OldWidth == 8 && NewWidth == 32)
-    {
-         ULONG Sample;
-         PULONG BufferOut = ExAllocatePool(NonPagedPool, Samples * sizeof(ULONG));
-         if (!BufferOut)
-             return STATUS_INSUFFICIENT_RESOURCES;
-
-          for(Index = 0; Index < Samples; Index++)
-          {
-              Sample = Buffer[Index];
-              Sample *= 16777216;
-#ifdef _X86_
-              Sample = _byteswap_ulong(Sample);
-#endif
-              BufferOut[Index] = Sample;
-          }
-          *Result = BufferOut;
-          *ResultLength = Samples * sizeof(ULONG);
-    }
-    else if (OldWidth == 16 && NewWidth == 32)
+    Status = KeSaveFloatingPointState(&FloatSave);
+    if (!NT_SUCCESS(Status))
     {
-         ULONG Sample;
-         PUSHORT BufferIn = (PUSHORT)Buffer;
-         PULONG BufferOut = ExAllocatePool(NonPagedPool, Samples * sizeof(ULONG));
-         if (!BufferOut)
-             return STATUS_INSUFFICIENT_RESOURCES;
-
-          for(Index = 0; Index < Samples; Index++)
-          {
-              Sample = BufferIn[Index];
-              Sample *= 65536;
-#ifdef _X86_
-              Sample = _byteswap_ulong(Sample);
-#endif
-              BufferOut[Index] = Sample;
-          }
-          *Result = BufferOut;
-          *ResultLength = Samples * sizeof(ULONG);
+        DPRINT1("KeSaveFloatingPointState failed with %x\n", Status);
+        return Status;
     }
 
-    else if (OldWidth == 16 && NewWidth == 8)
-    {
-         USHORT Sample;
-         PUSHORT BufferIn = (PUSHORT)Buffer;
-         PUCHAR BufferOut = ExAllocatePool(NonPagedPool, Samples * sizeof(UCHAR));
-         if (!BufferOut)
-             return STATUS_INSUFFICIENT_RESOURCES;
-
-          for(Index = 0; Index < Samples; Index++)
-          {
-              Sample = BufferIn[Index];
-#ifdef _X86_
-              Sample = _byteswap_ushort(Sample);
-#endif
-              Sample /= 256;
-              BufferOut[Index] = (Sample & 0xFF);
-          }
-          *Result = BufferOut;
-          *ResultLength = Samples * sizeof(UCHAR);
-    }
-    else if (OldWidth == 32 && NewWidth == 8)
-    {
-         ULONG Sample;
-         PULONG BufferIn = (PULONG)Buffer;
-         PUCHAR BufferOut = ExAllocatePool(NonPagedPool, Samples * sizeof(UCHAR));
-         if (!BufferOut)
-             return STATUS_INSUFFICIENT_RESOURCES;
-
-          for(Index = 0; Index < Samples; Index++)
-          {
-              Sample = BufferIn[Index];
-#ifdef _X86_
-              Sample = _byteswap_ulong(Sample);
-#endif
-              Sample /= 16777216;
-              BufferOut[Index] = (Sample & 0xFF);
-          }
-          *Result = BufferOut;
-          *ResultLength = Samples * sizeof(UCHAR);
-    }
-    else if (OldWidth == 32 && NewWidth == 16)
-    {
-         USHORT Sample;
-         PULONG BufferIn = (PULONG)Buffer;
-         PUSHORT BufferOut = ExAllocatePool(NonPagedPool, Samples * sizeof(USHORT));
-         if (!BufferOut)
-             return STATUS_INSUFFICIENT_RESOURCES;
-
-          for(Index = 0; Index < Samples; Index++)
-          {
-              Sample = BufferIn[Index];
-#ifdef _X86_
-              Sample = _byteswap_ulong(Sample);
-#endif
-              Sample /= 65536;
-              BufferOut[Index] = (Sample & 0xFFFF);
-          }
-          *Result = BufferOut;
-          *ResultLength = Samples * sizeof(USHORT);
-    }
-    else
-    {
-        DPRINT1("Not implemented conversion OldWidth %u NewWidth %u\n", OldWidth, NewWidth);
-        return STATUS_NOT_IMPLEMENTED;
-    }
+    Stream.Data = Buffer;
+    Stream.BitsPerSample = OldWidth;
+    Stream.Gain = 1.0f;
+    MixStreams(&Stream, 1, Samples, Context->Accumulator, MIX_MIN_FRAMES, NewWidth, BufferOut);
 
+    KeRestoreFloatingPointState(&FloatSave);
+
+    *ResultLength = Samples * (NewWidth / 8);
     return STATUS_SUCCESS;
 }
 
@@ -438,24 +304,43 @@ Pin_fnDeviceIoControl(
         {
             if (Property->Property.Id == KSPROPERTY_CONNECTION_DATAFORMAT && Property->Property.Flags == KSPROPERTY_TYPE_SET)
             {
+                PPIN_CONTEXT Context;
                 PKSDATAFORMAT_WAVEFORMATEX Formats;
                 PKSDATAFORMAT_WAVEFORMATEX WaveFormat;
+                NTSTATUS Status;
 
-                Formats = (PKSDATAFORMAT_WAVEFORMATEX)IoStack->FileObject->FsContext2;
+                Context = (PPIN_CONTEXT)IoStack->FileObject->FsContext;
                 WaveFormat = (PKSDATAFORMAT_WAVEFORMATEX)Irp->UserBuffer;
 
                 ASSERT(Property->PinId == 0 || Property->PinId == 1);
-                ASSERT(Formats);
+                ASSERT(Context);
                 ASSERT(WaveFormat);
 
+                ExAcquireFastMutex(&Context->Lock);
+
+                Formats = Context->Formats;
                 Formats[Property->PinId].WaveFormatEx.nChannels = WaveFormat->WaveFormatEx.nChannels;
                 Formats[Property->PinId].WaveFormatEx.wBitsPerSample = WaveFormat->WaveFormatEx.wBitsPerSample;
                 Formats[Property->PinId].WaveFormatEx.nSamplesPerSec = WaveFormat->WaveFormatEx.nSamplesPerSec;
 
+                /* set up the resampler now rather than with the first packet */
+                Status = UpdateResampler(Context);
+
+                /* and size the conversion buffers for 100 ms, like the resampler */
+                if (NT_SUCCESS(Status) &&
+                    Formats[0].WaveFormatEx.nSamplesPerSec && Formats[0].WaveFormatEx.nChannels &&
+                    Formats[1].WaveFormatEx.nChannels && Formats[1].WaveFormatEx.wBitsPerSample)
+                {
+                    Status = ReserveConversionBuffers(Context,
+                                                      GetConversionBufferSize(Context, Formats[0].WaveFormatEx.nSamplesPerSec / 10));
+                }
+
+                ExReleaseFastMutex(&Context->Lock);
+
                 Irp->IoStatus.Information = 0;
-                Irp->IoStatus.Status = STATUS_SUCCESS;
+                Irp->IoStatus.Status = Status;
                 IoCompleteRequest(Irp, IO_NO_INCREMENT);
-                return STATUS_SUCCESS;
+                return Status;
             }
         }
     }
@@ -514,7 +399,20 @@ Pin_fnClose(
     PDEVICE_OBJECT DeviceObject,
     PIRP Irp)
 {
-    UNIMPLEMENTED;
+    PIO_STACK_LOCATION IoStack;
+    PPIN_CONTEXT Context;
+
+    IoStack = IoGetCurrentIrpStackLocation(Irp);
+    Context = (PPIN_CONTEXT)IoStack->FileObject->FsContext;
+
+    if (Context)
+    {
+        MixResamplerFree(&Context->Resampler);
+        FreeConversionBuffers(Context);
+        ExFreePoolWithTag(Context->Accumulator, TAG_KMIXER);
+        ExFreePoolWithTag(Context, TAG_KMIXER);
+        IoStack->FileObject->FsContext = NULL;
+    }
 
     Irp->IoStatus.Status = STATUS_SUCCESS;
     Irp->IoStatus.Information = 0;
@@ -588,6 +486,11 @@ Pin_fnFastRead(
 
 }
 
+/*
+ * Converted data is left in one of the pin's conversion buffers and
+ * StreamHeader->Data points there until the next packet or the pin is
+ * closed. The caller keeps owning the buffer it passed in.
+ */
 BOOLEAN
 NTAPI
 Pin_fnFastWrite(
@@ -601,77 +504,101 @@ Pin_fnFastWrite(
     PDEVICE_OBJECT DeviceObject)
 {
     PKSSTREAM_HEADER StreamHeader;
-    PVOID BufferOut;
     ULONG BufferLength;
+    ULONG FrameSize;
     NTSTATUS Status = STATUS_SUCCESS;
-    PKSDATAFORMAT_WAVEFORMATEX Formats;
+    PPIN_CONTEXT Context;
     PKSDATAFORMAT_WAVEFORMATEX InputFormat, OutputFormat;
 
     DPRINT("Pin_fnFastWrite called DeviceObject %p Irp %p\n", DeviceObject);
 
-    Formats = (PKSDATAFORMAT_WAVEFORMATEX)FileObject->FsContext2;
+    Context = (PPIN_CONTEXT)FileObject->FsContext;
 
-    InputFormat = Formats;
-    OutputFormat = (Formats + 1);
+    InputFormat = &Context->Formats[0];
+    OutputFormat = &Context->Formats[1];
     StreamHeader = (PKSSTREAM_HEADER)Buffer;
 
+    ExAcquireFastMutex(&Context->Lock);
 
     DPRINT("Num Channels %u Old Channels %u\n SampleRate %u Old SampleRate %u\n BitsPerSample %u Old BitsPerSample %u\n",
                InputFormat->WaveFormatEx.nChannels, OutputFormat->WaveFormatEx.nChannels,
                InputFormat->WaveFormatEx.nSamplesPerSec, OutputFormat->WaveFormatEx.nSamplesPerSec,
                InputFormat->WaveFormatEx.wBitsPerSample, OutputFormat->WaveFormatEx.wBitsPerSample);
 
-    if (InputFormat->WaveFormatEx.wBitsPerSample != OutputFormat->WaveFormatEx.wBitsPerSample)
+    FrameSize = InputFormat->WaveFormatEx.nChannels * (InputFormat->WaveFormatEx.wBitsPerSample / 8);
+    if (!FrameSize)
+        Status = STATUS_INVALID_DEVICE_STATE;
+
+    if (NT_SUCCESS(Status) &&
+        InputFormat->WaveFormatEx.nSamplesPerSec != OutputFormat->WaveFormatEx.nSamplesPerSec)
     {
-        Status = PerformQualityConversion(StreamHeader->Data,
-                                          StreamHeader->DataUsed,
-                                          InputFormat->WaveFormatEx.wBitsPerSample,
-                                          OutputFormat->WaveFormatEx.wBitsPerSample,
-                                          &BufferOut,
-                                          &BufferLength);
-        if (NT_SUCCESS(Status))
-        {
-            ExFreePool(StreamHeader->Data);
-            StreamHeader->Data = BufferOut;
-            StreamHeader->DataUsed = BufferLength;
-        }
+        Status = UpdateResampler(Context);
     }
 
-    if (InputFormat->WaveFormatEx.nChannels != OutputFormat->WaveFormatEx.nChannels)
+    /* normally a no-op, the buffers were sized when the formats were set */
+    if (NT_SUCCESS(Status))
+    {
+        Status = ReserveConversionBuffers(Context,
+                                          GetConversionBufferSize(Context, StreamHeader->DataUsed / FrameSize));
+    }
+
+    /* channels first, so that the conversions below touch each frame once */
+    if (NT_SUCCESS(Status) &&
+        InputFormat->WaveFormatEx.nChannels != OutputFormat->WaveFormatEx.nChannels)
     {
         Status = PerformChannelConversion(StreamHeader->Data,
                                           StreamHeader->DataUsed,
                                           InputFormat->WaveFormatEx.nChannels,
                                           OutputFormat->WaveFormatEx.nChannels,
-                                          OutputFormat->WaveFormatEx.wBitsPerSample,
-                                          &BufferOut,
+                                          InputFormat->WaveFormatEx.wBitsPerSample,
+                                          Context->Buffers[0],
+                                          Context->BufferSize,
                                           &BufferLength);
 
         if (NT_SUCCESS(Status))
         {
-            ExFreePool(StreamHeader->Data);
-            StreamHeader->Data = BufferOut;
+            StreamHeader->Data = Context->Buffers[0];
             StreamHeader->DataUsed = BufferLength;
         }
     }
 
-    if (InputFormat->WaveFormatEx.nSamplesPerSec != OutputFormat->WaveFormatEx.nSamplesPerSec)
+    if (NT_SUCCESS(Status) &&
+        InputFormat->WaveFormatEx.nSamplesPerSec != OutputFormat->WaveFormatEx.nSamplesPerSec)
     {
-        Status = PerformSampleRateConversion(StreamHeader->Data,
+        /* the resampler converts the sample width on its way out */
+        Status = PerformSampleRateConversion(Context,
+                                             StreamHeader->Data,
                                              StreamHeader->DataUsed,
-                                             InputFormat->WaveFormatEx.nSamplesPerSec,
-                                             OutputFormat->WaveFormatEx.nSamplesPerSec,
-                                             OutputFormat->WaveFormatEx.wBitsPerSample / 8,
-                                             OutputFormat->WaveFormatEx.nChannels,
-                                             &BufferOut,
+                                             InputFormat->WaveFormatEx.wBitsPerSample,
+                                             OutputFormat->WaveFormatEx.wBitsPerSample,
+                                             Context->Buffers[1],
+                                             Context->BufferSize,
                                              &BufferLength);
         if (NT_SUCCESS(Status))
         {
-            ExFreePool(StreamHeader->Data);
-            StreamHeader->Data = BufferOut;
+            StreamHeader->Data = Context->Buffers[1];
             StreamHeader->DataUsed = BufferLength;
         }
     }
+    else if (NT_SUCCESS(Status) &&
+             InputFormat->WaveFormatEx.wBitsPerSample != OutputFormat->WaveFormatEx.wBitsPerSample)
+    {
+        Status = PerformQualityConversion(Context,
+                                          StreamHeader->Data,
+                                          StreamHeader->DataUsed,
+                                          InputFormat->WaveFormatEx.wBitsPerSample,
+                                          OutputFormat->WaveFormatEx.wBitsPerSample,
+                                          Context->Buffers[1],
+                                          Context->BufferSize,
+                                          &BufferLength);
+        if (NT_SUCCESS(Status))
+        {
+            StreamHeader->Data = Context->Buffers[1];
+            StreamHeader->DataUsed = BufferLength;
+        }
+    }
+
+    ExReleaseFastMutex(&Context->Lock);
 
     IoStatus->Status = Status;
 
@@ -701,21 +628,36 @@ CreatePin(
 {
     NTSTATUS Status;
     KSOBJECT_HEADER ObjectHeader;
-    PKSDATAFORMAT DataFormat;
+    PPIN_CONTEXT Context;
     PIO_STACK_LOCATION IoStack;
 
-
-    DataFormat = ExAllocatePool(NonPagedPool, sizeof(KSDATAFORMAT_WAVEFORMATEX) * 2);
-    if (!DataFormat)
+    Context = ExAllocatePoolWithTag(NonPagedPool, sizeof(PIN_CONTEXT), TAG_KMIXER);
+    if (!Context)
         return STATUS_INSUFFICIENT_RESOURCES;
 
-    RtlZeroMemory(DataFormat, sizeof(KSDATAFORMAT_WAVEFORMATEX) * 2);
+    RtlZeroMemory(Context, sizeof(PIN_CONTEXT));
+    ExInitializeFastMutex(&Context->Lock);
 
+    /* the only buffer packets need that depends on neither format */
+    Context->Accumulator = ExAllocatePoolWithTag(NonPagedPool, MIX_MIN_FRAMES * sizeof(FLOAT), TAG_KMIXER);
+    if (!Context->Accumulator)
+    {
+        ExFreePoolWithTag(Context, TAG_KMIXER);
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    /* FsContext2 is taken by the object header */
     IoStack = IoGetCurrentIrpStackLocation(Irp);
-    IoStack->FileObject->FsContext2 = (PVOID)DataFormat;
+    IoStack->FileObject->FsContext = (PVOID)Context;
 
     /* allocate object header */
     Status = KsAllocateObjectHeader(&ObjectHeader, 0, NULL, Irp, &PinTable);
+    if (!NT_SUCCESS(Status))
+    {
+        IoStack->FileObject->FsContext = NULL;
+        ExFreePoolWithTag(Context->Accumulator, TAG_KMIXER);
+        ExFreePoolWithTag(Context, TAG_KMIXER);
+    }
     return Status;
 }
 
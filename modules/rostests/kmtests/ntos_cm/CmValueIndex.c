@@ -0,0 +1,178 @@
+/*
+ * PROJECT:     ReactOS kernel-mode tests
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Kernel-Mode Test Suite registry value name index test
+ */
+
+#include <kmt_test.h>
+
+/* Well above the value count at which the KCB gets a name index */
+#define VALUE_COUNT 200
+
+static
+NTSTATUS
+SetValue(
+    _In_ HANDLE KeyHandle,
+    _In_ PCWSTR Format,
+    _In_ ULONG Number)
+{
+    NTSTATUS Status;
+    WCHAR Buffer[32];
+    UNICODE_STRING ValueName;
+
+    Status = RtlStringCbPrintfW(Buffer, sizeof(Buffer), Format, Number);
+    if (!NT_SUCCESS(Status))
+        return Status;
+
+    RtlInitUnicodeString(&ValueName, Buffer);
+    return ZwSetValueKey(KeyHandle, &ValueName, 0, REG_DWORD, &Number, sizeof(Number));
+}
+
+static
+NTSTATUS
+QueryValue(
+    _In_ HANDLE KeyHandle,
+    _In_ PCWSTR Format,
+    _In_ ULONG Number,
+    _Out_ PULONG Data)
+{
+    NTSTATUS Status;
+    WCHAR Buffer[32];
+    UNICODE_STRING ValueName;
+    UCHAR InfoBuffer[FIELD_OFFSET(KEY_VALUE_PARTIAL_INFORMATION, Data) + sizeof(ULONG)];
+    PKEY_VALUE_PARTIAL_INFORMATION Info = (PVOID)InfoBuffer;
+    ULONG ResultLength;
+
+    *Data = MAXULONG;
+    Status = RtlStringCbPrintfW(Buffer, sizeof(Buffer), Format, Number);
+    if (!NT_SUCCESS(Status))
+        return Status;
+
+    RtlInitUnicodeString(&ValueName, Buffer);
+    Status = ZwQueryValueKey(KeyHandle,
+                             &ValueName,
+                             KeyValuePartialInformation,
+                             Info,
+                             sizeof(InfoBuffer),
+                             &ResultLength);
+    if (NT_SUCCESS(Status))
+        *Data = *(PULONG)Info->Data;
+    return Status;
+}
+
+static
+NTSTATUS
+DeleteValue(
+    _In_ HANDLE KeyHandle,
+    _In_ PCWSTR Format,
+    _In_ ULONG Number)
+{
+    NTSTATUS Status;
+    WCHAR Buffer[32];
+    UNICODE_STRING ValueName;
+
+    Status = RtlStringCbPrintfW(Buffer, sizeof(Buffer), Format, Number);
+    if (!NT_SUCCESS(Status))
+        return Status;
+
+    RtlInitUnicodeString(&ValueName, Buffer);
+    return ZwDeleteValueKey(KeyHandle, &ValueName);
+}
+
+static
+VOID
+TestValueIndex(
+    _In_ HANDLE KeyHandle)
+{
+    NTSTATUS Status;
+    ULONG Data;
+    ULONG i;
+
+    for (i = 0; i < VALUE_COUNT; i++)
+    {
+        Status = SetValue(KeyHandle, L"Value%lu", i);
+        ok_eq_hex(Status, STATUS_SUCCESS);
+    }
+
+    /* Every value has to be found, whatever the case of the name */
+    for (i = 0; i < VALUE_COUNT; i++)
+    {
+        Status = QueryValue(KeyHandle, L"Value%lu", i, &Data);
+        ok_eq_hex(Status, STATUS_SUCCESS);
+        ok_eq_ulong(Data, i);
+        Status = QueryValue(KeyHandle, L"VALUE%lu", i, &Data);
+        ok_eq_hex(Status, STATUS_SUCCESS);
+        ok_eq_ulong(Data, i);
+    }
+
+    /* Names that are not there */
+    Status = QueryValue(KeyHandle, L"Value%lu", VALUE_COUNT, &Data);
+    ok_eq_hex(Status, STATUS_OBJECT_NAME_NOT_FOUND);
+    Status = QueryValue(KeyHandle, L"Value%lux", 1, &Data);
+    ok_eq_hex(Status, STATUS_OBJECT_NAME_NOT_FOUND);
+
+    /* Deleting values has to invalidate the index */
+    for (i = 0; i < VALUE_COUNT; i += 2)
+    {
+        Status = DeleteValue(KeyHandle, L"value%lu", i);
+        ok_eq_hex(Status, STATUS_SUCCESS);
+    }
+    for (i = 0; i < VALUE_COUNT; i++)
+    {
+        Status = QueryValue(KeyHandle, L"Value%lu", i, &Data);
+        if (i % 2)
+        {
+            ok_eq_hex(Status, STATUS_SUCCESS);
+            ok_eq_ulong(Data, i);
+        }
+        else
+        {
+            ok_eq_hex(Status, STATUS_OBJECT_NAME_NOT_FOUND);
+        }
+    }
+
+    /* And so has adding them */
+    for (i = 0; i < VALUE_COUNT; i += 2)
+    {
+        Status = SetValue(KeyHandle, L"Other%lu", i);
+        ok_eq_hex(Status, STATUS_SUCCESS);
+        Status = QueryValue(KeyHandle, L"OTHER%lu", i, &Data);
+        ok_eq_hex(Status, STATUS_SUCCESS);
+        ok_eq_ulong(Data, i);
+    }
+    Status = QueryValue(KeyHandle, L"Value%lu", 1, &Data);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    ok_eq_ulong(Data, 1);
+}
+
+START_TEST(CmValueIndex)
+{
+    NTSTATUS Status;
+    UNICODE_STRING KeyName;
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    HANDLE KeyHandle;
+
+    RtlInitUnicodeString(&KeyName, L"\\Registry\\MACHINE\\Software\\CmValueIndexKmtestKey");
+    InitializeObjectAttributes(&ObjectAttributes,
+                               &KeyName,
+                               OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE,
+                               NULL,
+                               NULL);
+    Status = ZwCreateKey(&KeyHandle,
+                         KEY_QUERY_VALUE | KEY_SET_VALUE | DELETE,
+                         &ObjectAttributes,
+                         0,
+                         NULL,
+                         REG_OPTION_VOLATILE,
+                         NULL);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    if (skip(NT_SUCCESS(Status), "No test key\n"))
+        return;
+
+    TestValueIndex(KeyHandle);
+
+    Status = ZwDeleteKey(KeyHandle);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    Status = ZwClose(KeyHandle);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+}
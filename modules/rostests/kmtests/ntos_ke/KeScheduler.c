@@ -0,0 +1,178 @@
+/*
+ * PROJECT:     ReactOS kernel-mode tests
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Kernel-Mode Test Suite SMP dispatcher test
+ */
+
+#include <kmt_test.h>
+
+#define MAX_SPIN_THREADS 8
+#define SPIN_TIME_MS 200
+#define MIGRATE_TIMEOUT_MS 1000
+
+#define PROCESSOR_MASK(Number) ((KAFFINITY)1 << (Number))
+
+typedef struct _SPIN_THREAD_DATA
+{
+    PKEVENT StartEvent;
+    volatile LONG *Stop;
+    ULONG64 Iterations;
+    KAFFINITY ProcessorsSeen;
+    volatile LONG CurrentProcessor;
+} SPIN_THREAD_DATA, *PSPIN_THREAD_DATA;
+
+static
+ULONGLONG
+InterruptTimeMs(VOID)
+{
+    return KeQueryInterruptTime() / 10000;
+}
+
+static
+VOID
+SleepMs(
+    IN ULONG Milliseconds)
+{
+    LARGE_INTEGER Interval;
+
+    Interval.QuadPart = -10000LL * Milliseconds;
+    KeDelayExecutionThread(KernelMode, FALSE, &Interval);
+}
+
+static
+VOID
+NTAPI
+SpinThread(
+    IN PVOID Context)
+{
+    PSPIN_THREAD_DATA ThreadData = Context;
+    ULONG Processor;
+
+    KeWaitForSingleObject(ThreadData->StartEvent, Executive, KernelMode, FALSE, NULL);
+    while (!*ThreadData->Stop)
+    {
+        Processor = KeGetCurrentProcessorNumber();
+        ThreadData->ProcessorsSeen |= PROCESSOR_MASK(Processor);
+        InterlockedExchange(&ThreadData->CurrentProcessor, Processor);
+        ThreadData->Iterations++;
+        YieldProcessor();
+    }
+}
+
+static
+ULONG
+CountBits(
+    IN KAFFINITY Set)
+{
+    ULONG Count = 0;
+
+    while (Set)
+    {
+        Set &= Set - 1;
+        Count++;
+    }
+    return Count;
+}
+
+/* Busy threads of equal priority have to end up on different processors */
+static
+VOID
+TestSpread(VOID)
+{
+    SPIN_THREAD_DATA ThreadData[MAX_SPIN_THREADS];
+    PKTHREAD Threads[MAX_SPIN_THREADS];
+    KEVENT StartEvent;
+    volatile LONG Stop = 0;
+    KAFFINITY Used = 0;
+    ULONG64 Total = 0;
+    ULONG Count, i;
+
+    Count = min(KeNumberProcessors, MAX_SPIN_THREADS);
+    KeInitializeEvent(&StartEvent, NotificationEvent, FALSE);
+    for (i = 0; i < Count; i++)
+    {
+        RtlZeroMemory(&ThreadData[i], sizeof(ThreadData[i]));
+        ThreadData[i].StartEvent = &StartEvent;
+        ThreadData[i].Stop = &Stop;
+        Threads[i] = KmtStartThread(SpinThread, &ThreadData[i]);
+    }
+
+    KeSetEvent(&StartEvent, IO_NO_INCREMENT, FALSE);
+    SleepMs(SPIN_TIME_MS);
+    InterlockedExchange(&Stop, 1);
+
+    for (i = 0; i < Count; i++)
+    {
+        KmtFinishThread(Threads[i], NULL);
+        Used |= ThreadData[i].ProcessorsSeen;
+        Total += ThreadData[i].Iterations;
+        trace("Thread %lu: %I64u iterations, processors 0x%Ix\n",
+              i, ThreadData[i].Iterations, ThreadData[i].ProcessorsSeen);
+    }
+    trace("%lu threads, %I64u iterations, processors 0x%Ix\n", Count, Total, Used);
+    ok(CountBits(Used) > 1, "Spinning threads only ran on processors 0x%Ix\n", Used);
+}
+
+/* System affinity has to move the current thread right away */
+static
+VOID
+TestSystemAffinity(VOID)
+{
+    CCHAR i;
+
+    for (i = 0; i < KeNumberProcessors; i++)
+    {
+        KeSetSystemAffinityThread(PROCESSOR_MASK(i));
+        ok_eq_ulong(KeGetCurrentProcessorNumber(), (ULONG)i);
+        KeRevertToUserAffinityThread();
+    }
+}
+
+/* Changing the affinity of a thread running elsewhere has to migrate it */
+static
+VOID
+TestThreadAffinity(VOID)
+{
+    SPIN_THREAD_DATA ThreadData;
+    PKTHREAD Thread;
+    KEVENT StartEvent;
+    volatile LONG Stop = 0;
+    ULONGLONG Start;
+    CCHAR Target;
+
+    RtlZeroMemory(&ThreadData, sizeof(ThreadData));
+    KeInitializeEvent(&StartEvent, NotificationEvent, FALSE);
+    ThreadData.StartEvent = &StartEvent;
+    ThreadData.Stop = &Stop;
+    ThreadData.CurrentProcessor = -1;
+    Thread = KmtStartThread(SpinThread, &ThreadData);
+    if (skip(Thread != NULL, "No thread\n"))
+        return;
+    KeSetEvent(&StartEvent, IO_NO_INCREMENT, FALSE);
+
+    for (Target = 0; Target < KeNumberProcessors; Target++)
+    {
+        KeSetAffinityThread(Thread, PROCESSOR_MASK(Target));
+        Start = InterruptTimeMs();
+        while (ThreadData.CurrentProcessor != Target &&
+               InterruptTimeMs() - Start < MIGRATE_TIMEOUT_MS)
+        {
+            SleepMs(1);
+        }
+        ok(ThreadData.CurrentProcessor == Target,
+           "Thread runs on %ld instead of %d\n", ThreadData.CurrentProcessor, Target);
+    }
+
+    InterlockedExchange(&Stop, 1);
+    KmtFinishThread(Thread, NULL);
+}
+
+START_TEST(KeScheduler)
+{
+    if (skip(KeNumberProcessors > 1, "Single processor system\n"))
+        return;
+
+    TestSpread();
+    TestSystemAffinity();
+    TestThreadAffinity();
+}
@@ -33,6 +33,16 @@
     ok_irql(Irql);                                                              \
 } while (0)
 
+static
+BOOLEAN
+(NTAPI
+*pKeSetCoalescableTimer)(
+    _Inout_ PKTIMER Timer,
+    _In_ LARGE_INTEGER DueTime,
+    _In_ ULONG Period,
+    _In_ ULONG TolerableDelay,
+    _In_opt_ PKDPC Dpc);
+
 static
 VOID
 TestTimerFunctional(
@@ -47,6 +57,40 @@ TestTimerFunctional(
     CheckTimer(Timer, TimerNotificationObject + Type, 0L, FALSE, OriginalIrql, (PVOID *)NULL, 0);
 }
 
+static
+VOID
+TestCoalescableTimer(VOID)
+{
+    KTIMER Timer;
+    LARGE_INTEGER DueTime, Timeout;
+    ULONGLONG Start, Elapsed;
+    NTSTATUS Status;
+    BOOLEAN Inserted;
+
+    KeInitializeTimerEx(&Timer, NotificationTimer);
+
+    /* A 100 ms tolerance may delay a 500 ms timer, but never shorten it */
+    DueTime.QuadPart = -500 * 10000LL;
+    Timeout.QuadPart = -2000 * 10000LL;
+    Start = KeQueryInterruptTime();
+    Inserted = pKeSetCoalescableTimer(&Timer, DueTime, 0, 100, NULL);
+    ok_eq_bool(Inserted, FALSE);
+    Status = KeWaitForSingleObject(&Timer, Executive, KernelMode, FALSE, &Timeout);
+    Elapsed = (KeQueryInterruptTime() - Start) / 10000;
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    ok(Elapsed >= 500 - KeQueryTimeIncrement() / 10000, "Timer expired after %I64u ms\n", Elapsed);
+    ok(Elapsed < 500 + 100 + 100, "Timer expired after %I64u ms\n", Elapsed);
+
+    /* Setting it again cancels the pending expiration */
+    DueTime.QuadPart = -1000 * 10000LL;
+    Inserted = pKeSetCoalescableTimer(&Timer, DueTime, 0, 50, NULL);
+    ok_eq_bool(Inserted, FALSE);
+    Inserted = pKeSetCoalescableTimer(&Timer, DueTime, 0, 0, NULL);
+    ok_eq_bool(Inserted, TRUE);
+    ok_eq_bool(KeCancelTimer(&Timer), TRUE);
+    ok_eq_long(KeReadStateTimer(&Timer), 0L);
+}
+
 START_TEST(KeTimer)
 {
     KTIMER Timer;
@@ -54,6 +98,10 @@ START_TEST(KeTimer)
     KIRQL Irqls[] = { PASSIVE_LEVEL, APC_LEVEL, DISPATCH_LEVEL, HIGH_LEVEL };
     INT i;
 
+    pKeSetCoalescableTimer = KmtGetSystemRoutineAddress(L"KeSetCoalescableTimer");
+    if (!skip(pKeSetCoalescableTimer != NULL, "KeSetCoalescableTimer unavailable\n"))
+        TestCoalescableTimer();
+
     for (i = 0; i < sizeof Irqls / sizeof Irqls[0]; ++i)
     {
         /* DRIVER_IRQL_NOT_LESS_OR_EQUAL (TODO: on MP only?) */
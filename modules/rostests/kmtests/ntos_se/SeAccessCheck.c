@@ -0,0 +1,184 @@
+/*
+ * PROJECT:     ReactOS kernel-mode tests
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Kernel-Mode Test Suite access check microbenchmark
+ */
+
+#include <kmt_test.h>
+
+#define FOREIGN_ACE_COUNT 64
+#define ITERATIONS 2000
+
+static const ACCESS_MASK DesiredMasks[] =
+{
+    EVENT_QUERY_STATE,
+    SYNCHRONIZE,
+    READ_CONTROL,
+    EVENT_QUERY_STATE | SYNCHRONIZE,
+    EVENT_QUERY_STATE | READ_CONTROL,
+    SYNCHRONIZE | READ_CONTROL,
+    EVENT_QUERY_STATE | SYNCHRONIZE | READ_CONTROL,
+    MAXIMUM_ALLOWED,
+};
+
+/* A long DACL whose only matching ACE is the last one */
+static
+PACL
+CreateLongDacl(VOID)
+{
+    static SID_IDENTIFIER_AUTHORITY NtAuthority = {SECURITY_NT_AUTHORITY};
+    UCHAR SidBuffer[FIELD_OFFSET(SID, SubAuthority[5])];
+    PSID ForeignSid = (PSID)SidBuffer;
+    PACL Dacl;
+    ULONG AclSize;
+    NTSTATUS Status;
+    ULONG i;
+
+    AclSize = sizeof(ACL) +
+              FOREIGN_ACE_COUNT * (FIELD_OFFSET(ACCESS_ALLOWED_ACE, SidStart) + sizeof(SidBuffer)) +
+              FIELD_OFFSET(ACCESS_ALLOWED_ACE, SidStart) + RtlLengthSid(SeExports->SeLocalSystemSid);
+    Dacl = ExAllocatePoolWithTag(PagedPool, AclSize, 'AeSK');
+    if (!Dacl)
+        return NULL;
+
+    Status = RtlCreateAcl(Dacl, AclSize, ACL_REVISION);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+
+    RtlInitializeSid(ForeignSid, &NtAuthority, 5);
+    *RtlSubAuthoritySid(ForeignSid, 0) = SECURITY_NT_NON_UNIQUE;
+    *RtlSubAuthoritySid(ForeignSid, 1) = 0x1234;
+    *RtlSubAuthoritySid(ForeignSid, 2) = 0x5678;
+    *RtlSubAuthoritySid(ForeignSid, 3) = 0x9ABC;
+    for (i = 0; i < FOREIGN_ACE_COUNT; i++)
+    {
+        *RtlSubAuthoritySid(ForeignSid, 4) = 1000 + i;
+        Status = RtlAddAccessAllowedAce(Dacl, ACL_REVISION, EVENT_ALL_ACCESS, ForeignSid);
+        ok_eq_hex(Status, STATUS_SUCCESS);
+    }
+
+    Status = RtlAddAccessAllowedAce(Dacl,
+                                    ACL_REVISION,
+                                    EVENT_QUERY_STATE | SYNCHRONIZE | READ_CONTROL,
+                                    SeExports->SeLocalSystemSid);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    return Dacl;
+}
+
+static
+NTSTATUS
+OpenEvent(
+    _In_ PUNICODE_STRING Name,
+    _In_ ACCESS_MASK DesiredAccess,
+    _Out_ PACCESS_MASK GrantedAccess)
+{
+    NTSTATUS Status;
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    OBJECT_BASIC_INFORMATION BasicInfo;
+    HANDLE Handle;
+
+    *GrantedAccess = 0;
+    InitializeObjectAttributes(&ObjectAttributes,
+                               Name,
+                               OBJ_KERNEL_HANDLE | OBJ_FORCE_ACCESS_CHECK,
+                               NULL,
+                               NULL);
+    Status = ZwOpenEvent(&Handle, DesiredAccess, &ObjectAttributes);
+    if (!NT_SUCCESS(Status))
+        return Status;
+
+    Status = ZwQueryObject(Handle, ObjectBasicInformation, &BasicInfo, sizeof(BasicInfo), NULL);
+    if (NT_SUCCESS(Status))
+        *GrantedAccess = BasicInfo.GrantedAccess;
+    ObCloseHandle(Handle, KernelMode);
+    return Status;
+}
+
+static
+ULONGLONG
+TimeOpens(
+    _In_ PUNICODE_STRING Name,
+    _In_ BOOLEAN Cycle)
+{
+    LARGE_INTEGER Start, End, Frequency;
+    ACCESS_MASK GrantedAccess;
+    NTSTATUS Status;
+    ULONG i, Failures = 0;
+
+    Start = KeQueryPerformanceCounter(&Frequency);
+    for (i = 0; i < ITERATIONS; i++)
+    {
+        /* Cycling through more masks than a descriptor remembers defeats the cache */
+        Status = OpenEvent(Name,
+                           Cycle ? DesiredMasks[i % RTL_NUMBER_OF(DesiredMasks)] : MAXIMUM_ALLOWED,
+                           &GrantedAccess);
+        if (!NT_SUCCESS(Status))
+            Failures++;
+    }
+    End = KeQueryPerformanceCounter(NULL);
+    ok_eq_ulong(Failures, 0UL);
+
+    /* Nanoseconds per open */
+    return (ULONGLONG)(End.QuadPart - Start.QuadPart) * 1000000000 / Frequency.QuadPart / ITERATIONS;
+}
+
+START_TEST(SeAccessCheck)
+{
+    NTSTATUS Status;
+    UNICODE_STRING Name = RTL_CONSTANT_STRING(L"\\KmtestSeAccessCheckEvent");
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    SECURITY_DESCRIPTOR SecurityDescriptor;
+    ACCESS_MASK FirstAccess, GrantedAccess;
+    HANDLE EventHandle;
+    PACL Dacl;
+    ULONG i;
+
+    Dacl = CreateLongDacl();
+    if (skip(Dacl != NULL, "No DACL\n"))
+        return;
+
+    Status = RtlCreateSecurityDescriptor(&SecurityDescriptor, SECURITY_DESCRIPTOR_REVISION);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    Status = RtlSetDaclSecurityDescriptor(&SecurityDescriptor, TRUE, Dacl, FALSE);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+
+    InitializeObjectAttributes(&ObjectAttributes,
+                               &Name,
+                               OBJ_KERNEL_HANDLE,
+                               NULL,
+                               &SecurityDescriptor);
+    Status = ZwCreateEvent(&EventHandle, EVENT_ALL_ACCESS, &ObjectAttributes, NotificationEvent, FALSE);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    ExFreePoolWithTag(Dacl, 'AeSK');
+    if (skip(NT_SUCCESS(Status), "No event\n"))
+        return;
+
+    /* The first check fills the cache, later ones must get the same answer */
+    Status = OpenEvent(&Name, MAXIMUM_ALLOWED, &FirstAccess);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    ok(FirstAccess & EVENT_QUERY_STATE, "Granted access 0x%lx\n", FirstAccess);
+    ok(FirstAccess & SYNCHRONIZE, "Granted access 0x%lx\n", FirstAccess);
+    ok(!(FirstAccess & EVENT_MODIFY_STATE), "Granted access 0x%lx\n", FirstAccess);
+    for (i = 0; i < 3; i++)
+    {
+        Status = OpenEvent(&Name, MAXIMUM_ALLOWED, &GrantedAccess);
+        ok_eq_hex(Status, STATUS_SUCCESS);
+        ok_eq_hex(GrantedAccess, FirstAccess);
+    }
+
+    /* Every desired access keeps its own result */
+    for (i = 0; i < RTL_NUMBER_OF(DesiredMasks) * 2; i++)
+    {
+        Status = OpenEvent(&Name, DesiredMasks[i % RTL_NUMBER_OF(DesiredMasks)], &GrantedAccess);
+        ok_eq_hex(Status, STATUS_SUCCESS);
+        if (DesiredMasks[i % RTL_NUMBER_OF(DesiredMasks)] == MAXIMUM_ALLOWED)
+            ok_eq_hex(GrantedAccess, FirstAccess);
+        else
+            ok_eq_hex(GrantedAccess, DesiredMasks[i % RTL_NUMBER_OF(DesiredMasks)]);
+    }
+
+    trace("%lu ACEs, uncached: %I64u ns per open\n", (ULONG)FOREIGN_ACE_COUNT + 1, TimeOpens(&Name, TRUE));
+    trace("%lu ACEs, cached:   %I64u ns per open\n", (ULONG)FOREIGN_ACE_COUNT + 1, TimeOpens(&Name, FALSE));
+
+    Status = ZwClose(EventHandle);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+}
@@ -6600,6 +6600,81 @@ static void test_GdipFillRectanglesOnBitmapTextureBrush(void)
     GdipFree(src_img_data);
 }
 
+static void test_fill_antialias(void)
+{
+    GpStatus status;
+    GpGraphics *graphics;
+    GpBitmap *bitmap;
+    GpSolidFill *brush;
+    ARGB color;
+    BYTE alpha;
+
+    status = GdipCreateBitmapFromScan0(8, 8, 0, PixelFormat32bppARGB, NULL, &bitmap);
+    expect(Ok, status);
+    status = GdipGetImageGraphicsContext((GpImage *)bitmap, &graphics);
+    expect(Ok, status);
+    status = GdipCreateSolidFill(BLUE_COLOR, &brush);
+    expect(Ok, status);
+
+    status = GdipSetSmoothingMode(graphics, SmoothingModeAntiAlias);
+    expect(Ok, status);
+    status = GdipSetPixelOffsetMode(graphics, PixelOffsetModeHalf);
+    expect(Ok, status);
+
+    /* left and right edges cover half a pixel */
+    status = GdipFillRectangle(graphics, (GpBrush *)brush, 1.5, 1.0, 3.0, 2.0);
+    expect(Ok, status);
+
+    status = GdipBitmapGetPixel(bitmap, 1, 1, &color);
+    expect(Ok, status);
+    alpha = color >> 24;
+    ok(alpha >= 0x60 && alpha <= 0xa0, "got %08x\n", color);
+    ok((color & 0xffffff) == 0xff, "got %08x\n", color);
+    status = GdipBitmapGetPixel(bitmap, 2, 1, &color);
+    expect(Ok, status);
+    expect(BLUE_COLOR, color);
+    status = GdipBitmapGetPixel(bitmap, 3, 2, &color);
+    expect(Ok, status);
+    expect(BLUE_COLOR, color);
+    status = GdipBitmapGetPixel(bitmap, 4, 1, &color);
+    expect(Ok, status);
+    alpha = color >> 24;
+    ok(alpha >= 0x60 && alpha <= 0xa0, "got %08x\n", color);
+    status = GdipBitmapGetPixel(bitmap, 5, 1, &color);
+    expect(Ok, status);
+    expect(0, color);
+    status = GdipBitmapGetPixel(bitmap, 2, 3, &color);
+    expect(Ok, status);
+    expect(0, color);
+
+    /* without the half pixel offset, pixel centers are on integer coordinates */
+    status = GdipGraphicsClear(graphics, 0);
+    expect(Ok, status);
+    status = GdipSetPixelOffsetMode(graphics, PixelOffsetModeDefault);
+    expect(Ok, status);
+    status = GdipFillRectangle(graphics, (GpBrush *)brush, 2.0, 2.0, 3.0, 3.0);
+    expect(Ok, status);
+
+    status = GdipBitmapGetPixel(bitmap, 2, 3, &color);
+    expect(Ok, status);
+    alpha = color >> 24;
+    ok(alpha >= 0x60 && alpha <= 0xa0, "got %08x\n", color);
+    status = GdipBitmapGetPixel(bitmap, 3, 3, &color);
+    expect(Ok, status);
+    expect(BLUE_COLOR, color);
+    status = GdipBitmapGetPixel(bitmap, 5, 3, &color);
+    expect(Ok, status);
+    alpha = color >> 24;
+    ok(alpha >= 0x60 && alpha <= 0xa0, "got %08x\n", color);
+    status = GdipBitmapGetPixel(bitmap, 6, 3, &color);
+    expect(Ok, status);
+    expect(0, color);
+
+    GdipDeleteBrush((GpBrush *)brush);
+    GdipDeleteGraphics(graphics);
+    GdipDisposeImage((GpImage *)bitmap);
+}
+
 static void test_GdipDrawImagePointsRectOnMemoryDC(void)
 {
     ARGB color[6] = {0,0,0,0,0,0};
@@ -6880,6 +6955,7 @@ START_TEST(graphics)
     test_GdipFillRectanglesOnMemoryDCSolidBrush();
     test_GdipFillRectanglesOnMemoryDCTextureBrush();
     test_GdipFillRectanglesOnBitmapTextureBrush();
+    test_fill_antialias();
     test_GdipDrawImagePointsRectOnMemoryDC();
     test_container_rects();
     test_GdipGraphicsSetAbort();
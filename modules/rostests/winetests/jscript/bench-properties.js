@@ -0,0 +1,94 @@
+/*
+ * Property access workload for the benchmark runs
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * The kind of code automation scripts are made of: objects built by
+ * constructors, methods from prototypes, global counters and a few sites
+ * that see objects of more than one layout.
+ */
+
+var total = 0, calls = 0;
+
+function Point(x, y) {
+    this.x = x;
+    this.y = y;
+}
+
+Point.prototype.add = function(p) {
+    calls++;
+    return new Point(this.x + p.x, this.y + p.y);
+};
+
+Point.prototype.length2 = function() {
+    calls++;
+    return this.x * this.x + this.y * this.y;
+};
+
+function Point3(x, y, z) {
+    this.x = x;
+    this.y = y;
+    this.z = z;
+}
+
+Point3.prototype.length2 = function() {
+    calls++;
+    return this.x * this.x + this.y * this.y + this.z * this.z;
+};
+
+function sumPoints(n) {
+    var p = new Point(0, 0), step = new Point(1, 2), i;
+
+    for(i = 0; i < n; i++)
+        p = p.add(step);
+    return p.length2();
+}
+
+/* One call site, two shapes */
+function sumMixed(n) {
+    var list = [], sum = 0, i;
+
+    for(i = 0; i < 16; i++)
+        list[i] = (i & 1) ? new Point3(i, i, i) : new Point(i, i);
+    for(i = 0; i < n; i++)
+        sum += list[i & 15].length2();
+    return sum;
+}
+
+/* Globals and a record written field by field */
+function updateRecords(n) {
+    var rec = {name: "item", count: 0, size: 0, flags: 0}, i;
+
+    for(i = 0; i < n; i++) {
+        rec.count++;
+        rec.size += i & 7;
+        rec.flags = rec.flags ^ i;
+        total += rec.size;
+    }
+    return rec.count + rec.size + rec.flags;
+}
+
+function checkResult(name, got, expected) {
+    if(got !== expected)
+        throw name + " returned " + got + ", expected " + expected;
+}
+
+checkResult("sumPoints", sumPoints(20000), 5 * 20000 * 20000);
+checkResult("sumMixed", sumMixed(32000), 6320000);
+checkResult("updateRecords", updateRecords(40000), 180000);
+checkResult("total", total, 2799860000);
+checkResult("calls", calls, 20000 + 1 + 32000);
@@ -1502,6 +1502,37 @@ tmp.testWith = true;
 with(tmp)
     ok(testWith === true, "testWith !== true");
 
+/* The same member expression on objects of different layouts */
+function getCachedVal(o) {
+    return o.val;
+}
+
+(function() {
+    var objs = [{val: 0}, {a: 1, val: 1}, {b: 1, val: 2}, {a: 1, b: 1, val: 3},
+                {b: 1, a: 1, val: 4}, {c: 1, val: 5}, {val: 6, c: 1}], i, j;
+
+    for(j = 0; j < 3; j++) {
+        for(i = 0; i < objs.length; i++)
+            ok(getCachedVal(objs[i]) === i, "getCachedVal(objs[" + i + "]) = " + getCachedVal(objs[i]));
+    }
+
+    function CachedProto() {}
+    CachedProto.prototype.val = "proto";
+    tmp = new CachedProto();
+    ok(getCachedVal(tmp) === "proto", "getCachedVal(tmp) = " + getCachedVal(tmp));
+    tmp.val = "own";
+    ok(getCachedVal(tmp) === "own", "getCachedVal(tmp) = " + getCachedVal(tmp));
+    delete tmp.val;
+    ok(getCachedVal(tmp) === "proto", "getCachedVal(tmp) after delete = " + getCachedVal(tmp));
+    tmp.val = 1;
+    ok(getCachedVal(tmp) === 1, "getCachedVal(tmp) after re-adding = " + getCachedVal(tmp));
+
+    for(i = 0; i < objs.length; i++)
+        objs[i].val = i * 2;
+    for(i = 0; i < objs.length; i++)
+        ok(getCachedVal(objs[i]) === i * 2, "getCachedVal(objs[" + i + "]) = " + getCachedVal(objs[i]));
+})();
+
 if(false) {
     var varTest1 = true;
 }
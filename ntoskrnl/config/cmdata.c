@@ -320,6 +320,13 @@ INIT_SECTION CM_SYSTEM_CONTROL_VECTOR CmControlVector[] =
         NULL,
         NULL
     },
+    {
+        L"Session Manager\\Memory Management",
+        L"ZeroedPageLowWaterMark",
+        &MmZeroedPageLowWaterMark,
+        NULL,
+        NULL
+    },
     {
         L"Session Manager\\Memory Management",
         L"SystemPages",
@@ -436,6 +436,9 @@ CmpCleanUpKcbValueCache(IN PCM_KEY_CONTROL_BLOCK Kcb)
     /* Make sure we have the exclusive lock */
     CMP_ASSERT_KCB_LOCK(Kcb);
 
+    /* The value name index is stale now */
+    CmpFreeValueNameIndex(Kcb);
+
     /* Check if the value list is cached */
     if (CMP_IS_CELL_CACHED(Kcb->ValueCache.ValueList))
     {
@@ -724,6 +727,7 @@ CmpCreateKeyControlBlock(IN PHHIVE Hive,
     Kcb->ConvKey = ConvKey;
     Kcb->DelayedCloseIndex = CmpDelayedCloseSize;
     Kcb->InDelayClose = 0;
+    Kcb->ValueNameIndex = NULL;
     ASSERT_KCB_VALID(Kcb);
 
     /* Check if we have two hash entires */
@@ -37,8 +37,136 @@ CmpSetValueCached(IN PHCELL_INDEX CellIndex)
 #define ASSERT_VALUE_CACHE() \
     ASSERTMSG("Cached Values Not Yet Supported!\n", FALSE);
 
+#define CM_VALUE_INDEX_END  MAXULONG
+
+/* GLOBALS *******************************************************************/
+
+CM_VALUE_INDEX_STATISTICS CmpValueIndexStatistics;
+
 /* FUNCTIONS *****************************************************************/
 
+static
+ULONG
+CmpHashValueName(IN PVOID Name,
+                 IN ULONG NameLength,
+                 IN BOOLEAN Compressed)
+{
+    ULONG Hash = 0, i;
+
+    /* Use the same case-insensitive hash as the KCB and NCB tables */
+    if (Compressed)
+    {
+        for (i = 0; i < NameLength; i++)
+        {
+            Hash = 37 * Hash + RtlUpcaseUnicodeChar((WCHAR)((PUCHAR)Name)[i]);
+        }
+    }
+    else
+    {
+        for (i = 0; i < NameLength / sizeof(WCHAR); i++)
+        {
+            Hash = 37 * Hash + RtlUpcaseUnicodeChar(((PWCHAR)Name)[i]);
+        }
+    }
+
+    return Hash;
+}
+
+static
+LONG
+CmpCompareValueName(IN PCUNICODE_STRING Name,
+                    IN PCM_KEY_VALUE KeyValue)
+{
+    UNICODE_STRING SearchName;
+
+    /* Is the name compressed? */
+    if (KeyValue->Flags & VALUE_COMP_NAME)
+    {
+        /* It is, do a compressed name comparison */
+        return CmpCompareCompressedName(Name,
+                                        KeyValue->Name,
+                                        KeyValue->NameLength);
+    }
+
+    /* It's not compressed, so do a standard comparison */
+    SearchName.Length = KeyValue->NameLength;
+    SearchName.MaximumLength = SearchName.Length;
+    SearchName.Buffer = KeyValue->Name;
+    return RtlCompareUnicodeString(Name, &SearchName, TRUE);
+}
+
+static
+PCM_VALUE_NAME_INDEX
+CmpBuildValueNameIndex(IN PCM_KEY_CONTROL_BLOCK Kcb,
+                       IN PCELL_DATA CellData)
+{
+    PHHIVE Hive = Kcb->KeyHive;
+    PCM_VALUE_NAME_INDEX NameIndex;
+    PCM_KEY_VALUE KeyValue;
+    ULONG Count, Buckets, Hash, Bucket, i;
+
+    /* Use at least one bucket per value, rounded up to a power of two */
+    Count = Kcb->ValueCache.Count;
+    Buckets = CM_VALUE_INDEX_THRESHOLD;
+    while (Buckets < Count) Buckets <<= 1;
+
+    /* Allocate the bucket heads followed by the chain and hash arrays */
+    NameIndex = CmpAllocate(FIELD_OFFSET(CM_VALUE_NAME_INDEX, Head) +
+                            (Buckets + 2 * Count) * sizeof(ULONG),
+                            TRUE,
+                            TAG_CM);
+    if (!NameIndex) return NULL;
+
+    /* Remember which value list this index describes */
+    NameIndex->ValueList = Kcb->ValueCache.ValueList;
+    NameIndex->Count = Count;
+    NameIndex->BucketMask = Buckets - 1;
+    NameIndex->Next = &NameIndex->Head[Buckets];
+    NameIndex->Hash = &NameIndex->Next[Count];
+    RtlFillMemoryUlong(NameIndex->Head, Buckets * sizeof(ULONG), CM_VALUE_INDEX_END);
+
+    /* Insert the values backwards so each chain is in value list order */
+    for (i = Count; i-- > 0;)
+    {
+        KeyValue = (PCM_KEY_VALUE)HvGetCell(Hive, CellData->u.KeyList[i]);
+        if (!KeyValue)
+        {
+            /* Give up, the caller will do a linear search */
+            CmpFree(NameIndex, 0);
+            return NULL;
+        }
+
+        Hash = CmpHashValueName(KeyValue->Name,
+                                KeyValue->NameLength,
+                                (KeyValue->Flags & VALUE_COMP_NAME) != 0);
+        HvReleaseCell(Hive, CellData->u.KeyList[i]);
+
+        Bucket = Hash & NameIndex->BucketMask;
+        NameIndex->Hash[i] = Hash;
+        NameIndex->Next[i] = NameIndex->Head[Bucket];
+        NameIndex->Head[Bucket] = i;
+    }
+
+    CmpValueIndexStatistics.Builds++;
+    return NameIndex;
+}
+
+VOID
+NTAPI
+CmpFreeValueNameIndex(IN PCM_KEY_CONTROL_BLOCK Kcb)
+{
+    /* Make sure we have the exclusive lock */
+    CMP_ASSERT_KCB_LOCK(Kcb);
+
+    /* Free the index, it gets rebuilt on the next lookup */
+    if (Kcb->ValueNameIndex)
+    {
+        CmpFree(Kcb->ValueNameIndex, 0);
+        Kcb->ValueNameIndex = NULL;
+        CmpValueIndexStatistics.Invalidations++;
+    }
+}
+
 VALUE_SEARCH_RETURN_TYPE
 NTAPI
 CmpGetValueListFromCache(IN PCM_KEY_CONTROL_BLOCK Kcb,
@@ -202,12 +330,11 @@ CmpFindValueByNameFromCache(IN PCM_KEY_CONTROL_BLOCK Kcb,
     PHHIVE Hive;
     VALUE_SEARCH_RETURN_TYPE SearchResult = SearchFail;
     LONG Result;
-    UNICODE_STRING SearchName;
     PCELL_DATA CellData;
     PCACHED_CHILD_LIST ChildList;
-    PCM_KEY_VALUE KeyValue;
+    PCM_VALUE_NAME_INDEX NameIndex = NULL;
     BOOLEAN IndexIsCached;
-    ULONG i = 0;
+    ULONG Hash, i = 0;
     HCELL_INDEX Cell = HCELL_NIL;
 
     /* Set defaults */
@@ -237,6 +364,84 @@ CmpFindValueByNameFromCache(IN PCM_KEY_CONTROL_BLOCK Kcb,
         /* The index shouldn't be cached right now */
         if (IndexIsCached) ASSERT_VALUE_CACHE();
 
+        /* Large value lists are searched through the value name index */
+        if (!(IndexIsCached) && (ChildList->Count >= CM_VALUE_INDEX_THRESHOLD))
+        {
+            /* Drop the index if the value list changed behind our back */
+            NameIndex = Kcb->ValueNameIndex;
+            if ((NameIndex) &&
+                ((NameIndex->ValueList != ChildList->ValueList) ||
+                 (NameIndex->Count != ChildList->Count)))
+            {
+                CmpFreeValueNameIndex(Kcb);
+                NameIndex = NULL;
+            }
+
+            /* Build it if we don't have one yet */
+            if (!NameIndex)
+            {
+                NameIndex = CmpBuildValueNameIndex(Kcb, CellData);
+                Kcb->ValueNameIndex = NameIndex;
+            }
+        }
+
+        /* Check if we can use the index */
+        if (NameIndex)
+        {
+            /* Hash the name and walk its bucket */
+            CmpValueIndexStatistics.Lookups++;
+            Hash = CmpHashValueName(Name->Buffer, Name->Length, FALSE);
+            for (i = NameIndex->Head[Hash & NameIndex->BucketMask];
+                 i != CM_VALUE_INDEX_END;
+                 i = NameIndex->Next[i])
+            {
+                /* Skip values whose full hash doesn't match */
+                if (NameIndex->Hash[i] != Hash) continue;
+                CmpValueIndexStatistics.Probes++;
+
+                /* Check if there's any cell to release */
+                if (*CellToRelease != HCELL_NIL)
+                {
+                    /* Release it now */
+                    HvReleaseCell(Hive, *CellToRelease);
+                    *CellToRelease = HCELL_NIL;
+                }
+
+                /* Get the key value for this index */
+                SearchResult = CmpGetValueKeyFromCache(Kcb,
+                                                       CellData,
+                                                       i,
+                                                       CachedValue,
+                                                       Value,
+                                                       IndexIsCached,
+                                                       ValueIsCached,
+                                                       CellToRelease);
+                if (SearchResult != SearchSuccess)
+                {
+                    /* We either failed or need the exclusive lock */
+                    ASSERT((SearchResult == SearchFail) || !(CmpIsKcbLockedExclusive(Kcb)));
+                    ASSERT(Cell == HCELL_NIL);
+                    return SearchResult;
+                }
+
+                /* Confirm the candidate by comparing the name */
+                if (!CmpCompareValueName(Name, *Value))
+                {
+                    /* We have, return the index of the value and success */
+                    CmpValueIndexStatistics.Hits++;
+                    *Index = i;
+                    SearchResult = SearchSuccess;
+                    goto Quickie;
+                }
+            }
+
+            /* No value has this name */
+            CmpValueIndexStatistics.Misses++;
+            *Value = NULL;
+            SearchResult = SearchFail;
+            goto Quickie;
+        }
+
         /* Loop every value */
         while (TRUE)
         {
@@ -274,23 +479,8 @@ CmpFindValueByNameFromCache(IN PCM_KEY_CONTROL_BLOCK Kcb,
             }
             else
             {
-                /* No cache, so try to compare the name. Is it compressed? */
-                KeyValue = *Value;
-                if (KeyValue->Flags & VALUE_COMP_NAME)
-                {
-                    /* It is, do a compressed name comparison */
-                    Result = CmpCompareCompressedName(Name,
-                                                      KeyValue->Name,
-                                                      KeyValue->NameLength);
-                }
-                else
-                {
-                    /* It's not compressed, so do a standard comparison */
-                    SearchName.Length = KeyValue->NameLength;
-                    SearchName.MaximumLength = SearchName.Length;
-                    SearchName.Buffer = KeyValue->Name;
-                    Result = RtlCompareUnicodeString(Name, &SearchName, TRUE);
-                }
+                /* No cache, so try to compare the name */
+                Result = CmpCompareValueName(Name, *Value);
             }
 
             /* Check if we found the value data */
@@ -114,6 +114,11 @@
 //
 #define MAXIMUM_CACHED_DATA                             2 * PAGE_SIZE
 
+//
+// Value count at which a KCB gets a value name hash index
+//
+#define CM_VALUE_INDEX_THRESHOLD                        32
+
 //
 // Hives to load on startup
 //
@@ -253,6 +258,32 @@ typedef struct _CM_NAME_CONTROL_BLOCK
     };
 } CM_NAME_CONTROL_BLOCK, *PCM_NAME_CONTROL_BLOCK;
 
+//
+// Value Name Hash Index
+//
+typedef struct _CM_VALUE_NAME_INDEX
+{
+    HCELL_INDEX ValueList;
+    ULONG Count;
+    ULONG BucketMask;
+    PULONG Next;
+    PULONG Hash;
+    ULONG Head[ANYSIZE_ARRAY];
+} CM_VALUE_NAME_INDEX, *PCM_VALUE_NAME_INDEX;
+
+//
+// Value Name Hash Index Statistics
+//
+typedef struct _CM_VALUE_INDEX_STATISTICS
+{
+    ULONG Lookups;
+    ULONG Hits;
+    ULONG Misses;
+    ULONG Probes;
+    ULONG Builds;
+    ULONG Invalidations;
+} CM_VALUE_INDEX_STATISTICS, *PCM_VALUE_INDEX_STATISTICS;
+
 //
 // Key Control Block (KCB)
 //
@@ -308,6 +339,7 @@ typedef struct _CM_KEY_CONTROL_BLOCK
          ULONG Flags : 16;
     };
     ULONG InDelayClose;
+    PCM_VALUE_NAME_INDEX ValueNameIndex;
 } CM_KEY_CONTROL_BLOCK, *PCM_KEY_CONTROL_BLOCK;
 
 //
@@ -1014,6 +1046,12 @@ CmpCleanUpKcbValueCache(
     IN PCM_KEY_CONTROL_BLOCK Kcb
 );
 
+VOID
+NTAPI
+CmpFreeValueNameIndex(
+    IN PCM_KEY_CONTROL_BLOCK Kcb
+);
+
 VOID
 NTAPI
 CmpCleanUpKcbCacheWithLock(
@@ -1534,6 +1572,7 @@ extern BOOLEAN ExpInTextModeSetup;
 extern BOOLEAN InitIsWinPEMode;
 extern ULONG CmpHashTableSize;
 extern ULONG CmpDelayedCloseSize, CmpDelayedCloseIndex;
+extern CM_VALUE_INDEX_STATISTICS CmpValueIndexStatistics;
 extern BOOLEAN CmpNoWrite;
 extern BOOLEAN CmpForceForceFlush;
 extern BOOLEAN CmpWasSetupBoot;
@@ -78,6 +78,33 @@ typedef struct _KNMI_HANDLER_CALLBACK
     PVOID Handle;
 } KNMI_HANDLER_CALLBACK, *PKNMI_HANDLER_CALLBACK;
 
+//
+// Per-processor dispatcher counters, only updated with the PRCB lock of
+// the processor they belong to held
+//
+typedef struct _KI_SCHEDULER_STATISTICS
+{
+    ULONG IdleDispatches;
+    ULONG ReadyQueued;
+    ULONG Preemptions;
+    ULONG RemotePreemptions;
+    ULONG Steals;
+    ULONG IdleTransitions;
+} KI_SCHEDULER_STATISTICS, *PKI_SCHEDULER_STATISTICS;
+
+//
+// Timer expiration and clock counters
+//
+typedef struct _KI_TIMER_STATISTICS
+{
+    ULONG ClockInterrupts;
+    ULONG ExpirationPasses;
+    ULONG TimersExpired;
+    ULONG MaximumExpiredPerPass;
+    ULONG CoalescedTimers;
+    ULONG ClockStretches;
+} KI_TIMER_STATISTICS, *PKI_TIMER_STATISTICS;
+
 typedef PCHAR
 (NTAPI *PKE_BUGCHECK_UNICODE_TO_ANSI)(
     IN PUNICODE_STRING Unicode,
@@ -124,6 +151,7 @@ extern LIST_ENTRY KeBugcheckCallbackListHead, KeBugcheckReasonCallbackListHead;
 extern KSPIN_LOCK BugCheckCallbackLock;
 extern KDPC KiTimerExpireDpc;
 extern KTIMER_TABLE_ENTRY KiTimerTableListHead[TIMER_TABLE_SIZE];
+extern KI_TIMER_STATISTICS KiTimerStatistics;
 extern FAST_MUTEX KiGenericCallDpcMutex;
 extern LIST_ENTRY KiProfileListHead, KiProfileSourceListHead;
 extern KSPIN_LOCK KiProfileLock;
@@ -134,6 +162,8 @@ extern KEVENT KiSwapEvent;
 extern PKPRCB KiProcessorBlock[];
 extern ULONG KiMask32Array[MAXIMUM_PRIORITY];
 extern ULONG_PTR KiIdleSummary;
+extern ULONG_PTR KiIdleSMTSummary;
+extern KI_SCHEDULER_STATISTICS KiSchedulerStatistics[MAXIMUM_PROCESSORS];
 extern PVOID KeUserApcDispatcher;
 extern PVOID KeUserCallbackDispatcher;
 extern PVOID KeUserExceptionDispatcher;
@@ -142,6 +172,8 @@ extern ULONG KeTimeIncrement;
 extern ULONG KeTimeAdjustment;
 extern BOOLEAN KiTimeAdjustmentEnabled;
 extern LONG KiTickOffset;
+extern BOOLEAN KiDynamicTickEnabled;
+extern volatile BOOLEAN KiClockStretched;
 extern ULONG_PTR KiBugCheckData[5];
 extern ULONG KiFreezeFlag;
 extern ULONG KiDPCTimeout;
@@ -279,6 +311,24 @@ KiInsertTimerTable(
     IN ULONG Hand
 );
 
+ULONGLONG
+FASTCALL
+KiQueryNextTimerDueTime(
+    VOID
+);
+
+VOID
+FASTCALL
+KiStretchClockForIdle(
+    IN PKPRCB Prcb
+);
+
+VOID
+FASTCALL
+KiRestoreClockRate(
+    VOID
+);
+
 VOID
 FASTCALL
 KiTimerListExpire(
@@ -815,6 +865,11 @@ FASTCALL
 KeZeroPages(IN PVOID Address,
             IN ULONG Size);
 
+VOID
+FASTCALL
+KeZeroPagesNonTemporal(IN PVOID Address,
+                       IN ULONG Size);
+
 BOOLEAN
 FASTCALL
 KeInvalidAccessAllowed(IN PVOID TrapInformation OPTIONAL);
@@ -949,6 +949,7 @@ KiComputeDueTime(IN PKTIMER Timer,
                  OUT PULONG Hand)
 {
     LARGE_INTEGER InterruptTime, SystemTime, DifferenceTime;
+    ULONGLONG Window;
 
     /* Convert to relative time if needed */
     Timer->Header.Absolute = FALSE;
@@ -982,6 +983,17 @@ KiComputeDueTime(IN PKTIMER Timer,
     /* Recalculate due time */
     Timer->DueTime.QuadPart = InterruptTime.QuadPart - DueTime.QuadPart;
 
+    /*
+     * Coalescable timers are delayed to the next window boundary. The window
+     * is a power of two number of clock ticks no larger than the tolerable
+     * delay, so timers of similar due times share a hand and a tick.
+     */
+    if (Timer->Header.Coalescable)
+    {
+        Window = (ULONGLONG)KeMaximumIncrement << Timer->Header.EncodedTolerableDelay;
+        Timer->DueTime.QuadPart = ((Timer->DueTime.QuadPart + Window - 1) / Window) * Window;
+    }
+
     /* Get the handle */
     *Hand = KiComputeTimerTableIndex(Timer->DueTime.QuadPart);
     Timer->Header.Hand = (UCHAR)*Hand;
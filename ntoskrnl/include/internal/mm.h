@@ -434,6 +434,7 @@ typedef struct _MMPAGING_FILE
     PFILE_OBJECT FileObject;
     UNICODE_STRING PageFileName;
     PRTL_BITMAP Bitmap;
+    ULONG AllocationHint;
     HANDLE FileHandle;
 }
 MMPAGING_FILE, *PMMPAGING_FILE;
@@ -650,6 +651,17 @@ MmWriteToSwapPage(
     PFN_NUMBER Page
 );
 
+NTSTATUS
+NTAPI
+MmQueueSwapPage(
+    SWAPENTRY SwapEntry,
+    PFN_NUMBER Page
+);
+
+NTSTATUS
+NTAPI
+MmFlushSwapPages(VOID);
+
 VOID
 NTAPI
 MmShowOutOfSpaceMessagePagingFile(VOID);
@@ -993,6 +1005,10 @@ MmZeroPageThread(
     VOID
 );
 
+extern ULONG MmZeroedPageLowWaterMark;
+extern ULONG MmZeroPageThreads;
+extern volatile ULONG MmZeroedPageCount;
+
 /* hypermap.c *****************************************************************/
 
 extern PEPROCESS HyperProcess;
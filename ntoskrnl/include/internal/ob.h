@@ -115,6 +115,28 @@ typedef struct _OBP_FIND_HANDLE_DATA
     POBJECT_HANDLE_INFORMATION HandleInformation;
 } OBP_FIND_HANDLE_DATA, *POBP_FIND_HANDLE_DATA;
 
+//
+// Access Check Result for a Cached Security Descriptor
+//
+#define OB_SD_ACCESS_CACHE_ENTRIES 4
+
+typedef struct _OB_SD_ACCESS_CACHE_ENTRY
+{
+    LUID TokenId;
+    LUID ModifiedId;
+    POBJECT_TYPE ObjectType;
+    ACCESS_MASK DesiredAccess;
+    ACCESS_MASK PreviouslyGrantedAccess;
+    ACCESS_MASK GrantedAccess;
+    NTSTATUS AccessStatus;
+} OB_SD_ACCESS_CACHE_ENTRY, *POB_SD_ACCESS_CACHE_ENTRY;
+
+typedef struct _OB_SD_ACCESS_CACHE
+{
+    ULONG NextEntry;
+    OB_SD_ACCESS_CACHE_ENTRY Entries[OB_SD_ACCESS_CACHE_ENTRIES];
+} OB_SD_ACCESS_CACHE, *POB_SD_ACCESS_CACHE;
+
 //
 // Cached Security Descriptor Header
 //
@@ -123,6 +145,7 @@ typedef struct _SECURITY_DESCRIPTOR_HEADER
     LIST_ENTRY Link;
     ULONG RefCount;
     ULONG FullHash;
+    POB_SD_ACCESS_CACHE AccessCache;
     QUAD SecurityDescriptor;
 } SECURITY_DESCRIPTOR_HEADER, *PSECURITY_DESCRIPTOR_HEADER;
 
@@ -465,6 +488,30 @@ ObpReferenceSecurityDescriptor(
     IN POBJECT_HEADER ObjectHeader
 );
 
+BOOLEAN
+NTAPI
+ObpLookupCachedAccess(
+    IN PSECURITY_DESCRIPTOR SecurityDescriptor,
+    IN PACCESS_TOKEN Token,
+    IN POBJECT_TYPE ObjectType,
+    IN ACCESS_MASK DesiredAccess,
+    IN ACCESS_MASK PreviouslyGrantedAccess,
+    OUT PACCESS_MASK GrantedAccess,
+    OUT PNTSTATUS AccessStatus
+);
+
+VOID
+NTAPI
+ObpCacheAccess(
+    IN PSECURITY_DESCRIPTOR SecurityDescriptor,
+    IN PACCESS_TOKEN Token,
+    IN POBJECT_TYPE ObjectType,
+    IN ACCESS_MASK DesiredAccess,
+    IN ACCESS_MASK PreviouslyGrantedAccess,
+    IN ACCESS_MASK GrantedAccess,
+    IN NTSTATUS AccessStatus
+);
+
 //
 // Object Security Routines
 //
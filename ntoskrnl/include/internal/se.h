@@ -24,6 +24,17 @@ typedef struct _KNOWN_COMPOUND_ACE
     ULONG SidStart;
 } KNOWN_COMPOUND_ACE, *PKNOWN_COMPOUND_ACE;
 
+//
+// Token SID hash index
+//
+#define SEP_SID_INDEX_THRESHOLD 8
+
+typedef struct _SEP_SID_INDEX
+{
+    ULONG Mask;
+    ULONG Slot[ANYSIZE_ARRAY];
+} SEP_SID_INDEX, *PSEP_SID_INDEX;
+
 FORCEINLINE
 PSID
 SepGetGroupFromDescriptor(PVOID _Descriptor)
@@ -467,6 +478,12 @@ SepReleaseSid(
     IN BOOLEAN CaptureIfKernel
 );
 
+ULONG
+NTAPI
+SepHashSid(
+    IN PSID Sid
+);
+
 NTSTATUS
 NTAPI
 SeCaptureSidAndAttributesArray(
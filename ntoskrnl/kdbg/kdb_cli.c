@@ -78,11 +78,15 @@ static BOOLEAN KdbpCmdBreakPoint(ULONG Argc, PCHAR Argv[]);
 
 static BOOLEAN KdbpCmdThread(ULONG Argc, PCHAR Argv[]);
 static BOOLEAN KdbpCmdProc(ULONG Argc, PCHAR Argv[]);
+static BOOLEAN KdbpCmdSched(ULONG Argc, PCHAR Argv[]);
+static BOOLEAN KdbpCmdTimer(ULONG Argc, PCHAR Argv[]);
 
 static BOOLEAN KdbpCmdMod(ULONG Argc, PCHAR Argv[]);
 static BOOLEAN KdbpCmdGdtLdtIdt(ULONG Argc, PCHAR Argv[]);
 static BOOLEAN KdbpCmdPcr(ULONG Argc, PCHAR Argv[]);
 static BOOLEAN KdbpCmdTss(ULONG Argc, PCHAR Argv[]);
+static BOOLEAN KdbpCmdZeroPage(ULONG Argc, PCHAR Argv[]);
+static BOOLEAN KdbpCmdRegValueIndex(ULONG Argc, PCHAR Argv[]);
 
 static BOOLEAN KdbpCmdBugCheck(ULONG Argc, PCHAR Argv[]);
 static BOOLEAN KdbpCmdReboot(ULONG Argc, PCHAR Argv[]);
@@ -343,6 +347,8 @@ static const struct
     { NULL, NULL, "Process/Thread", NULL },
     { "thread", "thread [list[ pid]|[attach ]tid]", "List threads in current or specified process, display thread with given id or attach to thread.", KdbpCmdThread },
     { "proc", "proc [list|[attach ]pid]", "List processes, display process with given id or attach to process.", KdbpCmdProc },
+    { "sched", "sched", "Display the dispatcher statistics of each processor.", KdbpCmdSched },
+    { "timer", "timer", "Display timer expiration and clock statistics.", KdbpCmdTimer },
 
     /* System information */
     { NULL, NULL, "System info", NULL },
@@ -352,6 +358,8 @@ static const struct
     { "idt", "idt", "Display the interrupt descriptor table.", KdbpCmdGdtLdtIdt },
     { "pcr", "pcr", "Display the processor control region.", KdbpCmdPcr },
     { "tss", "tss [selector|*descaddr]", "Display the current task state segment, or the one specified by its selector number or descriptor address.", KdbpCmdTss },
+    { "zeropage", "zeropage", "Display zeroed page list and zero page thread statistics.", KdbpCmdZeroPage },
+    { "regvalue", "regvalue", "Display registry value name index statistics.", KdbpCmdRegValueIndex },
 
     /* Others */
     { NULL, NULL, "Others", NULL },
@@ -1927,6 +1935,149 @@ KdbpCmdProc(
     return TRUE;
 }
 
+/*!\brief Displays the dispatcher statistics of each processor.
+ */
+static BOOLEAN
+KdbpCmdSched(
+    ULONG Argc,
+    PCHAR Argv[])
+{
+    PKPRCB Prcb;
+    PKI_SCHEDULER_STATISTICS Statistics;
+    ULONG i;
+
+    KdbpPrint("Idle summary: 0x%p, idle cores: 0x%p\n",
+              (PVOID)KiIdleSummary, (PVOID)KiIdleSMTSummary);
+    KdbpPrint("CPU  Ready      Idle disp.  Queued      Preempt.    (IPI)       Steals      Idle\n");
+
+    for (i = 0; i < (ULONG)KeNumberProcessors; i++)
+    {
+        Prcb = KiProcessorBlock[i];
+        Statistics = &KiSchedulerStatistics[i];
+        KdbpPrint("%-4lu 0x%08lx %-11lu %-11lu %-11lu %-11lu %-11lu %lu\n",
+                  i, Prcb->ReadySummary, Statistics->IdleDispatches,
+                  Statistics->ReadyQueued, Statistics->Preemptions,
+                  Statistics->RemotePreemptions, Statistics->Steals,
+                  Statistics->IdleTransitions);
+    }
+
+    return TRUE;
+}
+
+/*!\brief Displays timer expiration and clock statistics, with the rates since
+ *         the previous invocation.
+ */
+static BOOLEAN
+KdbpCmdTimer(
+    ULONG Argc,
+    PCHAR Argv[])
+{
+    static KI_TIMER_STATISTICS Last;
+    static ULONGLONG LastTime;
+    KI_TIMER_STATISTICS Current = KiTimerStatistics;
+    ULONGLONG Now, Elapsed, NextDue, Ratio;
+
+    Now = KeQueryInterruptTime();
+    Elapsed = (Now - LastTime) / 10000;
+    if (!Elapsed)
+        Elapsed = 1;
+
+    KdbpPrint("Clock increment: %lu (maximum %lu), dynamic tick %s, stretched: %s\n",
+              KeTimeIncrement, KeMaximumIncrement,
+              KiDynamicTickEnabled ? "on" : "off", KiClockStretched ? "yes" : "no");
+
+    NextDue = KiQueryNextTimerDueTime();
+    if ((NextDue >> 32) == 0xFFFFFFFF)
+        KdbpPrint("Next timer:      none\n");
+    else
+        KdbpPrint("Next timer:      in %I64d ms\n", ((LONGLONG)NextDue - (LONGLONG)Now) / 10000);
+
+    KdbpPrint("                 Total       Per second\n");
+    KdbpPrint("Clock ticks:     %-11lu %I64u\n", Current.ClockInterrupts,
+              (ULONGLONG)(Current.ClockInterrupts - Last.ClockInterrupts) * 1000 / Elapsed);
+    KdbpPrint("Timer wakeups:   %-11lu %I64u\n", Current.ExpirationPasses,
+              (ULONGLONG)(Current.ExpirationPasses - Last.ExpirationPasses) * 1000 / Elapsed);
+    KdbpPrint("Timers expired:  %-11lu %I64u\n", Current.TimersExpired,
+              (ULONGLONG)(Current.TimersExpired - Last.TimersExpired) * 1000 / Elapsed);
+    Ratio = Current.ClockInterrupts ? (ULONGLONG)Current.TimersExpired * 100 / Current.ClockInterrupts : 0;
+    KdbpPrint("Per clock tick:  %I64u.%02I64u\n", Ratio / 100, Ratio % 100);
+    KdbpPrint("Per wakeup:      %lu average, %lu maximum\n",
+              Current.ExpirationPasses ? Current.TimersExpired / Current.ExpirationPasses : 0,
+              Current.MaximumExpiredPerPass);
+    KdbpPrint("Coalescable:     %lu\n", Current.CoalescedTimers);
+    KdbpPrint("Clock stretches: %lu\n", Current.ClockStretches);
+
+    Last = Current;
+    LastTime = Now;
+    return TRUE;
+}
+
+/*!\brief Displays the zeroed and free page lists and the zeroing rate since
+ *         the previous invocation.
+ */
+static BOOLEAN
+KdbpCmdZeroPage(
+    ULONG Argc,
+    PCHAR Argv[])
+{
+    static ULONG LastCount;
+    static ULONGLONG LastTime;
+    ULONG Count = MmZeroedPageCount;
+    ULONGLONG Now, Elapsed;
+
+    Now = KeQueryInterruptTime();
+    Elapsed = (Now - LastTime) / 10000;
+    if (!Elapsed)
+        Elapsed = 1;
+
+    KdbpPrint("Zeroed pages:    %lu (low-water mark %lu)\n",
+              (ULONG)MmZeroedPageListHead.Total, MmZeroedPageLowWaterMark);
+    KdbpPrint("Free pages:      %lu\n", (ULONG)MmFreePageListHead.Total);
+    KdbpPrint("Zeroing threads: %lu\n", MmZeroPageThreads);
+    KdbpPrint("                 Total       Per second\n");
+    KdbpPrint("Pages zeroed:    %-11lu %I64u\n", Count,
+              (ULONGLONG)(Count - LastCount) * 1000 / Elapsed);
+
+    LastCount = Count;
+    LastTime = Now;
+    return TRUE;
+}
+
+/*!\brief Displays the registry value name index hit rate, with the lookup
+ *         rate since the previous invocation.
+ */
+static BOOLEAN
+KdbpCmdRegValueIndex(
+    ULONG Argc,
+    PCHAR Argv[])
+{
+    static ULONG LastLookups;
+    static ULONGLONG LastTime;
+    CM_VALUE_INDEX_STATISTICS Current = CmpValueIndexStatistics;
+    ULONGLONG Now, Elapsed, Ratio;
+
+    Now = KeQueryInterruptTime();
+    Elapsed = (Now - LastTime) / 10000;
+    if (!Elapsed)
+        Elapsed = 1;
+
+    KdbpPrint("Index threshold: %lu values\n", CM_VALUE_INDEX_THRESHOLD);
+    KdbpPrint("                 Total       Per second\n");
+    KdbpPrint("Lookups:         %-11lu %I64u\n", Current.Lookups,
+              (ULONGLONG)(Current.Lookups - LastLookups) * 1000 / Elapsed);
+    Ratio = Current.Lookups ? (ULONGLONG)Current.Hits * 10000 / Current.Lookups : 0;
+    KdbpPrint("Hits:            %-11lu %I64u.%02I64u%%\n", Current.Hits, Ratio / 100, Ratio % 100);
+    KdbpPrint("Misses:          %lu\n", Current.Misses);
+    Ratio = Current.Lookups ? (ULONGLONG)Current.Probes * 100 / Current.Lookups : 0;
+    KdbpPrint("Per lookup:      %I64u.%02I64u name compares\n", Ratio / 100, Ratio % 100);
+    KdbpPrint("Indexes built:   %lu\n", Current.Builds);
+    KdbpPrint("Invalidations:   %lu\n", Current.Invalidations);
+
+    LastLookups = Current.Lookups;
+    LastTime = Now;
+    return TRUE;
+}
+
 /*!\brief Lists loaded modules or the one containing the specified address.
  */
 static BOOLEAN
@@ -52,23 +52,36 @@ KiDpcInterruptHandler(VOID)
     }
     else if (Prcb->NextThread)
     {
-        /* Capture current thread data */
-        OldThread = Prcb->CurrentThread;
-        NewThread = Prcb->NextThread;
+        /* Other processors can change the next thread until we lock */
+        KiAcquirePrcbLock(Prcb);
+        if (!Prcb->NextThread)
+        {
+            /* It was taken back, keep running the current thread */
+            KiReleasePrcbLock(Prcb);
+        }
+        else
+        {
+            /* KxQueueReadyThread releases the lock. Capture current thread data */
+            OldThread = Prcb->CurrentThread;
+            NewThread = Prcb->NextThread;
+
+            /* Nobody may run the old thread before its context is saved */
+            KiSetThreadSwapBusy(OldThread);
 
-        /* Set new thread data */
-        Prcb->NextThread = NULL;
-        Prcb->CurrentThread = NewThread;
+            /* Set new thread data */
+            Prcb->NextThread = NULL;
+            Prcb->CurrentThread = NewThread;
 
-        /* The thread is now running */
-        NewThread->State = Running;
-        OldThread->WaitReason = WrDispatchInt;
+            /* The thread is now running */
+            NewThread->State = Running;
+            OldThread->WaitReason = WrDispatchInt;
 
-        /* Make the old thread ready */
-        KxQueueReadyThread(OldThread, Prcb);
+            /* Make the old thread ready */
+            KxQueueReadyThread(OldThread, Prcb);
 
-        /* Swap to the new thread */
-        KiSwapContext(APC_LEVEL, OldThread);
+            /* Swap to the new thread */
+            KiSwapContext(APC_LEVEL, OldThread);
+        }
     }
 
     /* Go back to old irql and disable interrupts */
@@ -136,12 +149,24 @@ KiIdleLoop(VOID)
             KiRetireDpcList(Prcb);
         }
 
+        /* If we just became idle, look for work queued on other processors */
+        if (Prcb->IdleSchedule) KiIdleSchedule(Prcb);
+
         /* Check if a new thread is scheduled for execution */
         if (Prcb->NextThread)
         {
             /* Enable interrupts */
             _enable();
 
+            /* Other processors can change the next thread until we lock */
+            KiAcquirePrcbLock(Prcb);
+            if (!Prcb->NextThread)
+            {
+                /* It was taken back, keep idling */
+                KiReleasePrcbLock(Prcb);
+                continue;
+            }
+
             /* Capture current thread data */
             OldThread = Prcb->CurrentThread;
             NewThread = Prcb->NextThread;
@@ -152,6 +177,10 @@ KiIdleLoop(VOID)
 
             /* The thread is now running */
             NewThread->State = Running;
+            KiReleasePrcbLock(Prcb);
+
+            /* Leave the idle clock rate */
+            KiRestoreClockRate();
 
             /* Do the swap at SYNCH_LEVEL */
             KfRaiseIrql(SYNCH_LEVEL);
@@ -164,6 +193,9 @@ KiIdleLoop(VOID)
         }
         else
         {
+            /* Slow down the clock if no timer is due soon */
+            KiStretchClockForIdle(Prcb);
+
             /* Continue staying idle. Note the HAL returns with interrupts on */
             Prcb->PowerState.IdleFunction(&Prcb->PowerState);
         }
@@ -151,6 +151,12 @@ KiSwapContextResume(
     /* Now we are the new thread. Check if it's in a new process */
     OldProcess = OldThread->ApcState.Process;
     NewProcess = NewThread->ApcState.Process;
+
+#ifdef CONFIG_SMP
+    /* We are off the old thread's stack, other processors may run it now */
+    OldThread->SwapBusy = FALSE;
+#endif
+
     if (OldProcess != NewProcess)
     {
         /* Switch address space and flush TLB */
@@ -176,12 +176,24 @@ KiIdleLoop(VOID)
             KiRetireDpcList(Prcb);
         }
 
+        /* If we just became idle, look for work queued on other processors */
+        if (Prcb->IdleSchedule) KiIdleSchedule(Prcb);
+
         /* Check if a new thread is scheduled for execution */
         if (Prcb->NextThread)
         {
             /* Enable interrupts */
             _enable();
 
+            /* Other processors can change the next thread until we lock */
+            KiAcquirePrcbLock(Prcb);
+            if (!Prcb->NextThread)
+            {
+                /* It was taken back, keep idling */
+                KiReleasePrcbLock(Prcb);
+                continue;
+            }
+
             /* Capture current thread data */
             OldThread = Prcb->CurrentThread;
             NewThread = Prcb->NextThread;
@@ -192,12 +204,19 @@ KiIdleLoop(VOID)
 
             /* The thread is now running */
             NewThread->State = Running;
+            KiReleasePrcbLock(Prcb);
+
+            /* Leave the idle clock rate */
+            KiRestoreClockRate();
 
             /* Switch away from the idle thread */
             KiSwapContext(APC_LEVEL, OldThread);
         }
         else
         {
+            /* Slow down the clock if no timer is due soon */
+            KiStretchClockForIdle(Prcb);
+
             /* Continue staying idle. Note the HAL returns with interrupts on */
             Prcb->PowerState.IdleFunction(&Prcb->PowerState);
         }
@@ -324,10 +343,22 @@ KiDispatchInterrupt(VOID)
     }
     else if (Prcb->NextThread)
     {
-        /* Capture current thread data */
+        /* Other processors can change the next thread until we lock */
+        KiAcquirePrcbLock(Prcb);
+        if (!Prcb->NextThread)
+        {
+            /* It was taken back, keep running the current thread */
+            KiReleasePrcbLock(Prcb);
+            return;
+        }
+
+        /* KxQueueReadyThread releases the lock. Capture current thread data */
         OldThread = Prcb->CurrentThread;
         NewThread = Prcb->NextThread;
 
+        /* Nobody may run the old thread before its context is saved */
+        KiSetThreadSwapBusy(OldThread);
+
         /* Set new thread data */
         Prcb->NextThread = NULL;
         Prcb->CurrentThread = NewThread;
@@ -84,7 +84,7 @@ KiTimerExpiration(IN PKDPC Dpc,
     ULARGE_INTEGER SystemTime, InterruptTime;
     LARGE_INTEGER Interval;
     LONG Limit, Index, i;
-    ULONG Timers, ActiveTimers, DpcCalls;
+    ULONG Timers, ActiveTimers, DpcCalls, Expired = 0;
     PLIST_ENTRY ListHead, NextEntry;
     KIRQL OldIrql;
     PKTIMER Timer;
@@ -147,6 +147,7 @@ KiTimerExpiration(IN PKDPC Dpc,
             {
                 /* It's expired, remove it */
                 ActiveTimers--;
+                Expired++;
                 KiRemoveEntryTimer(Timer);
 
                 /* Make it non-inserted, unlock it, and signal it */
@@ -299,6 +300,14 @@ KiTimerExpiration(IN PKDPC Dpc,
         }
     } while (Index != Limit);
 
+    /* Update the statistics while we still own the dispatcher lock */
+    KiTimerStatistics.ExpirationPasses++;
+    KiTimerStatistics.TimersExpired += Expired;
+    if (Expired > KiTimerStatistics.MaximumExpiredPerPass)
+    {
+        KiTimerStatistics.MaximumExpiredPerPass = Expired;
+    }
+
     /* Verify the timer table, on debug builds */
     if (KeNumberProcessors == 1) KiCheckTimerTable(InterruptTime);
 
@@ -1138,6 +1138,22 @@ KeZeroPages(IN PVOID Address,
     RtlZeroMemory(Address, Size);
 }
 
+VOID
+FASTCALL
+KeZeroPagesNonTemporal(IN PVOID Address,
+                       IN ULONG Size)
+{
+    /* Go around the caches if the processor supports it */
+    if (KeFeatureBits & KF_XMMI64)
+    {
+        KiZeroPagesNonTemporal(Address, Size);
+    }
+    else
+    {
+        RtlZeroMemory(Address, Size);
+    }
+}
+
 VOID
 NTAPI
 KiSaveProcessorState(IN PKTRAP_FRAME TrapFrame,
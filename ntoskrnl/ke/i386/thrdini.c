@@ -294,12 +294,24 @@ KiIdleLoop(VOID)
             KiRetireDpcList(Prcb);
         }
 
+        /* If we just became idle, look for work queued on other processors */
+        if (Prcb->IdleSchedule) KiIdleSchedule(Prcb);
+
         /* Check if a new thread is scheduled for execution */
         if (Prcb->NextThread)
         {
             /* Enable interrupts */
             _enable();
 
+            /* Other processors can change the next thread until we lock */
+            KiAcquirePrcbLock(Prcb);
+            if (!Prcb->NextThread)
+            {
+                /* It was taken back, keep idling */
+                KiReleasePrcbLock(Prcb);
+                continue;
+            }
+
             /* Capture current thread data */
             OldThread = Prcb->CurrentThread;
             NewThread = Prcb->NextThread;
@@ -310,12 +322,19 @@ KiIdleLoop(VOID)
 
             /* The thread is now running */
             NewThread->State = Running;
+            KiReleasePrcbLock(Prcb);
+
+            /* Leave the idle clock rate */
+            KiRestoreClockRate();
 
             /* Switch away from the idle thread */
             KiSwapContext(APC_LEVEL, OldThread);
         }
         else
         {
+            /* Slow down the clock if no timer is due soon */
+            KiStretchClockForIdle(Prcb);
+
             /* Continue staying idle. Note the HAL returns with interrupts on */
             Prcb->PowerState.IdleFunction(&Prcb->PowerState);
         }
@@ -337,6 +356,12 @@ KiSwapContextExit(IN PKTHREAD OldThread,
     /* Now we are the new thread. Check if it's in a new process */
     OldProcess = OldThread->ApcState.Process;
     NewProcess = NewThread->ApcState.Process;
+
+#ifdef CONFIG_SMP
+    /* We are off the old thread's stack, other processors may run it now */
+    OldThread->SwapBusy = FALSE;
+#endif
+
     if (OldProcess != NewProcess)
     {
         /* Check if there is a different LDT */
@@ -438,6 +463,11 @@ KiSwapContextEntry(IN PKSWITCHFRAME SwitchFrame,
     /* Get the old thread and set its kernel stack */
     OldThread->KernelStack = SwitchFrame;
 
+#ifdef CONFIG_SMP
+    /* Wait until the processor that ran the new thread is off its stack */
+    while (NewThread->SwapBusy) YieldProcessor();
+#endif
+
     /* ISRs can change FPU state, so disable interrupts while checking */
     _disable();
 
@@ -493,10 +523,22 @@ KiDispatchInterrupt(VOID)
     }
     else if (Prcb->NextThread)
     {
-        /* Capture current thread data */
+        /* Other processors can change the next thread until we lock */
+        KiAcquirePrcbLock(Prcb);
+        if (!Prcb->NextThread)
+        {
+            /* It was taken back, keep running the current thread */
+            KiReleasePrcbLock(Prcb);
+            return;
+        }
+
+        /* KxQueueReadyThread releases the lock. Capture current thread data */
         OldThread = Prcb->CurrentThread;
         NewThread = Prcb->NextThread;
 
+        /* Nobody may run the old thread before its context is saved */
+        KiSetThreadSwapBusy(OldThread);
+
         /* Set new thread data */
         Prcb->NextThread = NULL;
         Prcb->CurrentThread = NewThread;
@@ -24,6 +24,141 @@
 
 ULONG_PTR KiIdleSummary;
 ULONG_PTR KiIdleSMTSummary;
+KI_SCHEDULER_STATISTICS KiSchedulerStatistics[MAXIMUM_PROCESSORS];
+
+/* PRIVATE FUNCTIONS *********************************************************/
+
+FORCEINLINE
+VOID
+KiSetIdleSummary(IN PKPRCB Prcb)
+{
+    /* Mark the processor idle and have it look for work on the others */
+    InterlockedOrSetMember(&KiIdleSummary, Prcb->SetMember);
+    Prcb->IdleSchedule = TRUE;
+    KiSchedulerStatistics[Prcb->Number].IdleTransitions++;
+
+    /* Check if all the logical processors of this core are idle now */
+    if ((KiIdleSummary & Prcb->MultiThreadProcessorSet) ==
+        Prcb->MultiThreadProcessorSet)
+    {
+        /* They are, so the whole core is free */
+        InterlockedOrSetMember(&KiIdleSMTSummary, Prcb->MultiThreadProcessorSet);
+    }
+}
+
+FORCEINLINE
+VOID
+KiClearIdleSummary(IN PKPRCB Prcb)
+{
+    /* The processor is getting a thread, so neither it nor its core is idle */
+#ifdef _WIN64
+    InterlockedAnd64((PLONG64)&KiIdleSummary, ~Prcb->SetMember);
+    InterlockedAnd64((PLONG64)&KiIdleSMTSummary, ~Prcb->MultiThreadProcessorSet);
+#else
+    InterlockedAnd((PLONG)&KiIdleSummary, ~Prcb->SetMember);
+    InterlockedAnd((PLONG)&KiIdleSMTSummary, ~Prcb->MultiThreadProcessorSet);
+#endif
+}
+
+FORCEINLINE
+VOID
+KiAcquireTwoPrcbLocks(IN PKPRCB FirstPrcb,
+                      IN PKPRCB SecondPrcb)
+{
+    /* Always take the lower numbered processor first to avoid deadlocks */
+    if (FirstPrcb->Number < SecondPrcb->Number)
+    {
+        KiAcquirePrcbLock(FirstPrcb);
+        KiAcquirePrcbLock(SecondPrcb);
+    }
+    else
+    {
+        KiAcquirePrcbLock(SecondPrcb);
+        KiAcquirePrcbLock(FirstPrcb);
+    }
+}
+
+FORCEINLINE
+VOID
+KiReleaseTwoPrcbLocks(IN PKPRCB FirstPrcb,
+                      IN PKPRCB SecondPrcb)
+{
+    KiReleasePrcbLock(FirstPrcb);
+    KiReleasePrcbLock(SecondPrcb);
+}
+
+static
+ULONG
+KiSelectIdleProcessor(IN PKTHREAD Thread,
+                      IN KAFFINITY IdleSet)
+{
+    KAFFINITY IdleCoreSet;
+    ULONG Processor;
+
+    /* Prefer processors whose core has no other busy logical processor */
+    IdleCoreSet = IdleSet & KiIdleSMTSummary;
+    if (IdleCoreSet) IdleSet = IdleCoreSet;
+
+    /* Use the ideal processor if we can */
+    Processor = Thread->IdealProcessor;
+    if (IdleSet & AFFINITY_MASK(Processor)) return Processor;
+
+    /* Then the one it last ran on, which may still have its data cached */
+    Processor = Thread->NextProcessor;
+    if (IdleSet & AFFINITY_MASK(Processor)) return Processor;
+
+    /* Then the current one, which doesn't need an IPI to pick it up */
+    Processor = KeGetCurrentProcessorNumber();
+    if (IdleSet & AFFINITY_MASK(Processor)) return Processor;
+
+    /* Otherwise, take the next one after the ideal processor */
+    return KeFindNextRightSetAffinity(Thread->IdealProcessor, (ULONG)IdleSet);
+}
+
+static
+PKTHREAD
+KiStealReadyThread(IN PKPRCB SourcePrcb,
+                   IN PKPRCB Prcb)
+{
+    ULONG PrioritySet;
+    LONG Priority;
+    PLIST_ENTRY ListHead, ListEntry;
+    PKTHREAD Thread;
+
+    /* Scan the ready lists of the other processor, highest priority first */
+    PrioritySet = SourcePrcb->ReadySummary;
+    while (PrioritySet)
+    {
+        BitScanReverse((PULONG)&Priority, PrioritySet);
+        PrioritySet ^= PRIORITY_MASK(Priority);
+
+        /* Take the first thread that is allowed to run on our processor */
+        ListHead = &SourcePrcb->DispatcherReadyListHead[Priority];
+        for (ListEntry = ListHead->Flink;
+             ListEntry != ListHead;
+             ListEntry = ListEntry->Flink)
+        {
+            Thread = CONTAINING_RECORD(ListEntry, KTHREAD, WaitListEntry);
+            if (!(Thread->Affinity & Prcb->SetMember)) continue;
+
+            /* Sanity checks */
+            ASSERT(Thread->State == Ready);
+            ASSERT(Thread->NextProcessor == SourcePrcb->Number);
+            ASSERT(Thread->Priority == Priority);
+
+            /* Remove it, and update the summary if the list is empty now */
+            if (RemoveEntryList(&Thread->WaitListEntry))
+            {
+                SourcePrcb->ReadySummary ^= PRIORITY_MASK(Priority);
+            }
+
+            return Thread;
+        }
+    }
+
+    /* Nothing we can run */
+    return NULL;
+}
 
 /* FUNCTIONS *****************************************************************/
 
@@ -31,9 +166,67 @@ PKTHREAD
 FASTCALL
 KiIdleSchedule(IN PKPRCB Prcb)
 {
-    /* FIXME: TODO */
-    ASSERTMSG("SMP: Not yet implemented\n", FALSE);
-    return NULL;
+    PKPRCB SourcePrcb;
+    PKTHREAD Thread = NULL;
+    KAFFINITY Scanned;
+    ULONG Processor, Source, PrioritySet, BestSet;
+
+    /* This processor just went idle, we only check once */
+    Prcb->IdleSchedule = FALSE;
+
+    /* Look at the other processors in the order of their most urgent thread */
+    Scanned = Prcb->SetMember;
+    while (!Thread)
+    {
+        /* Find the one with the highest priority ready thread we didn't try */
+        Source = 0;
+        BestSet = 0;
+        for (Processor = 0; Processor < (ULONG)KeNumberProcessors; Processor++)
+        {
+            if (Scanned & AFFINITY_MASK(Processor)) continue;
+
+            PrioritySet = KiProcessorBlock[Processor]->ReadySummary;
+            if (PrioritySet > BestSet)
+            {
+                BestSet = PrioritySet;
+                Source = Processor;
+            }
+        }
+
+        /* Stop if nobody has anything ready */
+        if (!BestSet) break;
+        Scanned |= AFFINITY_MASK(Source);
+
+        /* Lock both processors */
+        SourcePrcb = KiProcessorBlock[Source];
+        KiAcquireTwoPrcbLocks(Prcb, SourcePrcb);
+
+        /* Check if a thread was given to us in the meantime */
+        if ((Prcb->NextThread) && (Prcb->NextThread != Prcb->IdleThread))
+        {
+            /* It was, we're done */
+            KiReleaseTwoPrcbLocks(Prcb, SourcePrcb);
+            break;
+        }
+
+        /* Try to take one of its ready threads */
+        Thread = KiStealReadyThread(SourcePrcb, Prcb);
+        if (Thread)
+        {
+            /* Got one, it will run here next */
+            KiClearIdleSummary(Prcb);
+            Thread->NextProcessor = Prcb->Number;
+            Thread->State = Standby;
+            Prcb->NextThread = Thread;
+            KiSchedulerStatistics[Prcb->Number].Steals++;
+        }
+
+        /* Release the locks */
+        KiReleaseTwoPrcbLocks(Prcb, SourcePrcb);
+    }
+
+    /* Return the thread we found, if any */
+    return Thread;
 }
 
 VOID
@@ -80,7 +273,8 @@ KiDeferredReadyThread(IN PKTHREAD Thread)
 {
     PKPRCB Prcb;
     BOOLEAN Preempted;
-    ULONG Processor = 0;
+    ULONG Processor, Candidates[2], i;
+    KAFFINITY Affinity, IdleSet, Scanned;
     KPRIORITY OldPriority;
     PKTHREAD NextThread;
 
@@ -228,76 +422,145 @@ KiDeferredReadyThread(IN PKTHREAD Thread)
     OldPriority = Thread->Priority;
     Thread->Preempted = FALSE;
 
-    /* Queue the thread on CPU 0 and get the PRCB and lock it */
-    Thread->NextProcessor = 0;
-    Prcb = KiProcessorBlock[0];
-    KiAcquirePrcbLock(Prcb);
+    /* Get the processors this thread can run on */
+    Affinity = Thread->Affinity & KeActiveProcessors;
+    ASSERT(Affinity != 0);
 
-    /* Check if we have an idle summary */
-    if (KiIdleSummary)
+    /* Check if any of them is idle */
+    Scanned = 0;
+    while ((IdleSet = (KiIdleSummary & Affinity & ~Scanned)))
     {
-        /* Clear it and set this thread as the next one */
-        KiIdleSummary = 0;
-        Thread->State = Standby;
-        Prcb->NextThread = Thread;
-
-        /* Unlock the PRCB and return */
-        KiReleasePrcbLock(Prcb);
-        return;
-    }
-
-    /* Set the CPU number */
-    Thread->NextProcessor = (UCHAR)Processor;
-
-    /* Get the next scheduled thread */
-    NextThread = Prcb->NextThread;
-    if (NextThread)
-    {
-        /* Sanity check */
-        ASSERT(NextThread->State == Standby);
+        /* Pick one and lock its PRCB */
+        Processor = KiSelectIdleProcessor(Thread, IdleSet);
+        Scanned |= AFFINITY_MASK(Processor);
+        Prcb = KiProcessorBlock[Processor];
+        KiAcquirePrcbLock(Prcb);
 
-        /* Check if priority changed */
-        if (OldPriority > NextThread->Priority)
+        /* Make sure it is still idle now that we own the lock */
+        if ((KiIdleSummary & AFFINITY_MASK(Processor)) &&
+            (!(Prcb->NextThread) || (Prcb->NextThread == Prcb->IdleThread)))
         {
-            /* Preempt the thread */
-            NextThread->Preempted = TRUE;
-
-            /* Put this one as the next one */
+            /* It is, clear it from the summary and set this thread as next */
+            KiClearIdleSummary(Prcb);
+            Thread->NextProcessor = (UCHAR)Processor;
             Thread->State = Standby;
             Prcb->NextThread = Thread;
+            KiSchedulerStatistics[Processor].IdleDispatches++;
 
-            /* Set it in deferred ready mode */
-            NextThread->State = DeferredReady;
-            NextThread->DeferredProcessor = Prcb->Number;
+            /* Unlock the PRCB and wake the processor up if it's not us */
             KiReleasePrcbLock(Prcb);
-            KiDeferredReadyThread(NextThread);
+            if (KeGetCurrentProcessorNumber() != Processor)
+            {
+                KiIpiSend(AFFINITY_MASK(Processor), IPI_DPC);
+            }
             return;
         }
+
+        /* Somebody else got there first, try another one */
+        KiReleasePrcbLock(Prcb);
     }
-    else
+
+    /*
+     * No idle processor, so the thread goes to its ideal processor, or the
+     * first one it can run on. Before that, see if it can preempt what runs
+     * on the processor it last ran on, its cache may still be warm there.
+     */
+    Processor = Thread->IdealProcessor;
+    if (!(Affinity & AFFINITY_MASK(Processor)))
+    {
+        Processor = KeFindNextRightSetAffinity(Processor, (ULONG)Affinity);
+    }
+    Candidates[1] = Processor;
+    Candidates[0] = Thread->NextProcessor;
+    i = ((Candidates[0] != Processor) &&
+         (Affinity & AFFINITY_MASK(Candidates[0]))) ? 0 : 1;
+
+    for (; i < RTL_NUMBER_OF(Candidates); i++)
     {
-        /* Set the next thread as the current thread */
-        NextThread = Prcb->CurrentThread;
-        if (OldPriority > NextThread->Priority)
+        /* Lock the PRCB of the candidate processor */
+        Processor = Candidates[i];
+        Prcb = KiProcessorBlock[Processor];
+        KiAcquirePrcbLock(Prcb);
+
+        /* Set the CPU number */
+        Thread->NextProcessor = (UCHAR)Processor;
+
+        /* Get the next scheduled thread */
+        NextThread = Prcb->NextThread;
+        if (NextThread)
         {
-            /* Preempt it if it's already running */
-            if (NextThread->State == Running) NextThread->Preempted = TRUE;
+            /* Sanity check */
+            ASSERT(NextThread->State == Standby);
 
-            /* Set the thread on standby and as the next thread */
-            Thread->State = Standby;
-            Prcb->NextThread = Thread;
+            /* Check if priority changed */
+            if (OldPriority > NextThread->Priority)
+            {
+                /* Put this one as the next one */
+                Thread->State = Standby;
+                Prcb->NextThread = Thread;
+                KiSchedulerStatistics[Processor].Preemptions++;
 
-            /* Release the lock */
-            KiReleasePrcbLock(Prcb);
+                /* The idle thread doesn't go on any list */
+                if (NextThread == Prcb->IdleThread)
+                {
+                    /* The processor is not idle anymore then */
+                    KiClearIdleSummary(Prcb);
+                    KiReleasePrcbLock(Prcb);
 
-            /* Check if we're running on another CPU */
-            if (KeGetCurrentProcessorNumber() != Thread->NextProcessor)
+                    /* It may be halted, wake it up if it's not us */
+                    if (KeGetCurrentProcessorNumber() != Processor)
+                    {
+                        KiIpiSend(AFFINITY_MASK(Processor), IPI_DPC);
+                    }
+                    return;
+                }
+
+                /* Preempt the thread */
+                NextThread->Preempted = TRUE;
+
+                /* Set it in deferred ready mode */
+                NextThread->State = DeferredReady;
+                NextThread->DeferredProcessor = Prcb->Number;
+                KiReleasePrcbLock(Prcb);
+                KiDeferredReadyThread(NextThread);
+                return;
+            }
+        }
+        else
+        {
+            /* Set the next thread as the current thread */
+            NextThread = Prcb->CurrentThread;
+            if (OldPriority > NextThread->Priority)
             {
-                /* We are, send an IPI */
-                KiIpiSend(AFFINITY_MASK(Thread->NextProcessor), IPI_DPC);
+                /* Preempt it if it's already running */
+                if (NextThread->State == Running) NextThread->Preempted = TRUE;
+
+                /* Set the thread on standby and as the next thread */
+                Thread->State = Standby;
+                Prcb->NextThread = Thread;
+                KiSchedulerStatistics[Processor].Preemptions++;
+
+                /* Make sure it doesn't look idle anymore */
+                if (NextThread == Prcb->IdleThread) KiClearIdleSummary(Prcb);
+
+                /* Check if we're running on another CPU */
+                if (KeGetCurrentProcessorNumber() != Processor)
+                {
+                    /* We are, send an IPI after releasing the lock */
+                    KiSchedulerStatistics[Processor].RemotePreemptions++;
+                    KiReleasePrcbLock(Prcb);
+                    KiIpiSend(AFFINITY_MASK(Processor), IPI_DPC);
+                    return;
+                }
+
+                /* Release the lock */
+                KiReleasePrcbLock(Prcb);
+                return;
             }
-            return;
         }
+
+        /* Nothing to preempt here, keep the lock of the last candidate */
+        if (i + 1 < RTL_NUMBER_OF(Candidates)) KiReleasePrcbLock(Prcb);
     }
 
     /* Sanity check */
@@ -315,6 +578,7 @@ KiDeferredReadyThread(IN PKTHREAD Thread)
 
     /* Update the ready summary */
     Prcb->ReadySummary |= PRIORITY_MASK(OldPriority);
+    KiSchedulerStatistics[Processor].ReadyQueued++;
 
     /* Sanity check */
     ASSERT(OldPriority == Thread->Priority);
@@ -337,11 +601,7 @@ KiSelectNextThread(IN PKPRCB Prcb)
         Thread = Prcb->IdleThread;
 
         /* Enable idle scheduling */
-        InterlockedOrSetMember(&KiIdleSummary, Prcb->SetMember);
-        Prcb->IdleSchedule = TRUE;
-
-        /* FIXME: SMT support */
-        ASSERTMSG("SMP: Not yet implemented\n", FALSE);
+        KiSetIdleSummary(Prcb);
     }
 
     /* Sanity checks and return the thread */
@@ -386,7 +646,7 @@ KiSwapThread(IN PKTHREAD CurrentThread,
         else
         {
             /* Set the idle summary */
-            InterlockedOrSetMember(&KiIdleSummary, Prcb->SetMember);
+            KiSetIdleSummary(Prcb);
 
             /* Schedule the idle thread */
             NextThread = Prcb->IdleThread;
@@ -664,9 +924,8 @@ KiSetPriorityThread(IN PKTHREAD Thread,
             }
             else if (Thread->State == DeferredReady)
             {
-                /* FIXME: TODO */
-                DPRINT1("Deferred state not yet supported\n");
-                ASSERT(FALSE);
+                /* It isn't on any queue yet, it will be queued at this one */
+                Thread->Priority = (SCHAR)Priority;
             }
             else
             {
@@ -680,6 +939,114 @@ KiSetPriorityThread(IN PKTHREAD Thread,
     }
 }
 
+static
+VOID
+KiMoveThreadToAffinity(IN PKTHREAD Thread)
+{
+    PKPRCB Prcb;
+    ULONG Processor;
+    PKTHREAD NextThread;
+
+    /* Loop in case the thread changes state while we look at it */
+    for (;;)
+    {
+        /* Nothing to do if it can stay on its current processor */
+        Processor = Thread->NextProcessor;
+        if (Thread->Affinity & AFFINITY_MASK(Processor)) break;
+
+        /* Choose action based on thread's state */
+        if ((Thread->State == Ready) && !(Thread->ProcessReadyQueue))
+        {
+            /* Get the PRCB for the thread and lock it */
+            Prcb = KiProcessorBlock[Processor];
+            KiAcquirePrcbLock(Prcb);
+
+            /* Make sure the thread is still ready and on this CPU */
+            if ((Thread->State != Ready) ||
+                (Thread->NextProcessor != Prcb->Number))
+            {
+                /* Release the lock and loop again */
+                KiReleasePrcbLock(Prcb);
+                continue;
+            }
+
+            /* Remove it from the current queue */
+            if (RemoveEntryList(&Thread->WaitListEntry))
+            {
+                /* Update the ready summary */
+                Prcb->ReadySummary ^= PRIORITY_MASK(Thread->Priority);
+            }
+
+            /* Make it ready again, somewhere else */
+            KiInsertDeferredReadyList(Thread);
+            KiReleasePrcbLock(Prcb);
+        }
+        else if (Thread->State == Standby)
+        {
+            /* Get the PRCB for the thread and lock it */
+            Prcb = KiProcessorBlock[Processor];
+            KiAcquirePrcbLock(Prcb);
+
+            /* Check if we're still the next thread to run */
+            if (Thread != Prcb->NextThread)
+            {
+                /* Release the lock and try again */
+                KiReleasePrcbLock(Prcb);
+                continue;
+            }
+
+            /* Select a replacement, unless the processor would just go idle */
+            NextThread = KiSelectNextThread(Prcb);
+            if (NextThread == Prcb->CurrentThread)
+            {
+                NextThread = NULL;
+            }
+            else
+            {
+                NextThread->State = Standby;
+            }
+            Prcb->NextThread = NextThread;
+
+            /* Dispatch our thread */
+            KiInsertDeferredReadyList(Thread);
+            KiReleasePrcbLock(Prcb);
+        }
+        else if (Thread->State == Running)
+        {
+            /* Get the PRCB for the thread and lock it */
+            Prcb = KiProcessorBlock[Processor];
+            KiAcquirePrcbLock(Prcb);
+
+            /* Check if we're still the current thread running */
+            if (Thread != Prcb->CurrentThread)
+            {
+                /* Thread changed, release lock and restart */
+                KiReleasePrcbLock(Prcb);
+                continue;
+            }
+
+            /* Have the processor switch away, the thread moves when it does */
+            if (!Prcb->NextThread)
+            {
+                NextThread = KiSelectNextThread(Prcb);
+                NextThread->State = Standby;
+                Prcb->NextThread = NextThread;
+            }
+
+            /* Release the lock and check if we're running on another CPU */
+            KiReleasePrcbLock(Prcb);
+            if (KeGetCurrentProcessorNumber() != Processor)
+            {
+                /* We are, send an IPI */
+                KiIpiSend(AFFINITY_MASK(Processor), IPI_DPC);
+            }
+        }
+
+        /* Waiting or deferred threads pick a processor when they are readied */
+        break;
+    }
+}
+
 KAFFINITY
 FASTCALL
 KiSetAffinityThread(IN PKTHREAD Thread,
@@ -704,10 +1071,19 @@ KiSetAffinityThread(IN PKTHREAD Thread,
     /* Check if system affinity is disabled */
     if (!Thread->SystemAffinityActive)
     {
-#ifdef CONFIG_SMP
-        /* FIXME: TODO */
-        DPRINT1("Affinity support disabled!\n");
-#endif
+        /* It is, so the new affinity applies right away */
+        Thread->Affinity = Affinity;
+
+        /* Make sure the ideal processor is still part of it */
+        if (!(Affinity & AFFINITY_MASK(Thread->IdealProcessor)))
+        {
+            Thread->IdealProcessor =
+                KeFindNextRightSetAffinity(Thread->IdealProcessor,
+                                           (ULONG)Affinity);
+        }
+
+        /* Move the thread away if it sits on a processor it can't use now */
+        KiMoveThreadToAffinity(Thread);
     }
 
     /* Return the old affinity */
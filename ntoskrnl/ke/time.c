@@ -17,6 +17,9 @@
 LONG KiTickOffset;
 ULONG KeTimeAdjustment;
 BOOLEAN KiTimeAdjustmentEnabled = FALSE;
+BOOLEAN KiDynamicTickEnabled = TRUE;
+volatile BOOLEAN KiClockStretched;
+KSPIN_LOCK KiClockRateLock;
 
 /* FUNCTIONS ******************************************************************/
 
@@ -83,6 +86,9 @@ KeUpdateSystemTime(IN PKTRAP_FRAME TrapFrame,
         return;
     }
 
+    /* Account the interrupt */
+    KiTimerStatistics.ClockInterrupts++;
+
     /* Add the increment time to the shared data */
     InterruptTime.QuadPart = *(ULONGLONG*)&SharedUserData->InterruptTime;
     InterruptTime.QuadPart += Increment;
@@ -135,6 +141,55 @@ KeUpdateSystemTime(IN PKTRAP_FRAME TrapFrame,
     KiEndInterrupt(Irql, TrapFrame);
 }
 
+VOID
+FASTCALL
+KiStretchClockForIdle(IN PKPRCB Prcb)
+{
+    ULONGLONG DueTime;
+
+    /* Check if the clock already runs at its slowest rate */
+    if (!(KiDynamicTickEnabled) ||
+        (KiClockStretched) ||
+        (KeTimeIncrement >= KeMaximumIncrement))
+    {
+        return;
+    }
+
+    /* Only the clock owner decides, and only when every processor is idle */
+    if ((Prcb->Number != 0) || (KiIdleSummary != KeActiveProcessors)) return;
+
+    /* Don't stretch the clock past the next timer */
+    DueTime = KiQueryNextTimerDueTime();
+    if (DueTime < KeQueryInterruptTime() + KeMaximumIncrement) return;
+
+    /* Tick at the slowest rate, the HAL applies it on the next interrupt */
+    KeAcquireSpinLockAtDpcLevel(&KiClockRateLock);
+    if (!KiClockStretched)
+    {
+        KiClockStretched = TRUE;
+        HalSetTimeIncrement(KeMaximumIncrement);
+        KiTimerStatistics.ClockStretches++;
+    }
+    KeReleaseSpinLockFromDpcLevel(&KiClockRateLock);
+}
+
+VOID
+FASTCALL
+KiRestoreClockRate(VOID)
+{
+    /* Check if the clock was stretched at all */
+    if (!KiClockStretched) return;
+
+    /* Go back to the rate requested through ExSetTimerResolution */
+    KeAcquireSpinLockAtDpcLevel(&KiClockRateLock);
+    if (KiClockStretched)
+    {
+        HalSetTimeIncrement(KeTimeIncrement);
+        KiClockStretched = FALSE;
+    }
+    KeReleaseSpinLockFromDpcLevel(&KiClockRateLock);
+}
+
 VOID
 NTAPI
 KeUpdateRunTime(IN PKTRAP_FRAME TrapFrame,
@@ -18,6 +18,7 @@ KTIMER_TABLE_ENTRY KiTimerTableListHead[TIMER_TABLE_SIZE];
 LARGE_INTEGER KiTimeIncrementReciprocal;
 UCHAR KiTimeIncrementShiftCount;
 BOOLEAN KiEnableTimerWatchdog = FALSE;
+KI_TIMER_STATISTICS KiTimerStatistics;
 
 /* PRIVATE FUNCTIONS *********************************************************/
 
@@ -105,10 +106,40 @@ KiInsertTimerTable(IN PKTIMER Timer,
         if (DueTime <= InterruptTime.QuadPart) Expired = TRUE;
     }
 
+    /* A stretched clock would fire this timer late, go back to full rate */
+    if ((KiClockStretched) &&
+        (DueTime < (LONGLONG)(KeQueryInterruptTime() + KeMaximumIncrement)))
+    {
+        KiRestoreClockRate();
+    }
+
     /* Return expired state */
     return Expired;
 }
 
+ULONGLONG
+FASTCALL
+KiQueryNextTimerDueTime(VOID)
+{
+    ULONGLONG DueTime = ~(ULONGLONG)0;
+    ULONG Hand;
+
+    /*
+     * Each hand caches the due time of its first timer, or an infinite time
+     * when it is empty. The reads aren't locked, a stale value only makes
+     * the caller keep the current clock rate or stretch it by one tick.
+     */
+    for (Hand = 0; Hand < TIMER_TABLE_SIZE; Hand++)
+    {
+        if ((ULONGLONG)KiTimerTableListHead[Hand].Time.QuadPart < DueTime)
+        {
+            DueTime = KiTimerTableListHead[Hand].Time.QuadPart;
+        }
+    }
+
+    return DueTime;
+}
+
 BOOLEAN
 FASTCALL
 KiSignalTimer(IN PKTIMER Timer)
@@ -278,32 +309,27 @@ KeReadStateTimer(IN PKTIMER Timer)
  */
 BOOLEAN
 NTAPI
-KeSetTimer(IN OUT PKTIMER Timer,
-           IN LARGE_INTEGER DueTime,
-           IN PKDPC Dpc OPTIONAL)
-{
-    /* Call the newer function and supply a period of 0 */
-    return KeSetTimerEx(Timer, DueTime, 0, Dpc);
-}
-
-/*
- * @implemented
- */
-BOOLEAN
-NTAPI
-KeSetTimerEx(IN OUT PKTIMER Timer,
-             IN LARGE_INTEGER DueTime,
-             IN LONG Period,
-             IN PKDPC Dpc OPTIONAL)
+KeSetCoalescableTimer(IN OUT PKTIMER Timer,
+                      IN LARGE_INTEGER DueTime,
+                      IN ULONG Period,
+                      IN ULONG TolerableDelay,
+                      IN PKDPC Dpc OPTIONAL)
 {
     KIRQL OldIrql;
     BOOLEAN Inserted;
     ULONG Hand = 0;
     BOOLEAN RequestInterrupt = FALSE;
+    ULONGLONG Ticks;
+    UCHAR Shift = 0;
     ASSERT_TIMER(Timer);
     ASSERT(KeGetCurrentIrql() <= DISPATCH_LEVEL);
-    DPRINT("KeSetTimerEx(): Timer %p, DueTime %I64d, Period %d, Dpc %p\n",
-           Timer, DueTime.QuadPart, Period, Dpc);
+    DPRINT("KeSetCoalescableTimer(): Timer %p, DueTime %I64d, Period %lu, "
+           "TolerableDelay %lu, Dpc %p\n",
+           Timer, DueTime.QuadPart, Period, TolerableDelay, Dpc);
+
+    /* Find the largest power of two number of ticks within the delay */
+    Ticks = (ULONGLONG)TolerableDelay * 10000 / KeMaximumIncrement;
+    while ((Ticks >> (Shift + 1)) && (Shift < 31)) Shift++;
 
     /* Lock the Database and Raise IRQL */
     OldIrql = KiAcquireDispatcherLock();
@@ -315,24 +341,30 @@ KeSetTimerEx(IN OUT PKTIMER Timer,
     /* Set Default Timer Data */
     Timer->Dpc = Dpc;
     Timer->Period = Period;
+
+    /* Delays shorter than a tick can't batch anything */
+    Timer->Header.Coalescable = (Ticks != 0);
+    Timer->Header.EncodedTolerableDelay = Shift;
+    if (Ticks) KiTimerStatistics.CoalescedTimers++;
+
     if (!KiComputeDueTime(Timer, DueTime, &Hand))
     {
         /* Signal the timer */
         RequestInterrupt = KiSignalTimer(Timer);
-        
+
         /* Release the dispatcher lock */
         KiReleaseDispatcherLockFromSynchLevel();
-        
+
         /* Check if we need to do an interrupt */
-        if (RequestInterrupt) HalRequestSoftwareInterrupt(DISPATCH_LEVEL);        
+        if (RequestInterrupt) HalRequestSoftwareInterrupt(DISPATCH_LEVEL);
     }
     else
     {
         /* Insert the timer */
         Timer->Header.SignalState = FALSE;
-        KxInsertTimer(Timer, Hand);        
+        KxInsertTimer(Timer, Hand);
     }
-    
+
     /* Exit the dispatcher */
     KiExitDispatcher(OldIrql);
 
@@ -340,3 +372,29 @@ KeSetTimerEx(IN OUT PKTIMER Timer,
     return Inserted;
 }
 
+/*
+ * @implemented
+ */
+BOOLEAN
+NTAPI
+KeSetTimer(IN OUT PKTIMER Timer,
+           IN LARGE_INTEGER DueTime,
+           IN PKDPC Dpc OPTIONAL)
+{
+    /* Call the newer function and supply a period of 0 */
+    return KeSetTimerEx(Timer, DueTime, 0, Dpc);
+}
+
+/*
+ * @implemented
+ */
+BOOLEAN
+NTAPI
+KeSetTimerEx(IN OUT PKTIMER Timer,
+             IN LARGE_INTEGER DueTime,
+             IN LONG Period,
+             IN PKDPC Dpc OPTIONAL)
+{
+    /* Call the newer function and supply no tolerable delay */
+    return KeSetCoalescableTimer(Timer, DueTime, Period, 0, Dpc);
+}
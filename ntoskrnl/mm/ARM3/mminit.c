@@ -2147,8 +2147,15 @@ MmArmInitSystem(IN ULONG Phase,
         /* Initialize the Loader Lock */
         KeInitializeMutant(&MmSystemLoadLock, FALSE);
 
-        /* Set up the zero page event */
+        /* Set up the zero page events */
         KeInitializeEvent(&MmZeroingPageEvent, NotificationEvent, FALSE);
+        KeInitializeEvent(&MmZeroingAssistEvent, NotificationEvent, FALSE);
+
+        /* Keep about 3% of memory zeroed unless the registry says otherwise */
+        if (!MmZeroedPageLowWaterMark)
+        {
+            MmZeroedPageLowWaterMark = (ULONG)(MmNumberOfPhysicalPages / 32);
+        }
 
         /* Initialize the dead stack S-LIST */
         InitializeSListHead(&MmDeadStackSListHead);
@@ -117,6 +117,21 @@ MiDecrementAvailablePages(
     }
 }
 
+static
+VOID
+MiCheckZeroedPageLowWater(
+    VOID)
+{
+    /* Once below the low-water mark, the zeroing threads of all processors run */
+    if ((MmZeroedPageListHead.Total < MmZeroedPageLowWaterMark) &&
+        (MmFreePageListHead.Total != 0) &&
+        !MmZeroingAssistEvent.Header.SignalState)
+    {
+        KeSetEvent(&MmZeroingPageEvent, IO_NO_INCREMENT, FALSE);
+        KeSetEvent(&MmZeroingAssistEvent, IO_NO_INCREMENT, FALSE);
+    }
+}
+
 VOID
 NTAPI
 MiZeroPhysicalPage(IN PFN_NUMBER PageFrameIndex)
@@ -586,6 +601,9 @@ MiRemoveZeroPage(IN ULONG Color)
     /* Zero it, if needed */
     if (Zero) MiZeroPhysicalPage(PageIndex);
 
+    /* Don't let the zeroed pages run out */
+    MiCheckZeroedPageLowWater();
+
     /* Sanity checks */
     ASSERT(Pfn1->u3.e2.ReferenceCount == 0);
     ASSERT(Pfn1->u2.ShareCount == 0);
@@ -707,6 +725,9 @@ MiInsertPageInFreeList(IN PFN_NUMBER PageFrameIndex)
         KeSetEvent(&MmZeroingPageEvent, IO_NO_INCREMENT, FALSE);
     }
 
+    /* Get help if the zeroed pages are running low */
+    MiCheckZeroedPageLowWater();
+
 #if MI_TRACE_PFNS
     Pfn1->PfnUsage = MI_USAGE_FREE_PAGE;
     RtlZeroMemory(Pfn1->ProcessName, 16);
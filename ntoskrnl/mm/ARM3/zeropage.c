@@ -17,7 +17,23 @@
 
 /* GLOBALS ********************************************************************/
 
+/* Number of pages zeroed and mapped by a zeroing thread at once */
+#define MI_ZERO_BATCH_PAGES 16
+
+/* Zeroing threads beyond this don't get more out of the memory bus */
+#define MI_MAXIMUM_ZERO_THREADS 8
+
 KEVENT MmZeroingPageEvent;
+KEVENT MmZeroingAssistEvent;
+
+/*
+ * When fewer zeroed pages are left, the zeroing threads of the other
+ * processors help out. Zero means a default based on the amount of memory.
+ */
+ULONG MmZeroedPageLowWaterMark;
+
+ULONG MmZeroPageThreads;
+volatile ULONG MmZeroedPageCount;
 
 /* PRIVATE FUNCTIONS **********************************************************/
 
@@ -31,82 +47,179 @@ NTAPI
 MiFreeInitializationCode(IN PVOID StartVa,
 IN PVOID EndVa);
 
+static
+ULONG
+MiZeroPageBatch(IN PMMPTE ZeroPte)
+{
+    PFN_NUMBER Pages[MI_ZERO_BATCH_PAGES];
+    PFN_NUMBER PageIndex, FreePage;
+    PVOID ZeroAddress;
+    MMPTE TempPte;
+    KIRQL OldIrql;
+    ULONG Count, i;
+
+    /* Take a whole batch of free pages at once */
+    OldIrql = MiAcquirePfnLock();
+    for (Count = 0; Count < MI_ZERO_BATCH_PAGES && MmFreePageListHead.Total; Count++)
+    {
+        PageIndex = MmFreePageListHead.Flink;
+        ASSERT(PageIndex != LIST_HEAD);
+        MI_SET_USAGE(MI_USAGE_ZERO_LOOP);
+        MI_SET_PROCESS2("Kernel 0 Loop");
+        FreePage = MiRemoveAnyPage(MI_GET_PAGE_COLOR(PageIndex));
+
+        /* The first global free page should also be the first on its own list */
+        if (FreePage != PageIndex)
+        {
+            KeBugCheckEx(PFN_LIST_CORRUPT,
+                         0x8F,
+                         FreePage,
+                         PageIndex,
+                         0);
+        }
+
+        Pages[Count] = PageIndex;
+    }
+    MiReleasePfnLock(OldIrql);
+
+    if (!Count) return 0;
+
+    /*
+     * Map them next to each other in the window of this thread. Zeroing
+     * threads stay on their processor, so only the local TB needs flushing.
+     */
+    ZeroAddress = MiPteToAddress(ZeroPte);
+    TempPte = ValidKernelPte;
+    for (i = 0; i < Count; i++)
+    {
+        TempPte.u.Hard.PageFrameNumber = Pages[i];
+        MI_WRITE_VALID_PTE(ZeroPte + i, TempPte);
+    }
+
+    /* The pages wait on the zeroed list, keep them out of the caches */
+    KeZeroPagesNonTemporal(ZeroAddress, Count * PAGE_SIZE);
+
+    for (i = 0; i < Count; i++)
+    {
+        MI_ERASE_PTE(ZeroPte + i);
+        KeInvalidateTlbEntry((PUCHAR)ZeroAddress + i * PAGE_SIZE);
+    }
+
+    OldIrql = MiAcquirePfnLock();
+    for (i = 0; i < Count; i++)
+    {
+        MiInsertPageInList(&MmZeroedPageListHead, Pages[i]);
+    }
+    MiReleasePfnLock(OldIrql);
+
+    InterlockedExchangeAdd((PLONG)&MmZeroedPageCount, Count);
+    return Count;
+}
+
+static
+BOOLEAN
+MiZeroingDone(IN BOOLEAN Assist)
+{
+    if (!MmFreePageListHead.Total) return TRUE;
+
+    /* Helpers only run while the zeroed pages are short */
+    return Assist && (MmZeroedPageListHead.Total >= MmZeroedPageLowWaterMark);
+}
+
+static
+VOID
+MiZeroPageLoop(IN PKEVENT Event,
+               IN BOOLEAN Assist)
+{
+    PMMPTE ZeroPte;
+    KIRQL OldIrql;
+
+    ZeroPte = MiReserveSystemPtes(MI_ZERO_BATCH_PAGES, SystemPteSpace);
+    if (!ZeroPte)
+    {
+        /* Not fatal for a helper, the others will do the work */
+        if (Assist) return;
+        KeBugCheckEx(NO_MORE_SYSTEM_PTES, 0, MI_ZERO_BATCH_PAGES, 0, 0);
+    }
+
+    while (TRUE)
+    {
+        /* FIXME: Also wait for the idle timer once it is implemented */
+        KeWaitForSingleObject(Event,
+                              WrFreePage,
+                              KernelMode,
+                              FALSE,
+                              NULL);
+
+        while (!MiZeroingDone(Assist) && MiZeroPageBatch(ZeroPte));
+
+        /* Only go back to sleep if there really is nothing left to do */
+        OldIrql = MiAcquirePfnLock();
+        if (MiZeroingDone(Assist)) KeClearEvent(Event);
+        MiReleasePfnLock(OldIrql);
+    }
+}
+
+static
+VOID
+NTAPI
+MiZeroPageAssistThread(IN PVOID Context)
+{
+    PKTHREAD Thread = KeGetCurrentThread();
+
+    /* Stay on our processor, see MiZeroPageBatch */
+    KeSetSystemAffinityThread(AFFINITY_MASK((ULONG_PTR)Context));
+
+    Thread->BasePriority = 0;
+    KeSetPriorityThread(Thread, 0);
+
+    MiZeroPageLoop(&MmZeroingAssistEvent, TRUE);
+}
+
 VOID
 NTAPI
 MmZeroPageThread(VOID)
 {
     PKTHREAD Thread = KeGetCurrentThread();
     PVOID StartAddress, EndAddress;
-    PVOID WaitObjects[2];
-    KIRQL OldIrql;
-    PVOID ZeroAddress;
-    PFN_NUMBER PageIndex, FreePage;
-    PMMPFN Pfn1;
+    HANDLE ThreadHandle;
+    NTSTATUS Status;
+    ULONG i;
 
     /* Get the discardable sections to free them */
     MiFindInitializationCode(&StartAddress, &EndAddress);
     if (StartAddress) MiFreeInitializationCode(StartAddress, EndAddress);
     DPRINT("Free non-cache pages: %lx\n", MmAvailablePages + MiMemoryConsumers[MC_CACHE].PagesUsed);
 
+    /* Stay on the boot processor, see MiZeroPageBatch */
+    KeSetSystemAffinityThread(AFFINITY_MASK(0));
+
     /* Set our priority to 0 */
     Thread->BasePriority = 0;
     KeSetPriorityThread(Thread, 0);
 
-    /* Setup the wait objects */
-    WaitObjects[0] = &MmZeroingPageEvent;
-//    WaitObjects[1] = &PoSystemIdleTimer; FIXME: Implement idle timer
-
-    while (TRUE)
+    /* Start a helper on every other processor */
+    MmZeroPageThreads = 1;
+    for (i = 1; i < min((ULONG)KeNumberProcessors, MI_MAXIMUM_ZERO_THREADS); i++)
     {
-        KeWaitForMultipleObjects(1, // 2
-                                 WaitObjects,
-                                 WaitAny,
-                                 WrFreePage,
-                                 KernelMode,
-                                 FALSE,
-                                 NULL,
-                                 NULL);
-        OldIrql = MiAcquirePfnLock();
-
-        while (TRUE)
+        Status = PsCreateSystemThread(&ThreadHandle,
+                                      THREAD_ALL_ACCESS,
+                                      NULL,
+                                      NULL,
+                                      NULL,
+                                      MiZeroPageAssistThread,
+                                      (PVOID)(ULONG_PTR)i);
+        if (!NT_SUCCESS(Status))
         {
-            if (!MmFreePageListHead.Total)
-            {
-                KeClearEvent(&MmZeroingPageEvent);
-                MiReleasePfnLock(OldIrql);
-                break;
-            }
-
-            PageIndex = MmFreePageListHead.Flink;
-            ASSERT(PageIndex != LIST_HEAD);
-            Pfn1 = MiGetPfnEntry(PageIndex);
-            MI_SET_USAGE(MI_USAGE_ZERO_LOOP);
-            MI_SET_PROCESS2("Kernel 0 Loop");
-            FreePage = MiRemoveAnyPage(MI_GET_PAGE_COLOR(PageIndex));
-
-            /* The first global free page should also be the first on its own list */
-            if (FreePage != PageIndex)
-            {
-                KeBugCheckEx(PFN_LIST_CORRUPT,
-                             0x8F,
-                             FreePage,
-                             PageIndex,
-                             0);
-            }
-
-            Pfn1->u1.Flink = LIST_HEAD;
-            MiReleasePfnLock(OldIrql);
-
-            ZeroAddress = MiMapPagesInZeroSpace(Pfn1, 1);
-            ASSERT(ZeroAddress);
-            RtlZeroMemory(ZeroAddress, PAGE_SIZE);
-            MiUnmapPagesInZeroSpace(ZeroAddress, 1);
-
-            OldIrql = MiAcquirePfnLock();
-
-            MiInsertPageInList(&MmZeroedPageListHead, PageIndex);
+            DPRINT1("Failed to create zero page thread %lu: 0x%lx\n", i, Status);
+            break;
         }
+
+        ZwClose(ThreadHandle);
+        MmZeroPageThreads++;
     }
+
+    MiZeroPageLoop(&MmZeroingPageEvent, FALSE);
 }
 
 /* EOF */
@@ -203,6 +203,9 @@ MmTrimUserMemory(ULONG Target, ULONG Priority, PULONG NrFreedPages)
         CurrentPage = NextPage;
     }
 
+    /* The pages only become free once they are written */
+    MmFlushSwapPages();
+
     return STATUS_SUCCESS;
 }
 
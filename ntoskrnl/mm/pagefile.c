@@ -87,6 +87,51 @@ static PFN_COUNT MiReservedSwapPages;
 /* Make sure there can be only 16 paging files */
 C_ASSERT(FILE_FROM_ENTRY(0xffffffff) < MAX_PAGING_FILES);
 
+/*
+ * Swap space is handed out in runs of this many pages and dirty pages are
+ * written back in clusters of up to this many pages, so that pages paged out
+ * together end up next to each other in the paging file and go to the disk
+ * with a single request.
+ */
+#define MI_SWAP_CLUSTER_PAGES         (16)
+
+/* Pages of a cluster freed while it is being written are tracked in a mask */
+C_ASSERT(MI_SWAP_CLUSTER_PAGES <= 32);
+
+typedef struct _MI_SWAP_CLUSTER
+{
+    ULONG PageFileIndex;
+    ULONG_PTR FirstOffset;
+    ULONG Count;
+    ULONG FreedMask;
+    BOOLEAN Writing;
+    BOOLEAN Failed;
+    NTSTATUS Status;
+    KEVENT Event;
+    IO_STATUS_BLOCK Iosb;
+    PFN_NUMBER Pages[MI_SWAP_CLUSTER_PAGES];
+    UCHAR MdlBase[sizeof(MDL) + MI_SWAP_CLUSTER_PAGES * sizeof(PFN_NUMBER)];
+} MI_SWAP_CLUSTER, *PMI_SWAP_CLUSTER;
+
+/*
+ * One cluster collects pages while the other one is on its way to the disk.
+ * A cluster whose write failed keeps its pages and slots. It is written again
+ * before the gathering cluster is started. Until that works, page-outs fail
+ * once the gathering cluster is full.
+ * The writer lock serializes everything that fills, starts or retires a
+ * cluster, the cluster lock protects their contents against lookups from the
+ * page-in and free paths, which never wait for the disk.
+ */
+static MI_SWAP_CLUSTER MiSwapClusters[2];
+static PMI_SWAP_CLUSTER MiGatherCluster;
+static KGUARDED_MUTEX MiSwapWriterLock;
+static KGUARDED_MUTEX MiSwapClusterLock;
+
+/* Current run of swap space, protected by MmPageFileCreationLock */
+static ULONG MiSwapRunFile;
+static ULONG MiSwapRunOffset;
+static ULONG MiSwapRunLeft;
+
 static BOOLEAN MmSwapSpaceMessage = FALSE;
 
 static BOOLEAN MmSystemPageFileLocated = FALSE;
@@ -132,20 +177,316 @@ MmShowOutOfSpaceMessagePagingFile(VOID)
     }
 }
 
+static
+NTSTATUS
+MiStartPageFileWrite(
+    _In_ PMDL Mdl,
+    _In_ PPFN_NUMBER Pages,
+    _In_ ULONG PageCount,
+    _In_ ULONG PageFileIndex,
+    _In_ ULONG_PTR PageFileOffset,
+    _In_ PKEVENT Event,
+    _Out_ PIO_STATUS_BLOCK Iosb)
+{
+    LARGE_INTEGER file_offset;
+    PMMPAGING_FILE PagingFile;
+
+    PagingFile = MmPagingFile[PageFileIndex];
+
+    if (PagingFile->FileObject == NULL || PagingFile->FileObject->DeviceObject == NULL)
+    {
+        DPRINT1("Bad paging file %u\n", PageFileIndex);
+        KeBugCheck(MEMORY_MANAGEMENT);
+    }
+
+    MmInitializeMdl(Mdl, NULL, PageCount * PAGE_SIZE);
+    MmBuildMdlFromPages(Mdl, Pages);
+    Mdl->MdlFlags |= MDL_PAGES_LOCKED;
+
+    file_offset.QuadPart = (LONGLONG)PageFileOffset * PAGE_SIZE;
+
+    KeInitializeEvent(Event, NotificationEvent, FALSE);
+    return IoSynchronousPageWrite(PagingFile->FileObject,
+                                  Mdl,
+                                  &file_offset,
+                                  Event,
+                                  Iosb);
+}
+
+static
+NTSTATUS
+MiFinishPageFileWrite(
+    _In_ PMDL Mdl,
+    _In_ NTSTATUS Status,
+    _In_ PKEVENT Event,
+    _In_ PIO_STATUS_BLOCK Iosb)
+{
+    if (Status == STATUS_PENDING)
+    {
+        KeWaitForSingleObject(Event, Executive, KernelMode, FALSE, NULL);
+        Status = Iosb->Status;
+    }
+
+    if (Mdl->MdlFlags & MDL_MAPPED_TO_SYSTEM_VA)
+    {
+        MmUnmapLockedPages(Mdl->MappedSystemVa, Mdl);
+    }
+    return Status;
+}
+
+static
+VOID
+MiReleaseSwapSpace(ULONG PageFileIndex, ULONG_PTR Offset)
+{
+    PMMPAGING_FILE PagingFile;
+
+    KeAcquireGuardedMutex(&MmPageFileCreationLock);
+
+    PagingFile = MmPagingFile[PageFileIndex];
+    if (PagingFile == NULL)
+    {
+        KeBugCheck(MEMORY_MANAGEMENT);
+    }
+
+    RtlClearBit(PagingFile->Bitmap, (ULONG)Offset);
+
+    PagingFile->FreeSpace++;
+    PagingFile->CurrentUsage--;
+
+    MiFreeSwapPages++;
+    MiUsedSwapPages--;
+
+    KeReleaseGuardedMutex(&MmPageFileCreationLock);
+}
+
+static
+PMI_SWAP_CLUSTER
+MiOtherSwapCluster(PMI_SWAP_CLUSTER Cluster)
+{
+    return (Cluster == &MiSwapClusters[0]) ? &MiSwapClusters[1] : &MiSwapClusters[0];
+}
+
+/*
+ * Returns the cluster a page file slot is queued in. A slot can be queued
+ * twice when a page is paged out again before its previous copy reached the
+ * disk, the gathering cluster then has the newer copy. The cluster lock must
+ * be held.
+ */
+static
+PMI_SWAP_CLUSTER
+MiFindSwapCluster(ULONG PageFileIndex, ULONG_PTR Offset, PULONG Index)
+{
+    PMI_SWAP_CLUSTER Cluster;
+    ULONG i;
+
+    Cluster = MiGatherCluster;
+    for (i = 0; i < RTL_NUMBER_OF(MiSwapClusters); i++)
+    {
+        if (Cluster->Count != 0 &&
+            Cluster->PageFileIndex == PageFileIndex &&
+            Offset >= Cluster->FirstOffset &&
+            Offset < Cluster->FirstOffset + Cluster->Count)
+        {
+            if (Index != NULL)
+            {
+                *Index = (ULONG)(Offset - Cluster->FirstOffset);
+            }
+            return Cluster;
+        }
+        Cluster = MiOtherSwapCluster(Cluster);
+    }
+
+    return NULL;
+}
+
+/*
+ * Copies a page that is still queued for writing. Returns STATUS_NOT_FOUND if
+ * the slot isn't queued (anymore) and has to be read from the disk.
+ */
+static
+NTSTATUS
+MiReadSwapCluster(PFN_NUMBER Page, ULONG PageFileIndex, ULONG_PTR PageFileOffset)
+{
+    PMI_SWAP_CLUSTER Cluster;
+    ULONG Index;
+    UCHAR MdlBase[sizeof(MDL) + sizeof(PFN_NUMBER)];
+    PMDL Mdl = (PMDL)MdlBase;
+    PVOID Source;
+    BOOLEAN Copied = FALSE;
+    NTSTATUS Status;
+
+    KeAcquireGuardedMutex(&MiSwapClusterLock);
+
+    Cluster = MiFindSwapCluster(PageFileIndex, PageFileOffset, &Index);
+    if (Cluster == NULL)
+    {
+        KeReleaseGuardedMutex(&MiSwapClusterLock);
+        return STATUS_NOT_FOUND;
+    }
+
+    MmInitializeMdl(Mdl, NULL, PAGE_SIZE);
+    MmBuildMdlFromPages(Mdl, &Cluster->Pages[Index]);
+    Mdl->MdlFlags |= MDL_PAGES_LOCKED;
+
+    Source = MmMapLockedPagesSpecifyCache(Mdl, KernelMode, MmCached, NULL, FALSE, HighPagePriority);
+    if (Source != NULL)
+    {
+        Copied = NT_SUCCESS(MiCopyFromUserPage(Page, Source));
+        MmUnmapLockedPages(Source, Mdl);
+    }
+
+    KeReleaseGuardedMutex(&MiSwapClusterLock);
+
+    if (Copied)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    /* Get it on the disk so that it can be read from there */
+    Status = MmFlushSwapPages();
+    return NT_SUCCESS(Status) ? STATUS_NOT_FOUND : Status;
+}
+
+/*
+ * Waits for the write of a cluster and gives its pages and the slots freed in
+ * the meantime back. A cluster that failed before is written again first. If
+ * the write fails, the pages and slots stay in the cluster and page-ins keep
+ * copying them from memory. The writer lock must be held.
+ */
+static
+NTSTATUS
+MiCompleteSwapCluster(PMI_SWAP_CLUSTER Cluster)
+{
+    PMDL Mdl = (PMDL)Cluster->MdlBase;
+    NTSTATUS Status;
+    ULONG FreedMask;
+    ULONG Count;
+    ULONG i;
+
+    if (Cluster->Failed)
+    {
+        Cluster->Failed = FALSE;
+        Cluster->Writing = TRUE;
+        Cluster->Status = MiStartPageFileWrite(Mdl,
+                                               Cluster->Pages,
+                                               Cluster->Count,
+                                               Cluster->PageFileIndex,
+                                               Cluster->FirstOffset,
+                                               &Cluster->Event,
+                                               &Cluster->Iosb);
+    }
+
+    if (!Cluster->Writing)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    Status = MiFinishPageFileWrite(Mdl, Cluster->Status, &Cluster->Event, &Cluster->Iosb);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT1("MM: Failed to write %lu pages to paging file %lu at 0x%Ix (Status was 0x%.8X)\n",
+                Cluster->Count, Cluster->PageFileIndex, Cluster->FirstOffset, Status);
+
+        /* Give every page another chance on its own */
+        for (i = 0; i < Cluster->Count; i++)
+        {
+            Status = MiStartPageFileWrite(Mdl,
+                                          &Cluster->Pages[i],
+                                          1,
+                                          Cluster->PageFileIndex,
+                                          Cluster->FirstOffset + i,
+                                          &Cluster->Event,
+                                          &Cluster->Iosb);
+            Status = MiFinishPageFileWrite(Mdl, Status, &Cluster->Event, &Cluster->Iosb);
+            if (!NT_SUCCESS(Status))
+            {
+                /*
+                 * The pages aren't mapped anywhere anymore, so keep them and
+                 * their slots queued and try again with the next cluster.
+                 */
+                DPRINT1("MM: Keeping %lu pages queued for paging file %lu at 0x%Ix\n",
+                        Cluster->Count, Cluster->PageFileIndex, Cluster->FirstOffset);
+                Cluster->Writing = FALSE;
+                Cluster->Failed = TRUE;
+                return Status;
+            }
+        }
+    }
+
+    KeAcquireGuardedMutex(&MiSwapClusterLock);
+    FreedMask = Cluster->FreedMask;
+    Count = Cluster->Count;
+    Cluster->Count = 0;
+    Cluster->Writing = FALSE;
+    KeReleaseGuardedMutex(&MiSwapClusterLock);
+
+    for (i = 0; i < Count; i++)
+    {
+        if (FreedMask & (1 << i))
+        {
+            MiReleaseSwapSpace(Cluster->PageFileIndex, Cluster->FirstOffset + i);
+        }
+        MmReleasePageMemoryConsumer(MC_USER, Cluster->Pages[i]);
+    }
+
+    return STATUS_SUCCESS;
+}
+
+/*
+ * Starts writing the gathering cluster and switches to the other one. Fails
+ * and leaves the gathering cluster alone if the other one still can't be
+ * written. The writer lock must be held.
+ */
+static
+NTSTATUS
+MiStartSwapCluster(VOID)
+{
+    PMI_SWAP_CLUSTER Cluster = MiGatherCluster;
+    PMI_SWAP_CLUSTER Next = MiOtherSwapCluster(Cluster);
+    NTSTATUS Status;
+
+    /*
+     * Only one cluster is written at a time. This also keeps the writes of
+     * a slot that is queued twice in order.
+     */
+    Status = MiCompleteSwapCluster(Next);
+    if (!NT_SUCCESS(Status))
+    {
+        return Status;
+    }
+
+    if (Cluster->Count == 0)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    Cluster->Writing = TRUE;
+    Cluster->Status = MiStartPageFileWrite((PMDL)Cluster->MdlBase,
+                                           Cluster->Pages,
+                                           Cluster->Count,
+                                           Cluster->PageFileIndex,
+                                           Cluster->FirstOffset,
+                                           &Cluster->Event,
+                                           &Cluster->Iosb);
+
+    KeAcquireGuardedMutex(&MiSwapClusterLock);
+    MiGatherCluster = Next;
+    KeReleaseGuardedMutex(&MiSwapClusterLock);
+
+    return STATUS_SUCCESS;
+}
+
 NTSTATUS
 NTAPI
-MmWriteToSwapPage(SWAPENTRY SwapEntry, PFN_NUMBER Page)
+MmQueueSwapPage(SWAPENTRY SwapEntry, PFN_NUMBER Page)
 {
+    PMI_SWAP_CLUSTER Cluster;
     ULONG i;
     ULONG_PTR offset;
-    LARGE_INTEGER file_offset;
-    IO_STATUS_BLOCK Iosb;
+    KIRQL OldIrql;
     NTSTATUS Status;
-    KEVENT Event;
-    UCHAR MdlBase[sizeof(MDL) + sizeof(ULONG)];
-    PMDL Mdl = (PMDL)MdlBase;
 
-    DPRINT("MmWriteToSwapPage\n");
+    DPRINT("MmQueueSwapPage\n");
 
     if (SwapEntry == 0)
     {
@@ -156,36 +497,107 @@ MmWriteToSwapPage(SWAPENTRY SwapEntry, PFN_NUMBER Page)
     i = FILE_FROM_ENTRY(SwapEntry);
     offset = OFFSET_FROM_ENTRY(SwapEntry) - 1;
 
-    if (MmPagingFile[i]->FileObject == NULL ||
-            MmPagingFile[i]->FileObject->DeviceObject == NULL)
+    KeAcquireGuardedMutex(&MiSwapWriterLock);
+
+    /* A full cluster is only left behind when the other one failed */
+    Cluster = MiGatherCluster;
+    if (Cluster->Count != 0 &&
+        (Cluster->Count == MI_SWAP_CLUSTER_PAGES ||
+         Cluster->PageFileIndex != i ||
+         Cluster->FirstOffset + Cluster->Count != offset))
     {
-        DPRINT1("Bad paging file 0x%.8X\n", SwapEntry);
-        KeBugCheck(MEMORY_MANAGEMENT);
+        Status = MiStartSwapCluster();
+        if (!NT_SUCCESS(Status))
+        {
+            KeReleaseGuardedMutex(&MiSwapWriterLock);
+            return Status;
+        }
+        Cluster = MiGatherCluster;
     }
 
-    MmInitializeMdl(Mdl, NULL, PAGE_SIZE);
-    MmBuildMdlFromPages(Mdl, &Page);
-    Mdl->MdlFlags |= MDL_PAGES_LOCKED;
+    /* The cluster keeps the page around until it is on the disk */
+    OldIrql = MiAcquirePfnLock();
+    MmReferencePage(Page);
+    MiReleasePfnLock(OldIrql);
 
-    file_offset.QuadPart = offset * PAGE_SIZE;
+    KeAcquireGuardedMutex(&MiSwapClusterLock);
+    if (Cluster->Count == 0)
+    {
+        Cluster->PageFileIndex = i;
+        Cluster->FirstOffset = offset;
+        Cluster->FreedMask = 0;
+    }
+    Cluster->Pages[Cluster->Count++] = Page;
+    KeReleaseGuardedMutex(&MiSwapClusterLock);
 
-    KeInitializeEvent(&Event, NotificationEvent, FALSE);
-    Status = IoSynchronousPageWrite(MmPagingFile[i]->FileObject,
-                                    Mdl,
-                                    &file_offset,
-                                    &Event,
-                                    &Iosb);
-    if (Status == STATUS_PENDING)
+    if (Cluster->Count == MI_SWAP_CLUSTER_PAGES)
     {
-        KeWaitForSingleObject(&Event, Executive, KernelMode, FALSE, NULL);
-        Status = Iosb.Status;
+        /* If this fails, the next page queued tries again */
+        MiStartSwapCluster();
     }
 
-    if (Mdl->MdlFlags & MDL_MAPPED_TO_SYSTEM_VA)
+    KeReleaseGuardedMutex(&MiSwapWriterLock);
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+NTAPI
+MmFlushSwapPages(VOID)
+{
+    PMI_SWAP_CLUSTER Cluster;
+    NTSTATUS Status;
+
+    KeAcquireGuardedMutex(&MiSwapWriterLock);
+    Cluster = MiGatherCluster;
+    Status = MiStartSwapCluster();
+    if (NT_SUCCESS(Status))
     {
-        MmUnmapLockedPages (Mdl->MappedSystemVa, Mdl);
+        Status = MiCompleteSwapCluster(Cluster);
     }
-    return(Status);
+    KeReleaseGuardedMutex(&MiSwapWriterLock);
+
+    return Status;
+}
+
+NTSTATUS
+NTAPI
+MmWriteToSwapPage(SWAPENTRY SwapEntry, PFN_NUMBER Page)
+{
+    ULONG i;
+    ULONG_PTR offset;
+    IO_STATUS_BLOCK Iosb;
+    NTSTATUS Status;
+    KEVENT Event;
+    UCHAR MdlBase[sizeof(MDL) + sizeof(PFN_NUMBER)];
+    PMDL Mdl = (PMDL)MdlBase;
+    BOOLEAN Queued;
+
+    DPRINT("MmWriteToSwapPage\n");
+
+    if (SwapEntry == 0)
+    {
+        KeBugCheck(MEMORY_MANAGEMENT);
+        return(STATUS_UNSUCCESSFUL);
+    }
+
+    i = FILE_FROM_ENTRY(SwapEntry);
+    offset = OFFSET_FROM_ENTRY(SwapEntry) - 1;
+
+    /* An older copy still queued for this slot must not overwrite this one */
+    KeAcquireGuardedMutex(&MiSwapClusterLock);
+    Queued = (MiFindSwapCluster(i, offset, NULL) != NULL);
+    KeReleaseGuardedMutex(&MiSwapClusterLock);
+    if (Queued)
+    {
+        Status = MmFlushSwapPages();
+        if (!NT_SUCCESS(Status))
+        {
+            return Status;
+        }
+    }
+
+    Status = MiStartPageFileWrite(Mdl, &Page, 1, i, offset, &Event, &Iosb);
+    return MiFinishPageFileWrite(Mdl, Status, &Event, &Iosb);
 }
 
 
@@ -221,6 +633,13 @@ MiReadPageFile(
 
     ASSERT(PageFileIndex < MAX_PAGING_FILES);
 
+    /* The page may not have reached the disk yet */
+    Status = MiReadSwapCluster(Page, PageFileIndex, PageFileOffset);
+    if (Status != STATUS_NOT_FOUND)
+    {
+        return Status;
+    }
+
     PagingFile = MmPagingFile[PageFileIndex];
 
     if (PagingFile->FileObject == NULL || PagingFile->FileObject->DeviceObject == NULL)
@@ -261,6 +680,9 @@ MmInitPagingFile(VOID)
     ULONG i;
 
     KeInitializeGuardedMutex(&MmPageFileCreationLock);
+    KeInitializeGuardedMutex(&MiSwapWriterLock);
+    KeInitializeGuardedMutex(&MiSwapClusterLock);
+    MiGatherCluster = &MiSwapClusters[0];
 
     MiFreeSwapPages = 0;
     MiUsedSwapPages = 0;
@@ -279,28 +701,27 @@ MmFreeSwapPage(SWAPENTRY Entry)
 {
     ULONG i;
     ULONG_PTR off;
-    PMMPAGING_FILE PagingFile;
+    ULONG Index;
+    PMI_SWAP_CLUSTER Cluster;
 
     i = FILE_FROM_ENTRY(Entry);
     off = OFFSET_FROM_ENTRY(Entry) - 1;
 
-    KeAcquireGuardedMutex(&MmPageFileCreationLock);
-
-    PagingFile = MmPagingFile[i];
-    if (PagingFile == NULL)
+    /*
+     * If the page is still queued for writing, the slot must not be handed
+     * out again before that write is done. The cluster releases it then.
+     */
+    KeAcquireGuardedMutex(&MiSwapClusterLock);
+    Cluster = MiFindSwapCluster(i, off, &Index);
+    if (Cluster != NULL)
     {
-        KeBugCheck(MEMORY_MANAGEMENT);
+        Cluster->FreedMask |= 1 << Index;
+        KeReleaseGuardedMutex(&MiSwapClusterLock);
+        return;
     }
+    KeReleaseGuardedMutex(&MiSwapClusterLock);
 
-    RtlClearBit(PagingFile->Bitmap, off >> 5);
-
-    PagingFile->FreeSpace++;
-    PagingFile->CurrentUsage--;
-
-    MiFreeSwapPages++;
-    MiUsedSwapPages--;
-
-    KeReleaseGuardedMutex(&MmPageFileCreationLock);
+    MiReleaseSwapSpace(i, off);
 }
 
 SWAPENTRY
@@ -309,40 +730,77 @@ MmAllocSwapPage(VOID)
 {
     ULONG i;
     ULONG off;
+    ULONG Run;
+    PMMPAGING_FILE PagingFile;
     SWAPENTRY entry;
 
     KeAcquireGuardedMutex(&MmPageFileCreationLock);
 
-    if (MiFreeSwapPages == 0)
+    if (MiSwapRunLeft == 0)
     {
-        KeReleaseGuardedMutex(&MmPageFileCreationLock);
-        return(0);
-    }
+        if (MiFreeSwapPages == 0)
+        {
+            KeReleaseGuardedMutex(&MmPageFileCreationLock);
+            return(0);
+        }
 
-    for (i = 0; i < MAX_PAGING_FILES; i++)
-    {
-        if (MmPagingFile[i] != NULL &&
-                MmPagingFile[i]->FreeSpace >= 1)
+        /*
+         * Reserve a new run, starting the search where the last one ended
+         * instead of at the beginning of the file every time.
+         */
+        for (i = 0; i < MAX_PAGING_FILES; i++)
         {
-            off = RtlFindClearBitsAndSet(MmPagingFile[i]->Bitmap, 1, 0);
+            PagingFile = MmPagingFile[i];
+            if (PagingFile == NULL || PagingFile->FreeSpace < 1)
+            {
+                continue;
+            }
+
+            off = 0xFFFFFFFF;
+            Run = MI_SWAP_CLUSTER_PAGES;
+            if (PagingFile->FreeSpace >= Run)
+            {
+                off = RtlFindClearBitsAndSet(PagingFile->Bitmap, Run, PagingFile->AllocationHint);
+            }
+            if (off == 0xFFFFFFFF)
+            {
+                Run = 1;
+                off = RtlFindClearBitsAndSet(PagingFile->Bitmap, Run, PagingFile->AllocationHint);
+            }
             if (off == 0xFFFFFFFF)
             {
                 KeBugCheck(MEMORY_MANAGEMENT);
                 KeReleaseGuardedMutex(&MmPageFileCreationLock);
                 return(STATUS_UNSUCCESSFUL);
             }
-            MiUsedSwapPages++;
-            MiFreeSwapPages--;
-            KeReleaseGuardedMutex(&MmPageFileCreationLock);
 
-            entry = ENTRY_FROM_FILE_OFFSET(i, off + 1);
-            return(entry);
+            PagingFile->AllocationHint = off + Run;
+            PagingFile->FreeSpace -= Run;
+            PagingFile->CurrentUsage += Run;
+            MiUsedSwapPages += Run;
+            MiFreeSwapPages -= Run;
+
+            MiSwapRunFile = i;
+            MiSwapRunOffset = off;
+            MiSwapRunLeft = Run;
+            break;
+        }
+
+        if (MiSwapRunLeft == 0)
+        {
+            KeReleaseGuardedMutex(&MmPageFileCreationLock);
+            KeBugCheck(MEMORY_MANAGEMENT);
+            return(0);
         }
     }
 
+    entry = ENTRY_FROM_FILE_OFFSET(MiSwapRunFile, MiSwapRunOffset + 1);
+    MiSwapRunOffset++;
+    MiSwapRunLeft--;
+
     KeReleaseGuardedMutex(&MmPageFileCreationLock);
-    KeBugCheck(MEMORY_MANAGEMENT);
-    return(0);
+
+    return(entry);
 }
 
 NTSTATUS NTAPI
@@ -2273,17 +2273,19 @@ MmPageOutSectionView(PMMSUPPORT AddressSpace,
     }
 
     /*
-     * Write the page to the pagefile
+     * Queue the page for writing to the pagefile. It is written together with
+     * the pages paged out next to it and stays readable until it is on disk.
      */
-    Status = MmWriteToSwapPage(SwapEntry, Page);
+    Status = MmQueueSwapPage(SwapEntry, Page);
     if (!NT_SUCCESS(Status))
     {
-        DPRINT1("MM: Failed to write to swap page (Status was 0x%.8X)\n",
+        DPRINT1("MM: Failed to queue swap page (Status was 0x%.8X)\n",
                 Status);
         /*
-         * As above: undo our actions.
-         * FIXME: Also free the swap page.
+         * As above: undo our actions. The page keeps its swap slot, the next
+         * page out writes it there again.
          */
+        MmSetSavedSwapEntryPage(Page, SwapEntry);
         MmLockAddressSpace(AddressSpace);
         if (Context.Private)
         {
@@ -2318,10 +2320,7 @@ MmPageOutSectionView(PMMSUPPORT AddressSpace,
         return(STATUS_UNSUCCESSFUL);
     }
 
-    /*
-     * Otherwise we have succeeded.
-     */
-    DPRINT("MM: Wrote section page 0x%.8X to swap!\n", Page << PAGE_SHIFT);
+    DPRINT("MM: Queued section page 0x%.8X for swap!\n", Page << PAGE_SHIFT);
     MmSetSavedSwapEntryPage(Page, 0);
     if (Context.Segment->Flags & MM_PAGEFILE_SEGMENT ||
             Context.Segment->Image.Characteristics & IMAGE_SCN_MEM_SHARED)
@@ -138,6 +138,7 @@ ObpCreateCacheEntry(IN PSECURITY_DESCRIPTOR SecurityDescriptor,
     /* Setup the header */
     SdHeader->RefCount = RefCount;
     SdHeader->FullHash = FullHash;
+    SdHeader->AccessCache = NULL;
     
     /* Copy the descriptor */
     RtlCopyMemory(&SdHeader->SecurityDescriptor, SecurityDescriptor, Length);
@@ -232,6 +233,117 @@ ObpReferenceSecurityDescriptor(IN POBJECT_HEADER ObjectHeader)
     return SecurityDescriptor;
 }
 
+BOOLEAN
+NTAPI
+ObpLookupCachedAccess(IN PSECURITY_DESCRIPTOR SecurityDescriptor,
+                      IN PACCESS_TOKEN Token,
+                      IN POBJECT_TYPE ObjectType,
+                      IN ACCESS_MASK DesiredAccess,
+                      IN ACCESS_MASK PreviouslyGrantedAccess,
+                      OUT PACCESS_MASK GrantedAccess,
+                      OUT PNTSTATUS AccessStatus)
+{
+    PSECURITY_DESCRIPTOR_HEADER SdHeader;
+    POB_SD_CACHE_LIST CacheEntry;
+    POB_SD_ACCESS_CACHE_ENTRY Entry;
+    PTOKEN AccessToken = Token;
+    BOOLEAN Found = FALSE;
+    ULONG i;
+
+    /* Get the header and the cache entry guarding it */
+    SdHeader = ObpGetHeaderForSd(SecurityDescriptor);
+    CacheEntry = &ObsSecurityDescriptorCache[SdHeader->FullHash % SD_CACHE_ENTRIES];
+
+    /* Lock it shared */
+    ObpSdAcquireLockShared(CacheEntry);
+
+    /* Check if this descriptor has any results */
+    if (SdHeader->AccessCache)
+    {
+        /* Loop them */
+        for (i = 0; i < OB_SD_ACCESS_CACHE_ENTRIES; i++)
+        {
+            /* The modified ID changes whenever the token groups or privileges do */
+            Entry = &SdHeader->AccessCache->Entries[i];
+            if ((Entry->ObjectType == ObjectType) &&
+                (Entry->DesiredAccess == DesiredAccess) &&
+                (Entry->PreviouslyGrantedAccess == PreviouslyGrantedAccess) &&
+                (RtlEqualLuid(&Entry->TokenId, &AccessToken->TokenId)) &&
+                (RtlEqualLuid(&Entry->ModifiedId, &AccessToken->ModifiedId)))
+            {
+                /* Return the result of the previous access check */
+                *GrantedAccess = Entry->GrantedAccess;
+                *AccessStatus = Entry->AccessStatus;
+                Found = TRUE;
+                break;
+            }
+        }
+    }
+
+    /* Release the lock */
+    ObpSdReleaseLockShared(CacheEntry);
+    return Found;
+}
+
+VOID
+NTAPI
+ObpCacheAccess(IN PSECURITY_DESCRIPTOR SecurityDescriptor,
+               IN PACCESS_TOKEN Token,
+               IN POBJECT_TYPE ObjectType,
+               IN ACCESS_MASK DesiredAccess,
+               IN ACCESS_MASK PreviouslyGrantedAccess,
+               IN ACCESS_MASK GrantedAccess,
+               IN NTSTATUS AccessStatus)
+{
+    PSECURITY_DESCRIPTOR_HEADER SdHeader;
+    POB_SD_CACHE_LIST CacheEntry;
+    POB_SD_ACCESS_CACHE AccessCache, NewCache = NULL;
+    POB_SD_ACCESS_CACHE_ENTRY Entry;
+    PTOKEN AccessToken = Token;
+
+    /* Get the header and the cache entry guarding it */
+    SdHeader = ObpGetHeaderForSd(SecurityDescriptor);
+    CacheEntry = &ObsSecurityDescriptorCache[SdHeader->FullHash % SD_CACHE_ENTRIES];
+
+    /* Allocate the result array outside of the lock if we don't have one yet */
+    if (!SdHeader->AccessCache)
+    {
+        NewCache = ExAllocatePoolWithTag(PagedPool,
+                                         sizeof(OB_SD_ACCESS_CACHE),
+                                         TAG_OB_SD_CACHE);
+        if (!NewCache) return;
+        RtlZeroMemory(NewCache, sizeof(OB_SD_ACCESS_CACHE));
+    }
+
+    /* Lock it exclusive */
+    ObpSdAcquireLock(CacheEntry);
+
+    /* Someone else may have set up the array in the meantime */
+    if (!SdHeader->AccessCache)
+    {
+        SdHeader->AccessCache = NewCache;
+        NewCache = NULL;
+    }
+
+    /* Replace the oldest result */
+    AccessCache = SdHeader->AccessCache;
+    Entry = &AccessCache->Entries[AccessCache->NextEntry];
+    AccessCache->NextEntry = (AccessCache->NextEntry + 1) % OB_SD_ACCESS_CACHE_ENTRIES;
+
+    /* Fill it out */
+    Entry->TokenId = AccessToken->TokenId;
+    Entry->ModifiedId = AccessToken->ModifiedId;
+    Entry->ObjectType = ObjectType;
+    Entry->DesiredAccess = DesiredAccess;
+    Entry->PreviouslyGrantedAccess = PreviouslyGrantedAccess;
+    Entry->GrantedAccess = GrantedAccess;
+    Entry->AccessStatus = AccessStatus;
+
+    /* Release the lock and free the array if we didn't need it */
+    ObpSdReleaseLock(CacheEntry);
+    if (NewCache) ExFreePoolWithTag(NewCache, TAG_OB_SD_CACHE);
+}
+
 /* PUBLIC FUNCTIONS ***********************************************************/
 
 /*++
@@ -328,7 +440,8 @@ ObDereferenceSecurityDescriptor(IN PSECURITY_DESCRIPTOR SecurityDescriptor,
         /* Release the lock */
         ObpSdReleaseLock(CacheEntry);
         
-        /* Free the header */
+        /* Free the access check results and the header */
+        if (SdHeader->AccessCache) ExFreePoolWithTag(SdHeader->AccessCache, TAG_OB_SD_CACHE);
         ExFreePool(SdHeader);
     }
     else
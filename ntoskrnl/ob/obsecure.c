@@ -198,6 +198,80 @@ ObSetSecurityDescriptorInfo(IN PVOID Object,
     return Status;
 }
 
+static
+BOOLEAN
+ObpAccessCheck(IN PSECURITY_DESCRIPTOR SecurityDescriptor,
+               IN BOOLEAN SdAllocated,
+               IN PACCESS_STATE AccessState,
+               IN ACCESS_MASK DesiredAccess,
+               IN ACCESS_MASK PreviouslyGrantedAccess,
+               IN POBJECT_TYPE ObjectType,
+               IN KPROCESSOR_MODE AccessMode,
+               OUT PACCESS_MASK GrantedAccess,
+               OUT PNTSTATUS AccessStatus)
+{
+    PSECURITY_SUBJECT_CONTEXT SubjectContext = &AccessState->SubjectSecurityContext;
+    PPRIVILEGE_SET Privileges = NULL;
+    PACCESS_TOKEN Token;
+    BOOLEAN Cacheable, Result;
+    PAGED_CODE();
+
+    /*
+     * Only descriptors from the SD cache keep their results, and only for
+     * checks that depend on nothing but the token, which the caller locked.
+     */
+    Token = SeQuerySubjectContextToken(SubjectContext);
+    Cacheable = (SecurityDescriptor) &&
+                !(SdAllocated) &&
+                (AccessMode != KernelMode) &&
+                (!(SubjectContext->ClientToken) ||
+                 (SubjectContext->ImpersonationLevel >= SecurityImpersonation));
+
+    /* Check if this token already went through this descriptor */
+    if ((Cacheable) &&
+        (ObpLookupCachedAccess(SecurityDescriptor,
+                               Token,
+                               ObjectType,
+                               DesiredAccess,
+                               PreviouslyGrantedAccess,
+                               GrantedAccess,
+                               AccessStatus)))
+    {
+        return NT_SUCCESS(*AccessStatus);
+    }
+
+    /* Now do the entire access check */
+    Result = SeAccessCheck(SecurityDescriptor,
+                           SubjectContext,
+                           TRUE,
+                           DesiredAccess,
+                           PreviouslyGrantedAccess,
+                           &Privileges,
+                           &ObjectType->TypeInfo.GenericMapping,
+                           AccessMode,
+                           GrantedAccess,
+                           AccessStatus);
+    if (Privileges)
+    {
+        /* We got privileges, append them to the access state and free them */
+        SeAppendPrivileges(AccessState, Privileges);
+        SeFreePrivileges(Privileges);
+    }
+    else if (Cacheable)
+    {
+        /* Remember the result for the next open */
+        ObpCacheAccess(SecurityDescriptor,
+                       Token,
+                       ObjectType,
+                       DesiredAccess,
+                       PreviouslyGrantedAccess,
+                       *GrantedAccess,
+                       *AccessStatus);
+    }
+
+    return Result;
+}
+
 BOOLEAN
 NTAPI
 ObCheckCreateObjectAccess(IN PVOID Object,
@@ -214,7 +288,6 @@ ObCheckCreateObjectAccess(IN PVOID Object,
     BOOLEAN SdAllocated;
     BOOLEAN Result = TRUE;
     ACCESS_MASK GrantedAccess = 0;
-    PPRIVILEGE_SET Privileges = NULL;
     NTSTATUS Status;
     PAGED_CODE();
 
@@ -238,22 +311,15 @@ ObCheckCreateObjectAccess(IN PVOID Object,
     if (SecurityDescriptor)
     {
         /* Now do the entire access check */
-        Result = SeAccessCheck(SecurityDescriptor,
-                               &AccessState->SubjectSecurityContext,
-                               TRUE,
-                               CreateAccess,
-                               0,
-                               &Privileges,
-                               &ObjectType->TypeInfo.GenericMapping,
-                               AccessMode,
-                               &GrantedAccess,
-                               AccessStatus);
-        if (Privileges)
-        {
-            /* We got privileges, append them to the access state and free them */
-            Status = SeAppendPrivileges(AccessState, Privileges);
-            SeFreePrivileges(Privileges);
-        }
+        Result = ObpAccessCheck(SecurityDescriptor,
+                                SdAllocated,
+                                AccessState,
+                                CreateAccess,
+                                0,
+                                ObjectType,
+                                AccessMode,
+                                &GrantedAccess,
+                                AccessStatus);
     }
 
     /* We're done, unlock the context and release security */
@@ -277,7 +343,6 @@ ObpCheckTraverseAccess(IN PVOID Object,
     BOOLEAN SdAllocated;
     BOOLEAN Result;
     ACCESS_MASK GrantedAccess = 0;
-    PPRIVILEGE_SET Privileges = NULL;
     NTSTATUS Status;
     PAGED_CODE();
 
@@ -312,22 +377,15 @@ ObpCheckTraverseAccess(IN PVOID Object,
     SeLockSubjectContext(&AccessState->SubjectSecurityContext);
 
     /* Now do the entire access check */
-    Result = SeAccessCheck(SecurityDescriptor,
-                           &AccessState->SubjectSecurityContext,
-                           TRUE,
-                           TraverseAccess,
-                           0,
-                           &Privileges,
-                           &ObjectType->TypeInfo.GenericMapping,
-                           AccessMode,
-                           &GrantedAccess,
-                           AccessStatus);
-    if (Privileges)
-    {
-        /* We got privileges, append them to the access state and free them */
-        Status = SeAppendPrivileges(AccessState, Privileges);
-        SeFreePrivileges(Privileges);
-    }
+    Result = ObpAccessCheck(SecurityDescriptor,
+                            SdAllocated,
+                            AccessState,
+                            TraverseAccess,
+                            0,
+                            ObjectType,
+                            AccessMode,
+                            &GrantedAccess,
+                            AccessStatus);
 
     /* We're done, unlock the context and release security */
     SeUnlockSubjectContext(&AccessState->SubjectSecurityContext);
@@ -349,7 +407,6 @@ ObpCheckObjectReference(IN PVOID Object,
     BOOLEAN SdAllocated;
     BOOLEAN Result;
     ACCESS_MASK GrantedAccess = 0;
-    PPRIVILEGE_SET Privileges = NULL;
     NTSTATUS Status;
     PAGED_CODE();
 
@@ -370,16 +427,15 @@ ObpCheckObjectReference(IN PVOID Object,
     SeLockSubjectContext(&AccessState->SubjectSecurityContext);
 
     /* Now do the entire access check */
-    Result = SeAccessCheck(SecurityDescriptor,
-                           &AccessState->SubjectSecurityContext,
-                           TRUE,
-                           AccessState->RemainingDesiredAccess,
-                           AccessState->PreviouslyGrantedAccess,
-                           &Privileges,
-                           &ObjectType->TypeInfo.GenericMapping,
-                           AccessMode,
-                           &GrantedAccess,
-                           AccessStatus);
+    Result = ObpAccessCheck(SecurityDescriptor,
+                            SdAllocated,
+                            AccessState,
+                            AccessState->RemainingDesiredAccess,
+                            AccessState->PreviouslyGrantedAccess,
+                            ObjectType,
+                            AccessMode,
+                            &GrantedAccess,
+                            AccessStatus);
     if (Result)
     {
         /* Update the access state */
@@ -451,7 +507,6 @@ ObCheckObjectAccess(IN PVOID Object,
     NTSTATUS Status;
     BOOLEAN Result;
     ACCESS_MASK GrantedAccess;
-    PPRIVILEGE_SET Privileges = NULL;
     PAGED_CODE();
 
     /* Get the object header and type */
@@ -477,22 +532,15 @@ ObCheckObjectAccess(IN PVOID Object,
     SeLockSubjectContext(&AccessState->SubjectSecurityContext);
 
     /* Now do the entire access check */
-    Result = SeAccessCheck(SecurityDescriptor,
-                           &AccessState->SubjectSecurityContext,
-                           TRUE,
-                           AccessState->RemainingDesiredAccess,
-                           AccessState->PreviouslyGrantedAccess,
-                           &Privileges,
-                           &ObjectType->TypeInfo.GenericMapping,
-                           AccessMode,
-                           &GrantedAccess,
-                           ReturnedStatus);
-    if (Privileges)
-    {
-        /* We got privileges, append them to the access state and free them */
-        Status = SeAppendPrivileges(AccessState, Privileges);
-        SeFreePrivileges(Privileges);
-    }
+    Result = ObpAccessCheck(SecurityDescriptor,
+                            SdAllocated,
+                            AccessState,
+                            AccessState->RemainingDesiredAccess,
+                            AccessState->PreviouslyGrantedAccess,
+                            ObjectType,
+                            AccessMode,
+                            &GrantedAccess,
+                            ReturnedStatus);
 
     /* Check if access was granted */
     if (Result)
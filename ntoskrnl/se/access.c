@@ -32,7 +32,8 @@ SepSidInTokenEx(IN PACCESS_TOKEN _Token,
     PTOKEN Token = (PTOKEN)_Token;
     PISID TokenSid, Sid = (PISID)_Sid;
     PSID_AND_ATTRIBUTES SidAndAttributes;
-    ULONG SidCount, SidLength;
+    PSEP_SID_INDEX SidIndex;
+    ULONG SidCount, SidLength, Slot;
     USHORT SidMetadata;
     PAGED_CODE();
 
@@ -66,6 +67,33 @@ SepSidInTokenEx(IN PACCESS_TOKEN _Token,
                              SubAuthority[Sid->SubAuthorityCount]);
     SidMetadata = *(PUSHORT)&Sid->Revision;
 
+    /* Check if we can look the SID up in the token's SID index */
+    SidIndex = Token->SidIndex;
+    if (!(Restricted) && (SidIndex))
+    {
+        /* Probe from the hash slot until we find the SID or an empty slot */
+        Slot = SepHashSid(Sid) & SidIndex->Mask;
+        while (SidIndex->Slot[Slot])
+        {
+            i = SidIndex->Slot[Slot] - 1;
+            TokenSid = (PISID)SidAndAttributes[i].Sid;
+
+            /* Check if the SID metadata and data match */
+            if ((*(PUSHORT)&TokenSid->Revision == SidMetadata) &&
+                (RtlEqualMemory(Sid, TokenSid, SidLength)))
+            {
+                SidAndAttributes += i;
+                goto Found;
+            }
+
+            /* Move to the next slot */
+            Slot = (Slot + 1) & SidIndex->Mask;
+        }
+
+        /* SID is not present */
+        return FALSE;
+    }
+
     /* Loop every SID */
     for (i = 0; i < SidCount; i++)
     {
@@ -82,19 +110,7 @@ SepSidInTokenEx(IN PACCESS_TOKEN _Token,
             /* Check if the SID data matches */
             if (RtlEqualMemory(Sid, TokenSid, SidLength))
             {
-                /* Check if the group is enabled, or used for deny only */
-                if ((!(i) && !(SidAndAttributes->Attributes & SE_GROUP_USE_FOR_DENY_ONLY)) ||
-                    (SidAndAttributes->Attributes & SE_GROUP_ENABLED) ||
-                    ((Deny) && (SidAndAttributes->Attributes & SE_GROUP_USE_FOR_DENY_ONLY)))
-                {
-                    /* SID is present */
-                    return TRUE;
-                }
-                else
-                {
-                    /* SID is not present */
-                    return FALSE;
-                }
+                goto Found;
             }
         }
 
@@ -102,6 +118,19 @@ SepSidInTokenEx(IN PACCESS_TOKEN _Token,
         SidAndAttributes++;
     }
 
+    /* SID is not present */
+    return FALSE;
+
+Found:
+    /* Check if the group is enabled, or used for deny only */
+    if ((!(i) && !(SidAndAttributes->Attributes & SE_GROUP_USE_FOR_DENY_ONLY)) ||
+        (SidAndAttributes->Attributes & SE_GROUP_ENABLED) ||
+        ((Deny) && (SidAndAttributes->Attributes & SE_GROUP_USE_FOR_DENY_ONLY)))
+    {
+        /* SID is present */
+        return TRUE;
+    }
+
     /* SID is not present */
     return FALSE;
 }
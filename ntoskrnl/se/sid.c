@@ -353,6 +353,24 @@ SepReleaseSid(IN PSID CapturedSid,
     }
 }
 
+ULONG
+NTAPI
+SepHashSid(IN PSID _Sid)
+{
+    PISID Sid = (PISID)_Sid;
+    ULONG Hash, i;
+
+    /* Groups of the same domain only differ in their last sub-authorities */
+    Hash = Sid->IdentifierAuthority.Value[5];
+    for (i = 0; i < Sid->SubAuthorityCount; i++)
+    {
+        Hash = Hash * 31 + Sid->SubAuthority[i];
+    }
+
+    /* Fold the high bits in, the caller masks the low ones */
+    return Hash ^ (Hash >> 16);
+}
+
 NTSTATUS
 NTAPI
 SeCaptureSidAndAttributesArray(
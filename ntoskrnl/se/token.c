@@ -436,6 +436,55 @@ SepFindPrimaryGroupAndDefaultOwner(
 }
 
 
+static
+VOID
+SepBuildSidIndex(
+    _Inout_ PTOKEN Token)
+{
+    PSEP_SID_INDEX SidIndex;
+    ULONG SlotCount, Slot, i;
+
+    /* A few SIDs are quicker to scan than to hash */
+    if (Token->UserAndGroupCount < SEP_SID_INDEX_THRESHOLD)
+        return;
+
+    /* Keep the table at most half full */
+    SlotCount = SEP_SID_INDEX_THRESHOLD * 2;
+    while (SlotCount < Token->UserAndGroupCount * 2)
+        SlotCount <<= 1;
+
+    /* Without an index SepSidInTokenEx just scans the groups */
+    SidIndex = ExAllocatePoolWithTag(PagedPool,
+                                     FIELD_OFFSET(SEP_SID_INDEX, Slot) +
+                                     SlotCount * sizeof(ULONG),
+                                     TAG_TOKEN_SID_INDEX);
+    if (SidIndex == NULL)
+        return;
+
+    SidIndex->Mask = SlotCount - 1;
+    RtlZeroMemory(SidIndex->Slot, SlotCount * sizeof(ULONG));
+
+    /* Slots hold the group index plus one; the first copy of a SID wins */
+    for (i = 0; i < Token->UserAndGroupCount; i++)
+    {
+        Slot = SepHashSid(Token->UserAndGroups[i].Sid) & SidIndex->Mask;
+        while (SidIndex->Slot[Slot] != 0)
+        {
+            if (RtlEqualSid(Token->UserAndGroups[SidIndex->Slot[Slot] - 1].Sid,
+                            Token->UserAndGroups[i].Sid))
+            {
+                break;
+            }
+            Slot = (Slot + 1) & SidIndex->Mask;
+        }
+
+        if (SidIndex->Slot[Slot] == 0)
+            SidIndex->Slot[Slot] = i + 1;
+    }
+
+    Token->SidIndex = SidIndex;
+}
+
 NTSTATUS
 NTAPI
 SepDuplicateToken(
@@ -587,6 +636,9 @@ SepDuplicateToken(
 #endif
     AccessToken->DefaultOwnerIndex = Token->DefaultOwnerIndex;
 
+    /* Index the user and groups for the access checks */
+    SepBuildSidIndex(AccessToken);
+
     /* Copy the restricted SIDs */
     AccessToken->RestrictedSidCount = 0;
     AccessToken->RestrictedSids = NULL;
@@ -827,6 +879,10 @@ SepDeleteToken(PVOID ObjectBody)
     /* Delete the dynamic information area */
     if (AccessToken->DynamicPart)
         ExFreePoolWithTag(AccessToken->DynamicPart, TAG_TOKEN_DYNAMIC);
+
+    /* Delete the SID index */
+    if (AccessToken->SidIndex)
+        ExFreePoolWithTag(AccessToken->SidIndex, TAG_TOKEN_SID_INDEX);
 }
 
 
@@ -1088,6 +1144,9 @@ SepCreateToken(
     AccessToken->PrimaryGroup = AccessToken->UserAndGroups[PrimaryGroupIndex].Sid;
     AccessToken->DefaultOwnerIndex = DefaultOwnerIndex;
 
+    /* Index the user and groups for the access checks */
+    SepBuildSidIndex(AccessToken);
+
     /* Now allocate the TOKEN's dynamic information area and set the data */
     AccessToken->DynamicAvailable = 0; // Unused memory in the dynamic area.
     AccessToken->DynamicPart = NULL;
@@ -179,7 +179,8 @@ typedef struct _TOKEN
     PVOID ProxyData;                                  /* 0x90 */
     PVOID AuditData;                                  /* 0x94 */
     LUID OriginatingLogonSession;                     /* 0x98 */
-    ULONG VariablePart;                               /* 0xA0 */
+    struct _SEP_SID_INDEX *SidIndex;                  /* 0xA0 */
+    ULONG VariablePart;                               /* 0xA4 */
 } TOKEN, *PTOKEN;
 
 typedef struct _AUX_ACCESS_DATA
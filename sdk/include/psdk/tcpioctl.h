@@ -57,6 +57,8 @@
 /* Non public TOIID used to query modules info */
 #ifdef __REACTOS__
 #define IP_SPECIFIC_MODULE_ENTRY_ID     0x110
+/* Non public TOIID used to query the neighbor cache counters */
+#define IP_NEIGHBOR_CACHE_STATS_ID      0x111
 #endif
 #define MAX_PHYSADDR_SIZE               8
 
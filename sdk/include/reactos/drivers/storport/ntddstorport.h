@@ -0,0 +1,30 @@
+/*
+ * PROJECT:     ReactOS Storport Driver
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Storport private IOCTL definitions
+ */
+
+#ifndef _NTDDSTORPORT_H_INCLUDED_
+#define _NTDDSTORPORT_H_INCLUDED_
+
+/* Returns the PORT_LUN_STATISTICS of a logical unit. Sent to the disk,
+   the class driver passes it down to the storport PDO. */
+#define IOCTL_STORPORT_QUERY_LUN_STATISTICS \
+            CTL_CODE(FILE_DEVICE_MASS_STORAGE, 0x800, METHOD_BUFFERED, FILE_ANY_ACCESS)
+
+/* TYPEDEFS **************************************************************/
+
+typedef struct _PORT_LUN_STATISTICS
+{
+    ULONGLONG ReadRequests;
+    ULONGLONG WriteRequests;
+    ULONGLONG BytesRead;
+    ULONGLONG BytesWritten;
+    ULONGLONG OverlappedRequests;   /* Started while others were still in flight */
+    ULONGLONG FailedRequests;
+    ULONGLONG TotalLatency;         /* 100ns units, from dispatch to completion */
+    ULONG MaximumOutstanding;
+    ULONG MaximumQueued;
+} PORT_LUN_STATISTICS, *PPORT_LUN_STATISTICS;
+
+#endif /* _NTDDSTORPORT_H_INCLUDED_ */
@@ -30,6 +30,18 @@ typedef struct _ROSSYM_ENTRY {
   ULONG SourceLine;
 } ROSSYM_ENTRY, *PROSSYM_ENTRY;
 
+/* Optional, between the header and the symbols. FirstEntry[i] is the index
+   of the first symbol at or above (i << Shift), FirstEntry[BucketCount] is
+   the number of symbols. */
+#define ROSSYM_INDEX_MAGIC 0x58444952 /* RIDX */
+
+typedef struct _ROSSYM_INDEX {
+  ULONG Magic;
+  ULONG Shift;
+  ULONG BucketCount;
+  ULONG FirstEntry[1];
+} ROSSYM_INDEX, *PROSSYM_INDEX;
+
 enum _ROSSYM_REGNAME {
     ROSSYM_X86_EAX = 0,
     ROSSYM_X86_ECX,
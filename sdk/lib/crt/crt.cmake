@@ -114,7 +114,6 @@ list(APPEND CRT_SOURCE
     mbstring/mbstok.c
     mbstring/mbstrlen.c
     mbstring/mbsupr.c
-    mem/memcmp.c
     mem/memccpy.c
     mem/memicmp.c
     misc/__crt_MessageBoxA.c
@@ -239,6 +238,7 @@ list(APPEND CRT_SOURCE
     stdlib/errno.c
     stdlib/fcvt.c
     stdlib/fcvtbuf.c
+    stdlib/fpconv.c
     stdlib/fullpath.c
     stdlib/gcvt.c
     stdlib/getenv.c
@@ -435,7 +435,8 @@ if(ARCH STREQUAL "i386")
         math/i386/cipow.c
         math/i386/cisin.c
         math/i386/cisqrt.c
-        math/i386/ldexp.c)
+        math/i386/ldexp.c
+        mem/memcmp.c)
     list(APPEND CRT_WINE_SOURCE
         wine/except_i386.c)
     if(MSVC)
@@ -564,30 +565,45 @@ if(NOT ARCH STREQUAL "i386")
         math/tanf.c
         math/tanhf.c
         math/stubs.c
-        mem/memchr.c
-        mem/memcpy.c
-        mem/memmove.c
         mem/memset.c
         string/strcat.c
-        string/strchr.c
-        string/strcmp.c
         string/strcpy.c
-        string/strlen.c
         string/strncat.c
         string/strncmp.c
         string/strncpy.c
         string/strnlen.c
         string/strrchr.c
         string/wcscat.c
-        string/wcschr.c
-        string/wcscmp.c
         string/wcscpy.c
-        string/wcslen.c
         string/wcsncat.c
         string/wcsncmp.c
         string/wcsncpy.c
         string/wcsnlen.c
         string/wcsrchr.c)
+    if(ARCH STREQUAL "amd64")
+        list(APPEND CRT_ASM_SOURCE
+            mem/amd64/memchr_asm.s
+            mem/amd64/memcmp_asm.s
+            mem/amd64/memmove_asm.s
+            string/amd64/strchr_asm.s
+            string/amd64/strcmp_asm.s
+            string/amd64/strlen_asm.s
+            string/amd64/wcschr_asm.s
+            string/amd64/wcscmp_asm.s
+            string/amd64/wcslen_asm.s)
+    else()
+        list(APPEND CRT_SOURCE
+            mem/memchr.c
+            mem/memcmp.c
+            mem/memcpy.c
+            mem/memmove.c
+            string/strchr.c
+            string/strcmp.c
+            string/strlen.c
+            string/wcschr.c
+            string/wcscmp.c
+            string/wcslen.c)
+    endif()
 endif()
 
 # includes for wine code
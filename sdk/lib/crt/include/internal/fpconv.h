@@ -0,0 +1,32 @@
+#ifndef __CRT_INTERNAL_FPCONV_H
+#define __CRT_INTERNAL_FPCONV_H
+
+/* Rounding modes for __crt_dtoa */
+#define FPCONV_SIGNIFICANT  0   /* ndigits significant digits, as for %e */
+#define FPCONV_FIXED        1   /* ndigits digits after the point, as for %f */
+
+/* The exact decimal expansion of a double has at most 767 significant
+   digits (the smallest subnormal); buffers for __crt_dtoa hold that plus
+   the leading zeros of the top group */
+#define FPCONV_MAX_DIGITS   768
+#define FPCONV_BUFFER_SIZE  (FPCONV_MAX_DIGITS + 16)
+
+/* Enough for the exact comparisons done by strtod */
+#define FPCONV_BIGNUM_LIMBS 130
+
+typedef struct _FPCONV_BIGNUM
+{
+    unsigned int Length;
+    unsigned int Limb[FPCONV_BIGNUM_LIMBS];
+} FPCONV_BIGNUM;
+
+void __crt_bignum_set(FPCONV_BIGNUM *b, unsigned __int64 value);
+void __crt_bignum_muladd(FPCONV_BIGNUM *b, unsigned int factor, unsigned int addend);
+void __crt_bignum_mulpow5(FPCONV_BIGNUM *b, unsigned int exp5);
+void __crt_bignum_shl(FPCONV_BIGNUM *b, unsigned int shift);
+int __crt_bignum_compare(const FPCONV_BIGNUM *a, const FPCONV_BIGNUM *b);
+
+int __crt_dtoa(double value, int mode, int ndigits, char *digits, int *decpt);
+int __crt_format_double(char *buffer, int size, double value, int chr, int precision, int alternate);
+
+#endif
@@ -7,7 +7,6 @@ list(APPEND LIBCNTPR_SOURCE
     math/rand_nt.c
     mbstring/mbstrlen.c
     mem/memccpy.c
-    mem/memcmp.c
     mem/memicmp.c
     misc/fltused.c
     printf/_snprintf.c
@@ -25,6 +24,7 @@ list(APPEND LIBCNTPR_SOURCE
     printf/wstreamout.c
     search/bsearch.c
     search/lfind.c
+    stdlib/fpconv.c
     stdlib/qsort.c
     string/_splitpath.c
     string/_wsplitpath.c
@@ -106,7 +106,8 @@ if(ARCH STREQUAL "i386")
         math/i386/cipow.c
         math/i386/cisin.c
         math/i386/cisqrt.c
-        math/i386/ldexp.c)
+        math/i386/ldexp.c
+        mem/memcmp.c)
     if(NOT MSVC)
         list(APPEND LIBCNTPR_SOURCE except/i386/chkstk_ms.s)
     endif()
@@ -211,30 +212,45 @@ else()
         math/cos.c
         math/sin.c
         math/sqrt.c
-        mem/memchr.c
-        mem/memcpy.c
-        mem/memmove.c
         mem/memset.c
         string/strcat.c
-        string/strchr.c
-        string/strcmp.c
         string/strcpy.c
-        string/strlen.c
         string/strncat.c
         string/strncmp.c
         string/strncpy.c
         string/strnlen.c
         string/strrchr.c
         string/wcscat.c
-        string/wcschr.c
-        string/wcscmp.c
         string/wcscpy.c
-        string/wcslen.c
         string/wcsncat.c
         string/wcsncmp.c
         string/wcsncpy.c
         string/wcsnlen.c
         string/wcsrchr.c)
+    if(ARCH STREQUAL "amd64")
+        list(APPEND LIBCNTPR_ASM_SOURCE
+            mem/amd64/memchr_asm.s
+            mem/amd64/memcmp_asm.s
+            mem/amd64/memmove_asm.s
+            string/amd64/strchr_asm.s
+            string/amd64/strcmp_asm.s
+            string/amd64/strlen_asm.s
+            string/amd64/wcschr_asm.s
+            string/amd64/wcscmp_asm.s
+            string/amd64/wcslen_asm.s)
+    else()
+        list(APPEND LIBCNTPR_SOURCE
+            mem/memchr.c
+            mem/memcmp.c
+            mem/memcpy.c
+            mem/memmove.c
+            string/strchr.c
+            string/strcmp.c
+            string/strlen.c
+            string/wcschr.c
+            string/wcscmp.c
+            string/wcslen.c)
+    endif()
 endif()
 
 set_source_files_properties(${LIBCNTPR_ASM_SOURCE} PROPERTIES COMPILE_DEFINITIONS "NO_RTL_INLINES;_NTSYSTEM_;_NTDLLBUILD_;_LIBCNT_;__CRT__NO_INLINE;CRTDLL")
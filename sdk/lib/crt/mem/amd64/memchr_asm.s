@@ -0,0 +1,62 @@
+/*
+ * void *memchr(const void *s <rcx>, int c <edx>, size_t n <r8>)
+ *
+ */
+
+#include <asm.inc>
+
+PUBLIC memchr
+.code64
+
+FUNC memchr
+    .ENDPROLOG
+
+    /* Broadcast the byte to all 16 lanes */
+    movzx edx, dl
+    movd xmm1, edx
+    punpcklbw xmm1, xmm1
+    pshuflw xmm1, xmm1, 0
+    punpcklqdq xmm1, xmm1
+
+    /* The buffer is readable up to n, so unaligned loads are fine */
+    cmp r8, 16
+    jb .Ltail
+
+.Lloop:
+    movdqu xmm0, [rcx]
+    pcmpeqb xmm0, xmm1
+    pmovmskb eax, xmm0
+    test eax, eax
+    jnz .Lfound
+    add rcx, 16
+    sub r8, 16
+    cmp r8, 16
+    jae .Lloop
+
+.Ltail:
+    test r8, r8
+    jz .Lnotfound
+
+.Ltail_loop:
+    cmp [rcx], dl
+    je .Ltail_found
+    inc rcx
+    dec r8
+    jnz .Ltail_loop
+
+.Lnotfound:
+    xor eax, eax
+    ret
+
+.Lfound:
+    bsf eax, eax
+    add rax, rcx
+    ret
+
+.Ltail_found:
+    mov rax, rcx
+    ret
+ENDFUNC
+
+END
+/* EOF */
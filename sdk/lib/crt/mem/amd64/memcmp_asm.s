@@ -0,0 +1,62 @@
+/*
+ * int memcmp(const void *s1 <rcx>, const void *s2 <rdx>, size_t n <r8>)
+ *
+ */
+
+#include <asm.inc>
+
+PUBLIC memcmp
+.code64
+
+FUNC memcmp
+    .ENDPROLOG
+
+    /* Address s2 relative to s1, so only one pointer has to move */
+    sub rdx, rcx
+    cmp r8, 16
+    jb .Ltail
+
+.Lloop:
+    movdqu xmm0, [rcx]
+    movdqu xmm1, [rcx + rdx]
+    pcmpeqb xmm0, xmm1
+    pmovmskb eax, xmm0
+    xor eax, HEX(0FFFF)
+    jnz .Lfound
+    add rcx, 16
+    sub r8, 16
+    cmp r8, 16
+    jae .Lloop
+
+.Ltail:
+    test r8, r8
+    jz .Lequal
+
+.Ltail_loop:
+    movzx eax, byte ptr [rcx]
+    movzx r9d, byte ptr [rcx + rdx]
+    sub eax, r9d
+    jnz .Ldone
+    inc rcx
+    dec r8
+    jnz .Ltail_loop
+
+.Lequal:
+    xor eax, eax
+
+.Ldone:
+    ret
+
+.Lfound:
+    /* Return the difference of the first mismatching bytes, like the
+       portable version does */
+    bsf eax, eax
+    add rcx, rax
+    movzx eax, byte ptr [rcx]
+    movzx r9d, byte ptr [rcx + rdx]
+    sub eax, r9d
+    ret
+ENDFUNC
+
+END
+/* EOF */
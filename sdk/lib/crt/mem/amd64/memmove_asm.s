@@ -0,0 +1,138 @@
+/*
+ * void *memcpy (void *to <rcx>, const void *from <rdx>, size_t count <r8>)
+ *
+ */
+
+#include <asm.inc>
+
+/* Copies at least this large bypass the cache when the buffers do not
+   overlap, so a big copy doesn't flush everything else out of it */
+#define STREAMING_THRESHOLD HEX(100000)
+
+PUBLIC memcpy
+PUBLIC memmove
+.code64
+
+memcpy:
+FUNC memmove
+    .ENDPROLOG
+
+    mov rax, rcx
+
+    /* If (to - from) >= count, a forward copy never reads a byte it has
+       already written. This also covers to < from. */
+    mov r9, rcx
+    sub r9, rdx
+    cmp r9, r8
+    jb .CopyDown
+
+    cmp r8, 16
+    jb .CopyUpTail
+    cmp r8, STREAMING_THRESHOLD
+    jb .CopyUp64
+
+    /* Streaming needs the source to be disjoint as well */
+    mov r9, rdx
+    sub r9, rcx
+    cmp r9, r8
+    jb .CopyUp64
+
+    /* Copy the unaligned head, then continue from the next 16 byte
+       boundary of the destination */
+    movdqu xmm0, [rdx]
+    movdqu [rcx], xmm0
+    mov r9, rcx
+    neg r9
+    and r9, 15
+    add rcx, r9
+    add rdx, r9
+    sub r8, r9
+
+.CopyUpStream:
+    movdqu xmm0, [rdx]
+    movdqu xmm1, [rdx + 16]
+    movdqu xmm2, [rdx + 32]
+    movdqu xmm3, [rdx + 48]
+    movntdq [rcx], xmm0
+    movntdq [rcx + 16], xmm1
+    movntdq [rcx + 32], xmm2
+    movntdq [rcx + 48], xmm3
+    add rdx, 64
+    add rcx, 64
+    sub r8, 64
+    cmp r8, 64
+    jae .CopyUpStream
+    sfence
+    jmp .CopyUp16
+
+    /* All 4 blocks are loaded before any is stored. With to below from,
+       the stores stay behind the next loads. */
+.CopyUp64:
+    cmp r8, 64
+    jb .CopyUp16
+    movdqu xmm0, [rdx]
+    movdqu xmm1, [rdx + 16]
+    movdqu xmm2, [rdx + 32]
+    movdqu xmm3, [rdx + 48]
+    movdqu [rcx], xmm0
+    movdqu [rcx + 16], xmm1
+    movdqu [rcx + 32], xmm2
+    movdqu [rcx + 48], xmm3
+    add rdx, 64
+    add rcx, 64
+    sub r8, 64
+    jmp .CopyUp64
+
+.CopyUp16:
+    cmp r8, 16
+    jb .CopyUpTail
+    movdqu xmm0, [rdx]
+    movdqu [rcx], xmm0
+    add rdx, 16
+    add rcx, 16
+    sub r8, 16
+    jmp .CopyUp16
+
+.CopyUpTail:
+    test r8, r8
+    jz .Done
+.CopyUpByte:
+    movzx r9d, byte ptr [rdx]
+    mov [rcx], r9b
+    inc rdx
+    inc rcx
+    dec r8
+    jnz .CopyUpByte
+    ret
+
+    /* Overlapping with to above from: copy from the end */
+.CopyDown:
+    add rcx, r8
+    add rdx, r8
+.CopyDown16:
+    cmp r8, 16
+    jb .CopyDownTail
+    sub rdx, 16
+    sub rcx, 16
+    movdqu xmm0, [rdx]
+    movdqu [rcx], xmm0
+    sub r8, 16
+    jmp .CopyDown16
+
+.CopyDownTail:
+    test r8, r8
+    jz .Done
+.CopyDownByte:
+    dec rdx
+    dec rcx
+    movzx r9d, byte ptr [rdx]
+    mov [rcx], r9b
+    dec r8
+    jnz .CopyDownByte
+
+.Done:
+    ret
+ENDFUNC
+
+END
+/* EOF */
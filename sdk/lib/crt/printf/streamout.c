@@ -11,8 +11,7 @@
 #include <stdarg.h>
 #include <tchar.h>
 #include <strings.h>
-#include <math.h>
-#include <float.h>
+#include <internal/fpconv.h>
 
 #ifdef _UNICODE
 # define streamout wstreamout
@@ -20,7 +19,12 @@
 #endif
 
 #define MB_CUR_MAX 10
+#if defined(_USER32_WSPRINTF) || defined(_LIBCNT_)
 #define BUFFER_SIZE (32 + 17)
+#else
+/* Room for %f of DBL_MAX and a precision of a few hundred digits */
+#define BUFFER_SIZE 512
+#endif
 
 int mbtowc(wchar_t *wchar, const char *mbchar, size_t count);
 int wctomb(char *mbchar, wchar_t wchar);
@@ -68,9 +72,6 @@ enum
     (flags & FLAG_LONGDOUBLE) ? va_arg(argptr, long double) : \
     va_arg(argptr, double)
 
-#define get_exp(f) (int)floor(f == 0 ? 0 : (f >= 0 ? log10(f) : log10(-f)))
-#define round(x) floor((x) + 0.5)
-
 #ifndef _USER32_WSPRINTF
 
 void
@@ -87,94 +88,21 @@ format_float(
     const TCHAR **prefix,
     va_list *argptr)
 {
-    static const TCHAR digits_l[] = _T("0123456789abcdef0x");
-    static const TCHAR digits_u[] = _T("0123456789ABCDEF0X");
-    static const TCHAR _nan[] = _T("#QNAN");
-    static const TCHAR _infinity[] = _T("#INF");
-    const TCHAR *digits = digits_l;
-    int exponent = 0, sign;
-    long double fpval, fpval2;
-    int padding = 0, num_digits, val32, base = 10;
-
-    /* Normalize the precision */
-    if (precision < 0) precision = 6;
-    else if (precision > 17)
+    char buffer[BUFFER_SIZE];
+    union
     {
-        padding = precision - 17;
-        precision = 17;
-    }
-
-    /* Get the float value and calculate the exponent */
-    fpval = va_arg_ffp(*argptr, flags);
-    exponent = get_exp(fpval);
-    sign = fpval < 0 ? -1 : 1;
-
-    switch (chr)
-    {
-        case _T('G'):
-            digits = digits_u;
-        case _T('g'):
-            if (precision > 0) precision--;
-            if (exponent < -4 || exponent >= precision) goto case_e;
-
-            /* Shift the decimal point and round */
-            fpval2 = round(sign * fpval * pow(10., precision));
-
-            /* Skip trailing zeroes */
-            while (precision && (unsigned __int64)fpval2 % 10 == 0)
-            {
-                precision--;
-                fpval2 /= 10;
-            }
-            break;
-
-        case _T('E'):
-            digits = digits_u;
-        case _T('e'):
-        case_e:
-            /* Shift the decimal point and round */
-            fpval2 = round(sign * fpval * pow(10., precision - exponent));
-
-            /* Compensate for changed exponent through rounding */
-            if (fpval2 >= (unsigned __int64)pow(10., precision + 1))
-            {
-                exponent++;
-                fpval2 = round(sign * fpval * pow(10., precision - exponent));
-            }
-
-            val32 = exponent >= 0 ? exponent : -exponent;
-
-            // FIXME: handle length of exponent field:
-            // http://msdn.microsoft.com/de-de/library/0fatw238%28VS.80%29.aspx
-            num_digits = 3;
-            while (num_digits--)
-            {
-                *--(*string) = digits[val32 % 10];
-                val32 /= 10;
-            }
-
-            /* Sign for the exponent */
-            *--(*string) = exponent >= 0 ? _T('+') : _T('-');
-
-            /* Add 'e' or 'E' separator */
-            *--(*string) = digits[0xe];
-            break;
-
-        case _T('A'):
-            digits = digits_u;
-        case _T('a'):
-//            base = 16;
-            // FIXME: TODO
-
-        case _T('f'):
-        default:
-            /* Shift the decimal point and round */
-            fpval2 = round(sign * fpval * pow(10., precision));
-            break;
-    }
-
-    /* Handle sign */
-    if (fpval < 0)
+        double d;
+        unsigned __int64 u;
+    } fpval;
+    int len;
+
+    /* Get the float value, the rest is done on its bits */
+    fpval.d = va_arg_ffp(*argptr, flags);
+
+    /* Handle sign, NaNs and negative zero have none */
+    if ((__int64)fpval.u < 0 &&
+        (fpval.u & 0x7FFFFFFFFFFFFFFFULL) != 0 &&
+        (fpval.u & 0x7FFFFFFFFFFFFFFFULL) <= 0x7FF0000000000000ULL)
     {
         *prefix = _T("-");
     }
@@ -183,44 +111,12 @@ format_float(
     else if (flags & FLAG_FORCE_SIGNSP)
         *prefix = _T(" ");
 
-    /* Handle special cases first */
-    if (_isnan(fpval))
-    {
-        (*string) -= sizeof(_nan) / sizeof(TCHAR) - 1;
-        _tcscpy((*string), _nan);
-        fpval2 = 1;
-    }
-    else if (!_finite(fpval))
-    {
-        (*string) -= sizeof(_infinity) / sizeof(TCHAR) - 1;
-        _tcscpy((*string), _infinity);
-        fpval2 = 1;
-    }
-    else
-    {
-        /* Zero padding */
-        while (padding-- > 0) *--(*string) = _T('0');
-
-        /* Digits after the decimal point */
-        num_digits = precision;
-        while (num_digits-- > 0)
-        {
-            *--(*string) = digits[(unsigned __int64)fpval2 % 10];
-            fpval2 /= base;
-        }
-    }
-
-    if (precision > 0 || flags & FLAG_SPECIAL)
-        *--(*string) = _T('.');
-
-    /* Digits before the decimal point */
-    do
-    {
-        *--(*string) = digits[(unsigned __int64)fpval2 % base];
-        fpval2 /= base;
-    }
-    while ((unsigned __int64)fpval2);
+    /* The digits are exact for any precision, as much as fits the buffer */
+    len = __crt_format_double(buffer, BUFFER_SIZE, fpval.d, (char)chr,
+                              precision, (flags & FLAG_SPECIAL) != 0);
 
+    while (len--)
+        *--(*string) = (TCHAR)buffer[len];
 }
 #endif
 
@@ -0,0 +1,463 @@
+/*
+ * PROJECT:     ReactOS CRT library
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Exact decimal formatting of doubles for printf
+ *
+ * A double is m * 2^e. Over the common range its integer part fits in 64
+ * bits and its fraction in 60, so the digits come straight out of integer
+ * arithmetic. Everything else is expanded with a small bignum: m * 2^e for
+ * e >= 0, and m * 5^-e scaled by 10^e otherwise. Either way the digits are
+ * exact, so rounding them is exact for any precision. Ties round away from
+ * zero, like msvcrt.
+ *
+ * No floating point instructions are used, which matters for the kernel
+ * mode copy in libcntpr.
+ */
+
+#include <string.h>
+#include <internal/fpconv.h>
+
+#define DOUBLE_MANTISSA_MASK    ((((unsigned __int64)1) << 52) - 1)
+#define DOUBLE_HIDDEN_BIT       (((unsigned __int64)1) << 52)
+
+typedef union
+{
+    double d;
+    unsigned __int64 u;
+} FPCONV_DOUBLE;
+
+/* BIGNUM ********************************************************************/
+
+/* Limbs are little endian and the top limb is never zero. The callers keep
+   the values within FPCONV_BIGNUM_LIMBS, anything beyond is dropped. */
+
+void
+__crt_bignum_set(FPCONV_BIGNUM *b, unsigned __int64 value)
+{
+    b->Length = 0;
+    while (value)
+    {
+        b->Limb[b->Length++] = (unsigned int)value;
+        value >>= 32;
+    }
+}
+
+void
+__crt_bignum_muladd(FPCONV_BIGNUM *b, unsigned int factor, unsigned int addend)
+{
+    unsigned __int64 carry = addend;
+    unsigned int i;
+
+    for (i = 0; i < b->Length; i++)
+    {
+        carry += (unsigned __int64)b->Limb[i] * factor;
+        b->Limb[i] = (unsigned int)carry;
+        carry >>= 32;
+    }
+
+    if (carry && b->Length < FPCONV_BIGNUM_LIMBS)
+        b->Limb[b->Length++] = (unsigned int)carry;
+}
+
+void
+__crt_bignum_mulpow5(FPCONV_BIGNUM *b, unsigned int exp5)
+{
+    static const unsigned int pow5[13] =
+    {
+        1, 5, 25, 125, 625, 3125, 15625, 78125, 390625, 1953125, 9765625,
+        48828125, 244140625
+    };
+
+    /* 5^13 is the largest power that fits in a limb */
+    while (exp5 >= 13)
+    {
+        __crt_bignum_muladd(b, 1220703125, 0);
+        exp5 -= 13;
+    }
+
+    if (exp5)
+        __crt_bignum_muladd(b, pow5[exp5], 0);
+}
+
+void
+__crt_bignum_shl(FPCONV_BIGNUM *b, unsigned int shift)
+{
+    unsigned int words = shift / 32, bits = shift % 32, top, i;
+
+    if (!b->Length || b->Length + words >= FPCONV_BIGNUM_LIMBS)
+        return;
+
+    if (bits)
+    {
+        top = b->Limb[b->Length - 1] >> (32 - bits);
+        for (i = b->Length - 1; i > 0; i--)
+            b->Limb[i + words] = (b->Limb[i] << bits) | (b->Limb[i - 1] >> (32 - bits));
+        b->Limb[words] = b->Limb[0] << bits;
+        b->Length += words;
+        if (top)
+            b->Limb[b->Length++] = top;
+    }
+    else
+    {
+        for (i = b->Length; i-- > 0;)
+            b->Limb[i + words] = b->Limb[i];
+        b->Length += words;
+    }
+
+    for (i = 0; i < words; i++)
+        b->Limb[i] = 0;
+}
+
+int
+__crt_bignum_compare(const FPCONV_BIGNUM *a, const FPCONV_BIGNUM *b)
+{
+    unsigned int i;
+
+    if (a->Length != b->Length)
+        return a->Length < b->Length ? -1 : 1;
+
+    for (i = a->Length; i-- > 0;)
+    {
+        if (a->Limb[i] != b->Limb[i])
+            return a->Limb[i] < b->Limb[i] ? -1 : 1;
+    }
+
+    return 0;
+}
+
+static unsigned int
+bignum_divsmall(FPCONV_BIGNUM *b, unsigned int divisor)
+{
+    unsigned __int64 rem = 0;
+    unsigned int i;
+
+    for (i = b->Length; i-- > 0;)
+    {
+        rem = (rem << 32) | b->Limb[i];
+        b->Limb[i] = (unsigned int)(rem / divisor);
+        rem %= divisor;
+    }
+
+    while (b->Length && !b->Limb[b->Length - 1])
+        b->Length--;
+
+    return (unsigned int)rem;
+}
+
+/* DIGITS ********************************************************************/
+
+/* m * 2^e with -60 <= e <= 11: stops once the rounding digit is known */
+static int
+fast_digits(unsigned __int64 m, int e, int mode, int ndigits, char *digits, int *decpt)
+{
+    unsigned __int64 ip, fp = 0, mask = 0;
+    int shift = 0, count = 0, t = 0, limit;
+    char tmp[20];
+
+    if (e >= 0)
+    {
+        ip = m << e;
+    }
+    else
+    {
+        shift = -e;
+        mask = (((unsigned __int64)1) << shift) - 1;
+        ip = m >> shift;
+        fp = m & mask;
+    }
+
+    while (ip)
+    {
+        tmp[t++] = (char)('0' + (int)(ip % 10));
+        ip /= 10;
+    }
+
+    *decpt = t;
+    if (!t)
+    {
+        /* A pure fraction, skip its leading zeros */
+        fp *= 10;
+        while (!(fp >> shift))
+        {
+            (*decpt)--;
+            fp *= 10;
+        }
+    }
+
+    /* One digit past the cut decides the rounding */
+    limit = (mode == FPCONV_SIGNIFICANT ? ndigits : *decpt + ndigits) + 1;
+    if (limit <= 0)
+        return 0;
+
+    while (t && count < limit)
+        digits[count++] = tmp[--t];
+
+    if (*decpt <= 0)
+    {
+        /* The first significant digit is already above the point */
+        digits[count++] = (char)('0' + (int)(fp >> shift));
+        fp &= mask;
+    }
+
+    /* fp < 2^60, so fp * 10 can't overflow */
+    while (count < limit && fp)
+    {
+        fp *= 10;
+        digits[count++] = (char)('0' + (int)(fp >> shift));
+        fp &= mask;
+    }
+
+    return count;
+}
+
+/* All the digits of m * 2^e, converted 9 at a time from the bottom */
+static int
+big_digits(unsigned __int64 m, int e, char *digits, int *decpt)
+{
+    FPCONV_BIGNUM b;
+    char *end = digits + FPCONV_BUFFER_SIZE, *p = end;
+    unsigned int chunk;
+    int count, i;
+
+    __crt_bignum_set(&b, m);
+    if (e >= 0)
+        __crt_bignum_shl(&b, e);
+    else
+        __crt_bignum_mulpow5(&b, -e);
+
+    while (b.Length)
+    {
+        chunk = bignum_divsmall(&b, 1000000000);
+        for (i = 0; i < 9; i++)
+        {
+            *--p = (char)('0' + chunk % 10);
+            chunk /= 10;
+        }
+    }
+
+    while (*p == '0')
+        p++;
+
+    count = (int)(end - p);
+    memmove(digits, p, count);
+
+    /* b was m * 5^-e, so the value is b * 10^e */
+    *decpt = count + (e < 0 ? e : 0);
+    return count;
+}
+
+/*
+ * Rounds a positive double to ndigits significant digits or to ndigits
+ * digits after the decimal point, depending on mode. On return the value
+ * is 0.digits * 10^decpt; trailing zeros are not stored. Returns the number
+ * of digits, 0 when the value rounds to zero. digits must hold
+ * FPCONV_BUFFER_SIZE characters.
+ */
+int
+__crt_dtoa(double value, int mode, int ndigits, char *digits, int *decpt)
+{
+    FPCONV_DOUBLE fp;
+    unsigned __int64 m;
+    int e, count, cut, up;
+
+    fp.d = value;
+    m = fp.u & DOUBLE_MANTISSA_MASK;
+    e = (int)((fp.u >> 52) & 0x7FF);
+    *decpt = 0;
+
+    if (e)
+    {
+        m |= DOUBLE_HIDDEN_BIT;
+        e -= 1075;
+    }
+    else
+    {
+        if (!m)
+            return 0;
+        e = -1074;
+    }
+
+    if (e >= -60 && e <= 11)
+        count = fast_digits(m, e, mode, ndigits, digits, decpt);
+    else
+        count = big_digits(m, e, digits, decpt);
+
+    cut = mode == FPCONV_SIGNIFICANT ? ndigits : *decpt + ndigits;
+    if (cut < 0)
+        return 0;
+
+    if (count > cut)
+    {
+        /* The digits are exact, so a tie is a 5 followed by nothing, and
+           it rounds up like everything above it */
+        up = digits[cut] >= '5';
+        count = cut;
+        if (up)
+        {
+            while (count && digits[count - 1] == '9')
+                count--;
+
+            if (count)
+            {
+                digits[count - 1]++;
+            }
+            else
+            {
+                digits[0] = '1';
+                count = 1;
+                (*decpt)++;
+            }
+        }
+    }
+
+    while (count && digits[count - 1] == '0')
+        count--;
+
+    return count;
+}
+
+/* FORMATTING ****************************************************************/
+
+/*
+ * Formats the magnitude of value for %e, %f or %g into buffer, which holds
+ * size characters including the terminator; the sign is left to the caller.
+ * When the result wouldn't fit, the precision is cut down, and a %f number
+ * whose integer part alone is too long switches to %e. Returns the length.
+ */
+int
+__crt_format_double(char *buffer, int size, double value, int chr, int precision, int alternate)
+{
+    char digits[FPCONV_BUFFER_SIZE];
+    const char *special = NULL;
+    FPCONV_DOUBLE fp;
+    int count, decpt, exponent = 0, style, trim = 0, avail = size - 1, len, i;
+    char *p = buffer;
+
+    fp.d = value;
+    fp.u &= ~(((unsigned __int64)1) << 63);
+
+    if (precision < 0)
+        precision = 6;
+
+    if ((fp.u >> 52) == 0x7FF)
+    {
+        special = (fp.u & DOUBLE_MANTISSA_MASK) ? "#QNAN" : "#INF";
+        *p++ = '1';
+        if (precision > 0 || alternate)
+            *p++ = '.';
+        len = (int)strlen(special);
+        memcpy(p, special, len + 1);
+        return (int)(p - buffer) + len;
+    }
+
+    switch (chr)
+    {
+        case 'g':
+        case 'G':
+            if (precision == 0)
+                precision = 1;
+            if (precision > avail - 6)
+                precision = avail - 6;
+
+            count = __crt_dtoa(fp.d, FPCONV_SIGNIFICANT, precision, digits, &decpt);
+            exponent = count ? decpt - 1 : 0;
+            trim = !alternate;
+
+            if (exponent < -4 || exponent >= precision)
+            {
+                style = 'e';
+                precision--;
+            }
+            else
+            {
+                style = 'f';
+                precision -= exponent + 1;
+            }
+            break;
+
+        case 'e':
+        case 'E':
+            if (precision > avail - 7)
+                precision = avail - 7;
+
+            count = __crt_dtoa(fp.d, FPCONV_SIGNIFICANT, precision + 1, digits, &decpt);
+            exponent = count ? decpt - 1 : 0;
+            style = 'e';
+            break;
+
+        default:
+            /* FIXME: %a is printed as %f */
+            style = 'f';
+            count = __crt_dtoa(fp.d, FPCONV_FIXED, precision, digits, &decpt);
+
+            len = (count && decpt > 0) ? decpt : 1;
+            if (len + 1 + precision > avail)
+            {
+                /* Leave a digit for a carry out of the new rounding */
+                precision = avail - len - 2;
+                if (precision >= 0)
+                {
+                    count = __crt_dtoa(fp.d, FPCONV_FIXED, precision, digits, &decpt);
+                }
+                else
+                {
+                    style = 'e';
+                    precision = avail - 7;
+                    count = __crt_dtoa(fp.d, FPCONV_SIGNIFICANT, precision + 1, digits, &decpt);
+                    exponent = count ? decpt - 1 : 0;
+                }
+            }
+            break;
+    }
+
+    if (style == 'e')
+    {
+        if (trim && precision > count - 1)
+            precision = count > 1 ? count - 1 : 0;
+
+        *p++ = count ? digits[0] : '0';
+        if (precision > 0 || alternate)
+            *p++ = '.';
+        for (i = 1; i <= precision; i++)
+            *p++ = i < count ? digits[i] : '0';
+
+        *p++ = (chr == 'E' || chr == 'G') ? 'E' : 'e';
+        if (exponent < 0)
+        {
+            *p++ = '-';
+            exponent = -exponent;
+        }
+        else
+        {
+            *p++ = '+';
+        }
+
+        /* FIXME: _set_output_format(_TWO_DIGIT_EXPONENT) */
+        *p++ = (char)('0' + exponent / 100);
+        *p++ = (char)('0' + exponent / 10 % 10);
+        *p++ = (char)('0' + exponent % 10);
+    }
+    else
+    {
+        if (trim && precision > count - decpt)
+            precision = count > decpt ? count - decpt : 0;
+
+        if (count && decpt > 0)
+        {
+            for (i = 0; i < decpt; i++)
+                *p++ = i < count ? digits[i] : '0';
+        }
+        else
+        {
+            *p++ = '0';
+        }
+
+        if (precision > 0 || alternate)
+            *p++ = '.';
+        for (i = 0; i < precision; i++)
+            *p++ = (decpt + i >= 0 && decpt + i < count) ? digits[decpt + i] : '0';
+    }
+
+    *p = '\0';
+    return (int)(p - buffer);
+}
@@ -0,0 +1,4 @@
+
+#include "tcschr.inc"
+
+/* EOF */
@@ -1,5 +1,9 @@
 #include <precomp.h>
 
+#define WORD_ONES  ((size_t)-1 / 0xFF)
+#define WORD_HIGHS (WORD_ONES << 7)
+#define WORD_HAS_NUL(w) ((((w) - WORD_ONES) & ~(w) & WORD_HIGHS) != 0)
+
 /*
  * @implemented
  */
@@ -7,8 +11,23 @@ int
 CDECL
 _stricmp(const char *s1, const char *s2)
 {
-  while (toupper(*s1) == toupper(*s2))
+  while (1)
   {
+    /* Skip identical runs a word at a time. Identical bytes fold the same
+       way in any case, so only the words that differ go through toupper.
+       The loads are aligned for both strings and can't leave the page. */
+    if ((((ULONG_PTR)s1 | ((ULONG_PTR)s1 ^ (ULONG_PTR)s2)) & (sizeof(size_t) - 1)) == 0)
+    {
+      while (*(const size_t *)s1 == *(const size_t *)s2 &&
+             !WORD_HAS_NUL(*(const size_t *)s1))
+      {
+        s1 += sizeof(size_t);
+        s2 += sizeof(size_t);
+      }
+    }
+
+    if (toupper(*s1) != toupper(*s2))
+      break;
     if (*s1 == 0)
       return 0;
     s1++;
@@ -2,13 +2,30 @@
 
 #include <precomp.h>
 
+#define WORD_ONES  ((size_t)-1 / 0xFFFF)
+#define WORD_HIGHS (WORD_ONES << 15)
+#define WORD_HAS_NUL(w) ((((w) - WORD_ONES) & ~(w) & WORD_HIGHS) != 0)
+
 /*
  * @implemented
  */
 int CDECL _wcsicmp(const wchar_t* cs,const wchar_t * ct)
 {
-	while (towlower(*cs) == towlower(*ct))
+	while (1)
 	{
+		/* Skip identical runs a word at a time, see _stricmp */
+		if ((((ULONG_PTR)cs | ((ULONG_PTR)cs ^ (ULONG_PTR)ct)) & (sizeof(size_t) - 1)) == 0)
+		{
+			while (*(const size_t *)cs == *(const size_t *)ct &&
+			       !WORD_HAS_NUL(*(const size_t *)cs))
+			{
+				cs += sizeof(size_t) / sizeof(wchar_t);
+				ct += sizeof(size_t) / sizeof(wchar_t);
+			}
+		}
+
+		if (towlower(*cs) != towlower(*ct))
+			break;
 		if (*cs == 0)
 			return 0;
 		cs++;
@@ -10,7 +10,23 @@
 
 #include "precomp.h"
 
-NEIGHBOR_CACHE_TABLE NeighborCache[NB_HASHMASK + 1];
+PNEIGHBOR_CACHE_TABLE volatile NeighborCache;
+
+static NEIGHBOR_CACHE_TABLE NeighborCacheInitialTable;
+static NEIGHBOR_CACHE_BUCKET NeighborCacheInitialBuckets[NB_INITIAL_BUCKETS];
+static volatile LONG NeighborCacheResizing;
+static ULONG NeighborCacheHashSeed;
+
+/* Neighbor ticks, incremented once per NBTimeout call */
+static volatile ULONG NeighborCacheTick;
+
+/* Protects the timer wheel and the retired lists */
+static KSPIN_LOCK NeighborAgingLock;
+static LIST_ENTRY NeighborWheel[NB_WHEEL_SIZE];
+static LIST_ENTRY RetiredNeighbors;
+static LIST_ENTRY RetiredTables;
+
+static NEIGHBOR_CACHE_STATISTICS NeighborCacheStats;
 
 VOID NBCompleteSend( PVOID Context,
 		     PNDIS_PACKET NdisPacket,
@@ -28,19 +44,12 @@ VOID NBCompleteSend( PVOID Context,
 VOID NBSendPackets( PNEIGHBOR_CACHE_ENTRY NCE ) {
     PLIST_ENTRY PacketEntry;
     PNEIGHBOR_PACKET Packet;
-    UINT HashValue;
 
     ASSERT(!(NCE->State & NUD_INCOMPLETE));
 
-    HashValue  = *(PULONG)(&NCE->Address.Address);
-    HashValue ^= HashValue >> 16;
-    HashValue ^= HashValue >> 8;
-    HashValue ^= HashValue >> 4;
-    HashValue &= NB_HASHMASK;
-
     /* Send any waiting packets */
     while ((PacketEntry = ExInterlockedRemoveHeadList(&NCE->PacketQueue,
-                                              &NeighborCache[HashValue].Lock)) != NULL)
+                                                      &NCE->PacketLock)) != NULL)
     {
 	Packet = CONTAINING_RECORD( PacketEntry, NEIGHBOR_PACKET, Next );
 
@@ -61,14 +70,15 @@ VOID NBSendPackets( PNEIGHBOR_CACHE_ENTRY NCE ) {
     }
 }
 
-/* Must be called with table lock acquired */
+/* Must be called without the NCE's bucket lock held */
 VOID NBFlushPacketQueue( PNEIGHBOR_CACHE_ENTRY NCE,
 			 NTSTATUS ErrorCode ) {
     PLIST_ENTRY PacketEntry;
     PNEIGHBOR_PACKET Packet;
 
-    while( !IsListEmpty(&NCE->PacketQueue) ) {
-        PacketEntry = RemoveHeadList(&NCE->PacketQueue);
+    while ((PacketEntry = ExInterlockedRemoveHeadList(&NCE->PacketQueue,
+                                                      &NCE->PacketLock)) != NULL)
+    {
 	Packet = CONTAINING_RECORD
 	    ( PacketEntry, NEIGHBOR_PACKET, Next );
 
@@ -88,82 +98,448 @@ VOID NBFlushPacketQueue( PNEIGHBOR_CACHE_ENTRY NCE,
     }
 }
 
-VOID NBTimeout(VOID)
+static ULONG NBHashAddress(PIP_ADDRESS Address)
 /*
- * FUNCTION: Neighbor address cache timeout handler
+ * FUNCTION: Hashes an IP address for the neighbor cache
  * NOTES:
- *     This routine is called by IPTimeout to remove outdated cache
- *     entries.
+ *   Uses the MurmurHash3 finalizer, so that all bits of the address
+ *   affect the low bits used to select a bucket
+ */
+{
+    ULONG HashValue = *(PULONG)&Address->Address ^ NeighborCacheHashSeed;
+
+    HashValue ^= HashValue >> 16;
+    HashValue *= 0x85EBCA6B;
+    HashValue ^= HashValue >> 13;
+    HashValue *= 0xC2B2AE35;
+    HashValue ^= HashValue >> 16;
+
+    return HashValue;
+}
+
+static PNEIGHBOR_CACHE_BUCKET NBLockBucket(ULONG HashValue, PKIRQL OldIrql)
+/*
+ * FUNCTION: Acquires the bucket lock for a hash value in the current table
+ * NOTES:
+ *   A resize holds every bucket lock of the old table while it publishes
+ *   the new one, so the table cannot change while a bucket lock is held
+ */
+{
+    PNEIGHBOR_CACHE_TABLE Table;
+    PNEIGHBOR_CACHE_BUCKET Bucket;
+
+    for (;;)
+    {
+        Table = NeighborCache;
+        Bucket = &Table->Buckets[HashValue & Table->Mask];
+
+        TcpipAcquireSpinLock(&Bucket->Lock, OldIrql);
+        if (Table == NeighborCache)
+            return Bucket;
+
+        TcpipReleaseSpinLock(&Bucket->Lock, *OldIrql);
+    }
+}
+
+static PNEIGHBOR_CACHE_TABLE NBLockAllBuckets(PKIRQL OldIrql)
+/*
+ * FUNCTION: Acquires every bucket lock of the current table in order
+ */
+{
+    PNEIGHBOR_CACHE_TABLE Table;
+    ULONG i;
+
+    KeRaiseIrql(DISPATCH_LEVEL, OldIrql);
+
+    for (;;)
+    {
+        Table = NeighborCache;
+
+        for (i = 0; i <= Table->Mask; i++)
+            TcpipAcquireSpinLockAtDpcLevel(&Table->Buckets[i].Lock);
+
+        if (Table == NeighborCache)
+            return Table;
+
+        for (i = 0; i <= Table->Mask; i++)
+            TcpipReleaseSpinLockFromDpcLevel(&Table->Buckets[i].Lock);
+    }
+}
+
+static VOID NBUnlockAllBuckets(PNEIGHBOR_CACHE_TABLE Table, KIRQL OldIrql)
+{
+    ULONG i;
+
+    for (i = 0; i <= Table->Mask; i++)
+        TcpipReleaseSpinLockFromDpcLevel(&Table->Buckets[i].Lock);
+
+    KeLowerIrql(OldIrql);
+}
+
+static VOID NBInitializeTable(
+    PNEIGHBOR_CACHE_TABLE Table,
+    PNEIGHBOR_CACHE_BUCKET Buckets,
+    ULONG Size)
+{
+    ULONG i;
+
+    Table->Mask = Size - 1;
+    Table->Buckets = Buckets;
+
+    for (i = 0; i < Size; i++) {
+        Buckets[i].Cache = NULL;
+        TcpipInitializeSpinLock(&Buckets[i].Lock);
+    }
+}
+
+static BOOLEAN NBGetNextEvent(
+    PNEIGHBOR_CACHE_ENTRY NCE,
+    ULONG Now,
+    PULONG DueTick)
+/*
+ * FUNCTION: Computes the next tick at which NBTimeout has work for an NCE
+ * RETURNS:
+ *   FALSE if the NCE never needs to be aged
+ */
+{
+    ULONG Age = Now - NCE->LastEventTick;
+
+    if ((NCE->State & NUD_INCOMPLETE) ||
+        (NCE->EventTimer > 0 && Age >= ARP_RATE))
+    {
+        /* Solicit (or check for retransmission) on every tick */
+        *DueTick = Now + 1;
+        return TRUE;
+    }
+
+    if (NCE->EventTimer > 0)
+    {
+        *DueTick = NCE->LastEventTick + min(NCE->EventTimer, ARP_RATE);
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/* Must be called with the NCE's bucket lock acquired */
+static VOID NBScheduleNeighbor(PNEIGHBOR_CACHE_ENTRY NCE, ULONG DueTick)
+{
+    ULONG Now = NeighborCacheTick;
+    ULONG Delta = DueTick - Now;
+
+    /* Events further away than one wheel turn are re-evaluated when
+     * their slot comes around */
+    if ((LONG)Delta < 1)
+        Delta = 1;
+    else if (Delta >= NB_WHEEL_SIZE)
+        Delta = NB_WHEEL_SIZE - 1;
+
+    TcpipAcquireSpinLockAtDpcLevel(&NeighborAgingLock);
+
+    if (NCE->WheelSlot != NB_WHEEL_IDLE)
+        RemoveEntryList(&NCE->WheelLink);
+
+    NCE->WheelSlot = (Now + Delta) & (NB_WHEEL_SIZE - 1);
+    InsertTailList(&NeighborWheel[NCE->WheelSlot], &NCE->WheelLink);
+
+    TcpipReleaseSpinLockFromDpcLevel(&NeighborAgingLock);
+}
+
+/* Must be called with the NCE's bucket lock acquired */
+static BOOLEAN NBUnlinkNeighbor(
+    PNEIGHBOR_CACHE_BUCKET Bucket,
+    PNEIGHBOR_CACHE_ENTRY NCE)
+/*
+ * FUNCTION: Unlinks an NCE from its hash chain and the timer wheel
+ * NOTES:
+ *   The NCE's Next pointer is left intact for lock-free readers. The
+ *   caller must flush and retire the NCE after dropping the bucket lock
  */
 {
-    UINT i;
     PNEIGHBOR_CACHE_ENTRY *PrevNCE;
+    PNEIGHBOR_CACHE_ENTRY CurNCE;
+
+    for (PrevNCE = (PNEIGHBOR_CACHE_ENTRY *)&Bucket->Cache;
+         (CurNCE = *PrevNCE) != NULL;
+         PrevNCE = (PNEIGHBOR_CACHE_ENTRY *)&CurNCE->Next)
+    {
+        if (CurNCE == NCE)
+        {
+            *PrevNCE = NCE->Next;
+            NCE->Unlinked = TRUE;
+
+            TcpipAcquireSpinLockAtDpcLevel(&NeighborAgingLock);
+            if (NCE->WheelSlot != NB_WHEEL_IDLE)
+                RemoveEntryList(&NCE->WheelLink);
+            NCE->WheelSlot = NB_WHEEL_IDLE;
+            TcpipReleaseSpinLockFromDpcLevel(&NeighborAgingLock);
+
+            InterlockedDecrement((PLONG)&NeighborCacheStats.Entries);
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static VOID NBRetireNeighbor(PNEIGHBOR_CACHE_ENTRY NCE)
+/*
+ * FUNCTION: Queues an unlinked NCE to be freed after the grace period
+ * NOTES:
+ *   Retired NCEs keep their retire tick in WheelSlot
+ */
+{
+    KIRQL OldIrql;
+
+    TcpipAcquireSpinLock(&NeighborAgingLock, &OldIrql);
+    NCE->WheelSlot = NeighborCacheTick;
+    InsertTailList(&RetiredNeighbors, &NCE->WheelLink);
+    TcpipReleaseSpinLock(&NeighborAgingLock, OldIrql);
+}
+
+static VOID NBFreeRetired(ULONG Now)
+/*
+ * FUNCTION: Frees NCEs and tables whose grace period has elapsed
+ */
+{
+    LIST_ENTRY FreeNeighbors, FreeTables;
     PNEIGHBOR_CACHE_ENTRY NCE;
-    NDIS_STATUS Status;
+    PNEIGHBOR_CACHE_TABLE Table;
+    PLIST_ENTRY Entry;
+
+    InitializeListHead(&FreeNeighbors);
+    InitializeListHead(&FreeTables);
+
+    TcpipAcquireSpinLockAtDpcLevel(&NeighborAgingLock);
+
+    while (!IsListEmpty(&RetiredNeighbors))
+    {
+        NCE = CONTAINING_RECORD(RetiredNeighbors.Flink, NEIGHBOR_CACHE_ENTRY, WheelLink);
+        if (Now - NCE->WheelSlot < NB_GRACE_TICKS)
+            break;
+
+        RemoveEntryList(&NCE->WheelLink);
+        InsertTailList(&FreeNeighbors, &NCE->WheelLink);
+    }
+
+    while (!IsListEmpty(&RetiredTables))
+    {
+        Table = CONTAINING_RECORD(RetiredTables.Flink, NEIGHBOR_CACHE_TABLE, RetireLink);
+        if (Now - Table->RetireTick < NB_GRACE_TICKS)
+            break;
+
+        RemoveEntryList(&Table->RetireLink);
+        InsertTailList(&FreeTables, &Table->RetireLink);
+    }
+
+    TcpipReleaseSpinLockFromDpcLevel(&NeighborAgingLock);
+
+    while (!IsListEmpty(&FreeNeighbors))
+    {
+        Entry = RemoveHeadList(&FreeNeighbors);
+        NCE = CONTAINING_RECORD(Entry, NEIGHBOR_CACHE_ENTRY, WheelLink);
+
+        /* Packets may have been queued after the NCE was unlinked */
+        NBFlushPacketQueue(NCE, NDIS_STATUS_REQUEST_ABORTED);
+        ExFreePoolWithTag(NCE, NCE_TAG);
+    }
+
+    while (!IsListEmpty(&FreeTables))
+    {
+        Entry = RemoveHeadList(&FreeTables);
+        Table = CONTAINING_RECORD(Entry, NEIGHBOR_CACHE_TABLE, RetireLink);
+
+        if (Table != &NeighborCacheInitialTable)
+            ExFreePoolWithTag(Table, NCE_TABLE_TAG);
+    }
+}
+
+static VOID NBGrowTable(VOID)
+/*
+ * FUNCTION: Rehashes the neighbor cache into a larger table
+ * NOTES:
+ *   Lock-free readers racing with the rehash may miss an entry. They
+ *   fall back to a locked lookup, which always sees the current table
+ */
+{
+    PNEIGHBOR_CACHE_TABLE OldTable, NewTable;
+    PNEIGHBOR_CACHE_BUCKET Bucket, NewBucket;
+    PNEIGHBOR_CACHE_ENTRY NCE;
+    ULONG NewSize, i;
+    KIRQL OldIrql;
+
+    if (InterlockedCompareExchange(&NeighborCacheResizing, 1, 0) != 0)
+        return;
 
-    for (i = 0; i <= NB_HASHMASK; i++) {
-        TcpipAcquireSpinLockAtDpcLevel(&NeighborCache[i].Lock);
+    NewSize = min((NeighborCache->Mask + 1) << NB_GROWTH_SHIFT, NB_MAX_BUCKETS);
+    if (NewSize <= NeighborCache->Mask + 1)
+        goto Done;
 
-        for (PrevNCE = &NeighborCache[i].Cache;
-             (NCE = *PrevNCE) != NULL;) {
+    NewTable = ExAllocatePoolWithTag(NonPagedPool,
+                                     sizeof(NEIGHBOR_CACHE_TABLE) +
+                                     NewSize * sizeof(NEIGHBOR_CACHE_BUCKET),
+                                     NCE_TABLE_TAG);
+    if (NewTable == NULL)
+    {
+        TI_DbgPrint(MIN_TRACE, ("Insufficient resources.\n"));
+        goto Done;
+    }
+
+    NBInitializeTable(NewTable, (PNEIGHBOR_CACHE_BUCKET)&NewTable[1], NewSize);
+
+    OldTable = NBLockAllBuckets(&OldIrql);
+
+    for (i = 0; i <= OldTable->Mask; i++)
+    {
+        Bucket = &OldTable->Buckets[i];
+
+        while ((NCE = Bucket->Cache) != NULL)
+        {
+            Bucket->Cache = NCE->Next;
+
+            NewBucket = &NewTable->Buckets[NBHashAddress(&NCE->Address) & NewTable->Mask];
+            NCE->Next = NewBucket->Cache;
+            NewBucket->Cache = NCE;
+        }
+    }
+
+    InterlockedExchangePointer((PVOID *)&NeighborCache, NewTable);
+
+    TcpipAcquireSpinLockAtDpcLevel(&NeighborAgingLock);
+    OldTable->RetireTick = NeighborCacheTick;
+    InsertTailList(&RetiredTables, &OldTable->RetireLink);
+    TcpipReleaseSpinLockFromDpcLevel(&NeighborAgingLock);
+
+    NBUnlockAllBuckets(OldTable, OldIrql);
+
+    InterlockedIncrement((PLONG)&NeighborCacheStats.Resizes);
+
+    TI_DbgPrint(DEBUG_NCACHE, ("Neighbor cache resized to %u buckets.\n", NewSize));
+
+Done:
+    InterlockedExchange(&NeighborCacheResizing, 0);
+}
+
+static VOID NBAgeNeighbor(PNEIGHBOR_CACHE_ENTRY NCE, ULONG Now)
+/*
+ * FUNCTION: Runs the aging state machine of an NCE whose wheel slot expired
+ */
+{
+    PNEIGHBOR_CACHE_BUCKET Bucket;
+    NDIS_STATUS Status = NDIS_STATUS_SUCCESS;
+    BOOLEAN Expired = FALSE, Flush = FALSE;
+    ULONG Age, DueTick;
+    KIRQL OldIrql;
+
+    Bucket = NBLockBucket(NBHashAddress(&NCE->Address), &OldIrql);
+
+    /* It may have been removed after we took it off the wheel */
+    if (NCE->Unlinked)
+    {
+        TcpipReleaseSpinLock(&Bucket->Lock, OldIrql);
+        return;
+    }
+
+    Age = Now - NCE->LastEventTick;
+
+    if (NCE->State & NUD_INCOMPLETE)
+    {
+        /* Solicit for an address */
+        NBSendSolicit(NCE);
+        if (NCE->EventTimer == 0 &&
+            Age > 0 && Age % ARP_INCOMPLETE_TIMEOUT == 0)
+        {
+            Flush = TRUE;
+        }
+    }
+
+    if (NCE->EventTimer > 0)
+    {
+        ASSERT(!(NCE->State & NUD_PERMANENT));
+
+        if ((Age > ARP_RATE && Age % ARP_TIMEOUT_RETRANSMISSION == 0) ||
+            (Age == ARP_RATE))
+        {
+            /* We haven't gotten a packet from them in
+             * Age seconds so we mark them as stale
+             * and solicit now */
+            NCE->State |= NUD_STALE;
+            NBSendSolicit(NCE);
+        }
+
+        if (Age >= NCE->EventTimer)
+        {
+            /* Choose the proper failure status */
             if (NCE->State & NUD_INCOMPLETE)
             {
-                /* Solicit for an address */
-                NBSendSolicit(NCE);
-                if (NCE->EventTimer == 0)
-                {
-                    NCE->EventCount++;
-                    if (NCE->EventCount == ARP_INCOMPLETE_TIMEOUT)
-                    {
-                        NBFlushPacketQueue(NCE, NDIS_STATUS_NETWORK_UNREACHABLE);
-                        NCE->EventCount = 0;
-                    }
-                }
+                /* We couldn't get an address to this IP at all */
+                Status = NDIS_STATUS_HOST_UNREACHABLE;
             }
-
-            /* Check if event timer is running */
-            if (NCE->EventTimer > 0)  {
-                ASSERT(!(NCE->State & NUD_PERMANENT));
-                NCE->EventCount++;
-
-                if ((NCE->EventCount > ARP_RATE &&
-                     NCE->EventCount % ARP_TIMEOUT_RETRANSMISSION == 0) ||
-                    (NCE->EventCount == ARP_RATE))
-                {
-                    /* We haven't gotten a packet from them in
-                     * EventCount seconds so we mark them as stale
-                     * and solicit now */
-                    NCE->State |= NUD_STALE;
-                    NBSendSolicit(NCE);
-                }
-                if (NCE->EventTimer - NCE->EventCount == 0) {
-                    /* Unlink and destroy the NCE */
-                    *PrevNCE = NCE->Next;
-                    
-                    /* Choose the proper failure status */
-                    if (NCE->State & NUD_INCOMPLETE)
-                    {
-                        /* We couldn't get an address to this IP at all */
-                        Status = NDIS_STATUS_HOST_UNREACHABLE;
-                    }
-                    else
-                    {
-                        /* This guy was stale for way too long */
-                        Status = NDIS_STATUS_REQUEST_ABORTED;
-                    }
-                    
-                    NBFlushPacketQueue(NCE, Status);
-
-                    ExFreePoolWithTag(NCE, NCE_TAG);
-
-                    continue;
-                }
+            else
+            {
+                /* This guy was stale for way too long */
+                Status = NDIS_STATUS_REQUEST_ABORTED;
             }
-            PrevNCE = &NCE->Next;
+
+            Expired = NBUnlinkNeighbor(Bucket, NCE);
+        }
+    }
+
+    if (!Expired && NBGetNextEvent(NCE, Now, &DueTick))
+        NBScheduleNeighbor(NCE, DueTick);
+
+    TcpipReleaseSpinLock(&Bucket->Lock, OldIrql);
+
+    if (Expired)
+    {
+        InterlockedIncrement((PLONG)&NeighborCacheStats.Evictions);
+        NBFlushPacketQueue(NCE, Status);
+        NBRetireNeighbor(NCE);
+    }
+    else if (Flush)
+    {
+        NBFlushPacketQueue(NCE, NDIS_STATUS_NETWORK_UNREACHABLE);
+    }
+}
+
+VOID NBTimeout(VOID)
+/*
+ * FUNCTION: Neighbor address cache timeout handler
+ * NOTES:
+ *     This routine is called by IPTimeout to remove outdated cache
+ *     entries. Only the NCEs in the current timer wheel slot are
+ *     visited; NCEs that aren't due yet are put back on the wheel
+ */
+{
+    PLIST_ENTRY Slot, Entry;
+    PNEIGHBOR_CACHE_ENTRY NCE;
+    ULONG Now;
+
+    Now = ++NeighborCacheTick;
+    Slot = &NeighborWheel[Now & (NB_WHEEL_SIZE - 1)];
+
+    for (;;)
+    {
+        TcpipAcquireSpinLockAtDpcLevel(&NeighborAgingLock);
+
+        if (IsListEmpty(Slot))
+        {
+            TcpipReleaseSpinLockFromDpcLevel(&NeighborAgingLock);
+            break;
         }
 
-        TcpipReleaseSpinLockFromDpcLevel(&NeighborCache[i].Lock);
+        Entry = RemoveHeadList(Slot);
+        NCE = CONTAINING_RECORD(Entry, NEIGHBOR_CACHE_ENTRY, WheelLink);
+        NCE->WheelSlot = NB_WHEEL_IDLE;
+
+        TcpipReleaseSpinLockFromDpcLevel(&NeighborAgingLock);
+
+        /* A concurrent removal only retires the NCE, which keeps
+         * it allocated until a later tick */
+        NBAgeNeighbor(NCE, Now);
     }
+
+    NBFreeRetired(Now);
 }
 
 VOID NBStartup(VOID)
@@ -175,10 +551,21 @@ VOID NBStartup(VOID)
 
     TI_DbgPrint(DEBUG_NCACHE, ("Called.\n"));
 
-    for (i = 0; i <= NB_HASHMASK; i++) {
-	NeighborCache[i].Cache = NULL;
-	TcpipInitializeSpinLock(&NeighborCache[i].Lock);
-    }
+    NeighborCacheHashSeed = KeQueryPerformanceCounter(NULL).LowPart;
+    NeighborCacheTick = 0;
+    NeighborCacheResizing = 0;
+    RtlZeroMemory(&NeighborCacheStats, sizeof(NeighborCacheStats));
+
+    TcpipInitializeSpinLock(&NeighborAgingLock);
+    for (i = 0; i < NB_WHEEL_SIZE; i++)
+        InitializeListHead(&NeighborWheel[i]);
+    InitializeListHead(&RetiredNeighbors);
+    InitializeListHead(&RetiredTables);
+
+    NBInitializeTable(&NeighborCacheInitialTable,
+                      NeighborCacheInitialBuckets,
+                      NB_INITIAL_BUCKETS);
+    NeighborCache = &NeighborCacheInitialTable;
 }
 
 VOID NBShutdown(VOID)
@@ -186,33 +573,49 @@ VOID NBShutdown(VOID)
  * FUNCTION: Shuts down the neighbor cache
  */
 {
-  PNEIGHBOR_CACHE_ENTRY NextNCE;
+  PNEIGHBOR_CACHE_TABLE Table;
   PNEIGHBOR_CACHE_ENTRY CurNCE;
+  LIST_ENTRY Destroyed;
+  PLIST_ENTRY Entry;
   KIRQL OldIrql;
   UINT i;
 
   TI_DbgPrint(DEBUG_NCACHE, ("Called.\n"));
 
+  InitializeListHead(&Destroyed);
+
   /* Remove possible entries from the cache */
-  for (i = 0; i <= NB_HASHMASK; i++)
+  Table = NBLockAllBuckets(&OldIrql);
+
+  for (i = 0; i <= Table->Mask; i++)
     {
-      TcpipAcquireSpinLock(&NeighborCache[i].Lock, &OldIrql);
+      while ((CurNCE = Table->Buckets[i].Cache) != NULL) {
+          NBUnlinkNeighbor(&Table->Buckets[i], CurNCE);
+          InsertTailList(&Destroyed, &CurNCE->WheelLink);
+      }
+    }
 
-      CurNCE = NeighborCache[i].Cache;
-      while (CurNCE) {
-          NextNCE = CurNCE->Next;
+  NBUnlockAllBuckets(Table, OldIrql);
 
-          /* Flush wait queue */
-	  NBFlushPacketQueue( CurNCE, NDIS_STATUS_NOT_ACCEPTED );
+  while (!IsListEmpty(&Destroyed)) {
+      Entry = RemoveHeadList(&Destroyed);
+      CurNCE = CONTAINING_RECORD(Entry, NEIGHBOR_CACHE_ENTRY, WheelLink);
 
-          ExFreePoolWithTag(CurNCE, NCE_TAG);
+      /* Flush wait queue */
+      NBFlushPacketQueue( CurNCE, NDIS_STATUS_NOT_ACCEPTED );
 
-	  CurNCE = NextNCE;
-      }
+      ExFreePoolWithTag(CurNCE, NCE_TAG);
+  }
 
-    NeighborCache[i].Cache = NULL;
+  /* Nobody can reference the cache anymore, skip the grace period */
+  KeRaiseIrql(DISPATCH_LEVEL, &OldIrql);
+  NBFreeRetired(NeighborCacheTick + NB_GRACE_TICKS);
+  KeLowerIrql(OldIrql);
 
-    TcpipReleaseSpinLock(&NeighborCache[i].Lock, OldIrql);
+  if (Table != &NeighborCacheInitialTable)
+  {
+      NeighborCache = &NeighborCacheInitialTable;
+      ExFreePoolWithTag(Table, NCE_TABLE_TAG);
   }
 
   TI_DbgPrint(MAX_TRACE, ("Leaving.\n"));
@@ -236,38 +639,42 @@ VOID NBSendSolicit(PNEIGHBOR_CACHE_ENTRY NCE)
 
 VOID NBDestroyNeighborsForInterface(PIP_INTERFACE Interface)
 {
+    PNEIGHBOR_CACHE_TABLE Table;
+    PNEIGHBOR_CACHE_ENTRY NCE, NextNCE;
+    LIST_ENTRY Destroyed;
+    PLIST_ENTRY Entry;
     KIRQL OldIrql;
-    PNEIGHBOR_CACHE_ENTRY *PrevNCE;
-    PNEIGHBOR_CACHE_ENTRY NCE;
     ULONG i;
 
-    KeRaiseIrql(DISPATCH_LEVEL, &OldIrql);
-    for (i = 0; i <= NB_HASHMASK; i++)
+    InitializeListHead(&Destroyed);
+
+    Table = NBLockAllBuckets(&OldIrql);
+
+    for (i = 0; i <= Table->Mask; i++)
     {
-        TcpipAcquireSpinLockAtDpcLevel(&NeighborCache[i].Lock);
-        
-        for (PrevNCE = &NeighborCache[i].Cache;
-             (NCE = *PrevNCE) != NULL;)
+        for (NCE = Table->Buckets[i].Cache; NCE != NULL; NCE = NextNCE)
         {
-            if (NCE->Interface == Interface)
-            {
-                /* Unlink and destroy the NCE */
-                *PrevNCE = NCE->Next;
+            NextNCE = NCE->Next;
 
-                NBFlushPacketQueue(NCE, NDIS_STATUS_REQUEST_ABORTED);
-                ExFreePoolWithTag(NCE, NCE_TAG);
-
-                continue;
-            }
-            else
+            if (NCE->Interface == Interface)
             {
-                PrevNCE = &NCE->Next;
+                /* Unlink the NCE, it is destroyed below */
+                NBUnlinkNeighbor(&Table->Buckets[i], NCE);
+                InsertTailList(&Destroyed, &NCE->WheelLink);
             }
         }
-        
-        TcpipReleaseSpinLockFromDpcLevel(&NeighborCache[i].Lock);
     }
-    KeLowerIrql(OldIrql);
+
+    NBUnlockAllBuckets(Table, OldIrql);
+
+    while (!IsListEmpty(&Destroyed))
+    {
+        Entry = RemoveHeadList(&Destroyed);
+        NCE = CONTAINING_RECORD(Entry, NEIGHBOR_CACHE_ENTRY, WheelLink);
+
+        NBFlushPacketQueue(NCE, NDIS_STATUS_REQUEST_ABORTED);
+        NBRetireNeighbor(NCE);
+    }
 }
 
 PNEIGHBOR_CACHE_ENTRY NBAddNeighbor(
@@ -294,7 +701,9 @@ PNEIGHBOR_CACHE_ENTRY NBAddNeighbor(
  */
 {
   PNEIGHBOR_CACHE_ENTRY NCE;
-  ULONG HashValue;
+  PNEIGHBOR_CACHE_BUCKET Bucket;
+  ULONG DueTick;
+  ULONG Entries;
   KIRQL OldIrql;
 
   TI_DbgPrint
@@ -321,24 +730,31 @@ PNEIGHBOR_CACHE_ENTRY NBAddNeighbor(
   else
       memset(NCE->LinkAddress, 0xff, LinkAddressLength);
   NCE->State = State;
+  NCE->Unlinked = FALSE;
   NCE->EventTimer = EventTimer;
-  NCE->EventCount = 0;
+  NCE->LastEventTick = NeighborCacheTick;
+  NCE->WheelSlot = NB_WHEEL_IDLE;
+  TcpipInitializeSpinLock( &NCE->PacketLock );
   InitializeListHead( &NCE->PacketQueue );
 
   TI_DbgPrint(MID_TRACE,("NCE: %x\n", NCE));
 
-  HashValue = *(PULONG)&Address->Address;
-  HashValue ^= HashValue >> 16;
-  HashValue ^= HashValue >> 8;
-  HashValue ^= HashValue >> 4;
-  HashValue &= NB_HASHMASK;
+  Bucket = NBLockBucket(NBHashAddress(Address), &OldIrql);
 
-  TcpipAcquireSpinLock(&NeighborCache[HashValue].Lock, &OldIrql);
+  /* Publish the NCE only after it is fully initialized */
+  NCE->Next = Bucket->Cache;
+  KeMemoryBarrier();
+  Bucket->Cache = NCE;
 
-  NCE->Next = NeighborCache[HashValue].Cache;
-  NeighborCache[HashValue].Cache = NCE;
+  if (NBGetNextEvent(NCE, NeighborCacheTick, &DueTick))
+      NBScheduleNeighbor(NCE, DueTick);
 
-  TcpipReleaseSpinLock(&NeighborCache[HashValue].Lock, OldIrql);
+  Entries = InterlockedIncrement((PLONG)&NeighborCacheStats.Entries);
+
+  TcpipReleaseSpinLock(&Bucket->Lock, OldIrql);
+
+  if (Entries > (NeighborCache->Mask + 1) * NB_MAX_LOAD)
+      NBGrowTable();
 
   return NCE;
 }
@@ -357,93 +773,51 @@ VOID NBUpdateNeighbor(
  *   The link address and state is updated. Any waiting packets are sent
  */
 {
+    PNEIGHBOR_CACHE_BUCKET Bucket;
+    ULONG DueTick;
     KIRQL OldIrql;
-    UINT HashValue;
 
     TI_DbgPrint(DEBUG_NCACHE, ("Called. NCE (0x%X)  LinkAddress (0x%X)  State (0x%X).\n", NCE, LinkAddress, State));
 
-    HashValue  = *(PULONG)(&NCE->Address.Address);
-    HashValue ^= HashValue >> 16;
-    HashValue ^= HashValue >> 8;
-    HashValue ^= HashValue >> 4;
-    HashValue &= NB_HASHMASK;
-
-    TcpipAcquireSpinLock(&NeighborCache[HashValue].Lock, &OldIrql);
+    Bucket = NBLockBucket(NBHashAddress(&NCE->Address), &OldIrql);
 
-    RtlCopyMemory(NCE->LinkAddress, LinkAddress, NCE->LinkAddressLength);
-    NCE->State = State;
-    NCE->EventCount = 0;
-
-    TcpipReleaseSpinLock(&NeighborCache[HashValue].Lock, OldIrql);
-
-    if( !(NCE->State & NUD_INCOMPLETE) )
+    if (NCE->Unlinked)
     {
-        if (NCE->EventTimer) NCE->EventTimer = ARP_COMPLETE_TIMEOUT;
-        NBSendPackets( NCE );
+        TcpipReleaseSpinLock(&Bucket->Lock, OldIrql);
+        return;
     }
-}
 
-VOID
-NBResetNeighborTimeout(PIP_ADDRESS Address)
-{
-    KIRQL OldIrql;
-    UINT HashValue;
-    PNEIGHBOR_CACHE_ENTRY NCE;
+    RtlCopyMemory(NCE->LinkAddress, LinkAddress, NCE->LinkAddressLength);
+    NCE->State = State;
+    NCE->LastEventTick = NeighborCacheTick;
 
-    TI_DbgPrint(DEBUG_NCACHE, ("Resetting NCE timout for 0x%s\n", A2S(Address)));
+    if (!(State & NUD_INCOMPLETE) && NCE->EventTimer)
+        NCE->EventTimer = ARP_COMPLETE_TIMEOUT;
 
-    HashValue  = *(PULONG)(&Address->Address);
-    HashValue ^= HashValue >> 16;
-    HashValue ^= HashValue >> 8;
-    HashValue ^= HashValue >> 4;
-    HashValue &= NB_HASHMASK;
+    if (NBGetNextEvent(NCE, NCE->LastEventTick, &DueTick))
+        NBScheduleNeighbor(NCE, DueTick);
 
-    TcpipAcquireSpinLock(&NeighborCache[HashValue].Lock, &OldIrql);
+    TcpipReleaseSpinLock(&Bucket->Lock, OldIrql);
 
-    for (NCE = NeighborCache[HashValue].Cache;
-         NCE != NULL;
-         NCE = NCE->Next)
-    {
-         if (AddrIsEqual(Address, &NCE->Address))
-         {
-             NCE->EventCount = 0;
-             break;
-         }
-    }
-
-    TcpipReleaseSpinLock(&NeighborCache[HashValue].Lock, OldIrql);
+    if( !(State & NUD_INCOMPLETE) )
+        NBSendPackets( NCE );
 }
 
-PNEIGHBOR_CACHE_ENTRY NBLocateNeighbor(
+static PNEIGHBOR_CACHE_ENTRY NBFindNeighbor(
+  ULONG HashValue,
   PIP_ADDRESS Address,
   PIP_INTERFACE Interface)
 /*
- * FUNCTION: Locates a neighbor in the neighbor cache
- * ARGUMENTS:
- *   Address = Pointer to IP address
- *   Interface = Pointer to IP interface
- * RETURNS:
- *   Pointer to NCE, NULL if not found
+ * FUNCTION: Searches the current table for a neighbor
  * NOTES:
- *   If the NCE is found, it is referenced. The caller is
- *   responsible for dereferencing it again after use
+ *   Must be called at DISPATCH_LEVEL. No lock is required
  */
 {
+  PNEIGHBOR_CACHE_TABLE Table = NeighborCache;
+  PNEIGHBOR_CACHE_BUCKET Bucket = &Table->Buckets[HashValue & Table->Mask];
   PNEIGHBOR_CACHE_ENTRY NCE;
-  UINT HashValue;
-  KIRQL OldIrql;
   PIP_INTERFACE FirstInterface;
 
-  TI_DbgPrint(DEBUG_NCACHE, ("Called. Address (0x%X).\n", Address));
-
-  HashValue = *(PULONG)&Address->Address;
-  HashValue ^= HashValue >> 16;
-  HashValue ^= HashValue >> 8;
-  HashValue ^= HashValue >> 4;
-  HashValue &= NB_HASHMASK;
-
-  TcpipAcquireSpinLock(&NeighborCache[HashValue].Lock, &OldIrql);
-
   /* If there's no adapter specified, we'll look for a match on
    * each one. */
   if (Interface == NULL)
@@ -458,7 +832,7 @@ PNEIGHBOR_CACHE_ENTRY NBLocateNeighbor(
 
   do
   {
-      NCE = NeighborCache[HashValue].Cache;
+      NCE = Bucket->Cache;
       while (NCE != NULL)
       {
          if (NCE->Interface == Interface &&
@@ -466,10 +840,10 @@ PNEIGHBOR_CACHE_ENTRY NBLocateNeighbor(
          {
              break;
          }
- 
+
          NCE = NCE->Next;
       }
-      
+
       if (NCE != NULL)
           break;
   }
@@ -479,7 +853,7 @@ PNEIGHBOR_CACHE_ENTRY NBLocateNeighbor(
   if ((NCE == NULL) && (FirstInterface != NULL))
   {
       /* This time we'll even match loopback NCEs */
-      NCE = NeighborCache[HashValue].Cache;
+      NCE = Bucket->Cache;
       while (NCE != NULL)
       {
          if (AddrIsEqual(Address, &NCE->Address))
@@ -491,7 +865,77 @@ PNEIGHBOR_CACHE_ENTRY NBLocateNeighbor(
       }
   }
 
-  TcpipReleaseSpinLock(&NeighborCache[HashValue].Lock, OldIrql);
+  return NCE;
+}
+
+VOID
+NBResetNeighborTimeout(PIP_ADDRESS Address)
+{
+    PNEIGHBOR_CACHE_TABLE Table;
+    PNEIGHBOR_CACHE_ENTRY NCE;
+    KIRQL OldIrql;
+
+    TI_DbgPrint(DEBUG_NCACHE, ("Resetting NCE timout for 0x%s\n", A2S(Address)));
+
+    /* This runs for every received datagram, so we don't take the
+     * bucket lock. The timer wheel picks up the new tick lazily */
+    KeRaiseIrql(DISPATCH_LEVEL, &OldIrql);
+
+    Table = NeighborCache;
+    for (NCE = Table->Buckets[NBHashAddress(Address) & Table->Mask].Cache;
+         NCE != NULL;
+         NCE = NCE->Next)
+    {
+         if (AddrIsEqual(Address, &NCE->Address))
+         {
+             NCE->LastEventTick = NeighborCacheTick;
+             break;
+         }
+    }
+
+    KeLowerIrql(OldIrql);
+}
+
+PNEIGHBOR_CACHE_ENTRY NBLocateNeighbor(
+  PIP_ADDRESS Address,
+  PIP_INTERFACE Interface)
+/*
+ * FUNCTION: Locates a neighbor in the neighbor cache
+ * ARGUMENTS:
+ *   Address = Pointer to IP address
+ *   Interface = Pointer to IP interface
+ * RETURNS:
+ *   Pointer to NCE, NULL if not found
+ * NOTES:
+ *   If the NCE is found, it is referenced. The caller is
+ *   responsible for dereferencing it again after use
+ */
+{
+  PNEIGHBOR_CACHE_BUCKET Bucket;
+  PNEIGHBOR_CACHE_ENTRY NCE;
+  ULONG HashValue;
+  KIRQL OldIrql;
+
+  TI_DbgPrint(DEBUG_NCACHE, ("Called. Address (0x%X).\n", Address));
+
+  InterlockedIncrement((PLONG)&NeighborCacheStats.Lookups);
+
+  HashValue = NBHashAddress(Address);
+
+  KeRaiseIrql(DISPATCH_LEVEL, &OldIrql);
+  NCE = NBFindNeighbor(HashValue, Address, Interface);
+  KeLowerIrql(OldIrql);
+
+  if (NCE == NULL)
+  {
+      /* We may have raced with a resize, try again under the lock */
+      Bucket = NBLockBucket(HashValue, &OldIrql);
+      NCE = NBFindNeighbor(HashValue, Address, Interface);
+      TcpipReleaseSpinLock(&Bucket->Lock, OldIrql);
+
+      if (NCE == NULL)
+          InterlockedIncrement((PLONG)&NeighborCacheStats.Misses);
+  }
 
   TI_DbgPrint(MAX_TRACE, ("Leaving.\n"));
 
@@ -552,9 +996,7 @@ BOOLEAN NBQueuePacket(
  *   TRUE if the packet was successfully queued, FALSE if not
  */
 {
-  KIRQL OldIrql;
   PNEIGHBOR_PACKET Packet;
-  UINT HashValue;
 
   TI_DbgPrint
       (DEBUG_NCACHE,
@@ -566,20 +1008,11 @@ BOOLEAN NBQueuePacket(
 
   /* FIXME: Should we limit the number of queued packets? */
 
-  HashValue  = *(PULONG)(&NCE->Address.Address);
-  HashValue ^= HashValue >> 16;
-  HashValue ^= HashValue >> 8;
-  HashValue ^= HashValue >> 4;
-  HashValue &= NB_HASHMASK;
-
-  TcpipAcquireSpinLock(&NeighborCache[HashValue].Lock, &OldIrql);
-
   Packet->Complete = PacketComplete;
   Packet->Context = PacketContext;
   Packet->Packet = NdisPacket;
-  InsertTailList( &NCE->PacketQueue, &Packet->Next );
-
-  TcpipReleaseSpinLock(&NeighborCache[HashValue].Lock, OldIrql);
+  ExInterlockedInsertTailList( &NCE->PacketQueue, &Packet->Next,
+                               &NCE->PacketLock );
 
   if( !(NCE->State & NUD_INCOMPLETE) )
       NBSendPackets( NCE );
@@ -597,52 +1030,39 @@ VOID NBRemoveNeighbor(
  *   The NCE must be in a safe state
  */
 {
-  PNEIGHBOR_CACHE_ENTRY *PrevNCE;
-  PNEIGHBOR_CACHE_ENTRY CurNCE;
-  ULONG HashValue;
+  PNEIGHBOR_CACHE_BUCKET Bucket;
+  BOOLEAN Removed;
   KIRQL OldIrql;
 
   TI_DbgPrint(DEBUG_NCACHE, ("Called. NCE (0x%X).\n", NCE));
 
-  HashValue  = *(PULONG)(&NCE->Address.Address);
-  HashValue ^= HashValue >> 16;
-  HashValue ^= HashValue >> 8;
-  HashValue ^= HashValue >> 4;
-  HashValue &= NB_HASHMASK;
-
-  TcpipAcquireSpinLock(&NeighborCache[HashValue].Lock, &OldIrql);
+  Bucket = NBLockBucket(NBHashAddress(&NCE->Address), &OldIrql);
 
   /* Search the list and remove the NCE from the list if found */
-  for (PrevNCE = &NeighborCache[HashValue].Cache;
-    (CurNCE = *PrevNCE) != NULL;
-    PrevNCE = &CurNCE->Next)
-    {
-      if (CurNCE == NCE)
-        {
-          /* Found it, now unlink it from the list */
-          *PrevNCE = CurNCE->Next;
+  Removed = !NCE->Unlinked && NBUnlinkNeighbor(Bucket, NCE);
 
-	  NBFlushPacketQueue( CurNCE, NDIS_STATUS_REQUEST_ABORTED );
-          ExFreePoolWithTag(CurNCE, NCE_TAG);
+  TcpipReleaseSpinLock(&Bucket->Lock, OldIrql);
 
-	  break;
-        }
+  if (Removed)
+    {
+      NBFlushPacketQueue( NCE, NDIS_STATUS_REQUEST_ABORTED );
+      NBRetireNeighbor( NCE );
     }
-
-  TcpipReleaseSpinLock(&NeighborCache[HashValue].Lock, OldIrql);
 }
 
 ULONG NBCopyNeighbors
 (PIP_INTERFACE Interface,
  PIPARP_ENTRY ArpTable)
 {
+  PNEIGHBOR_CACHE_TABLE Table;
   PNEIGHBOR_CACHE_ENTRY CurNCE;
   KIRQL OldIrql;
   UINT Size = 0, i;
 
-  for (i = 0; i <= NB_HASHMASK; i++) {
-      TcpipAcquireSpinLock(&NeighborCache[i].Lock, &OldIrql);
-      for( CurNCE = NeighborCache[i].Cache;
+  Table = NBLockAllBuckets(&OldIrql);
+
+  for (i = 0; i <= Table->Mask; i++) {
+      for( CurNCE = Table->Buckets[i].Cache;
 	   CurNCE;
 	   CurNCE = CurNCE->Next ) {
 	  if( CurNCE->Interface == Interface &&
@@ -665,8 +1085,19 @@ ULONG NBCopyNeighbors
 	      Size++;
 	  }
       }
-      TcpipReleaseSpinLock(&NeighborCache[i].Lock, OldIrql);
   }
-  
+
+  NBUnlockAllBuckets(Table, OldIrql);
+
   return Size;
 }
+
+VOID NBQueryStatistics(
+  PNEIGHBOR_CACHE_STATISTICS Statistics)
+/*
+ * FUNCTION: Returns a snapshot of the neighbor cache counters
+ */
+{
+  *Statistics = NeighborCacheStats;
+  Statistics->Buckets = NeighborCache->Mask + 1;
+}
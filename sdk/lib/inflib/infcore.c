@@ -82,60 +82,424 @@ static const parser_state_func parser_funcs[NB_PARSER_STATES] =
 
 /* PRIVATE FUNCTIONS ********************************************************/
 
-static PINFCACHELINE
-InfpFreeLine (PINFCACHELINE Line)
+/* FNV-1a of the lower case name, names are compared case-insensitively */
+static ULONG
+InfpHashName(PCWSTR Name)
 {
-  PINFCACHELINE Next;
-  PINFCACHEFIELD Field;
+  ULONG Hash = 0x811C9DC5;
 
-  if (Line == NULL)
+  while (*Name != 0)
     {
-      return NULL;
+      Hash = (Hash ^ tolowerW(*Name)) * 0x01000193;
+      Name++;
     }
 
-  Next = Line->Next;
-  if (Line->Key != NULL)
+  return Hash;
+}
+
+
+static ULONG
+InfpHashString(PCWSTR String)
+{
+  ULONG Hash = 0x811C9DC5;
+
+  while (*String != 0)
     {
-      FREE (Line->Key);
-      Line->Key = NULL;
+      Hash = (Hash ^ *String) * 0x01000193;
+      String++;
     }
 
-  /* Remove data fields */
-  while (Line->FirstField != NULL)
+  return Hash;
+}
+
+
+/* Smallest power of two that keeps the tables at most half full */
+static UINT
+InfpTableSize(UINT Count)
+{
+  UINT Size = 16;
+
+  while (Size < Count * 2)
     {
-      Field = Line->FirstField->Next;
-      FREE (Line->FirstField);
-      Line->FirstField = Field;
+      Size *= 2;
     }
-  Line->LastField = NULL;
 
-  FREE (Line);
+  return Size;
+}
+
+
+static PVOID *
+InfpAllocTable(UINT Size)
+{
+  PVOID *Table;
 
-  return Next;
+  Table = (PVOID *)MALLOC(Size * sizeof(PVOID));
+  if (Table != NULL)
+    {
+      ZEROMEMORY(Table, Size * sizeof(PVOID));
+    }
+
+  return Table;
 }
 
 
-PINFCACHESECTION
-InfpFreeSection (PINFCACHESECTION Section)
+static PVOID
+InfpArenaAlloc(PINFCACHE Cache,
+               ULONG Size)
 {
-  PINFCACHESECTION Next;
+  PINFCACHEARENA Block = Cache->Arena;
+  ULONG BlockSize;
+  PVOID Ptr;
 
-  if (Section == NULL)
+  Size = (Size + sizeof(PVOID) - 1) & ~(ULONG)(sizeof(PVOID) - 1);
+
+  if (Block == NULL || Block->Size - Block->Used < Size)
+    {
+      /* Large allocations get a block of their own, placed behind the
+         current one so that its free space is not lost */
+      BlockSize = (Size > INF_ARENA_BLOCK_SIZE / 4) ? Size : INF_ARENA_BLOCK_SIZE;
+      Block = (PINFCACHEARENA)MALLOC(sizeof(INFCACHEARENA) + BlockSize);
+      if (Block == NULL)
+        {
+          DPRINT1("MALLOC() failed\n");
+          return NULL;
+        }
+      Block->Size = BlockSize;
+      Block->Used = 0;
+
+      if (BlockSize != INF_ARENA_BLOCK_SIZE && Cache->Arena != NULL)
+        {
+          Block->Next = Cache->Arena->Next;
+          Cache->Arena->Next = Block;
+        }
+      else
+        {
+          Block->Next = Cache->Arena;
+          Cache->Arena = Block;
+        }
+    }
+
+  Ptr = (PUCHAR)(Block + 1) + Block->Used;
+  Block->Used += Size;
+
+  return Ptr;
+}
+
+
+/* Copies a key or field into the arena, or finds the copy made earlier
+   when the cache interns its strings. Interned strings are shared, so
+   nothing may write to them. */
+static PWCHAR
+InfpAllocString(PINFCACHE Cache,
+                PCWSTR String)
+{
+  PINFCACHESTRING Entry, Next, *Table;
+  ULONG Length, Hash;
+  PWCHAR Copy;
+  UINT Size, i;
+
+  Length = (ULONG)strlenW(String);
+
+  if (!(Cache->Flags & INF_CACHE_INTERN_STRINGS))
+    {
+      Copy = (PWCHAR)InfpArenaAlloc(Cache, (Length + 1) * sizeof(WCHAR));
+      if (Copy != NULL)
+        {
+          MEMCPY(Copy, String, (Length + 1) * sizeof(WCHAR));
+        }
+      return Copy;
+    }
+
+  Hash = InfpHashString(String);
+  if (Cache->StringTable != NULL)
+    {
+      for (Entry = Cache->StringTable[Hash & (Cache->StringTableSize - 1)];
+           Entry != NULL;
+           Entry = Entry->Next)
+        {
+          if (Entry->Hash == Hash && strcmpW(Entry->Data, String) == 0)
+            {
+              return Entry->Data;
+            }
+        }
+    }
+
+  Entry = (PINFCACHESTRING)InfpArenaAlloc(Cache,
+                                          (ULONG)FIELD_OFFSET(INFCACHESTRING,
+                                                              Data[Length + 1]));
+  if (Entry == NULL)
     {
       return NULL;
     }
+  Entry->Hash = Hash;
+  MEMCPY(Entry->Data, String, (Length + 1) * sizeof(WCHAR));
+
+  Cache->StringCount++;
+  if (Cache->StringCount * 2 > Cache->StringTableSize)
+    {
+      Size = InfpTableSize(Cache->StringCount);
+      Table = (PINFCACHESTRING *)InfpAllocTable(Size);
+      if (Table != NULL)
+        {
+          for (i = 0; i < Cache->StringTableSize; i++)
+            {
+              for (Next = Cache->StringTable[i]; Next != NULL;)
+                {
+                  PINFCACHESTRING Moved = Next;
+
+                  Next = Next->Next;
+                  Moved->Next = Table[Moved->Hash & (Size - 1)];
+                  Table[Moved->Hash & (Size - 1)] = Moved;
+                }
+            }
+
+          if (Cache->StringTable != NULL)
+            {
+              FREE(Cache->StringTable);
+            }
+          Cache->StringTable = Table;
+          Cache->StringTableSize = Size;
+        }
+    }
+
+  /* Without a table the string just isn't shared */
+  if (Cache->StringTable != NULL)
+    {
+      Entry->Next = Cache->StringTable[Hash & (Cache->StringTableSize - 1)];
+      Cache->StringTable[Hash & (Cache->StringTableSize - 1)] = Entry;
+    }
+
+  return Entry->Data;
+}
+
+
+PINFCACHE
+InfpCreateCache(LANGID LanguageId,
+                ULONG Flags)
+{
+  PINFCACHE Cache;
+
+  Cache = (PINFCACHE)MALLOC(sizeof(INFCACHE));
+  if (Cache == NULL)
+    {
+      DPRINT1("MALLOC() failed\n");
+      return NULL;
+    }
+
+  ZEROMEMORY(Cache,
+             sizeof(INFCACHE));
+  Cache->LanguageId = LanguageId;
+  Cache->Flags = Flags;
+
+  return Cache;
+}
+
+
+VOID
+InfpFreeCache(PINFCACHE Cache)
+{
+  PINFCACHESECTION Section;
+  PINFCACHEARENA Block;
+
+  if (Cache == NULL)
+    {
+      return;
+    }
+
+  /* The sections, lines and strings are all in the arena, only the
+     indexes are allocated separately */
+  for (Section = Cache->FirstSection; Section != NULL; Section = Section->Next)
+    {
+      if (Section->LineById != NULL)
+        FREE(Section->LineById);
+      if (Section->KeyTable != NULL)
+        FREE(Section->KeyTable);
+    }
+
+  if (Cache->SectionById != NULL)
+    FREE(Cache->SectionById);
+  if (Cache->SectionTable != NULL)
+    FREE(Cache->SectionTable);
+  if (Cache->StringTable != NULL)
+    FREE(Cache->StringTable);
+
+  while (Cache->Arena != NULL)
+    {
+      Block = Cache->Arena;
+      Cache->Arena = Block->Next;
+      FREE(Block);
+    }
+
+  FREE(Cache);
+}
+
+
+static VOID
+InfpIndexSection(PINFCACHE Cache,
+                 PINFCACHESECTION Section)
+{
+  PINFCACHESECTION *Table, Other;
+  UINT Size, Count = Section->Id;
+
+  /* Small INFs are cheaper to scan than to index */
+  if (Count < INF_HASH_THRESHOLD)
+    {
+      return;
+    }
+
+  /* Rebuild the indexes from the list whenever they fill up. Should that
+     fail, the old ones stay usable, just slower. */
+  Table = NULL;
+  if (Count * 2 > Cache->SectionTableSize)
+    {
+      Size = InfpTableSize(Count);
+      Table = (PINFCACHESECTION *)InfpAllocTable(Size);
+      if (Table != NULL)
+        {
+          if (Cache->SectionTable != NULL)
+            FREE(Cache->SectionTable);
+          Cache->SectionTable = Table;
+          Cache->SectionTableSize = Size;
+
+          for (Other = Cache->FirstSection; Other != NULL; Other = Other->Next)
+            {
+              Other->HashNext = Table[Other->Hash & (Size - 1)];
+              Table[Other->Hash & (Size - 1)] = Other;
+            }
+        }
+    }
+
+  if (Table == NULL && Cache->SectionTable != NULL)
+    {
+      Section->HashNext = Cache->SectionTable[Section->Hash & (Cache->SectionTableSize - 1)];
+      Cache->SectionTable[Section->Hash & (Cache->SectionTableSize - 1)] = Section;
+    }
+
+  if (Count > Cache->SectionByIdSize)
+    {
+      Size = InfpTableSize(Count);
+      Table = (PINFCACHESECTION *)InfpAllocTable(Size);
+      if (Table != NULL)
+        {
+          if (Cache->SectionById != NULL)
+            FREE(Cache->SectionById);
+          Cache->SectionById = Table;
+          Cache->SectionByIdSize = Size;
+
+          for (Other = Cache->FirstSection; Other != NULL; Other = Other->Next)
+            {
+              Table[Other->Id - 1] = Other;
+            }
+        }
+    }
+  else
+    {
+      Cache->SectionById[Count - 1] = Section;
+    }
+}
+
+
+static PINFCACHELINE
+InfpLookupKey(PINFCACHESECTION Section,
+              PCWSTR Key,
+              ULONG Hash)
+{
+  PINFCACHELINE Line;
+
+  for (Line = Section->KeyTable[Hash & (Section->KeyTableSize - 1)];
+       Line != NULL;
+       Line = Line->HashNext)
+    {
+      if (Line->KeyHash == Hash && strcmpiW(Line->Key, Key) == 0)
+        {
+          return Line;
+        }
+    }
+
+  return NULL;
+}
+
 
-  /* Release all keys */
-  Next = Section->Next;
-  while (Section->FirstLine != NULL)
+static VOID
+InfpIndexKey(PINFCACHESECTION Section,
+             PINFCACHELINE Line)
+{
+  PINFCACHELINE *Table, Other;
+  UINT Size;
+
+  Section->KeyCount++;
+  if (Section->KeyCount < INF_HASH_THRESHOLD)
     {
-      Section->FirstLine = InfpFreeLine (Section->FirstLine);
+      return;
     }
-  Section->LastLine = NULL;
 
-  FREE (Section);
+  if (Section->KeyCount * 2 > Section->KeyTableSize)
+    {
+      Size = InfpTableSize(Section->KeyCount);
+      Table = (PINFCACHELINE *)InfpAllocTable(Size);
+      if (Table != NULL)
+        {
+          if (Section->KeyTable != NULL)
+            FREE(Section->KeyTable);
+          Section->KeyTable = Table;
+          Section->KeyTableSize = Size;
+
+          /* Only the first line of a key is indexed, that's the one
+             InfpFindKeyLine returns */
+          for (Other = Section->FirstLine; Other != NULL; Other = Other->Next)
+            {
+              if (Other->Key != NULL &&
+                  InfpLookupKey(Section, Other->Key, Other->KeyHash) == NULL)
+                {
+                  Other->HashNext = Table[Other->KeyHash & (Size - 1)];
+                  Table[Other->KeyHash & (Size - 1)] = Other;
+                }
+            }
+          return;
+        }
+    }
 
-  return Next;
+  if (Section->KeyTable != NULL &&
+      InfpLookupKey(Section, Line->Key, Line->KeyHash) == NULL)
+    {
+      Line->HashNext = Section->KeyTable[Line->KeyHash & (Section->KeyTableSize - 1)];
+      Section->KeyTable[Line->KeyHash & (Section->KeyTableSize - 1)] = Line;
+    }
+}
+
+
+static VOID
+InfpIndexLine(PINFCACHESECTION Section,
+              PINFCACHELINE Line)
+{
+  PINFCACHELINE *Table, Other;
+  UINT Size;
+
+  if (Line->Id < INF_HASH_THRESHOLD)
+    {
+      return;
+    }
+
+  if (Line->Id > Section->LineByIdSize)
+    {
+      Size = InfpTableSize(Line->Id);
+      Table = (PINFCACHELINE *)InfpAllocTable(Size);
+      if (Table != NULL)
+        {
+          if (Section->LineById != NULL)
+            FREE(Section->LineById);
+          Section->LineById = Table;
+          Section->LineByIdSize = Size;
+
+          for (Other = Section->FirstLine; Other != NULL; Other = Other->Next)
+            {
+              Table[Other->Id - 1] = Other;
+            }
+        }
+      return;
+    }
+
+  Section->LineById[Line->Id - 1] = Line;
 }
 
 
@@ -144,12 +508,29 @@ InfpFindSection(PINFCACHE Cache,
                 PCWSTR Name)
 {
   PINFCACHESECTION Section = NULL;
+  ULONG Hash;
 
   if (Cache == NULL || Name == NULL)
     {
       return NULL;
     }
 
+  if (Cache->SectionTable != NULL)
+    {
+      Hash = InfpHashName(Name);
+      for (Section = Cache->SectionTable[Hash & (Cache->SectionTableSize - 1)];
+           Section != NULL;
+           Section = Section->HashNext)
+        {
+          if (Section->Hash == Hash && strcmpiW(Section->Name, Name) == 0)
+            {
+              return Section;
+            }
+        }
+
+      return NULL;
+    }
+
   /* iterate through list of sections */
   Section = Cache->FirstSection;
   while (Section != NULL)
@@ -183,15 +564,15 @@ InfpAddSection(PINFCACHE Cache,
   /* Allocate and initialize the new section */
   Size = (ULONG)FIELD_OFFSET(INFCACHESECTION,
                              Name[strlenW(Name) + 1]);
-  Section = (PINFCACHESECTION)MALLOC(Size);
+  Section = (PINFCACHESECTION)InfpArenaAlloc(Cache, Size);
   if (Section == NULL)
     {
-      DPRINT("MALLOC() failed\n");
       return NULL;
     }
   ZEROMEMORY (Section,
               Size);
   Section->Id = ++Cache->NextSectionId;
+  Section->Hash = InfpHashName(Name);
 
   /* Copy section name */
   strcpyW(Section->Name, Name);
@@ -209,12 +590,15 @@ InfpAddSection(PINFCACHE Cache,
       Cache->LastSection = Section;
     }
 
+  InfpIndexSection(Cache, Section);
+
   return Section;
 }
 
 
 PINFCACHELINE
-InfpAddLine(PINFCACHESECTION Section)
+InfpAddLine(PINFCACHE Cache,
+            PINFCACHESECTION Section)
 {
   PINFCACHELINE Line;
 
@@ -224,10 +608,9 @@ InfpAddLine(PINFCACHESECTION Section)
       return NULL;
     }
 
-  Line = (PINFCACHELINE)MALLOC(sizeof(INFCACHELINE));
+  Line = (PINFCACHELINE)InfpArenaAlloc(Cache, sizeof(INFCACHELINE));
   if (Line == NULL)
     {
-      DPRINT("MALLOC() failed\n");
       return NULL;
     }
   ZEROMEMORY(Line,
@@ -248,6 +631,8 @@ InfpAddLine(PINFCACHESECTION Section)
     }
   Section->LineCount++;
 
+  InfpIndexLine(Section, Line);
+
   return Line;
 }
 
@@ -256,6 +641,12 @@ InfpFindSectionById(PINFCACHE Cache, UINT Id)
 {
     PINFCACHESECTION Section;
 
+    if (Id != 0 && Id <= Cache->SectionByIdSize &&
+        Cache->SectionById[Id - 1] != NULL)
+    {
+        return Cache->SectionById[Id - 1];
+    }
+
     for (Section = Cache->FirstSection;
          Section != NULL;
          Section = Section->Next)
@@ -293,6 +684,12 @@ InfpFindLineById(PINFCACHESECTION Section, UINT Id)
 {
     PINFCACHELINE Line;
 
+    if (Id != 0 && Id <= Section->LineByIdSize &&
+        Section->LineById[Id - 1] != NULL)
+    {
+        return Section->LineById[Id - 1];
+    }
+
     for (Line = Section->FirstLine;
          Line != NULL;
          Line = Line->Next)
@@ -321,7 +718,9 @@ InfpGetLineForContext(PINFCONTEXT Context)
 }
 
 PVOID
-InfpAddKeyToLine(PINFCACHELINE Line,
+InfpAddKeyToLine(PINFCACHE Cache,
+                 PINFCACHESECTION Section,
+                 PINFCACHELINE Line,
                  PCWSTR Key)
 {
   if (Line == NULL)
@@ -336,37 +735,58 @@ InfpAddKeyToLine(PINFCACHELINE Line,
       return NULL;
     }
 
-  Line->Key = (PWCHAR)MALLOC((strlenW(Key) + 1) * sizeof(WCHAR));
+  Line->Key = InfpAllocString(Cache, Key);
   if (Line->Key == NULL)
     {
-      DPRINT1("MALLOC() failed\n");
       return NULL;
     }
+  Line->KeyHash = InfpHashName(Key);
 
-  strcpyW(Line->Key, Key);
+  InfpIndexKey(Section, Line);
 
   return (PVOID)Line->Key;
 }
 
 
 PVOID
-InfpAddFieldToLine(PINFCACHELINE Line,
+InfpAddFieldToLine(PINFCACHE Cache,
+                   PINFCACHELINE Line,
                    PCWSTR Data)
 {
   PINFCACHEFIELD Field;
   ULONG Size;
 
-  Size = (ULONG)FIELD_OFFSET(INFCACHEFIELD,
-                             Data[strlenW(Data) + 1]);
-  Field = (PINFCACHEFIELD)MALLOC(Size);
+  /* Unless the data is shared, it follows the field directly */
+  if (Cache->Flags & INF_CACHE_INTERN_STRINGS)
+    {
+      Size = sizeof(INFCACHEFIELD);
+    }
+  else
+    {
+      Size = sizeof(INFCACHEFIELD) + ((ULONG)strlenW(Data) + 1) * sizeof(WCHAR);
+    }
+
+  Field = (PINFCACHEFIELD)InfpArenaAlloc(Cache, Size);
   if (Field == NULL)
     {
-      DPRINT1("MALLOC() failed\n");
       return NULL;
     }
   ZEROMEMORY (Field,
-              Size);
-  strcpyW(Field->Data, Data);
+              sizeof(INFCACHEFIELD));
+
+  if (Cache->Flags & INF_CACHE_INTERN_STRINGS)
+    {
+      Field->Data = InfpAllocString(Cache, Data);
+      if (Field->Data == NULL)
+        {
+          return NULL;
+        }
+    }
+  else
+    {
+      Field->Data = (PWCHAR)(Field + 1);
+      strcpyW(Field->Data, Data);
+    }
 
   /* Append key */
   if (Line->FirstField == NULL)
@@ -392,6 +812,11 @@ InfpFindKeyLine(PINFCACHESECTION Section,
 {
   PINFCACHELINE Line;
 
+  if (Section->KeyTable != NULL)
+    {
+      return InfpLookupKey(Section, Key, InfpHashName(Key));
+    }
+
   Line = Section->FirstLine;
   while (Line != NULL)
     {
@@ -445,7 +870,7 @@ __inline static int is_eol( struct parser *parser, const WCHAR *ptr )
   return (ptr >= parser->end ||
           *ptr == CONTROL_Z ||
           *ptr == '\n' ||
-          (*ptr == '\r' && *(ptr + 1) == '\n') ||
+          (*ptr == '\r' && ptr + 1 < parser->end && *(ptr + 1) == '\n') ||
           *ptr == 0);
 }
 
@@ -526,7 +951,7 @@ static struct field *add_field_from_token( struct parser *parser, int is_key )
           return NULL;
         }
 
-      parser->line = InfpAddLine(parser->cur_section);
+      parser->line = InfpAddLine(parser->file, parser->cur_section);
       if (parser->line == NULL)
         goto error;
     }
@@ -537,11 +962,12 @@ static struct field *add_field_from_token( struct parser *parser, int is_key )
 
   if (is_key)
     {
-      field = InfpAddKeyToLine(parser->line, parser->token);
+      field = InfpAddKeyToLine(parser->file, parser->cur_section,
+                               parser->line, parser->token);
     }
   else
     {
-      field = InfpAddFieldToLine(parser->line, parser->token);
+      field = InfpAddFieldToLine(parser->file, parser->line, parser->token);
     }
 
   if (field != NULL)
@@ -262,26 +262,18 @@ InfpFindFirstMatchLine(PINFCONTEXT ContextIn,
   if (Section == NULL)
       return INF_STATUS_INVALID_PARAMETER;
 
-  CacheLine = Section->FirstLine;
-  while (CacheLine != NULL)
-    {
-      if (CacheLine->Key != NULL && strcmpiW (CacheLine->Key, Key) == 0)
-        {
-
-          if (ContextIn != ContextOut)
-            {
-              ContextOut->Inf = ContextIn->Inf;
-              ContextOut->Section = ContextIn->Section;
-            }
-          ContextOut->Line = CacheLine->Id;
-
-          return INF_STATUS_SUCCESS;
-        }
+  CacheLine = InfpFindKeyLine(Section, Key);
+  if (CacheLine == NULL)
+    return INF_STATUS_NOT_FOUND;
 
-      CacheLine = CacheLine->Next;
+  if (ContextIn != ContextOut)
+    {
+      ContextOut->Inf = ContextIn->Inf;
+      ContextOut->Section = ContextIn->Section;
     }
+  ContextOut->Line = CacheLine->Id;
 
-  return INF_STATUS_NOT_FOUND;
+  return INF_STATUS_SUCCESS;
 }
 
 
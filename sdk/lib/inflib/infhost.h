@@ -14,6 +14,10 @@ extern "C" {
 
 #include "infcommon.h"
 
+/* InfHostOpenFileEx flags */
+#define INF_HOST_MAP_FILE        0x00000001  /* parse a read-only mapping, not a copy */
+#define INF_HOST_INTERN_STRINGS  0x00000002  /* share identical keys and values */
+
 extern int InfHostOpenBufferedFile(PHINF InfHandle,
                                    void *Buffer,
                                    ULONG BufferSize,
@@ -23,6 +27,11 @@ extern int InfHostOpenFile(PHINF InfHandle,
                            const CHAR *FileName,
                            LANGID LanguageId,
                            ULONG *ErrorLine);
+extern int InfHostOpenFileEx(PHINF InfHandle,
+                             const CHAR *FileName,
+                             LANGID LanguageId,
+                             ULONG Flags,
+                             ULONG *ErrorLine);
 extern int InfHostWriteFile(HINF InfHandle,
                             const CHAR *FileName,
                             const CHAR *HeaderComment);
@@ -11,107 +11,166 @@
 #include "inflib.h"
 #include "infhost.h"
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #define NDEBUG
 #include <debug.h>
 
-/* PUBLIC FUNCTIONS *********************************************************/
+/* PRIVATE FUNCTIONS ********************************************************/
 
-int
-InfHostOpenBufferedFile(PHINF InfHandle,
-                        void *Buffer,
-                        ULONG BufferSize,
-                        LANGID LanguageId,
-                        ULONG *ErrorLine)
+/* Decodes an ANSI or UTF-16 buffer and parses it. A UTF-16 buffer is
+   parsed in place, so it may be a read-only mapping of the file. */
+static INFSTATUS
+InfpHostParseBuffer(PINFCACHE Cache,
+                    CHAR *FileBuffer,
+                    ULONG FileBufferLength,
+                    ULONG *ErrorLine)
 {
   INFSTATUS Status;
-  PINFCACHE Cache;
-  WCHAR *FileBuffer;
-  ULONG FileBufferSize;
-
-  *InfHandle = NULL;
-  *ErrorLine = (ULONG)-1;
-
-  /* Allocate file buffer */
-  FileBufferSize = BufferSize + 2;
-  FileBuffer = MALLOC(FileBufferSize);
-  if (FileBuffer == NULL)
-    {
-      DPRINT1("MALLOC() failed\n");
-      return(INF_STATUS_INSUFFICIENT_RESOURCES);
-    }
-
-  MEMCPY(FileBuffer, Buffer, BufferSize);
 
-  /* Append string terminator */
-  FileBuffer[BufferSize] = 0;
-  FileBuffer[BufferSize + 1] = 0;
-
-  /* Allocate infcache header */
-  Cache = (PINFCACHE)MALLOC(sizeof(INFCACHE));
-  if (Cache == NULL)
-    {
-      DPRINT1("MALLOC() failed\n");
-      FREE(FileBuffer);
-      return(INF_STATUS_INSUFFICIENT_RESOURCES);
-    }
-
-  /* Initialize inicache header */
-  ZEROMEMORY(Cache,
-             sizeof(INFCACHE));
-
-    Cache->LanguageId = LanguageId;
-
-  /* Parse the inf buffer */
-    if (!RtlIsTextUnicode(FileBuffer, (INT)FileBufferSize, NULL))
+  if (!RtlIsTextUnicode(FileBuffer, (INT)FileBufferLength, NULL))
     {
 //        static const BYTE utf8_bom[3] = { 0xef, 0xbb, 0xbf };
         WCHAR *new_buff;
 //        UINT codepage = CP_ACP;
         UINT offset = 0;
 
-//        if (BufferSize > sizeof(utf8_bom) && !memcmp(FileBuffer, utf8_bom, sizeof(utf8_bom) ))
+//        if (FileBufferLength > sizeof(utf8_bom) && !memcmp(FileBuffer, utf8_bom, sizeof(utf8_bom) ))
 //        {
 //            codepage = CP_UTF8;
 //            offset = sizeof(utf8_bom);
 //        }
 
-        new_buff = MALLOC(FileBufferSize * sizeof(WCHAR));
+        new_buff = MALLOC(FileBufferLength * sizeof(WCHAR));
         if (new_buff != NULL)
         {
             ULONG len;
             Status = RtlMultiByteToUnicodeN(new_buff,
-                                            FileBufferSize * sizeof(WCHAR),
+                                            FileBufferLength * sizeof(WCHAR),
                                             &len,
                                             (char *)FileBuffer + offset,
-                                            FileBufferSize - offset);
+                                            FileBufferLength - offset);
 
             Status = InfpParseBuffer(Cache,
                                      new_buff,
                                      new_buff + len / sizeof(WCHAR),
                                      ErrorLine);
+
             FREE(new_buff);
         }
         else
             Status = INF_STATUS_INSUFFICIENT_RESOURCES;
     }
-    else
+  else
     {
-        WCHAR *new_buff = (WCHAR *)FileBuffer;
+        const WCHAR *new_buff = (const WCHAR *)FileBuffer;
         /* UCS-16 files should start with the Unicode BOM; we should skip it */
         if (*new_buff == 0xfeff)
         {
             new_buff++;
-            FileBufferSize -= sizeof(WCHAR);
+            FileBufferLength -= sizeof(WCHAR);
         }
         Status = InfpParseBuffer(Cache,
                                  new_buff,
-                                 (WCHAR*)((char*)new_buff + FileBufferSize),
+                                 (const WCHAR*)((const char*)new_buff + FileBufferLength),
                                  ErrorLine);
     }
 
+  return Status;
+}
+
+
+#ifndef _WIN32
+/* Parses a read-only mapping of the file instead of a copy. Returns FALSE
+   when the file can't be mapped, so the caller reads it instead. */
+static BOOLEAN
+InfpHostParseMappedFile(PINFCACHE Cache,
+                        const CHAR *FileName,
+                        ULONG *ErrorLine,
+                        INFSTATUS *Status)
+{
+  struct stat Stat;
+  void *View;
+  int File;
+
+  File = open(FileName, O_RDONLY);
+  if (File < 0)
+    {
+      return FALSE;
+    }
+
+  if (fstat(File, &Stat) != 0 || Stat.st_size == 0 || Stat.st_size > 0x7FFFFFFF)
+    {
+      close(File);
+      return FALSE;
+    }
+
+  View = mmap(NULL, (size_t)Stat.st_size, PROT_READ, MAP_PRIVATE, File, 0);
+  close(File);
+  if (View == MAP_FAILED)
+    {
+      return FALSE;
+    }
+
+  *Status = InfpHostParseBuffer(Cache, View, (ULONG)Stat.st_size, ErrorLine);
+
+  munmap(View, (size_t)Stat.st_size);
+  return TRUE;
+}
+#endif
+
+
+/* PUBLIC FUNCTIONS *********************************************************/
+
+int
+InfHostOpenBufferedFile(PHINF InfHandle,
+                        void *Buffer,
+                        ULONG BufferSize,
+                        LANGID LanguageId,
+                        ULONG *ErrorLine)
+{
+  INFSTATUS Status;
+  PINFCACHE Cache;
+  CHAR *FileBuffer;
+  ULONG FileBufferSize;
+
+  *InfHandle = NULL;
+  *ErrorLine = (ULONG)-1;
+
+  /* Allocate file buffer */
+  FileBufferSize = BufferSize + 2;
+  FileBuffer = MALLOC(FileBufferSize);
+  if (FileBuffer == NULL)
+    {
+      DPRINT1("MALLOC() failed\n");
+      return(INF_STATUS_INSUFFICIENT_RESOURCES);
+    }
+
+  MEMCPY(FileBuffer, Buffer, BufferSize);
+
+  /* Append string terminator */
+  FileBuffer[BufferSize] = 0;
+  FileBuffer[BufferSize + 1] = 0;
+
+  /* Allocate infcache header */
+  Cache = InfpCreateCache(LanguageId, 0);
+  if (Cache == NULL)
+    {
+      FREE(FileBuffer);
+      return(INF_STATUS_INSUFFICIENT_RESOURCES);
+    }
+
+  /* Parse the inf buffer */
+  Status = InfpHostParseBuffer(Cache, FileBuffer, FileBufferSize, ErrorLine);
+
   if (!INF_SUCCESS(Status))
     {
-      FREE(Cache);
+      InfpFreeCache(Cache);
       Cache = NULL;
     }
 
@@ -125,10 +184,11 @@ InfHostOpenBufferedFile(PHINF InfHandle,
 
 
 int
-InfHostOpenFile(PHINF InfHandle,
-                const CHAR *FileName,
-                LANGID LanguageId,
-                ULONG *ErrorLine)
+InfHostOpenFileEx(PHINF InfHandle,
+                  const CHAR *FileName,
+                  LANGID LanguageId,
+                  ULONG Flags,
+                  ULONG *ErrorLine)
 {
   FILE *File;
   CHAR *FileBuffer;
@@ -140,11 +200,28 @@ InfHostOpenFile(PHINF InfHandle,
   *InfHandle = NULL;
   *ErrorLine = (ULONG)-1;
 
+  /* Allocate infcache header */
+  Cache = InfpCreateCache(LanguageId,
+                          (Flags & INF_HOST_INTERN_STRINGS) ? INF_CACHE_INTERN_STRINGS : 0);
+  if (Cache == NULL)
+    {
+      return -1;
+    }
+
+#ifndef _WIN32
+  if ((Flags & INF_HOST_MAP_FILE) &&
+      InfpHostParseMappedFile(Cache, FileName, ErrorLine, &Status))
+    {
+      goto done;
+    }
+#endif
+
   /* Open the inf file */
   File = fopen(FileName, "rb");
   if (NULL == File)
     {
       DPRINT1("fopen() failed (errno %d)\n", errno);
+      InfpFreeCache(Cache);
       return -1;
     }
 
@@ -155,6 +232,7 @@ InfHostOpenFile(PHINF InfHandle,
     {
       DPRINT1("fseek() to EOF failed (errno %d)\n", errno);
       fclose(File);
+      InfpFreeCache(Cache);
       return -1;
     }
 
@@ -163,6 +241,7 @@ InfHostOpenFile(PHINF InfHandle,
     {
       DPRINT1("ftell() failed (errno %d)\n", errno);
       fclose(File);
+      InfpFreeCache(Cache);
       return -1;
     }
   DPRINT("File size: %u\n", (UINT)FileLength);
@@ -172,6 +251,7 @@ InfHostOpenFile(PHINF InfHandle,
     {
       DPRINT1("fseek() to BOF failed (errno %d)\n", errno);
       fclose(File);
+      InfpFreeCache(Cache);
       return -1;
     }
 
@@ -182,6 +262,7 @@ InfHostOpenFile(PHINF InfHandle,
     {
       DPRINT1("MALLOC() failed\n");
       fclose(File);
+      InfpFreeCache(Cache);
       return -1;
     }
 
@@ -191,6 +272,7 @@ InfHostOpenFile(PHINF InfHandle,
       DPRINT1("fread() failed (errno %d)\n", errno);
       FREE(FileBuffer);
       fclose(File);
+      InfpFreeCache(Cache);
       return -1;
     }
 
@@ -200,104 +282,41 @@ InfHostOpenFile(PHINF InfHandle,
   FileBuffer[FileLength] = 0;
   FileBuffer[FileLength + 1] = 0;
 
-  /* Allocate infcache header */
-  Cache = (PINFCACHE)MALLOC(sizeof(INFCACHE));
-  if (Cache == NULL)
-    {
-      DPRINT1("MALLOC() failed\n");
-      FREE(FileBuffer);
-      return -1;
-    }
-
-  /* Initialize inicache header */
-  ZEROMEMORY(Cache,
-             sizeof(INFCACHE));
-
-    Cache->LanguageId = LanguageId;
-
   /* Parse the inf buffer */
-    if (!RtlIsTextUnicode(FileBuffer, (INT)FileBufferLength, NULL))
-    {
-//        static const BYTE utf8_bom[3] = { 0xef, 0xbb, 0xbf };
-        WCHAR *new_buff;
-//        UINT codepage = CP_ACP;
-        UINT offset = 0;
-
-//        if (FileLength > sizeof(utf8_bom) && !memcmp(FileBuffer, utf8_bom, sizeof(utf8_bom) ))
-//        {
-//            codepage = CP_UTF8;
-//            offset = sizeof(utf8_bom);
-//        }
+  Status = InfpHostParseBuffer(Cache, FileBuffer, FileBufferLength, ErrorLine);
 
-        new_buff = MALLOC(FileBufferLength * sizeof(WCHAR));
-        if (new_buff != NULL)
-        {
-            ULONG len;
-            Status = RtlMultiByteToUnicodeN(new_buff,
-                                            FileBufferLength * sizeof(WCHAR),
-                                            &len,
-                                            (char *)FileBuffer + offset,
-                                            FileBufferLength - offset);
-
-            Status = InfpParseBuffer(Cache,
-                                     new_buff,
-                                     new_buff + len / sizeof(WCHAR),
-                                     ErrorLine);
-
-            FREE(new_buff);
-        }
-        else
-            Status = INF_STATUS_INSUFFICIENT_RESOURCES;
-    }
-    else
-    {
-        WCHAR *new_buff = (WCHAR *)FileBuffer;
-        /* UCS-16 files should start with the Unicode BOM; we should skip it */
-        if (*new_buff == 0xfeff)
-        {
-            new_buff++;
-            FileBufferLength -= sizeof(WCHAR);
-        }
-        Status = InfpParseBuffer(Cache,
-                                 new_buff,
-                                 (WCHAR*)((char*)new_buff + FileBufferLength),
-                                 ErrorLine);
-    }
+  /* Free file buffer */
+  FREE(FileBuffer);
 
+#ifndef _WIN32
+done:
+#endif
   if (!INF_SUCCESS(Status))
     {
-      FREE(Cache);
+      InfpFreeCache(Cache);
       Cache = NULL;
     }
 
-  /* Free file buffer */
-  FREE(FileBuffer);
-
   *InfHandle = (HINF)Cache;
 
   return INF_SUCCESS(Status) ? 0 : -1;
 }
 
 
-void
-InfHostCloseFile(HINF InfHandle)
+int
+InfHostOpenFile(PHINF InfHandle,
+                const CHAR *FileName,
+                LANGID LanguageId,
+                ULONG *ErrorLine)
 {
-  PINFCACHE Cache;
-
-  Cache = (PINFCACHE)InfHandle;
+  return InfHostOpenFileEx(InfHandle, FileName, LanguageId, 0, ErrorLine);
+}
 
-  if (Cache == NULL)
-    {
-      return;
-    }
 
-  while (Cache->FirstSection != NULL)
-    {
-      Cache->FirstSection = InfpFreeSection(Cache->FirstSection);
-    }
-  Cache->LastSection = NULL;
-
-  FREE(Cache);
+void
+InfHostCloseFile(HINF InfHandle)
+{
+  InfpFreeCache((PINFCACHE)InfHandle);
 }
 
 /* EOF */
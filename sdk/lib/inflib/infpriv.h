@@ -18,23 +18,50 @@
 #define INF_STATUS_WRONG_INF_STYLE         ((INFSTATUS)0xC0700003)
 #define INF_STATUS_NOT_ENOUGH_MEMORY       ((INFSTATUS)0xC0700004)
 
+/* Everything parsed from an INF lives in a chain of arena blocks that is
+   released as a whole when the INF is closed */
+#define INF_ARENA_BLOCK_SIZE   0x4000
+
+/* Sections and keys are looked up by hash once there are this many */
+#define INF_HASH_THRESHOLD     8
+
+/* INFCACHE flags */
+#define INF_CACHE_INTERN_STRINGS  0x00000001  /* share identical keys and fields */
+
+typedef struct _INFCACHEARENA
+{
+  struct _INFCACHEARENA *Next;
+  ULONG Size;
+  ULONG Used;
+} INFCACHEARENA, *PINFCACHEARENA;
+
+typedef struct _INFCACHESTRING
+{
+  struct _INFCACHESTRING *Next;
+  ULONG Hash;
+
+  WCHAR Data[1];
+} INFCACHESTRING, *PINFCACHESTRING;
+
 typedef struct _INFCACHEFIELD
 {
   struct _INFCACHEFIELD *Next;
   struct _INFCACHEFIELD *Prev;
 
-  WCHAR Data[1];
+  PWCHAR Data;
 } INFCACHEFIELD, *PINFCACHEFIELD;
 
 typedef struct _INFCACHELINE
 {
   struct _INFCACHELINE *Next;
   struct _INFCACHELINE *Prev;
+  struct _INFCACHELINE *HashNext;
   UINT Id;
 
   LONG FieldCount;
 
   PWCHAR Key;
+  ULONG KeyHash;
 
   PINFCACHEFIELD FirstField;
   PINFCACHEFIELD LastField;
@@ -45,25 +72,47 @@ typedef struct _INFCACHESECTION
 {
   struct _INFCACHESECTION *Next;
   struct _INFCACHESECTION *Prev;
+  struct _INFCACHESECTION *HashNext;
 
   PINFCACHELINE FirstLine;
   PINFCACHELINE LastLine;
   UINT Id;
+  ULONG Hash;
 
   LONG LineCount;
   UINT NextLineId;
 
+  /* Lines indexed by Id - 1, and the first line of each key by hash */
+  PINFCACHELINE *LineById;
+  UINT LineByIdSize;
+  PINFCACHELINE *KeyTable;
+  UINT KeyTableSize;
+  UINT KeyCount;
+
   WCHAR Name[1];
 } INFCACHESECTION, *PINFCACHESECTION;
 
 typedef struct _INFCACHE
 {
   LANGID LanguageId;
+  ULONG Flags;
   PINFCACHESECTION FirstSection;
   PINFCACHESECTION LastSection;
   UINT NextSectionId;
 
   PINFCACHESECTION StringsSection;
+
+  PINFCACHEARENA Arena;
+
+  /* Sections indexed by Id - 1, and by hash of their name */
+  PINFCACHESECTION *SectionById;
+  UINT SectionByIdSize;
+  PINFCACHESECTION *SectionTable;
+  UINT SectionTableSize;
+
+  PINFCACHESTRING *StringTable;
+  UINT StringTableSize;
+  UINT StringCount;
 } INFCACHE, *PINFCACHE;
 
 typedef struct _INFCONTEXT
@@ -82,13 +131,19 @@ extern INFSTATUS InfpParseBuffer(PINFCACHE file,
                                  const WCHAR *buffer,
                                  const WCHAR *end,
                                  PULONG error_line);
-extern PINFCACHESECTION InfpFreeSection(PINFCACHESECTION Section);
+extern PINFCACHE InfpCreateCache(LANGID LanguageId,
+                                 ULONG Flags);
+extern VOID InfpFreeCache(PINFCACHE Cache);
 extern PINFCACHESECTION InfpAddSection(PINFCACHE Cache,
                                        PCWSTR Name);
-extern PINFCACHELINE InfpAddLine(PINFCACHESECTION Section);
-extern PVOID InfpAddKeyToLine(PINFCACHELINE Line,
+extern PINFCACHELINE InfpAddLine(PINFCACHE Cache,
+                                 PINFCACHESECTION Section);
+extern PVOID InfpAddKeyToLine(PINFCACHE Cache,
+                              PINFCACHESECTION Section,
+                              PINFCACHELINE Line,
                               PCWSTR Key);
-extern PVOID InfpAddFieldToLine(PINFCACHELINE Line,
+extern PVOID InfpAddFieldToLine(PINFCACHE Cache,
+                                PINFCACHELINE Line,
                                 PCWSTR Data);
 extern PINFCACHELINE InfpFindKeyLine(PINFCACHESECTION Section,
                                      PCWSTR Key);
@@ -233,7 +233,7 @@ InfpAddLineWithKey(PINFCONTEXT Context, PCWSTR Key)
     }
 
   Section = InfpGetSectionForContext(Context);
-  Line = InfpAddLine(Section);
+  Line = InfpAddLine(Context->Inf, Section);
   if (NULL == Line)
     {
       DPRINT("Failed to create line\n");
@@ -241,7 +241,7 @@ InfpAddLineWithKey(PINFCONTEXT Context, PCWSTR Key)
     }
   Context->Line = Line->Id;
 
-  if (NULL != Key && NULL == InfpAddKeyToLine(Line, Key))
+  if (NULL != Key && NULL == InfpAddKeyToLine(Context->Inf, Section, Line, Key))
     {
       DPRINT("Failed to add key\n");
       return INF_STATUS_NO_MEMORY;
@@ -262,7 +262,7 @@ InfpAddField(PINFCONTEXT Context, PCWSTR Data)
     }
 
   Line = InfpGetLineForContext(Context);
-  if (NULL == InfpAddFieldToLine(Line, Data))
+  if (NULL == InfpAddFieldToLine(Context->Inf, Line, Data))
     {
       DPRINT("Failed to add field\n");
       return INF_STATUS_NO_MEMORY;
@@ -42,6 +42,85 @@
 #define NDEBUG
 #include <debug.h>
 
+ULONG
+RosSymGetIndexLength(PVOID Data, ULONG Length)
+{
+  PROSSYM_INDEX Index = (PROSSYM_INDEX) Data;
+
+  if (Length < FIELD_OFFSET(ROSSYM_INDEX, FirstEntry)
+      || ROSSYM_INDEX_MAGIC != Index->Magic
+      || sizeof(ULONG_PTR) * 8 <= Index->Shift
+      || 0 == Index->BucketCount
+      || (Length - FIELD_OFFSET(ROSSYM_INDEX, FirstEntry)) / sizeof(ULONG) <= Index->BucketCount)
+    {
+      return 0;
+    }
+
+  return FIELD_OFFSET(ROSSYM_INDEX, FirstEntry) + (Index->BucketCount + 1) * sizeof(ULONG);
+}
+
+VOID
+RosSymSetIndex(PROSSYM_INFO RosSymInfo, PROSSYM_INDEX Index)
+{
+  ULONG Bucket;
+
+  RosSymInfo->Index = NULL;
+  if (NULL == Index || Index->FirstEntry[Index->BucketCount] != RosSymInfo->SymbolsCount)
+    {
+      return;
+    }
+  for (Bucket = 0; Bucket < Index->BucketCount; Bucket++)
+    {
+      if (Index->FirstEntry[Bucket + 1] < Index->FirstEntry[Bucket])
+        {
+          DPRINT1("Invalid rossym address index\n");
+          return;
+        }
+    }
+
+  RosSymInfo->Index = Index;
+}
+
+static PROSSYM_ENTRY
+FindIndexedEntry(IN PROSSYM_INFO RosSymInfo, IN ULONG_PTR RelativeAddress)
+{
+  PROSSYM_INDEX Index = RosSymInfo->Index;
+  PROSSYM_ENTRY Symbols = RosSymInfo->Symbols;
+  ULONG_PTR Bucket = RelativeAddress >> Index->Shift;
+  ULONG Low, High, Mid;
+
+  /* Find the first symbol past the address, only the bucket of the
+     address can hold it */
+  if (Index->BucketCount <= Bucket)
+    {
+      Low = RosSymInfo->SymbolsCount;
+    }
+  else
+    {
+      Low = Index->FirstEntry[Bucket];
+      High = Index->FirstEntry[Bucket + 1];
+      while (Low < High)
+        {
+          Mid = Low + (High - Low) / 2;
+          if (RelativeAddress < Symbols[Mid].Address)
+            {
+              High = Mid;
+            }
+          else
+            {
+              Low = Mid + 1;
+            }
+        }
+    }
+
+  if (0 == Low)
+    {
+      return NULL;
+    }
+
+  return Symbols + Low - 1;
+}
+
 static PROSSYM_ENTRY
 FindEntry(IN PROSSYM_INFO RosSymInfo, IN ULONG_PTR RelativeAddress)
 {
@@ -65,6 +144,11 @@ FindEntry(IN PROSSYM_INFO RosSymInfo, IN ULONG_PTR RelativeAddress)
   ULONG Lim;
   PROSSYM_ENTRY Mid, Low;
 
+  if (NULL != RosSymInfo->Index)
+    {
+      return FindIndexedEntry(RosSymInfo, RelativeAddress);
+    }
+
   if (RelativeAddress < Base->Address)
     {
       return NULL;
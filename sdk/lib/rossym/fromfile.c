@@ -141,6 +141,11 @@ RosSymCreateFromFile(PVOID FileContext, PROSSYM_INFO *RosSymInfo)
   /* Make sure the last string is null terminated, we allocated an extra byte for that */
   (*RosSymInfo)->Strings[(*RosSymInfo)->StringsLength] = '\0';
 
+  /* The address index, if any, was read along with the rest */
+  RosSymSetIndex(*RosSymInfo,
+                 0 != RosSymGetIndexLength(*RosSymInfo + 1, RosSymHeader.SymbolsOffset - sizeof(ROSSYM_HEADER))
+                 ? (PROSSYM_INDEX)(*RosSymInfo + 1) : NULL);
+
   return TRUE;
 }
 
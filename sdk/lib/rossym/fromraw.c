@@ -19,6 +19,7 @@ BOOLEAN
 RosSymCreateFromRaw(PVOID RawData, ULONG_PTR DataSize, PROSSYM_INFO *RosSymInfo)
 {
   PROSSYM_HEADER RosSymHeader;
+  ULONG IndexLength;
 
   RosSymHeader = (PROSSYM_HEADER) RawData;
   if (RosSymHeader->SymbolsOffset < sizeof(ROSSYM_HEADER)
@@ -30,17 +31,20 @@ RosSymCreateFromRaw(PVOID RawData, ULONG_PTR DataSize, PROSSYM_INFO *RosSymInfo)
       return FALSE;
     }
 
+  IndexLength = RosSymGetIndexLength(RosSymHeader + 1,
+                                     RosSymHeader->SymbolsOffset - sizeof(ROSSYM_HEADER));
+
   /* Copy */
-  *RosSymInfo = RosSymAllocMem(sizeof(ROSSYM_INFO) + RosSymHeader->SymbolsLength
+  *RosSymInfo = RosSymAllocMem(sizeof(ROSSYM_INFO) + IndexLength + RosSymHeader->SymbolsLength
                                + RosSymHeader->StringsLength + 1);
   if (NULL == *RosSymInfo)
     {
       DPRINT1("Failed to allocate memory for rossym\n");
       return FALSE;
     }
-  (*RosSymInfo)->Symbols = (PROSSYM_ENTRY)((char *) *RosSymInfo + sizeof(ROSSYM_INFO));
+  (*RosSymInfo)->Symbols = (PROSSYM_ENTRY)((char *) *RosSymInfo + sizeof(ROSSYM_INFO) + IndexLength);
   (*RosSymInfo)->SymbolsCount = RosSymHeader->SymbolsLength / sizeof(ROSSYM_ENTRY);
-  (*RosSymInfo)->Strings = (PCHAR) *RosSymInfo + sizeof(ROSSYM_INFO) + RosSymHeader->SymbolsLength;
+  (*RosSymInfo)->Strings = (PCHAR) (*RosSymInfo)->Symbols + RosSymHeader->SymbolsLength;
   (*RosSymInfo)->StringsLength = RosSymHeader->StringsLength;
   memcpy((*RosSymInfo)->Symbols, (char *) RosSymHeader + RosSymHeader->SymbolsOffset,
          RosSymHeader->SymbolsLength);
@@ -49,6 +53,9 @@ RosSymCreateFromRaw(PVOID RawData, ULONG_PTR DataSize, PROSSYM_INFO *RosSymInfo)
   /* Make sure the last string is null terminated, we allocated an extra byte for that */
   (*RosSymInfo)->Strings[(*RosSymInfo)->StringsLength] = '\0';
 
+  memcpy(*RosSymInfo + 1, RosSymHeader + 1, IndexLength);
+  RosSymSetIndex(*RosSymInfo, 0 != IndexLength ? (PROSSYM_INDEX)(*RosSymInfo + 1) : NULL);
+
   return TRUE;
 }
 
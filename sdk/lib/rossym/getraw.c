@@ -12,10 +12,24 @@
 #include <reactos/rossym.h>
 #include "rossympriv.h"
 
+static ULONG
+GetIndexLength(PROSSYM_INFO RosSymInfo)
+{
+  if (NULL == RosSymInfo->Index)
+    {
+      return 0;
+    }
+
+  /* Keep the symbols that follow 64-bit aligned */
+  return (FIELD_OFFSET(ROSSYM_INDEX, FirstEntry)
+          + (RosSymInfo->Index->BucketCount + 1) * sizeof(ULONG) + 7) & ~7;
+}
+
 ULONG
 RosSymGetRawDataLength(PROSSYM_INFO RosSymInfo)
 {
   return sizeof(ROSSYM_HEADER)
+         + GetIndexLength(RosSymInfo)
          + RosSymInfo->SymbolsCount * sizeof(ROSSYM_ENTRY)
          + RosSymInfo->StringsLength;
 }
@@ -24,13 +38,20 @@ VOID
 RosSymGetRawData(PROSSYM_INFO RosSymInfo, PVOID RawData)
 {
   PROSSYM_HEADER RosSymHeader;
+  ULONG IndexLength = GetIndexLength(RosSymInfo);
 
   RosSymHeader = (PROSSYM_HEADER) RawData;
-  RosSymHeader->SymbolsOffset = sizeof(ROSSYM_HEADER);
+  RosSymHeader->SymbolsOffset = sizeof(ROSSYM_HEADER) + IndexLength;
   RosSymHeader->SymbolsLength = RosSymInfo->SymbolsCount * sizeof(ROSSYM_ENTRY);
   RosSymHeader->StringsOffset = RosSymHeader->SymbolsOffset + RosSymHeader->SymbolsLength;
   RosSymHeader->StringsLength = RosSymInfo->StringsLength;
 
+  if (0 != IndexLength)
+    {
+      memset(RosSymHeader + 1, 0, IndexLength);
+      memcpy(RosSymHeader + 1, RosSymInfo->Index, FIELD_OFFSET(ROSSYM_INDEX, FirstEntry)
+             + (RosSymInfo->Index->BucketCount + 1) * sizeof(ULONG));
+    }
   memcpy((char *) RawData + RosSymHeader->SymbolsOffset, RosSymInfo->Symbols,
          RosSymHeader->SymbolsLength);
   memcpy((char *) RawData + RosSymHeader->StringsOffset, RosSymInfo->Strings,
@@ -14,6 +14,7 @@ typedef struct _ROSSYM_INFO {
   ULONG SymbolsCount;
   PCHAR Strings;
   ULONG StringsLength;
+  PROSSYM_INDEX Index;
 } ROSSYM_INFO;
 
 extern ROSSYM_CALLBACKS RosSymCallbacks;
@@ -23,6 +24,9 @@ extern ROSSYM_CALLBACKS RosSymCallbacks;
 #define RosSymReadFile(FileContext, Buffer, Size) (*RosSymCallbacks.ReadFileProc)((FileContext), (Buffer), (Size))
 #define RosSymSeekFile(FileContext, Position) (*RosSymCallbacks.SeekFileProc)((FileContext), (Position))
 
+extern ULONG RosSymGetIndexLength(PVOID Data, ULONG Length);
+extern VOID RosSymSetIndex(PROSSYM_INFO RosSymInfo, PROSSYM_INDEX Index);
+
 extern BOOLEAN RosSymZwReadFile(PVOID FileContext, PVOID Buffer, ULONG Size);
 extern BOOLEAN RosSymZwSeekFile(PVOID FileContext, ULONG_PTR Position);
 
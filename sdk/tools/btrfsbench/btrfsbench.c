@@ -0,0 +1,328 @@
+/*
+ * PROJECT:     ReactOS Btrfs Benchmarks
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Host checks and benchmarks for the btrfs checksum algorithms
+ *
+ * Builds the driver's sha256.c, blake2b-ref.c and xxhash.c for the host.
+ * Before timing, every algorithm is checked against known answers, and on
+ * x86_64 the SHA extensions block function (sha256-amd64.S, as in the
+ * ReactOS build) is checked against the C one for every length up to a few
+ * blocks. Each benchmark hashes a buffer of 4 KB
+ * sectors one sector at a time, the way calc_thread_main does, and reports
+ * one CSV line:
+ *
+ *   benchmark,sectors,runs,min_ns,median_ns,mb_per_s
+ *
+ * Workloads the CPU can't run are skipped.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _AMD64_
+#include <cpuid.h>
+#endif
+
+#include "xxhash.h"
+
+#define SECTOR_SIZE     4096
+#define SHA256_SIZE     32
+#define BLAKE2_SIZE     32
+
+void calc_sha256(uint8_t* hash, const void* input, size_t len);
+void blake2b(void *out, size_t outlen, const void* in, size_t inlen);
+#ifdef _AMD64_
+extern int sha256_use_shani;
+#endif
+
+typedef int (*bench_setup)(void);
+typedef void (*bench_sector)(const uint8_t* sector, uint8_t* csum);
+
+typedef struct {
+    const char* name;
+    bench_setup setup;
+    bench_sector hash;
+} benchmark;
+
+static uint64_t bench_seed = 0x9E3779B97F4A7C15ULL;
+
+/* HELPERS *******************************************************************/
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* xorshift64*, deterministic for a given -s seed */
+static uint32_t random32(void) {
+    bench_seed ^= bench_seed >> 12;
+    bench_seed ^= bench_seed << 25;
+    bench_seed ^= bench_seed >> 27;
+    return (uint32_t)((bench_seed * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static void* xalloc(size_t size) {
+    void* buf = malloc(size);
+
+    if (!buf) {
+        fprintf(stderr, "btrfsbench: out of memory\n");
+        exit(1);
+    }
+
+    return buf;
+}
+
+static void to_hex(char* out, const uint8_t* in, size_t len) {
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        sprintf(out + (i * 2), "%02x", in[i]);
+    }
+}
+
+static int check_hex(const char* what, const uint8_t* hash, size_t len, const char* expected) {
+    char hex[(64 * 2) + 1];
+
+    to_hex(hex, hash, len);
+
+    if (strcmp(hex, expected)) {
+        fprintf(stderr, "btrfsbench: %s is %s, expected %s\n", what, hex, expected);
+        return 0;
+    }
+
+    return 1;
+}
+
+/* ALGORITHMS ****************************************************************/
+
+static int setup_sha256_sw(void) {
+#ifdef _AMD64_
+    sha256_use_shani = 0;
+#endif
+    return 1;
+}
+
+#ifdef _AMD64_
+/* Same test as check_cpu */
+static int have_shani(void) {
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSE4_1))
+        return 0;
+
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+        return 0;
+
+    return (ebx & (1 << 29)) != 0;
+}
+
+static int setup_sha256_shani(void) {
+    sha256_use_shani = have_shani();
+    return sha256_use_shani;
+}
+#endif
+
+static void hash_sha256(const uint8_t* sector, uint8_t* csum) {
+    calc_sha256(csum, sector, SECTOR_SIZE);
+}
+
+static void hash_blake2b(const uint8_t* sector, uint8_t* csum) {
+    blake2b(csum, BLAKE2_SIZE, sector, SECTOR_SIZE);
+}
+
+static void hash_xxhash(const uint8_t* sector, uint8_t* csum) {
+    *(uint64_t*)csum = XXH64(sector, SECTOR_SIZE, 0);
+}
+
+static const benchmark benchmarks[] = {
+    { "sha256.sw",      setup_sha256_sw,    hash_sha256 },
+#ifdef _AMD64_
+    { "sha256.shani",   setup_sha256_shani, hash_sha256 },
+#endif
+    { "blake2b",        NULL,               hash_blake2b },
+    { "xxhash64",       NULL,               hash_xxhash },
+};
+
+/* CHECKS ********************************************************************/
+
+static int check_vectors(void) {
+    static const char abc[] = "abc";
+    static const char two_blocks[] = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    uint8_t hash[SHA256_SIZE];
+    int ok = 1;
+
+    setup_sha256_sw();
+
+    calc_sha256(hash, abc, strlen(abc));
+    ok &= check_hex("sha256(\"abc\")", hash, SHA256_SIZE,
+                    "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+
+    calc_sha256(hash, two_blocks, strlen(two_blocks));
+    ok &= check_hex("sha256(two blocks)", hash, SHA256_SIZE,
+                    "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+
+    blake2b(hash, BLAKE2_SIZE, abc, strlen(abc));
+    ok &= check_hex("blake2b-256(\"abc\")", hash, BLAKE2_SIZE,
+                    "bddd813c634239723171ef3fee98579b94964e3bb1cb3e427262c8c068d52319");
+
+    if (XXH64(abc, strlen(abc), 0) != 0x44bc2cf5ad770999ULL) {
+        fprintf(stderr, "btrfsbench: xxhash64(\"abc\") mismatch\n");
+        ok = 0;
+    }
+
+    return ok;
+}
+
+#ifdef _AMD64_
+/* Both block functions must agree for every amount of padding */
+static int check_shani(void) {
+    uint8_t buf[4 * 64 + 1], sw[SHA256_SIZE], ni[SHA256_SIZE];
+    size_t len;
+
+    if (!have_shani()) {
+        fprintf(stderr, "btrfsbench: no SHA extensions, skipping the SHA-NI check\n");
+        return 1;
+    }
+
+    for (len = 0; len < sizeof(buf); len++) {
+        buf[len] = (uint8_t)random32();
+    }
+
+    for (len = 0; len <= sizeof(buf); len++) {
+        sha256_use_shani = 0;
+        calc_sha256(sw, buf, len);
+
+        sha256_use_shani = 1;
+        calc_sha256(ni, buf, len);
+
+        if (memcmp(sw, ni, SHA256_SIZE)) {
+            fprintf(stderr, "btrfsbench: SHA-NI and C SHA-256 differ at length %u\n", (unsigned int)len);
+            sha256_use_shani = 0;
+            return 0;
+        }
+    }
+
+    sha256_use_shani = 0;
+    return 1;
+}
+#endif
+
+/* DRIVER ********************************************************************/
+
+static int compare_ns(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+
+    return (x > y) - (x < y);
+}
+
+static int is_selected(const char* name, int argc, char** argv, int first) {
+    int i;
+
+    if (first >= argc)
+        return 1;
+
+    for (i = first; i < argc; i++) {
+        if (strstr(name, argv[i]))
+            return 1;
+    }
+
+    return 0;
+}
+
+static void usage(void) {
+    printf("Usage: btrfsbench [-n sectors] [-r runs] [-s seed] [-l] [filter ...]\n"
+           "  -n sectors  4 KB sectors per run (default 16384)\n"
+           "  -r runs     Repetitions per workload (default 5)\n"
+           "  -s seed     Random seed for the sector contents\n"
+           "  -l          List the workloads and exit\n"
+           "Only workloads whose name contains one of the filters are run.\n");
+}
+
+int main(int argc, char** argv) {
+    unsigned int sectors = 16384, runs = 5, i, r, s;
+    uint64_t seed = bench_seed, start, *samples;
+    uint8_t *data, csum[SHA256_SIZE];
+    volatile uint8_t sink = 0;
+    int arg;
+
+    for (arg = 1; arg < argc && argv[arg][0] == '-'; arg++) {
+        if (!strcmp(argv[arg], "-l")) {
+            for (i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+                printf("%s\n", benchmarks[i].name);
+            }
+            return 0;
+        } else if (arg + 1 < argc && !strcmp(argv[arg], "-n"))
+            sectors = strtoul(argv[++arg], NULL, 0);
+        else if (arg + 1 < argc && !strcmp(argv[arg], "-r"))
+            runs = strtoul(argv[++arg], NULL, 0);
+        else if (arg + 1 < argc && !strcmp(argv[arg], "-s"))
+            seed = strtoull(argv[++arg], NULL, 0);
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    if (sectors == 0 || runs == 0) {
+        usage();
+        return 1;
+    }
+
+    bench_seed = seed ? seed : 1;
+
+    if (!check_vectors())
+        return 1;
+
+#ifdef _AMD64_
+    if (!check_shani())
+        return 1;
+#endif
+
+    data = xalloc((size_t)sectors * SECTOR_SIZE);
+    for (i = 0; i < sectors * (SECTOR_SIZE / sizeof(uint32_t)); i++) {
+        ((uint32_t*)data)[i] = random32();
+    }
+
+    samples = xalloc(runs * sizeof(uint64_t));
+    printf("benchmark,sectors,runs,min_ns,median_ns,mb_per_s\n");
+
+    for (i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+        if (!is_selected(benchmarks[i].name, argc, argv, arg))
+            continue;
+
+        if (benchmarks[i].setup && !benchmarks[i].setup()) {
+            fprintf(stderr, "btrfsbench: %s not supported by this CPU, skipped\n", benchmarks[i].name);
+            continue;
+        }
+
+        for (r = 0; r < runs; r++) {
+            start = now_ns();
+
+            for (s = 0; s < sectors; s++) {
+                benchmarks[i].hash(data + ((size_t)s * SECTOR_SIZE), csum);
+                sink ^= csum[0];
+            }
+
+            samples[r] = now_ns() - start;
+        }
+
+        qsort(samples, runs, sizeof(uint64_t), compare_ns);
+        printf("%s,%u,%u,%llu,%llu,%.1f\n",
+               benchmarks[i].name,
+               sectors,
+               runs,
+               (unsigned long long)samples[0],
+               (unsigned long long)samples[runs / 2],
+               ((double)sectors * SECTOR_SIZE * 1e9) / ((double)samples[0] * 1048576.0));
+        fflush(stdout);
+    }
+
+    free(samples);
+    free(data);
+    return 0;
+}
@@ -0,0 +1,507 @@
+/*
+ * PROJECT:     ReactOS Btrfs Benchmarks
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Host benchmark for the btrfs compressors
+ *
+ * Builds the compressors in the driver's compress.c (with BTRFS_HOST) and the
+ * bundled zstd for the host. A fixed corpus is cut into 128 KB extents, the
+ * unit write_compressed hands to the calc threads, and a pool of threads
+ * takes extents off a shared counter the way calc_thread_main takes jobs.
+ * Every extent is decompressed again and compared before anything is
+ * timed. One CSV line per algorithm, level and thread count:
+ *
+ *   algorithm,level,threads,extents,runs,stored_pct,min_ns,median_ns,mb_per_s
+ *
+ * stored_pct is what write_compressed would write: extents that don't save
+ * a whole sector are stored uncompressed, the rest are rounded up to one.
+ *
+ * The default corpus is generated from the -s seed and mixes text, record
+ * like binary data, random bytes and zero runs; -f uses a file instead.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "btrfs_host.h"
+
+#define SECTOR_SIZE     4096
+#define MAX_THREADS     64
+
+typedef enum {
+    ALG_LZO,
+    ALG_ZLIB,
+    ALG_ZSTD
+} algorithm;
+
+typedef struct {
+    const char* name;
+    algorithm alg;
+    unsigned int level;
+} workload;
+
+typedef struct {
+    const workload* wl;
+    uint8_t* corpus;
+    uint32_t corpus_len;
+    uint8_t* out;
+    unsigned int num_extents;
+    unsigned int* stored;
+    volatile unsigned int next;
+    volatile int failed;
+} bench_run;
+
+static const workload workloads[] = {
+    { "lzo",    ALG_LZO,    0 },
+    { "zlib",   ALG_ZLIB,   1 },
+    { "zlib",   ALG_ZLIB,   3 },
+    { "zlib",   ALG_ZLIB,   6 },
+    { "zstd",   ALG_ZSTD,   1 },
+    { "zstd",   ALG_ZSTD,   3 },
+    { "zstd",   ALG_ZSTD,   9 },
+};
+
+static uint64_t bench_seed = 0x9E3779B97F4A7C15ULL;
+
+/* HELPERS *******************************************************************/
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* xorshift64*, deterministic for a given -s seed */
+static uint32_t random32(void) {
+    bench_seed ^= bench_seed >> 12;
+    bench_seed ^= bench_seed << 25;
+    bench_seed ^= bench_seed >> 27;
+    return (uint32_t)((bench_seed * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static void* xalloc(size_t size) {
+    void* buf = malloc(size);
+
+    if (!buf) {
+        fprintf(stderr, "btrfscompbench: out of memory\n");
+        exit(1);
+    }
+
+    return buf;
+}
+
+/* CORPUS ********************************************************************/
+
+static void fill_text(uint8_t* p, uint32_t len) {
+    static const char* words[] = {
+        "the", "of", "and", "a", "to", "in", "is", "file", "system", "extent",
+        "block", "data", "tree", "node", "checksum", "device", "volume", "write",
+        "read", "compress", "ReactOS", "driver", "kernel", "memory", "page", "cache",
+    };
+    uint32_t pos = 0;
+    const char* w;
+
+    while (pos < len) {
+        w = words[random32() % (sizeof(words) / sizeof(words[0]))];
+
+        while (*w && pos < len) {
+            p[pos++] = *w++;
+        }
+
+        if (pos < len)
+            p[pos++] = (random32() % 12) == 0 ? '\n' : ' ';
+    }
+}
+
+/* Table-like binary data: counters, small fields and some padding */
+static void fill_records(uint8_t* p, uint32_t len) {
+    static uint32_t counter = 0;
+    uint32_t pos;
+
+    for (pos = 0; pos + 32 <= len; pos += 32) {
+        uint32_t rec[8];
+
+        rec[0] = counter++;
+        rec[1] = 0x1000 + (counter % 97);
+        rec[2] = random32() & 0xff;
+        rec[3] = 0;
+        rec[4] = counter * 4096;
+        rec[5] = random32();
+        rec[6] = 0;
+        rec[7] = 0xffffffff;
+
+        memcpy(p + pos, rec, sizeof(rec));
+    }
+
+    memset(p + pos, 0, len - pos);
+}
+
+static void fill_random(uint8_t* p, uint32_t len) {
+    uint32_t pos, r;
+
+    for (pos = 0; pos + 4 <= len; pos += 4) {
+        r = random32();
+        memcpy(p + pos, &r, 4);
+    }
+
+    for (; pos < len; pos++) {
+        p[pos] = (uint8_t)random32();
+    }
+}
+
+/* Mostly zero, with an occasional dirty sector */
+static void fill_sparse(uint8_t* p, uint32_t len) {
+    uint32_t pos;
+
+    memset(p, 0, len);
+
+    for (pos = 0; pos + SECTOR_SIZE <= len; pos += SECTOR_SIZE) {
+        if ((random32() % 8) == 0)
+            fill_random(p + pos, 256);
+    }
+}
+
+static uint8_t* make_corpus(uint32_t len) {
+    uint8_t* corpus = xalloc(len);
+    uint32_t pos, n;
+
+    /* Alternate the kinds every 64 KB, so extents are mixed too */
+    for (pos = 0; pos < len; pos += n) {
+        n = min(len - pos, 0x10000);
+
+        switch ((pos / 0x10000) % 6) {
+            case 0:
+            case 1:
+                fill_text(corpus + pos, n);
+                break;
+
+            case 2:
+            case 3:
+                fill_records(corpus + pos, n);
+                break;
+
+            case 4:
+                fill_random(corpus + pos, n);
+                break;
+
+            default:
+                fill_sparse(corpus + pos, n);
+                break;
+        }
+    }
+
+    return corpus;
+}
+
+static uint8_t* load_corpus(const char* fn, uint32_t* len) {
+    FILE* f = fopen(fn, "rb");
+    uint8_t* corpus;
+    long size;
+
+    if (!f) {
+        fprintf(stderr, "btrfscompbench: can't open %s\n", fn);
+        exit(1);
+    }
+
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    if (size <= 0 || size > 0x40000000) {
+        fprintf(stderr, "btrfscompbench: %s is empty or larger than 1 GB\n", fn);
+        exit(1);
+    }
+
+    corpus = xalloc(size);
+
+    if (fread(corpus, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "btrfscompbench: can't read %s\n", fn);
+        exit(1);
+    }
+
+    fclose(f);
+
+    *len = (uint32_t)size;
+    return corpus;
+}
+
+/* COMPRESSION ***************************************************************/
+
+static NTSTATUS compress_extent(const workload* wl, uint8_t* in, uint32_t inlen, uint8_t* out, unsigned int* space_left) {
+    switch (wl->alg) {
+        case ALG_LZO:
+            return lzo_compress(in, inlen, out, inlen, space_left);
+
+        case ALG_ZLIB:
+            return zlib_compress(in, inlen, out, inlen, wl->level, space_left);
+
+        default:
+            return zstd_compress(in, inlen, out, inlen, wl->level, space_left);
+    }
+}
+
+static NTSTATUS decompress_extent(const workload* wl, uint8_t* in, uint32_t inlen, uint8_t* out, uint32_t outlen) {
+    switch (wl->alg) {
+        case ALG_LZO:
+            // skip the overall length, as read_file does
+            return lzo_decompress(in + sizeof(uint32_t), inlen - sizeof(uint32_t), out, outlen, sizeof(uint32_t));
+
+        case ALG_ZLIB:
+            return zlib_decompress(in, inlen, out, outlen);
+
+        default:
+            return zstd_decompress(in, inlen, out, outlen);
+    }
+}
+
+static void* compress_thread(void* context) {
+    bench_run* run = context;
+    unsigned int i, space_left;
+    uint32_t off, inlen;
+    NTSTATUS Status;
+
+    while ((i = __atomic_fetch_add(&run->next, 1, __ATOMIC_RELAXED)) < run->num_extents) {
+        off = i * COMPRESSED_EXTENT_SIZE;
+        inlen = min(run->corpus_len - off, COMPRESSED_EXTENT_SIZE);
+
+        Status = compress_extent(run->wl, run->corpus + off, inlen, run->out + off, &space_left);
+        if (!NT_SUCCESS(Status)) {
+            run->failed = 1;
+            break;
+        }
+
+        // same decision as write_compressed
+        if (space_left >= SECTOR_SIZE)
+            run->stored[i] = (uint32_t)sector_align(inlen - space_left, SECTOR_SIZE);
+        else
+            run->stored[i] = (uint32_t)sector_align(inlen, SECTOR_SIZE);
+    }
+
+    return NULL;
+}
+
+static int run_pool(bench_run* run, unsigned int threads) {
+    pthread_t tids[MAX_THREADS];
+    unsigned int t;
+
+    run->next = 0;
+    run->failed = 0;
+
+    for (t = 1; t < threads; t++) {
+        if (pthread_create(&tids[t], NULL, compress_thread, run)) {
+            fprintf(stderr, "btrfscompbench: pthread_create failed\n");
+            exit(1);
+        }
+    }
+
+    /* The calling thread helps, as in write_compressed */
+    compress_thread(run);
+
+    for (t = 1; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+    }
+
+    return !run->failed;
+}
+
+/* Decompresses every extent that would be stored compressed */
+static int check_run(bench_run* run) {
+    uint8_t* buf = xalloc(COMPRESSED_EXTENT_SIZE);
+    uint32_t off, inlen;
+    unsigned int i;
+
+    for (i = 0; i < run->num_extents; i++) {
+        off = i * COMPRESSED_EXTENT_SIZE;
+        inlen = min(run->corpus_len - off, COMPRESSED_EXTENT_SIZE);
+
+        if (run->stored[i] >= inlen)
+            continue;
+
+        memset(buf, 0xcc, inlen);
+
+        if (!NT_SUCCESS(decompress_extent(run->wl, run->out + off, run->stored[i], buf, inlen)) ||
+            memcmp(buf, run->corpus + off, inlen)) {
+            fprintf(stderr, "btrfscompbench: %s:%u extent %u doesn't round trip\n", run->wl->name, run->wl->level, i);
+            free(buf);
+            return 0;
+        }
+    }
+
+    free(buf);
+    return 1;
+}
+
+/* DRIVER ********************************************************************/
+
+static int compare_ns(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+
+    return (x > y) - (x < y);
+}
+
+static int is_selected(const char* name, int argc, char** argv, int first) {
+    int i;
+
+    if (first >= argc)
+        return 1;
+
+    for (i = first; i < argc; i++) {
+        if (strstr(name, argv[i]))
+            return 1;
+    }
+
+    return 0;
+}
+
+static unsigned int parse_threads(const char* s, unsigned int* counts) {
+    unsigned int n = 0;
+    char* end;
+
+    while (*s && n < MAX_THREADS) {
+        counts[n] = strtoul(s, &end, 0);
+        if (end == s || counts[n] == 0 || counts[n] > MAX_THREADS)
+            return 0;
+
+        n++;
+        s = *end == ',' ? end + 1 : end;
+    }
+
+    return n;
+}
+
+static void usage(void) {
+    printf("Usage: btrfscompbench [-m MB | -f file] [-t threads] [-r runs] [-s seed] [-l] [filter ...]\n"
+           "  -m MB       Size of the generated corpus (default 32)\n"
+           "  -f file     Compress this file instead\n"
+           "  -t threads  Comma separated thread counts (default 1,2,4,... up to the CPUs)\n"
+           "  -r runs     Repetitions per workload (default 3)\n"
+           "  -s seed     Random seed for the generated corpus\n"
+           "  -l          List the workloads and exit\n"
+           "Only workloads whose name contains one of the filters are run.\n");
+}
+
+int main(int argc, char** argv) {
+    unsigned int mb = 32, runs = 3, counts[MAX_THREADS], num_counts = 0, i, c, r, n;
+    uint64_t seed = bench_seed, start, *samples, stored;
+    const char* fn = NULL;
+    bench_run run;
+    long cpus;
+    int arg;
+
+    for (arg = 1; arg < argc && argv[arg][0] == '-'; arg++) {
+        if (!strcmp(argv[arg], "-l")) {
+            for (i = 0; i < sizeof(workloads) / sizeof(workloads[0]); i++) {
+                if (workloads[i].alg == ALG_LZO)
+                    printf("%s\n", workloads[i].name);
+                else
+                    printf("%s:%u\n", workloads[i].name, workloads[i].level);
+            }
+            return 0;
+        } else if (arg + 1 < argc && !strcmp(argv[arg], "-m"))
+            mb = strtoul(argv[++arg], NULL, 0);
+        else if (arg + 1 < argc && !strcmp(argv[arg], "-f"))
+            fn = argv[++arg];
+        else if (arg + 1 < argc && !strcmp(argv[arg], "-t")) {
+            num_counts = parse_threads(argv[++arg], counts);
+            if (num_counts == 0) {
+                usage();
+                return 1;
+            }
+        } else if (arg + 1 < argc && !strcmp(argv[arg], "-r"))
+            runs = strtoul(argv[++arg], NULL, 0);
+        else if (arg + 1 < argc && !strcmp(argv[arg], "-s"))
+            seed = strtoull(argv[++arg], NULL, 0);
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    if ((!fn && (mb == 0 || mb > 1024)) || runs == 0) {
+        usage();
+        return 1;
+    }
+
+    if (num_counts == 0) {
+        cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        cpus = cpus < 1 ? 1 : min(cpus, MAX_THREADS);
+
+        for (n = 1; n < (unsigned int)cpus; n *= 2) {
+            counts[num_counts++] = n;
+        }
+
+        counts[num_counts++] = (unsigned int)cpus;
+    }
+
+    bench_seed = seed ? seed : 1;
+
+    memset(&run, 0, sizeof(run));
+
+    if (fn)
+        run.corpus = load_corpus(fn, &run.corpus_len);
+    else {
+        run.corpus_len = mb << 20;
+        run.corpus = make_corpus(run.corpus_len);
+    }
+
+    run.num_extents = (unsigned int)(sector_align(run.corpus_len, COMPRESSED_EXTENT_SIZE) / COMPRESSED_EXTENT_SIZE);
+    run.out = xalloc((size_t)run.num_extents * COMPRESSED_EXTENT_SIZE);
+    run.stored = xalloc(run.num_extents * sizeof(unsigned int));
+    samples = xalloc(runs * sizeof(uint64_t));
+
+    printf("algorithm,level,threads,extents,runs,stored_pct,min_ns,median_ns,mb_per_s\n");
+
+    for (i = 0; i < sizeof(workloads) / sizeof(workloads[0]); i++) {
+        char name[32];
+
+        if (workloads[i].alg == ALG_LZO)
+            snprintf(name, sizeof(name), "%s", workloads[i].name);
+        else
+            snprintf(name, sizeof(name), "%s:%u", workloads[i].name, workloads[i].level);
+
+        if (!is_selected(name, argc, argv, arg))
+            continue;
+
+        run.wl = &workloads[i];
+
+        if (!run_pool(&run, 1) || !check_run(&run)) {
+            fprintf(stderr, "btrfscompbench: %s failed\n", name);
+            return 1;
+        }
+
+        stored = 0;
+        for (n = 0; n < run.num_extents; n++) {
+            stored += run.stored[n];
+        }
+
+        for (c = 0; c < num_counts; c++) {
+            for (r = 0; r < runs; r++) {
+                start = now_ns();
+                run_pool(&run, counts[c]);
+                samples[r] = now_ns() - start;
+            }
+
+            qsort(samples, runs, sizeof(uint64_t), compare_ns);
+            printf("%s,%u,%u,%u,%u,%.1f,%llu,%llu,%.1f\n",
+                   workloads[i].name,
+                   workloads[i].level,
+                   counts[c],
+                   run.num_extents,
+                   runs,
+                   (double)stored * 100.0 / run.corpus_len,
+                   (unsigned long long)samples[0],
+                   (unsigned long long)samples[runs / 2],
+                   ((double)run.corpus_len * 1e9) / ((double)samples[0] * 1048576.0));
+            fflush(stdout);
+        }
+    }
+
+    free(samples);
+    free(run.stored);
+    free(run.out);
+    free(run.corpus);
+    return 0;
+}
@@ -0,0 +1,53 @@
+/*
+ * PROJECT:     ReactOS Btrfs Benchmarks
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Host replacement for btrfs_drv.h, enough for the compressors
+ *              in compress.c (built with BTRFS_HOST)
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <ntifs.h>
+
+typedef int32_t NTSTATUS;
+
+#define NT_SUCCESS(Status)              ((NTSTATUS)(Status) >= 0)
+#define STATUS_SUCCESS                  ((NTSTATUS)0x00000000)
+#define STATUS_INSUFFICIENT_RESOURCES   ((NTSTATUS)0xC000009A)
+#define STATUS_INTERNAL_ERROR           ((NTSTATUS)0xC00000E5)
+
+#ifndef min
+#define min(a, b)   (((a) < (b)) ? (a) : (b))
+#endif
+
+#define UNUSED(x) (void)(x)
+
+/* btrfsbench checks every return value itself */
+#define ERR(s, ...)     do { } while (0)
+#define WARN(s, ...)    do { } while (0)
+#define TRACE(s, ...)   do { } while (0)
+
+#define ALLOC_TAG 0x7442484D //'MHBt'
+#define ALLOC_TAG_ZLIB 0x7A42484D //'MHBz'
+
+#define COMPRESSED_EXTENT_SIZE 0x20000 // 128 KB
+
+static __inline uint64_t sector_align(uint64_t n, uint64_t a) {
+    if (n & (a - 1))
+        n = (n + a) & ~(a - 1);
+
+    return n;
+}
+
+// in compress.c
+NTSTATUS zlib_decompress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen);
+NTSTATUS lzo_decompress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, uint32_t inpageoff);
+NTSTATUS zstd_decompress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen);
+NTSTATUS zlib_compress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, unsigned int level, unsigned int* space_left);
+NTSTATUS lzo_compress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, unsigned int* space_left);
+NTSTATUS zstd_compress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, uint32_t level, unsigned int* space_left);
@@ -0,0 +1,9 @@
+/*
+ * PROJECT:     ReactOS Btrfs Benchmarks
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Host stand-in, everything needed is in ntifs.h
+ */
+
+#pragma once
+
+#include <ntifs.h>
@@ -0,0 +1,24 @@
+/*
+ * PROJECT:     ReactOS Btrfs Benchmarks
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Host stand-in for the kernel headers included by xxhash.c
+ *              and the zstd sources, which only need the pool allocator
+ *              and RtlZeroMemory
+ */
+
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum _POOL_TYPE
+{
+    NonPagedPool,
+    PagedPool
+} POOL_TYPE;
+
+#define ExAllocatePoolWithTag(Type, Size, Tag)  malloc(Size)
+#define ExFreePool(Block)                       free(Block)
+
+#define RtlZeroMemory(Destination, Length)          memset((Destination), 0, (Length))
+#define RtlCopyMemory(Destination, Source, Length)  memcpy((Destination), (Source), (Length))
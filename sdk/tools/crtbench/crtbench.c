@@ -0,0 +1,653 @@
+/*
+ * PROJECT:     ReactOS CRT Benchmarks
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Host correctness and throughput suite for the CRT string and number conversion routines
+ *
+ * The amd64 SSE2 routines from sdk/lib/crt are assembled unmodified and
+ * checked against the portable loops they replace: every length up to a few
+ * hundred characters, at every alignment, with the terminator placed right
+ * in front of an inaccessible page, so an overread faults instead of going
+ * unnoticed. The throughput part then reports one CSV line per routine,
+ * implementation and size:
+ *
+ *   routine,impl,size,runs,min_ns,bytes_per_ns
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wctype.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+typedef unsigned short WCHAR16;
+
+#define MSABI __attribute__((ms_abi))
+
+/* sdk/lib/crt/{mem,string}/amd64 */
+extern void * MSABI crt_memchr(const void *s, int c, size_t n);
+extern int MSABI crt_memcmp(const void *s1, const void *s2, size_t n);
+extern void * MSABI crt_memcpy(void *dest, const void *src, size_t n);
+extern void * MSABI crt_memmove(void *dest, const void *src, size_t n);
+extern char * MSABI crt_strchr(const char *s, int c);
+extern int MSABI crt_strcmp(const char *s1, const char *s2);
+extern size_t MSABI crt_strlen(const char *s);
+extern WCHAR16 * MSABI crt_wcschr(const WCHAR16 *s, WCHAR16 c);
+extern int MSABI crt_wcscmp(const WCHAR16 *s1, const WCHAR16 *s2);
+extern size_t MSABI crt_wcslen(const WCHAR16 *s);
+
+/* sdk/lib/crt/string/stricmp.c, sdk/lib/crt/wstring/wcsicmp.c */
+extern int _stricmp(const char *s1, const char *s2);
+extern int _wcsicmp(const WCHAR16 *s1, const WCHAR16 *s2);
+
+/* fpbench.c */
+unsigned long TestFloat(void);
+void RunFloatBenchmarks(unsigned Runs, int argc, char **argv, int First);
+
+#define PAGE_SIZE   0x1000
+#define ARENA_PAGES 1026
+
+static unsigned char *Arena;
+static unsigned char *ArenaEnd;
+static unsigned long Failures;
+static volatile size_t BenchSink;
+
+/* PORTABLE REFERENCES *******************************************************/
+
+/* These are the generic sdk/lib/crt loops the SSE2 versions replace */
+
+static size_t
+RefStrlen(const char *s)
+{
+    const char *p;
+
+    for (p = s; *p; ++p);
+    return p - s;
+}
+
+static size_t
+RefWcslen(const WCHAR16 *s)
+{
+    const WCHAR16 *p;
+
+    for (p = s; *p; ++p);
+    return p - s;
+}
+
+static const char *
+RefStrchr(const char *s, int c)
+{
+    char cc = c;
+
+    while (*s)
+    {
+        if (*s == cc) return s;
+        s++;
+    }
+    return cc == 0 ? s : NULL;
+}
+
+static const WCHAR16 *
+RefWcschr(const WCHAR16 *s, WCHAR16 c)
+{
+    while (*s)
+    {
+        if (*s == c) return s;
+        s++;
+    }
+    return c == 0 ? s : NULL;
+}
+
+static int
+RefStrcmp(const char *s1, const char *s2)
+{
+    const unsigned char *p1 = (const unsigned char *)s1;
+    const unsigned char *p2 = (const unsigned char *)s2;
+
+    while (*p1 == *p2)
+    {
+        if (*p1 == 0) return 0;
+        p1++;
+        p2++;
+    }
+    return *p1 - *p2;
+}
+
+static int
+RefWcscmp(const WCHAR16 *s1, const WCHAR16 *s2)
+{
+    while (*s1 == *s2)
+    {
+        if (*s1 == 0) return 0;
+        s1++;
+        s2++;
+    }
+    return *s1 - *s2;
+}
+
+static const void *
+RefMemchr(const void *s, int c, size_t n)
+{
+    const unsigned char *p = s;
+
+    for (; n; n--, p++)
+    {
+        if (*p == (unsigned char)c) return p;
+    }
+    return NULL;
+}
+
+static int
+RefMemcmp(const void *s1, const void *s2, size_t n)
+{
+    const unsigned char *p1 = s1, *p2 = s2;
+
+    for (; n; n--, p1++, p2++)
+    {
+        if (*p1 != *p2) return *p1 - *p2;
+    }
+    return 0;
+}
+
+static void *
+RefMemmove(void *dest, const void *src, size_t n)
+{
+    char *d = dest;
+    const char *s = src;
+
+    if (d <= s || d >= s + n)
+    {
+        while (n--) *d++ = *s++;
+    }
+    else
+    {
+        d += n;
+        s += n;
+        while (n--) *--d = *--s;
+    }
+    return dest;
+}
+
+static int
+RefStricmp(const char *s1, const char *s2)
+{
+    while (toupper(*s1) == toupper(*s2))
+    {
+        if (*s1 == 0) return 0;
+        s1++;
+        s2++;
+    }
+    return toupper(*(const unsigned char *)s1) - toupper(*(const unsigned char *)s2);
+}
+
+static int
+RefWcsicmp(const WCHAR16 *s1, const WCHAR16 *s2)
+{
+    while (towlower(*s1) == towlower(*s2))
+    {
+        if (*s1 == 0) return 0;
+        s1++;
+        s2++;
+    }
+    return towlower(*s1) - towlower(*s2);
+}
+
+/* HELPERS *******************************************************************/
+
+static int
+Sign(int Value)
+{
+    return (Value > 0) - (Value < 0);
+}
+
+#define CHECK(Cond, ...) \
+    do { if (!(Cond)) { Failures++; if (Failures <= 20) { \
+        printf("FAIL %s:%d: ", __FUNCTION__, __LINE__); \
+        printf(__VA_ARGS__); printf("\n"); } } } while (0)
+
+/* Returns a buffer of Size bytes that ends Gap bytes before the guard page */
+static unsigned char *
+AtPageEnd(size_t Size, size_t Gap)
+{
+    return ArenaEnd - Gap - Size;
+}
+
+static void
+Fill(unsigned char *p, size_t Size, unsigned Seed)
+{
+    size_t i;
+
+    /* Nonzero pattern with high bytes in it */
+    for (i = 0; i < Size; i++)
+        p[i] = (unsigned char)(((i + Seed) * 37) % 255) + 1;
+}
+
+/* CORRECTNESS ***************************************************************/
+
+static void
+TestStrlenChr(void)
+{
+    size_t Len, Gap, i;
+    char *s;
+    WCHAR16 *w;
+
+    /* Gap moves both the alignment and the distance to the guard page */
+    for (Gap = 0; Gap < 64; Gap++)
+    {
+        for (Len = 0; Len < 300; Len++)
+        {
+            s = (char *)AtPageEnd(Len + 1, Gap);
+            Fill((unsigned char *)s, Len + 1 + Gap, (unsigned)Len);
+            s[Len] = 0;
+            CHECK(crt_strlen(s) == Len, "strlen len %zu gap %zu", Len, Gap);
+
+            for (i = 0; i < Len; i += 7)
+            {
+                CHECK(crt_strchr(s, s[i]) == RefStrchr(s, s[i]),
+                      "strchr len %zu gap %zu pos %zu", Len, Gap, i);
+            }
+            CHECK(crt_strchr(s, 0) == s + Len, "strchr nul len %zu", Len);
+            CHECK(crt_strchr(s, 0x100 | 'x') == RefStrchr(s, 'x'), "strchr int len %zu", Len);
+
+            /* A match behind the terminator must not count */
+            if (Gap)
+            {
+                s[Len + 1] = 0x7F;
+                CHECK(crt_strchr(s, 0x7F) == RefStrchr(s, 0x7F), "strchr past end len %zu", Len);
+            }
+        }
+    }
+
+    /* Wide strings, odd addresses included */
+    for (Gap = 0; Gap < 64; Gap++)
+    {
+        for (Len = 0; Len < 200; Len++)
+        {
+            w = (WCHAR16 *)AtPageEnd((Len + 1) * 2, Gap);
+            for (i = 0; i < Len; i++)
+                w[i] = (WCHAR16)(0x0101 + i * 0x0123 + Gap);
+            w[Len] = 0;
+
+            CHECK(crt_wcslen(w) == Len, "wcslen len %zu gap %zu", Len, Gap);
+            for (i = 0; i < Len; i += 5)
+            {
+                CHECK(crt_wcschr(w, w[i]) == RefWcschr(w, w[i]),
+                      "wcschr len %zu gap %zu pos %zu", Len, Gap, i);
+            }
+            CHECK(crt_wcschr(w, 0) == w + Len, "wcschr nul len %zu", Len);
+            CHECK(crt_wcschr(w, 0xFFFF) == RefWcschr(w, 0xFFFF), "wcschr absent len %zu", Len);
+        }
+    }
+}
+
+static void
+TestStrcmp(void)
+{
+    size_t Len, Gap, Offset, i;
+    char *s1, *s2;
+    WCHAR16 *w1, *w2;
+
+    for (Gap = 0; Gap < 32; Gap += 3)
+    {
+        for (Offset = 0; Offset < 32; Offset += 5)
+        {
+            for (Len = 0; Len < 200; Len++)
+            {
+                /* s1 ends near the guard page, s2 lives elsewhere */
+                s1 = (char *)AtPageEnd(Len + 1, Gap);
+                s2 = (char *)Arena + PAGE_SIZE * 3 + Offset;
+                Fill((unsigned char *)s1, Len + 1, (unsigned)Len);
+                memcpy(s2, s1, Len + 1);
+                s1[Len] = s2[Len] = 0;
+
+                CHECK(crt_strcmp(s1, s2) == 0, "strcmp equal len %zu", Len);
+                CHECK(_stricmp(s1, s2) == 0, "_stricmp equal len %zu", Len);
+                for (i = 0; i < Len; i += 3)
+                {
+                    char Saved = s2[i];
+
+                    s2[i] = (char)(Saved == (char)0xFF ? 1 : Saved + 1);
+                    CHECK(crt_strcmp(s1, s2) == Sign(RefStrcmp(s1, s2)),
+                          "strcmp len %zu pos %zu", Len, i);
+                    CHECK(crt_strcmp(s2, s1) == Sign(RefStrcmp(s2, s1)),
+                          "strcmp rev len %zu pos %zu", Len, i);
+                    CHECK(_stricmp(s1, s2) == RefStricmp(s1, s2),
+                          "_stricmp len %zu pos %zu", Len, i);
+                    s2[i] = Saved;
+                }
+
+                /* The shorter string compares lower */
+                if (Len)
+                {
+                    s2[Len - 1] = 0;
+                    CHECK(crt_strcmp(s1, s2) == 1, "strcmp prefix len %zu", Len);
+                    s2[Len - 1] = s1[Len - 1];
+                }
+
+                /* Case-only differences */
+                for (i = 0; i < Len; i++)
+                {
+                    unsigned char c = s1[i];
+
+                    s2[i] = (char)(isupper(c) ? tolower(c) : toupper(c));
+                }
+                CHECK(_stricmp(s1, s2) == RefStricmp(s1, s2), "_stricmp case len %zu", Len);
+            }
+        }
+    }
+
+    for (Gap = 0; Gap < 8; Gap++)
+    {
+        for (Len = 0; Len < 120; Len++)
+        {
+            w1 = (WCHAR16 *)AtPageEnd((Len + 1) * 2, Gap);
+            w2 = (WCHAR16 *)(Arena + PAGE_SIZE * 5 + Gap * 2);
+            for (i = 0; i < Len; i++)
+                w1[i] = w2[i] = (WCHAR16)((i * 0x3B1) % 0xFFFE + 1);
+            w1[Len] = w2[Len] = 0;
+
+            CHECK(crt_wcscmp(w1, w2) == 0, "wcscmp equal len %zu", Len);
+            CHECK(_wcsicmp(w1, w2) == 0, "_wcsicmp equal len %zu", Len);
+            for (i = 0; i < Len; i += 2)
+            {
+                WCHAR16 Saved = w2[i];
+
+                /* Differ in the high byte only */
+                w2[i] ^= 0x8000;
+                CHECK(crt_wcscmp(w1, w2) == Sign(RefWcscmp(w1, w2)), "wcscmp len %zu pos %zu", Len, i);
+                CHECK(_wcsicmp(w1, w2) == RefWcsicmp(w1, w2), "_wcsicmp len %zu pos %zu", Len, i);
+                w2[i] = Saved;
+            }
+        }
+    }
+}
+
+static void
+TestMem(void)
+{
+    unsigned char *Src, *Dst, *Ref;
+    size_t Len, Align, i;
+    long Delta;
+
+    for (Align = 0; Align < 32; Align++)
+    {
+        for (Len = 0; Len < 300; Len++)
+        {
+            Src = AtPageEnd(Len, 0);
+            Dst = Arena + PAGE_SIZE * 2 + Align;
+            Fill(Src, Len, (unsigned)(Len + Align));
+            memcpy(Dst, Src, Len);
+
+            CHECK(crt_memcmp(Src, Dst, Len) == 0, "memcmp equal len %zu", Len);
+            for (i = 0; i < Len; i += 3)
+            {
+                Dst[i] ^= 0x80;
+                CHECK(crt_memcmp(Src, Dst, Len) == RefMemcmp(Src, Dst, Len), "memcmp len %zu pos %zu", Len, i);
+                CHECK(crt_memchr(Src, Dst[i], Len) == RefMemchr(Src, Dst[i], Len), "memchr len %zu pos %zu", Len, i);
+                Dst[i] ^= 0x80;
+                CHECK(crt_memchr(Src, Src[i], Len) == RefMemchr(Src, Src[i], Len), "memchr hit len %zu pos %zu", Len, i);
+            }
+            CHECK(crt_memchr(Src, 0, Len) == NULL, "memchr absent len %zu", Len);
+        }
+    }
+
+    /* Copies in both directions with every overlap distance */
+    Ref = malloc(PAGE_SIZE * 4);
+    for (Len = 0; Len < 600; Len += (Len < 150) ? 1 : 17)
+    {
+        for (Delta = -70; Delta <= 70; Delta++)
+        {
+            unsigned char *Base = Arena + PAGE_SIZE * 8;
+
+            Fill(Base, PAGE_SIZE, (unsigned)Len);
+            memcpy(Ref, Base, PAGE_SIZE);
+            CHECK(crt_memmove(Base + 200 + Delta, Base + 200, Len) == Base + 200 + Delta, "memmove result");
+            RefMemmove(Ref + 200 + Delta, Ref + 200, Len);
+            CHECK(memcmp(Ref, Base, PAGE_SIZE) == 0, "memmove len %zu delta %ld", Len, Delta);
+
+            if (Delta <= -(long)Len || Delta >= (long)Len)
+            {
+                Fill(Base, PAGE_SIZE, (unsigned)Len + 1);
+                memcpy(Ref, Base, PAGE_SIZE);
+                crt_memcpy(Base + 200 + Delta, Base + 200, Len);
+                RefMemmove(Ref + 200 + Delta, Ref + 200, Len);
+                CHECK(memcmp(Ref, Base, PAGE_SIZE) == 0, "memcpy len %zu delta %ld", Len, Delta);
+            }
+        }
+    }
+    free(Ref);
+
+    /* Large copies take the streaming path when disjoint */
+    Len = 3 * 1024 * 1024 + 7;
+    Src = malloc(Len + 64);
+    Dst = malloc(Len + 64);
+    Ref = malloc(Len + 64);
+    for (Align = 0; Align < 3; Align++)
+    {
+        Fill(Src, Len + 64, (unsigned)Align);
+        memset(Dst, 0, Len + 64);
+        crt_memcpy(Dst + Align * 5, Src + Align, Len);
+        CHECK(memcmp(Dst + Align * 5, Src + Align, Len) == 0, "large memcpy align %zu", Align);
+        CHECK(Dst[Align * 5 + Len] == 0, "large memcpy overrun align %zu", Align);
+
+        /* And the overlapping path when not */
+        memcpy(Ref, Src, Len + 64);
+        crt_memmove(Src + Align + 1, Src, Len);
+        RefMemmove(Ref + Align + 1, Ref, Len);
+        CHECK(memcmp(Ref, Src, Len + 64) == 0, "large memmove align %zu", Align);
+    }
+    free(Src);
+    free(Dst);
+    free(Ref);
+}
+
+/* THROUGHPUT ****************************************************************/
+
+typedef size_t (*PBENCH_ROUTINE)(unsigned char *a, unsigned char *b, size_t Size);
+
+typedef struct _BENCHMARK
+{
+    const char *Routine;
+    const char *Impl;
+    PBENCH_ROUTINE Run;
+    int Wide;
+} BENCHMARK;
+
+static size_t BStrlenSse(unsigned char *a, unsigned char *b, size_t n) { return crt_strlen((char *)a); }
+static size_t BStrlenRef(unsigned char *a, unsigned char *b, size_t n) { return RefStrlen((char *)a); }
+static size_t BWcslenSse(unsigned char *a, unsigned char *b, size_t n) { return crt_wcslen((WCHAR16 *)a); }
+static size_t BWcslenRef(unsigned char *a, unsigned char *b, size_t n) { return RefWcslen((WCHAR16 *)a); }
+static size_t BStrchrSse(unsigned char *a, unsigned char *b, size_t n) { return (size_t)crt_strchr((char *)a, 0x7F); }
+static size_t BStrchrRef(unsigned char *a, unsigned char *b, size_t n) { return (size_t)RefStrchr((char *)a, 0x7F); }
+static size_t BWcschrSse(unsigned char *a, unsigned char *b, size_t n) { return (size_t)crt_wcschr((WCHAR16 *)a, 0x7F); }
+static size_t BWcschrRef(unsigned char *a, unsigned char *b, size_t n) { return (size_t)RefWcschr((WCHAR16 *)a, 0x7F); }
+static size_t BStrcmpSse(unsigned char *a, unsigned char *b, size_t n) { return crt_strcmp((char *)a, (char *)b); }
+static size_t BStrcmpRef(unsigned char *a, unsigned char *b, size_t n) { return RefStrcmp((char *)a, (char *)b); }
+static size_t BWcscmpSse(unsigned char *a, unsigned char *b, size_t n) { return crt_wcscmp((WCHAR16 *)a, (WCHAR16 *)b); }
+static size_t BWcscmpRef(unsigned char *a, unsigned char *b, size_t n) { return RefWcscmp((WCHAR16 *)a, (WCHAR16 *)b); }
+static size_t BStricmpNew(unsigned char *a, unsigned char *b, size_t n) { return _stricmp((char *)a, (char *)b); }
+static size_t BStricmpRef(unsigned char *a, unsigned char *b, size_t n) { return RefStricmp((char *)a, (char *)b); }
+static size_t BWcsicmpNew(unsigned char *a, unsigned char *b, size_t n) { return _wcsicmp((WCHAR16 *)a, (WCHAR16 *)b); }
+static size_t BWcsicmpRef(unsigned char *a, unsigned char *b, size_t n) { return RefWcsicmp((WCHAR16 *)a, (WCHAR16 *)b); }
+static size_t BMemchrSse(unsigned char *a, unsigned char *b, size_t n) { return (size_t)crt_memchr(a, 0, n); }
+static size_t BMemchrRef(unsigned char *a, unsigned char *b, size_t n) { return (size_t)RefMemchr(a, 0, n); }
+static size_t BMemcmpSse(unsigned char *a, unsigned char *b, size_t n) { return crt_memcmp(a, b, n); }
+static size_t BMemcmpRef(unsigned char *a, unsigned char *b, size_t n) { return RefMemcmp(a, b, n); }
+static size_t BMemcpySse(unsigned char *a, unsigned char *b, size_t n) { return (size_t)crt_memcpy(b, a, n); }
+static size_t BMemcpyRef(unsigned char *a, unsigned char *b, size_t n) { return (size_t)RefMemmove(b, a, n); }
+
+static const BENCHMARK Benchmarks[] =
+{
+    { "strlen",   "sse2",     BStrlenSse,  0 },
+    { "strlen",   "portable", BStrlenRef,  0 },
+    { "wcslen",   "sse2",     BWcslenSse,  1 },
+    { "wcslen",   "portable", BWcslenRef,  1 },
+    { "strchr",   "sse2",     BStrchrSse,  0 },
+    { "strchr",   "portable", BStrchrRef,  0 },
+    { "wcschr",   "sse2",     BWcschrSse,  1 },
+    { "wcschr",   "portable", BWcschrRef,  1 },
+    { "strcmp",   "sse2",     BStrcmpSse,  0 },
+    { "strcmp",   "portable", BStrcmpRef,  0 },
+    { "wcscmp",   "sse2",     BWcscmpSse,  1 },
+    { "wcscmp",   "portable", BWcscmpRef,  1 },
+    { "_stricmp", "word",     BStricmpNew, 0 },
+    { "_stricmp", "portable", BStricmpRef, 0 },
+    { "_wcsicmp", "word",     BWcsicmpNew, 1 },
+    { "_wcsicmp", "portable", BWcsicmpRef, 1 },
+    { "memchr",   "sse2",     BMemchrSse,  0 },
+    { "memchr",   "portable", BMemchrRef,  0 },
+    { "memcmp",   "sse2",     BMemcmpSse,  0 },
+    { "memcmp",   "portable", BMemcmpRef,  0 },
+    { "memcpy",   "sse2",     BMemcpySse,  0 },
+    { "memcpy",   "portable", BMemcpyRef,  0 },
+};
+
+static const size_t BenchSizes[] = { 16, 64, 256, 4096, 65536, 4 << 20 };
+
+static unsigned long long
+NowNs(void)
+{
+    struct timespec Ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &Ts);
+    return (unsigned long long)Ts.tv_sec * 1000000000ULL + Ts.tv_nsec;
+}
+
+static void
+RunBenchmarks(unsigned Runs, int argc, char **argv, int First)
+{
+    size_t MaxSize = BenchSizes[sizeof(BenchSizes) / sizeof(BenchSizes[0]) - 1];
+    unsigned char *a = malloc(MaxSize + 64), *b = malloc(MaxSize + 64);
+    unsigned long long Best, Start, Elapsed;
+    size_t i, s, Size, Iterations, k;
+    unsigned r;
+    int Arg;
+
+    printf("routine,impl,size,runs,min_ns,bytes_per_ns\n");
+
+    for (i = 0; i < sizeof(Benchmarks) / sizeof(Benchmarks[0]); i++)
+    {
+        if (First < argc)
+        {
+            for (Arg = First; Arg < argc; Arg++)
+            {
+                if (strstr(Benchmarks[i].Routine, argv[Arg]))
+                    break;
+            }
+            if (Arg == argc)
+                continue;
+        }
+
+        for (s = 0; s < sizeof(BenchSizes) / sizeof(BenchSizes[0]); s++)
+        {
+            Size = BenchSizes[s];
+
+            /* Equal strings without the searched characters, terminated
+               at Size bytes; lower case letters for the icmp runs */
+            for (k = 0; k < Size; k++)
+                a[k] = b[k] = 'a' + k % 26;
+            memset(a + Size, 0, 64);
+            memset(b + Size, 0, 64);
+
+            /* About 64 MiB of work per sample */
+            Iterations = (64 << 20) / Size;
+            Best = ~0ULL;
+            for (r = 0; r < Runs; r++)
+            {
+                Start = NowNs();
+                for (k = 0; k < Iterations; k++)
+                    BenchSink += Benchmarks[i].Run(a, b, Size);
+                Elapsed = NowNs() - Start;
+                if (Elapsed < Best)
+                    Best = Elapsed;
+            }
+
+            printf("%s,%s,%zu,%u,%llu,%.2f\n",
+                   Benchmarks[i].Routine,
+                   Benchmarks[i].Impl,
+                   Size,
+                   Runs,
+                   Best / Iterations,
+                   (double)Size * Iterations / (Best ? Best : 1));
+            fflush(stdout);
+        }
+    }
+
+    free(a);
+    free(b);
+}
+
+/* DRIVER ********************************************************************/
+
+static void
+Usage(void)
+{
+    printf("Usage: crtbench [-t] [-r runs] [filter ...]\n"
+           "  -t        Run the correctness checks only\n"
+           "  -r runs   Repetitions per measurement (default 3)\n"
+           "The checks always run first. Only routines whose name contains\n"
+           "one of the filters are timed.\n");
+}
+
+int main(int argc, char **argv)
+{
+    unsigned Runs = 3;
+    int TestOnly = 0, Arg;
+
+    for (Arg = 1; Arg < argc && argv[Arg][0] == '-'; Arg++)
+    {
+        if (!strcmp(argv[Arg], "-t"))
+        {
+            TestOnly = 1;
+        }
+        else if (Arg + 1 < argc && !strcmp(argv[Arg], "-r"))
+        {
+            Runs = strtoul(argv[++Arg], NULL, 0);
+        }
+        else
+        {
+            Usage();
+            return 1;
+        }
+    }
+
+    if (Runs == 0)
+    {
+        Usage();
+        return 1;
+    }
+
+    /* All but the last page are usable, the last one faults */
+    Arena = mmap(NULL, ARENA_PAGES * PAGE_SIZE, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (Arena == MAP_FAILED)
+    {
+        fprintf(stderr, "crtbench: out of memory\n");
+        return 1;
+    }
+    ArenaEnd = Arena + (ARENA_PAGES - 1) * PAGE_SIZE;
+    mprotect(ArenaEnd, PAGE_SIZE, PROT_NONE);
+
+    TestStrlenChr();
+    TestStrcmp();
+    TestMem();
+    Failures += TestFloat();
+
+    if (Failures)
+    {
+        printf("crtbench: %lu checks failed\n", Failures);
+        return 1;
+    }
+    fprintf(stderr, "crtbench: all checks passed\n");
+
+    if (!TestOnly)
+    {
+        RunBenchmarks(Runs, argc, argv, Arg);
+        RunFloatBenchmarks(Runs, argc, argv, Arg);
+    }
+
+    munmap(Arena, ARENA_PAGES * PAGE_SIZE);
+    return 0;
+}
@@ -0,0 +1,552 @@
+/*
+ * PROJECT:     ReactOS CRT Benchmarks
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Checks and timings for the CRT floating point conversions
+ *
+ * glibc prints the exact decimal expansion of any double and its strtod
+ * rounds correctly, so both serve as references: the digits produced by
+ * sdk/lib/crt/stdlib/fpconv.c are compared for samples from every binary
+ * exponent, and sdk/lib/crt/string/strtod.c is fed round trips, exact
+ * halfway points and their neighbours. glibc rounds ties to even where
+ * msvcrt rounds them away from zero, so formatted ties are checked
+ * against the exact digits instead.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <internal/fpconv.h>
+
+/* sdk/lib/crt/string/strtod.c */
+extern double crt_strtod(const char *s, char **sret);
+
+#define EXACT_DIGITS    800
+
+static unsigned long FpFailures;
+static volatile double FpSink;
+static unsigned long long RandState = 0x9E3779B97F4A7C15ULL;
+
+#define FPCHECK(Cond, ...) \
+    do { if (!(Cond)) { FpFailures++; if (FpFailures <= 20) { \
+        printf("FAIL %s:%d: ", __FUNCTION__, __LINE__); \
+        printf(__VA_ARGS__); printf("\n"); } } } while (0)
+
+/* HELPERS *******************************************************************/
+
+static unsigned long long
+Rand64(void)
+{
+    /* xorshift64* */
+    RandState ^= RandState >> 12;
+    RandState ^= RandState << 25;
+    RandState ^= RandState >> 27;
+    return RandState * 0x2545F4914F6CDD1DULL;
+}
+
+static double
+FromBits(unsigned long long Bits)
+{
+    double d;
+
+    memcpy(&d, &Bits, sizeof(d));
+    return d;
+}
+
+static unsigned long long
+ToBits(double d)
+{
+    unsigned long long Bits;
+
+    memcpy(&Bits, &d, sizeof(Bits));
+    return Bits;
+}
+
+/* A positive finite double with the given biased exponent */
+static double
+RandomDouble(unsigned Exponent)
+{
+    return FromBits(((unsigned long long)Exponent << 52) | (Rand64() >> 12));
+}
+
+/* The exact digits of a positive double as 0.Digits * 10^Decpt, without
+   trailing zeros */
+static int
+ExactDigits(double Value, char *Digits, int *Decpt)
+{
+    char Text[EXACT_DIGITS + 32];
+    char *p, *e;
+    int Count = 0;
+
+    snprintf(Text, sizeof(Text), "%.*e", EXACT_DIGITS, Value);
+    e = strchr(Text, 'e');
+    for (p = Text; p < e; p++)
+    {
+        if (*p != '.')
+            Digits[Count++] = *p;
+    }
+    *Decpt = atoi(e + 1) + 1;
+
+    while (Count && Digits[Count - 1] == '0')
+        Count--;
+
+    return Count;
+}
+
+/* Rounds the exact digits like __crt_dtoa should, and reports ties */
+static int
+RefDtoa(double Value, int Mode, int NDigits, char *Digits, int *Decpt, int *Tie)
+{
+    int Count, Cut, i;
+
+    *Tie = 0;
+    if (Value == 0)
+    {
+        *Decpt = 0;
+        return 0;
+    }
+
+    Count = ExactDigits(Value, Digits, Decpt);
+    Cut = Mode == FPCONV_SIGNIFICANT ? NDigits : *Decpt + NDigits;
+    if (Cut < 0)
+        return 0;
+
+    if (Count > Cut)
+    {
+        *Tie = Digits[Cut] == '5' && Count == Cut + 1;
+        i = Cut;
+        if (Digits[Cut] >= '5')
+        {
+            while (i && Digits[i - 1] == '9')
+                i--;
+            if (i)
+            {
+                Digits[i - 1]++;
+            }
+            else
+            {
+                Digits[0] = '1';
+                i = 1;
+                (*Decpt)++;
+            }
+        }
+        Count = i;
+    }
+
+    while (Count && Digits[Count - 1] == '0')
+        Count--;
+
+    return Count;
+}
+
+/* glibc prints at least two exponent digits, msvcrt three */
+static void
+WidenExponent(char *Text)
+{
+    char *e = strpbrk(Text, "eE");
+    size_t Len;
+
+    if (!e)
+        return;
+
+    Len = strlen(e + 2);
+    if (Len < 3)
+    {
+        memmove(e + 2 + 3 - Len, e + 2, Len + 1);
+        memset(e + 2, '0', 3 - Len);
+    }
+}
+
+/* CORRECTNESS ***************************************************************/
+
+static void
+CheckDtoa(double Value, int Mode, int NDigits)
+{
+    char Digits[FPCONV_BUFFER_SIZE], Expected[EXACT_DIGITS + 32];
+    int Count, Decpt, RefCount, RefDecpt, Tie;
+
+    Count = __crt_dtoa(Value, Mode, NDigits, Digits, &Decpt);
+    RefCount = RefDtoa(Value, Mode, NDigits, Expected, &RefDecpt, &Tie);
+
+    FPCHECK(Count == RefCount && (!Count || Decpt == RefDecpt) &&
+            !memcmp(Digits, Expected, Count),
+            "dtoa(%a, %d, %d): %.*s e%d, expected %.*s e%d",
+            Value, Mode, NDigits, Count, Digits, Decpt, RefCount, Expected, RefDecpt);
+}
+
+static void
+TestDtoa(void)
+{
+    static const int Counts[] = { 0, 1, 2, 3, 6, 15, 17, 18, 25, 40, 120, 800 };
+    unsigned Exponent, i, k;
+    double Value;
+
+    /* A few samples from every binary exponent, subnormals included */
+    for (Exponent = 0; Exponent < 0x7FF; Exponent++)
+    {
+        for (i = 0; i < 4; i++)
+        {
+            Value = RandomDouble(Exponent);
+            for (k = 0; k < sizeof(Counts) / sizeof(Counts[0]); k++)
+            {
+                if (Counts[k])
+                    CheckDtoa(Value, FPCONV_SIGNIFICANT, Counts[k]);
+                CheckDtoa(Value, FPCONV_FIXED, Counts[k]);
+            }
+        }
+
+        /* The power of two itself and its neighbours */
+        Value = FromBits((unsigned long long)Exponent << 52);
+        CheckDtoa(Value, FPCONV_SIGNIFICANT, 17);
+        CheckDtoa(Value, FPCONV_FIXED, 6);
+        CheckDtoa(FromBits(ToBits(Value) + 1), FPCONV_SIGNIFICANT, 800);
+        if (Exponent)
+            CheckDtoa(FromBits(ToBits(Value) - 1), FPCONV_SIGNIFICANT, 800);
+    }
+
+    /* Values with short expansions, where rounding sees ties and carries */
+    for (i = 0; i < 20000; i++)
+    {
+        Value = (double)(Rand64() % 2000000) / (1 << (Rand64() % 12));
+        for (k = 0; k < 8; k++)
+        {
+            CheckDtoa(Value, FPCONV_SIGNIFICANT, k + 1);
+            CheckDtoa(Value, FPCONV_FIXED, k);
+        }
+    }
+}
+
+static void
+CheckFormat(double Value, int Chr, int Precision, int Alternate)
+{
+    char Buffer[512], Expected[EXACT_DIGITS + 64], Digits[EXACT_DIGITS + 32];
+    char Exact[EXACT_DIGITS + 32], Format[16];
+    int Decpt, ExactDecpt, Tie = 0, P;
+
+    /* Skip the ties, glibc rounds them to even */
+    switch (Chr)
+    {
+        case 'e': case 'E':
+            RefDtoa(Value, FPCONV_SIGNIFICANT, Precision + 1, Digits, &Decpt, &Tie);
+            break;
+        case 'f':
+            RefDtoa(Value, FPCONV_FIXED, Precision, Digits, &Decpt, &Tie);
+            break;
+        default:
+            P = Precision ? Precision : 1;
+            RefDtoa(Value, FPCONV_SIGNIFICANT, P, Digits, &Decpt, &Tie);
+
+            /* glibc keeps the digit count of the value before rounding
+               when %#g carries into a new power of ten, C99 doesn't */
+            if (Alternate && Value != 0)
+            {
+                ExactDigits(Value, Exact, &ExactDecpt);
+                if (ExactDecpt != Decpt)
+                    return;
+            }
+            break;
+    }
+    if (Tie)
+        return;
+
+    snprintf(Format, sizeof(Format), "%%%s.*%c", Alternate ? "#" : "", Chr);
+    snprintf(Expected, sizeof(Expected), Format, Precision, Value);
+    WidenExponent(Expected);
+
+    __crt_format_double(Buffer, sizeof(Buffer), Value, Chr, Precision, Alternate);
+
+    FPCHECK(!strcmp(Buffer, Expected), "%s of %a: \"%s\", expected \"%s\"",
+            Format, Value, Buffer, Expected);
+}
+
+static void
+CheckLiteral(double Value, int Chr, int Precision, int Alternate, const char *Expected)
+{
+    char Buffer[512];
+    int Len;
+
+    Len = __crt_format_double(Buffer, sizeof(Buffer), Value, Chr, Precision, Alternate);
+    FPCHECK(!strcmp(Buffer, Expected) && Len == (int)strlen(Expected),
+            "%%%c.%d of %a: \"%s\", expected \"%s\"", Chr, Precision, Value, Buffer, Expected);
+}
+
+static void
+TestFormat(void)
+{
+    static const char Chars[] = "eEfgG";
+    static const int Precisions[] = { 0, 1, 2, 3, 6, 10, 16, 17, 20, 40 };
+    char Buffer[48];
+    unsigned Exponent, i, c, p;
+    double Value;
+
+    for (Exponent = 0; Exponent < 0x7FF; Exponent += 3)
+    {
+        for (i = 0; i < 2; i++)
+        {
+            Value = RandomDouble(Exponent);
+            for (c = 0; c < sizeof(Chars) - 1; c++)
+            {
+                for (p = 0; p < sizeof(Precisions) / sizeof(Precisions[0]); p++)
+                    CheckFormat(Value, Chars[c], Precisions[p], i);
+            }
+        }
+    }
+
+    for (i = 0; i < 20000; i++)
+    {
+        Value = (double)(Rand64() % 10000000) / (1 << (Rand64() % 20));
+        for (c = 0; c < sizeof(Chars) - 1; c++)
+            CheckFormat(Value, Chars[c], Rand64() % 12, Rand64() & 1);
+    }
+
+    /* msvcrt specifics: three exponent digits, ties away from zero */
+    CheckLiteral(1.0, 'e', 2, 0, "1.00e+000");
+    CheckLiteral(0.5, 'f', 0, 0, "1");
+    CheckLiteral(2.5, 'f', 0, 0, "3");
+    CheckLiteral(0.125, 'f', 2, 0, "0.13");
+    CheckLiteral(1.0, 'f', 0, 1, "1.");
+    CheckLiteral(1.0, 'g', 6, 1, "1.00000");
+    CheckLiteral(0.0, 'g', 6, 0, "0");
+    CheckLiteral(0.0, 'e', 3, 0, "0.000e+000");
+    CheckLiteral(1e-5, 'g', 6, 0, "1e-005");
+    CheckLiteral(0.0001, 'g', 6, 0, "0.0001");
+    CheckLiteral(1e6, 'G', 6, 0, "1E+006");
+    CheckLiteral(1e23, 'f', 0, 0, "99999999999999991611392");
+    CheckLiteral(0.1, 'f', 20, 0, "0.10000000000000000555");
+    CheckLiteral(5e-324, 'e', 3, 0, "4.941e-324");
+    CheckLiteral(FromBits(0x7FF0000000000000ULL), 'f', 6, 0, "1.#INF");
+    CheckLiteral(FromBits(0x7FF8000000000000ULL), 'e', 0, 0, "1#QNAN");
+
+    /* A small buffer cuts the precision, then falls back to %e */
+    __crt_format_double(Buffer, sizeof(Buffer), 1.0 / 3, 'f', 100, 0);
+    FPCHECK(strlen(Buffer) < sizeof(Buffer) && !strncmp(Buffer, "0.3333", 6), "\"%s\"", Buffer);
+    __crt_format_double(Buffer, sizeof(Buffer), 1e300, 'f', 6, 0);
+    FPCHECK(!strcmp(Buffer, "1.0000000000000000525047602552044202487045e+300"), "\"%s\"", Buffer);
+}
+
+static void
+CheckStrtod(const char *Text)
+{
+    char *End, *RefEnd;
+    double Value, Expected;
+    int Err, RefErr;
+
+    errno = 0;
+    Expected = strtod(Text, &RefEnd);
+    RefErr = errno;
+
+    errno = 0;
+    Value = crt_strtod(Text, &End);
+    Err = errno;
+
+    /* glibc also reports ERANGE for subnormal results */
+    if (RefErr == ERANGE && Expected != 0 && ToBits(Expected) << 1 < 0xFFE0000000000000ULL)
+        RefErr = 0;
+
+    FPCHECK(ToBits(Value) == ToBits(Expected) && End == RefEnd && Err == RefErr,
+            "strtod(\"%.60s\"): %a +%d errno %d, expected %a +%d errno %d",
+            Text, Value, (int)(End - Text), Err, Expected, (int)(RefEnd - Text), RefErr);
+}
+
+/* Builds d.ddd followed by Fill nines or zeros and Tail, times 10^Power */
+static void
+MakeDecimal(char *Text, const char *Digits, int Count, const char *Tail, int Fill, int Power)
+{
+    char *p = Text;
+
+    *p++ = Digits[0];
+    *p++ = '.';
+    memcpy(p, Digits + 1, Count - 1);
+    p += Count - 1;
+    memset(p, *Tail == '9' ? '9' : '0', Fill);
+    p += Fill;
+    sprintf(p, "%se%d", Tail, Power);
+}
+
+static void
+TestStrtod(void)
+{
+    static const char *Literals[] =
+    {
+        "", "  ", "abc", "+", "-", ".", "-.e1", "1e", "1e+", "1e-x", ".5", "5.",
+        "  -0", "\t\n 42", "1e400", "-1e400", "1e-400", "0e999999999",
+        "1e99999999999999999999", "1e-99999999999999999999",
+        "2.2250738585072011e-308", "2.2250738585072012e-308",
+        "4.9406564584124654e-324", "2.4703282292062327e-324",
+        "2.4703282292062328e-324", "1.7976931348623157e308",
+        "1.7976931348623158e308", "1.7976931348623159e308",
+        "9007199254740993", "9007199254740992.5", "0.1", "3.14159265358979323846",
+        "123456789012345678901234567890", "000000000000000000000001.5e-3",
+    };
+    char Text[2048], Exact[EXACT_DIGITS + 64], Digits[EXACT_DIGITS + 32];
+    unsigned Exponent, i;
+    int Count, Power;
+    long double Half;
+    double Value, Next;
+    char *p, *q;
+
+    for (i = 0; i < sizeof(Literals) / sizeof(Literals[0]); i++)
+        CheckStrtod(Literals[i]);
+
+    /* Round trips at assorted lengths from every binary exponent */
+    for (Exponent = 0; Exponent < 0x7FF; Exponent++)
+    {
+        for (i = 0; i < 8; i++)
+        {
+            Value = RandomDouble(Exponent);
+            snprintf(Text, sizeof(Text), "%.*e", (int)(Rand64() % 25), (i & 1) ? -Value : Value);
+            CheckStrtod(Text);
+        }
+        snprintf(Text, sizeof(Text), "%.17g", RandomDouble(Exponent));
+        CheckStrtod(Text);
+    }
+
+    /* The exact halfway points, and values just above and below them */
+    for (Exponent = 0; Exponent < 0x7FE; Exponent++)
+    {
+        Value = RandomDouble(Exponent);
+        Next = FromBits(ToBits(Value) + 1);
+
+        /* 64 bits of mantissa hold the halfway point exactly */
+        Half = ((long double)Value + (long double)Next) / 2;
+        snprintf(Exact, sizeof(Exact), "%.*Le", EXACT_DIGITS, Half);
+        p = strchr(Exact, 'e');
+        Power = atoi(p + 1);
+        for (Count = 0, q = Exact; q < p; q++)
+        {
+            if (*q != '.')
+                Digits[Count++] = *q;
+        }
+        while (Digits[Count - 1] == '0')
+            Count--;
+
+        MakeDecimal(Text, Digits, Count, "", 0, Power);
+        CheckStrtod(Text);
+        MakeDecimal(Text, Digits, Count, "1", 900, Power);
+        CheckStrtod(Text);
+
+        /* Take one off the last digit, it isn't zero */
+        Digits[Count - 1]--;
+        MakeDecimal(Text, Digits, Count, "9999", 0, Power);
+        CheckStrtod(Text);
+        MakeDecimal(Text, Digits, Count, "9", 900, Power);
+        CheckStrtod(Text);
+    }
+}
+
+/* THROUGHPUT ****************************************************************/
+
+#define FP_INPUTS   4096
+
+static unsigned long long
+FpNowNs(void)
+{
+    struct timespec Ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &Ts);
+    return (unsigned long long)Ts.tv_sec * 1000000000ULL + Ts.tv_nsec;
+}
+
+static int
+FpSelected(const char *Routine, int argc, char **argv, int First)
+{
+    int Arg;
+
+    if (First >= argc)
+        return 1;
+
+    for (Arg = First; Arg < argc; Arg++)
+    {
+        if (strstr(Routine, argv[Arg]))
+            return 1;
+    }
+
+    return 0;
+}
+
+static void
+TimeFormat(const char *Routine, const char *Format, int Chr, int Precision,
+           const double *Values, unsigned Runs)
+{
+    unsigned long long Best[2] = { ~0ULL, ~0ULL }, Start, Elapsed;
+    char Buffer[512];
+    unsigned r, i, Impl;
+
+    for (r = 0; r < Runs; r++)
+    {
+        for (Impl = 0; Impl < 2; Impl++)
+        {
+            Start = FpNowNs();
+            for (i = 0; i < FP_INPUTS; i++)
+            {
+                if (Impl)
+                    snprintf(Buffer, sizeof(Buffer), Format, Precision, Values[i]);
+                else
+                    __crt_format_double(Buffer, sizeof(Buffer), Values[i], Chr, Precision, 0);
+                FpSink += Buffer[0];
+            }
+            Elapsed = FpNowNs() - Start;
+            if (Elapsed < Best[Impl])
+                Best[Impl] = Elapsed;
+        }
+    }
+
+    printf("%s,reactos,%u,%u,%llu,%.1f\n", Routine, FP_INPUTS, Runs, Best[0], (double)Best[0] / FP_INPUTS);
+    printf("%s,glibc,%u,%u,%llu,%.1f\n", Routine, FP_INPUTS, Runs, Best[1], (double)Best[1] / FP_INPUTS);
+}
+
+void
+RunFloatBenchmarks(unsigned Runs, int argc, char **argv, int First)
+{
+    static char Texts[FP_INPUTS][32];
+    double *Values = malloc(FP_INPUTS * sizeof(double));
+    unsigned long long Best[2] = { ~0ULL, ~0ULL }, Start, Elapsed;
+    unsigned r, i, Impl;
+
+    /* Magnitudes around 1e-30..1e30, the common case */
+    for (i = 0; i < FP_INPUTS; i++)
+        Values[i] = RandomDouble(0x3FF - 100 + Rand64() % 200);
+
+    printf("routine,impl,inputs,runs,min_ns,ns_per_call\n");
+
+    if (FpSelected("printf_e17", argc, argv, First))
+        TimeFormat("printf_e17", "%.*e", 'e', 17, Values, Runs);
+    if (FpSelected("printf_g6", argc, argv, First))
+        TimeFormat("printf_g6", "%.*g", 'g', 6, Values, Runs);
+    if (FpSelected("printf_f6", argc, argv, First))
+        TimeFormat("printf_f6", "%.*f", 'f', 6, Values, Runs);
+
+    if (FpSelected("strtod", argc, argv, First))
+    {
+        for (i = 0; i < FP_INPUTS; i++)
+            snprintf(Texts[i], sizeof(Texts[i]), "%.17g", Values[i]);
+
+        for (r = 0; r < Runs; r++)
+        {
+            for (Impl = 0; Impl < 2; Impl++)
+            {
+                Start = FpNowNs();
+                for (i = 0; i < FP_INPUTS; i++)
+                    FpSink += Impl ? strtod(Texts[i], NULL) : crt_strtod(Texts[i], NULL);
+                Elapsed = FpNowNs() - Start;
+                if (Elapsed < Best[Impl])
+                    Best[Impl] = Elapsed;
+            }
+        }
+
+        printf("strtod,reactos,%u,%u,%llu,%.1f\n", FP_INPUTS, Runs, Best[0], (double)Best[0] / FP_INPUTS);
+        printf("strtod,glibc,%u,%u,%llu,%.1f\n", FP_INPUTS, Runs, Best[1], (double)Best[1] / FP_INPUTS);
+    }
+
+    free(Values);
+}
+
+unsigned long
+TestFloat(void)
+{
+    TestDtoa();
+    TestFormat();
+    TestStrtod();
+    return FpFailures;
+}
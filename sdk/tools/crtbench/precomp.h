@@ -0,0 +1,21 @@
+/*
+ * PROJECT:     ReactOS CRT Benchmarks
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Host stand-in for the CRT precompiled header
+ */
+
+#ifndef _CRTBENCH_PRECOMP_H
+#define _CRTBENCH_PRECOMP_H
+
+#include <ctype.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <wctype.h>
+
+#define CDECL
+#define _errno() (&errno)
+
+typedef uintptr_t ULONG_PTR;
+
+#endif /* _CRTBENCH_PRECOMP_H */
@@ -9,6 +9,12 @@
 
 #include "diskio.h"		/* FatFs lower layer API */
 #include <stdio.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 /*-----------------------------------------------------------------------*/
 /* Correspondence between physical drive number and image file handles.  */
@@ -17,6 +23,122 @@ UINT sectorCount[1] = { 0 };
 FILE* driveHandle[1] = { NULL };
 const int driveHandleCount = sizeof(driveHandle) / sizeof(FILE*);
 
+/*-----------------------------------------------------------------------*/
+/* In-memory view of the image file                                      */
+/*-----------------------------------------------------------------------*/
+/* Sector I/O on the view is a memcpy, so the sectors FatFs rewrites    */
+/* over and over (FAT, directories) cost no system call. On POSIX the    */
+/* image is mapped shared and the page cache does the write-back. Other  */
+/* hosts read the image into memory and write the dirty sectors back in  */
+/* runs at cleanup. The stdio path stays as fallback for files that      */
+/* cannot be viewed (and before an empty image is sized).                */
+
+static BYTE* driveView[1] = { NULL };
+static size_t driveViewSize[1] = { 0 };
+#if defined(_WIN32)
+static BYTE* driveDirty[1] = { NULL };
+
+#define SECTOR_DIRTY(pdrv, sect)    (driveDirty[pdrv][(sect) >> 3] & (1 << ((sect) & 7)))
+
+static VOID flush_image(BYTE pdrv)
+{
+    size_t count = driveViewSize[pdrv] / 512;
+    size_t sect, run;
+
+    for (sect = 0; sect < count; sect += run)
+    {
+        for (run = 0; sect + run < count && SECTOR_DIRTY(pdrv, sect + run); run++);
+        if (run == 0)
+        {
+            run = 1;
+            continue;
+        }
+        if (fseek(driveHandle[pdrv], (long)(sect * 512), SEEK_SET) == 0)
+            fwrite(driveView[pdrv] + sect * 512, 512, run, driveHandle[pdrv]);
+    }
+    memset(driveDirty[pdrv], 0, (count + 7) / 8);
+    fflush(driveHandle[pdrv]);
+}
+#endif
+
+static VOID unmap_image(BYTE pdrv)
+{
+    if (driveView[pdrv] == NULL)
+        return;
+#if defined(_WIN32)
+    flush_image(pdrv);
+    free(driveDirty[pdrv]);
+    free(driveView[pdrv]);
+    driveDirty[pdrv] = NULL;
+#else
+    munmap(driveView[pdrv], driveViewSize[pdrv]);
+#endif
+    driveView[pdrv] = NULL;
+    driveViewSize[pdrv] = 0;
+}
+
+static VOID map_image(BYTE pdrv)
+{
+    FILE* fp = driveHandle[pdrv];
+    size_t size;
+
+    unmap_image(pdrv);
+
+    fflush(fp);
+    if (fseek(fp, 0, SEEK_END))
+        return;
+    size = ftell(fp);
+    if (size < 512)
+        return;
+
+#if defined(_WIN32)
+    driveView[pdrv] = malloc(size);
+    driveDirty[pdrv] = calloc((size / 512 + 7) / 8, 1);
+    if (driveView[pdrv] == NULL || driveDirty[pdrv] == NULL ||
+        fseek(fp, 0, SEEK_SET) || fread(driveView[pdrv], 1, size, fp) != size)
+    {
+        free(driveDirty[pdrv]);
+        free(driveView[pdrv]);
+        driveDirty[pdrv] = NULL;
+        driveView[pdrv] = NULL;
+        return;
+    }
+#else
+    driveView[pdrv] = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fileno(fp), 0);
+    if (driveView[pdrv] == MAP_FAILED)
+    {
+        driveView[pdrv] = NULL;
+        return;
+    }
+#endif
+    driveViewSize[pdrv] = size;
+}
+
+static int grow_image(BYTE pdrv, DWORD count)
+{
+    FILE* fp = driveHandle[pdrv];
+    BYTE zero = 0;
+
+    unmap_image(pdrv);
+
+#if !defined(_WIN32)
+    fflush(fp);
+    if (ftruncate(fileno(fp), (off_t)count * 512) == 0)
+    {
+        map_image(pdrv);
+        return 0;
+    }
+#endif
+
+    /* Extend the file by writing its last byte */
+    if (fseek(fp, (long)count * 512 - 1, SEEK_SET))
+        return -1;
+    fwrite(&zero, 1, 1, fp);
+
+    map_image(pdrv);
+    return 0;
+}
+
 /*-----------------------------------------------------------------------*/
 /* Open an image file a Drive                                            */
 /*-----------------------------------------------------------------------*/
@@ -35,7 +157,10 @@ DSTATUS disk_openimage(BYTE pdrv, const char* imageFileName)
         }
 
         if (driveHandle[0] != NULL)
+        {
+            map_image(0);
             return 0;
+        }
     }
     return STA_NOINIT;
 }
@@ -53,6 +178,7 @@ VOID disk_cleanup(
     {
         if (driveHandle[pdrv] != NULL)
         {
+            unmap_image(pdrv);
             fclose(driveHandle[pdrv]);
             driveHandle[pdrv] = NULL;
         }
@@ -107,6 +233,15 @@ DRESULT disk_read(
 
     if (pdrv < driveHandleCount)
     {
+        if (driveView[pdrv] != NULL)
+        {
+            if ((size_t)sector + count > driveViewSize[pdrv] / 512)
+                return RES_ERROR;
+
+            memcpy(buff, driveView[pdrv] + (size_t)sector * 512, (size_t)count * 512);
+            return RES_OK;
+        }
+
         if (driveHandle[pdrv] != NULL)
         {
             if (fseek(driveHandle[pdrv], sector * 512, SEEK_SET))
@@ -142,6 +277,19 @@ DRESULT disk_write(
 
     if (pdrv < driveHandleCount)
     {
+        if (driveView[pdrv] != NULL)
+        {
+            if ((size_t)sector + count > driveViewSize[pdrv] / 512)
+                return RES_ERROR;
+
+            memcpy(driveView[pdrv] + (size_t)sector * 512, buff, (size_t)count * 512);
+#if defined(_WIN32)
+            for (; count; sector++, count--)
+                driveDirty[pdrv][sector >> 3] |= 1 << (sector & 7);
+#endif
+            return RES_OK;
+        }
+
         if (driveHandle[pdrv] != NULL)
         {
             if (fseek(driveHandle[pdrv], sector * 512, SEEK_SET))
@@ -179,7 +327,9 @@ DRESULT disk_ioctl(
             switch (cmd)
             {
             case CTRL_SYNC:
-                fflush(driveHandle[pdrv]);
+                /* The mapped view is written back when it is unmapped */
+                if (driveView[pdrv] == NULL)
+                    fflush(driveHandle[pdrv]);
                 return RES_OK;
             case GET_SECTOR_SIZE:
                 *(DWORD*)buff = 512;
@@ -212,11 +362,9 @@ DRESULT disk_ioctl(
 
                 if (size < count)
                 {
-                    if (fseek(driveHandle[pdrv], count * 512 - 1, SEEK_SET))
+                    if (grow_image(pdrv, count))
                         return RES_ERROR;
 
-                    fwrite(buff, 1, 1, driveHandle[pdrv]);
-
                     return RES_OK;
                 }
                 else
@@ -52,6 +52,11 @@
 /  (0:Disable or 1:Enable) */
 
 
+#define	_USE_EXPAND		1
+/* This option switches f_expand() function, which allocates a contiguous cluster
+/  block to an empty file ahead of writing it. (0:Disable or 1:Enable) */
+
+
 #define	_USE_FORWARD	0
 /* This option switches f_forward() function. (0:Disable or 1:Enable)
 /  To enable it, also _FS_TINY need to be set to 1. */
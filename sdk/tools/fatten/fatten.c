@@ -16,6 +16,15 @@ static FATFS g_Filesystem;
 static int isMounted = 0;
 static unsigned char buff[32768];
 
+// statistics for the -time report
+static int showTiming = 0;
+static unsigned long statFiles = 0;
+static unsigned long statDirs = 0;
+static unsigned long long statBytes = 0;
+
+// last directory created by make_parent_dirs, manifests are usually grouped by directory
+static char lastParent[1024];
+
 // tool needed by fatfs
 DWORD get_fattime(void)
 {
@@ -83,6 +92,224 @@ void print_help(const char* name)
            "            Creates a directory.\n");
     printf("    -list [<pattern>]\n"
            "            Lists files a directory (defaults to root).\n");
+    printf("    -manifest <manifest file>\n"
+           "            Adds every file listed in the manifest, one '<src path> <dst path>'\n"
+           "            pair per line (paths with spaces in double quotes). A line with\n"
+           "            only a path creates that directory, lines starting with '#' are\n"
+           "            ignored. Missing parent directories are created.\n");
+    printf("    -time\n"
+           "            Prints the number of files and bytes added and the time taken.\n");
+}
+
+double get_time(void)
+{
+#if _WIN32
+    // clock() is wall clock time with the MS CRT
+    return (double)clock() / CLOCKS_PER_SEC;
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+int add_file(const char* src, const char* dst)
+{
+    FILE* fe;
+    FIL   fv = { 0 };
+    UINT rdlen = 0;
+    UINT wrlen = 0;
+    DWORD total = 0;
+    long size;
+    int ret = 0;
+
+    fe = fopen(src, "rb");
+    if (!fe)
+    {
+        fprintf(stderr, "Error: Unable to open external file '%s' for reading.", src);
+        return 1;
+    }
+
+    if (f_open(&fv, dst, FA_WRITE | FA_CREATE_ALWAYS))
+    {
+        fprintf(stderr, "Error: Unable to open file '%s' for writing.", dst);
+        fclose(fe);
+        return 1;
+    }
+
+    // When the size is known up front, allocate the whole file as one
+    // contiguous cluster run. Without a free run large enough, f_write
+    // grows the chain cluster by cluster as before.
+    if (fseek(fe, 0, SEEK_END) == 0 && (size = ftell(fe)) > 0)
+        f_expand(&fv, (DWORD)size, 1);
+    fseek(fe, 0, SEEK_SET);
+
+    while ((rdlen = fread(buff, 1, sizeof(buff), fe)) > 0)
+    {
+        if (f_write(&fv, buff, rdlen, &wrlen) || wrlen < rdlen)
+        {
+            fprintf(stderr, "Error: Unable to write '%d' bytes to disk.", wrlen);
+            ret = 1;
+            break;
+        }
+        total += wrlen;
+    }
+
+    // The file shrank since it was measured
+    if (!ret && total < f_size(&fv) && f_truncate(&fv))
+        ret = 1;
+
+    fclose(fe);
+    if (f_close(&fv))
+        ret = 1;
+
+    statFiles++;
+    statBytes += total;
+    return ret;
+}
+
+int make_dir(const char* path)
+{
+    int r = f_mkdir(path);
+
+    if (r == FR_EXIST)
+        return FR_OK;
+    if (r == FR_OK)
+        statDirs++;
+    return r;
+}
+
+int make_parent_dirs(char* path)
+{
+    char* sep = NULL;
+    char* p;
+    char c;
+    int r = FR_OK;
+
+    for (p = path; *p; p++)
+    {
+        if (*p == '/' || *p == '\\')
+            sep = p;
+    }
+    if (!sep || sep == path)
+        return FR_OK;
+
+    c = *sep;
+    *sep = '\0';
+    if (strcmp(path, lastParent) != 0)
+    {
+        for (p = path + 1; *p && r == FR_OK; p++)
+        {
+            if (*p == '/' || *p == '\\')
+            {
+                char d = *p;
+                *p = '\0';
+                r = make_dir(path);
+                *p = d;
+            }
+        }
+        if (r == FR_OK)
+            r = make_dir(path);
+        if (r == FR_OK && strlen(path) < sizeof(lastParent))
+            strcpy(lastParent, path);
+    }
+    *sep = c;
+    return r;
+}
+
+// Splits the next (optionally double quoted) path off a manifest line.
+char* next_token(char** line)
+{
+    char* p = *line;
+    char* tok;
+
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+        p++;
+    if (!*p)
+        return NULL;
+
+    if (*p == '"')
+    {
+        tok = ++p;
+        while (*p && *p != '"')
+            p++;
+    }
+    else
+    {
+        tok = p;
+        while (*p && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+            p++;
+    }
+    if (*p)
+        *p++ = '\0';
+    *line = p;
+    return tok;
+}
+
+int add_manifest(const char* name)
+{
+    FILE* fm;
+    char line[2048];
+    char* p;
+    char* src;
+    char* dst;
+    unsigned long lineno = 0;
+    unsigned long files = statFiles;
+    unsigned long long bytes = statBytes;
+    double start = get_time();
+    int ret = 0;
+
+    fm = fopen(name, "r");
+    if (!fm)
+    {
+        fprintf(stderr, "Error: Unable to open manifest '%s' for reading.\n", name);
+        return 1;
+    }
+
+    while (!ret && fgets(line, sizeof(line), fm))
+    {
+        lineno++;
+        p = line;
+        src = next_token(&p);
+        if (!src || *src == '#')
+            continue;
+        dst = next_token(&p);
+
+        if (next_token(&p))
+        {
+            fprintf(stderr, "Error: %s(%lu): Expected '<src path> <dst path>'.\n", name, lineno);
+            ret = 1;
+        }
+        else if (!dst)
+        {
+            // directory entry
+            if (make_parent_dirs(src) || make_dir(src))
+            {
+                fprintf(stderr, "Error: %s(%lu): Unable to create directory '%s'.\n", name, lineno, src);
+                ret = 1;
+            }
+        }
+        else if (make_parent_dirs(dst))
+        {
+            fprintf(stderr, "Error: %s(%lu): Unable to create the parent directories of '%s'.\n", name, lineno, dst);
+            ret = 1;
+        }
+        else if (add_file(src, dst))
+        {
+            fprintf(stderr, "\nError: %s(%lu): Unable to add '%s'.\n", name, lineno, src);
+            ret = 1;
+        }
+    }
+
+    fclose(fm);
+
+    if (showTiming)
+    {
+        printf("%s: %lu files, %llu bytes in %.3f s\n", name,
+               statFiles - files, statBytes - bytes, get_time() - start);
+    }
+    return ret;
 }
 
 #define PRINT_HELP_AND_QUIT() \
@@ -132,6 +359,7 @@ int need_mount(void)
 int main(int oargc, char* oargv[])
 {
     int ret;
+    double start = get_time();
     int    argc = oargc - 1;
     char** argv = oargv + 1;
 
@@ -352,11 +580,6 @@ int main(int oargc, char* oargv[])
         }
         else if (strcmp(parg, "add") == 0)
         {
-            FILE* fe;
-            FIL   fv = { 0 };
-            UINT rdlen = 0;
-            UINT wrlen = 0;
-
             NEED_PARAMS(2, 2);
 
             NEED_MOUNT();
@@ -364,34 +587,31 @@ int main(int oargc, char* oargv[])
             // Arg 1: external file to add
             // Arg 2: virtual filename
 
-            fe = fopen(argv[0], "rb");
-            if (!fe)
+            if (add_file(argv[0], argv[1]))
             {
-                fprintf(stderr, "Error: Unable to open external file '%s' for reading.", argv[0]);
                 ret = 1;
                 goto exit;
             }
+        }
+        else if (strcmp(parg, "manifest") == 0)
+        {
+            NEED_PARAMS(1, 1);
 
-            if (f_open(&fv, argv[1], FA_WRITE | FA_CREATE_ALWAYS))
+            NEED_MOUNT();
+
+            // Arg 1: manifest file
+
+            if (add_manifest(argv[0]))
             {
-                fprintf(stderr, "Error: Unable to open file '%s' for writing.", argv[1]);
-                fclose(fe);
                 ret = 1;
                 goto exit;
             }
+        }
+        else if (strcmp(parg, "time") == 0)
+        {
+            NEED_PARAMS(0, 0);
 
-            while ((rdlen = fread(buff, 1, sizeof(buff), fe)) > 0)
-            {
-                if (f_write(&fv, buff, rdlen, &wrlen) || wrlen < rdlen)
-                {
-                    fprintf(stderr, "Error: Unable to write '%d' bytes to disk.", wrlen);
-                    ret = 1;
-                    goto exit;
-                }
-            }
-
-            fclose(fe);
-            f_close(&fv);
+            showTiming = 1;
         }
         else if (strcmp(parg, "extract") == 0)
         {
@@ -569,5 +789,11 @@ exit:
 
     disk_cleanup(0);
 
+    if (showTiming)
+    {
+        printf("Added %lu files and %lu directories, %llu bytes in %.3f s.\n",
+               statFiles, statDirs, statBytes, get_time() - start);
+    }
+
     return ret;
 }
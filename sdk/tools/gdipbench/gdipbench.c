@@ -0,0 +1,720 @@
+/*
+ * PROJECT:     ReactOS GDI+ Benchmarks
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Host benchmark for the software renderer's span functions
+ *
+ * Builds gdiplus' span.c for the host and runs the inner loops of the
+ * software renderer two ways: the old per-pixel code, blending through
+ * GdipBitmapGetPixel and GdipBitmapSetPixel and resampling one point at a
+ * time, and the span functions the way graphics.c now calls them. Both have
+ * to give the same pixels, for a range of small widths too, before anything
+ * is timed. The rasterizer has no old counterpart on the host (it replaces
+ * a trip through regions and GDI); its coverage is checked against shapes
+ * with a known area instead, and its old columns are 0. One CSV line per
+ * test:
+ *
+ *   test,width,height,runs,old_ns,new_ns,old_mpix_s,new_mpix_s,checksum
+ *
+ * The checksum doesn't depend on the SIMD loops, so builds with and
+ * without them can be compared.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include <typedefs.h>
+#include <string.h>
+#include "span.h"
+
+#define min(a, b)       (((a) < (b)) ? (a) : (b))
+
+#define WIDTH           1920
+#define HEIGHT          1080
+
+/* The source image for resampling, drawn to WIDTH x HEIGHT */
+#define SRC_WIDTH       1280
+#define SRC_HEIGHT      720
+
+#define PI              3.14159265358979323846
+
+typedef VOID (*RENDER)(BYTE *Dst, UINT Width, UINT Height);
+
+static BYTE *Src, *Background;
+static UINT SrcWidth, SrcHeight;
+
+static const char Hatch[8] = { 0x81, 0x42, 0x24, 0x18, 0x18, 0x24, 0x42, 0x81 };
+
+/* THE OLD LOOPS **************************************************************/
+
+static ARGB
+OldGetPixel(const BYTE *Row, UINT x, span_format Format)
+{
+    BYTE r, g, b, a;
+
+    switch (Format)
+    {
+    case SPAN_FORMAT_RGB:
+        r = Row[x * 4 + 2];
+        g = Row[x * 4 + 1];
+        b = Row[x * 4];
+        a = 255;
+        break;
+    case SPAN_FORMAT_ARGB:
+        r = Row[x * 4 + 2];
+        g = Row[x * 4 + 1];
+        b = Row[x * 4];
+        a = Row[x * 4 + 3];
+        break;
+    default:
+        a = Row[x * 4 + 3];
+        if (a == 0)
+            r = g = b = 0;
+        else
+        {
+            r = Row[x * 4 + 2] * 255 / a;
+            g = Row[x * 4 + 1] * 255 / a;
+            b = Row[x * 4] * 255 / a;
+        }
+        break;
+    }
+
+    return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+static VOID
+OldSetPixel(BYTE *Row, UINT x, span_format Format, ARGB Color)
+{
+    BYTE a = Color >> 24, r = Color >> 16, g = Color >> 8, b = Color;
+
+    switch (Format)
+    {
+    case SPAN_FORMAT_RGB:
+        *((DWORD *)Row + x) = (r << 16) | (g << 8) | b;
+        break;
+    case SPAN_FORMAT_ARGB:
+        *((DWORD *)Row + x) = (a << 24) | (r << 16) | (g << 8) | b;
+        break;
+    default:
+        r = r * a / 255;
+        g = g * a / 255;
+        b = b * a / 255;
+        *((DWORD *)Row + x) = (a << 24) | (r << 16) | (g << 8) | b;
+        break;
+    }
+}
+
+static VOID
+OldBlend(BYTE *Dst, UINT Width, UINT Height, span_format Format, BOOL Premult)
+{
+    UINT x, y;
+
+    for (y = 0; y < Height; y++)
+    {
+        for (x = 0; x < Width; x++)
+        {
+            ARGB DstColor, SrcColor = ((const ARGB *)(Src + Width * 4 * y))[x];
+
+            if (!(SrcColor & 0xff000000))
+                continue;
+
+            DstColor = OldGetPixel(Dst + Width * 4 * y, x, Format);
+            if (Premult)
+                OldSetPixel(Dst + Width * 4 * y, x, Format, color_over_fgpremult(DstColor, SrcColor));
+            else
+                OldSetPixel(Dst + Width * 4 * y, x, Format, color_over(DstColor, SrcColor));
+        }
+    }
+}
+
+static VOID OldBlendArgb(BYTE *Dst, UINT Width, UINT Height) { OldBlend(Dst, Width, Height, SPAN_FORMAT_ARGB, FALSE); }
+static VOID OldBlendPargb(BYTE *Dst, UINT Width, UINT Height) { OldBlend(Dst, Width, Height, SPAN_FORMAT_PARGB, FALSE); }
+static VOID OldBlendRgb(BYTE *Dst, UINT Width, UINT Height) { OldBlend(Dst, Width, Height, SPAN_FORMAT_RGB, FALSE); }
+static VOID OldBlendPremult(BYTE *Dst, UINT Width, UINT Height) { OldBlend(Dst, Width, Height, SPAN_FORMAT_ARGB, TRUE); }
+
+static VOID
+OldFillSolid(BYTE *Dst, UINT Width, UINT Height)
+{
+    DWORD *Pixels = (DWORD *)Dst;
+    UINT x, y;
+
+    for (x = 0; x < Width; x++)
+        for (y = 0; y < Height; y++)
+            Pixels[x + y * Width] = 0x80204060;
+}
+
+static VOID
+OldFillHatch(BYTE *Dst, UINT Width, UINT Height)
+{
+    DWORD *Pixels = (DWORD *)Dst;
+    UINT x, y;
+
+    for (x = 0; x < Width; x++)
+        for (y = 0; y < Height; y++)
+        {
+            int hx, hy;
+
+            hx = (x + 3) % 8;
+            hy = (y + 5) % 8;
+
+            if ((Hatch[7 - hy] & (0x80 >> hx)) != 0)
+                Pixels[x + y * Width] = 0xff000000;
+            else
+                Pixels[x + y * Width] = 0x80ffffff;
+        }
+}
+
+static ARGB
+OldSampleBitmapPixel(INT x, INT y, BOOL Clamp)
+{
+    UINT width = SrcWidth, height = SrcHeight;
+
+    if (Clamp)
+    {
+        if (x < 0 || y < 0 || x >= width || y >= height)
+            return 0;
+    }
+    else
+    {
+        /* Tiling, no flipping */
+        if (x < 0)
+            x = width*2 + x % (width * 2);
+        if (y < 0)
+            y = height*2 + y % (height * 2);
+        x = x % width;
+        y = y % height;
+    }
+
+    return ((DWORD *)Src)[x + y * SrcWidth];
+}
+
+static inline int
+old_positive_ceilf(float f)
+{
+    return f - (int)f > 0.0f ? f + 1.0f : f;
+}
+
+static ARGB
+OldResampleBilinear(REAL X, REAL Y, BOOL Premult, BOOL Clamp)
+{
+    REAL leftxf, topyf;
+    INT leftx, rightx, topy, bottomy;
+    ARGB topleft, topright, bottomleft, bottomright;
+    ARGB top, bottom;
+    float x_offset;
+
+    leftx = (INT)X;
+    leftxf = (REAL)leftx;
+    rightx = old_positive_ceilf(X);
+    topy = (INT)Y;
+    topyf = (REAL)topy;
+    bottomy = old_positive_ceilf(Y);
+
+    if (leftx == rightx && topy == bottomy)
+        return OldSampleBitmapPixel(leftx, topy, Clamp);
+
+    topleft = OldSampleBitmapPixel(leftx, topy, Clamp);
+    topright = OldSampleBitmapPixel(rightx, topy, Clamp);
+    bottomleft = OldSampleBitmapPixel(leftx, bottomy, Clamp);
+    bottomright = OldSampleBitmapPixel(rightx, bottomy, Clamp);
+
+    x_offset = X - leftxf;
+    if (Premult)
+    {
+        top = blend_colors_premult(topleft, topright, x_offset);
+        bottom = blend_colors_premult(bottomleft, bottomright, x_offset);
+        return blend_colors_premult(top, bottom, Y - topyf);
+    }
+
+    top = blend_colors(topleft, topright, x_offset);
+    bottom = blend_colors(bottomleft, bottomright, x_offset);
+    return blend_colors(top, bottom, Y - topyf);
+}
+
+/* DrawImage's loop for a scaled, not rotated, image */
+static VOID
+OldResample(BYTE *Dst, UINT Width, UINT Height, BOOL Premult, BOOL Nearest, BOOL Clamp)
+{
+    REAL x_dx = (REAL)SrcWidth / Width, y_dy = (REAL)SrcHeight / Height;
+    REAL delta_xx, delta_yy = 0.0f;
+    UINT x, y;
+
+    for (y = 0; y < Height; y++)
+    {
+        delta_xx = 0.0f;
+
+        for (x = 0; x < Width; x++)
+        {
+            REAL X = 0.25f + delta_xx, Y = 0.25f + delta_yy;
+            ARGB *Color = (ARGB *)(Dst + Width * 4 * y) + x;
+
+            if (!Clamp || (X >= 0.0f && X < SrcWidth && Y >= 0.0f && Y < SrcHeight))
+            {
+                if (Nearest)
+                    *Color = OldSampleBitmapPixel(floorf(X + 0.5f), floorf(Y + 0.5f), Clamp);
+                else
+                    *Color = OldResampleBilinear(X, Y, Premult, Clamp);
+            }
+            else
+                *Color = 0;
+
+            delta_xx += x_dx;
+        }
+
+        delta_yy += y_dy;
+    }
+}
+
+static VOID OldBilinear(BYTE *Dst, UINT Width, UINT Height) { OldResample(Dst, Width, Height, FALSE, FALSE, TRUE); }
+static VOID OldBilinearPremult(BYTE *Dst, UINT Width, UINT Height) { OldResample(Dst, Width, Height, TRUE, FALSE, TRUE); }
+static VOID OldBilinearTile(BYTE *Dst, UINT Width, UINT Height) { OldResample(Dst, Width, Height, FALSE, FALSE, FALSE); }
+static VOID OldNearest(BYTE *Dst, UINT Width, UINT Height) { OldResample(Dst, Width, Height, TRUE, TRUE, TRUE); }
+
+/* WHAT GRAPHICS.C DOES NOW ***************************************************/
+
+static VOID
+NewBlend(BYTE *Dst, UINT Width, UINT Height, span_format Format, BOOL Premult)
+{
+    UINT y;
+
+    for (y = 0; y < Height; y++)
+        span_blend_row(Dst + Width * 4 * y, Format, (const ARGB *)(Src + Width * 4 * y),
+                       Width, Premult);
+}
+
+static VOID NewBlendArgb(BYTE *Dst, UINT Width, UINT Height) { NewBlend(Dst, Width, Height, SPAN_FORMAT_ARGB, FALSE); }
+static VOID NewBlendPargb(BYTE *Dst, UINT Width, UINT Height) { NewBlend(Dst, Width, Height, SPAN_FORMAT_PARGB, FALSE); }
+static VOID NewBlendRgb(BYTE *Dst, UINT Width, UINT Height) { NewBlend(Dst, Width, Height, SPAN_FORMAT_RGB, FALSE); }
+static VOID NewBlendPremult(BYTE *Dst, UINT Width, UINT Height) { NewBlend(Dst, Width, Height, SPAN_FORMAT_ARGB, TRUE); }
+
+static VOID
+NewFillSolid(BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT y;
+
+    for (y = 0; y < Height; y++)
+        span_fill_solid((ARGB *)Dst + y * Width, Width, 0x80204060);
+}
+
+static VOID
+NewFillHatch(BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT y;
+
+    for (y = 0; y < Height; y++)
+        span_fill_hatch((ARGB *)Dst + y * Width, Width, 3, 5 + y, Hatch,
+                        0xff000000, 0x80ffffff);
+}
+
+static VOID
+NewResample(BYTE *Dst, UINT Width, UINT Height, BOOL Premult, span_filter Filter, BOOL Clamp)
+{
+    REAL x_dx = (REAL)SrcWidth / Width, y_dy = (REAL)SrcHeight / Height;
+    REAL delta_yy = 0.0f;
+    span_source Source;
+    UINT y;
+
+    memset(&Source, 0, sizeof(Source));
+    Source.bits = (const ARGB *)Src;
+    Source.width = Source.bitmap_width = SrcWidth;
+    Source.height = Source.bitmap_height = SrcHeight;
+    Source.clamp = Clamp;
+    Source.premult = Premult;
+    Source.filter = Filter;
+    Source.pixel_offset = 0.5f;
+    Source.bounded = Clamp;
+    Source.max_x = SrcWidth;
+    Source.max_y = SrcHeight;
+
+    for (y = 0; y < Height; y++)
+    {
+        span_resample(&Source, (ARGB *)(Dst + Width * 4 * y), Width,
+                      0.25f, 0.25f + delta_yy, 0.0f, 0.0f, x_dx, 0.0f);
+        delta_yy += y_dy;
+    }
+}
+
+static VOID NewBilinear(BYTE *Dst, UINT Width, UINT Height) { NewResample(Dst, Width, Height, FALSE, SPAN_FILTER_BILINEAR, TRUE); }
+static VOID NewBilinearPremult(BYTE *Dst, UINT Width, UINT Height) { NewResample(Dst, Width, Height, TRUE, SPAN_FILTER_BILINEAR, TRUE); }
+static VOID NewBilinearTile(BYTE *Dst, UINT Width, UINT Height) { NewResample(Dst, Width, Height, FALSE, SPAN_FILTER_BILINEAR, FALSE); }
+static VOID NewNearest(BYTE *Dst, UINT Width, UINT Height) { NewResample(Dst, Width, Height, TRUE, SPAN_FILTER_NEAREST, TRUE); }
+static VOID NewBicubic(BYTE *Dst, UINT Width, UINT Height) { NewResample(Dst, Width, Height, TRUE, SPAN_FILTER_BICUBIC, TRUE); }
+
+/* An ellipse filling most of the image, as a fill would flatten it */
+static VOID
+Ellipse(GpPointF *Points, INT Count, UINT Width, UINT Height)
+{
+    INT i;
+
+    for (i = 0; i < Count; i++)
+    {
+        Points[i].X = Width * (0.5 + 0.45 * cos(2 * PI * i / Count));
+        Points[i].Y = Height * (0.5 + 0.45 * sin(2 * PI * i / Count));
+    }
+}
+
+static VOID
+NewRaster(BYTE *Dst, UINT Width, UINT Height, BOOL Antialias)
+{
+    GpPointF Points[512];
+    INT End = 512;
+
+    Ellipse(Points, End, Width, Height);
+    memset(Dst, 0, Width * Height);
+    if (!raster_fill_mask(Points, &End, 1, FALSE, Antialias, Dst, 0, 0, Width, Height, Width))
+    {
+        fprintf(stderr, "gdipbench: out of memory\n");
+        exit(1);
+    }
+}
+
+static VOID NewRasterAliased(BYTE *Dst, UINT Width, UINT Height) { NewRaster(Dst, Width, Height, FALSE); }
+static VOID NewRasterAntialias(BYTE *Dst, UINT Width, UINT Height) { NewRaster(Dst, Width, Height, TRUE); }
+
+/* An antialiased fill as SOFTWARE_GdipFillPath does it: render the brush,
+ * rasterize, apply the coverage and blend. */
+static VOID
+NewFillPath(BYTE *Dst, UINT Width, UINT Height)
+{
+    static BYTE *Mask;
+    static ARGB *Pixels;
+    UINT y;
+
+    Mask = realloc(Mask, Width * Height);
+    Pixels = realloc(Pixels, Width * Height * 4);
+    if (!Mask || !Pixels)
+    {
+        fprintf(stderr, "gdipbench: out of memory\n");
+        exit(1);
+    }
+
+    NewRaster(Mask, Width, Height, TRUE);
+    for (y = 0; y < Height; y++)
+    {
+        span_fill_solid(Pixels + y * Width, Width, 0xc0408020);
+        span_apply_coverage(Pixels + y * Width, Mask + y * Width, Width);
+        span_blend_row(Dst + y * Width * 4, SPAN_FORMAT_ARGB, Pixels + y * Width, Width, FALSE);
+    }
+}
+
+/* TESTS **********************************************************************/
+
+typedef struct _TEST
+{
+    const char *Name;
+    BOOL Blend;             /* draws over the background */
+    UINT Bytes;             /* per pixel */
+    RENDER Old, New;
+} TEST;
+
+static const TEST Tests[] =
+{
+    { "blend-argb", TRUE, 4, OldBlendArgb, NewBlendArgb },
+    { "blend-pargb", TRUE, 4, OldBlendPargb, NewBlendPargb },
+    { "blend-rgb", TRUE, 4, OldBlendRgb, NewBlendRgb },
+    { "blend-premult", TRUE, 4, OldBlendPremult, NewBlendPremult },
+    { "fill-solid", FALSE, 4, OldFillSolid, NewFillSolid },
+    { "fill-hatch", FALSE, 4, OldFillHatch, NewFillHatch },
+    { "resample-bilinear", FALSE, 4, OldBilinear, NewBilinear },
+    { "resample-bilinear-premult", FALSE, 4, OldBilinearPremult, NewBilinearPremult },
+    { "resample-bilinear-tile", FALSE, 4, OldBilinearTile, NewBilinearTile },
+    { "resample-nearest", FALSE, 4, OldNearest, NewNearest },
+    { "resample-bicubic", FALSE, 4, NULL, NewBicubic },
+    { "raster-aliased", FALSE, 1, NULL, NewRasterAliased },
+    { "raster-antialias", FALSE, 1, NULL, NewRasterAntialias },
+    { "fill-path-antialias", TRUE, 4, NULL, NewFillPath },
+};
+
+/* HELPERS *******************************************************************/
+
+static ULONGLONG
+NowNs(VOID)
+{
+    struct timespec Ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &Ts);
+    return (ULONGLONG)Ts.tv_sec * 1000000000ULL + Ts.tv_nsec;
+}
+
+static PVOID
+XAlloc(SIZE_T Size)
+{
+    PVOID Buffer = malloc(Size);
+
+    if (!Buffer)
+    {
+        fprintf(stderr, "gdipbench: out of memory\n");
+        exit(1);
+    }
+    return Buffer;
+}
+
+/* Random bytes, with alpha 0 and 255 showing up more often than that */
+static VOID
+FillRandom(BYTE *Data, SIZE_T Size, UINT *State)
+{
+    SIZE_T i;
+
+    for (i = 0; i < Size; i++)
+    {
+        *State ^= *State << 13;
+        *State ^= *State >> 17;
+        *State ^= *State << 5;
+        Data[i] = (BYTE)*State;
+        if (i % 4 == 3 && (*State >> 8) % 4 == 0)
+            Data[i] = ((*State >> 11) & 1) ? 255 : 0;
+    }
+}
+
+static UINT
+Checksum(const BYTE *Data, SIZE_T Size)
+{
+    UINT Hash = 2166136261u;
+    SIZE_T i;
+
+    for (i = 0; i < Size; i++)
+        Hash = (Hash ^ Data[i]) * 16777619u;
+    return Hash;
+}
+
+static VOID
+Prepare(const TEST *Test, BYTE *Dst, SIZE_T Size)
+{
+    if (Test->Blend)
+        memcpy(Dst, Background, Size);
+    else
+        memset(Dst, 0xcc, Size);
+}
+
+/* Small images of every width up to 40, so each tail length is covered */
+static BOOL
+CheckTest(const TEST *Test, BYTE *Old, BYTE *New)
+{
+    UINT Width, Height = 3;
+
+    if (!Test->Old)
+        return TRUE;
+
+    for (Width = 1; Width <= 40; Width++)
+    {
+        SIZE_T Size = (SIZE_T)Width * Height * Test->Bytes;
+
+        Prepare(Test, Old, Size);
+        Prepare(Test, New, Size);
+        SrcWidth = Width * 2 / 3 + 1;
+        SrcHeight = 2;
+        Test->Old(Old, Width, Height);
+        Test->New(New, Width, Height);
+        if (memcmp(Old, New, Size))
+        {
+            fprintf(stderr, "gdipbench: %s differs at width %u\n", Test->Name, Width);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static UINT
+MaskSum(const BYTE *Mask, UINT Count)
+{
+    UINT Sum = 0, i;
+
+    for (i = 0; i < Count; i++)
+        Sum += Mask[i];
+    return Sum;
+}
+
+/* Shapes whose coverage is known */
+static BOOL
+CheckRaster(VOID)
+{
+    static const GpPointF Rect[] = { { 2.25f, 1.0f }, { 9.75f, 1.0f }, { 9.75f, 7.5f }, { 2.25f, 7.5f } };
+    static const GpPointF Squares[] = { { 0, 0 }, { 6, 0 }, { 6, 6 }, { 0, 6 },
+                                        { 3, 3 }, { 9, 3 }, { 9, 9 }, { 3, 9 } };
+    static const INT SquareEnds[] = { 4, 8 };
+    GpPointF Circle[1024];
+    BYTE Mask[100 * 100];
+    INT End = 4, x, y;
+    double Area;
+
+    /* Pixel centers inside, right and bottom edges excluded */
+    memset(Mask, 0, sizeof(Mask));
+    raster_fill_mask(Rect, &End, 1, FALSE, FALSE, Mask, 0, 0, 12, 12, 12);
+    for (y = 0; y < 12; y++)
+        for (x = 0; x < 12; x++)
+            if (Mask[y * 12 + x] != ((x >= 2 && x <= 9 && y >= 1 && y <= 6) ? 255 : 0))
+            {
+                fprintf(stderr, "gdipbench: aliased rectangle wrong at %d,%d\n", x, y);
+                return FALSE;
+            }
+
+    /* Exact horizontally, the half pixel at the bottom is two of four lines */
+    memset(Mask, 0, sizeof(Mask));
+    raster_fill_mask(Rect, &End, 1, FALSE, TRUE, Mask, 0, 0, 12, 12, 12);
+    if (Mask[1 * 12 + 2] != 192 || Mask[1 * 12 + 5] != 255 || Mask[1 * 12 + 9] != 192 ||
+        Mask[7 * 12 + 5] != 128 || Mask[7 * 12 + 2] != 96 || Mask[0 * 12 + 5] || Mask[8 * 12 + 5])
+    {
+        fprintf(stderr, "gdipbench: antialiased rectangle wrong\n");
+        return FALSE;
+    }
+
+    /* The overlap of two squares is left out by the alternate fill mode */
+    memset(Mask, 0, sizeof(Mask));
+    raster_fill_mask(Squares, SquareEnds, 2, FALSE, FALSE, Mask, 0, 0, 10, 10, 10);
+    if (MaskSum(Mask, 100) != 255 * (36 + 36 - 18) || Mask[4 * 10 + 4])
+    {
+        fprintf(stderr, "gdipbench: alternate fill mode wrong\n");
+        return FALSE;
+    }
+    memset(Mask, 0, sizeof(Mask));
+    raster_fill_mask(Squares, SquareEnds, 2, TRUE, FALSE, Mask, 0, 0, 10, 10, 10);
+    if (MaskSum(Mask, 100) != 255 * (36 + 36 - 9))
+    {
+        fprintf(stderr, "gdipbench: winding fill mode wrong\n");
+        return FALSE;
+    }
+
+    /* A circle of radius 40 covers its area to within a fraction */
+    End = 1024;
+    for (x = 0; x < End; x++)
+    {
+        Circle[x].X = 50 + 40 * cos(2 * PI * x / End);
+        Circle[x].Y = 50 + 40 * sin(2 * PI * x / End);
+    }
+    memset(Mask, 0, sizeof(Mask));
+    raster_fill_mask(Circle, &End, 1, FALSE, TRUE, Mask, 0, 0, 100, 100, 100);
+    Area = MaskSum(Mask, 100 * 100) / 255.0;
+    if (fabs(Area - PI * 40 * 40) > PI * 40 * 40 * 0.002)
+    {
+        fprintf(stderr, "gdipbench: antialiased circle covers %.1f pixels\n", Area);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* A flat source has to stay flat through the cubic */
+static BOOL
+CheckBicubic(BYTE *New)
+{
+    UINT i;
+
+    SrcWidth = 13;
+    SrcHeight = 7;
+    for (i = 0; i < SrcWidth * SrcHeight; i++)
+        ((ARGB *)Src)[i] = 0x80402010;
+    NewBicubic(New, 29, 17);
+    for (i = 0; i < 29 * 17; i++)
+    {
+        double X = 0.25 + (i % 29) * 13.0 / 29, Y = 0.25 + (i / 29) * 7.0 / 17;
+
+        /* Points near the border see the transparent outside */
+        if (X < 1.1 || X > 10.9 || Y < 1.1 || Y > 4.9)
+            continue;
+        if (((ARGB *)New)[i] != 0x80402010)
+        {
+            fprintf(stderr, "gdipbench: flat bicubic gives %08x at %u\n", ((ARGB *)New)[i], i);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static VOID
+Usage(VOID)
+{
+    printf("Usage: gdipbench [-r runs]\n"
+           "\n"
+           "  -r runs     Time each test this many times, keep the best (default 5)\n");
+}
+
+int main(int argc, char **argv)
+{
+    UINT Runs = 5, Run, t, State = 0x12345678;
+    SIZE_T Pixels = (SIZE_T)WIDTH * HEIGHT;
+    BYTE *Old, *New;
+    int Arg, Failed = 0;
+
+    for (Arg = 1; Arg < argc; Arg++)
+    {
+        if (Arg + 1 < argc && !strcmp(argv[Arg], "-r"))
+        {
+            Runs = strtoul(argv[++Arg], NULL, 0);
+        }
+        else
+        {
+            Usage();
+            return strcmp(argv[Arg], "-h") ? 1 : 0;
+        }
+    }
+    if (!Runs)
+    {
+        fprintf(stderr, "gdipbench: nothing to do\n");
+        return 1;
+    }
+
+    Src = XAlloc(Pixels * 4);
+    Background = XAlloc(Pixels * 4);
+    Old = XAlloc(Pixels * 4);
+    New = XAlloc(Pixels * 4);
+
+    if (!CheckRaster() || !CheckBicubic(New))
+        Failed = 1;
+
+    FillRandom(Src, Pixels * 4, &State);
+    FillRandom(Background, Pixels * 4, &State);
+
+    printf("test,width,height,runs,old_ns,new_ns,old_mpix_s,new_mpix_s,checksum\n");
+    for (t = 0; t < sizeof(Tests) / sizeof(Tests[0]); t++)
+    {
+        const TEST *Test = &Tests[t];
+        ULONGLONG OldNs = ~0ULL, NewNs = ~0ULL, Start;
+        SIZE_T Size = Pixels * Test->Bytes;
+
+        if (!CheckTest(Test, Old, New))
+        {
+            Failed = 1;
+            continue;
+        }
+
+        SrcWidth = SRC_WIDTH;
+        SrcHeight = SRC_HEIGHT;
+
+        for (Run = 0; Run < Runs; Run++)
+        {
+            if (Test->Old)
+            {
+                Prepare(Test, Old, Size);
+                Start = NowNs();
+                Test->Old(Old, WIDTH, HEIGHT);
+                OldNs = min(OldNs, NowNs() - Start);
+            }
+
+            Prepare(Test, New, Size);
+            Start = NowNs();
+            Test->New(New, WIDTH, HEIGHT);
+            NewNs = min(NewNs, NowNs() - Start);
+        }
+
+        if (!Test->Old)
+            OldNs = 0;
+        else if (memcmp(Old, New, Size))
+        {
+            fprintf(stderr, "gdipbench: %s differs\n", Test->Name);
+            Failed = 1;
+        }
+
+        printf("%s,%u,%u,%u,%llu,%llu,%.1f,%.1f,%08x\n", Test->Name, WIDTH, HEIGHT, Runs,
+               OldNs, NewNs, OldNs ? Pixels * 1000.0 / OldNs : 0.0, Pixels * 1000.0 / NewNs,
+               Checksum(New, Size));
+    }
+
+    free(Src);
+    free(Background);
+    free(Old);
+    free(New);
+    return Failed;
+}
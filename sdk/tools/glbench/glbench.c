@@ -0,0 +1,755 @@
+/*
+ * PROJECT:     ReactOS OpenGL Benchmarks
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Host benchmark for the software OpenGL rasterizer
+ *
+ * Builds the Mesa core from dll/opengl/mesa for the host, with a small
+ * driver drawing into memory the way opengl32's back buffer does. Each
+ * scene is rendered once with a single rasterizer thread, which gives
+ * the reference image, then with the rasterizer threads. The two images
+ * have to be identical. One CSV line per scene:
+ *
+ *   scene,width,height,triangles,runs,threads,serial_ns,threaded_ns,checksum
+ *
+ * The checksum doesn't depend on the SIMD kernels either, so builds with
+ * and without USE_SSE2 can be compared. -o writes the reference images
+ * as PPM files.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <context.h>
+#include <matrix.h>
+
+#define WIDTH           640
+#define HEIGHT          480
+#define MAX_THREADS     16
+
+#define PACK_COLOR(r, g, b) ((GLuint)(r) | ((GLuint)(g) << 8) | ((GLuint)(b) << 16))
+
+/* The API entry points, from api.c */
+extern void APIENTRY _mesa_Begin(GLenum mode);
+extern void APIENTRY _mesa_BlendFunc(GLenum sfactor, GLenum dfactor);
+extern void APIENTRY _mesa_Clear(GLbitfield mask);
+extern void APIENTRY _mesa_ClearColor(GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha);
+extern void APIENTRY _mesa_ClearStencil(GLint s);
+extern void APIENTRY _mesa_Color4ub(GLubyte red, GLubyte green, GLubyte blue, GLubyte alpha);
+extern void APIENTRY _mesa_DepthFunc(GLenum func);
+extern void APIENTRY _mesa_Disable(GLenum cap);
+extern void APIENTRY _mesa_Enable(GLenum cap);
+extern void APIENTRY _mesa_End(void);
+extern void APIENTRY _mesa_Finish(void);
+extern void APIENTRY _mesa_Hint(GLenum target, GLenum mode);
+extern void APIENTRY _mesa_LoadIdentity(void);
+extern void APIENTRY _mesa_MatrixMode(GLenum mode);
+extern void APIENTRY _mesa_Ortho(GLdouble left, GLdouble right, GLdouble bottom, GLdouble top,
+                                 GLdouble nearval, GLdouble farval);
+extern void APIENTRY _mesa_ShadeModel(GLenum mode);
+extern void APIENTRY _mesa_StencilFunc(GLenum func, GLint ref, GLuint mask);
+extern void APIENTRY _mesa_StencilOp(GLenum fail, GLenum zfail, GLenum zpass);
+extern void APIENTRY _mesa_TexCoord2f(GLfloat s, GLfloat t);
+extern void APIENTRY _mesa_TexEnvi(GLenum target, GLenum pname, GLint param);
+extern void APIENTRY _mesa_TexImage2D(GLenum target, GLint level, GLint internalformat,
+                                      GLsizei width, GLsizei height, GLint border,
+                                      GLenum format, GLenum type, const GLvoid *pixels);
+extern void APIENTRY _mesa_TexParameteri(GLenum target, GLenum pname, GLint param);
+extern void APIENTRY _mesa_Vertex3f(GLfloat x, GLfloat y, GLfloat z);
+
+typedef struct _BENCH_DRIVER
+{
+    GLcontext *Ctx;
+    GLuint *Pixels;
+    GLuint ClearColor;
+    GLuint CurrentColor;
+    GLuint Threads;             /* What RasterThreads() answers */
+} BENCH_DRIVER;
+
+typedef struct _SCENE
+{
+    const char *Name;
+    void (*Draw)(unsigned Triangles);
+} SCENE;
+
+static GLcontext *CurrentContext;
+static unsigned RandomState;
+
+/* HELPERS *******************************************************************/
+
+static unsigned long long
+NowNs(void)
+{
+    struct timespec Ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &Ts);
+    return (unsigned long long)Ts.tv_sec * 1000000000ULL + Ts.tv_nsec;
+}
+
+static void *
+XAlloc(size_t Size)
+{
+    void *Buffer = calloc(1, Size);
+
+    if (!Buffer)
+    {
+        fprintf(stderr, "glbench: out of memory\n");
+        exit(1);
+    }
+    return Buffer;
+}
+
+static unsigned
+Random(void)
+{
+    RandomState ^= RandomState << 13;
+    RandomState ^= RandomState >> 17;
+    RandomState ^= RandomState << 5;
+    return RandomState;
+}
+
+static float
+RandomFloat(float Min, float Max)
+{
+    return Min + (Max - Min) * (float)(Random() & 0xffff) / 65535.0f;
+}
+
+/* Mesa calls this to find the current context (THREADS build) */
+GLcontext *
+gl_get_thread_context(void)
+{
+    return CurrentContext;
+}
+
+/* RASTERIZER THREADS ********************************************************/
+
+static pthread_t PoolThreads[MAX_THREADS - 1];
+static unsigned PoolCount;
+static pthread_mutex_t PoolLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t PoolWake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t PoolDone = PTHREAD_COND_INITIALIZER;
+static unsigned PoolGeneration;
+static unsigned PoolPending;
+static unsigned PoolJobCount;
+static void (*PoolFunc)(void *Data, GLuint Index);
+static void *PoolData;
+
+static void *
+PoolThread(void *Param)
+{
+    GLuint Index = (GLuint)(size_t)Param;
+    unsigned Seen = 0;
+
+    pthread_mutex_lock(&PoolLock);
+    for (;;)
+    {
+        while (PoolGeneration == Seen)
+            pthread_cond_wait(&PoolWake, &PoolLock);
+        Seen = PoolGeneration;
+        if (Index >= PoolJobCount)
+            continue;
+
+        pthread_mutex_unlock(&PoolLock);
+        PoolFunc(PoolData, Index);
+        pthread_mutex_lock(&PoolLock);
+
+        if (--PoolPending == 0)
+            pthread_cond_signal(&PoolDone);
+    }
+    return NULL;
+}
+
+static void
+PoolStart(unsigned Threads)
+{
+    while (PoolCount + 1 < Threads)
+    {
+        if (pthread_create(&PoolThreads[PoolCount], NULL, PoolThread, (void *)(size_t)(PoolCount + 1)))
+        {
+            fprintf(stderr, "glbench: can't create threads\n");
+            exit(1);
+        }
+        PoolCount++;
+    }
+}
+
+/* DRIVER ********************************************************************/
+
+static const char *
+RendererString(void)
+{
+    return "glbench";
+}
+
+static void
+ClearIndex(GLcontext *ctx, GLuint index)
+{
+}
+
+static void
+ClearColor(GLcontext *ctx, GLubyte r, GLubyte g, GLubyte b, GLubyte a)
+{
+    ((BENCH_DRIVER *)ctx->DriverCtx)->ClearColor = PACK_COLOR(r, g, b);
+}
+
+static void
+Clear(GLcontext *ctx, GLboolean all, GLint x, GLint y, GLint width, GLint height)
+{
+    BENCH_DRIVER *Driver = ctx->DriverCtx;
+    GLint i, j;
+
+    if (all)
+    {
+        x = y = 0;
+        width = WIDTH;
+        height = HEIGHT;
+    }
+    for (j = y; j < y + height; j++)
+    {
+        for (i = x; i < x + width; i++)
+            Driver->Pixels[j * WIDTH + i] = Driver->ClearColor;
+    }
+}
+
+static void
+SetIndex(GLcontext *ctx, GLuint index)
+{
+}
+
+static void
+SetColor(GLcontext *ctx, GLubyte r, GLubyte g, GLubyte b, GLubyte a)
+{
+    ((BENCH_DRIVER *)ctx->DriverCtx)->CurrentColor = PACK_COLOR(r, g, b);
+}
+
+static GLboolean
+SetBuffer(GLcontext *ctx, GLenum mode)
+{
+    return mode == GL_BACK;
+}
+
+static void
+GetBufferSize(GLcontext *ctx, GLuint *width, GLuint *height)
+{
+    *width = WIDTH;
+    *height = HEIGHT;
+}
+
+static void
+WriteColorSpan(GLcontext *ctx, GLuint n, GLint x, GLint y,
+               const GLubyte red[], const GLubyte green[],
+               const GLubyte blue[], const GLubyte alpha[],
+               const GLubyte mask[])
+{
+    GLuint *Row = ((BENCH_DRIVER *)ctx->DriverCtx)->Pixels + y * WIDTH + x;
+    GLuint i;
+
+    for (i = 0; i < n; i++)
+    {
+        if (!mask || mask[i])
+            Row[i] = PACK_COLOR(red[i], green[i], blue[i]);
+    }
+}
+
+static void
+WriteMonocolorSpan(GLcontext *ctx, GLuint n, GLint x, GLint y, const GLubyte mask[])
+{
+    BENCH_DRIVER *Driver = ctx->DriverCtx;
+    GLuint *Row = Driver->Pixels + y * WIDTH + x;
+    GLuint i;
+
+    for (i = 0; i < n; i++)
+    {
+        if (mask[i])
+            Row[i] = Driver->CurrentColor;
+    }
+}
+
+static void
+WriteColorPixels(GLcontext *ctx, GLuint n, const GLint x[], const GLint y[],
+                 const GLubyte red[], const GLubyte green[],
+                 const GLubyte blue[], const GLubyte alpha[],
+                 const GLubyte mask[])
+{
+    GLuint *Pixels = ((BENCH_DRIVER *)ctx->DriverCtx)->Pixels;
+    GLuint i;
+
+    for (i = 0; i < n; i++)
+    {
+        if (mask[i])
+            Pixels[y[i] * WIDTH + x[i]] = PACK_COLOR(red[i], green[i], blue[i]);
+    }
+}
+
+static void
+WriteMonocolorPixels(GLcontext *ctx, GLuint n, const GLint x[], const GLint y[],
+                     const GLubyte mask[])
+{
+    BENCH_DRIVER *Driver = ctx->DriverCtx;
+    GLuint i;
+
+    for (i = 0; i < n; i++)
+    {
+        if (mask[i])
+            Driver->Pixels[y[i] * WIDTH + x[i]] = Driver->CurrentColor;
+    }
+}
+
+static void
+WriteIndexSpan(GLcontext *ctx, GLuint n, GLint x, GLint y,
+               const GLuint index[], const GLubyte mask[])
+{
+}
+
+static void
+WriteIndexPixels(GLcontext *ctx, GLuint n, const GLint x[], const GLint y[],
+                 const GLuint index[], const GLubyte mask[])
+{
+}
+
+static void
+ReadIndexSpan(GLcontext *ctx, GLuint n, GLint x, GLint y, GLuint index[])
+{
+}
+
+static void
+ReadIndexPixels(GLcontext *ctx, GLuint n, const GLint x[], const GLint y[],
+                GLuint indx[], const GLubyte mask[])
+{
+}
+
+static void
+ReadColorSpan(GLcontext *ctx, GLuint n, GLint x, GLint y,
+              GLubyte red[], GLubyte green[], GLubyte blue[], GLubyte alpha[])
+{
+    const GLuint *Row = ((BENCH_DRIVER *)ctx->DriverCtx)->Pixels + y * WIDTH + x;
+    GLuint i;
+
+    for (i = 0; i < n; i++)
+    {
+        red[i] = Row[i] & 0xff;
+        green[i] = (Row[i] >> 8) & 0xff;
+        blue[i] = (Row[i] >> 16) & 0xff;
+        alpha[i] = 0;
+    }
+}
+
+static void
+ReadColorPixels(GLcontext *ctx, GLuint n, const GLint x[], const GLint y[],
+                GLubyte red[], GLubyte green[], GLubyte blue[], GLubyte alpha[],
+                const GLubyte mask[])
+{
+    const GLuint *Pixels = ((BENCH_DRIVER *)ctx->DriverCtx)->Pixels;
+    GLuint i;
+
+    for (i = 0; i < n; i++)
+    {
+        if (mask[i])
+        {
+            GLuint Pixel = Pixels[y[i] * WIDTH + x[i]];
+            red[i] = Pixel & 0xff;
+            green[i] = (Pixel >> 8) & 0xff;
+            blue[i] = (Pixel >> 16) & 0xff;
+            alpha[i] = 0;
+        }
+    }
+}
+
+static GLuint
+RasterThreads(GLcontext *ctx)
+{
+    return ((BENCH_DRIVER *)ctx->DriverCtx)->Threads;
+}
+
+static void
+RasterRun(GLcontext *ctx, void (*func)(void *data, GLuint i), void *data, GLuint count)
+{
+    pthread_mutex_lock(&PoolLock);
+    PoolFunc = func;
+    PoolData = data;
+    PoolJobCount = count;
+    PoolPending = count - 1;
+    PoolGeneration++;
+    pthread_cond_broadcast(&PoolWake);
+    pthread_mutex_unlock(&PoolLock);
+
+    func(data, 0);
+
+    pthread_mutex_lock(&PoolLock);
+    while (PoolPending)
+        pthread_cond_wait(&PoolDone, &PoolLock);
+    pthread_mutex_unlock(&PoolLock);
+}
+
+static void
+UpdateState(GLcontext *ctx)
+{
+    ctx->Driver.RendererString = RendererString;
+    ctx->Driver.UpdateState = UpdateState;
+    ctx->Driver.ClearIndex = ClearIndex;
+    ctx->Driver.ClearColor = ClearColor;
+    ctx->Driver.Clear = Clear;
+    ctx->Driver.Index = SetIndex;
+    ctx->Driver.Color = SetColor;
+    ctx->Driver.SetBuffer = SetBuffer;
+    ctx->Driver.GetBufferSize = GetBufferSize;
+    ctx->Driver.WriteColorSpan = WriteColorSpan;
+    ctx->Driver.WriteMonocolorSpan = WriteMonocolorSpan;
+    ctx->Driver.WriteColorPixels = WriteColorPixels;
+    ctx->Driver.WriteMonocolorPixels = WriteMonocolorPixels;
+    ctx->Driver.WriteIndexSpan = WriteIndexSpan;
+    ctx->Driver.WriteMonoindexSpan = WriteMonocolorSpan;
+    ctx->Driver.WriteIndexPixels = WriteIndexPixels;
+    ctx->Driver.WriteMonoindexPixels = WriteMonocolorPixels;
+    ctx->Driver.ReadIndexSpan = ReadIndexSpan;
+    ctx->Driver.ReadColorSpan = ReadColorSpan;
+    ctx->Driver.ReadIndexPixels = ReadIndexPixels;
+    ctx->Driver.ReadColorPixels = ReadColorPixels;
+    ctx->Driver.RasterThreads = RasterThreads;
+    ctx->Driver.RasterRun = RasterRun;
+}
+
+/* SCENES ********************************************************************/
+
+static void
+Ortho(void)
+{
+    _mesa_MatrixMode(GL_PROJECTION);
+    _mesa_LoadIdentity();
+    _mesa_Ortho(0.0, WIDTH, 0.0, HEIGHT, -1.0, 1.0);
+    _mesa_MatrixMode(GL_MODELVIEW);
+    _mesa_LoadIdentity();
+}
+
+static void
+RandomTriangles(unsigned Triangles, float Size, int Textured, int Alpha)
+{
+    unsigned i, v;
+
+    _mesa_Begin(GL_TRIANGLES);
+    for (i = 0; i < Triangles; i++)
+    {
+        float x = RandomFloat(-Size / 4, WIDTH - Size / 2);
+        float y = RandomFloat(-Size / 4, HEIGHT - Size / 2);
+        float z = RandomFloat(-0.9f, 0.9f);
+
+        for (v = 0; v < 3; v++)
+        {
+            _mesa_Color4ub(Random() & 0xff, Random() & 0xff, Random() & 0xff,
+                           Alpha ? (Random() & 0xff) : 0xff);
+            if (Textured)
+                _mesa_TexCoord2f(RandomFloat(-2.0f, 2.0f), RandomFloat(-2.0f, 2.0f));
+            _mesa_Vertex3f(x + RandomFloat(0.0f, Size), y + RandomFloat(0.0f, Size),
+                           z + RandomFloat(-0.1f, 0.1f));
+        }
+    }
+    _mesa_End();
+}
+
+static void
+Texture(GLenum Format, GLenum Filter)
+{
+    static GLubyte Texels[64 * 64 * 4];
+    unsigned i;
+
+    for (i = 0; i < sizeof(Texels); i++)
+        Texels[i] = Random() & 0xff;
+    _mesa_TexImage2D(GL_TEXTURE_2D, 0, Format == GL_RGBA ? 4 : 3, 64, 64, 0,
+                     Format, GL_UNSIGNED_BYTE, Texels);
+    _mesa_TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, Filter);
+    _mesa_TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, Filter);
+    _mesa_TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    _mesa_TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    _mesa_Enable(GL_TEXTURE_2D);
+}
+
+static void
+DrawFlat(unsigned Triangles)
+{
+    Ortho();
+    _mesa_Enable(GL_DEPTH_TEST);
+    _mesa_DepthFunc(GL_LESS);
+    _mesa_ShadeModel(GL_FLAT);
+    RandomTriangles(Triangles, 200.0f, 0, 0);
+}
+
+static void
+DrawSmooth(unsigned Triangles)
+{
+    Ortho();
+    _mesa_Enable(GL_DEPTH_TEST);
+    _mesa_DepthFunc(GL_GREATER);
+    _mesa_ShadeModel(GL_SMOOTH);
+    RandomTriangles(Triangles, 200.0f, 0, 0);
+}
+
+static void
+DrawBlend(unsigned Triangles)
+{
+    Ortho();
+    _mesa_ShadeModel(GL_SMOOTH);
+    _mesa_Enable(GL_BLEND);
+    _mesa_BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    RandomTriangles(Triangles, 200.0f, 0, 1);
+}
+
+static void
+DrawAdd(unsigned Triangles)
+{
+    Ortho();
+    _mesa_ShadeModel(GL_FLAT);
+    _mesa_Enable(GL_BLEND);
+    _mesa_BlendFunc(GL_ONE, GL_ONE);
+    RandomTriangles(Triangles, 200.0f, 0, 0);
+}
+
+static void
+DrawTexNearest(unsigned Triangles)
+{
+    Ortho();
+    _mesa_Enable(GL_DEPTH_TEST);
+    _mesa_DepthFunc(GL_LESS);
+    _mesa_Hint(GL_PERSPECTIVE_CORRECTION_HINT, GL_FASTEST);
+    _mesa_TexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_DECAL);
+    Texture(GL_RGB, GL_NEAREST);
+    RandomTriangles(Triangles, 200.0f, 1, 0);
+}
+
+static void
+DrawTexLinear(unsigned Triangles)
+{
+    /* NICEST picks the perspective correct rasterizers, even with ortho */
+    Ortho();
+    _mesa_Enable(GL_DEPTH_TEST);
+    _mesa_DepthFunc(GL_LESS);
+    _mesa_Hint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);
+    _mesa_TexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    Texture(GL_RGBA, GL_LINEAR);
+    _mesa_Enable(GL_BLEND);
+    _mesa_BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    RandomTriangles(Triangles, 200.0f, 1, 1);
+}
+
+static void
+DrawStencil(unsigned Triangles)
+{
+    Ortho();
+    _mesa_Enable(GL_STENCIL_TEST);
+    _mesa_ShadeModel(GL_FLAT);
+
+    /* Write increasing stencil values */
+    _mesa_StencilFunc(GL_ALWAYS, 0, 0xff);
+    _mesa_StencilOp(GL_KEEP, GL_KEEP, GL_INCR);
+    RandomTriangles(Triangles / 2, 200.0f, 0, 0);
+
+    /* Then draw where they are above a threshold, with depth */
+    _mesa_Enable(GL_DEPTH_TEST);
+    _mesa_DepthFunc(GL_LESS);
+    _mesa_ShadeModel(GL_SMOOTH);
+    _mesa_StencilFunc(GL_LESS, 2, 0xff);
+    _mesa_StencilOp(GL_KEEP, GL_DECR, GL_KEEP);
+    RandomTriangles(Triangles / 2, 200.0f, 0, 0);
+}
+
+static const SCENE Scenes[] =
+{
+    { "flat_depth", DrawFlat },
+    { "smooth_depth", DrawSmooth },
+    { "blend_alpha", DrawBlend },
+    { "blend_add", DrawAdd },
+    { "tex_nearest", DrawTexNearest },
+    { "tex_linear", DrawTexLinear },
+    { "stencil", DrawStencil },
+};
+
+/* Renders the scene, the returned pixels belong to the caller */
+static GLuint *
+Render(const SCENE *Scene, unsigned Triangles, GLuint Threads, unsigned long long *Ns)
+{
+    BENCH_DRIVER Driver;
+    GLvisual *Visual;
+    GLframebuffer *Buffer;
+    unsigned long long Start;
+
+    memset(&Driver, 0, sizeof(Driver));
+    Driver.Pixels = XAlloc(WIDTH * HEIGHT * sizeof(GLuint));
+    Driver.Threads = Threads;
+
+    Visual = gl_create_visual(GL_TRUE, GL_FALSE, GL_TRUE, 16, 8, 0, 0,
+                              255.0f, 255.0f, 255.0f, 255.0f, 8, 8, 8, 0);
+    Buffer = Visual ? gl_create_framebuffer(Visual) : NULL;
+    Driver.Ctx = Visual ? gl_create_context(Visual, NULL, &Driver) : NULL;
+    if (!Driver.Ctx || !Buffer)
+    {
+        fprintf(stderr, "glbench: can't create the context\n");
+        exit(1);
+    }
+
+    CurrentContext = Driver.Ctx;
+    gl_make_current(Driver.Ctx, Buffer);
+    UpdateState(Driver.Ctx);
+    gl_Viewport(Driver.Ctx, 0, 0, WIDTH, HEIGHT);
+    gl_ResizeBuffersMESA(Driver.Ctx);
+
+    _mesa_ClearColor(0.25f, 0.5f, 0.75f, 0.0f);
+    _mesa_ClearStencil(0);
+    _mesa_Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+    /* Same random scene every time */
+    RandomState = 0x12345678;
+    Start = NowNs();
+    Scene->Draw(Triangles);
+    _mesa_Finish();
+    *Ns = NowNs() - Start;
+
+    gl_make_current(NULL, NULL);
+    CurrentContext = NULL;
+    gl_destroy_context(Driver.Ctx);
+    gl_destroy_framebuffer(Buffer);
+    gl_destroy_visual(Visual);
+
+    return Driver.Pixels;
+}
+
+static unsigned
+Checksum(const GLuint *Pixels)
+{
+    unsigned Hash = 2166136261u;
+    unsigned i;
+
+    for (i = 0; i < WIDTH * HEIGHT; i++)
+        Hash = (Hash ^ Pixels[i]) * 16777619u;
+    return Hash;
+}
+
+static void
+WritePpm(const char *Prefix, const SCENE *Scene, const GLuint *Pixels)
+{
+    char Path[1024];
+    FILE *File;
+    int x, y;
+
+    snprintf(Path, sizeof(Path), "%s%s.ppm", Prefix, Scene->Name);
+    File = fopen(Path, "wb");
+    if (!File)
+    {
+        fprintf(stderr, "glbench: can't write %s\n", Path);
+        return;
+    }
+    fprintf(File, "P6\n%d %d\n255\n", WIDTH, HEIGHT);
+    for (y = HEIGHT - 1; y >= 0; y--)
+    {
+        for (x = 0; x < WIDTH; x++)
+        {
+            GLuint Pixel = Pixels[y * WIDTH + x];
+            fputc(Pixel & 0xff, File);
+            fputc((Pixel >> 8) & 0xff, File);
+            fputc((Pixel >> 16) & 0xff, File);
+        }
+    }
+    fclose(File);
+}
+
+static void
+Usage(void)
+{
+    printf("Usage: glbench [-r runs] [-n triangles] [-t threads] [-o prefix]\n"
+           "\n"
+           "  -r runs     Render each scene this many times (default 3)\n"
+           "  -n count    Triangles per scene (default 4000)\n"
+           "  -t threads  Rasterizer threads (default: one per CPU)\n"
+           "  -o prefix   Write the reference images to <prefix><scene>.ppm\n");
+}
+
+int main(int argc, char **argv)
+{
+    unsigned Runs = 3, Triangles = 4000, Run, Scene;
+    long Cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    GLuint Threads = (Cpus > 1) ? (GLuint)Cpus : 2;
+    const char *Prefix = NULL;
+    int Arg, Failed = 0;
+
+    for (Arg = 1; Arg < argc; Arg++)
+    {
+        if (Arg + 1 < argc && !strcmp(argv[Arg], "-r"))
+        {
+            Runs = strtoul(argv[++Arg], NULL, 0);
+        }
+        else if (Arg + 1 < argc && !strcmp(argv[Arg], "-n"))
+        {
+            Triangles = strtoul(argv[++Arg], NULL, 0);
+        }
+        else if (Arg + 1 < argc && !strcmp(argv[Arg], "-t"))
+        {
+            Threads = strtoul(argv[++Arg], NULL, 0);
+        }
+        else if (Arg + 1 < argc && !strcmp(argv[Arg], "-o"))
+        {
+            Prefix = argv[++Arg];
+        }
+        else
+        {
+            Usage();
+            return strcmp(argv[Arg], "-h") ? 1 : 0;
+        }
+    }
+    if (!Runs)
+    {
+        fprintf(stderr, "glbench: nothing to do\n");
+        return 1;
+    }
+    if (Threads < 2)
+        Threads = 2;
+    if (Threads > MAX_THREADS)
+        Threads = MAX_THREADS;
+    PoolStart(Threads);
+
+    printf("scene,width,height,triangles,runs,threads,serial_ns,threaded_ns,checksum\n");
+    for (Scene = 0; Scene < sizeof(Scenes) / sizeof(Scenes[0]); Scene++)
+    {
+        const SCENE *s = &Scenes[Scene];
+        unsigned long long Serial = ~0ULL, Threaded = ~0ULL, Ns;
+        GLuint *Reference = NULL, *Pixels;
+        unsigned i;
+
+        for (Run = 0; Run < Runs; Run++)
+        {
+            Pixels = Render(s, Triangles, 1, &Ns);
+            if (Ns < Serial)
+                Serial = Ns;
+            if (!Reference)
+                Reference = Pixels;
+            else
+                free(Pixels);
+        }
+
+        for (Run = 0; Run < Runs; Run++)
+        {
+            Pixels = Render(s, Triangles, Threads, &Ns);
+            if (Ns < Threaded)
+                Threaded = Ns;
+            for (i = 0; i < WIDTH * HEIGHT; i++)
+            {
+                if (Pixels[i] != Reference[i])
+                {
+                    fprintf(stderr, "glbench: %s differs with %u threads at %u,%u\n",
+                            s->Name, Threads, i % WIDTH, i / WIDTH);
+                    Failed = 1;
+                    break;
+                }
+            }
+            free(Pixels);
+        }
+
+        if (Prefix)
+            WritePpm(Prefix, s, Reference);
+        printf("%s,%u,%u,%u,%u,%u,%llu,%llu,%08x\n", s->Name, WIDTH, HEIGHT, Triangles,
+               Runs, Threads, Serial, Threaded, Checksum(Reference));
+        free(Reference);
+    }
+
+    return Failed;
+}
@@ -0,0 +1,18 @@
+/*
+ * PROJECT:     ReactOS host tools
+ * LICENSE:     LGPL-2.1+ (https://spdx.org/licenses/LGPL-2.1+)
+ * PURPOSE:     Silent stand-in for wine/debug.h when building Mesa on the host
+ */
+
+#ifndef __WINE_WINE_DEBUG_H
+#define __WINE_WINE_DEBUG_H
+
+#define WINE_DEFAULT_DEBUG_CHANNEL(ch) static const int __wine_dbch_##ch = 0
+#define wine_dbgstr_a(s) (s)
+
+#define TRACE(...) do { } while (0)
+#define WARN(...)  do { } while (0)
+#define FIXME(...) do { } while (0)
+#define ERR(...)   do { } while (0)
+
+#endif /* __WINE_WINE_DEBUG_H */
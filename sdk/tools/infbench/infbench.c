@@ -0,0 +1,472 @@
+/*
+ * PROJECT:     ReactOS INF Benchmarks
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Host benchmark for the INF parser and its lookups
+ *
+ * Loads every .inf and .sif file below the given directories through the
+ * inflibhost build, once per open mode, and times opening them, looking up
+ * every section and every key the way setup and mkhive do, and closing
+ * them again. Before timing, each mode is checked against the first one:
+ * the parsed content must be identical and every lookup must return the
+ * same line a linear walk of the section finds. One CSV line per mode:
+ *
+ *   mode,files,runs,open_us,lookup_us,close_us,lookups,arena_kb
+ */
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "inflib.h"
+#include "infhost.h"
+
+typedef struct _BENCH_MODE
+{
+    const char *Name;
+    ULONG Flags;
+} BENCH_MODE;
+
+static const BENCH_MODE Modes[] =
+{
+    { "read",            0 },
+    { "mapped",          INF_HOST_MAP_FILE },
+    { "interned",        INF_HOST_INTERN_STRINGS },
+    { "mapped+interned", INF_HOST_MAP_FILE | INF_HOST_INTERN_STRINGS },
+};
+
+#define MODE_COUNT  (sizeof(Modes) / sizeof(Modes[0]))
+
+static char **FileNames;
+static ULONG FileCount;
+static ULONG FileMax;
+static HINF *Handles;
+static volatile ULONG_PTR BenchSink;
+
+/* HELPERS *******************************************************************/
+
+static ULONGLONG
+NowNs(VOID)
+{
+    struct timespec Ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &Ts);
+    return (ULONGLONG)Ts.tv_sec * 1000000000ULL + Ts.tv_nsec;
+}
+
+static PVOID
+XAlloc(SIZE_T Size)
+{
+    PVOID Buffer = malloc(Size);
+
+    if (!Buffer)
+    {
+        fprintf(stderr, "infbench: out of memory\n");
+        exit(1);
+    }
+    return Buffer;
+}
+
+static BOOLEAN
+IsInfName(const char *Name)
+{
+    const char *Dot = strrchr(Name, '.');
+
+    return Dot && (!strcasecmp(Dot, ".inf") || !strcasecmp(Dot, ".sif"));
+}
+
+static VOID
+AddFile(const char *Path)
+{
+    if (FileCount == FileMax)
+    {
+        char **NewNames;
+
+        FileMax = FileMax ? FileMax * 2 : 256;
+        NewNames = XAlloc(FileMax * sizeof(char *));
+        if (FileCount)
+            memcpy(NewNames, FileNames, FileCount * sizeof(char *));
+        free(FileNames);
+        FileNames = NewNames;
+    }
+
+    FileNames[FileCount] = XAlloc(strlen(Path) + 1);
+    strcpy(FileNames[FileCount++], Path);
+}
+
+static VOID
+CollectFiles(const char *Directory)
+{
+    DIR *Dir;
+    struct dirent *Entry;
+    struct stat Stat;
+    char Path[4096];
+
+    Dir = opendir(Directory);
+    if (!Dir)
+        return;
+
+    while ((Entry = readdir(Dir)) != NULL)
+    {
+        /* Skips ., .. and the VCS and build directories */
+        if (Entry->d_name[0] == '.')
+            continue;
+
+        snprintf(Path, sizeof(Path), "%s/%s", Directory, Entry->d_name);
+        if (lstat(Path, &Stat) != 0)
+            continue;
+
+        if (S_ISDIR(Stat.st_mode))
+            CollectFiles(Path);
+        else if (S_ISREG(Stat.st_mode) && IsInfName(Entry->d_name))
+            AddFile(Path);
+    }
+
+    closedir(Dir);
+}
+
+static int
+CompareNames(const void *a, const void *b)
+{
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/* CHECKS ********************************************************************/
+
+static ULONG
+HashWide(ULONG Hash, const WCHAR *String)
+{
+    if (String == NULL)
+        return (Hash ^ 0xFFFF) * 0x01000193;
+
+    do
+        Hash = (Hash ^ *String) * 0x01000193;
+    while (*String++);
+
+    return Hash;
+}
+
+/* Digest of everything the parser produced, in list order */
+static ULONG
+HashCache(PINFCACHE Cache)
+{
+    PINFCACHESECTION Section;
+    PINFCACHELINE Line;
+    PINFCACHEFIELD Field;
+    ULONG Hash = 0x811C9DC5;
+
+    for (Section = Cache->FirstSection; Section != NULL; Section = Section->Next)
+    {
+        Hash = HashWide(Hash, Section->Name);
+        for (Line = Section->FirstLine; Line != NULL; Line = Line->Next)
+        {
+            Hash = HashWide(Hash, Line->Key);
+            Hash = (Hash ^ Line->FieldCount) * 0x01000193;
+            for (Field = Line->FirstField; Field != NULL; Field = Field->Next)
+                Hash = HashWide(Hash, Field->Data);
+        }
+    }
+
+    return Hash;
+}
+
+/* Every lookup must land where a linear walk of the lists does */
+static BOOLEAN
+CheckLookups(const char *FileName, HINF Handle)
+{
+    PINFCACHE Cache = (PINFCACHE)Handle;
+    PINFCACHESECTION Section, Expected;
+    PINFCACHELINE Line, ExpectedLine;
+    PINFCONTEXT Context;
+    LONG Count;
+
+    for (Section = Cache->FirstSection; Section != NULL; Section = Section->Next)
+    {
+        for (Expected = Cache->FirstSection; Expected != NULL; Expected = Expected->Next)
+        {
+            if (strcmpiW(Expected->Name, Section->Name) == 0)
+                break;
+        }
+
+        if (Section->FirstLine != NULL)
+        {
+            if (InfHostFindFirstLine(Handle, Section->Name, NULL, &Context) != 0 ||
+                Context->Section != Expected->Id)
+            {
+                fprintf(stderr, "infbench: %s: section lookup mismatch\n", FileName);
+                return FALSE;
+            }
+
+            /* Walks the section line by line through the Id lookups */
+            Count = 1;
+            while (InfHostFindNextLine(Context, Context) == 0)
+                Count++;
+            InfHostFreeContext(Context);
+
+            if (Count != Expected->LineCount)
+            {
+                fprintf(stderr, "infbench: %s: line walk mismatch\n", FileName);
+                return FALSE;
+            }
+        }
+
+        for (Line = Section->FirstLine; Line != NULL; Line = Line->Next)
+        {
+            if (Line->Key == NULL || Line->Key[0] == 0)
+                continue;
+
+            for (ExpectedLine = Expected->FirstLine; ExpectedLine != NULL; ExpectedLine = ExpectedLine->Next)
+            {
+                if (ExpectedLine->Key != NULL && strcmpiW(ExpectedLine->Key, Line->Key) == 0)
+                    break;
+            }
+
+            if (InfHostFindFirstLine(Handle, Section->Name, Line->Key, &Context) != 0)
+            {
+                fprintf(stderr, "infbench: %s: key lookup failed\n", FileName);
+                return FALSE;
+            }
+
+            if (InfpGetLineForContext(Context) != ExpectedLine)
+            {
+                fprintf(stderr, "infbench: %s: key lookup mismatch\n", FileName);
+                InfHostFreeContext(Context);
+                return FALSE;
+            }
+            InfHostFreeContext(Context);
+        }
+    }
+
+    return TRUE;
+}
+
+static ULONG
+ArenaBytes(VOID)
+{
+    PINFCACHEARENA Block;
+    ULONG i, Bytes = 0;
+
+    for (i = 0; i < FileCount; i++)
+    {
+        for (Block = ((PINFCACHE)Handles[i])->Arena; Block != NULL; Block = Block->Next)
+            Bytes += Block->Size;
+    }
+
+    return Bytes;
+}
+
+/* WORKLOAD ******************************************************************/
+
+/* Drops the files the parser rejects, like the registry fragments that
+   share the extension but have no section header */
+static VOID
+FilterFiles(VOID)
+{
+    HINF Handle;
+    ULONG i, Kept = 0, ErrorLine;
+
+    for (i = 0; i < FileCount; i++)
+    {
+        if (InfHostOpenFileEx(&Handle, FileNames[i], 0, 0, &ErrorLine) != 0)
+        {
+            fprintf(stderr, "infbench: skipping %s (error at line %u)\n", FileNames[i], ErrorLine);
+            free(FileNames[i]);
+            continue;
+        }
+
+        InfHostCloseFile(Handle);
+        FileNames[Kept++] = FileNames[i];
+    }
+
+    FileCount = Kept;
+}
+
+static BOOLEAN
+OpenAll(ULONG Flags)
+{
+    ULONG i, ErrorLine;
+
+    for (i = 0; i < FileCount; i++)
+    {
+        if (InfHostOpenFileEx(&Handles[i], FileNames[i], 0, Flags, &ErrorLine) != 0)
+        {
+            fprintf(stderr, "infbench: %s: open failed at line %u\n", FileNames[i], ErrorLine);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static VOID
+CloseAll(VOID)
+{
+    ULONG i;
+
+    for (i = 0; i < FileCount; i++)
+        InfHostCloseFile(Handles[i]);
+}
+
+/* Looks up every section and every key by name, reads the first field of
+   each hit and walks each section with FindNextLine */
+static ULONG
+LookupAll(VOID)
+{
+    PINFCACHESECTION Section;
+    PINFCACHELINE Line;
+    PINFCONTEXT Context;
+    WCHAR Buffer[MAX_INF_STRING_LENGTH + 1];
+    ULONG i, Required, Lookups = 0;
+
+    for (i = 0; i < FileCount; i++)
+    {
+        for (Section = ((PINFCACHE)Handles[i])->FirstSection; Section != NULL; Section = Section->Next)
+        {
+            if (InfHostFindFirstLine(Handles[i], Section->Name, NULL, &Context) == 0)
+            {
+                do
+                    Lookups++;
+                while (InfHostFindNextLine(Context, Context) == 0);
+                InfHostFreeContext(Context);
+            }
+
+            for (Line = Section->FirstLine; Line != NULL; Line = Line->Next)
+            {
+                if (Line->Key == NULL || Line->Key[0] == 0)
+                    continue;
+
+                if (InfHostFindFirstLine(Handles[i], Section->Name, Line->Key, &Context) == 0)
+                {
+                    if (InfHostGetStringField(Context, 1, Buffer, MAX_INF_STRING_LENGTH + 1, &Required) == 0)
+                        BenchSink += Buffer[0];
+                    InfHostFreeContext(Context);
+                }
+                Lookups++;
+            }
+        }
+    }
+
+    return Lookups;
+}
+
+/* MAIN **********************************************************************/
+
+static VOID
+Usage(VOID)
+{
+    printf("Usage: infbench [-r runs] [directory ...]\n"
+           "\n"
+           "Parses every .inf and .sif file below the directories (default: the\n"
+           "current one) in each open mode and prints one CSV line per mode.\n");
+}
+
+int main(int argc, char **argv)
+{
+    ULONGLONG Start, Open[MODE_COUNT], Lookup[MODE_COUNT], Close[MODE_COUNT], Ns;
+    ULONG *Digests;
+    ULONG Runs = 5, Lookups = 0, Arena[MODE_COUNT];
+    ULONG i, Mode, Run;
+    int Arg;
+
+    for (Arg = 1; Arg < argc && argv[Arg][0] == '-'; Arg++)
+    {
+        if (Arg + 1 < argc && !strcmp(argv[Arg], "-r"))
+        {
+            Runs = strtoul(argv[++Arg], NULL, 0);
+        }
+        else
+        {
+            Usage();
+            return strcmp(argv[Arg], "-h") ? 1 : 0;
+        }
+    }
+
+    if (Arg == argc)
+        CollectFiles(".");
+    for (; Arg < argc; Arg++)
+        CollectFiles(argv[Arg]);
+
+    if (FileCount)
+    {
+        qsort(FileNames, FileCount, sizeof(char *), CompareNames);
+        FilterFiles();
+    }
+
+    if (FileCount == 0 || Runs == 0)
+    {
+        fprintf(stderr, "infbench: nothing to do\n");
+        return 1;
+    }
+
+    Handles = XAlloc(FileCount * sizeof(HINF));
+    Digests = XAlloc(FileCount * sizeof(ULONG));
+
+    for (Mode = 0; Mode < MODE_COUNT; Mode++)
+    {
+        if (!OpenAll(Modes[Mode].Flags))
+            return 1;
+
+        for (i = 0; i < FileCount; i++)
+        {
+            ULONG Digest = HashCache((PINFCACHE)Handles[i]);
+
+            if (Mode == 0)
+            {
+                Digests[i] = Digest;
+            }
+            else if (Digests[i] != Digest)
+            {
+                fprintf(stderr, "infbench: %s: %s parse differs from %s\n",
+                        FileNames[i], Modes[Mode].Name, Modes[0].Name);
+                return 1;
+            }
+
+            if (!CheckLookups(FileNames[i], Handles[i]))
+                return 1;
+        }
+
+        Arena[Mode] = ArenaBytes();
+        CloseAll();
+    }
+
+    for (Mode = 0; Mode < MODE_COUNT; Mode++)
+    {
+        Open[Mode] = Lookup[Mode] = Close[Mode] = ~0ULL;
+
+        for (Run = 0; Run < Runs; Run++)
+        {
+            Start = NowNs();
+            OpenAll(Modes[Mode].Flags);
+            Ns = NowNs() - Start;
+            if (Ns < Open[Mode])
+                Open[Mode] = Ns;
+
+            Start = NowNs();
+            Lookups = LookupAll();
+            Ns = NowNs() - Start;
+            if (Ns < Lookup[Mode])
+                Lookup[Mode] = Ns;
+
+            Start = NowNs();
+            CloseAll();
+            Ns = NowNs() - Start;
+            if (Ns < Close[Mode])
+                Close[Mode] = Ns;
+        }
+    }
+
+    printf("mode,files,runs,open_us,lookup_us,close_us,lookups,arena_kb\n");
+    for (Mode = 0; Mode < MODE_COUNT; Mode++)
+    {
+        printf("%s,%u,%u,%llu,%llu,%llu,%u,%u\n",
+               Modes[Mode].Name, FileCount, Runs,
+               Open[Mode] / 1000, Lookup[Mode] / 1000, Close[Mode] / 1000,
+               Lookups, Arena[Mode] / 1024);
+    }
+
+    for (i = 0; i < FileCount; i++)
+        free(FileNames[i]);
+    free(FileNames);
+    free(Handles);
+    free(Digests);
+    return 0;
+}
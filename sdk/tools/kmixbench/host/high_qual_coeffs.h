@@ -0,0 +1,12 @@
+/*
+ * PROJECT:     ReactOS Kernel Mixer Benchmarks
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Stand-in for libsamplerate's high quality coefficient table
+ *
+ * Only found when sdk/lib/3rdparty/libsamplerate has no high_qual_coeffs.h
+ * of its own, since src_sinc.c includes it with quotes. kmixer and the
+ * bench only ever ask for SRC_SINC_FASTEST, so SRC_SINC_BEST_QUALITY falls
+ * back to the medium quality table rather than leaving the bench unbuilt.
+ */
+
+#define slow_high_qual_coeffs slow_mid_qual_coeffs
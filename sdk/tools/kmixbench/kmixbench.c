@@ -0,0 +1,499 @@
+/*
+ * PROJECT:     ReactOS Kernel Mixer Benchmarks
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Host benchmark for the kmixer conversion, mixing and resampling
+ *
+ * Builds kmixer's mix.c and the libsamplerate import for the host. Before
+ * timing, the conversions are checked against libsamplerate's own array
+ * helpers (16 and 32 bit) and against those helpers shifted down (8 and 24
+ * bit), the mixer against a plain C sum, and a stream resampled packet by
+ * packet against the same stream resampled in one go. One CSV line per
+ * test:
+ *
+ *   test,samples,runs,ref_ns,new_ns
+ *
+ * ref_ns is libsamplerate's helper for the conversions, a per-sample C
+ * loop for the mixer and the old per packet src_new/src_delete path for
+ * the resampler.
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include <typedefs.h>
+#include <string.h>
+#include "mix.h"
+
+#define SAMPLES         (1 << 20)
+#define STREAMS         8
+#define CHANNELS        2
+#define IN_RATE         44100
+#define OUT_RATE        48000
+#define PACKET_FRAMES   441         /* 10 ms */
+
+#define min(a, b)       (((a) < (b)) ? (a) : (b))
+
+static volatile ULONG BenchSink;
+
+/* libsamplerate's config.h maps these for the kernel build */
+void __debugbreak(void)
+{
+    abort();
+}
+
+unsigned long DbgPrint(const char *Format, ...)
+{
+    return 0;
+}
+
+/* HELPERS *******************************************************************/
+
+static ULONGLONG
+NowNs(VOID)
+{
+    struct timespec Ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &Ts);
+    return (ULONGLONG)Ts.tv_sec * 1000000000ULL + Ts.tv_nsec;
+}
+
+static PVOID
+XAlloc(SIZE_T Size)
+{
+    PVOID Buffer = malloc(Size);
+
+    if (!Buffer)
+    {
+        fprintf(stderr, "kmixbench: out of memory\n");
+        exit(1);
+    }
+    return Buffer;
+}
+
+static ULONG
+Random(VOID)
+{
+    static ULONG State = 0x12345678;
+
+    State ^= State << 13;
+    State ^= State >> 17;
+    State ^= State << 5;
+    return State;
+}
+
+static VOID
+FillPcm(PUCHAR Buffer, ULONG Bytes)
+{
+    ULONG i;
+
+    for (i = 0; i < Bytes; i++)
+        Buffer[i] = (UCHAR)Random();
+}
+
+/* Mostly in range, some clipped, plus the edges */
+static VOID
+FillFloat(FLOAT *Buffer, ULONG Samples)
+{
+    static const FLOAT Edges[] = { 0.0f, -0.0f, 1.0f, -1.0f, 0.99999994f, -0.99999994f,
+                                   1.0000001f, -1.0000001f, 2.0f, -2.0f, 1e-10f, -1e-10f };
+    ULONG i;
+
+    for (i = 0; i < Samples; i++)
+        Buffer[i] = ((LONG)Random() / 2147483648.0f) * 1.25f;
+    for (i = 0; i < sizeof(Edges) / sizeof(Edges[0]) && i < Samples; i++)
+        Buffer[i * 7 % Samples] = Edges[i];
+}
+
+/* Reference narrow conversions, through libsamplerate's 32 bit helpers */
+static VOID
+RefFloatToPcm(const FLOAT *In, ULONG Bits, PUCHAR Out, int *Scratch, ULONG Samples)
+{
+    ULONG i;
+
+    src_float_to_int_array(In, Scratch, Samples);
+    for (i = 0; i < Samples; i++)
+    {
+        if (Bits == 8)
+        {
+            Out[i] = (UCHAR)((Scratch[i] >> 24) ^ 0x80);
+        }
+        else
+        {
+            Out[i * 3] = (UCHAR)(Scratch[i] >> 8);
+            Out[i * 3 + 1] = (UCHAR)(Scratch[i] >> 16);
+            Out[i * 3 + 2] = (UCHAR)(Scratch[i] >> 24);
+        }
+    }
+}
+
+static VOID
+RefPcmToFloat(const UCHAR *In, ULONG Bits, FLOAT *Out, int *Scratch, ULONG Samples)
+{
+    ULONG i;
+
+    for (i = 0; i < Samples; i++)
+    {
+        if (Bits == 8)
+            Scratch[i] = (int)((ULONG)(In[i] ^ 0x80) << 24);
+        else
+            Scratch[i] = (int)(((ULONG)In[i * 3] << 8) | ((ULONG)In[i * 3 + 1] << 16) | ((ULONG)In[i * 3 + 2] << 24));
+    }
+    src_int_to_float_array(Scratch, Out, Samples);
+}
+
+/* What PerformSampleRateConversion did for every packet */
+static ULONG
+OldResamplePacket(const short *In, ULONG Frames, short *Out)
+{
+    SRC_STATE *State;
+    SRC_DATA Data;
+    FLOAT *FloatIn, *FloatOut;
+    ULONG NewFrames;
+    short *Result;
+    int Error;
+
+    NewFrames = ((((ULONGLONG)Frames * OUT_RATE) + (IN_RATE / 2)) / IN_RATE) + 2;
+    FloatIn = XAlloc(Frames * CHANNELS * sizeof(FLOAT));
+    FloatOut = XAlloc(NewFrames * CHANNELS * sizeof(FLOAT));
+    Result = XAlloc(NewFrames * CHANNELS * sizeof(short));
+    State = src_new(SRC_SINC_FASTEST, CHANNELS, &Error);
+
+    src_short_to_float_array(In, FloatIn, Frames * CHANNELS);
+    Data.data_in = FloatIn;
+    Data.data_out = FloatOut;
+    Data.input_frames = Frames;
+    Data.output_frames = NewFrames;
+    Data.src_ratio = (double)OUT_RATE / IN_RATE;
+    Data.end_of_input = 0;
+    src_process(State, &Data);
+    src_float_to_short_array(FloatOut, Result, Data.output_frames_gen * CHANNELS);
+    memcpy(Out, Result, Data.output_frames_gen * CHANNELS * sizeof(short));
+
+    src_delete(State);
+    free(Result);
+    free(FloatOut);
+    free(FloatIn);
+    return Data.output_frames_gen;
+}
+
+static ULONG
+NewResample(PMIX_RESAMPLER Resampler, const short *In, ULONG Frames, ULONG Packet, short *Out)
+{
+    ULONG Offset, Take, Generated, Total = 0;
+
+    for (Offset = 0; Offset < Frames; Offset += Take)
+    {
+        Take = min(Packet, Frames - Offset);
+        MixResamplerProcess(Resampler, In + Offset * CHANNELS, 16, Take,
+                            Out + Total * CHANNELS, 16,
+                            MixResamplerMaxOutput(Resampler, Take), &Generated);
+        Total += Generated;
+    }
+    return Total;
+}
+
+/* CHECKS ********************************************************************/
+
+static BOOL
+CheckConversions(PUCHAR Pcm, FLOAT *Float, FLOAT *Float2, PUCHAR Out, PUCHAR Out2, int *Scratch)
+{
+    static const ULONG Widths[] = { 8, 16, 24, 32 };
+    ULONG w, Bits, Samples;
+
+    /* Odd lengths exercise the C tails behind the SSE2 blocks */
+    for (Samples = SAMPLES - 13; Samples <= SAMPLES; Samples += 13)
+    {
+        for (w = 0; w < 4; w++)
+        {
+            Bits = Widths[w];
+
+            FillPcm(Pcm, Samples * 4);
+            MixPcmToFloat(Pcm, Bits, Float, Samples);
+            if (Bits == 16)
+                src_short_to_float_array((short *)Pcm, Float2, Samples);
+            else if (Bits == 32)
+                src_int_to_float_array((int *)Pcm, Float2, Samples);
+            else
+                RefPcmToFloat(Pcm, Bits, Float2, Scratch, Samples);
+            if (memcmp(Float, Float2, Samples * sizeof(FLOAT)))
+            {
+                fprintf(stderr, "kmixbench: %u bit to float differs\n", Bits);
+                return FALSE;
+            }
+
+            /* Every PCM value that fits a float survives the round trip */
+            MixFloatToPcm(Float, Bits, Out, Samples);
+            if (Bits < 32 && memcmp(Out, Pcm, Samples * (Bits / 8)))
+            {
+                fprintf(stderr, "kmixbench: %u bit round trip differs\n", Bits);
+                return FALSE;
+            }
+
+            FillFloat(Float, Samples);
+            MixFloatToPcm(Float, Bits, Out, Samples);
+            if (Bits == 16)
+                src_float_to_short_array(Float, (short *)Out2, Samples);
+            else if (Bits == 32)
+                src_float_to_int_array(Float, (int *)Out2, Samples);
+            else
+                RefFloatToPcm(Float, Bits, Out2, Scratch, Samples);
+            if (memcmp(Out, Out2, Samples * (Bits / 8)))
+            {
+                fprintf(stderr, "kmixbench: float to %u bit differs\n", Bits);
+                return FALSE;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+static BOOL
+CheckMix(PUCHAR *Inputs, FLOAT *Accumulator, FLOAT *Sum, PUCHAR Out, PUCHAR Out2)
+{
+    MIX_STREAM Streams[STREAMS];
+    ULONG s, i;
+
+    for (s = 0; s < STREAMS; s++)
+    {
+        Streams[s].Data = Inputs[s];
+        Streams[s].BitsPerSample = (s & 1) ? 16 : 32;
+        Streams[s].Gain = 1.0f / (s + 1);
+    }
+
+    MixStreams(Streams, STREAMS, SAMPLES, Accumulator, MIX_MIN_FRAMES, 16, Out);
+
+    for (i = 0; i < SAMPLES; i++)
+    {
+        for (s = 0; s < STREAMS; s++)
+        {
+            FLOAT Value;
+
+            if (Streams[s].BitsPerSample == 16)
+                Value = (FLOAT)((const short *)Inputs[s])[i] * (Streams[s].Gain * (1.0f / 32768.0f));
+            else
+                Value = (FLOAT)((const int *)Inputs[s])[i] * (Streams[s].Gain * (1.0f / 2147483648.0f));
+            Sum[i] = s ? Sum[i] + Value : Value;
+        }
+    }
+    src_float_to_short_array(Sum, (short *)Out2, SAMPLES);
+
+    if (memcmp(Out, Out2, SAMPLES * 2))
+    {
+        fprintf(stderr, "kmixbench: mix differs from the C sum\n");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static BOOL
+CheckResampler(const short *In, short *Out, short *Out2)
+{
+    static const ULONG Packets[] = { 1, 441, 480, 4096, 10000 };
+    MIX_RESAMPLER Resampler;
+    ULONG Frames = SAMPLES / CHANNELS;
+    ULONG p, Whole, Total, Old, Skip;
+    ULONGLONG Error;
+
+    if (!MixResamplerInit(&Resampler, CHANNELS, IN_RATE, OUT_RATE, Frames))
+        return FALSE;
+    Whole = NewResample(&Resampler, In, Frames, Frames, Out2);
+
+    /* However the stream is cut into packets, the result is the same */
+    for (p = 0; p < sizeof(Packets) / sizeof(Packets[0]); p++)
+    {
+        MixResamplerReset(&Resampler);
+        Total = NewResample(&Resampler, In, Frames, Packets[p], Out);
+        if (Total != Whole || memcmp(Out, Out2, Total * CHANNELS * sizeof(short)))
+        {
+            fprintf(stderr, "kmixbench: %u frame packets resample to %u frames, %u in one go (%s)\n",
+                    Packets[p], Total, Whole, Total == Whole ? "data differs" : "count differs");
+            MixResamplerFree(&Resampler);
+            return FALSE;
+        }
+    }
+    MixResamplerFree(&Resampler);
+
+    /* For the record: how far the old per packet output strays from that */
+    for (p = 0, Old = 0; p + PACKET_FRAMES <= Frames; p += PACKET_FRAMES)
+        Old += OldResamplePacket(In + p * CHANNELS, PACKET_FRAMES, Out + Old * CHANNELS);
+    for (p = 0, Error = 0, Skip = min(Old, Whole); p < Skip * CHANNELS; p++)
+        Error += (ULONGLONG)abs(Out[p] - Out2[p]);
+    fprintf(stderr, "kmixbench: old path: %u frames instead of %u, mean error %llu\n",
+            Old, Whole, Skip ? (unsigned long long)(Error / (Skip * CHANNELS)) : 0ULL);
+
+    return TRUE;
+}
+
+/* MAIN **********************************************************************/
+
+static VOID
+Usage(VOID)
+{
+    printf("Usage: kmixbench [-r runs]\n"
+           "\n"
+           "Checks and times kmixer's PCM conversions, mixer and resampler on\n"
+           "generated data and prints one CSV line per test.\n");
+}
+
+#define BENCH(Best, Statement) \
+    do { \
+        ULONGLONG _Start = NowNs(), _Ns; \
+        Statement; \
+        _Ns = NowNs() - _Start; \
+        if (_Ns < (Best)) \
+            (Best) = _Ns; \
+    } while (0)
+
+int main(int argc, char **argv)
+{
+    static const ULONG Widths[] = { 8, 16, 24, 32 };
+    PUCHAR Pcm, Out, Out2, Inputs[STREAMS];
+    FLOAT *Float, *Float2;
+    int *Scratch;
+    ULONGLONG Ref, New;
+    ULONG Runs = 5, Run, w, s, i;
+    int Arg;
+
+    for (Arg = 1; Arg < argc; Arg++)
+    {
+        if (Arg + 1 < argc && !strcmp(argv[Arg], "-r"))
+        {
+            Runs = strtoul(argv[++Arg], NULL, 0);
+        }
+        else
+        {
+            Usage();
+            return strcmp(argv[Arg], "-h") ? 1 : 0;
+        }
+    }
+
+    if (Runs == 0)
+    {
+        fprintf(stderr, "kmixbench: nothing to do\n");
+        return 1;
+    }
+
+    Pcm = XAlloc(SAMPLES * 4);
+    Out = XAlloc(SAMPLES * 4 * 2);
+    Out2 = XAlloc(SAMPLES * 4 * 2);
+    Float = XAlloc(SAMPLES * sizeof(FLOAT));
+    Float2 = XAlloc(SAMPLES * sizeof(FLOAT));
+    Scratch = XAlloc(SAMPLES * sizeof(int));
+    for (s = 0; s < STREAMS; s++)
+    {
+        Inputs[s] = XAlloc(SAMPLES * 4);
+        FillPcm(Inputs[s], SAMPLES * 4);
+    }
+
+    if (!CheckConversions(Pcm, Float, Float2, Out, Out2, Scratch) ||
+        !CheckMix(Inputs, Float, Float2, Out, Out2) ||
+        !CheckResampler((const short *)Inputs[0], (short *)Out, (short *)Out2))
+    {
+        return 1;
+    }
+
+    printf("test,samples,runs,ref_ns,new_ns\n");
+
+    FillPcm(Pcm, SAMPLES * 4);
+    FillFloat(Float, SAMPLES);
+    for (w = 0; w < 4; w++)
+    {
+        ULONG Bits = Widths[w];
+
+        Ref = New = ~0ULL;
+        for (Run = 0; Run < Runs; Run++)
+        {
+            if (Bits == 16)
+                BENCH(Ref, src_short_to_float_array((short *)Pcm, Float2, SAMPLES));
+            else if (Bits == 32)
+                BENCH(Ref, src_int_to_float_array((int *)Pcm, Float2, SAMPLES));
+            else
+                BENCH(Ref, RefPcmToFloat(Pcm, Bits, Float2, Scratch, SAMPLES));
+            BENCH(New, MixPcmToFloat(Pcm, Bits, Float2, SAMPLES));
+        }
+        printf("pcm%u_to_float,%u,%u,%llu,%llu\n", Bits, SAMPLES, Runs,
+               (unsigned long long)Ref, (unsigned long long)New);
+
+        Ref = New = ~0ULL;
+        for (Run = 0; Run < Runs; Run++)
+        {
+            if (Bits == 16)
+                BENCH(Ref, src_float_to_short_array(Float, (short *)Out, SAMPLES));
+            else if (Bits == 32)
+                BENCH(Ref, src_float_to_int_array(Float, (int *)Out, SAMPLES));
+            else
+                BENCH(Ref, RefFloatToPcm(Float, Bits, Out, Scratch, SAMPLES));
+            BENCH(New, MixFloatToPcm(Float, Bits, Out, SAMPLES));
+        }
+        printf("float_to_pcm%u,%u,%u,%llu,%llu\n", Bits, SAMPLES, Runs,
+               (unsigned long long)Ref, (unsigned long long)New);
+    }
+
+    /* Eight 16 bit streams into one */
+    {
+        MIX_STREAM Streams[STREAMS];
+
+        for (s = 0; s < STREAMS; s++)
+        {
+            Streams[s].Data = Inputs[s];
+            Streams[s].BitsPerSample = 16;
+            Streams[s].Gain = 1.0f / STREAMS;
+        }
+
+        Ref = New = ~0ULL;
+        for (Run = 0; Run < Runs; Run++)
+        {
+            BENCH(Ref,
+                for (i = 0; i < SAMPLES; i++)
+                {
+                    FLOAT Sum = 0.0f;
+
+                    for (s = 0; s < STREAMS; s++)
+                        Sum += ((const short *)Inputs[s])[i] * (1.0f / (32768.0f * STREAMS));
+                    Float2[i] = Sum;
+                }
+                src_float_to_short_array(Float2, (short *)Out, SAMPLES));
+            BENCH(New, MixStreams(Streams, STREAMS, SAMPLES, Float, MIX_MIN_FRAMES, 16, Out));
+        }
+        printf("mix%u_pcm16,%u,%u,%llu,%llu\n", STREAMS, SAMPLES, Runs,
+               (unsigned long long)Ref, (unsigned long long)New);
+    }
+
+    /* 10 ms packets of 16 bit stereo, 44.1 to 48 kHz */
+    {
+        MIX_RESAMPLER Resampler;
+        const short *In = (const short *)Inputs[0];
+        ULONG Frames = SAMPLES / CHANNELS / 4;
+        ULONG Offset, Total;
+
+        MixResamplerInit(&Resampler, CHANNELS, IN_RATE, OUT_RATE, PACKET_FRAMES);
+
+        Ref = New = ~0ULL;
+        for (Run = 0; Run < Runs; Run++)
+        {
+            BENCH(Ref,
+                for (Offset = 0, Total = 0; Offset + PACKET_FRAMES <= Frames; Offset += PACKET_FRAMES)
+                    Total += OldResamplePacket(In + Offset * CHANNELS, PACKET_FRAMES, (short *)Out + Total * CHANNELS));
+            BenchSink += Total;
+
+            MixResamplerReset(&Resampler);
+            BENCH(New, Total = NewResample(&Resampler, In, Frames / PACKET_FRAMES * PACKET_FRAMES, PACKET_FRAMES, (short *)Out));
+            BenchSink += Total;
+        }
+        printf("resample_%u_%u_packets,%u,%u,%llu,%llu\n", IN_RATE, OUT_RATE, Frames * CHANNELS, Runs,
+               (unsigned long long)Ref, (unsigned long long)New);
+
+        MixResamplerFree(&Resampler);
+    }
+
+    for (s = 0; s < STREAMS; s++)
+        free(Inputs[s]);
+    free(Scratch);
+    free(Float2);
+    free(Float);
+    free(Out2);
+    free(Out);
+    free(Pcm);
+    return 0;
+}
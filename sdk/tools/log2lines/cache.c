@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <dirent.h>
 
 #include "util.h"
 #include "version.h"
@@ -186,13 +187,65 @@ read_cache(void)
     return result;
 }
 
+/* Walks the tree in-process (like 'find <dir> -type f' did) and writes
+ * one line per image: name|path|ImageBase|rossym offset|rossym size|file size
+ */
+static int
+scan_directory(FILE *fw, char *dir, int skipImageBase)
+{
+    char Path[PATH_MAX];
+    DIR *d;
+    struct dirent *de;
+    struct stat st;
+    size_t ImageBase, SymOffset, SymSize;
+    int err, count = 0;
+
+    if ((d = opendir(dir)) == NULL)
+    {
+        l2l_dbg(1, "Cannot open directory %s\n", dir);
+        return -1;
+    }
+
+    while ((de = readdir(d)) != NULL)
+    {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+            continue;
+
+        snprintf(Path, sizeof(Path), "%s" PATH_STR "%s", dir, de->d_name);
+        if (LSTAT(Path, &st) != 0)
+            continue;
+
+        if (S_ISDIR(st.st_mode))
+        {
+            err = scan_directory(fw, Path, skipImageBase);
+            if (err > 0)
+                count += err;
+            continue;
+        }
+
+        if (!S_ISREG(st.st_mode) || skipImageBase)
+            continue;
+
+        if ((err = get_ImageBase(Path, &ImageBase)) == 0)
+        {
+            get_RosSymInfo(Path, &SymOffset, &SymSize);
+            fprintf(fw, "%s|%s|%0x|%x|%x|%x\n", de->d_name, Path, (unsigned int)ImageBase,
+                    (unsigned int)SymOffset, (unsigned int)SymSize, (unsigned int)st.st_size);
+            count++;
+        }
+        else
+            l2l_dbg(3, "%s|%s|%0x, ERR=%d\n", de->d_name, Path, (unsigned int)ImageBase, err);
+    }
+
+    closedir(d);
+    return count;
+}
+
 int
 create_cache(int force, int skipImageBase)
 {
-    FILE *fr, *fw;
-    char Line[LINESIZE + 1], *Fname = NULL;
-    int len, err;
-    size_t ImageBase;
+    FILE *fw;
+    int count;
 
     if ((fw = fopen(tmp_name, "w")) == NULL)
     {
@@ -221,53 +274,30 @@ create_cache(int force, int skipImageBase)
         }
     }
 
-    Line[LINESIZE] = '\0';
-
-    remove(tmp_name);
     l2l_dbg(0, "Scanning %s ...\n", opt_dir);
-    snprintf(Line, LINESIZE, DIR_FMT, opt_dir, tmp_name);
-    l2l_dbg(1, "Executing: %s\n", Line);
-    if (system(Line) != 0)
+    if ((fw = fopen(tmp_name, "w")) == NULL)
+    {
+        l2l_dbg(0, "Cannot create %s\n", tmp_name);
+        return 2;
+    }
+
+    count = scan_directory(fw, opt_dir, skipImageBase);
+    fclose(fw);
+    if (count < 0)
     {
         l2l_dbg(0, "Cannot list directory %s\n", opt_dir);
-        l2l_dbg(1, "Failed to execute: '%s'\n", Line);
         remove(tmp_name);
         return 2;
     }
-    l2l_dbg(0, "Creating cache ...");
 
-    if ((fr = fopen(tmp_name, "r")) != NULL)
+    /* Only replace the cache once it is complete */
+    if (rename(tmp_name, cache_name) != 0)
     {
-        if ((fw = fopen(cache_name, "w")) != NULL)
-        {
-            while (fgets(Line, LINESIZE, fr) != NULL)
-            {
-                len = strlen(Line);
-                if (!len)
-                    continue;
-
-                Fname = Line + len - 1;
-                if (*Fname == '\n')
-                    *Fname = '\0';
-
-                while (Fname > Line && *Fname != PATH_CHAR)
-                    Fname--;
-                if (*Fname == PATH_CHAR)
-                    Fname++;
-                if (*Fname && !skipImageBase)
-                {
-                    if ((err = get_ImageBase(Line, &ImageBase)) == 0)
-                        fprintf(fw, "%s|%s|%0x\n", Fname, Line, (unsigned int)ImageBase);
-                    else
-                        l2l_dbg(3, "%s|%s|%0x, ERR=%d\n", Fname, Line, (unsigned int)ImageBase, err);
-                }
-            }
-            fclose(fw);
-        }
-        l2l_dbg(0, "... done\n");
-        fclose(fr);
+        l2l_dbg(0, "Cannot create cache %s\n", cache_name);
+        remove(tmp_name);
+        return 2;
     }
-    remove(tmp_name);
+    l2l_dbg(0, "Created cache with %d images\n", count);
     return 0;
 }
 
@@ -3,6 +3,7 @@
 #if defined(_WIN32)
 
 #include <direct.h>
+#include <sys/stat.h>
 
 #define POPEN           _popen
 #define PCLOSE          _pclose
@@ -12,8 +13,7 @@
 #define PATH_CHAR       '\\'
 #define PATH_STR        "\\"
 #define PATHCMP         strcasecmp
-#define CP_CMD          "copy /Y "
-#define DIR_FMT         "dir /a:-d /s /b %s > %s"
+#define LSTAT           stat
 
 #else /* not defined (_WIN32) */
 #include <sys/stat.h>
@@ -26,8 +26,7 @@
 #define PATH_CHAR       '/'
 #define PATH_STR        "/"
 #define PATHCMP         strcasecmp
-#define CP_CMD          "cp -f "
-#define DIR_FMT         "find %s -type f > %s"
+#define LSTAT           lstat
 
 #endif /* not defined (_WIN32) */
 
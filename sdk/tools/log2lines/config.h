@@ -13,8 +13,6 @@
 #define PIPEREAD_CMD    "piperead -c"
 
 
-#define CP_FMT          CP_CMD "%s %s > " DEV_NULL
-
 #define CMD_7Z          "7z"
 #define UNZIP_FMT_7Z    "%s e -y %s -o%s > " DEV_NULL
 #define UNZIP_FMT       "%s x -tIso -y -r %s -o%s > " DEV_NULL
@@ -30,4 +28,8 @@ PATH_STR "reactos" PATH_STR "reactos > " DEV_NULL
 #define LINESIZE        1024
 #define NAMESIZE        80
 
+/* Whole logs are translated in batches of lines, see -j */
+#define BATCH_LINES     2048
+#define MAX_THREADS     64
+
 /* EOF */
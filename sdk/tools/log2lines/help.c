@@ -28,8 +28,9 @@ char *verboseUsage =
 "  - An image with base < 0x400000 MUST be relocated to a > 0x400000 address.\n"
 "  - The offset of a relocated image MUST be relative.\n\n"
 "  log2lines uses a cache in order to avoid a directory scan at each\n"
-"  image lookup, greatly increasing performance. Only image path and its\n"
-"  base address are cached.\n\n"
+"  image lookup, greatly increasing performance. The image path, its\n"
+"  base address and the location of its symbols are cached. The symbols\n"
+"  of each image are mapped once, when it is first seen in the log.\n\n"
 "Options:\n"
 "  -b   Use this combined with '-l'. Enable buffering on logFile.\n"
 "       This may solve loosing output on real hardware (ymmv).\n\n"
@@ -49,6 +50,11 @@ char *verboseUsage =
 "  -f   Force creating new cache.\n\n"
 "  -F   As -f but exits immediately after creating cache.\n\n"
 "  -h   This text.\n\n"
+"  -j <threads>\n"
+"       <threads>: Number of threads doing the lookups. The input is then\n"
+"       read and translated in batches of lines instead of line by line.\n"
+"       Not used with -c and -r.\n"
+"       Default: all CPUs when stdin is a file, otherwise 1\n\n"
 "  -l <logFile>\n"
 "       <logFile>: Append copy to specified logFile.\n"
 "       Default: no logFile\n\n"
@@ -76,6 +82,7 @@ char *verboseUsage =
 "       - Reg candidates:  Regression candidates. See '-R regscan'\n"
 "       - Offset error:    Image exists, but error retrieving offset info.\n"
 "       - Total:           Total number of lines attempted to translate.\n"
+"       - Lines:           Lines read, and the number of lines per second.\n"
 "       Also some version info is displayed.\n\n"
 "  -S <context>[+<add>][,<sources>]\n"
 "       Source line options:\n"
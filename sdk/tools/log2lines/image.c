@@ -34,25 +34,48 @@ fixup_offset(size_t ImageBase, size_t offset)
     return offset;
 }
 
+/* The entries are sorted by address. Returns the last one at or below
+ * offset; as before, an offset past the last entry is not found.
+ */
 PROSSYM_ENTRY
 find_offset(void *data, size_t offset)
 {
     PSYMBOLFILE_HEADER RosSymHeader = (PSYMBOLFILE_HEADER)data;
+    PSYMBOLFILE_INDEX Index = (PSYMBOLFILE_INDEX)(RosSymHeader + 1);
     PROSSYM_ENTRY Entries = (PROSSYM_ENTRY)((char *)data + RosSymHeader->SymbolsOffset);
     size_t symbols = RosSymHeader->SymbolsLength / sizeof(ROSSYM_ENTRY);
-    size_t i;
-
-    for (i = 0; i < symbols; i++)
+    size_t lo = 0, hi = symbols, mid;
+
+    /* Narrow the search to one bucket of the address index, if rsym wrote one */
+    if (RosSymHeader->SymbolsOffset >= sizeof(SYMBOLFILE_HEADER) + FIELD_OFFSET(SYMBOLFILE_INDEX, FirstEntry) &&
+        Index->Magic == SYMBOLFILE_INDEX_MAGIC && Index->Shift < 32 &&
+        Index->BucketCount < (RosSymHeader->SymbolsOffset - sizeof(SYMBOLFILE_HEADER) -
+                              FIELD_OFFSET(SYMBOLFILE_INDEX, FirstEntry)) / sizeof(ULONG) &&
+        Index->FirstEntry[Index->BucketCount] == symbols)
     {
-        if (Entries[i].Address > offset)
+        if ((offset >> Index->Shift) < Index->BucketCount)
         {
-            if (!i--)
-                return NULL;
-            else
-                return &Entries[i];
+            lo = Index->FirstEntry[offset >> Index->Shift];
+            hi = Index->FirstEntry[(offset >> Index->Shift) + 1];
+            if (lo > hi || hi > symbols)
+                lo = 0, hi = symbols;
         }
+        else
+            lo = symbols;
     }
-    return NULL;
+
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        if (Entries[mid].Address > offset)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+
+    if (lo == 0 || lo == symbols)
+        return NULL;
+    return &Entries[lo - 1];
 }
 
 PIMAGE_SECTION_HEADER
@@ -165,4 +188,53 @@ get_ImageBase(char *fname, size_t *ImageBase)
     return 0;
 }
 
+/* Locates the raw .rossym data in the file, so it can be mapped without
+ * reading (or parsing) the rest of the image again.
+ */
+int
+get_RosSymInfo(char *fname, size_t *SymOffset, size_t *SymSize)
+{
+    IMAGE_DOS_HEADER PEDosHeader;
+    IMAGE_FILE_HEADER PEFileHeader;
+    IMAGE_SECTION_HEADER PESectionHeader;
+    FILE *fr;
+    size_t i;
+    int res = 3;
+
+    *SymOffset = *SymSize = 0;
+    fr = fopen(fname, "rb");
+    if (!fr)
+    {
+        l2l_dbg(3, "get_RosSymInfo, cannot open '%s' (%s)\n", fname, strerror(errno));
+        return 1;
+    }
+
+    if (1 != fread(&PEDosHeader, sizeof(IMAGE_DOS_HEADER), 1, fr) ||
+        PEDosHeader.e_magic != IMAGE_DOS_MAGIC || PEDosHeader.e_lfanew == 0L ||
+        fseek(fr, PEDosHeader.e_lfanew + sizeof(ULONG), SEEK_SET) ||
+        1 != fread(&PEFileHeader, sizeof(IMAGE_FILE_HEADER), 1, fr) ||
+        fseek(fr, PEFileHeader.SizeOfOptionalHeader, SEEK_CUR))
+    {
+        l2l_dbg(2, "get_RosSymInfo %s, not a PE image\n", fname);
+        fclose(fr);
+        return 2;
+    }
+
+    for (i = 0; i < PEFileHeader.NumberOfSections; i++)
+    {
+        if (1 != fread(&PESectionHeader, sizeof(IMAGE_SECTION_HEADER), 1, fr))
+            break;
+        if (0 == strncmp((char *)PESectionHeader.Name, ".rossym", IMAGE_SIZEOF_SHORT_NAME))
+        {
+            *SymOffset = PESectionHeader.PointerToRawData;
+            *SymSize = PESectionHeader.SizeOfRawData;
+            res = 0;
+            break;
+        }
+    }
+
+    fclose(fr);
+    return res;
+}
+
 /* EOF */
@@ -17,4 +17,6 @@ PIMAGE_SECTION_HEADER get_sectionheader(const void *FileData);
 
 int get_ImageBase(char *fname, size_t *ImageBase);
 
+int get_RosSymInfo(char *fname, size_t *SymOffset, size_t *SymSize);
+
 /* EOF */
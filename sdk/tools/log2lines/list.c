@@ -121,11 +121,12 @@ cache_entry_create(char *Line)
     PLIST_MEMBER pentry;
     char *s = NULL;
     int l;
+    unsigned int ImageBase, SymOffset, SymSize, FileSize;
 
     if (!Line)
         return NULL;
 
-    pentry = malloc(sizeof(LIST_MEMBER));
+    pentry = calloc(1, sizeof(LIST_MEMBER));
     if (!pentry)
         return NULL;
 
@@ -158,11 +159,20 @@ cache_entry_create(char *Line)
         return entry_delete(pentry);
     }
     *s++ = '\0';
-    if (1 != sscanf(s, "%x", (unsigned int *)(&pentry->ImageBase)))
+    /* The .rossym location was added later, older caches just lack it */
+    l = sscanf(s, "%x|%x|%x|%x", &ImageBase, &SymOffset, &SymSize, &FileSize);
+    if (l < 1)
     {
         l2l_dbg(1, "ImageBase field missing\n");
         return entry_delete(pentry);
     }
+    pentry->ImageBase = ImageBase;
+    if (l == 4)
+    {
+        pentry->SymOffset = SymOffset;
+        pentry->SymSize = SymSize;
+        pentry->FileSize = FileSize;
+    }
     pentry->RelBase = INVALID_BASE;
     pentry->Size = 0;
     return pentry;
@@ -181,7 +191,7 @@ sources_entry_create(PLIST list, char *path, char *prefix)
     if (!prefix)
         prefix = "";
 
-    pentry = malloc(sizeof(LIST_MEMBER));
+    pentry = calloc(1, sizeof(LIST_MEMBER));
     if (!pentry)
         return NULL;
 
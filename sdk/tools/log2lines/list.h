@@ -8,6 +8,9 @@ typedef struct entry_struct
     size_t ImageBase;
     size_t RelBase;
     size_t Size;
+    size_t SymOffset;   // raw .rossym data in the file, see create_cache()
+    size_t SymSize;
+    size_t FileSize;
     struct entry_struct *pnext;
 } LIST_MEMBER, *PLIST_MEMBER;
 
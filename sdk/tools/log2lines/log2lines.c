@@ -9,6 +9,10 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#if !defined(_WIN32)
+#include <pthread.h>
+#include <unistd.h>
+#endif
 
 #include "util.h"
 #include "version.h"
@@ -20,6 +24,7 @@
 #include "help.h"
 #include "cmd.h"
 #include "match.h"
+#include "symidx.h"
 
 
 static FILE *dbgIn          = NULL;
@@ -103,201 +108,182 @@ report(FILE *outFile)
 }
 
 
-static int
-print_offset(void *data, size_t offset, char *toString)
+/* The lookup for one <IMAGENAME:ADDRESS>. resolve_offset() only reads the
+ * symbol index so it can run on the worker threads, everything with side
+ * effects (lastLine, sources, statistics) is left to account_resolved().
+ */
+typedef struct resolved_struct
+{
+    int             valid;
+    char            path[LINESIZE + 1];
+    size_t          offset;
+    int             res;
+    int             offset_error;
+    int             differ;
+    PSYM_MODULE     mod;
+    PROSSYM_ENTRY   e;
+    PROSSYM_ENTRY   e2;
+    char            LineOut[LINESIZE + 1];
+} RESOLVED, *PRESOLVED;
+
+/* Set by translate_batches() for the line being translated */
+static PRESOLVED prefetched = NULL;
+
+static void
+format_offset(PRESOLVED r)
 {
-    PSYMBOLFILE_HEADER RosSymHeader = (PSYMBOLFILE_HEADER)data;
-    PROSSYM_ENTRY e = NULL;
-    PROSSYM_ENTRY e2 = NULL;
-    int bFileOffsetChanged = 0;
+    PROSSYM_ENTRY e = r->e;
+    PROSSYM_ENTRY e2 = r->e2;
+    char *Strings = symidx_strings(r->mod);
+    int bFileOffsetChanged;
     char fmt[LINESIZE];
-    char *Strings = (char *)data + RosSymHeader->StringsOffset;
 
-    fmt[0] = '\0';
-    e = find_offset(data, offset);
-    if (opt_twice)
+    if (!e2)
     {
-        e2 = find_offset(data, offset - 1);
+        snprintf(r->LineOut, LINESIZE, "%s:%u (%s)",
+            &Strings[e->FileOffset],
+            (unsigned int)e->SourceLine,
+            &Strings[e->FunctionOffset]);
+        return;
+    }
 
-        if (e == e2)
-            e2 = NULL;
-        else
-            summ.diff++;
+    /*
+     * - "%.0s" displays nothing, but processes argument
+     * - bFileOffsetChanged implies always display 2nd SourceLine even if the same
+     * - also for FunctionOffset
+     */
+    bFileOffsetChanged = e->FileOffset != e2->FileOffset;
+    strcpy(fmt, "%s");
+    if (bFileOffsetChanged)
+        strcat(fmt, "[%s]");
+    else
+        strcat(fmt, "%.0s");
 
-        if (opt_Twice && e2)
-        {
-            e = e2;
-            e2 = NULL;
-            /* replaced (transparantly), but updated stats */
-        }
+    strcat(fmt, ":%u");
+    if (e->SourceLine != e2->SourceLine || bFileOffsetChanged)
+        strcat(fmt, "[%u]");
+    else
+        strcat(fmt, "%.0u");
+
+    strcat(fmt, " (%s");
+    if (e->FunctionOffset != e2->FunctionOffset || bFileOffsetChanged)
+        strcat(fmt, "[%s])");
+    else
+        strcat(fmt, "%.0s)");
+
+    snprintf(r->LineOut, LINESIZE, fmt,
+        &Strings[e->FileOffset],
+        &Strings[e2->FileOffset],
+        (unsigned int)e->SourceLine,
+        (unsigned int)e2->SourceLine,
+        &Strings[e->FunctionOffset],
+        &Strings[e2->FunctionOffset]);
+}
+
+static void
+resolve_offset(PRESOLVED r, const char *cpath, size_t offset)
+{
+    PSYM_MODULE mod;
+
+    r->offset = offset;
+    r->offset_error = r->differ = 0;
+    r->e = r->e2 = NULL;
+    r->LineOut[0] = '\0';
+
+    r->mod = mod = symidx_lookup(cpath);
+    if (!mod)
+    {
+        r->res = 1;
+        return;
     }
-    if (e || e2)
+    if (mod->res)
     {
-        strcpy(lastLine.file1, &Strings[e->FileOffset]);
-        strcpy(lastLine.func1, &Strings[e->FunctionOffset]);
-        lastLine.nr1 = e->SourceLine;
-        sources_entry_create(&sources, lastLine.file1, SVN_PREFIX);
-        lastLine.valid = 1;
-        if (e2)
-        {
-            strcpy(lastLine.file2, &Strings[e2->FileOffset]);
-            strcpy(lastLine.func2, &Strings[e2->FunctionOffset]);
-            lastLine.nr2 = e2->SourceLine;
-            sources_entry_create(&sources, lastLine.file2, SVN_PREFIX);
-            bFileOffsetChanged = e->FileOffset != e2->FileOffset;
-            if (e->FileOffset != e2->FileOffset || e->FunctionOffset != e2->FunctionOffset)
-                summ.majordiff++;
-
-            /*
-             * - "%.0s" displays nothing, but processes argument
-             * - bFileOffsetChanged implies always display 2nd SourceLine even if the same
-             * - also for FunctionOffset
-             */
-            strcat(fmt, "%s");
-            if (bFileOffsetChanged)
-                strcat(fmt, "[%s]");
-            else
-                strcat(fmt, "%.0s");
+        r->res = mod->res;
+        r->offset_error = mod->sym_error;
+        return;
+    }
 
-            strcat(fmt, ":%u");
-            if (e->SourceLine != e2->SourceLine || bFileOffsetChanged)
-                strcat(fmt, "[%u]");
-            else
-                strcat(fmt, "%.0u");
+    r->e = symidx_find(mod, offset);
+    if (opt_twice)
+    {
+        r->e2 = symidx_find(mod, offset - 1);
 
-            strcat(fmt, " (%s");
-            if (e->FunctionOffset != e2->FunctionOffset || bFileOffsetChanged)
-                strcat(fmt, "[%s])");
-            else
-                strcat(fmt, "%.0s)");
-
-            if (toString)
-            {   // put in toString if provided
-                snprintf(toString, LINESIZE, fmt,
-                    &Strings[e->FileOffset],
-                    &Strings[e2->FileOffset],
-                    (unsigned int)e->SourceLine,
-                    (unsigned int)e2->SourceLine,
-                    &Strings[e->FunctionOffset],
-                    &Strings[e2->FunctionOffset]);
-            }
-            else
-            {
-                strcat(fmt, "\n");
-                printf(fmt,
-                    &Strings[e->FileOffset],
-                    &Strings[e2->FileOffset],
-                    (unsigned int)e->SourceLine,
-                    (unsigned int)e2->SourceLine,
-                    &Strings[e->FunctionOffset],
-                    &Strings[e2->FunctionOffset]);
-            }
-        }
+        if (r->e == r->e2)
+            r->e2 = NULL;
         else
+            r->differ = 1;
+
+        if (opt_Twice && r->e2)
         {
-            if (toString)
-            {   // put in toString if provided
-                snprintf(toString, LINESIZE, "%s:%u (%s)",
-                    &Strings[e->FileOffset],
-                    (unsigned int)e->SourceLine,
-                    &Strings[e->FunctionOffset]);
-            }
-            else
-            {
-                printf("%s:%u (%s)\n",
-                    &Strings[e->FileOffset],
-                    (unsigned int)e->SourceLine,
-                    &Strings[e->FunctionOffset]);
-            }
+            r->e = r->e2;
+            r->e2 = NULL;
+            /* replaced (transparantly), but updated stats */
         }
-        return 0;
     }
-    return 1;
-}
-
-static int
-process_data(const void *FileData, size_t offset, char *toString)
-{
-    int res;
 
-    PIMAGE_SECTION_HEADER PERosSymSectionHeader = get_sectionheader((char *)FileData);
-    if (!PERosSymSectionHeader)
-        return 2;
-
-    res = print_offset((char *)FileData + PERosSymSectionHeader->PointerToRawData, offset, toString);
-    if (res)
+    if (r->e)
     {
-        if (toString)
-            sprintf(toString, "??:0");
-        else
-            printf("??:0");
-        l2l_dbg(1, "Offset not found: %x\n", (unsigned int)offset);
-        summ.offset_errors++;
+        format_offset(r);
+        r->res = 0;
+    }
+    else
+    {
+        strcpy(r->LineOut, "??:0");
+        r->offset_error = 1;
+        r->res = 1;
     }
-
-    return res;
 }
 
-static int
-process_file(const char *file_name, size_t offset, char *toString)
+static void
+account_resolved(PRESOLVED r)
 {
-    void *FileData;
-    size_t FileSize;
-    int res = 1;
+    char *Strings;
 
-    FileData = load_file(file_name, &FileSize);
-    if (!FileData)
+    summ.diff += r->differ;
+    summ.offset_errors += r->offset_error;
+    if (!r->e)
     {
-        l2l_dbg(0, "An error occured loading '%s'\n", file_name);
+        if (r->mod && !r->mod->res)
+            l2l_dbg(1, "Offset not found: %x\n", (unsigned int)r->offset);
+        return;
     }
-    else
+
+    Strings = symidx_strings(r->mod);
+    strcpy(lastLine.file1, &Strings[r->e->FileOffset]);
+    strcpy(lastLine.func1, &Strings[r->e->FunctionOffset]);
+    lastLine.nr1 = r->e->SourceLine;
+    /* The list is a linear one, only keep it when showing sources */
+    if (opt_Source)
+        sources_entry_create(&sources, lastLine.file1, SVN_PREFIX);
+    lastLine.valid = 1;
+    if (r->e2)
     {
-        res = process_data(FileData, offset, toString);
-        free(FileData);
+        strcpy(lastLine.file2, &Strings[r->e2->FileOffset]);
+        strcpy(lastLine.func2, &Strings[r->e2->FunctionOffset]);
+        lastLine.nr2 = r->e2->SourceLine;
+        if (opt_Source)
+            sources_entry_create(&sources, lastLine.file2, SVN_PREFIX);
+        if (r->e->FileOffset != r->e2->FileOffset || r->e->FunctionOffset != r->e2->FunctionOffset)
+            summ.majordiff++;
     }
-    return res;
 }
 
 static int
 translate_file(const char *cpath, size_t offset, char *toString)
 {
-    size_t base = 0;
-    LIST_MEMBER *pentry = NULL;
-    int res = 0;
-    char *path, *dpath;
+    RESOLVED local;
+    PRESOLVED r = prefetched;
 
-    dpath = path = convert_path(cpath);
-    if (!path)
-        return 1;
-
-    // The path could be absolute:
-    if (get_ImageBase(path, &base))
+    if (!r || !r->valid || r->offset != offset || strcmp(r->path, cpath) != 0)
     {
-        pentry = entry_lookup(&cache, path);
-        if (pentry)
-        {
-            path = pentry->path;
-            base = pentry->ImageBase;
-            if (base == INVALID_BASE)
-            {
-                l2l_dbg(1, "No, or invalid base address: %s\n", path);
-                res = 2;
-            }
-        }
-        else
-        {
-            l2l_dbg(1, "Not found in cache: %s\n", path);
-            res = 3;
-        }
+        r = &local;
+        resolve_offset(r, cpath, offset);
     }
 
-    if (!res)
-    {
-        res = process_file(path, offset, toString);
-    }
-
-    free(dpath);
-    return res;
+    account_resolved(r);
+    if (r->LineOut[0])
+        strcpy(toString, r->LineOut);
+    return r->res;
 }
 
 static void
@@ -405,6 +391,143 @@ translate_line(FILE *outFile, char *Line, char *path, char *LineOut)
     memset(Line, '\0', LINESIZE);  // flushed
 }
 
+#if !defined(_WIN32)
+typedef struct batch_line_struct
+{
+    char        Line[LINESIZE + 1];
+    RESOLVED    r;
+} BATCH_LINE, *PBATCH_LINE;
+
+typedef struct batch_work_struct
+{
+    PBATCH_LINE lines;
+    int         count;
+} BATCH_WORK, *PBATCH_WORK;
+
+/* Does the lookup translate_line() will ask for, on a copy of the line */
+static void
+prefetch_line(PBATCH_LINE bl)
+{
+    char Line[LINESIZE + 1];
+    unsigned int offset;
+    unsigned char ch;
+    char *s, *sep;
+
+    bl->r.valid = 0;
+    strcpy(Line, bl->Line);
+    s = remove_mark(Line);
+    sep = strchr(s, ':');
+    if (!sep)
+        return;
+
+    *sep = ' ';
+    if (sscanf(s, "<%s %x%c", bl->r.path, &offset, &ch) == 3 && (ch == '>' || ch == ' '))
+    {
+        resolve_offset(&bl->r, bl->r.path, offset);
+        bl->r.valid = 1;
+    }
+}
+
+static void *
+prefetch_worker(void *arg)
+{
+    PBATCH_WORK work = (PBATCH_WORK)arg;
+    int i;
+
+    for (i = 0; i < work->count; i++)
+        prefetch_line(&work->lines[i]);
+    return NULL;
+}
+
+/* Reads BATCH_LINES lines at a time, resolves them on the threads and then
+ * translates them in order, so the output is the same as line by line.
+ */
+static int
+translate_batches(FILE *inFile, FILE *outFile, int threads)
+{
+    PBATCH_LINE lines;
+    BATCH_WORK work[MAX_THREADS];
+    pthread_t tid[MAX_THREADS];
+    int started[MAX_THREADS];
+    char path[LINESIZE + 1];
+    char LineOut[LINESIZE + 1];
+    int count, chunk, i, t;
+
+    lines = malloc(BATCH_LINES * sizeof(BATCH_LINE));
+    if (!lines)
+        return 1;
+
+    while (!opt_quit)
+    {
+        for (count = 0; count < BATCH_LINES; count++)
+        {
+            if (fgets(lines[count].Line, LINESIZE, inFile) == NULL)
+                break;
+        }
+        if (!count)
+            break;
+
+        chunk = (count + threads - 1) / threads;
+        for (t = 0; t < threads; t++)
+        {
+            work[t].lines = lines + t * chunk;
+            work[t].count = (t * chunk < count) ? count - t * chunk : 0;
+            if (work[t].count > chunk)
+                work[t].count = chunk;
+            started[t] = t && work[t].count &&
+                         pthread_create(&tid[t], NULL, prefetch_worker, &work[t]) == 0;
+            if (t && !started[t])
+                prefetch_worker(&work[t]);
+        }
+        prefetch_worker(&work[0]);
+        for (t = 1; t < threads; t++)
+        {
+            if (started[t])
+                pthread_join(tid[t], NULL);
+        }
+
+        for (i = 0; i < count && !opt_quit; i++)
+        {
+            summ.lines++;
+            prefetched = &lines[i].r;
+            translate_line(outFile, lines[i].Line, path, LineOut);
+            report(outFile);
+        }
+        prefetched = NULL;
+
+        if (count < BATCH_LINES)
+            break;
+    }
+
+    free(lines);
+    return 0;
+}
+#endif
+
+/* Batches only pay off for a whole log, not for interactive use */
+static int
+translate_threads(FILE *inFile)
+{
+#if defined(_WIN32)
+    return 1;
+#else
+    struct stat st;
+    long cpus;
+
+    if (opt_console || opt_raw || (opt_undo && !opt_redo))
+        return 1;
+    if (opt_threads > 0)
+        return opt_threads < MAX_THREADS ? opt_threads : MAX_THREADS;
+    if (fstat(fileno(inFile), &st) != 0 || !S_ISREG(st.st_mode))
+        return 1;
+
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1)
+        return 1;
+    return cpus < MAX_THREADS ? (int)cpus : MAX_THREADS;
+#endif
+}
+
 static int
 translate_files(FILE *inFile, FILE *outFile)
 {
@@ -418,6 +541,9 @@ translate_files(FILE *inFile, FILE *outFile)
     const char *p     = kdbg_prompt;
     const char *p_eos = p + sizeof(KDBG_PROMPT) - 1; //end of string pos
 
+    double start = now_seconds();
+    int threads = translate_threads(inFile);
+
     memset(Line, '\0', LINESIZE + 1);
     if (opt_console)
     {
@@ -426,6 +552,8 @@ translate_files(FILE *inFile, FILE *outFile)
             if (opt_quit)break;
 
             ch = (unsigned char)c;
+            if (ch == '\n')
+                summ.lines++;
             if (!opt_raw)
             {
                 switch (ch)
@@ -517,12 +645,20 @@ translate_files(FILE *inFile, FILE *outFile)
                 translate_char(c, outFile);
         }
     }
+#if !defined(_WIN32)
+    else if (threads > 1 && translate_batches(inFile, outFile, threads) == 0)
+    {
+        l2l_dbg(1, "Translated using %d threads\n", threads);
+    }
+#endif
     else
     {   // Line by line, slightly faster but less interactive
         while (fgets(Line, LINESIZE, inFile) != NULL)
         {
             if (opt_quit)break;
 
+            summ.lines++;
+
             if (!opt_raw)
             {
                 translate_line(outFile, Line, path, LineOut);
@@ -533,6 +669,7 @@ translate_files(FILE *inFile, FILE *outFile)
         }
     }
 
+    summ.seconds += now_seconds() - start;
     if (opt_stats)
     {
         stat_print(outFile, &summ);
@@ -665,6 +802,7 @@ cleanup:
     }
 
     list_clear(&sources);
+    symidx_clear();
     list_clear(&cache);
 
     return res;
@@ -17,9 +17,10 @@
 #include "log2lines.h"
 #include "options.h"
 
-char *optchars       = "bcd:fFhl:L:mMP:rsS:tTuUvz:";
+char *optchars       = "bcd:fFhj:l:L:mMP:rsS:tTuUvz:";
 int   opt_buffered   = 0;        // -b
 int   opt_help       = 0;        // -h
+int   opt_threads    = 0;        // -j <opt_threads>
 int   opt_force      = 0;        // -f
 int   opt_exit       = 0;        // -e
 int   opt_verbose    = 0;        // -v
@@ -141,6 +142,10 @@ int optionParse(int argc, const char **argv)
             opt_exit++;
             opt_force++;
             break;
+        case 'j':
+            optCount++;
+            opt_threads = atoi(optarg);
+            break;
         case 'l':
             optCount++;
             //just count, see optionInit()
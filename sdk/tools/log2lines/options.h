@@ -10,6 +10,7 @@
 extern char *optchars;
 extern int   opt_buffered;  // -b
 extern int   opt_help;      // -h
+extern int   opt_threads;   // -j <opt_threads>
 extern int   opt_force;     // -f
 extern int   opt_exit;      // -e
 extern int   opt_verbose;   // -v
@@ -29,6 +29,9 @@ stat_print(FILE *outFile, PSUMM psumm)
         clilog(outFile, "Regression candidates:    %d\n", psumm->regfound);
         clilog(outFile, "Offset error:             %d\n", psumm->offset_errors);
         clilog(outFile, "Total:                    %d\n", psumm->total);
+        clilog(outFile, "Lines:                    %d\n", psumm->lines);
+        if (psumm->seconds > 0)
+            clilog(outFile, "Lines per second:         %.0f\n", psumm->lines / psumm->seconds);
         clilog(outFile, "-------------------------------\n");
         clilog(outFile, "Log2lines version: " LOG2LINES_VERSION "\n");
         clilog(outFile, "Directory:         %s\n", opt_dir);
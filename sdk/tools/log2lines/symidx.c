@@ -0,0 +1,258 @@
+/*
+ * ReactOS log2lines
+ *
+ * - In-process symbol index
+ *
+ * Image names from the log are hashed to modules. A module maps only the
+ * .rossym section of its image, located through the cache entry (see
+ * create_cache) or, for caches without that info, the PE headers. All of
+ * this happens once per name, lookups after that are a hash probe and a
+ * binary search. Lookups are safe from several threads.
+ */
+
+#include <errno.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "util.h"
+#include "compat.h"
+#include "options.h"
+#include "image.h"
+#include "log2lines.h"
+#include "symidx.h"
+
+#define SYMIDX_BUCKETS  1024
+
+static PSYM_MODULE buckets[SYMIDX_BUCKETS];
+
+#if defined(_WIN32)
+#define INDEX_LOCK()
+#define INDEX_UNLOCK()
+#else
+static pthread_mutex_t indexLock = PTHREAD_MUTEX_INITIALIZER;
+#define INDEX_LOCK()    pthread_mutex_lock(&indexLock)
+#define INDEX_UNLOCK()  pthread_mutex_unlock(&indexLock)
+#endif
+
+static unsigned int
+hash_name(const char *name)
+{
+    unsigned int hash = 2166136261u;
+
+    while (*name)
+        hash = (hash ^ (unsigned char)tolower((unsigned char)*name++)) * 16777619u;
+    return hash;
+}
+
+static int
+map_rossym(PSYM_MODULE mod, char *path, PLIST_MEMBER pentry)
+{
+    PSYMBOLFILE_HEADER RosSymHeader;
+    struct stat st;
+    size_t SymOffset, SymSize, delta = 0;
+    char *data;
+    int err;
+
+    if (stat(path, &st) != 0)
+    {
+        l2l_dbg(0, "An error occured loading '%s'\n", path);
+        return 1;
+    }
+
+    if (pentry && pentry->SymSize && pentry->FileSize == (size_t)st.st_size)
+    {
+        SymOffset = pentry->SymOffset;
+        SymSize = pentry->SymSize;
+    }
+    else if ((err = get_RosSymInfo(path, &SymOffset, &SymSize)))
+    {
+        if (err == 2)
+            l2l_dbg(0, "Input file is not a PE image.\n")
+        else
+            l2l_dbg(0, "Couldn't find rossym section in executable\n");
+        mod->sym_error = 1;
+        return 2;
+    }
+
+    if (SymSize < sizeof(SYMBOLFILE_HEADER) || SymOffset + SymSize > (size_t)st.st_size)
+    {
+        l2l_dbg(0, "Invalid rossym section in '%s'\n", path);
+        mod->sym_error = 1;
+        return 2;
+    }
+
+#if defined(_WIN32)
+    {
+        FILE *fr;
+
+        data = malloc(SymSize);
+        fr = fopen(path, "rb");
+        if (!data || !fr || fseek(fr, SymOffset, SEEK_SET) || fread(data, 1, SymSize, fr) != SymSize)
+        {
+            l2l_dbg(0, "An error occured loading '%s'\n", path);
+            if (fr)
+                fclose(fr);
+            free(data);
+            return 1;
+        }
+        fclose(fr);
+        mod->map = data;
+        mod->mapSize = SymSize;
+    }
+#else
+    {
+        int fd;
+
+        delta = SymOffset % (size_t)sysconf(_SC_PAGESIZE);
+        fd = open(path, O_RDONLY);
+        data = (fd < 0) ? MAP_FAILED :
+               mmap(NULL, SymSize + delta, PROT_READ, MAP_PRIVATE, fd, SymOffset - delta);
+        if (fd >= 0)
+            close(fd);
+        if (data == MAP_FAILED)
+        {
+            l2l_dbg(0, "An error occured loading '%s' (%s)\n", path, strerror(errno));
+            return 1;
+        }
+        mod->map = data;
+        mod->mapSize = SymSize + delta;
+    }
+#endif
+
+    RosSymHeader = (PSYMBOLFILE_HEADER)(data + delta);
+    if (RosSymHeader->SymbolsOffset > SymSize ||
+        RosSymHeader->SymbolsLength > SymSize - RosSymHeader->SymbolsOffset ||
+        RosSymHeader->StringsOffset > SymSize ||
+        RosSymHeader->StringsLength > SymSize - RosSymHeader->StringsOffset)
+    {
+        l2l_dbg(0, "Invalid rossym section in '%s'\n", path);
+        mod->sym_error = 1;
+        return 2;
+    }
+
+    mod->RosSymHeader = RosSymHeader;
+    return 0;
+}
+
+/* Same resolution as translate_file() always did: an existing file by
+ * that name, otherwise the image cache.
+ */
+static PSYM_MODULE
+create_module(const char *name)
+{
+    PSYM_MODULE mod;
+    PLIST_MEMBER pentry;
+    size_t base = 0;
+    char *path;
+
+    mod = calloc(1, sizeof(SYM_MODULE));
+    if (!mod)
+        return NULL;
+    mod->name = strdup(name);
+    path = convert_path(name);
+    if (!mod->name || !path)
+    {
+        free(path);
+        free(mod->name);
+        free(mod);
+        return NULL;
+    }
+
+    if (get_ImageBase(path, &base))
+    {
+        pentry = entry_lookup(&cache, path);
+        if (pentry)
+        {
+            if (pentry->ImageBase == INVALID_BASE)
+            {
+                l2l_dbg(1, "No, or invalid base address: %s\n", pentry->path);
+                mod->res = 2;
+            }
+            else
+                mod->res = map_rossym(mod, pentry->path, pentry);
+        }
+        else
+        {
+            l2l_dbg(1, "Not found in cache: %s\n", path);
+            mod->res = 3;
+        }
+    }
+    else
+        mod->res = map_rossym(mod, path, NULL);
+
+    free(path);
+    return mod;
+}
+
+PSYM_MODULE
+symidx_lookup(const char *name)
+{
+    unsigned int bucket = hash_name(name) % SYMIDX_BUCKETS;
+    PSYM_MODULE mod;
+
+    INDEX_LOCK();
+    for (mod = buckets[bucket]; mod; mod = mod->pnext)
+    {
+        if (PATHCMP(mod->name, name) == 0)
+            break;
+    }
+    if (!mod && (mod = create_module(name)))
+    {
+        mod->pnext = buckets[bucket];
+        buckets[bucket] = mod;
+    }
+    INDEX_UNLOCK();
+
+    return mod;
+}
+
+PROSSYM_ENTRY
+symidx_find(PSYM_MODULE mod, size_t offset)
+{
+    if (mod->res)
+        return NULL;
+    return find_offset(mod->RosSymHeader, offset);
+}
+
+char *
+symidx_strings(PSYM_MODULE mod)
+{
+    return (char *)mod->RosSymHeader + mod->RosSymHeader->StringsOffset;
+}
+
+void
+symidx_clear(void)
+{
+    PSYM_MODULE mod, pnext;
+    int i;
+
+    for (i = 0; i < SYMIDX_BUCKETS; i++)
+    {
+        for (mod = buckets[i]; mod; mod = pnext)
+        {
+            pnext = mod->pnext;
+            if (mod->map)
+            {
+#if defined(_WIN32)
+                free(mod->map);
+#else
+                munmap(mod->map, mod->mapSize);
+#endif
+            }
+            free(mod->name);
+            free(mod);
+        }
+        buckets[i] = NULL;
+    }
+}
+
+/* EOF */
@@ -0,0 +1,30 @@
+/*
+ * ReactOS log2lines
+ *
+ * - In-process symbol index
+ */
+
+#pragma once
+
+#include <rsym.h>
+
+/* One per image name seen in the log. The .rossym data is mapped the
+ * first time the name is looked up and stays mapped until exit.
+ */
+typedef struct sym_module_struct
+{
+    char *name;             // as it appears in the log
+    int res;                // translate_file() result when not usable
+    int sym_error;          // res is an offset error (no/bad .rossym)
+    void *map;
+    size_t mapSize;
+    PSYMBOLFILE_HEADER RosSymHeader;
+    struct sym_module_struct *pnext;
+} SYM_MODULE, *PSYM_MODULE;
+
+PSYM_MODULE symidx_lookup(const char *name);
+PROSSYM_ENTRY symidx_find(PSYM_MODULE mod, size_t offset);
+char *symidx_strings(PSYM_MODULE mod);
+void symidx_clear(void);
+
+/* EOF */
@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <sys/time.h>
 
 #include "config.h"
 #include "compat.h"
@@ -162,29 +163,60 @@ isOffset(const char *a)
 int
 copy_file(char *src, char *dst)
 {
-    char Line[LINESIZE];
+    char Buffer[0x10000];
+    FILE *fr, *fw;
+    size_t len;
+    int res = 0;
 
-    sprintf(Line, CP_FMT, src, dst);
-    l2l_dbg(2, "Executing: %s\n", Line);
+    l2l_dbg(2, "Copying %s to %s\n", src, dst);
     remove(dst);
     if (file_exists(dst))
     {
         l2l_dbg(0, "Cannot remove dst %s before copy\n", dst);
         return 1;
     }
-    if (system(Line) < 0)
+
+    if ((fr = fopen(src, "rb")) == NULL)
     {
-        l2l_dbg(0, "Cannot copy %s to %s\n", src, dst);
-        l2l_dbg(1, "Failed to execute: '%s'\n", Line);
+        l2l_dbg(0, "Cannot copy %s to %s (%s)\n", src, dst, strerror(errno));
         return 2;
     }
-
-    if (!file_exists(dst))
+    if ((fw = fopen(dst, "wb")) == NULL)
     {
-        l2l_dbg(0, "Dst %s does not exist after copy\n", dst);
+        l2l_dbg(0, "Cannot copy %s to %s (%s)\n", src, dst, strerror(errno));
+        fclose(fr);
         return 2;
     }
-    return 0;
+
+    while ((len = fread(Buffer, 1, sizeof(Buffer), fr)) > 0)
+    {
+        if (fwrite(Buffer, 1, len, fw) != len)
+        {
+            res = 2;
+            break;
+        }
+    }
+    if (ferror(fr))
+        res = 2;
+    fclose(fr);
+    if (fclose(fw) != 0)
+        res = 2;
+
+    if (res)
+    {
+        l2l_dbg(0, "Cannot copy %s to %s\n", src, dst);
+        remove(dst);
+    }
+    return res;
+}
+
+double
+now_seconds(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
 }
 
 /* EOF */
@@ -1,5 +1,5 @@
 /*
- * Usage: rsym input-file output-file
+ * Usage: rsym [-p] [-s sources] input-file output-file
  *
  * There are two sources of information: the .stab/.stabstr
  * sections of the executable and the COFF symbol table. Most
@@ -9,7 +9,12 @@
  * .stab section. They are present in the COFF symbol table.
  * So, we mostly use the .stab/.stabstr sections, but we augment
  * the info there with info from the COFF symbol table when
- * possible.
+ * possible. With -p the COFF symbols are converted on a second
+ * thread while the stabs are.
+ *
+ * The symbols are written sorted by address, preceded by an index
+ * of the first symbol in each fixed size address range (see
+ * SYMBOLFILE_INDEX) so lookups don't need to search all of them.
  *
  * This is a tool and is compiled using the host compiler,
  * i.e. on Linux gcc and not mingw-gcc (cross-compiler).
@@ -28,22 +33,41 @@
 #include <assert.h>
 #include <wchar.h>
 
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+
 #include "rsym.h"
 
 #define MAX_PATH 260
 #define MAX_SYM_NAME 2000
+#define STRING_ENTRY_BLOCK 4096
 
 struct StringEntry
 {
     struct StringEntry *Next;
+    unsigned int Hash;
     ULONG Offset;
-    char *String;
 };
 
+struct StringEntryBlock
+{
+    struct StringEntryBlock *Next;
+    struct StringEntry Entries[STRING_ENTRY_BLOCK];
+    ULONG Used;
+};
+
+/* Strings are appended to StringsBase, which the caller sized for the worst
+ * case. The table doubles whenever it holds more entries than buckets, so
+ * it can be shared by all conversions instead of being rebuilt for each. */
 struct StringHashTable
 {
     ULONG TableSize;
+    ULONG EntryCount;
     struct StringEntry **Table;
+    struct StringEntryBlock *Blocks;
+    char *StringsBase;
+    ULONG StringsLength;
 };
 
 /* This is the famous DJB hash */
@@ -61,78 +85,177 @@ ComputeDJBHash(const char *name)
     return val;
 }
 
-static void
+static int
+GrowStringHashTable(struct StringHashTable *StringTable)
+{
+    ULONG NewSize = StringTable->TableSize * 2;
+    struct StringEntry **NewTable, *entry, *next;
+    ULONG i;
+
+    NewTable = calloc(NewSize, sizeof(struct StringEntry *));
+    if (!NewTable)
+        return 1;
+
+    for (i = 0; i < StringTable->TableSize; i++)
+    {
+        for (entry = StringTable->Table[i]; entry; entry = next)
+        {
+            next = entry->Next;
+            entry->Next = NewTable[entry->Hash & (NewSize - 1)];
+            NewTable[entry->Hash & (NewSize - 1)] = entry;
+        }
+    }
+
+    free(StringTable->Table);
+    StringTable->Table = NewTable;
+    StringTable->TableSize = NewSize;
+    return 0;
+}
+
+static int
 AddStringToHash(struct StringHashTable *StringTable,
                 unsigned int hash,
-                ULONG Offset,
-                char *StringPtr)
+                ULONG Offset)
 {
-    struct StringEntry *entry = calloc(1, sizeof(struct StringEntry));
+    struct StringEntryBlock *block = StringTable->Blocks;
+    struct StringEntry *entry;
+
+    if (!block || block->Used == STRING_ENTRY_BLOCK)
+    {
+        block = malloc(sizeof(struct StringEntryBlock));
+        if (!block)
+            return 1;
+        block->Next = StringTable->Blocks;
+        block->Used = 0;
+        StringTable->Blocks = block;
+    }
+
+    entry = &block->Entries[block->Used++];
+    entry->Hash = hash;
     entry->Offset = Offset;
-    entry->String = StringPtr;
-    entry->Next = StringTable->Table[hash];
-    StringTable->Table[hash] = entry;
+    entry->Next = StringTable->Table[hash & (StringTable->TableSize - 1)];
+    StringTable->Table[hash & (StringTable->TableSize - 1)] = entry;
+
+    if (++StringTable->EntryCount > StringTable->TableSize)
+        return GrowStringHashTable(StringTable);
+    return 0;
 }
 
-static void
+static int
 StringHashTableInit(struct StringHashTable *StringTable,
                     ULONG StringsLength,
                     char *StringsBase)
 {
     char *Start = StringsBase;
     char *End = StringsBase + StringsLength;
+
     StringTable->TableSize = 1024;
-    StringTable->Table = calloc(1024, sizeof(struct StringEntry *));
+    StringTable->EntryCount = 0;
+    StringTable->Blocks = NULL;
+    StringTable->StringsBase = StringsBase;
+    StringTable->StringsLength = StringsLength;
+    StringTable->Table = calloc(StringTable->TableSize, sizeof(struct StringEntry *));
+    if (!StringTable->Table)
+        return 1;
+
     while (Start < End)
     {
-        AddStringToHash(StringTable,
-                        ComputeDJBHash(Start) % StringTable->TableSize,
-                        Start - StringsBase,
-                        Start);
+        if (AddStringToHash(StringTable, ComputeDJBHash(Start), Start - StringsBase))
+            return 1;
         Start += strlen(Start) + 1;
     }
+
+    return 0;
 }
 
 static void
 StringHashTableFree(struct StringHashTable *StringTable)
 {
-    int i;
-    struct StringEntry *entry;
-    for (i = 0; i < StringTable->TableSize; i++)
+    struct StringEntryBlock *block;
+
+    while ((block = StringTable->Blocks))
     {
-        while ((entry = StringTable->Table[i]))
-        {
-            entry = entry->Next;
-            free(StringTable->Table[i]);
-            StringTable->Table[i] = entry;
-        }
+        StringTable->Blocks = block->Next;
+        free(block);
     }
     free(StringTable->Table);
+    StringTable->Table = NULL;
 }
 
+/* Symbols are ordered by address, entries without a line number go after
+ * the ones with a line number at the same address. */
 static int
-CompareSymEntry(const PROSSYM_ENTRY SymEntry1, const PROSSYM_ENTRY SymEntry2)
+SymEntryAfter(const ROSSYM_ENTRY *SymEntry1, const ROSSYM_ENTRY *SymEntry2)
 {
-    if (SymEntry1->Address < SymEntry2->Address)
+    if (SymEntry1->Address != SymEntry2->Address)
     {
-        return -1;
+        return SymEntry2->Address < SymEntry1->Address;
     }
 
-    if (SymEntry2->Address < SymEntry1->Address)
+    return SymEntry1->SourceLine == 0 && SymEntry2->SourceLine != 0;
+}
+
+/* Stable LSD radix sort in the order above. The first pass splits on the
+ * line number, the address bytes follow from least significant up; bytes
+ * that are the same for all symbols (the high ones, usually) are skipped. */
+static int
+SortSymbols(PROSSYM_ENTRY Symbols, ULONG Count)
+{
+    ULONG Histogram[sizeof(TARGET_ULONG_PTR)][256];
+    PROSSYM_ENTRY Temp, Src, Dst, Swap;
+    ULONG i, Pass, Digit, Sum, Lines, Bare;
+
+    if (Count < 2)
+        return 0;
+
+    Temp = malloc(Count * sizeof(ROSSYM_ENTRY));
+    if (Temp == NULL)
     {
-        return +1;
+        fprintf(stderr, "Unable to allocate memory for sorting symbols\n");
+        return 1;
     }
 
-    if (SymEntry2->SourceLine == 0)
+    memset(Histogram, 0, sizeof(Histogram));
+    Lines = 0;
+    for (i = 0; i < Count; i++)
     {
-        return -1;
+        for (Pass = 0; Pass < sizeof(TARGET_ULONG_PTR); Pass++)
+            Histogram[Pass][(Symbols[i].Address >> (Pass * 8)) & 0xff]++;
+        if (Symbols[i].SourceLine != 0)
+            Lines++;
     }
 
-    if (SymEntry1->SourceLine == 0)
+    Src = Symbols;
+    Dst = Temp;
+    if (Lines != 0 && Lines != Count)
     {
-        return +1;
+        Bare = Lines;
+        Lines = 0;
+        for (i = 0; i < Count; i++)
+            Dst[Src[i].SourceLine != 0 ? Lines++ : Bare++] = Src[i];
+        Swap = Src; Src = Dst; Dst = Swap;
     }
 
+    for (Pass = 0; Pass < sizeof(TARGET_ULONG_PTR); Pass++)
+    {
+        if (Histogram[Pass][(Src[0].Address >> (Pass * 8)) & 0xff] == Count)
+            continue;
+
+        for (Sum = 0, Digit = 0; Digit < 256; Digit++)
+        {
+            i = Histogram[Pass][Digit];
+            Histogram[Pass][Digit] = Sum;
+            Sum += i;
+        }
+        for (i = 0; i < Count; i++)
+            Dst[Histogram[Pass][(Src[i].Address >> (Pass * 8)) & 0xff]++] = Src[i];
+        Swap = Src; Src = Dst; Dst = Swap;
+    }
+
+    if (Src != Symbols)
+        memcpy(Symbols, Src, Count * sizeof(ROSSYM_ENTRY));
+    free(Temp);
+
     return 0;
 }
 
@@ -198,38 +321,41 @@ GetCoffInfo(void *FileData, PIMAGE_FILE_HEADER PEFileHeader,
     return 0;
 }
 
-static ULONG
+static int
 FindOrAddString(struct StringHashTable *StringTable,
                 char *StringToFind,
-                ULONG *StringsLength,
-                void *StringsBase)
+                ULONG *Offset)
 {
-    unsigned int hash = ComputeDJBHash(StringToFind) % StringTable->TableSize;
-    struct StringEntry *entry = StringTable->Table[hash];
+    unsigned int hash = ComputeDJBHash(StringToFind);
+    struct StringEntry *entry = StringTable->Table[hash & (StringTable->TableSize - 1)];
+    ULONG Length;
 
-    while (entry && strcmp(entry->String, StringToFind))
+    while (entry && (entry->Hash != hash ||
+                     strcmp(StringTable->StringsBase + entry->Offset, StringToFind)))
         entry = entry->Next;
 
     if (entry)
     {
-        return entry->Offset;
+        *Offset = entry->Offset;
+        return 0;
     }
-    else
-    {
-        char *End = (char *)StringsBase + *StringsLength;
 
-        strcpy(End, StringToFind);
-        *StringsLength += strlen(StringToFind) + 1;
+    Length = strlen(StringToFind) + 1;
+    *Offset = StringTable->StringsLength;
+    memcpy(StringTable->StringsBase + *Offset, StringToFind, Length);
+    StringTable->StringsLength += Length;
 
-        AddStringToHash(StringTable, hash, End - (char *)StringsBase, End);
-
-        return End - (char *)StringsBase;
+    if (AddStringToHash(StringTable, hash, *Offset))
+    {
+        fprintf(stderr, "Unable to allocate memory for the string table\n");
+        return 1;
     }
+    return 0;
 }
 
 static int
 ConvertStabs(ULONG *SymbolsCount, PROSSYM_ENTRY *SymbolsBase,
-             ULONG *StringsLength, void *StringsBase,
+             struct StringHashTable *StringTable,
              ULONG StabSymbolsLength, void *StabSymbolsBase,
              ULONG StabStringsLength, void *StabStringsBase,
              ULONG_PTR ImageBase, PIMAGE_FILE_HEADER PEFileHeader,
@@ -243,7 +369,6 @@ ConvertStabs(ULONG *SymbolsCount, PROSSYM_ENTRY *SymbolsBase,
     ULONG NameLen;
     char FuncName[256];
     PROSSYM_ENTRY Current;
-    struct StringHashTable StringHash;
 
     StabEntry = StabSymbolsBase;
     Count = StabSymbolsLength / sizeof(STAB_ENTRY);
@@ -265,8 +390,6 @@ ConvertStabs(ULONG *SymbolsCount, PROSSYM_ENTRY *SymbolsBase,
     Current = *SymbolsBase;
     memset(Current, 0, sizeof(*Current));
 
-    StringHashTableInit(&StringHash, *StringsLength, (char *)StringsBase);
-
     LastFunctionAddress = 0;
     for (i = 0; i < Count; i++)
     {
@@ -302,10 +425,13 @@ ConvertStabs(ULONG *SymbolsCount, PROSSYM_ENTRY *SymbolsBase,
                         First = 0;
                     Current->Address = Address;
                 }
-                Current->FileOffset = FindOrAddString(&StringHash,
-                                                      (char *)StabStringsBase + StabEntry[i].n_strx,
-                                                      StringsLength,
-                                                      StringsBase);
+                if (FindOrAddString(StringTable,
+                                    (char *)StabStringsBase + StabEntry[i].n_strx,
+                                    &Current->FileOffset))
+                {
+                    free(*SymbolsBase);
+                    return 1;
+                }
                 break;
             case N_FUN:
                 if (StabEntry[i].n_desc == 0 || StabEntry[i].n_value < ImageBase)
@@ -332,10 +458,11 @@ ConvertStabs(ULONG *SymbolsCount, PROSSYM_ENTRY *SymbolsBase,
                 }
                 memcpy(FuncName, Name, NameLen);
                 FuncName[NameLen] = '\0';
-                Current->FunctionOffset = FindOrAddString(&StringHash,
-                                                          FuncName,
-                                                          StringsLength,
-                                                          StringsBase);
+                if (FindOrAddString(StringTable, FuncName, &Current->FunctionOffset))
+                {
+                    free(*SymbolsBase);
+                    return 1;
+                }
                 Current->SourceLine = 0;
                 LastFunctionAddress = Address;
                 break;
@@ -360,16 +487,18 @@ ConvertStabs(ULONG *SymbolsCount, PROSSYM_ENTRY *SymbolsBase,
     }
     *SymbolsCount = (Current - *SymbolsBase + 1);
 
-    qsort(*SymbolsBase, *SymbolsCount, sizeof(ROSSYM_ENTRY), (int (*)(const void *, const void *)) CompareSymEntry);
-
-    StringHashTableFree(&StringHash);
+    if (SortSymbols(*SymbolsBase, *SymbolsCount))
+    {
+        free(*SymbolsBase);
+        return 1;
+    }
 
     return 0;
 }
 
 static int
 ConvertCoffs(ULONG *SymbolsCount, PROSSYM_ENTRY *SymbolsBase,
-             ULONG *StringsLength, void *StringsBase,
+             struct StringHashTable *StringTable,
              ULONG CoffSymbolsLength, void *CoffSymbolsBase,
              ULONG CoffStringsLength, void *CoffStringsBase,
              ULONG_PTR ImageBase, PIMAGE_FILE_HEADER PEFileHeader,
@@ -380,12 +509,12 @@ ConvertCoffs(ULONG *SymbolsCount, PROSSYM_ENTRY *SymbolsBase,
     char FuncName[256], FileName[1024];
     char *p;
     PROSSYM_ENTRY Current;
-    struct StringHashTable StringHash;
 
     CoffEntry = (PCOFF_SYMENT) CoffSymbolsBase;
     Count = CoffSymbolsLength / sizeof(COFF_SYMENT);
 
-    *SymbolsBase = malloc(Count * sizeof(ROSSYM_ENTRY));
+    /* One more for the terminating empty entry */
+    *SymbolsBase = malloc((Count + 1) * sizeof(ROSSYM_ENTRY));
     if (*SymbolsBase == NULL)
     {
         fprintf(stderr, "Unable to allocate memory for converted COFF symbols\n");
@@ -393,8 +522,7 @@ ConvertCoffs(ULONG *SymbolsCount, PROSSYM_ENTRY *SymbolsBase,
     }
     *SymbolsCount = 0;
     Current = *SymbolsBase;
-
-    StringHashTableInit(&StringHash, *StringsLength, (char*)StringsBase);
+    memset(Current, 0, sizeof(*Current));
 
     for (i = 0; i < Count; i++)
     {
@@ -421,7 +549,6 @@ ConvertCoffs(ULONG *SymbolsCount, PROSSYM_ENTRY *SymbolsBase,
                 {
                     free(*SymbolsBase);
                     fprintf(stderr, "Function name too long\n");
-                    StringHashTableFree(&StringHash);
                     return 1;
                 }
                 strcpy(FuncName, (char *) CoffStringsBase + CoffEntry[i].e.e.e_offset);
@@ -439,10 +566,11 @@ ConvertCoffs(ULONG *SymbolsCount, PROSSYM_ENTRY *SymbolsBase,
                 *p = '\0';
             }
             p = ('_' == FuncName[0] || '@' == FuncName[0] ? FuncName + 1 : FuncName);
-            Current->FunctionOffset = FindOrAddString(&StringHash,
-                                                      p,
-                                                      StringsLength,
-                                                      StringsBase);
+            if (FindOrAddString(StringTable, p, &Current->FunctionOffset))
+            {
+                free(*SymbolsBase);
+                return 1;
+            }
             Current->SourceLine = 0;
             memset(++Current, 0, sizeof(*Current));
         }
@@ -451,9 +579,12 @@ ConvertCoffs(ULONG *SymbolsCount, PROSSYM_ENTRY *SymbolsBase,
     }
 
     *SymbolsCount = (Current - *SymbolsBase + 1);
-    qsort(*SymbolsBase, *SymbolsCount, sizeof(ROSSYM_ENTRY), (int (*)(const void *, const void *)) CompareSymEntry);
 
-    StringHashTableFree(&StringHash);
+    if (SortSymbols(*SymbolsBase, *SymbolsCount))
+    {
+        free(*SymbolsBase);
+        return 1;
+    }
 
     return 0;
 }
@@ -707,9 +838,7 @@ ConvertDbgHelp(void *process, DWORD module_base, char *SourcePath,
     free(strtab.LineEntryData);
     free(strtab.PathChop);
 
-    qsort(*SymbolsBase, *SymbolsCount, sizeof(ROSSYM_ENTRY), (int (*)(const void *, const void *))CompareSymEntry);
-
-    return 0;
+    return SortSymbols(*SymbolsBase, *SymbolsCount);
 }
 
 static int
@@ -718,7 +847,7 @@ MergeStabsAndCoffs(ULONG *MergedSymbolCount, PROSSYM_ENTRY *MergedSymbols,
                    ULONG CoffSymbolsCount, PROSSYM_ENTRY CoffSymbols)
 {
     ULONG StabIndex, j;
-    ULONG CoffIndex;
+    ULONG CoffIndex, CoffKept;
     ULONG_PTR StabFunctionStartAddress;
     ULONG StabFunctionStringOffset, NewStabFunctionStringOffset, CoffFunctionStringOffset;
     PROSSYM_ENTRY CoffFunctionSymbol;
@@ -788,18 +917,27 @@ MergeStabsAndCoffs(ULONG *MergedSymbolCount, PROSSYM_ENTRY *MergedSymbols,
         StabFunctionStringOffset = NewStabFunctionStringOffset;
         (*MergedSymbolCount)++;
     }
-    /* Handle functions that have no analog in the upstream data */
+    /* Handle functions that have no analog in the upstream data. Both lists
+       are sorted, so merge them from the back instead of sorting again */
+    CoffKept = 0;
     for (CoffIndex = 0; CoffIndex < CoffSymbolsCount; CoffIndex++)
     {
         if (CoffSymbols[CoffIndex].Address &&
             CoffSymbols[CoffIndex].FunctionOffset)
         {
-            (*MergedSymbols)[*MergedSymbolCount] = CoffSymbols[CoffIndex];
-            (*MergedSymbolCount)++;
+            CoffSymbols[CoffKept++] = CoffSymbols[CoffIndex];
         }
     }
 
-    qsort(*MergedSymbols, *MergedSymbolCount, sizeof(ROSSYM_ENTRY), (int (*)(const void *, const void *)) CompareSymEntry);
+    j = *MergedSymbolCount;
+    *MergedSymbolCount += CoffKept;
+    for (StabIndex = *MergedSymbolCount; CoffKept != 0; )
+    {
+        if (j != 0 && SymEntryAfter(&(*MergedSymbols)[j - 1], &CoffSymbols[CoffKept - 1]))
+            (*MergedSymbols)[--StabIndex] = (*MergedSymbols)[--j];
+        else
+            (*MergedSymbols)[--StabIndex] = CoffSymbols[--CoffKept];
+    }
 
     return 0;
 }
@@ -1227,6 +1365,106 @@ CreateOutputFile(FILE *OutFile, void *InData,
     return 0;
 }
 
+/* Aim for this many symbols per bucket of the address index */
+#define INDEX_BUCKET_SYMBOLS 4
+
+static int
+CreateAddressIndex(ULONG *IndexLength, PSYMBOLFILE_INDEX *Index,
+                   ULONG SymbolsCount, PROSSYM_ENTRY Symbols)
+{
+    TARGET_ULONG_PTR MaxAddress = Symbols[SymbolsCount - 1].Address;
+    ULONG Buckets = SymbolsCount / INDEX_BUCKET_SYMBOLS;
+    ULONG Shift, Bucket, i;
+
+    if (Buckets == 0)
+        Buckets = 1;
+    for (Shift = 4; (MaxAddress >> Shift) >= Buckets; Shift++);
+
+    /* Keep the symbols that follow 64-bit aligned */
+    *IndexLength = ROUND_UP(FIELD_OFFSET(SYMBOLFILE_INDEX, FirstEntry) +
+                            ((MaxAddress >> Shift) + 2) * sizeof(ULONG), 8);
+    *Index = calloc(1, *IndexLength);
+    if (*Index == NULL)
+    {
+        fprintf(stderr, "Unable to allocate memory for the address index\n");
+        return 1;
+    }
+
+    (*Index)->Magic = SYMBOLFILE_INDEX_MAGIC;
+    (*Index)->Shift = Shift;
+    (*Index)->BucketCount = (ULONG)(MaxAddress >> Shift) + 1;
+
+    for (Bucket = 0, i = 0; Bucket <= (*Index)->BucketCount; Bucket++)
+    {
+        while (i < SymbolsCount && (Symbols[i].Address >> Shift) < Bucket)
+            i++;
+        (*Index)->FirstEntry[Bucket] = i;
+    }
+
+    return 0;
+}
+
+struct CoffConversion
+{
+    PROSSYM_ENTRY Symbols;
+    struct StringHashTable *StringTable;
+    void *CoffBase;
+    void *CoffStringBase;
+    ULONG_PTR ImageBase;
+    PIMAGE_FILE_HEADER PEFileHeader;
+    PIMAGE_SECTION_HEADER PESectionHeaders;
+    ULONG SymbolsCount;
+    ULONG CoffsLength;
+    ULONG CoffStringsLength;
+    int Result;
+};
+
+static void *
+CoffConversionThread(void *Context)
+{
+    struct CoffConversion *Conversion = Context;
+
+    Conversion->Result = ConvertCoffs(&Conversion->SymbolsCount,
+                                      &Conversion->Symbols,
+                                      Conversion->StringTable,
+                                      Conversion->CoffsLength,
+                                      Conversion->CoffBase,
+                                      Conversion->CoffStringsLength,
+                                      Conversion->CoffStringBase,
+                                      Conversion->ImageBase,
+                                      Conversion->PEFileHeader,
+                                      Conversion->PESectionHeaders);
+    return NULL;
+}
+
+/* Moves the strings of a COFF conversion that ran on its own string table
+ * into the main one. Adding them in their original order gives the same
+ * table as converting against the main table directly. */
+static int
+MergeCoffStrings(struct StringHashTable *StringTable, struct CoffConversion *Conversion)
+{
+    char *Start = Conversion->StringTable->StringsBase;
+    char *End = Start + Conversion->StringTable->StringsLength;
+    ULONG Offset, i;
+
+    for (; Start < End; Start += strlen(Start) + 1)
+    {
+        if (FindOrAddString(StringTable, Start, &Offset))
+            return 1;
+    }
+
+    for (i = 0; i < Conversion->SymbolsCount; i++)
+    {
+        if (FindOrAddString(StringTable,
+                            Conversion->StringTable->StringsBase + Conversion->Symbols[i].FunctionOffset,
+                            &Conversion->Symbols[i].FunctionOffset))
+            return 1;
+    }
+
+    Conversion->StringTable = StringTable;
+    return 0;
+}
+
 int main(int argc, char* argv[])
 {
     PSYMBOLFILE_HEADER SymbolFileHeader;
@@ -1254,6 +1492,12 @@ int main(int argc, char* argv[])
     PROSSYM_ENTRY CoffSymbols = NULL;
     ULONG MergedSymbolsCount = 0;
     PROSSYM_ENTRY MergedSymbols = NULL;
+    ULONG CoffStringsCapacity;
+    char *CoffStringsBuffer = NULL;
+    struct StringHashTable StringTable, CoffStringTable;
+    struct CoffConversion Coff = { 0 };
+    ULONG IndexLength;
+    PSYMBOLFILE_INDEX Index;
     size_t FileSize;
     void *FileData;
     ULONG RosSymLength;
@@ -1264,6 +1508,11 @@ int main(int argc, char* argv[])
     BOOLEAN UseDbgHelp = FALSE;
     int arg, argstate = 0;
     char *SourcePath = NULL;
+    BOOLEAN Parallel = FALSE;
+#if !defined(_WIN32)
+    pthread_t CoffThread;
+    BOOLEAN CoffThreadStarted = FALSE;
+#endif
 
     for (arg = 1; arg < argc; arg++)
     {
@@ -1278,6 +1527,10 @@ int main(int argc, char* argv[])
                 {
                     argstate = 1;
                 }
+                else if (!strcmp(argv[arg], "-p"))
+                {
+                    Parallel = TRUE;
+                }
                 else
                 {
                     argstate = 2;
@@ -1300,7 +1553,7 @@ int main(int argc, char* argv[])
 
     if (argstate != 3)
     {
-        fprintf(stderr, "Usage: rsym [-s <sources>] <input> <output>\n");
+        fprintf(stderr, "Usage: rsym [-p] [-s <sources>] <input> <output>\n");
         exit(1);
     }
 
@@ -1350,6 +1603,50 @@ int main(int argc, char* argv[])
         exit(1);
     }
 
+    if (GetCoffInfo(FileData,
+                    PEFileHeader,
+                    PESectionHeaders,
+                    &CoffsLength,
+                    &CoffBase,
+                    &CoffStringsLength,
+                    &CoffStringBase))
+    {
+        free(FileData);
+        exit(1);
+    }
+
+    /* Every COFF symbol adds at most its short name or its entry in the
+       COFF string table */
+    CoffStringsCapacity = 1 + CoffStringsLength +
+                          (CoffsLength / sizeof(COFF_SYMENT)) * (E_SYMNMLEN + 1);
+
+    Coff.CoffsLength = CoffsLength;
+    Coff.CoffBase = CoffBase;
+    Coff.CoffStringsLength = CoffStringsLength;
+    Coff.CoffStringBase = CoffStringBase;
+    Coff.ImageBase = ImageBase;
+    Coff.PEFileHeader = PEFileHeader;
+    Coff.PESectionHeaders = PESectionHeaders;
+    Coff.StringTable = &StringTable;
+
+    /* The COFF symbols are converted next to the stabs or the DbgHelp line
+       info, against a string table of their own that is merged afterwards */
+    if (Parallel && CoffsLength != 0)
+    {
+        CoffStringsBuffer = malloc(CoffStringsCapacity);
+        if (CoffStringsBuffer == NULL ||
+            StringHashTableInit(&CoffStringTable, 1, memset(CoffStringsBuffer, 0, 1)))
+        {
+            free(FileData);
+            fprintf(stderr, "Failed to allocate memory for strings table\n");
+            exit(1);
+        }
+        Coff.StringTable = &CoffStringTable;
+#if !defined(_WIN32)
+        CoffThreadStarted = !pthread_create(&CoffThread, NULL, CoffConversionThread, &Coff);
+#endif
+    }
+
     if (StabsLength == 0)
     {
         // SYMOPT_AUTO_PUBLICS
@@ -1378,22 +1675,9 @@ int main(int argc, char* argv[])
         SymCleanup(FileData);
     }
 
-    if (GetCoffInfo(FileData,
-                    PEFileHeader,
-                    PESectionHeaders,
-                    &CoffsLength,
-                    &CoffBase,
-                    &CoffStringsLength,
-                    &CoffStringBase))
-    {
-        free(FileData);
-        exit(1);
-    }
-
     if (!UseDbgHelp)
     {
-        StringBase = malloc(1 + StringsLength + CoffStringsLength +
-                            (CoffsLength / sizeof(ROSSYM_ENTRY)) * (E_SYMNMLEN + 1));
+        StringBase = malloc(1 + StabStringsLength + CoffStringsCapacity);
         if (StringBase == NULL)
         {
             free(FileData);
@@ -1403,11 +1687,31 @@ int main(int argc, char* argv[])
         /* Make offset 0 into an empty string */
         *((char *) StringBase) = '\0';
         StringsLength = 1;
+    }
+    else
+    {
+        StringBase = realloc(StringBase, StringsLength + CoffStringsCapacity);
+        if (!StringBase)
+        {
+            free(FileData);
+            fprintf(stderr, "Failed to allocate memory for strings table\n");
+            exit(1);
+        }
+    }
 
+    if (StringHashTableInit(&StringTable, StringsLength, StringBase))
+    {
+        free(StringBase);
+        free(FileData);
+        fprintf(stderr, "Failed to allocate memory for strings table\n");
+        exit(1);
+    }
+
+    if (!UseDbgHelp)
+    {
         if (ConvertStabs(&StabSymbolsCount,
                          &StabSymbols,
-                         &StringsLength,
-                         StringBase,
+                         &StringTable,
                          StabsLength,
                          StabBase,
                          StabStringsLength,
@@ -1418,32 +1722,31 @@ int main(int argc, char* argv[])
         {
             free(StringBase);
             free(FileData);
-            fprintf(stderr, "Failed to allocate memory for strings table\n");
+            fprintf(stderr, "Failed to convert .stab symbols\n");
             exit(1);
         }
     }
+
+#if !defined(_WIN32)
+    if (CoffThreadStarted)
+        pthread_join(CoffThread, NULL);
     else
+#endif
+        CoffConversionThread(&Coff);
+
+    if (Coff.Result == 0 && Coff.StringTable != &StringTable)
     {
-        StringBase = realloc(StringBase, StringsLength + CoffStringsLength);
-        if (!StringBase)
-        {
-            free(FileData);
-            fprintf(stderr, "Failed to allocate memory for strings table\n");
-            exit(1);
-        }
+        Coff.Result = MergeCoffStrings(&StringTable, &Coff);
+        StringHashTableFree(&CoffStringTable);
+        free(CoffStringsBuffer);
     }
 
-    if (ConvertCoffs(&CoffSymbolsCount,
-                     &CoffSymbols,
-                     &StringsLength,
-                     StringBase,
-                     CoffsLength,
-                     CoffBase,
-                     CoffStringsLength,
-                     CoffStringBase,
-                     ImageBase,
-                     PEFileHeader,
-                     PESectionHeaders))
+    CoffSymbolsCount = Coff.SymbolsCount;
+    CoffSymbols = Coff.Symbols;
+    StringsLength = StringTable.StringsLength;
+    StringHashTableFree(&StringTable);
+
+    if (Coff.Result)
     {
         if (StabSymbols)
         {
@@ -1489,13 +1792,23 @@ int main(int argc, char* argv[])
     }
     else
     {
+        if (CreateAddressIndex(&IndexLength, &Index, MergedSymbolsCount, MergedSymbols))
+        {
+            free(MergedSymbols);
+            free(StringBase);
+            free(FileData);
+            exit(1);
+        }
+
         RosSymLength = sizeof(SYMBOLFILE_HEADER) +
+                       IndexLength +
                        MergedSymbolsCount * sizeof(ROSSYM_ENTRY) +
                        StringsLength;
 
         RosSymSection = malloc(RosSymLength);
         if (RosSymSection == NULL)
         {
+            free(Index);
             free(MergedSymbols);
             free(StringBase);
             free(FileData);
@@ -1505,12 +1818,14 @@ int main(int argc, char* argv[])
         memset(RosSymSection, '\0', RosSymLength);
 
         SymbolFileHeader = (PSYMBOLFILE_HEADER)RosSymSection;
-        SymbolFileHeader->SymbolsOffset = sizeof(SYMBOLFILE_HEADER);
+        SymbolFileHeader->SymbolsOffset = sizeof(SYMBOLFILE_HEADER) + IndexLength;
         SymbolFileHeader->SymbolsLength = MergedSymbolsCount * sizeof(ROSSYM_ENTRY);
         SymbolFileHeader->StringsOffset = SymbolFileHeader->SymbolsOffset +
                                           SymbolFileHeader->SymbolsLength;
         SymbolFileHeader->StringsLength = StringsLength;
 
+        memcpy(SymbolFileHeader + 1, Index, IndexLength);
+
         memcpy((char *) RosSymSection + SymbolFileHeader->SymbolsOffset,
                MergedSymbols,
                SymbolFileHeader->SymbolsLength);
@@ -1519,6 +1834,7 @@ int main(int argc, char* argv[])
                StringBase,
                SymbolFileHeader->StringsLength);
 
+        free(Index);
         free(MergedSymbols);
     }
 
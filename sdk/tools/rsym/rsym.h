@@ -35,6 +35,18 @@ typedef struct _SYMBOLFILE_HEADER {
   ULONG StringsLength;
 } SYMBOLFILE_HEADER, *PSYMBOLFILE_HEADER;
 
+/* Optional, between the header and the symbols. FirstEntry[i] is the index
+ * of the first symbol at or above (i << Shift), FirstEntry[BucketCount] is
+ * the number of symbols. */
+#define SYMBOLFILE_INDEX_MAGIC 0x58444952 /* RIDX */
+
+typedef struct _SYMBOLFILE_INDEX {
+  ULONG Magic;
+  ULONG Shift;
+  ULONG BucketCount;
+  ULONG FirstEntry[1];
+} SYMBOLFILE_INDEX, *PSYMBOLFILE_INDEX;
+
 typedef struct _STAB_ENTRY {
   ULONG n_strx;         /* index into string table of name */
   UCHAR n_type;         /* type of symbol */
@@ -0,0 +1,81 @@
+/*
+ * PROJECT:     ReactOS RTL Benchmarks
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Runtime shim and splay tree based RTL packages
+ */
+
+#include <ctype.h>
+
+#include "rtlbench.h"
+
+#include <splaytree.c>
+#include <generictable.c>
+#include <unicodeprefix.c>
+#include <handle.c>
+#include <rangelist.c>
+
+PVOID NTAPI
+RtlpAllocateMemory(
+    SIZE_T Bytes,
+    ULONG Tag)
+{
+    return malloc(Bytes);
+}
+
+VOID NTAPI
+RtlpFreeMemory(
+    PVOID Mem,
+    ULONG Tag)
+{
+    free(Mem);
+}
+
+WCHAR NTAPI
+RtlpUpcaseUnicodeChar(
+    IN WCHAR Source)
+{
+    /* The benchmark only feeds ASCII names */
+    if (Source < 0x80)
+        return (WCHAR)toupper(Source);
+    return Source;
+}
+
+/*
+ * The handle table reserves its whole array up front and then commits it one
+ * page at a time. Reserve with zero-filled heap memory, which the host only
+ * backs on first touch, and treat commits as no-ops inside that block.
+ */
+NTSTATUS NTAPI
+ZwAllocateVirtualMemory(
+    IN HANDLE ProcessHandle,
+    IN OUT PVOID *BaseAddress,
+    IN ULONG_PTR ZeroBits,
+    IN OUT PSIZE_T RegionSize,
+    IN ULONG AllocationType,
+    IN ULONG Protect)
+{
+    if (AllocationType & MEM_RESERVE)
+    {
+        *RegionSize = (*RegionSize + PAGE_SIZE - 1) & ~(SIZE_T)(PAGE_SIZE - 1);
+        *BaseAddress = calloc(1, *RegionSize);
+        return *BaseAddress ? STATUS_SUCCESS : STATUS_NO_MEMORY;
+    }
+
+    if (!*BaseAddress)
+        return STATUS_INVALID_PARAMETER;
+
+    *RegionSize = (*RegionSize + PAGE_SIZE - 1) & ~(SIZE_T)(PAGE_SIZE - 1);
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS NTAPI
+NtFreeVirtualMemory(
+    IN HANDLE ProcessHandle,
+    IN PVOID *BaseAddress,
+    IN PSIZE_T RegionSize,
+    IN ULONG FreeType)
+{
+    if (FreeType & MEM_RELEASE)
+        free(*BaseAddress);
+    return STATUS_SUCCESS;
+}
@@ -0,0 +1,8 @@
+/*
+ * PROJECT:     ReactOS RTL Benchmarks
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     AVL tree based RTL generic tables
+ */
+
+#include "rtlbench.h"
+#include <avltable.c>
@@ -0,0 +1,1033 @@
+/*
+ * PROJECT:     ReactOS RTL Benchmarks
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Host microbenchmarks for the RTL data structures
+ *
+ * The RTL sources are compiled unmodified against a thin host shim (see
+ * rtlbench.h), the same way mkhive reuses them. Each benchmark prepares its
+ * data outside of the timed section, runs a fixed workload and reports one
+ * CSV line, so the output can be diffed or fed to a plotting script:
+ *
+ *   benchmark,count,runs,min_ns,median_ns,ns_per_op
+ */
+
+#include <time.h>
+
+#include "rtlbench.h"
+
+typedef struct _BENCH_ELEMENT
+{
+    ULONG Key;
+    ULONG Value;
+    ULONGLONG Payload;
+} BENCH_ELEMENT, *PBENCH_ELEMENT;
+
+typedef ULONG (*PBENCH_ROUTINE)(ULONG Count);
+
+typedef struct _BENCHMARK
+{
+    const char *Name;
+    PBENCH_ROUTINE Routine;
+    ULONG CountShift;
+} BENCHMARK;
+
+static ULONGLONG BenchSeed = 0x9E3779B97F4A7C15ULL;
+static ULONGLONG TimerStartNs;
+static ULONGLONG TimerElapsedNs;
+static volatile ULONG_PTR BenchSink;
+
+/* HELPERS *******************************************************************/
+
+static ULONGLONG
+NowNs(VOID)
+{
+    struct timespec Ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &Ts);
+    return (ULONGLONG)Ts.tv_sec * 1000000000ULL + Ts.tv_nsec;
+}
+
+static __inline VOID
+TimerStart(VOID)
+{
+    TimerStartNs = NowNs();
+}
+
+static __inline VOID
+TimerStop(VOID)
+{
+    TimerElapsedNs = NowNs() - TimerStartNs;
+}
+
+/* xorshift64*, deterministic for a given -s seed */
+static ULONG
+Random(VOID)
+{
+    BenchSeed ^= BenchSeed >> 12;
+    BenchSeed ^= BenchSeed << 25;
+    BenchSeed ^= BenchSeed >> 27;
+    return (ULONG)((BenchSeed * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static PVOID
+XAlloc(SIZE_T Size)
+{
+    PVOID Buffer = malloc(Size);
+
+    if (!Buffer)
+    {
+        fprintf(stderr, "rtlbench: out of memory\n");
+        exit(1);
+    }
+    return Buffer;
+}
+
+/* Returns a random permutation of 0 .. Count - 1 */
+static PULONG
+MakeKeys(ULONG Count)
+{
+    PULONG Keys = XAlloc(Count * sizeof(ULONG));
+    ULONG i, j, Tmp;
+
+    for (i = 0; i < Count; i++)
+        Keys[i] = i;
+
+    for (i = Count; i > 1; i--)
+    {
+        j = Random() % i;
+        Tmp = Keys[i - 1];
+        Keys[i - 1] = Keys[j];
+        Keys[j] = Tmp;
+    }
+
+    return Keys;
+}
+
+/* SPLAY GENERIC TABLE *******************************************************/
+
+static RTL_GENERIC_COMPARE_RESULTS NTAPI
+GenCompare(PRTL_GENERIC_TABLE Table, PVOID First, PVOID Second)
+{
+    ULONG A = ((PBENCH_ELEMENT)First)->Key, B = ((PBENCH_ELEMENT)Second)->Key;
+
+    if (A < B) return GenericLessThan;
+    if (A > B) return GenericGreaterThan;
+    return GenericEqual;
+}
+
+static PVOID NTAPI
+GenAllocate(PRTL_GENERIC_TABLE Table, CLONG ByteSize)
+{
+    return XAlloc(ByteSize);
+}
+
+static VOID NTAPI
+GenFree(PRTL_GENERIC_TABLE Table, PVOID Buffer)
+{
+    free(Buffer);
+}
+
+static VOID
+GenFill(PRTL_GENERIC_TABLE Table, PULONG Keys, ULONG Count)
+{
+    BENCH_ELEMENT Element = { 0 };
+    ULONG i;
+
+    RtlInitializeGenericTable(Table, GenCompare, GenAllocate, GenFree, NULL);
+    for (i = 0; i < Count; i++)
+    {
+        Element.Key = Keys[i];
+        RtlInsertElementGenericTable(Table, &Element, sizeof(Element), NULL);
+    }
+}
+
+/* Every workload keys its elements 0 .. Count - 1 */
+static VOID
+GenDrain(PRTL_GENERIC_TABLE Table, ULONG Count)
+{
+    BENCH_ELEMENT Element = { 0 };
+
+    for (Element.Key = 0; Element.Key < Count; Element.Key++)
+        RtlDeleteElementGenericTable(Table, &Element);
+}
+
+static ULONG
+BenchGenInsert(ULONG Count)
+{
+    RTL_GENERIC_TABLE Table;
+    BENCH_ELEMENT Element = { 0 };
+    PULONG Keys = MakeKeys(Count);
+    ULONG i;
+
+    RtlInitializeGenericTable(&Table, GenCompare, GenAllocate, GenFree, NULL);
+    TimerStart();
+    for (i = 0; i < Count; i++)
+    {
+        Element.Key = Keys[i];
+        RtlInsertElementGenericTable(&Table, &Element, sizeof(Element), NULL);
+    }
+    TimerStop();
+
+    GenDrain(&Table, Count);
+    free(Keys);
+    return Count;
+}
+
+static ULONG
+BenchGenLookup(ULONG Count)
+{
+    RTL_GENERIC_TABLE Table;
+    BENCH_ELEMENT Element = { 0 };
+    PULONG Keys = MakeKeys(Count);
+    ULONG i;
+
+    GenFill(&Table, Keys, Count);
+    TimerStart();
+    for (i = 0; i < Count; i++)
+    {
+        Element.Key = Keys[Random() % Count];
+        BenchSink += (ULONG_PTR)RtlLookupElementGenericTable(&Table, &Element);
+    }
+    TimerStop();
+
+    GenDrain(&Table, Count);
+    free(Keys);
+    return Count;
+}
+
+/* 50% lookups, 25% inserts, 25% deletes against a half full table */
+static ULONG
+BenchGenMixed(ULONG Count)
+{
+    RTL_GENERIC_TABLE Table;
+    BENCH_ELEMENT Element = { 0 };
+    PULONG Keys = MakeKeys(Count);
+    ULONG i, Op;
+
+    GenFill(&Table, Keys, Count / 2);
+    TimerStart();
+    for (i = 0; i < Count; i++)
+    {
+        Op = Random();
+        Element.Key = (Op >> 2) % Count;
+        switch (Op & 3)
+        {
+            case 0:
+                RtlInsertElementGenericTable(&Table, &Element, sizeof(Element), NULL);
+                break;
+            case 1:
+                RtlDeleteElementGenericTable(&Table, &Element);
+                break;
+            default:
+                BenchSink += (ULONG_PTR)RtlLookupElementGenericTable(&Table, &Element);
+                break;
+        }
+    }
+    TimerStop();
+
+    GenDrain(&Table, Count);
+    free(Keys);
+    return Count;
+}
+
+static ULONG
+BenchGenDelete(ULONG Count)
+{
+    RTL_GENERIC_TABLE Table;
+    BENCH_ELEMENT Element = { 0 };
+    PULONG Keys = MakeKeys(Count);
+    ULONG i;
+
+    /* Delete in a different random order than the one used for inserting */
+    GenFill(&Table, Keys, Count);
+    free(Keys);
+    Keys = MakeKeys(Count);
+
+    TimerStart();
+    for (i = 0; i < Count; i++)
+    {
+        Element.Key = Keys[i];
+        RtlDeleteElementGenericTable(&Table, &Element);
+    }
+    TimerStop();
+
+    free(Keys);
+    return Count;
+}
+
+static ULONG
+BenchGenEnumerate(ULONG Count)
+{
+    RTL_GENERIC_TABLE Table;
+    PULONG Keys = MakeKeys(Count);
+    PVOID RestartKey = NULL, Element;
+    ULONG Found = 0;
+
+    GenFill(&Table, Keys, Count);
+    TimerStart();
+    for (Element = RtlEnumerateGenericTableWithoutSplaying(&Table, &RestartKey);
+         Element != NULL;
+         Element = RtlEnumerateGenericTableWithoutSplaying(&Table, &RestartKey))
+    {
+        Found++;
+    }
+    TimerStop();
+
+    BenchSink += Found;
+    GenDrain(&Table, Count);
+    free(Keys);
+    return Count;
+}
+
+/* AVL GENERIC TABLE *********************************************************/
+
+static RTL_GENERIC_COMPARE_RESULTS NTAPI
+AvlCompare(PRTL_AVL_TABLE Table, PVOID First, PVOID Second)
+{
+    ULONG A = ((PBENCH_ELEMENT)First)->Key, B = ((PBENCH_ELEMENT)Second)->Key;
+
+    if (A < B) return GenericLessThan;
+    if (A > B) return GenericGreaterThan;
+    return GenericEqual;
+}
+
+static PVOID NTAPI
+AvlAllocate(PRTL_AVL_TABLE Table, CLONG ByteSize)
+{
+    return XAlloc(ByteSize);
+}
+
+static VOID NTAPI
+AvlFree(PRTL_AVL_TABLE Table, PVOID Buffer)
+{
+    free(Buffer);
+}
+
+static VOID
+AvlFill(PRTL_AVL_TABLE Table, PULONG Keys, ULONG Count)
+{
+    BENCH_ELEMENT Element = { 0 };
+    ULONG i;
+
+    RtlInitializeGenericTableAvl(Table, AvlCompare, AvlAllocate, AvlFree, NULL);
+    for (i = 0; i < Count; i++)
+    {
+        Element.Key = Keys[i];
+        RtlInsertElementGenericTableAvl(Table, &Element, sizeof(Element), NULL);
+    }
+}
+
+/* Every workload keys its elements 0 .. Count - 1 */
+static VOID
+AvlDrain(PRTL_AVL_TABLE Table, ULONG Count)
+{
+    BENCH_ELEMENT Element = { 0 };
+
+    for (Element.Key = 0; Element.Key < Count; Element.Key++)
+        RtlDeleteElementGenericTableAvl(Table, &Element);
+}
+
+static ULONG
+BenchAvlInsert(ULONG Count)
+{
+    RTL_AVL_TABLE Table;
+    BENCH_ELEMENT Element = { 0 };
+    PULONG Keys = MakeKeys(Count);
+    ULONG i;
+
+    RtlInitializeGenericTableAvl(&Table, AvlCompare, AvlAllocate, AvlFree, NULL);
+    TimerStart();
+    for (i = 0; i < Count; i++)
+    {
+        Element.Key = Keys[i];
+        RtlInsertElementGenericTableAvl(&Table, &Element, sizeof(Element), NULL);
+    }
+    TimerStop();
+
+    AvlDrain(&Table, Count);
+    free(Keys);
+    return Count;
+}
+
+static ULONG
+BenchAvlLookup(ULONG Count)
+{
+    RTL_AVL_TABLE Table;
+    BENCH_ELEMENT Element = { 0 };
+    PULONG Keys = MakeKeys(Count);
+    ULONG i;
+
+    AvlFill(&Table, Keys, Count);
+    TimerStart();
+    for (i = 0; i < Count; i++)
+    {
+        Element.Key = Keys[Random() % Count];
+        BenchSink += (ULONG_PTR)RtlLookupElementGenericTableAvl(&Table, &Element);
+    }
+    TimerStop();
+
+    AvlDrain(&Table, Count);
+    free(Keys);
+    return Count;
+}
+
+static ULONG
+BenchAvlMixed(ULONG Count)
+{
+    RTL_AVL_TABLE Table;
+    BENCH_ELEMENT Element = { 0 };
+    PULONG Keys = MakeKeys(Count);
+    ULONG i, Op;
+
+    AvlFill(&Table, Keys, Count / 2);
+    TimerStart();
+    for (i = 0; i < Count; i++)
+    {
+        Op = Random();
+        Element.Key = (Op >> 2) % Count;
+        switch (Op & 3)
+        {
+            case 0:
+                RtlInsertElementGenericTableAvl(&Table, &Element, sizeof(Element), NULL);
+                break;
+            case 1:
+                RtlDeleteElementGenericTableAvl(&Table, &Element);
+                break;
+            default:
+                BenchSink += (ULONG_PTR)RtlLookupElementGenericTableAvl(&Table, &Element);
+                break;
+        }
+    }
+    TimerStop();
+
+    AvlDrain(&Table, Count);
+    free(Keys);
+    return Count;
+}
+
+static ULONG
+BenchAvlDelete(ULONG Count)
+{
+    RTL_AVL_TABLE Table;
+    BENCH_ELEMENT Element = { 0 };
+    PULONG Keys = MakeKeys(Count);
+    ULONG i;
+
+    /* Delete in a different random order than the one used for inserting */
+    AvlFill(&Table, Keys, Count);
+    free(Keys);
+    Keys = MakeKeys(Count);
+
+    TimerStart();
+    for (i = 0; i < Count; i++)
+    {
+        Element.Key = Keys[i];
+        RtlDeleteElementGenericTableAvl(&Table, &Element);
+    }
+    TimerStop();
+
+    free(Keys);
+    return Count;
+}
+
+static ULONG
+BenchAvlEnumerate(ULONG Count)
+{
+    RTL_AVL_TABLE Table;
+    PULONG Keys = MakeKeys(Count);
+    PVOID RestartKey = NULL, Element;
+    ULONG Found = 0;
+
+    AvlFill(&Table, Keys, Count);
+    TimerStart();
+    for (Element = RtlEnumerateGenericTableWithoutSplayingAvl(&Table, &RestartKey);
+         Element != NULL;
+         Element = RtlEnumerateGenericTableWithoutSplayingAvl(&Table, &RestartKey))
+    {
+        Found++;
+    }
+    TimerStop();
+
+    BenchSink += Found;
+    AvlDrain(&Table, Count);
+    free(Keys);
+    return Count;
+}
+
+/* BITMAPS *******************************************************************/
+
+/* Fragment a bitmap with random runs so roughly half of it is in use */
+static VOID
+BitmapFragment(PRTL_BITMAP BitMap)
+{
+    ULONG Index = 0, Length;
+
+    RtlClearAllBits(BitMap);
+    while (Index < BitMap->SizeOfBitMap)
+    {
+        Index += Random() % 64;
+        Length = 1 + Random() % 64;
+        if (Index + Length > BitMap->SizeOfBitMap)
+            break;
+        RtlSetBits(BitMap, Index, Length);
+        Index += Length;
+    }
+}
+
+static PULONG
+BitmapCreate(PRTL_BITMAP BitMap, ULONG Bits)
+{
+    PULONG Buffer = XAlloc((Bits + 31) / 32 * sizeof(ULONG));
+
+    RtlInitializeBitMap(BitMap, Buffer, Bits);
+    BitmapFragment(BitMap);
+    return Buffer;
+}
+
+static ULONG
+BenchBitmapSetClear(ULONG Count)
+{
+    RTL_BITMAP BitMap;
+    PULONG Buffer = BitmapCreate(&BitMap, Count * 32);
+    ULONG i, Start, Length;
+
+    TimerStart();
+    for (i = 0; i < Count; i++)
+    {
+        Length = 1 + Random() % 256;
+        Start = Random() % (BitMap.SizeOfBitMap - Length);
+        if (i & 1)
+            RtlSetBits(&BitMap, Start, Length);
+        else
+            RtlClearBits(&BitMap, Start, Length);
+    }
+    TimerStop();
+
+    free(Buffer);
+    return Count;
+}
+
+static ULONG
+BenchBitmapFindClear(ULONG Count)
+{
+    RTL_BITMAP BitMap;
+    PULONG Buffer = BitmapCreate(&BitMap, Count * 32);
+    ULONG i;
+
+    TimerStart();
+    for (i = 0; i < Count; i++)
+    {
+        BenchSink += RtlFindClearBits(&BitMap,
+                                      1 + Random() % 32,
+                                      Random() % BitMap.SizeOfBitMap);
+    }
+    TimerStop();
+
+    free(Buffer);
+    return Count;
+}
+
+/* Allocator style churn: grab a run, release an older one */
+static ULONG
+BenchBitmapAllocFree(ULONG Count)
+{
+    RTL_BITMAP BitMap;
+    PULONG Buffer = BitmapCreate(&BitMap, Count * 32);
+    ULONG Runs[64][2] = { { 0 } };
+    ULONG i, Slot, Length, Index;
+
+    TimerStart();
+    for (i = 0; i < Count; i++)
+    {
+        Slot = i % 64;
+        if (Runs[Slot][1])
+            RtlClearBits(&BitMap, Runs[Slot][0], Runs[Slot][1]);
+
+        Length = 1 + Random() % 16;
+        Index = RtlFindClearBitsAndSet(&BitMap, Length, Random() % BitMap.SizeOfBitMap);
+        Runs[Slot][0] = Index;
+        Runs[Slot][1] = (Index == MAXULONG) ? 0 : Length;
+    }
+    TimerStop();
+
+    free(Buffer);
+    return Count;
+}
+
+static ULONG
+BenchBitmapCount(ULONG Count)
+{
+    RTL_BITMAP BitMap;
+    PULONG Buffer = BitmapCreate(&BitMap, Count * 32);
+    ULONG i;
+
+    TimerStart();
+    for (i = 0; i < 16; i++)
+        BenchSink += RtlNumberOfSetBits(&BitMap);
+    TimerStop();
+
+    free(Buffer);
+    return 16;
+}
+
+static ULONG
+BenchBitmapLongestRun(ULONG Count)
+{
+    RTL_BITMAP BitMap;
+    PULONG Buffer = BitmapCreate(&BitMap, Count * 32);
+    ULONG i, Start;
+
+    TimerStart();
+    for (i = 0; i < 16; i++)
+        BenchSink += RtlFindLongestRunClear(&BitMap, &Start);
+    TimerStop();
+
+    free(Buffer);
+    return 16;
+}
+
+static ULONG
+BenchBitmapClearRuns(ULONG Count)
+{
+    RTL_BITMAP BitMap;
+    RTL_BITMAP_RUN Runs[32];
+    PULONG Buffer = BitmapCreate(&BitMap, Count * 32);
+    ULONG i;
+
+    TimerStart();
+    for (i = 0; i < 16; i++)
+        BenchSink += RtlFindClearRuns(&BitMap, Runs, 32, TRUE);
+    TimerStop();
+
+    free(Buffer);
+    return 16;
+}
+
+static PULONG64
+Bitmap64Create(PRTL_BITMAP64 BitMap, ULONG Bits)
+{
+    PULONG64 Buffer = XAlloc((Bits + 63) / 64 * sizeof(ULONG64));
+    ULONG64 Index = 0, Length;
+
+    RtlInitializeBitMap64(BitMap, Buffer, Bits);
+    RtlClearAllBits64(BitMap);
+    while (Index < BitMap->SizeOfBitMap)
+    {
+        Index += Random() % 64;
+        Length = 1 + Random() % 64;
+        if (Index + Length > BitMap->SizeOfBitMap)
+            break;
+        RtlSetBits64(BitMap, Index, Length);
+        Index += Length;
+    }
+
+    return Buffer;
+}
+
+static ULONG
+BenchBitmap64FindClear(ULONG Count)
+{
+    RTL_BITMAP64 BitMap;
+    PULONG64 Buffer = Bitmap64Create(&BitMap, Count * 32);
+    ULONG i;
+
+    TimerStart();
+    for (i = 0; i < Count; i++)
+    {
+        BenchSink += RtlFindClearBits64(&BitMap,
+                                        1 + Random() % 32,
+                                        Random() % BitMap.SizeOfBitMap);
+    }
+    TimerStop();
+
+    free(Buffer);
+    return Count;
+}
+
+static ULONG
+BenchBitmap64AllocFree(ULONG Count)
+{
+    RTL_BITMAP64 BitMap;
+    PULONG64 Buffer = Bitmap64Create(&BitMap, Count * 32);
+    ULONG64 Runs[64][2] = { { 0 } };
+    ULONG64 Length, Index;
+    ULONG i, Slot;
+
+    TimerStart();
+    for (i = 0; i < Count; i++)
+    {
+        Slot = i % 64;
+        if (Runs[Slot][1])
+            RtlClearBits64(&BitMap, Runs[Slot][0], Runs[Slot][1]);
+
+        Length = 1 + Random() % 16;
+        Index = RtlFindClearBitsAndSet64(&BitMap, Length, Random() % BitMap.SizeOfBitMap);
+        Runs[Slot][0] = Index;
+        Runs[Slot][1] = (Index == (ULONG64)-1) ? 0 : Length;
+    }
+    TimerStop();
+
+    free(Buffer);
+    return Count;
+}
+
+/* UNICODE PREFIX TABLE ******************************************************/
+
+typedef struct _BENCH_PREFIX
+{
+    UNICODE_PREFIX_TABLE_ENTRY Entry;
+    UNICODE_STRING Name;
+    WCHAR Buffer[32];
+} BENCH_PREFIX, *PBENCH_PREFIX;
+
+static VOID
+MakeName(PUNICODE_STRING String, PWCHAR Buffer, ULONG Id, BOOLEAN File)
+{
+    char Ansi[64];
+    int i, Length;
+
+    /* Spread the prefixes over a few hundred trees, like volumes and shares */
+    Length = snprintf(Ansi, sizeof(Ansi), "\\VOL%u\\DIR%u%s",
+                      Id % 257, Id / 257, File ? "\\file.txt" : "");
+    for (i = 0; i < Length; i++)
+        Buffer[i] = (WCHAR)Ansi[i];
+
+    String->Buffer = Buffer;
+    String->Length = (USHORT)(Length * sizeof(WCHAR));
+    String->MaximumLength = String->Length;
+}
+
+static PBENCH_PREFIX
+PrefixFill(PUNICODE_PREFIX_TABLE Table, PULONG Keys, ULONG Count)
+{
+    PBENCH_PREFIX Prefixes = XAlloc(Count * sizeof(BENCH_PREFIX));
+    ULONG i;
+
+    RtlInitializeUnicodePrefix(Table);
+    for (i = 0; i < Count; i++)
+    {
+        MakeName(&Prefixes[i].Name, Prefixes[i].Buffer, Keys[i], FALSE);
+        RtlInsertUnicodePrefix(Table, &Prefixes[i].Name, &Prefixes[i].Entry);
+    }
+
+    return Prefixes;
+}
+
+static ULONG
+BenchPrefixInsert(ULONG Count)
+{
+    UNICODE_PREFIX_TABLE Table;
+    PBENCH_PREFIX Prefixes = XAlloc(Count * sizeof(BENCH_PREFIX));
+    PULONG Keys = MakeKeys(Count);
+    ULONG i;
+
+    for (i = 0; i < Count; i++)
+        MakeName(&Prefixes[i].Name, Prefixes[i].Buffer, i, FALSE);
+
+    RtlInitializeUnicodePrefix(&Table);
+    TimerStart();
+    for (i = 0; i < Count; i++)
+    {
+        RtlInsertUnicodePrefix(&Table,
+                               &Prefixes[Keys[i]].Name,
+                               &Prefixes[Keys[i]].Entry);
+    }
+    TimerStop();
+
+    free(Prefixes);
+    free(Keys);
+    return Count;
+}
+
+static ULONG
+BenchPrefixFind(ULONG Count)
+{
+    UNICODE_PREFIX_TABLE Table;
+    UNICODE_STRING Name;
+    WCHAR Buffer[48];
+    PULONG Keys = MakeKeys(Count);
+    PBENCH_PREFIX Prefixes = PrefixFill(&Table, Keys, Count);
+    ULONG i;
+
+    TimerStart();
+    for (i = 0; i < Count; i++)
+    {
+        MakeName(&Name, Buffer, Random() % Count, TRUE);
+        BenchSink += (ULONG_PTR)RtlFindUnicodePrefix(&Table, &Name, 0);
+    }
+    TimerStop();
+
+    free(Prefixes);
+    free(Keys);
+    return Count;
+}
+
+/* HANDLE TABLE **************************************************************/
+
+typedef struct _BENCH_HANDLE
+{
+    RTL_HANDLE_TABLE_ENTRY Entry;
+    PVOID Object;
+} BENCH_HANDLE, *PBENCH_HANDLE;
+
+static ULONG
+BenchHandleAllocFree(ULONG Count)
+{
+    RTL_HANDLE_TABLE Table;
+    PRTL_HANDLE_TABLE_ENTRY *Handles = XAlloc(Count * sizeof(PVOID));
+    PRTL_HANDLE_TABLE_ENTRY Handle;
+    ULONG i, Index;
+
+    RtlInitializeHandleTable(Count, sizeof(BENCH_HANDLE), &Table);
+    TimerStart();
+    for (i = 0; i < Count; i++)
+    {
+        Handles[i] = RtlAllocateHandle(&Table, &Index);
+        Handles[i]->Flags = RTL_HANDLE_VALID;
+    }
+    for (i = 0; i < Count; i++)
+    {
+        if (RtlIsValidIndexHandle(&Table, Random() % Count, &Handle))
+            BenchSink += (ULONG_PTR)Handle;
+    }
+    for (i = 0; i < Count; i++)
+        RtlFreeHandle(&Table, Handles[i]);
+    TimerStop();
+
+    RtlDestroyHandleTable(&Table);
+    free(Handles);
+    return 3 * Count;
+}
+
+/* RANGE LISTS ***************************************************************/
+
+#define RANGE_BASE 0x100000ULL
+
+static VOID
+RangeFill(PRTL_RANGE_LIST RangeList, PULONG Keys, ULONG Count)
+{
+    ULONG i;
+
+    RtlInitializeRangeList(RangeList);
+    for (i = 0; i < Count; i++)
+    {
+        /* Every range is 256 bytes followed by a 256 byte hole */
+        RtlAddRange(RangeList,
+                    RANGE_BASE + (ULONGLONG)Keys[i] * 512,
+                    RANGE_BASE + (ULONGLONG)Keys[i] * 512 + 255,
+                    0, 0, NULL, NULL);
+    }
+}
+
+static ULONG
+BenchRangeAdd(ULONG Count)
+{
+    RTL_RANGE_LIST RangeList;
+    PULONG Keys = MakeKeys(Count);
+    ULONG i;
+
+    RtlInitializeRangeList(&RangeList);
+    TimerStart();
+    for (i = 0; i < Count; i++)
+    {
+        RtlAddRange(&RangeList,
+                    RANGE_BASE + (ULONGLONG)Keys[i] * 512,
+                    RANGE_BASE + (ULONGLONG)Keys[i] * 512 + 255,
+                    0, 0, NULL, NULL);
+    }
+    TimerStop();
+
+    RtlFreeRangeList(&RangeList);
+    free(Keys);
+    return Count;
+}
+
+static ULONG
+BenchRangeAvailable(ULONG Count)
+{
+    RTL_RANGE_LIST RangeList;
+    PULONG Keys = MakeKeys(Count);
+    BOOLEAN Available;
+    ULONGLONG Start;
+    ULONG i;
+
+    RangeFill(&RangeList, Keys, Count);
+    TimerStart();
+    for (i = 0; i < Count; i++)
+    {
+        Start = RANGE_BASE + (ULONGLONG)(Random() % Count) * 512 + 256;
+        RtlIsRangeAvailable(&RangeList, Start, Start + 127, 0, 0, NULL, NULL, &Available);
+        BenchSink += Available;
+    }
+    TimerStop();
+
+    RtlFreeRangeList(&RangeList);
+    free(Keys);
+    return Count;
+}
+
+static ULONG
+BenchRangeFind(ULONG Count)
+{
+    RTL_RANGE_LIST RangeList;
+    PULONG Keys = MakeKeys(Count);
+    ULONGLONG Start;
+    ULONG i;
+
+    RangeFill(&RangeList, Keys, Count);
+    TimerStart();
+    for (i = 0; i < Count; i++)
+    {
+        /* No hole is large enough, so every search scans the whole list */
+        Start = 0;
+        RtlFindRange(&RangeList, RANGE_BASE, RANGE_BASE + (ULONGLONG)Count * 512 - 1,
+                     257 + Random() % 256, 1, 0, 0, NULL, NULL, &Start);
+        BenchSink += (ULONG_PTR)Start;
+    }
+    TimerStop();
+
+    RtlFreeRangeList(&RangeList);
+    free(Keys);
+    return Count;
+}
+
+/* DRIVER ********************************************************************/
+
+/*
+ * CountShift scales the -n count down for the linear list based packages,
+ * so a default run stays within a few seconds.
+ */
+static const BENCHMARK Benchmarks[] =
+{
+    { "gentable.insert",        BenchGenInsert,         0 },
+    { "gentable.lookup",        BenchGenLookup,         0 },
+    { "gentable.mixed",         BenchGenMixed,          0 },
+    { "gentable.delete",        BenchGenDelete,         0 },
+    { "gentable.enumerate",     BenchGenEnumerate,      0 },
+    { "avltable.insert",        BenchAvlInsert,         0 },
+    { "avltable.lookup",        BenchAvlLookup,         0 },
+    { "avltable.mixed",         BenchAvlMixed,          0 },
+    { "avltable.delete",        BenchAvlDelete,         0 },
+    { "avltable.enumerate",     BenchAvlEnumerate,      0 },
+    { "bitmap.setclear",        BenchBitmapSetClear,    0 },
+    { "bitmap.findclear",       BenchBitmapFindClear,   0 },
+    { "bitmap.allocfree",       BenchBitmapAllocFree,   0 },
+    { "bitmap.count",           BenchBitmapCount,       0 },
+    { "bitmap.longestrun",      BenchBitmapLongestRun,  0 },
+    { "bitmap.clearruns",       BenchBitmapClearRuns,   0 },
+    { "bitmap64.findclear",     BenchBitmap64FindClear, 0 },
+    { "bitmap64.allocfree",     BenchBitmap64AllocFree, 0 },
+    { "prefix.insert",          BenchPrefixInsert,      0 },
+    { "prefix.find",            BenchPrefixFind,        0 },
+    { "handle.allocfree",       BenchHandleAllocFree,   0 },
+    { "rangelist.add",          BenchRangeAdd,          4 },
+    { "rangelist.available",    BenchRangeAvailable,    4 },
+    { "rangelist.find",         BenchRangeFind,         6 },
+};
+
+static int
+CompareNs(const void *A, const void *B)
+{
+    ULONGLONG X = *(const ULONGLONG *)A, Y = *(const ULONGLONG *)B;
+
+    return (X > Y) - (X < Y);
+}
+
+static BOOLEAN
+IsSelected(const char *Name, int argc, char **argv, int First)
+{
+    int i;
+
+    if (First >= argc)
+        return TRUE;
+
+    for (i = First; i < argc; i++)
+    {
+        if (strstr(Name, argv[i]))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+static void
+Usage(void)
+{
+    printf("Usage: rtlbench [-n count] [-r runs] [-s seed] [-l] [filter ...]\n"
+           "  -n count  Elements per workload (default 100000)\n"
+           "  -r runs   Repetitions per workload (default 5)\n"
+           "  -s seed   Random seed\n"
+           "  -l        List the workloads and exit\n"
+           "Only workloads whose name contains one of the filters are run.\n");
+}
+
+int main(int argc, char **argv)
+{
+    ULONG Count = 100000, Runs = 5, Scaled, Ops = 0, i, r;
+    ULONGLONG Seed = BenchSeed, *Samples;
+    int Arg;
+
+    for (Arg = 1; Arg < argc && argv[Arg][0] == '-'; Arg++)
+    {
+        if (!strcmp(argv[Arg], "-l"))
+        {
+            for (i = 0; i < sizeof(Benchmarks) / sizeof(Benchmarks[0]); i++)
+                printf("%s\n", Benchmarks[i].Name);
+            return 0;
+        }
+        else if (Arg + 1 < argc && !strcmp(argv[Arg], "-n"))
+        {
+            Count = strtoul(argv[++Arg], NULL, 0);
+        }
+        else if (Arg + 1 < argc && !strcmp(argv[Arg], "-r"))
+        {
+            Runs = strtoul(argv[++Arg], NULL, 0);
+        }
+        else if (Arg + 1 < argc && !strcmp(argv[Arg], "-s"))
+        {
+            Seed = strtoull(argv[++Arg], NULL, 0);
+        }
+        else
+        {
+            Usage();
+            return 1;
+        }
+    }
+
+    if (Count < 256 || Runs == 0)
+    {
+        Usage();
+        return 1;
+    }
+
+    Samples = XAlloc(Runs * sizeof(ULONGLONG));
+    printf("benchmark,count,runs,min_ns,median_ns,ns_per_op\n");
+
+    for (i = 0; i < sizeof(Benchmarks) / sizeof(Benchmarks[0]); i++)
+    {
+        if (!IsSelected(Benchmarks[i].Name, argc, argv, Arg))
+            continue;
+
+        Scaled = max(Count >> Benchmarks[i].CountShift, 64);
+        for (r = 0; r < Runs; r++)
+        {
+            /* Every repetition sees the same data */
+            BenchSeed = Seed ? Seed : 1;
+            Ops = Benchmarks[i].Routine(Scaled);
+            Samples[r] = TimerElapsedNs;
+        }
+
+        qsort(Samples, Runs, sizeof(ULONGLONG), CompareNs);
+        printf("%s,%u,%u,%llu,%llu,%.2f\n",
+               Benchmarks[i].Name,
+               Scaled,
+               Runs,
+               (unsigned long long)Samples[0],
+               (unsigned long long)Samples[Runs / 2],
+               (double)Samples[0] / Ops);
+        fflush(stdout);
+    }
+
+    free(Samples);
+    return 0;
+}
@@ -0,0 +1,587 @@
+/*
+ * PROJECT:     ReactOS RTL Benchmarks
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Host shim for building RTL data structures outside of NT
+ */
+
+#ifndef _RTLBENCH_H
+#define _RTLBENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <typedefs.h>
+
+/* SAL annotations used by the RTL sources */
+#define _In_
+#define _In_opt_
+#define _Out_
+#define _In_range_(l, h)
+#define _Analysis_assume_(x)
+#define __drv_aliasesMem
+
+#define FORCEINLINE static __inline
+#define C_ASSERT(e) typedef char __C_ASSERT__[(e) ? 1 : -1]
+
+#ifndef min
+#define min(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef max
+#define max(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+
+#define ROUND_DOWN(n, align) (((ULONG_PTR)(n)) & ~((align) - 1l))
+
+typedef ULONG CLONG;
+typedef SHORT CSHORT;
+typedef ULONG64 *PULONG64, *PULONGLONG;
+
+// Definitions copied from <ntstatus.h>
+// We only want to include host headers, so we define them manually
+#define STATUS_SUCCESS                   ((NTSTATUS)0x00000000)
+#define STATUS_UNSUCCESSFUL              ((NTSTATUS)0xC0000001)
+#define STATUS_INVALID_PARAMETER         ((NTSTATUS)0xC000000D)
+#define STATUS_NO_MEMORY                 ((NTSTATUS)0xC0000017)
+#define STATUS_INSUFFICIENT_RESOURCES    ((NTSTATUS)0xC000009A)
+#define STATUS_NO_MORE_ENTRIES           ((NTSTATUS)0x8000001A)
+#define STATUS_RANGE_NOT_FOUND           ((NTSTATUS)0xC000028C)
+
+/* Virtual memory emulation for the handle table */
+#define PAGE_SIZE       0x1000
+#define PAGE_READWRITE  0x04
+#define MEM_COMMIT      0x1000
+#define MEM_RESERVE     0x2000
+#define MEM_RELEASE     0x8000
+#define NtCurrentProcess() ((HANDLE)(LONG_PTR)-1)
+
+NTSTATUS NTAPI
+ZwAllocateVirtualMemory(
+    IN HANDLE ProcessHandle,
+    IN OUT PVOID *BaseAddress,
+    IN ULONG_PTR ZeroBits,
+    IN OUT PSIZE_T RegionSize,
+    IN ULONG AllocationType,
+    IN ULONG Protect);
+
+NTSTATUS NTAPI
+NtFreeVirtualMemory(
+    IN HANDLE ProcessHandle,
+    IN PVOID *BaseAddress,
+    IN PSIZE_T RegionSize,
+    IN ULONG FreeType);
+
+PVOID NTAPI
+RtlpAllocateMemory(
+    SIZE_T Bytes,
+    ULONG Tag);
+
+VOID NTAPI
+RtlpFreeMemory(
+    PVOID Mem,
+    ULONG Tag);
+
+WCHAR NTAPI
+RtlpUpcaseUnicodeChar(
+    IN WCHAR Source);
+
+/* Bit scanning, mapped on the compiler builtins */
+static __inline unsigned char
+BitScanForward(ULONG *Index, ULONG Mask)
+{
+    if (!Mask) return 0;
+    *Index = __builtin_ctz(Mask);
+    return 1;
+}
+
+static __inline unsigned char
+BitScanReverse(ULONG *Index, ULONG Mask)
+{
+    if (!Mask) return 0;
+    *Index = 31 - __builtin_clz(Mask);
+    return 1;
+}
+
+static __inline unsigned char
+BitScanForward64(unsigned long *Index, ULONG64 Mask)
+{
+    if (!Mask) return 0;
+    *Index = __builtin_ctzll(Mask);
+    return 1;
+}
+
+static __inline unsigned char
+BitScanReverse64(unsigned long *Index, ULONG64 Mask)
+{
+    if (!Mask) return 0;
+    *Index = 63 - __builtin_clzll(Mask);
+    return 1;
+}
+
+/* The bitmap code only fills with all-zero or all-one patterns */
+static __inline VOID
+RtlFillMemoryUlong(PVOID Destination, SIZE_T Length, ULONG Pattern)
+{
+    memset(Destination, (UCHAR)Pattern, Length);
+}
+
+static __inline VOID
+RtlFillMemoryUlonglong(PVOID Destination, SIZE_T Length, ULONGLONG Pattern)
+{
+    memset(Destination, (UCHAR)Pattern, Length);
+}
+
+/* RTL bitmaps */
+typedef struct _RTL_BITMAP64
+{
+    ULONG64 SizeOfBitMap;
+    PULONG64 Buffer;
+} RTL_BITMAP64, *PRTL_BITMAP64;
+
+typedef struct _RTL_BITMAP_RUN64
+{
+    ULONG64 StartingIndex;
+    ULONG64 NumberOfBits;
+} RTL_BITMAP_RUN64, *PRTL_BITMAP_RUN64;
+
+/* RTL splay and balanced links structures */
+typedef enum _TABLE_SEARCH_RESULT
+{
+    TableEmptyTree,
+    TableFoundNode,
+    TableInsertAsLeft,
+    TableInsertAsRight
+} TABLE_SEARCH_RESULT;
+
+typedef enum _RTL_GENERIC_COMPARE_RESULTS
+{
+    GenericLessThan,
+    GenericGreaterThan,
+    GenericEqual
+} RTL_GENERIC_COMPARE_RESULTS;
+
+typedef struct _RTL_SPLAY_LINKS
+{
+    struct _RTL_SPLAY_LINKS *Parent;
+    struct _RTL_SPLAY_LINKS *LeftChild;
+    struct _RTL_SPLAY_LINKS *RightChild;
+} RTL_SPLAY_LINKS, *PRTL_SPLAY_LINKS;
+
+typedef struct _RTL_BALANCED_LINKS
+{
+    struct _RTL_BALANCED_LINKS *Parent;
+    struct _RTL_BALANCED_LINKS *LeftChild;
+    struct _RTL_BALANCED_LINKS *RightChild;
+    CHAR Balance;
+    UCHAR Reserved[3];
+} RTL_BALANCED_LINKS, *PRTL_BALANCED_LINKS;
+
+#define RtlIsLeftChild(Links) \
+    (RtlLeftChild(RtlParent(Links)) == (PRTL_SPLAY_LINKS)(Links))
+
+#define RtlIsRightChild(Links) \
+    (RtlRightChild(RtlParent(Links)) == (PRTL_SPLAY_LINKS)(Links))
+
+#define RtlRightChild(Links) \
+    ((PRTL_SPLAY_LINKS)(Links))->RightChild
+
+#define RtlIsRoot(Links) \
+    (RtlParent(Links) == (PRTL_SPLAY_LINKS)(Links))
+
+#define RtlLeftChild(Links) \
+    ((PRTL_SPLAY_LINKS)(Links))->LeftChild
+
+#define RtlParent(Links) \
+    ((PRTL_SPLAY_LINKS)(Links))->Parent
+
+#define RtlInitializeSplayLinks(Links)                  \
+    {                                                   \
+        PRTL_SPLAY_LINKS _SplayLinks;                   \
+        _SplayLinks = (PRTL_SPLAY_LINKS)(Links);        \
+        _SplayLinks->Parent = _SplayLinks;              \
+        _SplayLinks->LeftChild = NULL;                  \
+        _SplayLinks->RightChild = NULL;                 \
+    }
+
+#define RtlInsertAsLeftChild(ParentLinks,ChildLinks)    \
+    {                                                   \
+        PRTL_SPLAY_LINKS _SplayParent;                  \
+        PRTL_SPLAY_LINKS _SplayChild;                   \
+        _SplayParent = (PRTL_SPLAY_LINKS)(ParentLinks); \
+        _SplayChild = (PRTL_SPLAY_LINKS)(ChildLinks);   \
+        _SplayParent->LeftChild = _SplayChild;          \
+        _SplayChild->Parent = _SplayParent;             \
+    }
+
+#define RtlInsertAsRightChild(ParentLinks,ChildLinks)   \
+    {                                                   \
+        PRTL_SPLAY_LINKS _SplayParent;                  \
+        PRTL_SPLAY_LINKS _SplayChild;                   \
+        _SplayParent = (PRTL_SPLAY_LINKS)(ParentLinks); \
+        _SplayChild = (PRTL_SPLAY_LINKS)(ChildLinks);   \
+        _SplayParent->RightChild = _SplayChild;         \
+        _SplayChild->Parent = _SplayParent;             \
+    }
+
+/* RTL generic and AVL tables */
+struct _RTL_AVL_TABLE;
+struct _RTL_GENERIC_TABLE;
+
+typedef NTSTATUS
+(NTAPI RTL_AVL_MATCH_FUNCTION)(
+    struct _RTL_AVL_TABLE *Table,
+    PVOID UserData,
+    PVOID MatchData);
+typedef RTL_AVL_MATCH_FUNCTION *PRTL_AVL_MATCH_FUNCTION;
+
+typedef RTL_GENERIC_COMPARE_RESULTS
+(NTAPI RTL_AVL_COMPARE_ROUTINE)(
+    struct _RTL_AVL_TABLE *Table,
+    PVOID FirstStruct,
+    PVOID SecondStruct);
+typedef RTL_AVL_COMPARE_ROUTINE *PRTL_AVL_COMPARE_ROUTINE;
+
+typedef RTL_GENERIC_COMPARE_RESULTS
+(NTAPI RTL_GENERIC_COMPARE_ROUTINE)(
+    struct _RTL_GENERIC_TABLE *Table,
+    PVOID FirstStruct,
+    PVOID SecondStruct);
+typedef RTL_GENERIC_COMPARE_ROUTINE *PRTL_GENERIC_COMPARE_ROUTINE;
+
+typedef PVOID
+(NTAPI RTL_GENERIC_ALLOCATE_ROUTINE)(
+    struct _RTL_GENERIC_TABLE *Table,
+    CLONG ByteSize);
+typedef RTL_GENERIC_ALLOCATE_ROUTINE *PRTL_GENERIC_ALLOCATE_ROUTINE;
+
+typedef PVOID
+(NTAPI RTL_AVL_ALLOCATE_ROUTINE)(
+    struct _RTL_AVL_TABLE *Table,
+    CLONG ByteSize);
+typedef RTL_AVL_ALLOCATE_ROUTINE *PRTL_AVL_ALLOCATE_ROUTINE;
+
+typedef VOID
+(NTAPI RTL_GENERIC_FREE_ROUTINE)(
+    struct _RTL_GENERIC_TABLE *Table,
+    PVOID Buffer);
+typedef RTL_GENERIC_FREE_ROUTINE *PRTL_GENERIC_FREE_ROUTINE;
+
+typedef VOID
+(NTAPI RTL_AVL_FREE_ROUTINE)(
+    struct _RTL_AVL_TABLE *Table,
+    PVOID Buffer);
+typedef RTL_AVL_FREE_ROUTINE *PRTL_AVL_FREE_ROUTINE;
+
+typedef struct _RTL_GENERIC_TABLE
+{
+    PRTL_SPLAY_LINKS TableRoot;
+    LIST_ENTRY InsertOrderList;
+    PLIST_ENTRY OrderedPointer;
+    ULONG WhichOrderedElement;
+    ULONG NumberGenericTableElements;
+    PRTL_GENERIC_COMPARE_ROUTINE CompareRoutine;
+    PRTL_GENERIC_ALLOCATE_ROUTINE AllocateRoutine;
+    PRTL_GENERIC_FREE_ROUTINE FreeRoutine;
+    PVOID TableContext;
+} RTL_GENERIC_TABLE, *PRTL_GENERIC_TABLE;
+
+typedef struct _RTL_AVL_TABLE
+{
+    RTL_BALANCED_LINKS BalancedRoot;
+    PVOID OrderedPointer;
+    ULONG WhichOrderedElement;
+    ULONG NumberGenericTableElements;
+    ULONG DepthOfTree;
+    PRTL_BALANCED_LINKS RestartKey;
+    ULONG DeleteCount;
+    PRTL_AVL_COMPARE_ROUTINE CompareRoutine;
+    PRTL_AVL_ALLOCATE_ROUTINE AllocateRoutine;
+    PRTL_AVL_FREE_ROUTINE FreeRoutine;
+    PVOID TableContext;
+} RTL_AVL_TABLE, *PRTL_AVL_TABLE;
+
+/* RTL unicode prefix table */
+typedef struct _UNICODE_PREFIX_TABLE_ENTRY
+{
+    CSHORT NodeTypeCode;
+    CSHORT NameLength;
+    struct _UNICODE_PREFIX_TABLE_ENTRY *NextPrefixTree;
+    struct _UNICODE_PREFIX_TABLE_ENTRY *CaseMatch;
+    RTL_SPLAY_LINKS Links;
+    PUNICODE_STRING Prefix;
+} UNICODE_PREFIX_TABLE_ENTRY, *PUNICODE_PREFIX_TABLE_ENTRY;
+
+typedef struct _UNICODE_PREFIX_TABLE
+{
+    CSHORT NodeTypeCode;
+    CSHORT NameLength;
+    PUNICODE_PREFIX_TABLE_ENTRY NextPrefixTree;
+    PUNICODE_PREFIX_TABLE_ENTRY LastNextEntry;
+} UNICODE_PREFIX_TABLE, *PUNICODE_PREFIX_TABLE;
+
+/* RTL handle table */
+#define RTL_HANDLE_VALID        0x1
+
+typedef struct _RTL_HANDLE_TABLE_ENTRY
+{
+    union
+    {
+        ULONG Flags;
+        struct _RTL_HANDLE_TABLE_ENTRY *NextFree;
+    };
+} RTL_HANDLE_TABLE_ENTRY, *PRTL_HANDLE_TABLE_ENTRY;
+
+typedef struct _RTL_HANDLE_TABLE
+{
+    ULONG MaximumNumberOfHandles;
+    ULONG SizeOfHandleTableEntry;
+    ULONG Reserved[2];
+    PRTL_HANDLE_TABLE_ENTRY FreeHandles;
+    PRTL_HANDLE_TABLE_ENTRY CommittedHandles;
+    PRTL_HANDLE_TABLE_ENTRY UnCommittedHandles;
+    PRTL_HANDLE_TABLE_ENTRY MaxReservedHandles;
+} RTL_HANDLE_TABLE, *PRTL_HANDLE_TABLE;
+
+/* RTL range lists */
+#define RTL_RANGE_LIST_ADD_IF_CONFLICT                      0x00000001
+#define RTL_RANGE_LIST_ADD_SHARED                           0x00000002
+
+#define RTL_RANGE_LIST_SHARED_OK                            0x00000001
+#define RTL_RANGE_LIST_NULL_CONFLICT_OK                     0x00000002
+
+#define RTL_RANGE_SHARED                                    0x01
+#define RTL_RANGE_CONFLICT                                  0x02
+
+struct _RTL_RANGE;
+
+typedef BOOLEAN
+(NTAPI *PRTL_CONFLICT_RANGE_CALLBACK)(
+    PVOID Context,
+    struct _RTL_RANGE *Range);
+
+typedef struct _RTL_RANGE_LIST
+{
+    LIST_ENTRY ListHead;
+    ULONG Flags;
+    ULONG Count;
+    ULONG Stamp;
+} RTL_RANGE_LIST, *PRTL_RANGE_LIST;
+
+typedef struct _RTL_RANGE
+{
+    ULONGLONG Start;
+    ULONGLONG End;
+    PVOID UserData;
+    PVOID Owner;
+    UCHAR Attributes;
+    UCHAR Flags;
+} RTL_RANGE, *PRTL_RANGE;
+
+typedef struct _RANGE_LIST_ITERATOR
+{
+    PLIST_ENTRY RangeListHead;
+    PLIST_ENTRY MergedHead;
+    PVOID Current;
+    ULONG Stamp;
+} RTL_RANGE_LIST_ITERATOR, *PRTL_RANGE_LIST_ITERATOR;
+
+/* Splay trees */
+PRTL_SPLAY_LINKS NTAPI RtlSplay(PRTL_SPLAY_LINKS Links);
+PRTL_SPLAY_LINKS NTAPI RtlDelete(PRTL_SPLAY_LINKS Links);
+VOID NTAPI RtlDeleteNoSplay(PRTL_SPLAY_LINKS Links, PRTL_SPLAY_LINKS *Root);
+PRTL_SPLAY_LINKS NTAPI RtlSubtreeSuccessor(PRTL_SPLAY_LINKS Links);
+PRTL_SPLAY_LINKS NTAPI RtlSubtreePredecessor(PRTL_SPLAY_LINKS Links);
+PRTL_SPLAY_LINKS NTAPI RtlRealSuccessor(PRTL_SPLAY_LINKS Links);
+PRTL_SPLAY_LINKS NTAPI RtlRealPredecessor(PRTL_SPLAY_LINKS Links);
+
+/* Generic tables */
+VOID NTAPI
+RtlInitializeGenericTable(
+    PRTL_GENERIC_TABLE Table,
+    PRTL_GENERIC_COMPARE_ROUTINE CompareRoutine,
+    PRTL_GENERIC_ALLOCATE_ROUTINE AllocateRoutine,
+    PRTL_GENERIC_FREE_ROUTINE FreeRoutine,
+    PVOID TableContext);
+
+PVOID NTAPI
+RtlInsertElementGenericTable(
+    PRTL_GENERIC_TABLE Table,
+    PVOID Buffer,
+    CLONG BufferSize,
+    PBOOLEAN NewElement);
+
+PVOID NTAPI
+RtlInsertElementGenericTableFull(
+    PRTL_GENERIC_TABLE Table,
+    PVOID Buffer,
+    CLONG BufferSize,
+    PBOOLEAN NewElement,
+    PVOID NodeOrParent,
+    TABLE_SEARCH_RESULT SearchResult);
+
+BOOLEAN NTAPI RtlIsGenericTableEmpty(PRTL_GENERIC_TABLE Table);
+ULONG NTAPI RtlNumberGenericTableElements(PRTL_GENERIC_TABLE Table);
+PVOID NTAPI RtlLookupElementGenericTable(PRTL_GENERIC_TABLE Table, PVOID Buffer);
+
+PVOID NTAPI
+RtlLookupElementGenericTableFull(
+    PRTL_GENERIC_TABLE Table,
+    PVOID Buffer,
+    OUT PVOID *NodeOrParent,
+    OUT TABLE_SEARCH_RESULT *SearchResult);
+
+BOOLEAN NTAPI RtlDeleteElementGenericTable(PRTL_GENERIC_TABLE Table, PVOID Buffer);
+PVOID NTAPI RtlEnumerateGenericTable(PRTL_GENERIC_TABLE Table, BOOLEAN Restart);
+PVOID NTAPI RtlEnumerateGenericTableWithoutSplaying(PRTL_GENERIC_TABLE Table, PVOID *RestartKey);
+PVOID NTAPI RtlGetElementGenericTable(PRTL_GENERIC_TABLE Table, ULONG I);
+
+/* AVL tables */
+VOID NTAPI
+RtlInitializeGenericTableAvl(
+    PRTL_AVL_TABLE Table,
+    PRTL_AVL_COMPARE_ROUTINE CompareRoutine,
+    PRTL_AVL_ALLOCATE_ROUTINE AllocateRoutine,
+    PRTL_AVL_FREE_ROUTINE FreeRoutine,
+    PVOID TableContext);
+
+PVOID NTAPI
+RtlInsertElementGenericTableAvl(
+    PRTL_AVL_TABLE Table,
+    PVOID Buffer,
+    CLONG BufferSize,
+    PBOOLEAN NewElement);
+
+PVOID NTAPI
+RtlInsertElementGenericTableFullAvl(
+    PRTL_AVL_TABLE Table,
+    PVOID Buffer,
+    CLONG BufferSize,
+    PBOOLEAN NewElement,
+    PVOID NodeOrParent,
+    TABLE_SEARCH_RESULT SearchResult);
+
+BOOLEAN NTAPI RtlIsGenericTableEmptyAvl(PRTL_AVL_TABLE Table);
+ULONG NTAPI RtlNumberGenericTableElementsAvl(PRTL_AVL_TABLE Table);
+PVOID NTAPI RtlLookupElementGenericTableAvl(PRTL_AVL_TABLE Table, PVOID Buffer);
+
+PVOID NTAPI
+RtlLookupElementGenericTableFullAvl(
+    PRTL_AVL_TABLE Table,
+    PVOID Buffer,
+    OUT PVOID *NodeOrParent,
+    OUT TABLE_SEARCH_RESULT *SearchResult);
+
+PVOID NTAPI
+RtlLookupFirstMatchingElementGenericTableAvl(
+    PRTL_AVL_TABLE Table,
+    PVOID Buffer,
+    OUT PVOID *RestartKey);
+
+BOOLEAN NTAPI RtlDeleteElementGenericTableAvl(PRTL_AVL_TABLE Table, PVOID Buffer);
+PVOID NTAPI RtlEnumerateGenericTableAvl(PRTL_AVL_TABLE Table, BOOLEAN Restart);
+PVOID NTAPI RtlEnumerateGenericTableWithoutSplayingAvl(PRTL_AVL_TABLE Table, PVOID *RestartKey);
+PVOID NTAPI RtlGetElementGenericTableAvl(PRTL_AVL_TABLE Table, ULONG I);
+
+/* Bitmaps */
+VOID NTAPI RtlInitializeBitMap(PRTL_BITMAP BitMapHeader, PULONG BitMapBuffer, ULONG SizeOfBitMap);
+VOID NTAPI RtlClearAllBits(PRTL_BITMAP BitMapHeader);
+VOID NTAPI RtlSetAllBits(PRTL_BITMAP BitMapHeader);
+VOID NTAPI RtlClearBits(PRTL_BITMAP BitMapHeader, ULONG StartingIndex, ULONG NumberToClear);
+VOID NTAPI RtlSetBits(PRTL_BITMAP BitMapHeader, ULONG StartingIndex, ULONG NumberToSet);
+BOOLEAN NTAPI RtlAreBitsClear(PRTL_BITMAP BitMapHeader, ULONG StartingIndex, ULONG Length);
+ULONG NTAPI RtlNumberOfSetBits(PRTL_BITMAP BitMapHeader);
+ULONG NTAPI RtlFindClearBits(PRTL_BITMAP BitMapHeader, ULONG NumberToFind, ULONG HintIndex);
+ULONG NTAPI RtlFindClearBitsAndSet(PRTL_BITMAP BitMapHeader, ULONG NumberToFind, ULONG HintIndex);
+ULONG NTAPI RtlFindLongestRunClear(PRTL_BITMAP BitMapHeader, PULONG StartingIndex);
+ULONG NTAPI RtlFindClearRuns(PRTL_BITMAP BitMapHeader, PRTL_BITMAP_RUN RunArray, ULONG SizeOfRunArray, BOOLEAN LocateLongestRuns);
+
+VOID NTAPI RtlInitializeBitMap64(PRTL_BITMAP64 BitMapHeader, PULONG64 BitMapBuffer, ULONG SizeOfBitMap);
+VOID NTAPI RtlClearAllBits64(PRTL_BITMAP64 BitMapHeader);
+VOID NTAPI RtlClearBits64(PRTL_BITMAP64 BitMapHeader, ULONG64 StartingIndex, ULONG64 NumberToClear);
+VOID NTAPI RtlSetBits64(PRTL_BITMAP64 BitMapHeader, ULONG64 StartingIndex, ULONG64 NumberToSet);
+ULONG64 NTAPI RtlNumberOfSetBits64(PRTL_BITMAP64 BitMapHeader);
+ULONG64 NTAPI RtlFindClearBits64(PRTL_BITMAP64 BitMapHeader, ULONG64 NumberToFind, ULONG64 HintIndex);
+ULONG64 NTAPI RtlFindClearBitsAndSet64(PRTL_BITMAP64 BitMapHeader, ULONG64 NumberToFind, ULONG64 HintIndex);
+ULONG64 NTAPI RtlFindLongestRunClear64(PRTL_BITMAP64 BitMapHeader, PULONG64 StartingIndex);
+
+/* Unicode prefix tables */
+VOID NTAPI RtlInitializeUnicodePrefix(PUNICODE_PREFIX_TABLE PrefixTable);
+
+BOOLEAN NTAPI
+RtlInsertUnicodePrefix(
+    PUNICODE_PREFIX_TABLE PrefixTable,
+    PUNICODE_STRING Prefix,
+    PUNICODE_PREFIX_TABLE_ENTRY PrefixTableEntry);
+
+PUNICODE_PREFIX_TABLE_ENTRY NTAPI
+RtlFindUnicodePrefix(
+    PUNICODE_PREFIX_TABLE PrefixTable,
+    PUNICODE_STRING FullName,
+    ULONG CaseInsensitiveIndex);
+
+PUNICODE_PREFIX_TABLE_ENTRY NTAPI
+RtlNextUnicodePrefix(
+    PUNICODE_PREFIX_TABLE PrefixTable,
+    BOOLEAN Restart);
+
+VOID NTAPI
+RtlRemoveUnicodePrefix(
+    PUNICODE_PREFIX_TABLE PrefixTable,
+    PUNICODE_PREFIX_TABLE_ENTRY PrefixTableEntry);
+
+/* Handle tables */
+VOID NTAPI RtlInitializeHandleTable(ULONG TableSize, ULONG HandleSize, PRTL_HANDLE_TABLE HandleTable);
+VOID NTAPI RtlDestroyHandleTable(PRTL_HANDLE_TABLE HandleTable);
+PRTL_HANDLE_TABLE_ENTRY NTAPI RtlAllocateHandle(PRTL_HANDLE_TABLE HandleTable, PULONG Index);
+BOOLEAN NTAPI RtlFreeHandle(PRTL_HANDLE_TABLE HandleTable, PRTL_HANDLE_TABLE_ENTRY Handle);
+BOOLEAN NTAPI RtlIsValidHandle(PRTL_HANDLE_TABLE HandleTable, PRTL_HANDLE_TABLE_ENTRY Handle);
+BOOLEAN NTAPI RtlIsValidIndexHandle(PRTL_HANDLE_TABLE HandleTable, ULONG Index, PRTL_HANDLE_TABLE_ENTRY *Handle);
+
+/* Range lists */
+VOID NTAPI RtlInitializeRangeList(PRTL_RANGE_LIST RangeList);
+VOID NTAPI RtlFreeRangeList(PRTL_RANGE_LIST RangeList);
+
+NTSTATUS NTAPI
+RtlAddRange(
+    PRTL_RANGE_LIST RangeList,
+    ULONGLONG Start,
+    ULONGLONG End,
+    UCHAR Attributes,
+    ULONG Flags,
+    PVOID UserData,
+    PVOID Owner);
+
+NTSTATUS NTAPI RtlDeleteRange(PRTL_RANGE_LIST RangeList, ULONGLONG Start, ULONGLONG End, PVOID Owner);
+
+NTSTATUS NTAPI
+RtlFindRange(
+    PRTL_RANGE_LIST RangeList,
+    ULONGLONG Minimum,
+    ULONGLONG Maximum,
+    ULONG Length,
+    ULONG Alignment,
+    ULONG Flags,
+    UCHAR AttributeAvailableMask,
+    PVOID Context,
+    PRTL_CONFLICT_RANGE_CALLBACK Callback,
+    PULONGLONG Start);
+
+NTSTATUS NTAPI
+RtlIsRangeAvailable(
+    PRTL_RANGE_LIST RangeList,
+    ULONGLONG Start,
+    ULONGLONG End,
+    ULONG Flags,
+    UCHAR AttributeAvailableMask,
+    PVOID Context,
+    PRTL_CONFLICT_RANGE_CALLBACK Callback,
+    PBOOLEAN Available);
+
+NTSTATUS NTAPI RtlGetFirstRange(PRTL_RANGE_LIST RangeList, PRTL_RANGE_LIST_ITERATOR Iterator, PRTL_RANGE *Range);
+NTSTATUS NTAPI RtlGetNextRange(PRTL_RANGE_LIST_ITERATOR Iterator, PRTL_RANGE *Range, BOOLEAN MoveForwards);
+NTSTATUS NTAPI RtlCopyRangeList(PRTL_RANGE_LIST CopyRangeList, PRTL_RANGE_LIST RangeList);
+NTSTATUS NTAPI RtlDeleteOwnersRanges(PRTL_RANGE_LIST RangeList, PVOID Owner);
+NTSTATUS NTAPI RtlInvertRangeList(PRTL_RANGE_LIST InvertedRangeList, PRTL_RANGE_LIST RangeList);
+NTSTATUS NTAPI RtlMergeRangeLists(PRTL_RANGE_LIST MergedRangeList, PRTL_RANGE_LIST RangeList1, PRTL_RANGE_LIST RangeList2, ULONG Flags);
+
+#endif /* _RTLBENCH_H */
@@ -0,0 +1,8 @@
+/*
+ * PROJECT:     ReactOS RTL Benchmarks
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     32-bit RTL bitmaps
+ */
+
+#include "rtlbench.h"
+#include <bitmap.c>
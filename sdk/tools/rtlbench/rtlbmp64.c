@@ -0,0 +1,8 @@
+/*
+ * PROJECT:     ReactOS RTL Benchmarks
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     64-bit RTL bitmaps
+ */
+
+#include "rtlbench.h"
+#include <bitmap64.c>
@@ -0,0 +1,137 @@
+#!/bin/bash
+#
+# PROJECT:     ReactOS Storport Benchmarks
+# LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+# PURPOSE:     Runs fio against a storport (storahci) disk of a ReactOS guest in QEMU
+#
+# The guest boots from IDE, so the only storport device is the raw test disk
+# on the AHCI controller. The jobs disk (FAT, IDE) carries fio.exe, the job
+# file and run.cmd, and receives one fio JSON report per queue depth. The
+# guest image is opened with snapshot=on and is never modified.
+#
+# One time guest setup, in the image passed with -i:
+#   - automatic logon
+#   - HKLM\Software\Microsoft\Windows\CurrentVersion\Run: storbench = D:\run.cmd
+#   - the disk number of the AHCI disk, see -n (it follows the two IDE disks)
+#
+# Needs qemu-system-i386 (or $QEMU), qemu-img, mtools and python3 on the host.
+# The results are printed as CSV:
+#
+#   iodepth,job,iops,mb_per_s,mean_latency_us
+#
+
+set -e
+
+QEMU=${QEMU:-qemu-system-i386}
+SCRIPT_DIR=$(cd "$(dirname "$0")" && pwd)
+
+IMAGE=
+FIO=
+OUTDIR=storbench.out
+DEPTHS="1 4 16 32"
+DISK=2
+MEMORY=1024
+TIMEOUT=1800
+
+usage()
+{
+    echo "Usage: storbench.sh -i image -f fio.exe [-o outdir] [-d depths] [-n disk] [-m MB] [-t seconds]"
+    echo "  -i image    ReactOS guest disk image, set up as described in this script"
+    echo "  -f fio.exe  Windows fio binary copied to the jobs disk"
+    echo "  -o outdir   Directory for the work files and reports (default $OUTDIR)"
+    echo "  -d depths   Queue depths to run (default \"$DEPTHS\")"
+    echo "  -n disk     PhysicalDrive number of the AHCI disk in the guest (default $DISK)"
+    echo "  -m MB       Guest memory (default $MEMORY)"
+    echo "  -t seconds  Give up after this long (default $TIMEOUT)"
+    exit 1
+}
+
+while getopts "i:f:o:d:n:m:t:" opt; do
+    case $opt in
+        i) IMAGE=$OPTARG ;;
+        f) FIO=$OPTARG ;;
+        o) OUTDIR=$OPTARG ;;
+        d) DEPTHS=$OPTARG ;;
+        n) DISK=$OPTARG ;;
+        m) MEMORY=$OPTARG ;;
+        t) TIMEOUT=$OPTARG ;;
+        *) usage ;;
+    esac
+done
+
+if [ -z "$IMAGE" ] || [ -z "$FIO" ]; then
+    usage
+fi
+
+for tool in "$QEMU" qemu-img mformat mcopy python3; do
+    if ! command -v "$tool" > /dev/null; then
+        echo "storbench: $tool not found" >&2
+        exit 1
+    fi
+done
+
+mkdir -p "$OUTDIR"
+rm -f "$OUTDIR"/test.raw "$OUTDIR"/jobs.img "$OUTDIR"/run.cmd "$OUTDIR"/qd*.json
+
+# A fresh test disk every run, fully allocated so that the host doesn't add
+# allocation cost to the first writes
+qemu-img create -q -f raw -o preallocation=full "$OUTDIR/test.raw" 2G
+
+# run.cmd runs every depth, then powers the guest off, which ends QEMU
+{
+    echo "@echo off"
+    echo "set TESTDISK=\\\\.\\PhysicalDrive$DISK"
+    for depth in $DEPTHS; do
+        echo "set IODEPTH=$depth"
+        echo "%~d0\\fio.exe --output-format=json --output=%~d0\\qd$depth.json %~d0\\storbench.fio"
+    done
+    echo "shutdown -s -t 0"
+} | sed 's/$/\r/' > "$OUTDIR/run.cmd"
+
+# 64 MB FAT superfloppy
+mformat -i "$OUTDIR/jobs.img" -C -t 64 -h 64 -s 32 ::
+mcopy -i "$OUTDIR/jobs.img" "$FIO" ::fio.exe
+mcopy -i "$OUTDIR/jobs.img" "$SCRIPT_DIR/storbench.fio" "$OUTDIR/run.cmd" ::
+
+ACCEL=tcg
+if [ -w /dev/kvm ]; then
+    ACCEL=kvm
+fi
+
+# cache=none keeps the host page cache out of the numbers
+timeout "$TIMEOUT" "$QEMU" \
+    -accel $ACCEL -m "$MEMORY" -no-reboot -display none \
+    -serial file:"$OUTDIR/serial.log" \
+    -drive file="$IMAGE",index=0,media=disk,snapshot=on \
+    -drive file="$OUTDIR/jobs.img",index=1,media=disk,format=raw \
+    -device ahci,id=ahci \
+    -drive if=none,id=test,file="$OUTDIR/test.raw",format=raw,cache=none \
+    -device ide-hd,drive=test,bus=ahci.0 || {
+    echo "storbench: QEMU failed or timed out, see $OUTDIR/serial.log" >&2
+    exit 1
+}
+
+for depth in $DEPTHS; do
+    mcopy -n -i "$OUTDIR/jobs.img" ::qd$depth.json "$OUTDIR/" || {
+        echo "storbench: no report for iodepth $depth" >&2
+        exit 1
+    }
+done
+
+python3 - "$OUTDIR" $DEPTHS << 'EOF'
+import json
+import sys
+
+print("iodepth,job,iops,mb_per_s,mean_latency_us")
+for depth in sys.argv[2:]:
+    with open("%s/qd%s.json" % (sys.argv[1], depth)) as f:
+        report = json.load(f)
+    for job in report["jobs"]:
+        for rw in ("read", "write"):
+            stats = job[rw]
+            if stats["io_bytes"] == 0:
+                continue
+            print("%s,%s,%.0f,%.1f,%.1f" % (depth, job["jobname"], stats["iops"],
+                                            stats["bw"] / 1024.0,
+                                            stats["clat_ns"]["mean"] / 1000.0))
+EOF
@@ -0,0 +1,650 @@
+/*
+ * PROJECT:     ReactOS Windows Imaging Component Benchmarks
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Host benchmark for the format converter's row kernels
+ *
+ * Builds windowscodecs' pixconv.c for the host and runs the common
+ * conversions of WICConvertBitmapSource two ways: with the converter's old
+ * per-pixel loops, including the second pass some of them took over the
+ * whole image, and with the kernels the way the converter now calls them.
+ * Both have to give the same bytes, for a range of small widths too, before
+ * anything is timed. One CSV line per conversion:
+ *
+ *   conversion,width,height,runs,old_ns,new_ns,old_mpix_s,new_mpix_s,checksum
+ *
+ * The checksum doesn't depend on the SIMD loops, so builds with and
+ * without them can be compared.
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include <typedefs.h>
+#include <string.h>
+#include "pixconv.h"
+
+#define min(a, b)       (((a) < (b)) ? (a) : (b))
+
+#define WIDTH           1920
+#define HEIGHT          1080
+
+typedef VOID (*CONVERT)(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height);
+
+static UINT Palette[256];
+
+/* THE OLD LOOPS **************************************************************/
+
+static VOID
+OldReverse(BYTE *Bits, UINT Width, UINT Height)
+{
+    UINT x, y;
+    BYTE *Pixel, Temp;
+
+    for (y = 0; y < Height; y++)
+    {
+        Pixel = Bits + Width * 4 * y;
+        for (x = 0; x < Width; x++)
+        {
+            Temp = Pixel[2];
+            Pixel[2] = Pixel[0];
+            Pixel[0] = Temp;
+            Pixel += 4;
+        }
+    }
+}
+
+static VOID
+OldPremultiply(BYTE *Bits, UINT Width, UINT Height)
+{
+    UINT x, y, Stride = Width * 4;
+
+    for (y = 0; y < Height; y++)
+        for (x = 0; x < Width; x++)
+        {
+            BYTE Alpha = Bits[Stride * y + 4 * x + 3];
+            if (Alpha != 255)
+            {
+                Bits[Stride * y + 4 * x] = Bits[Stride * y + 4 * x] * Alpha / 255;
+                Bits[Stride * y + 4 * x + 1] = Bits[Stride * y + 4 * x + 1] * Alpha / 255;
+                Bits[Stride * y + 4 * x + 2] = Bits[Stride * y + 4 * x + 2] * Alpha / 255;
+            }
+        }
+}
+
+static VOID
+OldUnpremultiply(BYTE *Bits, UINT Width, UINT Height)
+{
+    UINT x, y, Stride = Width * 4;
+
+    for (y = 0; y < Height; y++)
+        for (x = 0; x < Width; x++)
+        {
+            BYTE Alpha = Bits[Stride * y + 4 * x + 3];
+            if (Alpha != 0 && Alpha != 255)
+            {
+                Bits[Stride * y + 4 * x] = Bits[Stride * y + 4 * x] * 255 / Alpha;
+                Bits[Stride * y + 4 * x + 1] = Bits[Stride * y + 4 * x + 1] * 255 / Alpha;
+                Bits[Stride * y + 4 * x + 2] = Bits[Stride * y + 4 * x + 2] * 255 / Alpha;
+            }
+        }
+}
+
+static VOID
+OldBgr24ToBgra(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT x, n = Width * Height;
+
+    for (x = 0; x < n; x++)
+    {
+        *Dst++ = *Src++;
+        *Dst++ = *Src++;
+        *Dst++ = *Src++;
+        *Dst++ = 255;
+    }
+}
+
+static VOID
+OldRgb24ToBgra(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT x, n = Width * Height;
+    BYTE Tmp[3];
+
+    for (x = 0; x < n; x++)
+    {
+        Tmp[0] = *Src++;
+        Tmp[1] = *Src++;
+        Tmp[2] = *Src++;
+        *Dst++ = Tmp[2];
+        *Dst++ = Tmp[1];
+        *Dst++ = Tmp[0];
+        *Dst++ = 255;
+    }
+}
+
+static VOID
+OldBgr24ToRgba(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    OldBgr24ToBgra(Src, Dst, Width, Height);
+    OldReverse(Dst, Width, Height);
+}
+
+static VOID
+OldBgr24ToPbgra(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    OldBgr24ToBgra(Src, Dst, Width, Height);
+    OldPremultiply(Dst, Width, Height);
+}
+
+static VOID
+OldBgraToBgr24(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT x, n = Width * Height;
+
+    for (x = 0; x < n; x++)
+    {
+        *Dst++ = *Src++;
+        *Dst++ = *Src++;
+        *Dst++ = *Src++;
+        Src++;
+    }
+}
+
+static VOID
+OldBgraToRgb24(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT x, n = Width * Height;
+    BYTE Tmp[3];
+
+    for (x = 0; x < n; x++)
+    {
+        Tmp[0] = *Src++;
+        Tmp[1] = *Src++;
+        Tmp[2] = *Src++;
+        Src++;
+        *Dst++ = Tmp[2];
+        *Dst++ = Tmp[1];
+        *Dst++ = Tmp[0];
+    }
+}
+
+static VOID
+OldBgrxToBgra(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT x, y, Stride = Width * 4;
+
+    memcpy(Dst, Src, Stride * Height);
+    for (y = 0; y < Height; y++)
+        for (x = 0; x < Width; x++)
+            Dst[Stride * y + 4 * x + 3] = 0xff;
+}
+
+static VOID
+OldBgraToRgba(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    memcpy(Dst, Src, Width * 4 * Height);
+    OldReverse(Dst, Width, Height);
+}
+
+static VOID
+OldBgraToPbgra(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    memcpy(Dst, Src, Width * 4 * Height);
+    OldPremultiply(Dst, Width, Height);
+}
+
+static VOID
+OldPbgraToBgra(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    memcpy(Dst, Src, Width * 4 * Height);
+    OldUnpremultiply(Dst, Width, Height);
+}
+
+static VOID
+OldPbgraToPrgba(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    OldPbgraToBgra(Src, Dst, Width, Height);
+    OldReverse(Dst, Width, Height);
+    OldPremultiply(Dst, Width, Height);
+}
+
+static VOID
+OldGray8ToBgra(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT x, n = Width * Height;
+    DWORD *Pixel = (DWORD *)Dst;
+
+    for (x = 0; x < n; x++)
+    {
+        *Pixel++ = 0xff000000 | (*Src << 16) | (*Src << 8) | *Src;
+        Src++;
+    }
+}
+
+static VOID
+OldIndexed8ToBgra(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT x, n = Width * Height;
+    DWORD *Pixel = (DWORD *)Dst;
+
+    for (x = 0; x < n; x++)
+        *Pixel++ = Palette[*Src++];
+}
+
+static VOID
+OldIndexed8ToPbgra(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    OldIndexed8ToBgra(Src, Dst, Width, Height);
+    OldPremultiply(Dst, Width, Height);
+}
+
+static VOID
+OldBgr555ToBgra(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT x, n = Width * Height;
+    const WORD *SrcPixel = (const WORD *)Src;
+    DWORD *Pixel = (DWORD *)Dst;
+
+    for (x = 0; x < n; x++)
+    {
+        WORD v = *SrcPixel++;
+        *Pixel++ = 0xff000000 |
+                   ((v << 9) & 0xf80000) | ((v << 4) & 0x070000) |
+                   ((v << 6) & 0x00f800) | ((v << 1) & 0x000700) |
+                   ((v << 3) & 0x0000f8) | ((v >> 2) & 0x000007);
+    }
+}
+
+static VOID
+OldBgra5551ToBgra(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT x, n = Width * Height;
+    const WORD *SrcPixel = (const WORD *)Src;
+    DWORD *Pixel = (DWORD *)Dst;
+
+    for (x = 0; x < n; x++)
+    {
+        WORD v = *SrcPixel++;
+        *Pixel++ = ((v & 0x8000) ? 0xff000000 : 0) |
+                   ((v << 9) & 0xf80000) | ((v << 4) & 0x070000) |
+                   ((v << 6) & 0x00f800) | ((v << 1) & 0x000700) |
+                   ((v << 3) & 0x0000f8) | ((v >> 2) & 0x000007);
+    }
+}
+
+static VOID
+OldBgr565ToBgra(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT x, n = Width * Height;
+    const WORD *SrcPixel = (const WORD *)Src;
+    DWORD *Pixel = (DWORD *)Dst;
+
+    for (x = 0; x < n; x++)
+    {
+        WORD v = *SrcPixel++;
+        *Pixel++ = 0xff000000 |
+                   ((v << 8) & 0xf80000) | ((v << 3) & 0x070000) |
+                   ((v << 5) & 0x00fc00) | ((v >> 1) & 0x000300) |
+                   ((v << 3) & 0x0000f8) | ((v >> 2) & 0x000007);
+    }
+}
+
+static VOID
+OldBgr565ToRgba(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    OldBgr565ToBgra(Src, Dst, Width, Height);
+    OldReverse(Dst, Width, Height);
+}
+
+/* WHAT THE CONVERTER DOES NOW ************************************************/
+
+static VOID
+NewBgr24ToBgra(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT y;
+
+    for (y = 0; y < Height; y++)
+        pixconv_24_to_32(Src + y * Width * 3, Dst + y * Width * 4, Width, FALSE);
+}
+
+static VOID
+NewRgb24ToBgra(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT y;
+
+    for (y = 0; y < Height; y++)
+        pixconv_24_to_32(Src + y * Width * 3, Dst + y * Width * 4, Width, TRUE);
+}
+
+/* Opaque, so premultiplying is skipped */
+#define NewBgr24ToRgba  NewRgb24ToBgra
+#define NewBgr24ToPbgra NewBgr24ToBgra
+
+static VOID
+NewBgraToBgr24(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT y;
+
+    for (y = 0; y < Height; y++)
+        pixconv_32_to_24(Src + y * Width * 4, Dst + y * Width * 3, Width, FALSE);
+}
+
+static VOID
+NewBgraToRgb24(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT y;
+
+    for (y = 0; y < Height; y++)
+        pixconv_32_to_24(Src + y * Width * 4, Dst + y * Width * 3, Width, TRUE);
+}
+
+static VOID
+NewBgrxToBgra(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT y;
+
+    memcpy(Dst, Src, Width * 4 * Height);
+    for (y = 0; y < Height; y++)
+        pixconv_set_alpha(Dst + y * Width * 4, Width);
+}
+
+static VOID
+NewBgraToRgba(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT y;
+
+    memcpy(Dst, Src, Width * 4 * Height);
+    for (y = 0; y < Height; y++)
+        pixconv_swap_rb(Dst + y * Width * 4, Width);
+}
+
+static VOID
+NewBgraToPbgra(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT y;
+
+    memcpy(Dst, Src, Width * 4 * Height);
+    for (y = 0; y < Height; y++)
+        pixconv_premultiply(Dst + y * Width * 4, Width);
+}
+
+static VOID
+NewPbgraToBgra(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT y;
+
+    memcpy(Dst, Src, Width * 4 * Height);
+    for (y = 0; y < Height; y++)
+        pixconv_unpremultiply(Dst + y * Width * 4, Width);
+}
+
+static VOID
+NewPbgraToPrgba(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT y;
+
+    memcpy(Dst, Src, Width * 4 * Height);
+    for (y = 0; y < Height; y++)
+    {
+        pixconv_unpremultiply(Dst + y * Width * 4, Width);
+        pixconv_premultiply(Dst + y * Width * 4, Width);
+        pixconv_swap_rb(Dst + y * Width * 4, Width);
+    }
+}
+
+static VOID
+NewGray8ToBgra(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT y;
+
+    for (y = 0; y < Height; y++)
+        pixconv_gray8_to_32(Src + y * Width, Dst + y * Width * 4, Width);
+}
+
+static VOID
+NewIndexed8ToBgra(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT y;
+
+    for (y = 0; y < Height; y++)
+        pixconv_indexed8_to_32(Src + y * Width, Dst + y * Width * 4, Width, Palette);
+}
+
+/* The palette is premultiplied instead of the pixels */
+static VOID
+NewIndexed8ToPbgra(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT Colors[256], y;
+
+    memcpy(Colors, Palette, sizeof(Colors));
+    pixconv_premultiply((BYTE *)Colors, 256);
+    for (y = 0; y < Height; y++)
+        pixconv_indexed8_to_32(Src + y * Width, Dst + y * Width * 4, Width, Colors);
+}
+
+static VOID
+NewBgr555ToBgra(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT y;
+
+    for (y = 0; y < Height; y++)
+        pixconv_555_to_32(Src + y * Width * 2, Dst + y * Width * 4, Width, FALSE);
+}
+
+static VOID
+NewBgra5551ToBgra(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT y;
+
+    for (y = 0; y < Height; y++)
+        pixconv_555_to_32(Src + y * Width * 2, Dst + y * Width * 4, Width, TRUE);
+}
+
+static VOID
+NewBgr565ToBgra(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT y;
+
+    for (y = 0; y < Height; y++)
+        pixconv_565_to_32(Src + y * Width * 2, Dst + y * Width * 4, Width);
+}
+
+static VOID
+NewBgr565ToRgba(const BYTE *Src, BYTE *Dst, UINT Width, UINT Height)
+{
+    UINT y;
+
+    for (y = 0; y < Height; y++)
+    {
+        pixconv_565_to_32(Src + y * Width * 2, Dst + y * Width * 4, Width);
+        pixconv_swap_rb(Dst + y * Width * 4, Width);
+    }
+}
+
+/* TESTS **********************************************************************/
+
+typedef struct _CONVERSION
+{
+    const char *Name;
+    UINT SrcBytes, DstBytes;    /* per pixel */
+    CONVERT Old, New;
+} CONVERSION;
+
+#define CONVERSION(name, src, dst, func) { name, src, dst, Old##func, New##func }
+
+static const CONVERSION Conversions[] =
+{
+    CONVERSION("24bppBGR-32bppBGRA", 3, 4, Bgr24ToBgra),
+    CONVERSION("24bppRGB-32bppBGRA", 3, 4, Rgb24ToBgra),
+    CONVERSION("24bppBGR-32bppRGBA", 3, 4, Bgr24ToRgba),
+    CONVERSION("24bppBGR-32bppPBGRA", 3, 4, Bgr24ToPbgra),
+    CONVERSION("32bppBGRA-24bppBGR", 4, 3, BgraToBgr24),
+    CONVERSION("32bppBGRA-24bppRGB", 4, 3, BgraToRgb24),
+    CONVERSION("32bppBGR-32bppBGRA", 4, 4, BgrxToBgra),
+    CONVERSION("32bppBGRA-32bppRGBA", 4, 4, BgraToRgba),
+    CONVERSION("32bppBGRA-32bppPBGRA", 4, 4, BgraToPbgra),
+    CONVERSION("32bppPBGRA-32bppBGRA", 4, 4, PbgraToBgra),
+    CONVERSION("32bppPBGRA-32bppPRGBA", 4, 4, PbgraToPrgba),
+    CONVERSION("8bppGray-32bppBGRA", 1, 4, Gray8ToBgra),
+    CONVERSION("8bppIndexed-32bppBGRA", 1, 4, Indexed8ToBgra),
+    CONVERSION("8bppIndexed-32bppPBGRA", 1, 4, Indexed8ToPbgra),
+    CONVERSION("16bppBGR555-32bppBGRA", 2, 4, Bgr555ToBgra),
+    CONVERSION("16bppBGRA5551-32bppBGRA", 2, 4, Bgra5551ToBgra),
+    CONVERSION("16bppBGR565-32bppBGRA", 2, 4, Bgr565ToBgra),
+    CONVERSION("16bppBGR565-32bppRGBA", 2, 4, Bgr565ToRgba),
+};
+
+/* HELPERS *******************************************************************/
+
+static ULONGLONG
+NowNs(VOID)
+{
+    struct timespec Ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &Ts);
+    return (ULONGLONG)Ts.tv_sec * 1000000000ULL + Ts.tv_nsec;
+}
+
+static PVOID
+XAlloc(SIZE_T Size)
+{
+    PVOID Buffer = malloc(Size);
+
+    if (!Buffer)
+    {
+        fprintf(stderr, "wicconvbench: out of memory\n");
+        exit(1);
+    }
+    return Buffer;
+}
+
+/* Random bytes, with alpha 0 and 255 showing up more often than that */
+static VOID
+FillRandom(BYTE *Data, SIZE_T Size, UINT *State)
+{
+    SIZE_T i;
+
+    for (i = 0; i < Size; i++)
+    {
+        *State ^= *State << 13;
+        *State ^= *State >> 17;
+        *State ^= *State << 5;
+        Data[i] = (BYTE)*State;
+        if (i % 4 == 3 && (*State >> 8) % 8 == 0)
+            Data[i] = ((*State >> 11) & 1) ? 255 : 0;
+    }
+}
+
+static UINT
+Checksum(const BYTE *Data, SIZE_T Size)
+{
+    UINT Hash = 2166136261u;
+    SIZE_T i;
+
+    for (i = 0; i < Size; i++)
+        Hash = (Hash ^ Data[i]) * 16777619u;
+    return Hash;
+}
+
+/* Small images of every width up to 40, so each tail length is covered */
+static BOOL
+CheckConversion(const CONVERSION *Conv, const BYTE *Src, BYTE *Old, BYTE *New)
+{
+    UINT Width, Height = 3;
+
+    for (Width = 1; Width <= 40; Width++)
+    {
+        SIZE_T Size = (SIZE_T)Width * Height * Conv->DstBytes;
+
+        memset(Old, 0xcc, Size + 16);
+        memset(New, 0xcc, Size + 16);
+        Conv->Old(Src, Old, Width, Height);
+        Conv->New(Src, New, Width, Height);
+        if (memcmp(Old, New, Size + 16))
+        {
+            fprintf(stderr, "wicconvbench: %s differs at width %u\n", Conv->Name, Width);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static VOID
+Usage(VOID)
+{
+    printf("Usage: wicconvbench [-r runs]\n"
+           "\n"
+           "  -r runs     Time each conversion this many times, keep the best (default 5)\n");
+}
+
+int main(int argc, char **argv)
+{
+    UINT Runs = 5, Run, c, State = 0x12345678;
+    SIZE_T Pixels = (SIZE_T)WIDTH * HEIGHT;
+    BYTE *Src, *Old, *New;
+    int Arg, Failed = 0;
+
+    for (Arg = 1; Arg < argc; Arg++)
+    {
+        if (Arg + 1 < argc && !strcmp(argv[Arg], "-r"))
+        {
+            Runs = strtoul(argv[++Arg], NULL, 0);
+        }
+        else
+        {
+            Usage();
+            return strcmp(argv[Arg], "-h") ? 1 : 0;
+        }
+    }
+    if (!Runs)
+    {
+        fprintf(stderr, "wicconvbench: nothing to do\n");
+        return 1;
+    }
+
+    Src = XAlloc(Pixels * 4);
+    Old = XAlloc(Pixels * 4 + 16);
+    New = XAlloc(Pixels * 4 + 16);
+    FillRandom(Src, Pixels * 4, &State);
+    FillRandom((BYTE *)Palette, sizeof(Palette), &State);
+
+    printf("conversion,width,height,runs,old_ns,new_ns,old_mpix_s,new_mpix_s,checksum\n");
+    for (c = 0; c < sizeof(Conversions) / sizeof(Conversions[0]); c++)
+    {
+        const CONVERSION *Conv = &Conversions[c];
+        ULONGLONG OldNs = ~0ULL, NewNs = ~0ULL, Start;
+        SIZE_T Size = Pixels * Conv->DstBytes;
+
+        if (!CheckConversion(Conv, Src, Old, New))
+        {
+            Failed = 1;
+            continue;
+        }
+
+        for (Run = 0; Run < Runs; Run++)
+        {
+            Start = NowNs();
+            Conv->Old(Src, Old, WIDTH, HEIGHT);
+            OldNs = min(OldNs, NowNs() - Start);
+
+            Start = NowNs();
+            Conv->New(Src, New, WIDTH, HEIGHT);
+            NewNs = min(NewNs, NowNs() - Start);
+        }
+
+        if (memcmp(Old, New, Size))
+        {
+            fprintf(stderr, "wicconvbench: %s differs\n", Conv->Name);
+            Failed = 1;
+        }
+
+        printf("%s,%u,%u,%u,%llu,%llu,%.1f,%.1f,%08x\n", Conv->Name, WIDTH, HEIGHT, Runs,
+               OldNs, NewNs, Pixels * 1000.0 / OldNs, Pixels * 1000.0 / NewNs,
+               Checksum(New, Size));
+    }
+
+    free(Src);
+    free(Old);
+    free(New);
+    return Failed;
+}
@@ -0,0 +1,308 @@
+/*
+ * PROJECT:     ReactOS Windows Imaging Component Benchmarks
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Host benchmark for the bitmap scaler's resampling filters
+ *
+ * Builds windowscodecs' resample.c for the host and scales generated
+ * images the way the scaler does, one destination row at a time. Before
+ * timing, every result is checked against the same filter computed in
+ * double precision (off by at most one), and a flat image has to come
+ * out unchanged. One CSV line per test:
+ *
+ *   mode,channels,src_width,src_height,dst_width,dst_height,runs,nearest_ns,filter_ns,checksum
+ *
+ * nearest_ns is the nearest neighbour copy the scaler used for every
+ * mode before. The checksum doesn't depend on the SIMD loops, so builds
+ * with and without them can be compared.
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include <typedefs.h>
+#include <string.h>
+#include "resample.h"
+
+#define min(a, b)       (((a) < (b)) ? (a) : (b))
+
+typedef struct _TEST
+{
+    UINT SrcWidth, SrcHeight;
+    UINT DstWidth, DstHeight;
+} TEST;
+
+static const TEST Tests[] =
+{
+    { 3000, 2000, 640, 427 },       /* photo to preview */
+    { 3000, 2000, 160, 107 },       /* photo to thumbnail */
+    { 640, 480, 1600, 1200 },       /* enlarge */
+};
+
+static const struct
+{
+    const char *Name;
+    resample_kind Kind;
+} Modes[] =
+{
+    { "linear", RESAMPLE_LINEAR },
+    { "cubic", RESAMPLE_CUBIC },
+    { "fant", RESAMPLE_FANT },
+};
+
+static const UINT Channels[] = { 4, 3, 1 };
+
+/* HELPERS *******************************************************************/
+
+static ULONGLONG
+NowNs(VOID)
+{
+    struct timespec Ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &Ts);
+    return (ULONGLONG)Ts.tv_sec * 1000000000ULL + Ts.tv_nsec;
+}
+
+static PVOID
+XAlloc(SIZE_T Size)
+{
+    PVOID Buffer = malloc(Size);
+
+    if (!Buffer)
+    {
+        fprintf(stderr, "wicbench: out of memory\n");
+        exit(1);
+    }
+    return Buffer;
+}
+
+/* Gradients with some noise, so every tap matters */
+static VOID
+FillImage(BYTE *Bits, UINT Width, UINT Height, UINT Channels, BOOL Flat)
+{
+    UINT State = 0x12345678, x, y, c;
+
+    for (y = 0; y < Height; y++)
+    {
+        for (x = 0; x < Width; x++)
+        {
+            for (c = 0; c < Channels; c++)
+            {
+                State ^= State << 13;
+                State ^= State >> 17;
+                State ^= State << 5;
+                Bits[(y * Width + x) * Channels + c] = Flat ? 0x5a + c :
+                    (BYTE)(x * (c + 1) + y * (3 - c) + (State & 0x3f));
+            }
+        }
+    }
+}
+
+static VOID
+InitFilter(resample_filter *Filter, resample_kind Kind, UINT Src, UINT Dst)
+{
+    Filter->taps = resample_filter_taps(Kind, Src, Dst);
+    Filter->start = XAlloc(sizeof(UINT) * Dst);
+    Filter->weights = XAlloc(sizeof(SHORT) * Dst * Filter->taps);
+    resample_filter_init(Filter, Kind, Src, Dst);
+}
+
+static VOID
+FreeFilter(resample_filter *Filter)
+{
+    free(Filter->start);
+    free(Filter->weights);
+}
+
+/* What the scaler's Filter_CopyScanline does for a full width row */
+static VOID
+Scale(const resample_filter *FilterX, const resample_filter *FilterY, UINT Channels,
+      BYTE **Rows, UINT DstWidth, UINT DstHeight, SHORT *Row, BYTE *Out)
+{
+    UINT y, First, Last;
+
+    First = FilterX->start[0];
+    Last = FilterX->start[DstWidth - 1] + FilterX->taps;
+    for (y = 0; y < DstHeight; y++)
+    {
+        resample_vertical(FilterY, y, Rows + FilterY->start[y],
+                          First * Channels, (Last - First) * Channels, Row);
+        resample_horizontal(FilterX, 0, DstWidth, Channels, Row, First,
+                            Out + y * DstWidth * Channels);
+    }
+}
+
+/* The scaler's old path, for every mode */
+static VOID
+Nearest(const BYTE *Src, UINT SrcWidth, UINT SrcHeight, UINT Channels,
+        BYTE *Out, UINT DstWidth, UINT DstHeight)
+{
+    UINT x, y;
+
+    for (y = 0; y < DstHeight; y++)
+    {
+        const BYTE *Row = Src + (y * SrcHeight / DstHeight) * SrcWidth * Channels;
+
+        for (x = 0; x < DstWidth; x++)
+            memcpy(Out + (y * DstWidth + x) * Channels, Row + (x * SrcWidth / DstWidth) * Channels, Channels);
+    }
+}
+
+/* Largest difference to the filter in double precision */
+static UINT
+CheckScale(const resample_filter *FilterX, const resample_filter *FilterY, UINT Channels,
+           const BYTE *Src, UINT SrcWidth, const BYTE *Out, UINT DstWidth, UINT DstHeight)
+{
+    UINT x, y, c, i, j, Worst = 0;
+
+    for (y = 0; y < DstHeight; y++)
+    {
+        const SHORT *Wy = FilterY->weights + y * FilterY->taps;
+
+        for (x = 0; x < DstWidth; x++)
+        {
+            const SHORT *Wx = FilterX->weights + x * FilterX->taps;
+
+            for (c = 0; c < Channels; c++)
+            {
+                double Sum = 0.0;
+                INT Expected, Diff;
+
+                for (j = 0; j < FilterY->taps; j++)
+                {
+                    const BYTE *Row = Src + (FilterY->start[y] + j) * SrcWidth * Channels;
+
+                    for (i = 0; i < FilterX->taps; i++)
+                        Sum += (double)Wy[j] * Wx[i] * Row[(FilterX->start[x] + i) * Channels + c];
+                }
+                Expected = (INT)(Sum / (double)(1 << (2 * RESAMPLE_WEIGHT_BITS)) + 0.5 + 1024.0) - 1024;
+                Expected = Expected < 0 ? 0 : (Expected > 255 ? 255 : Expected);
+                Diff = abs(Expected - Out[(y * DstWidth + x) * Channels + c]);
+                if ((UINT)Diff > Worst)
+                    Worst = Diff;
+            }
+        }
+    }
+
+    return Worst;
+}
+
+static UINT
+Checksum(const BYTE *Data, SIZE_T Size)
+{
+    UINT Hash = 2166136261u;
+    SIZE_T i;
+
+    for (i = 0; i < Size; i++)
+        Hash = (Hash ^ Data[i]) * 16777619u;
+    return Hash;
+}
+
+static VOID
+Usage(VOID)
+{
+    printf("Usage: wicbench [-r runs]\n"
+           "\n"
+           "  -r runs     Time each test this many times, keep the best (default 5)\n");
+}
+
+int main(int argc, char **argv)
+{
+    UINT Runs = 5, Run, t, m, ch, y;
+    int Arg, Failed = 0;
+
+    for (Arg = 1; Arg < argc; Arg++)
+    {
+        if (Arg + 1 < argc && !strcmp(argv[Arg], "-r"))
+        {
+            Runs = strtoul(argv[++Arg], NULL, 0);
+        }
+        else
+        {
+            Usage();
+            return strcmp(argv[Arg], "-h") ? 1 : 0;
+        }
+    }
+    if (!Runs)
+    {
+        fprintf(stderr, "wicbench: nothing to do\n");
+        return 1;
+    }
+
+    printf("mode,channels,src_width,src_height,dst_width,dst_height,runs,nearest_ns,filter_ns,checksum\n");
+    for (t = 0; t < sizeof(Tests) / sizeof(Tests[0]); t++)
+    {
+        const TEST *Test = &Tests[t];
+
+        for (ch = 0; ch < sizeof(Channels) / sizeof(Channels[0]); ch++)
+        {
+            UINT Chan = Channels[ch];
+            SIZE_T SrcSize = (SIZE_T)Test->SrcWidth * Test->SrcHeight * Chan;
+            SIZE_T DstSize = (SIZE_T)Test->DstWidth * Test->DstHeight * Chan;
+            BYTE *Src = XAlloc(SrcSize), *Out = XAlloc(DstSize);
+            BYTE **Rows = XAlloc(sizeof(BYTE *) * Test->SrcHeight);
+            SHORT *Row = XAlloc(sizeof(SHORT) * (Test->SrcWidth * Chan + RESAMPLE_ROW_PADDING));
+
+            for (y = 0; y < Test->SrcHeight; y++)
+                Rows[y] = Src + y * Test->SrcWidth * Chan;
+
+            for (m = 0; m < sizeof(Modes) / sizeof(Modes[0]); m++)
+            {
+                resample_filter FilterX, FilterY;
+                ULONGLONG NearestNs = ~0ULL, FilterNs = ~0ULL, Start;
+                UINT Worst, i;
+
+                InitFilter(&FilterX, Modes[m].Kind, Test->SrcWidth, Test->DstWidth);
+                InitFilter(&FilterY, Modes[m].Kind, Test->SrcHeight, Test->DstHeight);
+
+                /* A flat image stays flat */
+                FillImage(Src, Test->SrcWidth, Test->SrcHeight, Chan, TRUE);
+                Scale(&FilterX, &FilterY, Chan, Rows, Test->DstWidth, Test->DstHeight, Row, Out);
+                for (i = 0; i < DstSize; i++)
+                {
+                    if (Out[i] != 0x5a + i % Chan)
+                    {
+                        fprintf(stderr, "wicbench: %s changes a flat %u channel image\n", Modes[m].Name, Chan);
+                        Failed = 1;
+                        break;
+                    }
+                }
+
+                FillImage(Src, Test->SrcWidth, Test->SrcHeight, Chan, FALSE);
+                Scale(&FilterX, &FilterY, Chan, Rows, Test->DstWidth, Test->DstHeight, Row, Out);
+                Worst = CheckScale(&FilterX, &FilterY, Chan, Src, Test->SrcWidth, Out,
+                                   Test->DstWidth, Test->DstHeight);
+                if (Worst > 1)
+                {
+                    fprintf(stderr, "wicbench: %s %u channels %ux%u is off by %u\n",
+                            Modes[m].Name, Chan, Test->DstWidth, Test->DstHeight, Worst);
+                    Failed = 1;
+                }
+
+                for (Run = 0; Run < Runs; Run++)
+                {
+                    Start = NowNs();
+                    Nearest(Src, Test->SrcWidth, Test->SrcHeight, Chan, Out, Test->DstWidth, Test->DstHeight);
+                    NearestNs = min(NearestNs, NowNs() - Start);
+
+                    Start = NowNs();
+                    Scale(&FilterX, &FilterY, Chan, Rows, Test->DstWidth, Test->DstHeight, Row, Out);
+                    FilterNs = min(FilterNs, NowNs() - Start);
+                }
+
+                printf("%s,%u,%u,%u,%u,%u,%u,%llu,%llu,%08x\n", Modes[m].Name, Chan,
+                       Test->SrcWidth, Test->SrcHeight, Test->DstWidth, Test->DstHeight, Runs,
+                       NearestNs, FilterNs, Checksum(Out, DstSize));
+
+                FreeFilter(&FilterX);
+                FreeFilter(&FilterY);
+            }
+
+            free(Src);
+            free(Out);
+            free(Rows);
+            free(Row);
+        }
+    }
+
+    return Failed;
+}